@@ -40,6 +40,15 @@
 /* Circular buffer size */
 #define AU_BUF_SIZE (32 * 1024)
 
+/*
+ * The play buffer is split into blocks of info.blocksize bytes.
+ * Up to info.hiwat blocks are handed to the hardware at a time,
+ * so the next block is already queued when one completes.
+ */
+#define AU_DEFAULT_BLKSIZE (AU_BUF_SIZE / 4)
+#define AU_DEFAULT_HIWAT    3   /* triple buffering */
+#define AU_MIN_BLKSIZE      64
+
 struct aucb {
     char    *buf;
     size_t  size;
@@ -48,6 +57,13 @@ struct aucb {
     size_t  used;
     int     active;
     struct event event;
+    /* Block queue (play only) */
+    size_t  blksize;    /* block size */
+    int     nblks;      /* number of blocks in buf */
+    size_t  fill;       /* bytes in the tail block */
+    int     starved;    /* hardware ran out of data */
+    u_int   blocks;     /* blocks played */
+    u_int   underruns;  /* times the hardware was starved */
 };
 
 struct audio_softc {
@@ -123,15 +139,78 @@ static int aucb_init(struct aucb *cb, size_t size) {
     return 0;
 }
 
+/* Set the block size of the play buffer */
+static void aucb_setblk(struct aucb *cb, size_t blksize) {
+    cb->blksize = blksize;
+    cb->nblks = (int)(cb->size / blksize);
+    cb->head = 0;
+    cb->tail = 0;
+    cb->used = 0;
+    cb->fill = 0;
+}
+
 static void audio_play_intr(void *priv) {
     struct audio_softc *sc = priv;
     struct aucb *cb = &sc->play_cb;
-    
-    /* Hardware finished a chunk */
-    cb->active = 0;
+
+    /* Hardware finished a block */
+    if (cb->used > 0) {
+        cb->head = (cb->head + 1) % cb->nblks;
+        cb->used--;
+        cb->blocks++;
+    }
+    if (cb->used == 0) {
+        cb->starved = 1;
+        cb->active = 0;
+        sc->info.play.active = 0;
+    }
     sched_wakeup(&cb->event);
 }
 
+/*
+ * Hand the tail block to the hardware.
+ * Must be called with the scheduler locked.
+ */
+static void audio_queue(struct audio_softc *sc) {
+    struct aucb *cb = &sc->play_cb;
+    char *blk = cb->buf + cb->tail * cb->blksize;
+    size_t len = cb->fill;
+
+    if (len == 0)
+        return;
+
+    /*
+     * The hardware went idle while the stream was still being
+     * written.  An explicit drain or flush ends the stream.
+     */
+    if (cb->used == 0 && cb->starved) {
+        cb->underruns++;
+        sc->info.play.error = 1;
+    }
+    cb->starved = 0;
+    cb->tail = (cb->tail + 1) % cb->nblks;
+    cb->fill = 0;
+    cb->used++;
+    cb->active = 1;
+    sc->info.play.active = 1;
+    sc->info.play.seek += len;
+    sc->hw_if->start_output(sc->hw_priv, blk, len, audio_play_intr);
+}
+
+/*
+ * Queue the partial block and wait until all blocks are played.
+ */
+static void audio_drain(struct audio_softc *sc) {
+    struct aucb *cb = &sc->play_cb;
+
+    sched_lock();
+    audio_queue(sc);
+    while (cb->used > 0)
+        sched_sleep(&cb->event);
+    cb->starved = 0;
+    sched_unlock();
+}
+
 static void audio_record_intr(void *priv) {
     struct audio_softc *sc = priv;
     struct aucb *cb = &sc->record_cb;
@@ -155,10 +234,9 @@ static int audio_open(device_t dev, int mode) {
     sc->opened = 1;
     
     /* Reset Playback buffer */
-    sc->play_cb.head = 0;
-    sc->play_cb.tail = 0;
-    sc->play_cb.used = 0;
+    aucb_setblk(&sc->play_cb, sc->play_cb.blksize);
     sc->play_cb.active = 0;
+    sc->play_cb.starved = 0;
     
     /* Reset Record buffer */
     sc->record_cb.head = 0;
@@ -172,6 +250,7 @@ static int audio_open(device_t dev, int mode) {
 static int audio_close(device_t dev) {
     struct audio_softc *sc = device_private(dev);
 
+    audio_drain(sc);
     if (sc->hw_if->close)
         sc->hw_if->close(sc->hw_priv);
 
@@ -182,23 +261,42 @@ static int audio_close(device_t dev) {
 static int audio_write(device_t dev, char *buf, size_t *nbyte, int blkno) {
     struct audio_softc *sc = device_private(dev);
     struct aucb *cb = &sc->play_cb;
-
-    if (*nbyte == 0) return 0;
-
-    /* 
-     * Start hardware output and wait for completion.
-     * We use a loop and an 'active' flag to prevent the lost wakeup problem.
+    size_t remain = *nbyte;
+    size_t n;
+    char *blk;
+
+    /*
+     * Copy the data into the tail block, and start the hardware
+     * on it once it is full.  Sleep only while all blocks allowed
+     * by hiwat are queued.
      */
-    sched_lock();
-    cb->active = 1;
-    sc->hw_if->start_output(sc->hw_priv, buf, *nbyte, audio_play_intr);
-    
-    while (cb->active) {
-        sched_sleep(&cb->event);
+    while (remain > 0) {
+        sched_lock();
+        while (cb->used >= sc->info.hiwat) {
+            if (sched_sleep(&cb->event) == SLP_INTR) {
+                sched_unlock();
+                *nbyte -= remain;
+                return EINTR;
+            }
+        }
+        sched_unlock();
+
+        blk = cb->buf + cb->tail * cb->blksize;
+        n = cb->blksize - cb->fill;
+        if (n > remain)
+            n = remain;
+        if (copyin(buf, blk + cb->fill, n))
+            return EFAULT;
+        cb->fill += n;
+        buf += n;
+        remain -= n;
+
+        if (cb->fill == cb->blksize) {
+            sched_lock();
+            audio_queue(sc);
+            sched_unlock();
+        }
     }
-    sched_unlock();
-
-    /* We assume the hardware finished the whole chunk */
     return 0;
 }
 
@@ -246,15 +344,58 @@ static int audio_read(device_t dev, char *buf, size_t *nbyte, int blkno) {
 static int audio_ioctl(device_t dev, u_long cmd, void *arg) {
     struct audio_softc *sc = device_private(dev);
     struct audio_info *info;
+    struct audio_info uinfo;
+    struct audio_stats stats;
+    struct aucb *cb = &sc->play_cb;
 
     switch (cmd) {
     case AUDIO_GETINFO:
-        memcpy(arg, &sc->info, sizeof(struct audio_info));
+        if (copyout(&sc->info, arg, sizeof(struct audio_info)))
+            return EFAULT;
+        return 0;
+
+    case AUDIO_GETSTATS:
+        sched_lock();
+        stats.blocks = cb->blocks;
+        stats.underruns = cb->underruns;
+        stats.queued = (u_int)cb->used;
+        stats.blocksize = (u_int)cb->blksize;
+        sched_unlock();
+        if (copyout(&stats, arg, sizeof(stats)))
+            return EFAULT;
         return 0;
 
     case AUDIO_SETINFO:
-        info = arg;
-        
+        if (copyin(arg, &uinfo, sizeof(uinfo)))
+            return EFAULT;
+        info = &uinfo;
+
+        /* Block size and queue depth can be changed only while idle */
+        if (info->blocksize != (u_int)-1 || info->hiwat != (u_int)-1) {
+            u_int blksize = sc->info.blocksize;
+            u_int hiwat = sc->info.hiwat;
+
+            if (cb->used > 0 || cb->fill > 0)
+                return EBUSY;
+            if (info->blocksize != (u_int)-1)
+                blksize = info->blocksize & ~3U;
+            if (blksize < AU_MIN_BLKSIZE || blksize > AU_BUF_SIZE / 3)
+                return EINVAL;
+            if (info->hiwat != (u_int)-1)
+                hiwat = info->hiwat;
+            if (hiwat < 2)
+                hiwat = 2;
+            /* The tail block must stay free for the writer */
+            if (hiwat > AU_BUF_SIZE / blksize - 1)
+                hiwat = AU_BUF_SIZE / blksize - 1;
+            /* Nor can more blocks be queued than the hardware holds */
+            if (sc->hw_if->maxblks != 0 && hiwat > sc->hw_if->maxblks)
+                hiwat = sc->hw_if->maxblks;
+            aucb_setblk(cb, blksize);
+            sc->info.blocksize = blksize;
+            sc->info.hiwat = hiwat;
+        }
+
         /* Playback configuration */
         if (info->play.encoding != (u_int)-1) {
             struct audio_params params;
@@ -281,15 +422,14 @@ static int audio_ioctl(device_t dev, u_long cmd, void *arg) {
         return 0;
 
     case AUDIO_DRAIN:
-        while (sc->play_cb.used > 0) {
-            sched_sleep(&sc->play_cb.event);
-        }
+        audio_drain(sc);
         return 0;
 
     case AUDIO_FLUSH:
-        sc->play_cb.head = 0;
-        sc->play_cb.tail = 0;
-        sc->play_cb.used = 0;
+        sched_lock();
+        aucb_setblk(cb, cb->blksize);
+        cb->starved = 0;
+        sched_unlock();
         sc->record_cb.head = 0;
         sc->record_cb.tail = 0;
         sc->record_cb.used = 0;
@@ -330,12 +470,14 @@ device_t audio_attach(const char *name, struct audio_hw_if *hw_if, void *hw_priv
     sc->info.record.channels = AU_DEFAULT_CHANNELS;
     sc->info.record.encoding = AU_DEFAULT_ENCODING;
     
-    sc->info.blocksize = AU_BUF_SIZE / 2;
+    sc->info.blocksize = AU_DEFAULT_BLKSIZE;
+    sc->info.hiwat = AU_DEFAULT_HIWAT;
 
     /* Initialize buffers */
     if (aucb_init(&sc->play_cb, AU_BUF_SIZE) != 0) {
         return 0;
     }
+    aucb_setblk(&sc->play_cb, AU_DEFAULT_BLKSIZE);
     if (aucb_init(&sc->record_cb, AU_BUF_SIZE) != 0) {
         return 0;
     }
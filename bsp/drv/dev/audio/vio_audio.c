@@ -90,6 +90,9 @@
 
 /* VirtQueue Configuration */
 #define VQ_SIZE                      16
+
+/* Each play block takes three descriptors and its own status */
+#define VIO_TX_SLOTS                 (VQ_SIZE / 3)
 #ifndef PAGE_SHIFT
 #define PAGE_SHIFT                   12
 #endif
@@ -176,7 +179,7 @@ struct vio_audio_softc {
     /* Shared buffers for command responses */
     void *ctrl_req;
     struct virtio_snd_hdr *resp_hdr;
-    struct virtio_snd_pcm_status *pcm_status;
+    struct virtio_snd_pcm_status *pcm_status;  /* VIO_TX_SLOTS entries */
     struct virtio_snd_pcm_xfer *xfer;
     
     int pcm_started;
@@ -200,6 +203,7 @@ static struct audio_hw_if vio_audio_hw_if = {
     NULL, /* start_input */
     NULL, /* stop_input */
     vio_audio_set_volume,
+    VIO_TX_SLOTS,
 };
 
 static int vio_audio_set_volume(void *priv, uint8_t volume)
@@ -351,6 +355,7 @@ static int vio_audio_start_output(void *priv, void *block, size_t blksize, void
         return EFAULT;
 
     int head = vq->next_free;
+    int slot = vq->avail->idx % VIO_TX_SLOTS;
     sc->xfer->stream_id = VIO_SND_STREAM_PLAY;
     
     vq->desc[head].addr = (uint64_t)kvtop(sc->xfer);
@@ -365,7 +370,7 @@ static int vio_audio_start_output(void *priv, void *block, size_t blksize, void
     vq->desc[d1].next = (head + 2) % VQ_SIZE;
 
     int d2 = (head + 2) % VQ_SIZE;
-    vq->desc[d2].addr = (uint64_t)kvtop(sc->pcm_status);
+    vq->desc[d2].addr = (uint64_t)kvtop(&sc->pcm_status[slot]);
     vq->desc[d2].len = sizeof(struct virtio_snd_pcm_status);
     vq->desc[d2].flags = VRING_DESC_F_WRITE;
     vq->desc[d2].next = 0;
@@ -253,11 +253,11 @@ static int kd_task(int argc, char** argv)
 static void kd_vm_region(task_t task)
 {
     struct vminfo vi;
-    char flags[6];
+    char flags[7];
     int rc;
 
-    printf(" virtual  physical     size flags\n");
-    printf(" -------- -------- -------- -----\n");
+    printf(" virtual  physical     size resident flags\n");
+    printf(" -------- -------- -------- -------- ------\n");
 
     rc = 0;
     vi.cookie = 0;
@@ -267,7 +267,7 @@ static void kd_vm_region(task_t task)
         rc = sysinfo(INFO_VM, &vi);
         if (!rc) {
             if (vi.flags != VF_FREE) {
-                strlcpy(flags, "-----", sizeof(flags));
+                strlcpy(flags, "------", sizeof(flags));
                 if (vi.flags & VF_READ)
                     flags[0] = 'R';
                 if (vi.flags & VF_WRITE)
@@ -278,7 +278,9 @@ static void kd_vm_region(task_t task)
                     flags[3] = 'S';
                 if (vi.flags & VF_MAPPED)
                     flags[4] = 'M';
-                printf(" %08lx %08lx %8x %s\n", (long)vi.virt, (long)vi.phys, vi.size, flags);
+                if (vi.flags & VF_LAZY)
+                    flags[5] = 'L';
+                printf(" %08lx %08lx %8x %8x %s\n", (long)vi.virt, (long)vi.phys, vi.size, vi.resident, flags);
             }
         }
     } while (rc == 0);
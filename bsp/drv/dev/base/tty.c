@@ -70,10 +70,24 @@ static const cc_t ttydefchars[NCCS] = TTYDEFCHARS;
 /*
  * TTY queue operations
  */
-#define ttyq_next(i) (((i) + 1) & (TTYQ_SIZE - 1))
-#define ttyq_prev(i) (((i)-1) & (TTYQ_SIZE - 1))
-#define ttyq_full(q) ((q)->tq_count >= TTYQ_SIZE)
+#define ttyq_next(q, i) (((i) + 1) & ((q)->tq_size - 1))
+#define ttyq_prev(q, i) (((i)-1) & ((q)->tq_size - 1))
+#define ttyq_full(q) ((q)->tq_count >= (q)->tq_size)
 #define ttyq_empty(q) ((q)->tq_count == 0)
+#define ttyq_room(q) ((q)->tq_size - (q)->tq_count)
+
+/* Size of the staging buffer used by tty_write() */
+#define TTY_OBUFSZ 128
+
+static void ttyq_init(struct tty_queue* tq, char* buf, int size)
+{
+
+    tq->tq_buf = buf;
+    tq->tq_size = size;
+    tq->tq_head = 0;
+    tq->tq_tail = 0;
+    tq->tq_count = 0;
+}
 
 /*
  * Get a character from a queue.
@@ -89,12 +103,38 @@ int tty_getc(struct tty_queue* tq)
         return -1;
     }
     c = tq->tq_buf[tq->tq_head];
-    tq->tq_head = ttyq_next(tq->tq_head);
+    tq->tq_head = ttyq_next(tq, tq->tq_head);
     tq->tq_count--;
     sched_unlock();
     return (int)c;
 }
 
+/*
+ * Get up to len characters from a queue.
+ * Returns the number of characters copied to buf.
+ */
+int tty_getq(struct tty_queue* tq, char* buf, int len)
+{
+    int n, cnt, total = 0;
+
+    sched_lock();
+    while (len > 0 && !ttyq_empty(tq)) {
+        /* Copy up to the end of the ring in one go */
+        cnt = tq->tq_size - tq->tq_head;
+        if (cnt > tq->tq_count)
+            cnt = tq->tq_count;
+        n = (cnt < len) ? cnt : len;
+        memcpy(buf, &tq->tq_buf[tq->tq_head], (size_t)n);
+        tq->tq_head = (tq->tq_head + n) & (tq->tq_size - 1);
+        tq->tq_count -= n;
+        buf += n;
+        len -= n;
+        total += n;
+    }
+    sched_unlock();
+    return total;
+}
+
 /*
  * Put a character into a queue.
  */
@@ -106,11 +146,34 @@ static void tty_putc(int c, struct tty_queue* tq)
         return;
     }
     tq->tq_buf[tq->tq_tail] = (char)(c & 0xff);
-    tq->tq_tail = ttyq_next(tq->tq_tail);
+    tq->tq_tail = ttyq_next(tq, tq->tq_tail);
     tq->tq_count++;
     sched_unlock();
 }
 
+/*
+ * Put len characters into a queue.
+ * Characters that do not fit are dropped, as with tty_putc().
+ */
+static void tty_putq(const char* buf, int len, struct tty_queue* tq)
+{
+    int n, cnt;
+
+    sched_lock();
+    while (len > 0 && !ttyq_full(tq)) {
+        cnt = tq->tq_size - tq->tq_tail;
+        if (cnt > ttyq_room(tq))
+            cnt = ttyq_room(tq);
+        n = (cnt < len) ? cnt : len;
+        memcpy(&tq->tq_buf[tq->tq_tail], buf, (size_t)n);
+        tq->tq_tail = (tq->tq_tail + n) & (tq->tq_size - 1);
+        tq->tq_count += n;
+        buf += n;
+        len -= n;
+    }
+    sched_unlock();
+}
+
 /*
  * Remove the last character in a queue and return it.
  */
@@ -123,7 +186,7 @@ static int tty_unputc(struct tty_queue* tq)
         sched_unlock();
         return -1;
     }
-    tq->tq_tail = ttyq_prev(tq->tq_tail);
+    tq->tq_tail = ttyq_prev(tq, tq->tq_tail);
     c = tq->tq_buf[tq->tq_tail];
     tq->tq_count--;
     sched_unlock();
@@ -438,6 +501,35 @@ static void tty_output(int c, struct tty* tp)
     return;
 }
 
+/*
+ * Output a block of characters on a tty.
+ * Runs of printable characters bypass the per-character
+ * output processing and are queued in bulk.
+ */
+static void tty_outblock(const char* buf, int len, struct tty* tp)
+{
+    int i, run;
+
+    if ((tp->t_lflag & ICANON) == 0) {
+        tty_putq(buf, len, &tp->t_outq);
+        return;
+    }
+    i = 0;
+    while (i < len) {
+        run = 0;
+        while (i + run < len && !is_ctrl((u_char)buf[i + run]))
+            run++;
+        if (run > 0) {
+            tty_putq(&buf[i], run, &tp->t_outq);
+            tp->t_column += run;
+            i += run;
+        } else {
+            tty_output((u_char)buf[i], tp);
+            i++;
+        }
+    }
+}
+
 /*
  * Process a read call on a tty device.
  */
@@ -486,27 +578,42 @@ int tty_read(struct tty* tp, char* buf, size_t* nbyte)
  */
 int tty_write(struct tty* tp, char* buf, size_t* nbyte)
 {
-    size_t remain, count = 0;
-    u_char c;
+    char kbuf[TTY_OBUFSZ];
+    size_t remain, n, room, count = 0;
 
     DPRINTF(("tty_write\n"));
 
     remain = *nbyte;
     while (remain > 0) {
-        if (tp->t_outq.tq_count > TTYQ_HIWAT) {
+        if (tp->t_outq.tq_count > TTY_OUTQ_HIWAT) {
             tty_start(tp);
-            if (tp->t_outq.tq_count <= TTYQ_HIWAT)
-                continue;
-            tp->t_state |= TS_ASLEEP;
-            sched_sleep(&tp->t_output);
+            sched_lock();
+            if (tp->t_outq.tq_count > TTY_OUTQ_HIWAT) {
+                tp->t_state |= TS_ASLEEP;
+                sched_sleep(&tp->t_output);
+            }
+            sched_unlock();
             continue;
         }
-        if (copyin(buf, &c, 1))
+        /*
+         * Copy in a chunk that is guaranteed to fit in the
+         * output queue.  A character can expand to at most 8
+         * characters (tab) with output processing.
+         */
+        room = (size_t)ttyq_room(&tp->t_outq);
+        if (tp->t_lflag & ICANON)
+            room /= 8;
+        n = remain;
+        if (n > sizeof(kbuf))
+            n = sizeof(kbuf);
+        if (n > room)
+            n = room;
+        if (copyin(buf, kbuf, n))
             return EFAULT;
-        tty_output((int)c, tp);
-        buf++;
-        remain--;
-        count++;
+        tty_outblock(kbuf, (int)n, tp);
+        buf += n;
+        remain -= n;
+        count += n;
     }
     tty_start(tp);
     *nbyte = count;
@@ -609,6 +716,9 @@ void tty_attach(struct tty* tp)
     /* Initialize tty */
     memset(tp, 0, sizeof(struct tty));
     memcpy(&tp->t_termios.c_cc, ttydefchars, sizeof(ttydefchars));
+    ttyq_init(&tp->t_rawq, tp->t_rawbuf, TTYQ_SIZE);
+    ttyq_init(&tp->t_canq, tp->t_canbuf, TTYQ_SIZE);
+    ttyq_init(&tp->t_outq, tp->t_outbuf, TTY_OUTQ_SIZE);
 
     event_init(&tp->t_input, "TTY input");
     event_init(&tp->t_output, "TTY output");
@@ -32,6 +32,7 @@
  */
 
 #include <driver.h>
+#include <sys/ioctl.h>
 
 /* #define DEBUG_RAMDISK 1 */
 
@@ -53,6 +54,7 @@ struct ramdisk_softc
 
 static int ramdisk_read(device_t, char*, size_t*, int);
 static int ramdisk_write(device_t, char*, size_t*, int);
+static int ramdisk_ioctl(device_t, u_long, void*);
 static int ramdisk_probe(struct driver*);
 static int ramdisk_init(struct driver*);
 
@@ -61,7 +63,7 @@ static struct devops ramdisk_devops = {
     /* close */ no_close,
     /* read */ ramdisk_read,
     /* write */ ramdisk_write,
-    /* ioctl */ no_ioctl,
+    /* ioctl */ ramdisk_ioctl,
     /* devctl */ no_devctl,
 };
 
@@ -130,6 +132,21 @@ static int ramdisk_write(device_t dev, char* buf, size_t* nbyte, int blkno)
     return 0;
 }
 
+static int ramdisk_ioctl(device_t dev, u_long cmd, void* arg)
+{
+    struct ramdisk_softc* sc = device_private(dev);
+
+    switch (cmd) {
+    case RDIOC_GET_SIZE:
+        if (copyout(&sc->size, arg, sizeof(size_t)))
+            return EFAULT;
+        break;
+    default:
+        return EINVAL;
+    }
+    return 0;
+}
+
 static int ramdisk_probe(struct driver* self)
 {
     struct bootinfo* bi;
@@ -41,6 +41,9 @@ const RamdiskSoftc = struct {
 
 const BSIZE = 512;
 
+/// _IOR('r', 0, size_t) from sys/ioctl.h
+const RDIOC_GET_SIZE: c_ulong = c.IOC_OUT | (@sizeOf(usize) << 16) | ('r' << 8) | 0;
+
 /// Read function for the RAM disk
 export fn ramdisk_read(dev: c.device_t, buf: [*]c_char, nbyte: *usize, blkno: c_int) callconv(.c) c_int {
     const sc: *RamdiskSoftc = @ptrCast(@alignCast(dki.device_private(dev) orelse return c.ENODEV));
@@ -89,6 +92,19 @@ export fn ramdisk_write(dev: c.device_t, buf: [*]const c_char, nbyte: *usize, bl
     return 0;
 }
 
+/// I/O control function for the RAM disk
+export fn ramdisk_ioctl(dev: c.device_t, cmd: c_ulong, arg: ?*anyopaque) callconv(.c) c_int {
+    const sc: *RamdiskSoftc = @ptrCast(@alignCast(dki.device_private(dev) orelse return c.ENODEV));
+
+    switch (cmd) {
+        RDIOC_GET_SIZE => {
+            if (c.copyout(&sc.size, arg, @sizeOf(usize)) != 0) return c.EFAULT;
+        },
+        else => return c.EINVAL,
+    }
+    return 0;
+}
+
 /// Probe function
 export fn ramdisk_probe(_: ?*dki.Driver) callconv(.c) c_int {
     var bi: ?*c.bootinfo = null;
@@ -111,6 +127,7 @@ export fn ramdisk_init(self: ?*dki.Driver) callconv(.c) c_int {
     ramdisk_devops.close = ramdisk_close;
     ramdisk_devops.read = ramdisk_read;
     ramdisk_devops.write = ramdisk_write;
+    ramdisk_devops.ioctl = ramdisk_ioctl;
 
     const dev = dki.device_create(self.?, "ram0", c.D_BLK | c.D_PROT) catch |err| {
         dki.log("ramdisk_init: device_create failed\n", .{});
@@ -38,19 +38,33 @@ struct net_ifreq {
     char hwaddr[14];
 };
 
+/*
+ * Received frames are kept in a ring of NET_BUF_SIZE bytes.  Each
+ * frame is stored as a struct net_frame and the frame data, so that
+ * frame boundaries are preserved.  A frame never wraps; if it does
+ * not fit at the end of the ring, NET_FRAME_WRAP is stored there and
+ * the frame goes to the start of the ring.
+ */
 #define NET_BUF_SIZE (64 * 1024)
+#define NET_FRAME_WRAP 0xffff
+#define NET_BATCH_MAX  64       /* max frames per NETIO_RXBATCH */
 
 struct net_softc {
     device_t            dev;
     const struct net_hw_if *hw_if;
     void                *hw_priv;
-    int                 opened;
+    int                 opened;     /* open count */
     
     char                *rx_buf;
-    size_t              rx_head;
-    size_t              rx_tail;
-    size_t              rx_len;
+    size_t              rx_head;    /* offset of the oldest frame */
+    size_t              rx_tail;    /* offset to store the next frame */
+    size_t              rx_len;     /* bytes in use */
+    int                 rx_count;   /* frames in the ring */
+    int                 rx_full;    /* a frame was refused */
+    int                 rx_busy;    /* a reader is copying frames */
     struct event        rx_event;
+    u_int               reads;
+    u_int               stalls;
 };
 
 static int net_open(device_t dev, int mode);
@@ -81,18 +95,26 @@ static struct driver net_dev_driver = {
 static int net_open(device_t dev, int mode) {
     struct net_softc *sc = device_private(dev);
 
-    if (sc->opened)
-        return EBUSY;
+    if (sc->opened > 0) {
+        /* Additional opens are used for statistics */
+        sc->opened++;
+        return 0;
+    }
 
     if (sc->hw_if->open) {
         int err = sc->hw_if->open(sc->hw_priv);
         if (err) return err;
     }
 
+    sched_lock();
     sc->opened = 1;
     sc->rx_head = 0;
     sc->rx_tail = 0;
     sc->rx_len = 0;
+    sc->rx_count = 0;
+    sc->rx_full = 0;
+    sc->rx_busy = 0;
+    sched_unlock();
 
     return 0;
 }
@@ -100,6 +122,9 @@ static int net_open(device_t dev, int mode) {
 static int net_close(device_t dev) {
     struct net_softc *sc = device_private(dev);
 
+    if (--sc->opened > 0)
+        return 0;
+
     if (sc->hw_if->close)
         sc->hw_if->close(sc->hw_priv);
 
@@ -107,28 +132,108 @@ static int net_close(device_t dev) {
     return 0;
 }
 
-static int net_read(device_t dev, char *buf, size_t *nbyte, int blkno) {
-    struct net_softc *sc = device_private(dev);
-    size_t len = 0;
+/*
+ * Copy received frames to a user buffer.
+ *
+ * Waits for a frame, then copies up to maxframes frames.  If framed
+ * is set, each frame is copied with its struct net_frame, otherwise
+ * only the data of one frame is copied and truncated to size.
+ * The ring is read without the scheduler lock: the producer only
+ * appends after rx_tail, and only the reader holding rx_busy
+ * advances rx_head.
+ */
+static int net_rx_copy(struct net_softc *sc, char *buf, size_t size,
+                       int maxframes, int framed, size_t *used, int *nframes) {
+    struct net_frame *nf;
+    size_t pos, freed = 0, copied = 0, len, need;
+    int count, n = 0, resume, error = 0;
 
     sched_lock();
-    while (sc->rx_len == 0) {
-        if (sched_tsleep(&sc->rx_event, 0) == EINTR) {
+    while (sc->rx_count == 0 || sc->rx_busy) {
+        if (sched_sleep(&sc->rx_event) == SLP_INTR) {
             sched_unlock();
             return EINTR;
         }
     }
-    
-    /* Simplified read: In real implementation, read one packet or from ring buffer */
-    len = (*nbyte < sc->rx_len) ? *nbyte : sc->rx_len;
-    memcpy(buf, sc->rx_buf + sc->rx_head, len);
-    sc->rx_head = (sc->rx_head + len) % NET_BUF_SIZE;
-    sc->rx_len -= len;
-    
+    sc->rx_busy = 1;
+    count = sc->rx_count;
+    pos = sc->rx_head;
+    sc->reads++;
     sched_unlock();
 
-    *nbyte = len;
-    return 0;
+    if (count > maxframes)
+        count = maxframes;
+
+    while (n < count) {
+        nf = (struct net_frame *)(sc->rx_buf + pos);
+        if (nf->nf_len == NET_FRAME_WRAP) {
+            freed += NET_BUF_SIZE - pos;
+            pos = 0;
+            continue;
+        }
+        len = nf->nf_len;
+        need = NET_FRAME_SIZE(len);
+        if (framed) {
+            if (copied + sizeof(*nf) + len > size) {
+                if (n == 0)
+                    error = EINVAL;
+                break;
+            }
+            if (copyout(nf, buf + copied, sizeof(*nf) + len)) {
+                error = EFAULT;
+                break;
+            }
+            copied += need;
+        } else {
+            if (len > size)
+                len = size;
+            if (copyout(nf + 1, buf, len)) {
+                error = EFAULT;
+                break;
+            }
+            copied = len;
+        }
+        pos = (pos + need) % NET_BUF_SIZE;
+        freed += need;
+        n++;
+    }
+
+    sched_lock();
+    sc->rx_head = pos;
+    sc->rx_len -= freed;
+    sc->rx_count -= n;
+    if (sc->rx_count == 0) {
+        /* Start over at the beginning of the ring */
+        sc->rx_head = 0;
+        sc->rx_tail = 0;
+        sc->rx_len = 0;
+    }
+    resume = sc->rx_full;
+    sc->rx_full = 0;
+    sc->rx_busy = 0;
+    if (sc->rx_count > 0)
+        sched_wakeup(&sc->rx_event);
+    sched_unlock();
+
+    /* Let the hardware deliver the frames it held back */
+    if (resume && sc->hw_if->rx_resume)
+        sc->hw_if->rx_resume(sc->hw_priv);
+
+    if (copied > size)
+        copied = size;
+    *used = copied;
+    *nframes = n;
+    return error;
+}
+
+/*
+ * Read one frame.
+ */
+static int net_read(device_t dev, char *buf, size_t *nbyte, int blkno) {
+    struct net_softc *sc = device_private(dev);
+    int n;
+
+    return net_rx_copy(sc, buf, *nbyte, 1, 0, nbyte, &n);
 }
 
 static int net_write(device_t dev, char *buf, size_t *nbyte, int blkno) {
@@ -145,8 +250,29 @@ static int net_write(device_t dev, char *buf, size_t *nbyte, int blkno) {
 static int net_ioctl(device_t dev, u_long cmd, void *arg) {
     struct net_softc *sc = device_private(dev);
     struct net_ifreq *ifr = arg;
+    struct net_rxbatch rb;
+    struct net_stats stats;
+    int error;
     
     switch(cmd) {
+    case NETIO_RXBATCH:
+        if (copyin(arg, &rb, sizeof(rb)))
+            return EFAULT;
+        error = net_rx_copy(sc, rb.buf, rb.size, NET_BATCH_MAX, 1, &rb.size, &rb.nframes);
+        if (error)
+            return error;
+        if (copyout(&rb, arg, sizeof(rb)))
+            return EFAULT;
+        return 0;
+    case NETIO_GETSTATS:
+        memset(&stats, 0, sizeof(stats));
+        if (sc->hw_if->get_stats)
+            sc->hw_if->get_stats(sc->hw_priv, &stats);
+        stats.reads = sc->reads;
+        stats.stalls = sc->stalls;
+        if (copyout(&stats, arg, sizeof(stats)))
+            return EFAULT;
+        return 0;
     case SIOCGIFHWADDR:
         if (sc->hw_if->get_addr) {
             return sc->hw_if->get_addr(sc->hw_priv, (uint8_t *)ifr->hwaddr);
@@ -159,19 +285,45 @@ static int net_ioctl(device_t dev, u_long cmd, void *arg) {
 
 /* 
  * Called by MD layer when a packet is received 
+ *
+ * Returns ENOSPC if the ring is full.  The MD layer should then keep
+ * the frame, and stop receiving until rx_resume() is called.
  */
-void net_rx_complete(device_t dev, void *buf, size_t len) {
+int net_rx_complete(device_t dev, void *buf, size_t len) {
     struct net_softc *sc = device_private(dev);
+    struct net_frame *nf;
+    size_t need = NET_FRAME_SIZE(len);
+    size_t room;
 
     sched_lock();
-    if (sc->rx_len + len <= NET_BUF_SIZE) {
-        /* Simplified copy to buffer */
-        memcpy(sc->rx_buf + sc->rx_tail, buf, len);
-        sc->rx_tail = (sc->rx_tail + len) % NET_BUF_SIZE;
-        sc->rx_len += len;
-        sched_wakeup(&sc->rx_event);
-    }
+    room = NET_BUF_SIZE - sc->rx_tail;
+    if (room < need) {
+        /* Skip the end of the ring */
+        if (sc->rx_len + room + need > NET_BUF_SIZE)
+            goto full;
+        nf = (struct net_frame *)(sc->rx_buf + sc->rx_tail);
+        nf->nf_len = NET_FRAME_WRAP;
+        sc->rx_len += room;
+        sc->rx_tail = 0;
+    } else if (sc->rx_len + need > NET_BUF_SIZE)
+        goto full;
+
+    nf = (struct net_frame *)(sc->rx_buf + sc->rx_tail);
+    nf->nf_len = (u_short)len;
+    nf->nf_pad = 0;
+    memcpy(nf + 1, buf, len);
+    sc->rx_tail = (sc->rx_tail + need) % NET_BUF_SIZE;
+    sc->rx_len += need;
+    sc->rx_count++;
+    sched_wakeup(&sc->rx_event);
+    sched_unlock();
+    return 0;
+
+ full:
+    sc->rx_full = 1;
+    sc->stalls++;
     sched_unlock();
+    return ENOSPC;
 }
 
 device_t net_attach(const char *name, const struct net_hw_if *hw_if, void *hw_priv) {
@@ -61,6 +61,9 @@
 #define VRING_DESC_F_NEXT       1
 #define VRING_DESC_F_WRITE      2
 
+/* VirtQueue Avail Flags */
+#define VRING_AVAIL_F_NO_INTERRUPT 1
+
 #define VQ_SIZE 16
 #define PKT_BUF_SIZE 2048
 
@@ -119,8 +122,17 @@ struct vio_net_softc {
     void                  *rx_pkts[VQ_SIZE];
     struct virtio_net_hdr *rx_hdrs[VQ_SIZE];
     struct event          tx_event;
+
+    /* Receive polling */
+    int                   rx_stalled;   /* MI receive queue is full */
+    u_int                 intrs;
+    u_int                 polls;
+    u_int                 frames;
+    u_int                 max_batch;
 };
 
+static void vio_net_rx(struct vio_net_softc *sc);
+
 static int vio_net_open(void *priv) {
     return 0;
 }
@@ -181,6 +193,26 @@ static int vio_net_get_addr(void *priv, uint8_t *addr) {
     return 0;
 }
 
+static void vio_net_rx_resume(void *priv) {
+    struct vio_net_softc *sc = priv;
+
+    sched_lock();
+    sc->rx_stalled = 0;
+    vio_net_rx(sc);
+    sched_unlock();
+}
+
+static void vio_net_get_stats(void *priv, struct net_stats *stats) {
+    struct vio_net_softc *sc = priv;
+
+    sched_lock();
+    stats->intrs = sc->intrs;
+    stats->polls = sc->polls;
+    stats->frames = sc->frames;
+    stats->max_batch = sc->max_batch;
+    sched_unlock();
+}
+
 static struct net_hw_if vio_net_hw_if = {
     vio_net_open,
     vio_net_close,
@@ -188,6 +220,8 @@ static struct net_hw_if vio_net_hw_if = {
     vio_net_get_addr,
     NULL, /* set_addr */
     NULL, /* set_promisc */
+    vio_net_rx_resume,
+    vio_net_get_stats,
 };
 
 __isr
@@ -197,26 +231,38 @@ static int vio_net_isr(void* arg)
     uint32_t status = bus_read_32(sc->base + VIO_MMIO_IRQ_STATUS);
     if (status) {
         bus_write_32(sc->base + VIO_MMIO_IRQ_ACK, status);
+        sc->intrs++;
         return INT_CONTINUE;
     }
     return INT_DONE;
 }
 
-static void vio_net_ist(void* arg)
+/*
+ * Pass received frames to the MI layer, and give the buffers back
+ * to the device.  Returns the number of frames.
+ */
+static int vio_net_rx_poll(struct vio_net_softc *sc)
 {
-    struct vio_net_softc* sc = arg;
     struct vio_net_vq *rx_vq = &sc->vqs[VIO_NET_VQ_RX];
-    struct vio_net_vq *tx_vq = &sc->vqs[VIO_NET_VQ_TX];
+    volatile struct vring_used_elem *ue;
+    uint32_t len;
+    int id, n = 0, refill = 0;
 
-    /* Process RX */
     while (rx_vq->used->idx != rx_vq->last_used_idx) {
-        volatile struct vring_used_elem *ue = &rx_vq->used->ring[rx_vq->last_used_idx % VQ_SIZE];
-        int id = ue->id;
-        uint32_t len = ue->len;
+        __sync_synchronize();
+        ue = &rx_vq->used->ring[rx_vq->last_used_idx % VQ_SIZE];
+        id = ue->id;
+        len = ue->len;
         
         /* ue->len includes the virtio header size */
         if (len > sizeof(struct virtio_net_hdr)) {
-            net_rx_complete(sc->net_dev, sc->rx_pkts[id / 2], len - sizeof(struct virtio_net_hdr));
+            if (net_rx_complete(sc->net_dev, sc->rx_pkts[id / 2],
+                                len - sizeof(struct virtio_net_hdr)) != 0) {
+                /* MI queue is full: keep the frame in the ring */
+                sc->rx_stalled = 1;
+                break;
+            }
+            n++;
         }
 
         /* Put descriptor back to avail ring */
@@ -226,8 +272,62 @@ static void vio_net_ist(void* arg)
         __sync_synchronize();
         
         rx_vq->last_used_idx++;
+        refill = 1;
+    }
+    if (refill)
+        bus_write_32(sc->base + VIO_MMIO_QUEUE_NOTIFY, VIO_NET_VQ_RX);
+    return n;
+}
+
+/*
+ * Receive frames in polled mode.
+ *
+ * Interrupts are suppressed while the used ring has frames, so a
+ * burst of frames costs one interrupt.  Polling stops when the ring
+ * is empty, or when the MI queue is full.  In the latter case the
+ * host holds further frames until net.c calls rx_resume().
+ * Must be called with the scheduler locked.
+ */
+static void vio_net_rx(struct vio_net_softc *sc)
+{
+    struct vio_net_vq *rx_vq = &sc->vqs[VIO_NET_VQ_RX];
+    int n;
+
+    rx_vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+    while (!sc->rx_stalled) {
+        n = vio_net_rx_poll(sc);
+        if (n > 0) {
+            sc->polls++;
+            sc->frames += n;
+            if ((u_int)n > sc->max_batch)
+                sc->max_batch = n;
+            continue;
+        }
+        if (sc->rx_stalled)
+            break;
+
+        /*
+         * Ring is empty.  Enable interrupts again, and check for
+         * a frame which arrived before the device saw the flag.
+         */
+        rx_vq->avail->flags = 0;
+        __sync_synchronize();
+        if (rx_vq->used->idx == rx_vq->last_used_idx)
+            break;
+        rx_vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
     }
-    bus_write_32(sc->base + VIO_MMIO_QUEUE_NOTIFY, VIO_NET_VQ_RX);
+}
+
+static void vio_net_ist(void* arg)
+{
+    struct vio_net_softc* sc = arg;
+    struct vio_net_vq *tx_vq = &sc->vqs[VIO_NET_VQ_TX];
+
+    /* Process RX */
+    sched_lock();
+    if (!sc->rx_stalled)
+        vio_net_rx(sc);
+    sched_unlock();
 
     /* Process TX completion */
     if (tx_vq->used->idx != tx_vq->last_used_idx) {
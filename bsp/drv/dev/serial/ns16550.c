@@ -84,6 +84,8 @@
 #define LSR_RXRDY 0x01    /* Byte ready in Receive Buffer */
 #define LSR_RCV_MASK 0x1f /* Mask for incoming data or error */
 
+#define COM_FIFO_SIZE 16 /* transmit FIFO size */
+
 /* Forward functions */
 static int ns16550_probe(struct driver*);
 static int ns16550_init(struct driver*);
@@ -93,6 +95,7 @@ static char ns16550_rcv_char(struct serial_port*);
 static void ns16550_set_poll(struct serial_port*, int);
 static void ns16550_start(struct serial_port*);
 static void ns16550_stop(struct serial_port*);
+static void ns16550_xmt_start(struct serial_port*);
 
 struct driver ns16550_driver = {
     /* name */ "ns16550",
@@ -110,9 +113,12 @@ static struct serial_ops ns16550_ops = {
     /* set_poll */ ns16550_set_poll,
     /* start */ ns16550_start,
     /* stop */ ns16550_stop,
+    /* xmt_start */ ns16550_xmt_start,
 };
 
 static struct serial_port ns16550_port;
+static volatile int ns16550_ier; /* current interrupt enable bits */
+static int ns16550_polling;       /* true in polling mode */
 
 static void ns16550_xmt_char(struct serial_port* sp, char c)
 {
@@ -133,19 +139,63 @@ static char ns16550_rcv_char(struct serial_port* sp)
 static void ns16550_set_poll(struct serial_port* sp, int on)
 {
 
+    ns16550_polling = on;
     if (on) {
         /* Disable interrupt for polling mode. */
         bus_write_8(COM_IER, 0x00);
     } else {
         /* enable interrupt again */
-        bus_write_8(COM_IER, IER_RDA | IER_THRE | IER_RLS);
+        bus_write_8(COM_IER, ns16550_ier);
+    }
+}
+
+/*
+ * Start interrupt driven output.
+ * The THRE interrupt fires as soon as it is enabled
+ * if the transmitter is idle.
+ */
+static void ns16550_xmt_start(struct serial_port* sp)
+{
+    int s;
+
+    s = splhigh();
+    if (!(ns16550_ier & IER_THRE)) {
+        ns16550_ier |= IER_THRE;
+        if (!ns16550_polling)
+            bus_write_8(COM_IER, ns16550_ier);
     }
+    splx(s);
+}
+
+/*
+ * Refill the transmit FIFO from the output queue.
+ */
+static void ns16550_ist(void* arg)
+{
+    struct serial_port* sp = arg;
+    char buf[COM_FIFO_SIZE];
+    int i, n, s;
+
+    sched_lock();
+    n = tty_getq(&sp->tty->t_outq, buf, COM_FIFO_SIZE);
+    for (i = 0; i < n; i++)
+        bus_write_8(COM_THR, buf[i]);
+    if (n > 0) {
+        s = splhigh();
+        ns16550_ier |= IER_THRE;
+        if (!ns16550_polling)
+            bus_write_8(COM_IER, ns16550_ier);
+        splx(s);
+    }
+    serial_xmt_done(sp);
+    sched_unlock();
 }
 
 __isr
 static int ns16550_isr(void* arg)
 {
     struct serial_port* sp = arg;
+    int rc = INT_DONE;
 
     switch (bus_read_8(COM_IIR) & IIR_MASK) {
     case IIR_MSR: /* Modem status change */
@@ -154,14 +204,17 @@ static int ns16550_isr(void* arg)
         bus_read_8(COM_LSR);
         break;
     case IIR_TXB: /* Transmitter holding register empty */
-        serial_xmt_done(sp);
+        /* Mask THRE until the IST refills the FIFO */
+        ns16550_ier &= ~IER_THRE;
+        bus_write_8(COM_IER, ns16550_ier);
+        rc = INT_CONTINUE;
         break;
     case IIR_RXB: /* Received data available */
-        bus_read_8(COM_LSR);
-        serial_rcv_char(sp, bus_read_8(COM_RBR));
+        while (bus_read_8(COM_LSR) & LSR_RXRDY)
+            serial_rcv_char(sp, bus_read_8(COM_RBR));
         break;
     }
-    return 0;
+    return rc;
 }
 
 static void ns16550_start(struct serial_port* sp)
@@ -173,13 +226,14 @@ static void ns16550_start(struct serial_port* sp)
     bus_write_8(COM_DLL, 0x01); /* 115200 baud */
     bus_write_8(COM_DLM, 0x00);
     bus_write_8(COM_LCR, 0x03); /* N, 8, 1 */
-    bus_write_8(COM_FCR, 0x06); /* Disable & clear FIFO */
+    bus_write_8(COM_FCR, 0x07); /* Enable & clear FIFO */
 
-    sp->irq = irq_attach(COM_IRQ, IPL_COMM, 0, ns16550_isr, IST_NONE, sp);
+    sp->irq = irq_attach(COM_IRQ, IPL_COMM, 0, ns16550_isr, ns16550_ist, sp);
 
     s = splhigh();
-    bus_write_8(COM_MCR, 0x0b);                         /* Enable OUT2 interrupt */
-    bus_write_8(COM_IER, IER_RDA | IER_THRE | IER_RLS); /* Enable interrupt */
+    ns16550_ier = IER_RDA | IER_RLS;
+    bus_write_8(COM_MCR, 0x0b);        /* Enable OUT2 interrupt */
+    bus_write_8(COM_IER, ns16550_ier); /* Enable interrupt */
     bus_read_8(COM_IIR);
     splx(s);
 }
@@ -188,6 +242,7 @@ static void ns16550_stop(struct serial_port* sp)
 {
 
     /* Disable all interrupts */
+    ns16550_ier = 0;
     bus_write_8(COM_IER, 0x00);
 }
 
@@ -98,6 +98,7 @@ static char pl011_rcv_char(struct serial_port*);
 static void pl011_set_poll(struct serial_port*, int);
 static void pl011_start(struct serial_port*);
 static void pl011_stop(struct serial_port*);
+static void pl011_xmt_start(struct serial_port*);
 
 struct driver pl011_driver = {
     /* name */ "pl011",
@@ -115,9 +116,13 @@ static struct serial_ops pl011_ops = {
     /* set_poll */ pl011_set_poll,
     /* start */ pl011_start,
     /* stop */ pl011_stop,
+    /* xmt_start */ pl011_xmt_start,
 };
 
 static struct serial_port pl011_port;
+static volatile uint32_t pl011_imsc;   /* current interrupt mask */
+static volatile int pl011_ist_pending; /* IST will restore IMSC */
+static int pl011_polling;              /* true in polling mode */
 
 static void pl011_xmt_char(struct serial_port* sp, char c)
 {
@@ -140,13 +145,50 @@ static char pl011_rcv_char(struct serial_port* sp)
 static void pl011_set_poll(struct serial_port* sp, int on)
 {
 
+    pl011_polling = on;
     if (on) {
         /*
          * Disable interrupt for polling mode.
          */
         bus_write_32(UART_IMSC, 0);
     } else
-        bus_write_32(UART_IMSC, (IMSC_RX | IMSC_RT));
+        bus_write_32(UART_IMSC, pl011_imsc);
+}
+
+/*
+ * Move data from the output queue to the transmit FIFO
+ * until either of them runs out.
+ * Must be called with the scheduler locked.
+ */
+static void pl011_xmt_fill(struct serial_port* sp)
+{
+    struct tty_queue* tq = &sp->tty->t_outq;
+    char c;
+
+    while (!(bus_read_32(UART_FR) & FR_TXFF) && tty_getq(tq, &c, 1) > 0)
+        bus_write_32(UART_DR, (uint32_t)c);
+
+    /* Keep the TX interrupt only while data remains */
+    if (tq->tq_count > 0)
+        pl011_imsc |= IMSC_TX;
+    else
+        pl011_imsc &= ~IMSC_TX;
+}
+
+/*
+ * Start interrupt driven output.
+ * The TX interrupt is raised when the FIFO drains below
+ * its trigger level, so the FIFO must be primed here.
+ */
+static void pl011_xmt_start(struct serial_port* sp)
+{
+
+    sched_lock();
+    pl011_xmt_fill(sp);
+    if (!pl011_ist_pending && !pl011_polling)
+        bus_write_32(UART_IMSC, pl011_imsc);
+    serial_xmt_done(sp);
+    sched_unlock();
 }
 
 static void pl011_ist(void* arg)
@@ -173,14 +215,18 @@ static void pl011_ist(void* arg)
         /*
          * Transmit interrupt
          */
-        serial_xmt_done(sp);
-
-        /* Clear interrupt status */
         bus_write_32(UART_ICR, ICR_TX);
+
+        sched_lock();
+        pl011_xmt_fill(sp);
+        serial_xmt_done(sp);
+        sched_unlock();
     }
 
     /* Re-enable interrupts */
-    bus_write_32(UART_IMSC, (IMSC_RX | IMSC_RT));
+    pl011_ist_pending = 0;
+    if (!pl011_polling)
+        bus_write_32(UART_IMSC, pl011_imsc);
 }
 
 __isr
@@ -195,6 +241,7 @@ static int pl011_isr(void* arg)
 
     /* Disable interrupts; IST will re-enable them */
     bus_write_32(UART_IMSC, 0);
+    pl011_ist_pending = 1;
 
 #ifdef CONFIG_ARMV8M
     (void)bus_read_32(UART_IMSC); /* Force write to complete */
@@ -233,13 +280,15 @@ static void pl011_start(struct serial_port* sp)
     /* Install interrupt handler */
     sp->irq = irq_attach(UART_IRQ, IPL_COMM, 0, pl011_isr, pl011_ist, sp);
 
-    /* Enable TX/RX interrupt */
-    bus_write_32(UART_IMSC, (IMSC_RX | IMSC_RT));
+    /* Enable RX interrupt; TX is enabled while output is pending */
+    pl011_imsc = IMSC_RX | IMSC_RT;
+    bus_write_32(UART_IMSC, pl011_imsc);
 }
 
 static void pl011_stop(struct serial_port* sp)
 {
 
+    pl011_imsc = 0;
     bus_write_32(UART_IMSC, 0); /* Disable all interrupts */
     bus_write_32(UART_CR, 0);   /* Disable everything */
 }
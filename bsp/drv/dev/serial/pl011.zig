@@ -77,6 +77,38 @@ const IMSC_RX = 0x10; // Receive interrupt mask
 const IMSC_TX = 0x20; // Transmit interrupt mask
 const IMSC_RT = 0x40; // Timeout interrupt mask
 
+// Interrupt state shared by the ISR, IST and xmt_start
+var pl011_imsc: u32 = 0; // current interrupt mask
+var pl011_ist_pending: bool = false; // IST will restore IMSC
+var pl011_polling: bool = false; // true in polling mode
+
+fn writeImsc(v: u32) void {
+    @as(*volatile u32, @ptrCast(&pl011_imsc)).* = v;
+}
+
+fn readImsc() u32 {
+    return @as(*volatile u32, @ptrCast(&pl011_imsc)).*;
+}
+
+/// Move data from the output queue to the transmit FIFO until either
+/// of them runs out. Must be called with the scheduler locked.
+fn xmtFill(sp: *c.struct_serial_port) void {
+    const tq = &sp.tty.*.t_outq;
+    var ch: u8 = 0;
+
+    while (dki.bus_read_32(UART_FR) & FR_TXFF == 0) {
+        if (c.tty_getq(tq, @ptrCast(&ch), 1) <= 0) break;
+        dki.bus_write_32(UART_DR, @as(u32, ch));
+    }
+
+    // Keep the TX interrupt only while data remains
+    if (tq.tq_count > 0) {
+        writeImsc(readImsc() | IMSC_TX);
+    } else {
+        writeImsc(readImsc() & ~@as(u32, IMSC_TX));
+    }
+}
+
 /// Static serial port implementation
 const SerialInterface = struct {
     pub fn xmt_char(_: ?*c.struct_serial_port, ch: u8) callconv(.c) void {
@@ -90,13 +122,26 @@ const SerialInterface = struct {
     }
 
     pub fn set_poll(_: ?*c.struct_serial_port, on: c_int) callconv(.c) void {
+        pl011_polling = on != 0;
         if (on != 0) {
             dki.bus_write_32(UART_IMSC, 0);
         } else {
-            dki.bus_write_32(UART_IMSC, (IMSC_RX | IMSC_RT));
+            dki.bus_write_32(UART_IMSC, readImsc());
         }
     }
 
+    /// Start interrupt driven output. The TX interrupt is raised when
+    /// the FIFO drains below its trigger level, so prime the FIFO here.
+    pub fn xmt_start(sp: ?*c.struct_serial_port) callconv(.c) void {
+        dki.sched_lock();
+        defer dki.sched_unlock();
+
+        xmtFill(sp.?);
+        if (!@as(*volatile bool, @ptrCast(&pl011_ist_pending)).* and !pl011_polling)
+            dki.bus_write_32(UART_IMSC, readImsc());
+        c.serial_xmt_done(sp);
+    }
+
     pub fn start(sp: ?*c.struct_serial_port) callconv(.c) void {
         startZig(sp) catch |err| {
             dki.log("PL011: Start failed: {}\n", .{err});
@@ -120,10 +165,13 @@ const SerialInterface = struct {
         // Use try for idiomatic error handling
         sp.?.irq = try dki.irq_attach(UART_IRQ, c.IPL_COMM, 0, pl011_isr, pl011_ist, sp);
 
-        dki.bus_write_32(UART_IMSC, (IMSC_RX | IMSC_RT));
+        // Enable RX interrupt; TX is enabled while output is pending
+        writeImsc(IMSC_RX | IMSC_RT);
+        dki.bus_write_32(UART_IMSC, readImsc());
     }
 
     pub fn stop(_: ?*c.struct_serial_port) callconv(.c) void {
+        writeImsc(0);
         dki.bus_write_32(UART_IMSC, 0);
         dki.bus_write_32(UART_CR, 0);
     }
@@ -134,6 +182,7 @@ export fn pl011_isr(_: ?*anyopaque) callconv(.c) c_int {
     if (mis == 0) return c.INT_DONE;
 
     dki.bus_write_32(UART_IMSC, 0);
+    @as(*volatile bool, @ptrCast(&pl011_ist_pending)).* = true;
 
     if (@hasDecl(c, "CONFIG_ARMV8M")) {
         _ = dki.bus_read_32(UART_IMSC);
@@ -148,7 +197,10 @@ export fn pl011_ist(arg: ?*anyopaque) callconv(.c) void {
     const sp: *c.struct_serial_port = @ptrCast(@alignCast(arg.?));
     
     // Use defer to guarantee interrupts are re-enabled
-    defer dki.bus_write_32(UART_IMSC, (IMSC_RX | IMSC_RT));
+    defer {
+        @as(*volatile bool, @ptrCast(&pl011_ist_pending)).* = false;
+        if (!pl011_polling) dki.bus_write_32(UART_IMSC, readImsc());
+    }
     
     const ris = dki.bus_read_32(UART_RIS);
 
@@ -162,8 +214,12 @@ export fn pl011_ist(arg: ?*anyopaque) callconv(.c) void {
     }
     
     if (ris & MIS_TX != 0) {
-        c.serial_xmt_done(sp);
         dki.bus_write_32(UART_ICR, ICR_TX);
+
+        dki.sched_lock();
+        defer dki.sched_unlock();
+        xmtFill(sp);
+        c.serial_xmt_done(sp);
     }
 }
 
@@ -113,6 +113,11 @@ static int serial_ioctl(device_t dev, u_long cmd, void* arg)
 
 /*
  * Start TTY output operation.
+ *
+ * If the driver can transmit from its interrupt handler, just
+ * kick it and let it drain the output queue.  The driver calls
+ * serial_xmt_done() whenever it has taken data from the queue.
+ * Otherwise, the queue is drained by polling.
  */
 static void serial_start(struct tty* tp)
 {
@@ -120,6 +125,11 @@ static void serial_start(struct tty* tp)
     struct serial_port* port = sc->port;
     int c;
 
+    if (sc->ops->xmt_start != NULL) {
+        tp->t_state |= TS_BUSY;
+        sc->ops->xmt_start(port);
+        return;
+    }
     while ((c = tty_getc(&tp->t_outq)) >= 0)
         sc->ops->xmt_char(port, c);
 }
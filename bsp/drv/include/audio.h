@@ -52,6 +52,7 @@ struct audio_hw_if {
     int  (*start_input)(void *priv, void *buf, size_t size, void (*intr)(void *));
     int  (*stop_input)(void *priv);
     int  (*set_volume)(void *priv, uint8_t volume);
+    u_int maxblks;      /* blocks the hardware can queue, 0 for no limit */
 };
 
 /*
@@ -134,6 +134,7 @@ void page_reserve(paddr_t, psize_t);
 
 irq_t irq_attach(int, int, int, int (*)(void*), void (*)(void*), void*);
 void irq_detach(irq_t);
+int irq_setaffinity(irq_t, int);
 
 int spl0(void);
 int splhigh(void);
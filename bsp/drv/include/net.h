@@ -29,6 +29,7 @@
 
 #include <sys/types.h>
 #include <ddi.h>
+#include <sys/netio.h>
 
 /* Ethernet parameters */
 #define NET_MAX_FRAME 1518
@@ -44,6 +45,8 @@ struct net_hw_if {
     int  (*get_addr)(void *priv, uint8_t *addr);
     int  (*set_addr)(void *priv, uint8_t *addr);
     int  (*set_promisc)(void *priv, int on);
+    void (*rx_resume)(void *priv);  /* receive queue has room again */
+    void (*get_stats)(void *priv, struct net_stats *stats);
 };
 
 /*
@@ -51,7 +54,7 @@ struct net_hw_if {
  */
 __BEGIN_DECLS
 device_t net_attach(const char *name, const struct net_hw_if *hw_if, void *hw_priv);
-void     net_rx_complete(device_t dev, void *buf, size_t len);
+int      net_rx_complete(device_t dev, void *buf, size_t len);
 __END_DECLS
 
 #endif /* !_NET_H_ */
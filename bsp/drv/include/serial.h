@@ -46,6 +46,7 @@ struct serial_ops
     void (*set_poll)(struct serial_port* port, int on);
     void (*start)(struct serial_port* port);
     void (*stop)(struct serial_port* port);
+    void (*xmt_start)(struct serial_port* port); /* optional: start interrupt driven output */
 };
 
 __BEGIN_DECLS
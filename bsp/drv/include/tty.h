@@ -43,11 +43,21 @@
 #include <sys/syslimits.h>
 
 #define TTYQ_SIZE MAX_INPUT
-#define TTYQ_HIWAT (TTYQ_SIZE - 10)
+
+/*
+ * Output queue size.  This must be a power of 2 and at least 128.
+ */
+#ifdef CONFIG_TTY_OUTQ
+#define TTY_OUTQ_SIZE CONFIG_TTY_OUTQ
+#else
+#define TTY_OUTQ_SIZE 1024
+#endif
+#define TTY_OUTQ_HIWAT (TTY_OUTQ_SIZE - 64)
 
 struct tty_queue
 {
-    char tq_buf[TTYQ_SIZE];
+    char* tq_buf;  /* ring buffer */
+    int tq_size;   /* buffer size (power of 2) */
     int tq_head;
     int tq_tail;
     int tq_count;
@@ -74,6 +84,9 @@ struct tty
     int t_signo;                  /* pending signal# */
     struct dpc t_dpc;             /* dpc for tty */
     unsigned long t_poll_sem;     /* semaphore to signal on input */
+    char t_rawbuf[TTYQ_SIZE];     /* buffer for t_rawq */
+    char t_canbuf[TTYQ_SIZE];     /* buffer for t_canq */
+    char t_outbuf[TTY_OUTQ_SIZE]; /* buffer for t_outq */
 };
 
 #define t_iflag t_termios.c_iflag
@@ -97,6 +110,7 @@ int tty_write(struct tty*, char*, size_t*);
 int tty_ioctl(struct tty*, u_long, void*);
 void tty_input(int, struct tty*);
 int tty_getc(struct tty_queue*);
+int tty_getq(struct tty_queue*, char*, int);
 void tty_done(struct tty*);
 void tty_attach(struct tty*);
 __END_DECLS
@@ -46,6 +46,7 @@
 #endif
 
 static uint32_t timer_count;
+static uint32_t timer_freq;
 
 /*
  * Clock interrupt service routine.
@@ -71,6 +72,7 @@ void clock_init(void)
     uint32_t freq;
 
     freq = get_cntfrq();
+    timer_freq = freq;
     timer_count = freq / CONFIG_HZ;
 
     /* Install ISR */
@@ -98,3 +100,20 @@ void clock_ap_init(void)
     set_cntp_ctl_reg(1);
 }
 #endif
+
+/*
+ * Return the low word of the physical count of the generic timer.
+ */
+uint32_t clock_cycles(void)
+{
+    uint32_t lo, hi;
+
+    __asm__ volatile("mrrc p15, 0, %0, %1, c14" : "=r"(lo), "=r"(hi));
+    return lo;
+}
+
+uint32_t clock_cyclehz(void)
+{
+
+    return timer_freq;
+}
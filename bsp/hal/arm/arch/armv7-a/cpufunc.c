@@ -85,6 +85,56 @@ __attribute__((naked)) void switch_ttb(paddr_t ttb)
         "bx  lr");
 }
 
+/*
+ * Load TTBR0 together with a new ASID.
+ * The reserved ASID 0 is set while TTBR0 changes, so that no walk
+ * of the new table is tagged with the old ASID.
+ */
+__attribute__((naked)) void switch_ttb_asid(paddr_t ttb, uint32_t asid)
+{
+    __asm__ volatile(
+        "mov r2, #0\n"
+        "mcr p15, 0, r2, c13, c0, 1\n" /* CONTEXTIDR = 0 */
+        "isb\n"
+        "mcr p15, 0, r0, c2, c0, 0\n"  /* TTBR0 */
+        "isb\n"
+        "mcr p15, 0, r1, c13, c0, 1\n" /* CONTEXTIDR = asid */
+        "isb\n"
+        "bx  lr");
+}
+
+/*
+ * Invalidate the TLB entries of one page for all ASIDs.
+ */
+__attribute__((naked)) void flush_tlb_page(vaddr_t va)
+{
+    __asm__ volatile(
+#ifdef CONFIG_SMP
+        "dsb ishst\n"
+        "mcr p15, 0, r0, c8, c3, 3\n" /* TLBIMVAAIS */
+        "dsb ish\n"
+#else
+        "dsb\n"
+        "mcr p15, 0, r0, c8, c7, 3\n" /* TLBIMVAA */
+        "dsb\n"
+#endif
+        "isb\n"
+        "bx  lr");
+}
+
+/*
+ * Invalidate the whole TLB of this CPU only.
+ */
+__attribute__((naked)) void flush_tlb_local(void)
+{
+    __asm__ volatile(
+        "mov r0, #0\n"
+        "mcr p15, 0, r0, c8, c7, 0\n" /* invalidate I+D TLBs */
+        "dsb\n"
+        "isb\n"
+        "bx  lr");
+}
+
 __attribute__((naked)) void flush_tlb(void)
 {
     __asm__ volatile(
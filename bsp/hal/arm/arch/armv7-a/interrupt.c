@@ -58,6 +58,7 @@
 #define GICC_EOIR (*(volatile uint32_t*)(CONFIG_GIC_CPU_BASE + 0x010))
 
 static int ipl_table[CONFIG_NIRQS];
+static uint8_t target_table[CONFIG_NIRQS]; /* target CPU of each SPI */
 static int interrupt_initialized = 0;
 
 /*
@@ -99,7 +100,7 @@ void interrupt_unmask(int vector, int level)
     } else {
         uint32_t target = GICD_ITARGETSR(vector / 4);
         target &= ~(0xff << shift);
-        target |= (0x01 << shift);
+        target |= ((1U << target_table[vector]) << shift);
         GICD_ITARGETSR(vector / 4) = target;
     }
 
@@ -172,6 +173,26 @@ void interrupt_handler(void)
     update_mask();
 }
 
+/*
+ * Route a shared peripheral interrupt to the specified CPU.
+ * SGIs and PPIs are banked per CPU and can not be moved.
+ */
+int interrupt_setaffinity(int vector, int cpu)
+{
+    uint32_t target;
+    int shift = (vector % 4) * 8;
+
+    if (vector < 32 || vector >= CONFIG_NIRQS || cpu < 0 || cpu >= 8)
+        return -1;
+
+    target_table[vector] = (uint8_t)cpu;
+    target = GICD_ITARGETSR(vector / 4);
+    target &= ~(0xff << shift);
+    target |= ((1U << cpu) << shift);
+    GICD_ITARGETSR(vector / 4) = target;
+    return 0;
+}
+
 /*
  * Inter-Processor Interrupt
  */
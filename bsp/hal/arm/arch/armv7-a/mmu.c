@@ -45,16 +45,93 @@
 #include <mmu.h>
 #include <cpu.h>
 #include <cpufunc.h>
+#include <kmem.h>
 
 #define L1TBL_MASK (L1TBL_SIZE - 1)
 #define PGD_ALIGN(n) ((((paddr_t)(n)) + L1TBL_MASK) & ~L1TBL_MASK)
 
+#ifdef CONFIG_SMP
+#define NCPUS CONFIG_SMP_NCPUS
+#else
+#define NCPUS 1
+#endif
+
+/*
+ * Largest range, in pages, which is invalidated page by page.
+ * Bigger updates flush the whole TLB instead.
+ */
+#define TLB_RANGE_MAX 32
+
+/*
+ * ASID width of the short-descriptor format (CONTEXTIDR[7:0]).
+ */
+#define ASID_BITS 8
+#define ASID_MASK ((1U << ASID_BITS) - 1)
+
+/*
+ * Address space context.
+ *
+ * User pages are mapped non-global, and tagged with the ASID of
+ * their map, so the TLB survives a context switch. Contexts are
+ * found from the page directory through a small hash table.
+ */
+#define CTX_HASH 64
+#define ctx_hashfn(pgd) ((int)((kvtop(pgd) >> 14) & (CTX_HASH - 1)))
+
+struct mmu_ctx
+{
+    struct mmu_ctx* next; /* hash chain */
+    pgd_t pgd;            /* page directory */
+    uint32_t asid;        /* generation | ASID */
+};
+
 /*
  * Boot page directory.
  * This works as a template for all page directory in the system.
  */
 static pgd_t boot_pgd = (pgd_t)BOOT_PGD;
 
+static struct mmu_ctx* ctx_table[CTX_HASH];
+
+/*
+ * ASID allocator.
+ *
+ * ASIDs are handed out sequentially, with the generation kept in
+ * the bits above the ASID. When the ASID space is used up, a new
+ * generation is started and every CPU flushes its local TLB before
+ * it runs a map with a new ASID. ASID 0 is reserved for the boot
+ * map and for the TTBR0 switch sequence.
+ *
+ * The allocator is serialized by the scheduler lock. Invalidation
+ * by address is broadcast to the inner shareable domain, so no
+ * shootdown IPI is needed.
+ */
+static uint32_t asid_generation = 1U << ASID_BITS;
+static uint32_t asid_next = 1;
+static volatile uint32_t tlb_stale; /* CPUs which must flush on switch */
+
+static struct mmu_ctx* ctx_lookup(pgd_t pgd)
+{
+    struct mmu_ctx* ctx;
+
+    for (ctx = ctx_table[ctx_hashfn(pgd)]; ctx != NULL; ctx = ctx->next) {
+        if (ctx->pgd == pgd)
+            return ctx;
+    }
+    return NULL;
+}
+
+static uint32_t asid_alloc(void)
+{
+    if (asid_next > ASID_MASK) {
+        /* Roll over to a new generation */
+        asid_generation += ASID_MASK + 1;
+        asid_next = 1;
+        tlb_stale = (1U << NCPUS) - 1;
+    }
+    return asid_generation | asid_next++;
+}
+
 /*
  * Allocate pgd
  *
@@ -83,6 +160,59 @@ static paddr_t alloc_pgd(void)
     return pgd;
 }
 
+/*
+ * Convert small page attributes to section attributes, and back.
+ * B and C stay in place, XN moves from bit 0 to bit 4, and
+ * AP/TEX/S/nG move from [11:4] to [17:10].
+ */
+static uint32_t pte_to_sect(uint32_t flag)
+{
+
+    return PDE_SECTION | (flag & 0xc) | ((flag & PTE_XN) << 4) | ((flag & 0xff0) << 6);
+}
+
+static uint32_t sect_to_pte(uint32_t desc)
+{
+
+    return PTE_PRESENT | (desc & 0xc) | ((desc >> 4) & PTE_XN) | ((desc >> 6) & 0xff0);
+}
+
+/*
+ * Returns true if the page table for the address belongs to the
+ * map, and can be released when it is replaced by a section.
+ * The kernel page tables are shared by all maps.
+ */
+static int table_owned(pgd_t pgd, vaddr_t va)
+{
+
+    return pgd != boot_pgd && va < KERNBASE;
+}
+
+/*
+ * Split a section into a page table of small pages with the same
+ * attributes, so that a part of it can be remapped.
+ */
+static int spage_split(pgd_t pgd, vaddr_t va)
+{
+    uint32_t desc, flag;
+    paddr_t pg, pa;
+    pte_t pte;
+    int i;
+
+    if ((pg = page_alloc(L2TBL_SIZE)) == 0)
+        return ENOMEM;
+    pte = (pte_t)ptokv(pg);
+
+    desc = pgd[PAGE_DIR(va)];
+    pa = desc & PDE_SECT_ADDRESS;
+    flag = sect_to_pte(desc);
+    for (i = 0; i < L2TBL_SIZE / 4; i++)
+        pte[i] = (uint32_t)(pa + (paddr_t)i * PAGE_SIZE) | flag;
+
+    pgd[PAGE_DIR(va)] = (uint32_t)pg | PDE_PRESENT;
+    return 0;
+}
+
 /*
  * Map physical memory range into virtual address
  *
@@ -107,16 +237,25 @@ static paddr_t alloc_pgd(void)
  * the page tables are not released even if there is no valid
  * page entry in it. All page tables are released when mmu_delmap()
  * is called when task is terminated.
+ *
+ * A section is used when the range covers a whole 1M directory
+ * entry and both addresses are aligned to it. When a part of a
+ * section is changed later, it is split into small pages.
  */
 int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
 {
     uint32_t pte_flag = 0;
     pte_t pte;
     paddr_t pg; /* page */
+    vaddr_t start;
+    size_t len;
+    uint32_t pde;
 
     pa = round_page(pa);
     va = round_page(va);
     size = trunc_page(size);
+    start = va;
+    len = size;
 
     /*
      * Set page flag
@@ -126,10 +265,10 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
         pte_flag = 0;
         break;
     case PG_READ:
-        pte_flag = (uint32_t)(PTE_PRESENT | PTE_CACHE | PTE_USER_RO);
+        pte_flag = (uint32_t)(PTE_PRESENT | PTE_CACHE | PTE_USER_RO | PTE_NG);
         break;
     case PG_WRITE:
-        pte_flag = (uint32_t)(PTE_PRESENT | PTE_CACHE | PTE_USER_RW | PTE_XN);
+        pte_flag = (uint32_t)(PTE_PRESENT | PTE_CACHE | PTE_USER_RW | PTE_XN | PTE_NG);
         break;
     case PG_SYSTEM:
         pte_flag = (uint32_t)(PTE_PRESENT | PTE_CACHE | PTE_SYSTEM);
@@ -148,10 +287,34 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
     /*
      * Map all pages
      */
-    flush_tlb();
     // DPRINTF(("mmu_map: pa=%lx va=%lx size=%lx type=%d pte_flag=%lx\n", pa, va, size, type, (long)pte_flag));
 
     while (size > 0) {
+        pde = pgd[PAGE_DIR(va)];
+        if (size >= SPAGE_SIZE && (va & SPAGE_MASK) == 0 &&
+            (type == PG_UNMAP || (pa & SPAGE_MASK) == 0) &&
+            (!(pde & PDE_TYPE_MASK) || spage_present(pgd, va) || table_owned(pgd, va))) {
+            /*
+             * Map (or unmap) a whole section.
+             */
+            if (type == PG_UNMAP)
+                pgd[PAGE_DIR(va)] = 0;
+            else
+                pgd[PAGE_DIR(va)] = (uint32_t)pa | pte_to_sect(pte_flag);
+            if ((pde & PDE_TYPE_MASK) == PDE_PRESENT)
+                page_free((paddr_t)(pde & PDE_ADDRESS), L2TBL_SIZE);
+
+            pa += SPAGE_SIZE;
+            va += SPAGE_SIZE;
+            size -= SPAGE_SIZE;
+            continue;
+        }
+        if (spage_present(pgd, va)) {
+            if (spage_split(pgd, va)) {
+                DPRINTF(("Error: MMU mapping failed\n"));
+                return ENOMEM;
+            }
+        }
         if (pte_present(pgd, va)) {
             /* Page table already exists for the address */
             pte = vtopte(pgd, va);
@@ -173,7 +336,17 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
         va += PAGE_SIZE;
         size -= PAGE_SIZE;
     }
-    flush_tlb();
+
+    /*
+     * Invalidate the stale translations. Small ranges are
+     * invalidated page by page for all ASIDs.
+     */
+    if (len > TLB_RANGE_MAX * PAGE_SIZE) {
+        flush_tlb();
+    } else {
+        for (; len > 0; start += PAGE_SIZE, len -= PAGE_SIZE)
+            flush_tlb_page(start);
+    }
     return 0;
 }
 
@@ -187,12 +360,17 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
  */
 pgd_t mmu_newmap(void)
 {
+    struct mmu_ctx* ctx;
     paddr_t pg;
     pgd_t pgd;
     int i;
 
-    if ((pg = alloc_pgd()) == 0)
+    if ((ctx = kmem_alloc(sizeof(*ctx))) == NULL)
+        return NO_PGD;
+    if ((pg = alloc_pgd()) == 0) {
+        kmem_free(ctx);
         return NO_PGD;
+    }
     pgd = (pgd_t)ptokv(pg);
     memset(pgd, 0, L1TBL_SIZE);
 
@@ -200,6 +378,13 @@ pgd_t mmu_newmap(void)
     i = PAGE_DIR(KERNBASE);
     memcpy(&pgd[i], &boot_pgd[i], (size_t)(L1TBL_SIZE - i * 4));
 
+    /* Register address space context */
+    ctx->pgd = pgd;
+    ctx->asid = 0;
+    i = ctx_hashfn(pgd);
+    ctx->next = ctx_table[i];
+    ctx_table[i] = ctx;
+
     /* Map vector page (address 0) */
     mmu_map(pgd, CONFIG_SYSPAGE_PHY_BASE, CONFIG_ARM_VECTORS, PAGE_SIZE, PG_SYSTEM);
     return pgd;
@@ -210,15 +395,25 @@ pgd_t mmu_newmap(void)
  */
 void mmu_terminate(pgd_t pgd)
 {
+    struct mmu_ctx **pp, *ctx;
     int i;
     pte_t pte;
 
     flush_tlb();
 
+    /* Drop the context */
+    for (pp = &ctx_table[ctx_hashfn(pgd)]; (ctx = *pp) != NULL; pp = &ctx->next) {
+        if (ctx->pgd == pgd) {
+            *pp = ctx->next;
+            kmem_free(ctx);
+            break;
+        }
+    }
+
     /* Release all user page table */
     for (i = 0; i < PAGE_DIR(KERNBASE); i++) {
         pte = (pte_t)pgd[i];
-        if (pte != 0)
+        if (((uint32_t)pte & PDE_TYPE_MASK) == PDE_PRESENT)
             page_free(((paddr_t)pte & PTE_ADDRESS), L2TBL_SIZE);
     }
     /* Release page directory */
@@ -228,16 +423,30 @@ void mmu_terminate(pgd_t pgd)
 /*
  * Switch to new page directory
  *
- * This is called when context is switched.
- * Whole TLB/cache must be flushed after loading
- * TLTB register
+ * This is called when context is switched. The TLB is kept
+ * as long as the map owns an ASID of the current generation.
  */
 void mmu_switch(pgd_t pgd)
 {
+    struct mmu_ctx* ctx;
     paddr_t phys = kvtop(pgd);
-
-    if (phys != get_ttb())
-        switch_ttb(phys);
+    uint32_t bit = 1U << hal_cpu_id();
+    uint32_t asid = 0;
+    int renew = 0;
+
+    if ((ctx = ctx_lookup(pgd)) != NULL) {
+        if ((ctx->asid & ~ASID_MASK) != asid_generation) {
+            ctx->asid = asid_alloc();
+            renew = 1;
+        }
+        asid = ctx->asid & ASID_MASK;
+    }
+    if (renew || phys != get_ttb())
+        switch_ttb_asid(phys, asid);
+    if (tlb_stale & bit) {
+        __sync_fetch_and_and(&tlb_stale, ~bit);
+        flush_tlb_local();
+    }
 }
 
 /*
@@ -256,6 +465,8 @@ paddr_t mmu_extract(pgd_t pgd, vaddr_t virt, size_t size)
 
     /* Check all pages exist */
     for (pg = start; pg <= end; pg += PAGE_SIZE) {
+        if (spage_present(pgd, pg))
+            continue;
         if (!pte_present(pgd, pg))
             return 0;
         pte = vtopte(pgd, pg);
@@ -264,6 +475,8 @@ paddr_t mmu_extract(pgd_t pgd, vaddr_t virt, size_t size)
     }
 
     /* Get physical address */
+    if (spage_present(pgd, start))
+        return (paddr_t)spagetopg(pgd, start) + (paddr_t)(virt & SPAGE_MASK);
     pte = vtopte(pgd, start);
     pa = (paddr_t)ptetopg(pte, start);
     return pa + (paddr_t)(virt - start);
@@ -50,6 +50,8 @@
 
 #define SCB_SHPR3    (*(volatile uint32_t*)0xE000ED20)
 
+#define SYST_FREQ    50000000
+
 /*
  * Initialize clock H/W chip.
  */
@@ -83,3 +85,26 @@ void clock_ap_init(void)
     SYST_CSR = SYST_CSR_CLKSOURCE | SYST_CSR_TICKINT | SYST_CSR_ENABLE;
 }
 #endif
+
+/*
+ * Return a cycle count composed of the tick count and SysTick.
+ */
+uint32_t clock_cycles(void)
+{
+    uint32_t reload, val;
+    u_long ticks;
+    int s;
+
+    s = splhigh();
+    ticks = timer_ticks();
+    reload = SYST_RVR + 1;
+    val = SYST_CVR;
+    splx(s);
+    return (uint32_t)ticks * reload + (reload - 1 - val);
+}
+
+uint32_t clock_cyclehz(void)
+{
+
+    return SYST_FREQ;
+}
@@ -154,6 +154,17 @@ void interrupt_handler(void)
     sched_unlock();
 }
 
+/*
+ * Return the program counter interrupted by the current interrupt.
+ * The exception frame may be on the process stack, so it is not
+ * known here.
+ */
+int interrupt_pc(vaddr_t* pc)
+{
+
+    return -1;
+}
+
 /*
  * Initialize NVIC.
  */
@@ -183,3 +194,13 @@ void interrupt_cpu_init(void)
     update_mask();
 }
 
+/*
+ * Each core has a private NVIC, so an interrupt can not be
+ * routed to another core.
+ */
+int interrupt_setaffinity(int vector, int cpu)
+{
+
+    return -1;
+}
+
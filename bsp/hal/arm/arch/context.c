@@ -50,6 +50,18 @@
 #include <context.h>
 #include <locore.h>
 #include <trap.h>
+#include <cpufunc.h>
+
+#ifdef CONFIG_SMP
+#define NCPUS CONFIG_SMP_NCPUS
+#define CPUID hal_cpu_id()
+#else
+#define NCPUS 1
+#define CPUID 0
+#endif
+
+/* Registers saved by the current interrupt on each CPU */
+static struct cpu_regs* irq_regs[NCPUS];
 
 /*
  * Set data to the specific register stored in context.
@@ -195,3 +207,31 @@ void context_dump(context_t ctx)
     trap_dump(ctx->uregs);
 #endif
 }
+
+/*
+ * Call the platform interrupt handler.
+ * The interrupt frame is kept for interrupt_pc() while it runs.
+ */
+void interrupt_call(struct cpu_regs* regs)
+{
+    struct cpu_regs* prev_regs;
+    int cpu = CPUID;
+
+    prev_regs = irq_regs[cpu];
+    irq_regs[cpu] = regs;
+    interrupt_handler();
+    irq_regs[cpu] = prev_regs;
+}
+
+/*
+ * Return the program counter interrupted by the current interrupt.
+ */
+int interrupt_pc(vaddr_t* pc)
+{
+    struct cpu_regs* regs = irq_regs[CPUID];
+
+    if (regs == NULL)
+        return -1;
+    *pc = (vaddr_t)regs->pc;
+    return ((regs->cpsr & PSR_MODE) == PSR_APP_MODE) ? 1 : 0;
+}
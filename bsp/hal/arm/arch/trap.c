@@ -41,6 +41,7 @@
 #include <cpufunc.h>
 #include <context.h>
 #include <locore.h>
+#include <vm.h>
 
 #ifdef DEBUG
 /*
@@ -68,6 +69,19 @@ static const int exception_map[] = {
 void trap_handler(struct cpu_regs* regs)
 {
     u_long trap_no = regs->r0;
+#ifdef CONFIG_MMU
+    int fs;
+
+    /*
+     * Back the page of a lazy segment, and retry the access.
+     * This handles a fault in copyin() or copyout(), too.
+     */
+    if (trap_no == TRAP_DATA_ABORT) {
+        fs = FSR_STATUS(get_faultstatus());
+        if ((fs == FSR_TRANS_SECT || fs == FSR_TRANS_PAGE) && vm_fault((vaddr_t)get_faultaddress()) == 0)
+            return;
+    }
+#endif
 
     if ((regs->cpsr & PSR_MODE) == PSR_SVC_MODE && trap_no == TRAP_DATA_ABORT &&
         (regs->pc - 4 == (uint32_t)known_fault1 || regs->pc - 4 == (uint32_t)known_fault2 ||
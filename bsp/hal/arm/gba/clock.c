@@ -98,3 +98,25 @@ void clock_init(void)
     /* Enable timer */
     TMR0_CTRL |= TMR_EN;
 }
+
+/*
+ * Return a cycle count composed of the tick count and the timer.
+ */
+uint32_t clock_cycles(void)
+{
+    uint32_t val;
+    u_long ticks;
+    int s;
+
+    s = splhigh();
+    ticks = timer_ticks();
+    val = TMR0_COUNT;
+    splx(s);
+    return (uint32_t)ticks * (0xffff - TIMER_COUNT) + (val - TIMER_COUNT);
+}
+
+uint32_t clock_cyclehz(void)
+{
+
+    return CLOCK_RATE / 64;
+}
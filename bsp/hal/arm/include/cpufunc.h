@@ -44,6 +44,9 @@ void flush_tlb(void);
 void flush_cache(void);
 
 // for ARMV6 & ARMV7A
+void switch_ttb_asid(paddr_t, uint32_t);
+void flush_tlb_page(vaddr_t);
+void flush_tlb_local(void);
 void set_vbar(vaddr_t);
 void cpu_barrier(void);
 uint32_t get_cntfrq(void);
@@ -38,6 +38,8 @@ void syscall_ret(void);
 void kernel_thread_entry(void);
 void cpu_switch(struct kern_regs*, struct kern_regs*);
 void interrupt_entry(void);
+void interrupt_handler(void);
+void interrupt_call(struct cpu_regs*);
 void vector_copy(vaddr_t);
 void cpu_init(void);
 void known_fault1(void);
@@ -79,6 +79,7 @@ typedef uint32_t* pte_t; /* page table entry */
 #define PTE_USER_RO 0x00000070 /* PL1:RO, PL0:RO (AP=11, AF=1) */
 #define PTE_USER_RW 0x00000030 /* PL1:RW, PL0:RW (AP=01, AF=1) */
 #define PTE_SHAREABLE 0x00000400 /* Shareable */
+#define PTE_NG 0x00000800        /* Not global (ASID tagged) */
 
 #define PTE_ATTR_MASK 0x00000ff1
 #define PTE_ADDRESS 0xfffff000
@@ -108,4 +109,18 @@ typedef uint32_t* pte_t; /* page table entry */
 
 #define ptetopg(pte, virt) ((pte)[PAGE_TABLE(virt)] & PTE_ADDRESS)
 
+#ifdef CONFIG_ARMV7A
+/*
+ * Section (1M page)
+ */
+#define PDE_SECTION 0x00000002
+#define PDE_SECT_ADDRESS 0xfff00000
+#define SPAGE_SIZE 0x00100000
+#define SPAGE_MASK (SPAGE_SIZE - 1)
+
+#define spage_present(pgd, virt) (((pgd)[PAGE_DIR(virt)] & PDE_TYPE_MASK) == PDE_SECTION)
+
+#define spagetopg(pgd, virt) ((pgd)[PAGE_DIR(virt)] & PDE_SECT_ADDRESS)
+#endif
+
 #endif /* !_ARM_MMU_H */
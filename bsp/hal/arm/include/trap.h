@@ -37,6 +37,13 @@
 #define TRAP_PREFETCH_ABORT 1
 #define TRAP_DATA_ABORT 2
 
+/*
+ * Fault status
+ */
+#define FSR_STATUS(fsr) (((fsr) & 0xf) | (((fsr) >> 6) & 0x10))
+#define FSR_TRANS_SECT 0x05 /* translation fault (section) */
+#define FSR_TRANS_PAGE 0x07 /* translation fault (page) */
+
 #ifndef __ASSEMBLY__
 
 __BEGIN_DECLS
@@ -100,3 +100,25 @@ void clock_init(void)
 
     DPRINTF(("Clock rate: %d ticks/sec\n", CONFIG_HZ));
 }
+
+/*
+ * Return a cycle count composed of the tick count and the timer.
+ */
+uint32_t clock_cycles(void)
+{
+    uint32_t val;
+    u_long ticks;
+    int s;
+
+    s = splhigh();
+    ticks = timer_ticks();
+    val = TMR_VAL;
+    splx(s);
+    return (uint32_t)ticks * TIMER_COUNT + (TIMER_COUNT - val);
+}
+
+uint32_t clock_cyclehz(void)
+{
+
+    return CLOCK_RATE;
+}
@@ -111,6 +111,28 @@ void clock_init(void)
 
     DPRINTF(("Clock rate: %d ticks/sec\n", CONFIG_HZ));
 }
+
+/*
+ * Return a cycle count composed of the tick count and the timer.
+ */
+uint32_t clock_cycles(void)
+{
+    uint32_t val;
+    u_long ticks;
+    int s;
+
+    s = splhigh();
+    ticks = timer_ticks();
+    val = TMR_VAL;
+    splx(s);
+    return (uint32_t)ticks * TIMER_COUNT + (TIMER_COUNT - val);
+}
+
+uint32_t clock_cyclehz(void)
+{
+
+    return CLOCK_RATE;
+}
 #else
 
 #define TIMER_IDX 1
@@ -157,4 +179,19 @@ void clock_init(void)
     DPRINTF(("%x %x Clock rate: %d ticks/sec\n", STIMER_CLO, STIMER_CT(TIMER_IDX), CONFIG_HZ));
 }
 
+/*
+ * Return the lower word of the 1MHz system timer.
+ */
+uint32_t clock_cycles(void)
+{
+
+    return STIMER_CLO;
+}
+
+uint32_t clock_cyclehz(void)
+{
+
+    return CLOCK_RATE;
+}
+
 #endif
@@ -66,3 +66,21 @@ void clock_init(void)
     DPRINTF(("clock_init\n"));
     set_decr(DECR_COUNT);
 }
+
+/*
+ * Return the lower word of the time base.
+ * The time base runs at the decrementer rate.
+ */
+uint32_t clock_cycles(void)
+{
+    uint32_t tbl;
+
+    __asm__ volatile("mftb %0" : "=r"(tbl));
+    return tbl;
+}
+
+uint32_t clock_cyclehz(void)
+{
+
+    return DECR_COUNT * HZ;
+}
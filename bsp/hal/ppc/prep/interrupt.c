@@ -35,6 +35,7 @@
 #include <hal.h>
 #include <irq.h>
 #include <io.h>
+#include <cpu.h>
 #include <cpufunc.h>
 #include <context.h>
 #include <trap.h>
@@ -67,6 +68,11 @@ static volatile int irq_level;
 static int ipl_table[NIRQS];    /* Vector -> level */
 static u_int mask_table[NIPLS]; /* Level -> mask */
 
+/*
+ * Registers saved by the current interrupt
+ */
+static struct cpu_regs* irq_regs;
+
 /*
  * Set mask for current ipl
  */
@@ -168,12 +174,17 @@ static int interrupt_lookup(void)
  */
 void interrupt_handler(struct cpu_regs* regs)
 {
+    struct cpu_regs* prev_regs;
     int vector;
     int old_ipl, new_ipl;
 
+    prev_regs = irq_regs;
+    irq_regs = regs;
+
     /* Handle decrementer interrupt */
     if (regs->trap_no == TRAP_DECREMENTER) {
         clock_isr(NULL);
+        irq_regs = prev_regs;
         return;
     }
 
@@ -191,12 +202,25 @@ void interrupt_handler(struct cpu_regs* regs)
     splon();
     irq_handler(vector);
     sploff();
+    irq_regs = prev_regs;
 
     /* Restore interrupt level */
     irq_level = old_ipl;
     update_mask();
 }
 
+/*
+ * Return the program counter interrupted by the current interrupt.
+ */
+int interrupt_pc(vaddr_t* pc)
+{
+
+    if (irq_regs == NULL)
+        return -1;
+    *pc = (vaddr_t)irq_regs->srr0;
+    return (irq_regs->srr1 & MSR_PR) ? 1 : 0;
+}
+
 /*
  * Initialize 8259 interrupt controllers.
  * All interrupts will be masked off in ICU.
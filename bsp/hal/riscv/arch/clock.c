@@ -91,3 +91,18 @@ void clock_init(void)
 
     DPRINTF(("Clock rate: %d ticks/sec\n", CONFIG_HZ));
 }
+
+/*
+ * Return the low word of the machine timer.
+ */
+uint32_t clock_cycles(void)
+{
+
+    return (uint32_t)get_time();
+}
+
+uint32_t clock_cyclehz(void)
+{
+
+    return clock_freq;
+}
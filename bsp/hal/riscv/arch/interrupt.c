@@ -11,11 +11,21 @@
 #include <context.h>
 #include <locore.h>
 #include <cpu.h>
+#include <mmu.h>
 
 #include <riscv_csr.h>
 
 #define PLIC_BASE CONFIG_PLIC_BASE
 
+#ifdef CONFIG_SMP
+#define NCPUS CONFIG_SMP_NCPUS
+#else
+#define NCPUS 1
+#endif
+
+/* Registers saved by the current interrupt on each CPU */
+static struct cpu_regs* irq_regs[NCPUS];
+
 /* 
  * PLIC Registers for QEMU Virt (RV32)
  * On QEMU Virt, Hart H has:
@@ -41,11 +51,24 @@ static inline uint32_t plic_context(uint32_t hartid)
 #define PLIC_THRESHOLD_REG(ctx) (*(volatile uint32_t*)(PLIC_BASE + 0x200000 + (ctx) * 0x1000))
 #define PLIC_CLAIM_REG(ctx)     (*(volatile uint32_t*)(PLIC_BASE + 0x200004 + (ctx) * 0x1000))
 
+/*
+ * Hart that receives each source, plus one.  Zero means the
+ * source goes to the hart that unmasks it.
+ */
+static uint8_t target_table[1024];
+
+static uint32_t plic_target(int vector)
+{
+    if (target_table[vector] == 0)
+        target_table[vector] = (uint8_t)(hal_cpu_id() + 1);
+    return target_table[vector] - 1;
+}
+
 void interrupt_unmask(int vector, int level)
 {
     if (vector > 0 && vector < 1024) {
         PLIC_PRIORITY(vector) = 1;
-        uint32_t ctx = plic_context(hal_cpu_id());
+        uint32_t ctx = plic_context(plic_target(vector));
         *(volatile uint32_t*)(PLIC_ENABLE_BASE(ctx) + ((vector) / 32) * 4) |= (1 << (vector % 32));
     }
 }
@@ -53,11 +76,35 @@ void interrupt_unmask(int vector, int level)
 void interrupt_mask(int vector)
 {
     if (vector > 0 && vector < 1024) {
-        uint32_t ctx = plic_context(hal_cpu_id());
+        uint32_t ctx = plic_context(plic_target(vector));
         *(volatile uint32_t*)(PLIC_ENABLE_BASE(ctx) + ((vector) / 32) * 4) &= ~(1 << (vector % 32));
     }
 }
 
+#ifdef CONFIG_SMP
+/*
+ * Route an interrupt source to the specified hart.
+ * The enable bit moves from the old context to the new one.
+ */
+int interrupt_setaffinity(int vector, int cpu)
+{
+    volatile uint32_t *old, *new;
+    uint32_t bit = 1U << (vector % 32);
+
+    if (vector <= 0 || vector >= 1024 || cpu < 0 || cpu >= CONFIG_SMP_NCPUS)
+        return -1;
+
+    old = (volatile uint32_t*)(PLIC_ENABLE_BASE(plic_context(plic_target(vector))) + (vector / 32) * 4);
+    new = (volatile uint32_t*)(PLIC_ENABLE_BASE(plic_context(cpu)) + (vector / 32) * 4);
+    target_table[vector] = (uint8_t)(cpu + 1);
+    if (old != new && (*old & bit)) {
+        *new |= bit;
+        *old &= ~bit;
+    }
+    return 0;
+}
+#endif /* CONFIG_SMP */
+
 void interrupt_setup(int vector, int mode)
 {
 }
@@ -66,11 +113,14 @@ void interrupt_handler(void)
 {
 }
 
-void riscv_irq_handler(uint32_t cause)
+void riscv_irq_handler(uint32_t cause, struct cpu_regs* regs)
 {
     int irq;
     uint32_t cpuid = hal_cpu_id();
     uint32_t ctx = plic_context(cpuid);
+    struct cpu_regs* prev_regs = irq_regs[cpuid];
+
+    irq_regs[cpuid] = regs;
 
 #ifdef CONFIG_SMODE
     if (cause == 9) {
@@ -87,6 +137,9 @@ void riscv_irq_handler(uint32_t cause)
         /* Supervisor Software Interrupt (IPI) */
         /* Clear pending software interrupt */
         __asm__ volatile("csrc " STR(CSR_IP) ", %0" : : "r"(0x2));
+#if defined(CONFIG_MMU) && defined(CONFIG_SMP)
+        mmu_tlb_ipi();
+#endif
         irq_handler(IPI_IRQ);
     }
 #else
@@ -106,6 +159,24 @@ void riscv_irq_handler(uint32_t cause)
         *(volatile uint32_t*)(CONFIG_CLINT_PHY_BASE + cpuid * 4) = 0;
         irq_handler(IPI_IRQ);
     }
+#endif
+    irq_regs[cpuid] = prev_regs;
+}
+
+/*
+ * Return the program counter interrupted by the current interrupt.
+ */
+int interrupt_pc(vaddr_t* pc)
+{
+    struct cpu_regs* regs = irq_regs[hal_cpu_id()];
+
+    if (regs == NULL)
+        return -1;
+    *pc = (vaddr_t)regs->epc;
+#ifdef CONFIG_SMODE
+    return (regs->status & 0x100) ? 0 : 1; /* SPP */
+#else
+    return (regs->status & 0x1800) ? 0 : 1; /* MPP */
 #endif
 }
 
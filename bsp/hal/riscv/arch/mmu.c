@@ -9,13 +9,245 @@
 #include <cpu.h>
 #include <cpufunc.h>
 #include <riscv_csr.h>
+#include <kmem.h>
+
+#ifdef CONFIG_SMP
+#define NCPUS CONFIG_SMP_NCPUS
+#else
+#define NCPUS 1
+#endif
+
+/*
+ * Largest range, in pages, which is invalidated page by page.
+ * Bigger updates flush the whole TLB instead.
+ */
+#define TLB_RANGE_MAX 32
+
+/*
+ * Spin count to wait for TLB shootdown acknowledgement before the
+ * interrupt is sent again to the CPUs which have not answered.
+ */
+#define SHOOTDOWN_SPIN 0x100000
+
+/*
+ * Address space context.
+ *
+ * Every page directory created by mmu_newmap() owns a context that
+ * holds the ASID tagged onto its translations, the set of CPUs which
+ * are running it, and the set of CPUs which have left it while an
+ * update was made. The latter drop the ASID from their TLB when they
+ * switch back. Contexts are found from the page directory through a
+ * small hash table.
+ */
+#define CTX_HASH 64
+#define ctx_hashfn(pgd) ((int)((kvtop(pgd) >> 12) & (CTX_HASH - 1)))
+
+struct mmu_ctx
+{
+    struct mmu_ctx* next; /* hash chain */
+    pgd_t pgd;            /* page directory */
+    uint32_t asid;        /* generation | ASID */
+    volatile uint32_t cpumask; /* CPUs running this map */
+    volatile uint32_t stale;   /* CPUs which must flush the ASID */
+};
 
 static pgd_t boot_pgd = (pgd_t)BOOT_PGD;
 
+static struct mmu_ctx* ctx_table[CTX_HASH];
+
+static struct mmu_ctx* cpu_ctx[NCPUS]; /* context running on each CPU */
+
+/*
+ * ASID allocator.
+ *
+ * ASIDs are handed out sequentially. The bits above the ASID field
+ * of mmu_ctx.asid carry the generation in which the ASID was given.
+ * When the ASID space is used up, a new generation is started and
+ * every CPU flushes its local TLB before it runs a map with a new
+ * ASID. ASID 0 is reserved for the boot and kernel maps.
+ *
+ * The allocator is serialized by the scheduler lock.
+ */
+static uint32_t asid_bits;       /* implemented ASID width, 0 if none */
+static uint32_t asid_generation; /* current generation */
+static uint32_t asid_next;       /* next ASID in this generation */
+static volatile uint32_t tlb_stale; /* CPUs which must flush on switch */
+
+#ifdef CONFIG_SMP
+/*
+ * Pending TLB shootdown. The request block is owned by the holder
+ * of the lock until every target has acknowledged it.
+ */
+static struct
+{
+    volatile int lock;
+    vaddr_t va;
+    size_t size;
+    volatile uint32_t pending; /* CPUs yet to acknowledge */
+} shootdown;
+#endif
+
+static struct mmu_ctx* ctx_lookup(pgd_t pgd)
+{
+    struct mmu_ctx* ctx;
+
+    for (ctx = ctx_table[ctx_hashfn(pgd)]; ctx != NULL; ctx = ctx->next) {
+        if (ctx->pgd == pgd)
+            return ctx;
+    }
+    return NULL;
+}
+
+static uint32_t asid_alloc(void)
+{
+    uint32_t mask = (1U << asid_bits) - 1;
+
+    if (asid_next > mask) {
+        /* Roll over to a new generation */
+        asid_generation += mask + 1;
+        asid_next = 1;
+        tlb_stale = (1U << NCPUS) - 1;
+    }
+    return asid_generation | asid_next++;
+}
+
+/*
+ * Invalidate the translations of the specified range on this CPU.
+ */
+static void tlb_invalidate_local(vaddr_t va, size_t size)
+{
+    vaddr_t end;
+
+    if (size > TLB_RANGE_MAX * PAGE_SIZE) {
+        mmu_invalidate_tlbs();
+        return;
+    }
+    __asm__ __volatile__("fence w, rw" : : : "memory");
+    for (end = va + size; va < end; va += PAGE_SIZE)
+        mmu_invalidate_tlb_by_vaddr(va);
+}
+
+/*
+ * Invalidate the translations of the specified range on every CPU
+ * that may cache them. Other CPUs are interrupted only when they
+ * have run the map.
+ */
+static void tlb_invalidate(pgd_t pgd, vaddr_t va, size_t size)
+{
+#ifdef CONFIG_SMP
+    struct mmu_ctx* ctx;
+    uint32_t self, cpus;
+    int spin;
+#endif
+
+    tlb_invalidate_local(va, size);
+
+#ifdef CONFIG_SMP
+    if ((ctx = ctx_lookup(pgd)) == NULL)
+        return;
+    self = 1U << hal_cpu_id();
+
+    /*
+     * CPUs which are not running the map flush its ASID when they
+     * switch back. The stale set is published before the running
+     * set is sampled, so a CPU switching in concurrently is caught
+     * by one of the two.
+     */
+    __sync_fetch_and_or(&ctx->stale, ((1U << NCPUS) - 1) & ~self);
+    cpus = ctx->cpumask & ~self;
+    if (cpus == 0)
+        return;
+
+    /*
+     * Take the request block. Another CPU may be waiting for us
+     * to acknowledge its own request meanwhile.
+     */
+    while (__sync_lock_test_and_set(&shootdown.lock, 1))
+        mmu_tlb_ipi();
+
+    shootdown.size = size;
+    shootdown.va = va;
+    __sync_synchronize();
+    __sync_fetch_and_or(&shootdown.pending, cpus);
+    hal_cpu_send_ipi(cpus, 0);
+
+    /*
+     * Wait for every target. A CPU waiting for the kernel lock
+     * drops its IPL, so it still answers. A CPU which runs with
+     * interrupts masked for long answers late, and is kicked
+     * again in case its interrupt was lost meanwhile.
+     */
+    for (spin = 0; shootdown.pending & cpus; spin++) {
+        if (spin >= SHOOTDOWN_SPIN) {
+            hal_cpu_send_ipi(shootdown.pending & cpus, 0);
+            spin = 0;
+        }
+    }
+    __sync_lock_release(&shootdown.lock);
+#endif
+}
+
+#ifdef CONFIG_SMP
+/*
+ * Handle a TLB shootdown request from another CPU.
+ * Called from the software interrupt handler.
+ */
+void mmu_tlb_ipi(void)
+{
+    uint32_t bit = 1U << hal_cpu_id();
+
+    if (shootdown.pending & bit) {
+        tlb_invalidate_local(shootdown.va, shootdown.size);
+        __sync_fetch_and_and(&shootdown.pending, ~bit);
+    }
+}
+#endif
+
+/*
+ * Returns true if the page table for the address belongs to the
+ * map, and can be released when it is replaced by a megapage.
+ * Kernel and I/O page tables are shared with the boot map.
+ */
+static int table_owned(pgd_t pgd, vaddr_t va)
+{
+
+    return pgd != boot_pgd && va < KERNBASE &&
+           pgd[PAGE_DIR(va)] != boot_pgd[PAGE_DIR(va)];
+}
+
+/*
+ * Split a megapage into a page table of 4K pages with the same
+ * attributes, so that a part of it can be remapped.
+ */
+static int spage_split(pgd_t pgd, vaddr_t va)
+{
+    uint32_t pde, flag;
+    paddr_t pg, pa;
+    pte_t pte;
+    int i;
+
+    if ((pg = page_alloc(PAGE_SIZE)) == 0)
+        return ENOMEM;
+    pte = (pte_t)ptokv(pg);
+
+    pde = pgd[PAGE_DIR(va)];
+    pa = spagetopg(pgd, va);
+    flag = pde & ~PTE_ADDRESS;
+    for (i = 0; i < 1024; i++)
+        pte[i] = (uint32_t)((pa + (paddr_t)i * PAGE_SIZE) >> 2) | flag;
+
+    pgd[PAGE_DIR(va)] = (uint32_t)(pg >> 2) | PTE_V;
+    return 0;
+}
+
 /*
  * Map physical memory range into virtual address
  *
  * Returns 0 on success, or ENOMEM on failure.
+ *
+ * A megapage is used when the range covers a whole L1 entry and
+ * both addresses are aligned to it. When a part of a megapage is
+ * changed later, it is split into 4K pages.
  */
 int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
 {
@@ -23,10 +255,15 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
     uint32_t pde_flag = 0;
     pte_t pte;
     paddr_t pg;
+    vaddr_t start;
+    size_t len;
+    uint32_t pde;
 
     pa = round_page(pa);
     va = round_page(va);
     size = trunc_page(size);
+    start = va;
+    len = size;
 
     /*
      * Set page flag
@@ -45,11 +282,11 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
         pde_flag = (uint32_t)PTE_V;
         break;
     case PG_SYSTEM:
-        pte_flag = (uint32_t)PTE_SYSTEM;
+        pte_flag = (uint32_t)(PTE_SYSTEM | PTE_G);
         pde_flag = (uint32_t)PTE_V;
         break;
     case PG_IOMEM:
-        pte_flag = (uint32_t)PTE_SYSTEM; // RISC-V Sv32 doesn't have cache bits in standard PTE
+        pte_flag = (uint32_t)(PTE_SYSTEM | PTE_G); // RISC-V Sv32 doesn't have cache bits in standard PTE
         pde_flag = (uint32_t)PTE_V;
         break;
     default:
@@ -60,6 +297,31 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
      * Map all pages
      */
     while (size > 0) {
+        pde = pgd[PAGE_DIR(va)];
+        if (size >= SPAGE_SIZE && (va & SPAGE_MASK) == 0 &&
+            (type == PG_UNMAP || (pa & SPAGE_MASK) == 0) &&
+            (pde == 0 || spage_present(pgd, va) || table_owned(pgd, va))) {
+            /*
+             * Map (or unmap) a whole megapage.
+             */
+            if (type == PG_UNMAP)
+                pgd[PAGE_DIR(va)] = 0;
+            else
+                pgd[PAGE_DIR(va)] = (uint32_t)(pa >> 2) | pte_flag;
+            if ((pde & PTE_V) && !(pde & (PTE_R | PTE_W | PTE_X)))
+                page_free((paddr_t)((pde & PTE_ADDRESS) << 2), PAGE_SIZE);
+
+            pa += SPAGE_SIZE;
+            va += SPAGE_SIZE;
+            size -= SPAGE_SIZE;
+            continue;
+        }
+        if (spage_present(pgd, va)) {
+            if (spage_split(pgd, va)) {
+                DPRINTF(("Error: MMU mapping failed\n"));
+                return ENOMEM;
+            }
+        }
         if (pte_present(pgd, va)) {
             /* Page table already exists for the address */
             pte = vtopte(pgd, va);
@@ -85,7 +347,7 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
         va += PAGE_SIZE;
         size -= PAGE_SIZE;
     }
-    mmu_invalidate_tlbs();
+    tlb_invalidate(pgd, start, len);
     return 0;
 }
 
@@ -94,13 +356,19 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
  */
 pgd_t mmu_newmap(void)
 {
+    struct mmu_ctx* ctx;
     paddr_t pg;
     pgd_t pgd;
     int i;
 
+    if ((ctx = kmem_alloc(sizeof(*ctx))) == NULL)
+        return NO_PGD;
+
     /* Allocate page directory */
-    if ((pg = page_alloc(PAGE_SIZE)) == 0)
+    if ((pg = page_alloc(PAGE_SIZE)) == 0) {
+        kmem_free(ctx);
         return NO_PGD;
+    }
     pgd = (pgd_t)ptokv(pg);
     memset(pgd, 0, PAGE_SIZE);
 
@@ -114,6 +382,15 @@ pgd_t mmu_newmap(void)
             pgd[i] = boot_pgd[i];
         }
     }
+
+    /* Register address space context */
+    ctx->pgd = pgd;
+    ctx->asid = 0;
+    ctx->cpumask = 0;
+    ctx->stale = 0;
+    i = ctx_hashfn(pgd);
+    ctx->next = ctx_table[i];
+    ctx_table[i] = ctx;
     return pgd;
 }
 
@@ -122,14 +399,32 @@ pgd_t mmu_newmap(void)
  */
 void mmu_terminate(pgd_t pgd)
 {
+    struct mmu_ctx **pp, *ctx;
     int i;
     paddr_t pte_phys;
 
     mmu_invalidate_tlbs();
 
+    /*
+     * Drop the context. Its ASID is not reused until the next
+     * generation, so stale entries tagged with it are harmless.
+     */
+    for (pp = &ctx_table[ctx_hashfn(pgd)]; (ctx = *pp) != NULL; pp = &ctx->next) {
+        if (ctx->pgd == pgd) {
+            *pp = ctx->next;
+            for (i = 0; i < NCPUS; i++) {
+                if (cpu_ctx[i] == ctx)
+                    cpu_ctx[i] = NULL;
+            }
+            kmem_free(ctx);
+            break;
+        }
+    }
+
     /* Release all user page table */
     for (i = 0; i < PAGE_DIR(KERNBASE); i++) {
-        if (pgd[i] != 0 && pgd[i] != boot_pgd[i]) {
+        if (pgd[i] != 0 && pgd[i] != boot_pgd[i] &&
+            !(pgd[i] & (PTE_R | PTE_W | PTE_X))) {
             // Extract physical address of L2 page table from PDE
             pte_phys = (paddr_t)((pgd[i] & PTE_ADDRESS) << 2);
             page_free(pte_phys, PAGE_SIZE);
@@ -141,20 +436,92 @@ void mmu_terminate(pgd_t pgd)
 
 /*
  * Switch to new page directory
+ *
+ * The TLB is kept across the switch when the map has an ASID of
+ * the current generation. Without ASID support in the hart, the
+ * whole TLB is flushed whenever satp changes. The CPU leaves the
+ * running set of the previous map, and drops the ASID of the new
+ * one if that map was changed while the CPU was away.
  */
 void mmu_switch(pgd_t pgd)
 {
+    struct mmu_ctx *ctx, *prev;
     paddr_t phys = kvtop(pgd);
-    uint32_t satp = (1U << 31) | (phys >> 12); // Sv32 mode
-    uint32_t current_satp;
+    int cpu = hal_cpu_id();
+    uint32_t bit = 1U << cpu;
+    uint32_t asid = 0;
+    uint32_t satp, current_satp;
+    int flush = 0, flush_asid = 0;
+
+    ctx = ctx_lookup(pgd);
+    prev = cpu_ctx[cpu];
+    if (prev != ctx) {
+        if (prev != NULL)
+            __sync_fetch_and_and(&prev->cpumask, ~bit);
+        if (ctx != NULL)
+            __sync_fetch_and_or(&ctx->cpumask, bit);
+        cpu_ctx[cpu] = ctx;
+    }
+    if (ctx != NULL) {
+        if (asid_bits != 0) {
+            if ((ctx->asid >> asid_bits) != (asid_generation >> asid_bits))
+                ctx->asid = asid_alloc();
+            asid = ctx->asid & ((1U << asid_bits) - 1);
+        }
+        if (ctx->stale & bit) {
+            __sync_fetch_and_and(&ctx->stale, ~bit);
+            flush_asid = 1;
+        }
+    }
+    if (tlb_stale & bit) {
+        __sync_fetch_and_and(&tlb_stale, ~bit);
+        flush = 1;
+    }
+    satp = SATP_MODE_SV32 | (asid << SATP_ASID_SHIFT) | (phys >> 12);
 
 #ifdef CONFIG_SMODE
     __asm__ __volatile__("csrr %0, " STR(CSR_SATP) : "=r"(current_satp));
 
     if (satp != current_satp) {
         __asm__ __volatile__("csrw " STR(CSR_SATP) ", %0" : : "r"(satp));
-        __asm__ __volatile__("sfence.vma");
+        if (asid_bits == 0)
+            flush = 1;
     }
+    if (flush)
+        mmu_invalidate_tlbs();
+    else if (flush_asid)
+        mmu_invalidate_tlb_by_asid(asid);
+#endif
+}
+
+/*
+ * Returns true if the current map allows the access to the page.
+ * The stale local translation is dropped, so that the access can
+ * be retried.
+ */
+int mmu_access(vaddr_t va, uint32_t prot)
+{
+#ifdef CONFIG_SMODE
+    pgd_t pgd;
+    pte_t pte;
+    uint32_t satp, entry;
+
+    __asm__ __volatile__("csrr %0, " STR(CSR_SATP) : "=r"(satp));
+    pgd = (pgd_t)ptokv((paddr_t)(satp & SATP_PPN_MASK) << 12);
+
+    if (spage_present(pgd, va))
+        entry = pgd[PAGE_DIR(va)];
+    else if (pte_present(pgd, va)) {
+        pte = vtopte(pgd, va);
+        entry = pte[PAGE_TABLE(va)];
+    } else
+        return 0;
+    if ((entry & (PTE_V | prot)) != (PTE_V | prot))
+        return 0;
+    mmu_invalidate_tlb_by_vaddr(va);
+    return 1;
+#else
+    return 0;
 #endif
 }
 
@@ -172,6 +539,8 @@ paddr_t mmu_extract(pgd_t pgd, vaddr_t va, size_t size)
 
     /* Check all pages exist */
     for (pg = start; pg <= end; pg += PAGE_SIZE) {
+        if (spage_present(pgd, pg))
+            continue;
         if (!pte_present(pgd, pg))
             return 0;
         pte = vtopte(pgd, pg);
@@ -180,6 +549,8 @@ paddr_t mmu_extract(pgd_t pgd, vaddr_t va, size_t size)
     }
 
     /* Get physical address */
+    if (spage_present(pgd, start))
+        return spagetopg(pgd, start) + (paddr_t)(va & SPAGE_MASK);
     pte = vtopte(pgd, start);
     pa = (paddr_t)ptetopg(pte, start);
     return pa + (paddr_t)(va - start);
@@ -202,6 +573,33 @@ void mmu_premap(paddr_t phys, vaddr_t virt)
     mmu_invalidate_tlbs();
 }
 
+/*
+ * Probe the number of implemented ASID bits.
+ *
+ * The ASID field of satp is WARL: writing all ones and reading back
+ * returns the bits the hart implements.
+ */
+static void asid_init(void)
+{
+#ifdef CONFIG_SMODE
+    uint32_t satp, probe;
+
+    __asm__ __volatile__("csrr %0, " STR(CSR_SATP) : "=r"(satp));
+    __asm__ __volatile__("csrw " STR(CSR_SATP) ", %0" : : "r"(satp | SATP_ASID_MASK));
+    __asm__ __volatile__("csrr %0, " STR(CSR_SATP) : "=r"(probe));
+    __asm__ __volatile__("csrw " STR(CSR_SATP) ", %0" : : "r"(satp));
+    mmu_invalidate_tlbs();
+
+    probe = (probe & SATP_ASID_MASK) >> SATP_ASID_SHIFT;
+    asid_bits = 0;
+    while (probe & (1U << asid_bits))
+        asid_bits++;
+#endif
+    asid_generation = 1U << asid_bits;
+    asid_next = 1;
+    DPRINTF(("mmu: %d ASID bits\n", asid_bits));
+}
+
 /*
  * Initialize mmu
  */
@@ -210,6 +608,8 @@ void mmu_init(struct mmumap* mmumap_table)
     struct mmumap* map;
     int map_type = 0;
 
+    asid_init();
+
     DPRINTF(("mmu_init start\n"));
     for (map = mmumap_table; map->type != 0; map++) {
         DPRINTF(("mmu_init: mapping phys %lx to virt %lx size %lx type %d\n",
@@ -8,6 +8,8 @@
 #include <cpu.h>
 #include <trap.h>
 #include <context.h>
+#include <vm.h>
+#include <mmu.h>
 
 #ifdef DEBUG
 static char* const trap_name[] = {
@@ -30,14 +32,29 @@ static char* const trap_name[] = {
 };
 #endif
 
+#ifdef CONFIG_MMU
+/*
+ * PTE permission needed by the access which caused the page fault.
+ */
+static uint32_t fault_prot(uint32_t cause)
+{
+
+    if (cause == 12)
+        return PTE_X;
+    if (cause == 15)
+        return PTE_W;
+    return PTE_R;
+}
+#endif
+
 void trap_handler(struct cpu_regs* regs)
 {
     uint32_t cause = regs->cause;
 
     if (cause & 0x80000000) {
         /* Interrupt */
-        extern void riscv_irq_handler(uint32_t cause);
-        riscv_irq_handler(cause & 0x7fffffff);
+        extern void riscv_irq_handler(uint32_t cause, struct cpu_regs* regs);
+        riscv_irq_handler(cause & 0x7fffffff, regs);
     } else {
         if (cause == 8 || cause == 9 || cause == 11) {
             /* System call (ECALL from U-mode, S-mode or M-mode) */
@@ -49,6 +66,18 @@ void trap_handler(struct cpu_regs* regs)
             /* Check for pending exceptions */
             exception_deliver();
         } else {
+#ifdef CONFIG_MMU
+            /*
+             * Instruction, load or store page fault. Back the page
+             * of a lazy segment, and retry the access only when the
+             * page now allows it. A fetch from a page without the
+             * execute permission would fault forever otherwise.
+             */
+            if ((cause == 12 || cause == 13 || cause == 15) &&
+                vm_fault((vaddr_t)regs->badaddr) == 0 &&
+                mmu_access((vaddr_t)regs->badaddr, fault_prot(cause)))
+                return;
+#endif
             /* Hardware exception */
 #ifdef DEBUG
             printf("TRAP: %s\n", (cause < 16) ? trap_name[cause] : "Unknown");
@@ -27,6 +27,14 @@
 
 #define PTE_ADDRESS 0xfffffc00
 
+/*
+ * satp fields (Sv32)
+ */
+#define SATP_MODE_SV32  0x80000000
+#define SATP_ASID_SHIFT 22
+#define SATP_ASID_MASK  0x7fc00000
+#define SATP_PPN_MASK   0x003fffff
+
 #ifndef __ASSEMBLY__
 #include <sys/types.h>
 #include <riscv_csr.h>
@@ -42,6 +50,15 @@ typedef uint32_t* pte_t;
 #define page_present(pte, virt) (pte[PAGE_TABLE(virt)] & PTE_PRESENT)
 #define ptetopg(pte, virt) (paddr_t)(((pte)[PAGE_TABLE(virt)] & PTE_ADDRESS) << 2)
 
+/*
+ * Megapage (4M leaf entry in the L1 table)
+ */
+#define SPAGE_SIZE 0x00400000
+#define SPAGE_MASK (SPAGE_SIZE - 1)
+
+#define spage_present(pgd, virt) (((pgd)[PAGE_DIR(virt)] & PTE_PRESENT) && ((pgd)[PAGE_DIR(virt)] & (PTE_R | PTE_W | PTE_X)))
+#define spagetopg(pgd, virt) (paddr_t)(((pgd)[PAGE_DIR(virt)] & PTE_ADDRESS) << 2)
+
 #define NO_PGD ((pgd_t)0)
 
 static inline void mmu_invalidate_tlbs(void)
@@ -54,6 +71,11 @@ static inline void mmu_invalidate_tlb_by_vaddr(vaddr_t va)
     __asm__ __volatile__("sfence.vma %0, x0" : : "r"(va) : "memory");
 }
 
+static inline void mmu_invalidate_tlb_by_asid(uint32_t asid)
+{
+    __asm__ __volatile__("sfence.vma x0, %0" : : "r"(asid) : "memory");
+}
+
 static inline void set_satp(uint32_t satp)
 {
 #ifdef CONFIG_SMODE
@@ -68,6 +90,8 @@ static inline void set_satp(uint32_t satp)
     );
 #endif
 }
+void mmu_tlb_ipi(void);
+int mmu_access(vaddr_t va, uint32_t prot);
 #endif /* !__ASSEMBLY__ */
 
 #endif /* !_RISCV_MMU_H */
@@ -34,6 +34,7 @@
 
 #include <sys/types.h>
 #include <cpufunc.h>
+#include <cpu.h>
 
 void cpu_idle(void)
 {
@@ -50,6 +51,14 @@ void flush_tlb(void)
                      : "memory");
 }
 
+/*
+ * Invalidate the TLB entry of one page (i486 or later).
+ */
+void flush_tlb_page(vaddr_t va)
+{
+    __asm__ volatile("invlpg (%0)" : : "r"(va) : "memory");
+}
+
 void flush_cache(void)
 {
     __asm__ volatile("wbinvd" : : : "memory");
@@ -89,6 +98,18 @@ uint32_t get_cr3(void)
     return val;
 }
 
+void set_cr4(uint32_t val)
+{
+    __asm__ volatile("movl %0, %%cr4" : : "r"(val) : "memory");
+}
+
+uint32_t get_cr4(void)
+{
+    uint32_t val;
+    __asm__ volatile("movl %%cr4, %0" : "=r"(val));
+    return val;
+}
+
 void outb(int port, u_char val)
 {
     __asm__ volatile("outb %0, %w1" : : "a"(val), "d"(port));
@@ -123,6 +144,30 @@ void wrmsr(uint32_t msr, uint32_t lo, uint32_t hi)
     __asm__ volatile("wrmsr" : : "a"(lo), "d"(hi), "c"(msr));
 }
 
+/*
+ * Returns true if the processor supports the cpuid instruction.
+ * It is detected by toggling the ID flag in EFLAGS.
+ */
+int cpuid_present(void)
+{
+    uint32_t before, after;
+
+    __asm__ volatile("pushfl\n"
+                     "popl %0\n"
+                     "movl %0, %1\n"
+                     "xorl %2, %1\n"
+                     "pushl %1\n"
+                     "popfl\n"
+                     "pushfl\n"
+                     "popl %1\n"
+                     "pushl %0\n"
+                     "popfl"
+                     : "=&r"(before), "=&r"(after)
+                     : "i"(EFL_ID)
+                     : "cc");
+    return ((before ^ after) & EFL_ID) != 0;
+}
+
 void cpuid(uint32_t op, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx)
 {
     __asm__ volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(op));
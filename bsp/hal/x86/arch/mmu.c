@@ -50,6 +50,79 @@
  */
 static pgd_t boot_pgd = (pgd_t)BOOT_PGD;
 
+/*
+ * Largest range, in pages, which is invalidated page by page.
+ * Bigger updates flush the whole TLB instead.
+ */
+#define TLB_RANGE_MAX 32
+
+/*
+ * Processor features used for TLB maintenance. invlpg is
+ * assumed whenever the cpuid instruction is available (i486
+ * and later).
+ */
+static int tlb_invlpg;    /* invlpg available */
+static uint32_t pte_global; /* PTE_GLOBAL if global pages are enabled */
+static int spage_enable;  /* 4M pages available */
+
+/*
+ * Invalidate the translations of the specified range.
+ * Global kernel entries survive a CR3 reload, so a change to
+ * the kernel map needs PGE to be toggled.
+ */
+static void tlb_invalidate(vaddr_t va, size_t size, int global)
+{
+    vaddr_t end;
+    uint32_t cr4;
+
+    if (tlb_invlpg && size <= TLB_RANGE_MAX * PAGE_SIZE) {
+        for (end = va + size; va < end; va += PAGE_SIZE)
+            flush_tlb_page(va);
+    } else if (global && pte_global) {
+        cr4 = get_cr4();
+        set_cr4(cr4 & ~CR4_PGE);
+        set_cr4(cr4);
+    } else {
+        flush_tlb();
+    }
+}
+
+/*
+ * Returns true if the page table for the address belongs to the
+ * map, and can be released when it is replaced by a large page.
+ * The kernel page tables are shared by all maps.
+ */
+static int table_owned(pgd_t pgd, vaddr_t va)
+{
+
+    return pgd != boot_pgd && va < KERNBASE;
+}
+
+/*
+ * Split a 4M page into a page table of 4K pages with the same
+ * attributes, so that a part of it can be remapped.
+ */
+static int spage_split(pgd_t pgd, vaddr_t va)
+{
+    uint32_t pde, flag;
+    paddr_t pg, pa;
+    pte_t pte;
+    int i;
+
+    if ((pg = page_alloc(PAGE_SIZE)) == 0)
+        return ENOMEM;
+    pte = (pte_t)ptokv(pg);
+
+    pde = pgd[PAGE_DIR(va)];
+    pa = pde & PDE_SPAGE_ADDRESS;
+    flag = pde & (PTE_PRESENT | PTE_WRITE | PTE_USER | PTE_WTHRU | PTE_NCACHE | PTE_GLOBAL);
+    for (i = 0; i < 1024; i++)
+        pte[i] = (uint32_t)(pa + (paddr_t)i * PAGE_SIZE) | flag;
+
+    pgd[PAGE_DIR(va)] = (uint32_t)pg | PDE_PRESENT | PDE_WRITE | (pde & PDE_USER);
+    return 0;
+}
+
 /*
  * Map physical memory range into virtual address
  *
@@ -75,8 +148,9 @@ static pgd_t boot_pgd = (pgd_t)BOOT_PGD;
  * page entry in it. All page tables are released when mmu_delmap()
  * is called when task is terminated.
  *
- * TODO: TLB should be flushed for specific page by invalpg in
- * case of i486.
+ * A 4M page is used when the range covers a whole page directory
+ * entry and both addresses are aligned to it. When a part of a 4M
+ * page is changed later, it is split into 4K pages.
  */
 int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
 {
@@ -84,10 +158,15 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
     uint32_t pde_flag = 0;
     pte_t pte;
     paddr_t pg;
+    vaddr_t start;
+    size_t len;
+    uint32_t pde;
 
     pa = round_page(pa);
     va = round_page(va);
     size = trunc_page(size);
+    start = va;
+    len = size;
 
     /*
      * Set page flag
@@ -107,11 +186,11 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
         break;
     case PG_SYSTEM:
         pde_flag = (uint32_t)(PDE_PRESENT | PDE_WRITE);
-        pte_flag = (uint32_t)(PTE_PRESENT | PTE_WRITE);
+        pte_flag = (uint32_t)(PTE_PRESENT | PTE_WRITE) | pte_global;
         break;
     case PG_IOMEM:
         pde_flag = (uint32_t)(PDE_PRESENT | PDE_WRITE);
-        pte_flag = (uint32_t)(PTE_PRESENT | PTE_WRITE | PTE_NCACHE);
+        pte_flag = (uint32_t)(PTE_PRESENT | PTE_WRITE | PTE_NCACHE) | pte_global;
         break;
     default:
         panic("mmu_map");
@@ -120,6 +199,31 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
      * Map all pages
      */
     while (size > 0) {
+        pde = pgd[PAGE_DIR(va)];
+        if (size >= SPAGE_SIZE && (va & SPAGE_MASK) == 0 &&
+            (type == PG_UNMAP || (spage_enable && (pa & SPAGE_MASK) == 0)) &&
+            (!(pde & PDE_PRESENT) || (pde & PDE_SIZE) || table_owned(pgd, va))) {
+            /*
+             * Map (or unmap) a whole 4M page.
+             */
+            if (type == PG_UNMAP)
+                pgd[PAGE_DIR(va)] = 0;
+            else
+                pgd[PAGE_DIR(va)] = (uint32_t)pa | pte_flag | PDE_SIZE;
+            if ((pde & (PDE_PRESENT | PDE_SIZE)) == PDE_PRESENT)
+                page_free((paddr_t)(pde & PDE_ADDRESS), PAGE_SIZE);
+
+            pa += SPAGE_SIZE;
+            va += SPAGE_SIZE;
+            size -= SPAGE_SIZE;
+            continue;
+        }
+        if (spage_present(pgd, va)) {
+            if (spage_split(pgd, va)) {
+                DPRINTF(("Error: MMU mapping failed\n"));
+                return ENOMEM;
+            }
+        }
         if (pte_present(pgd, va)) {
             /* Page table already exists for the address */
             pte = vtopte(pgd, va);
@@ -141,7 +245,7 @@ int mmu_map(pgd_t pgd, paddr_t pa, vaddr_t va, size_t size, int type)
         va += PAGE_SIZE;
         size -= PAGE_SIZE;
     }
-    flush_tlb();
+    tlb_invalidate(start, len, pgd == boot_pgd);
     return 0;
 }
 
@@ -184,7 +288,7 @@ void mmu_terminate(pgd_t pgd)
     /* Release all user page table */
     for (i = 0; i < PAGE_DIR(KERNBASE); i++) {
         pte = (pte_t)pgd[i];
-        if (pte != 0)
+        if (pte != 0 && !(pgd[i] & PDE_SIZE))
             page_free((paddr_t)((paddr_t)pte & PTE_ADDRESS), PAGE_SIZE);
     }
     /* Release page directory */
@@ -196,7 +300,7 @@ void mmu_terminate(pgd_t pgd)
  *
  * This is called when context is switched.
  * Whole TLB are flushed automatically by loading
- * CR3 register.
+ * CR3 register, except the global kernel pages.
  */
 void mmu_switch(pgd_t pgd)
 {
@@ -224,12 +328,16 @@ paddr_t mmu_extract(pgd_t pgd, vaddr_t va, size_t size)
     for (pg = start; pg <= end; pg += PAGE_SIZE) {
         if (!pte_present(pgd, pg))
             return 0;
+        if (spage_present(pgd, pg))
+            continue;
         pte = vtopte(pgd, pg);
         if (!page_present(pte, pg))
             return 0;
     }
 
     /* Get physical address */
+    if (spage_present(pgd, start))
+        return (paddr_t)spagetopg(pgd, start) + (paddr_t)(va & SPAGE_MASK);
     pte = vtopte(pgd, start);
     pa = (paddr_t)ptetopg(pte, start);
     return pa + (paddr_t)(va - start);
@@ -254,6 +362,25 @@ void mmu_init(struct mmumap* mmumap_table)
 {
     struct mmumap* map;
     int map_type = 0;
+    uint32_t eax, ebx, ecx, edx;
+
+    /*
+     * Enable global pages so that the kernel translations
+     * survive a context switch, and 4M pages for large
+     * mappings.
+     */
+    if (cpuid_present()) {
+        tlb_invlpg = 1;
+        cpuid(1, &eax, &ebx, &ecx, &edx);
+        if (edx & CPUID_PGE) {
+            set_cr4(get_cr4() | CR4_PGE);
+            pte_global = PTE_GLOBAL;
+        }
+        if (edx & CPUID_PSE) {
+            set_cr4(get_cr4() | CR4_PSE);
+            spage_enable = 1;
+        }
+    }
 
     for (map = mmumap_table; map->type != 0; map++) {
         switch (map->type) {
@@ -41,6 +41,7 @@
 #include <cpufunc.h>
 #include <context.h>
 #include <locore.h>
+#include <vm.h>
 
 #ifdef DEBUG
 /*
@@ -110,6 +111,15 @@ void trap_handler(struct cpu_regs* regs)
     else if (trap_no == 2)
         panic("NMI");
 
+#ifdef CONFIG_MMU
+    /*
+     * Back the page of a lazy segment, and retry the access.
+     * This handles a fault in copyin() or copyout(), too.
+     */
+    if (trap_no == 14 && !(regs->err_code & PF_PRESENT) && vm_fault((vaddr_t)get_cr2()) == 0)
+        return;
+#endif
+
     /*
      * Check whether this trap is kernel page fault caused
      * by known routine to access user space like copyin().
@@ -69,6 +69,7 @@
 #define EFL_RF 0x00010000        /* Resume without tracing */
 #define EFL_VM 0x00020000        /* Virtual 8086 mode */
 #define EFL_AC 0x00040000        /* Alignment Check */
+#define EFL_ID 0x00200000        /* CPUID instruction available */
 
 /*
  * CR0 register
@@ -85,6 +86,18 @@
 #define CR0_MP 0x00000002 /* monitor coprocessor */
 #define CR0_PE 0x00000001 /* enable protected mode */
 
+/*
+ * CR4 register
+ */
+#define CR4_PSE 0x00000010 /* enable 4M pages */
+#define CR4_PGE 0x00000080 /* enable global pages */
+
+/*
+ * CPUID feature flags (leaf 1, edx)
+ */
+#define CPUID_PSE 0x00000008 /* 4M pages */
+#define CPUID_PGE 0x00002000 /* global pages */
+
 #ifndef __ASSEMBLY__
 
 #include <sys/types.h>
@@ -38,6 +38,7 @@ __BEGIN_DECLS
 
 void cpu_idle(void);
 void flush_tlb(void);
+void flush_tlb_page(vaddr_t);
 void flush_cache(void);
 void load_tr(uint32_t);
 void load_gdt(void*);
@@ -45,12 +46,15 @@ void load_idt(void*);
 uint32_t get_cr2(void);
 void set_cr3(uint32_t);
 uint32_t get_cr3(void);
+void set_cr4(uint32_t);
+uint32_t get_cr4(void);
 void outb(int, u_char);
 u_char inb(int);
 void outb_p(int, u_char);
 u_char inb_p(int);
 void rdmsr(uint32_t, uint32_t*, uint32_t*);
 void wrmsr(uint32_t, uint32_t, uint32_t);
+int cpuid_present(void);
 void cpuid(uint32_t, uint32_t*, uint32_t*, uint32_t*, uint32_t*);
 
 __END_DECLS
@@ -58,6 +58,7 @@ typedef uint32_t* pte_t; /* page table entry */
 #define PTE_NCACHE 0x00000010
 #define PTE_ACCESS 0x00000020
 #define PTE_DIRTY 0x00000040
+#define PTE_GLOBAL 0x00000100
 #define PTE_AVAIL 0x00000e00
 #define PTE_ADDRESS 0xfffff000
 
@@ -75,4 +76,16 @@ typedef uint32_t* pte_t; /* page table entry */
 
 #define ptetopg(pte, virt) ((pte)[PAGE_TABLE(virt)] & PTE_ADDRESS)
 
+/*
+ * Large page (4M page with PSE)
+ */
+#define SPAGE_SIZE 0x00400000
+#define SPAGE_MASK (SPAGE_SIZE - 1)
+#define PDE_SPAGE_ADDRESS 0xffc00000
+
+#define spage_present(pgd, virt) \
+    (((pgd)[PAGE_DIR(virt)] & (PDE_PRESENT | PDE_SIZE)) == (PDE_PRESENT | PDE_SIZE))
+
+#define spagetopg(pgd, virt) ((pgd)[PAGE_DIR(virt)] & PDE_SPAGE_ADDRESS)
+
 #endif /* !_X86_MMU_H */
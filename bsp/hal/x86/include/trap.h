@@ -32,6 +32,11 @@
 
 #include <sys/cdefs.h>
 
+/*
+ * Page fault error code
+ */
+#define PF_PRESENT 0x01 /* protection violation */
+
 __BEGIN_DECLS
 void trap_handler(struct cpu_regs*);
 void trap_dump(struct cpu_regs*);
@@ -50,6 +50,24 @@
 #define PIT_CH0 0x40
 #define PIT_CTRL 0x43
 
+static int has_tsc;      /* time stamp counter is available */
+static uint32_t tsc_hz;  /* TSC rate, 0 until calibrated */
+static uint32_t tsc_start;
+static int calib_ticks;
+
+/*
+ * Measure the TSC rate against the first second of clock ticks.
+ */
+static void tsc_calibrate(void)
+{
+
+    if (calib_ticks == 0)
+        tsc_start = clock_cycles();
+    else if (calib_ticks == HZ)
+        tsc_hz = clock_cycles() - tsc_start;
+    calib_ticks++;
+}
+
 /*
  * Clock interrupt service routine.
  * No H/W reprogram is required.
@@ -59,6 +77,8 @@ static int clock_isr(void* arg)
     int s;
 
     s = splhigh();
+    if (has_tsc && tsc_hz == 0)
+        tsc_calibrate();
     timer_handler();
     splx(s);
 
@@ -72,6 +92,12 @@ static int clock_isr(void* arg)
 void clock_init(void)
 {
     irq_t clock_irq;
+    uint32_t eax, ebx, ecx, edx;
+
+    if (cpuid_present()) {
+        cpuid(1, &eax, &ebx, &ecx, &edx);
+        has_tsc = (edx & 0x10) ? 1 : 0;
+    }
 
     outb_p(PIT_CTRL, 0x34);                             /* Command to set generator mode */
     outb_p(PIT_CH0, (u_char)(PIT_LATCH & 0xff));        /* LSB */
@@ -81,3 +107,35 @@ void clock_init(void)
 
     DPRINTF(("Clock rate: %d ticks/sec\n", CONFIG_HZ));
 }
+
+/*
+ * Return a free running cycle counter.
+ * This is the TSC, or the i8254 count if the CPU has no TSC.
+ */
+uint32_t clock_cycles(void)
+{
+    uint32_t lo, hi;
+    u_long ticks;
+    int s;
+
+    if (has_tsc) {
+        __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+        return lo;
+    }
+    s = splhigh();
+    ticks = timer_ticks();
+    outb(PIT_CTRL, 0x00); /* Latch counter 0 */
+    lo = inb(PIT_CH0);
+    lo |= (uint32_t)inb(PIT_CH0) << 8;
+    splx(s);
+    return (uint32_t)ticks * PIT_LATCH + (PIT_LATCH - lo);
+}
+
+/*
+ * Return the rate of clock_cycles() in Hz, or 0 if unknown yet.
+ */
+uint32_t clock_cyclehz(void)
+{
+
+    return has_tsc ? tsc_hz : PIT_TICK;
+}
@@ -64,6 +64,11 @@ static volatile int irq_level;
 static int ipl_table[NIRQS];    /* Vector -> level */
 static u_int mask_table[NIPLS]; /* Level -> mask */
 
+/*
+ * Registers saved by the current interrupt
+ */
+static struct cpu_regs* irq_regs;
+
 /*
  * Set mask for current ipl
  */
@@ -149,6 +154,7 @@ void interrupt_setup(int vector, int mode)
  */
 void interrupt_handler(struct cpu_regs* regs)
 {
+    struct cpu_regs* prev_regs;
     int vector = (int)regs->trap_no;
     int old_ipl, new_ipl;
 
@@ -165,15 +171,30 @@ void interrupt_handler(struct cpu_regs* regs)
     outb(PIC_M, 0x20);     /* Non specific EOI to master */
 
     /* Dispatch interrupt */
+    prev_regs = irq_regs;
+    irq_regs = regs;
     splon();
     irq_handler(vector);
     sploff();
+    irq_regs = prev_regs;
 
     /* Restore interrupt level */
     irq_level = old_ipl;
     update_mask();
 }
 
+/*
+ * Return the program counter interrupted by the current interrupt.
+ */
+int interrupt_pc(vaddr_t* pc)
+{
+
+    if (irq_regs == NULL)
+        return -1;
+    *pc = (vaddr_t)irq_regs->eip;
+    return (irq_regs->cs & 3) ? 1 : 0;
+}
+
 /*
  * Initialize 8259 interrupt controllers.
  * All interrupts will be masked off in ICU.
@@ -0,0 +1,89 @@
+/*
+ * Automatically generated file. Don't edit
+ */
+#define CONFIG_MACHINE x86-pc
+#define CONFIG_PROFILE -mmu
+#define CONFIG_MMU y
+#define CONFIG_SYSPAGE_PHY_BASE 0x00000000
+#define CONFIG_SYSPAGE_BASE 0x80000000
+#define CONFIG_IOMEM_PHY_BASE 0x00000000
+#define CONFIG_IOMEM_BASE 0x00000000
+#define CONFIG_LOADER_TEXT 0x00004000
+#define CONFIG_LOADER_SIZE 0x4000
+#define CONFIG_KERNEL_TEXT 0x80200000
+#define CONFIG_BOOTIMG_PHY_BASE 0x00100000
+#define CONFIG_BOOTIMG_BASE 0x80100000
+#define CONFIG_HZ 1000
+#define CONFIG_TIME_SLICE 50
+#define CONFIG_OPEN_MAX 16
+#define CONFIG_BUF_CACHE 32
+#define CONFIG_FS_THREADS 4
+#define CONFIG_MAX_ALLOC_SIZE 0x8000
+#define CONFIG_I386 y
+#define CONFIG_CACHE y
+#define CONFIG_BOOTDISK y
+#define CONFIG_POSIX y
+#define CONFIG_CMDBOX y
+#define CONFIG_SIZE_OPT y
+#define CONFIG_DIAG_SERIAL y
+#define CONFIG_FIFOFS y
+#define CONFIG_DEVFS y
+#define CONFIG_RAMFS y
+#define CONFIG_ARFS y
+#define CONFIG_FATFS y
+#define CONFIG_PM y
+#define CONFIG_PM_POWERSAVE y
+#define CONFIG_DVS_EMULATION y
+#define CONFIG_PM y
+#define CONFIG_I8237 y
+#define CONFIG_CONS y
+#define CONFIG_SERIAL y
+#define CONFIG_NS16550 y
+#define CONFIG_CPUFREQ y
+#define CONFIG_EST y
+#define CONFIG_RTC y
+#define CONFIG_MC146818 y
+#define CONFIG_NULL y
+#define CONFIG_ZERO y
+#define CONFIG_RAMDISK y
+#define CONFIG_FDD y
+#define CONFIG_NS16550_PHY_BASE 0x3f8
+#define CONFIG_NS16550_BASE 0x000003f8
+#define CONFIG_NS16550_IRQ 4
+#define CONFIG_MC146818_PHY_BASE 0x70
+#define CONFIG_MC146818_BASE 0x00000070
+#define CONFIG_CMD_CAT y
+#define CONFIG_CMD_LS y
+#define CONFIG_CMD_MKDIR y
+#define CONFIG_CMD_MORE y
+#define CONFIG_CMD_MV y
+#define CONFIG_CMD_NICE y
+#define CONFIG_CMD_PRINTENV y
+#define CONFIG_CMD_PS y
+#define CONFIG_CMD_PWD y
+#define CONFIG_CMD_RM y
+#define CONFIG_CMD_RMDIR y
+#define CONFIG_CMD_SH y
+#define CONFIG_CMD_SLEEP y
+#define CONFIG_CMD_SYNC y
+#define CONFIG_CMD_TEST y
+#define CONFIG_CMD_TOUCH y
+#define CONFIG_CMD_UNAME y
+#define CONFIG_CMD_WC y
+#define CONFIG_CMD_GREP y
+#define CONFIG_CMD_TAIL y
+#define CONFIG_CMD_SORT y
+#define CONFIG_CMD_FIND y
+#define CONFIG_CMD_XARGS y
+#define CONFIG_CMD_TAR y
+#define CONFIG_CMD_GZIP y
+#define CONFIG_CMD_DD y
+#define CONFIG_CMD_HEXDUMP y
+#define CONFIG_CMD_KILO y
+#define CONFIG_CMD_NC y
+#define CONFIG_CMD_PING y
+#define CONFIG_CMD_DATE y
+#define CONFIG_CMD_INIT y
+#define CONFIG_CMD_DISKUTIL y
+#define CONFIG_LIBM fdlibm
+#define CONFIG_DIAG_SERIAL y
@@ -0,0 +1,105 @@
+#
+# Automatically generated file. Don't edit
+#
+_CONFIG_MK_=1
+ARCH=x86
+PLATFORM=pc
+PROFILE=pc-mmu
+_GNUC_=1
+CC=gcc
+CPP=cpp
+AS=as
+LD=ld
+AR=ar
+OBJCOPY=objcopy
+OBJDUMP=objdump
+STRIP=strip
+CONFIG_MMU=y
+GCCFLAGS+= -march=i386
+GCCFLAGS+= -m32
+GCCFLAGS+= -mpreferred-stack-boundary=2
+GCCFLAGS+= -fno-PIC -fno-pic -fno-stack-protector -fno-pie -fno-PIE
+ASFLAGS+= --32
+LDFLAGS+= -m elf_i386
+CONFIG_SYSPAGE_BASE=0x80000000
+CONFIG_IOMEM_BASE=0x00000000
+CONFIG_LOADER_TEXT=0x00004000
+CONFIG_LOADER_SIZE=0x4000
+CONFIG_KERNEL_TEXT=0x80200000
+CONFIG_BOOTIMG_BASE=0x80100000
+CONFIG_HZ=1000
+CONFIG_TIME_SLICE=50
+CONFIG_OPEN_MAX=16
+CONFIG_BUF_CACHE=32
+CONFIG_FS_THREADS=4
+CONFIG_MAX_ALLOC_SIZE=0x8000
+CONFIG_I386=y
+CONFIG_CACHE=y
+CONFIG_BOOTDISK=y
+CONFIG_POSIX=y
+CONFIG_CMDBOX=y
+CONFIG_ZIG_DRV=n
+CONFIG_ZIG_USR=n
+CONFIG_ZIG_KRNL=n
+CONFIG_ZIG_BOOT=n
+CONFIG_SIZE_OPT=y
+CONFIG_DIAG_SERIAL=y
+CONFIG_FIFOFS=y
+CONFIG_DEVFS=y
+CONFIG_RAMFS=y
+CONFIG_ARFS=y
+CONFIG_FATFS=y
+CONFIG_PM=y
+CONFIG_PM_POWERSAVE=y
+CONFIG_DVS_EMULATION=y
+CONFIG_PM=y
+CONFIG_I8237=y
+CONFIG_CONS=y
+CONFIG_SERIAL=y
+CONFIG_NS16550=y
+CONFIG_CPUFREQ=y
+CONFIG_EST=y
+CONFIG_RTC=y
+CONFIG_MC146818=y
+CONFIG_NULL=y
+CONFIG_ZERO=y
+CONFIG_RAMDISK=y
+CONFIG_FDD=y
+CONFIG_NS16550_BASE=0x000003f8
+CONFIG_NS16550_IRQ=4
+CONFIG_MC146818_BASE=0x00000070
+CONFIG_CMD_CAT=y
+CONFIG_CMD_LS=y
+CONFIG_CMD_MKDIR=y
+CONFIG_CMD_MORE=y
+CONFIG_CMD_MV=y
+CONFIG_CMD_NICE=y
+CONFIG_CMD_PRINTENV=y
+CONFIG_CMD_PS=y
+CONFIG_CMD_PWD=y
+CONFIG_CMD_RM=y
+CONFIG_CMD_RMDIR=y
+CONFIG_CMD_SH=y
+CONFIG_CMD_SLEEP=y
+CONFIG_CMD_SYNC=y
+CONFIG_CMD_TEST=y
+CONFIG_CMD_TOUCH=y
+CONFIG_CMD_UNAME=y
+CONFIG_CMD_WC=y
+CONFIG_CMD_GREP=y
+CONFIG_CMD_TAIL=y
+CONFIG_CMD_SORT=y
+CONFIG_CMD_FIND=y
+CONFIG_CMD_XARGS=y
+CONFIG_CMD_TAR=y
+CONFIG_CMD_GZIP=y
+CONFIG_CMD_DD=y
+CONFIG_CMD_HEXDUMP=y
+CONFIG_CMD_KILO=y
+CONFIG_CMD_NC=y
+CONFIG_CMD_PING=y
+CONFIG_CMD_DATE=y
+CONFIG_CMD_INIT=y
+CONFIG_CMD_DISKUTIL=y
+CONFIG_LIBM=fdlibm
+CONFIG_DIAG_SERIAL=y
@@ -0,0 +1,32 @@
+/*
+ * Automatically generated file. Don't edit
+ */
+extern struct driver pm_driver;
+extern struct driver i8237_driver;
+extern struct driver cons_driver;
+extern struct driver serial_driver;
+extern struct driver ns16550_driver;
+extern struct driver cpufreq_driver;
+extern struct driver est_driver;
+extern struct driver rtc_driver;
+extern struct driver mc146818_driver;
+extern struct driver null_driver;
+extern struct driver zero_driver;
+extern struct driver ramdisk_driver;
+extern struct driver fdd_driver;
+
+struct driver *driver_table[] = {
+	&pm_driver,
+	&i8237_driver,
+	&cons_driver,
+	&serial_driver,
+	&ns16550_driver,
+	&cpufreq_driver,
+	&est_driver,
+	&rtc_driver,
+	&mc146818_driver,
+	&null_driver,
+	&zero_driver,
+	&ramdisk_driver,
+	&fdd_driver,
+};
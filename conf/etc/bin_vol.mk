@@ -33,6 +33,9 @@ BIN_FILES-$(CONFIG_SNDIO)+= $(SRCDIR)/usr/posix/playwav/playwav
 BIN_FILES-$(CONFIG_CMD_DISKUTIL)+= $(SRCDIR)/usr/posix/diskutil/diskutil
 BIN_FILES-$(CONFIG_CMD_PMCTRL)+= $(SRCDIR)/usr/posix/pmctrl/pmctrl
 BIN_FILES-$(CONFIG_CMD_KTRACE)+= $(SRCDIR)/usr/posix/ktrace/ktrace
+BIN_FILES-$(CONFIG_CMD_IRQSTAT)+= $(SRCDIR)/usr/posix/irqstat/irqstat
+BIN_FILES-$(CONFIG_CMD_TRACE)+= $(SRCDIR)/usr/posix/trace/trace
+BIN_FILES-$(CONFIG_CMD_PROF)+= $(SRCDIR)/usr/posix/prof/prof
 BIN_FILES-$(CONFIG_CMD_DEBUG)+= $(SRCDIR)/usr/posix/debug/debug
 
 BIN_FILES= $(BIN_FILES-y)
@@ -37,7 +37,6 @@ endif
 #TASKS+= 	$(SRCDIR)/usr/test/ipc_mt/ipc_mt.rt
 #TASKS+= 	$(SRCDIR)/usr/test/kbd/kbd.rt
 #TASKS+= 	$(SRCDIR)/usr/test/kmon/kmon.rt
-#TASKS+= 	$(SRCDIR)/usr/test/malloc/malloc.rt
 #TASKS+= 	$(SRCDIR)/usr/test/mutex/mutex.rt
 #TASKS+= 	$(SRCDIR)/usr/test/sem/sem.rt
 #TASKS+= 	$(SRCDIR)/usr/test/task/task.rt
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _IPC_EVENT_H_
+#define _IPC_EVENT_H_
+
+#include <sys/types.h>
+#include <ipc/ipc.h>
+
+/*
+ * Shared event area of an epoll instance.
+ *
+ * The client allocates the area, and the servers map it when the
+ * first descriptor is registered.  Each server has its own ring, so
+ * every ring has a single writer: the server fills entries and
+ * advances head, and the client consumes entries and advances tail.
+ * When a ring is full the server sets overflow instead, and the
+ * client checks all of its descriptors.
+ */
+#define EVRING_SIZE     1024    /* entries per ring, power of 2 */
+
+#define EVRING_FS       0       /* ring of the file system server */
+#define EVRING_NET      1       /* ring of the network server */
+#define EVRING_NSRC     2
+
+struct event_entry {
+    int slot;                   /* slot of the descriptor */
+    u_int events;               /* POLLxxx */
+};
+
+struct event_ring {
+    volatile u_int head;        /* written by the server */
+    volatile u_int tail;        /* written by the client */
+    volatile int overflow;      /* set by the server, cleared by the client */
+    struct event_entry ent[EVRING_SIZE];
+};
+
+struct event_shm {
+    struct event_ring ring[EVRING_NSRC];
+};
+
+/*
+ * Event control message (FS_EVENT_CTL, NET_EVENT_CTL)
+ *
+ * Adds or removes a persistent listener of fd.  Events are queued to
+ * the ring of the server in shm, and sem is posted.  A listener is
+ * identified by sem and slot.  All listeners of sem are removed by
+ * FS_POLL_DEREGISTER and NET_POLL_DEREGISTER.  FS_EXIT and NET_EXIT
+ * remove all listeners of the task and unmap its shm.
+ */
+#define EVENT_ADD       1
+#define EVENT_DEL       2
+
+struct event_msg {
+    struct msg_header hdr;
+    int op;                     /* EVENT_ADD or EVENT_DEL */
+    int fd;                     /* descriptor */
+    int slot;                   /* slot of the descriptor */
+    u_int events;               /* events of interest */
+    sem_t sem;                  /* client notification semaphore */
+    struct event_shm *shm;      /* shared area in the client */
+    int polled;                 /* out: no events, poll this fd */
+};
+
+/*
+ * Queue an event.  Called by the single writer of the ring.
+ */
+static __inline void event_post(struct event_ring *r, int slot, u_int events)
+{
+    u_int head = r->head;
+
+    if (head - r->tail >= EVRING_SIZE) {
+        r->overflow = 1;
+        return;
+    }
+    r->ent[head & (EVRING_SIZE - 1)].slot = slot;
+    r->ent[head & (EVRING_SIZE - 1)].events = events;
+    __sync_synchronize();
+    r->head = head + 1;
+}
+
+#endif /* !_IPC_EVENT_H_ */
@@ -39,6 +39,7 @@
  */
 #define EXEC_EXECVE 0x00000300  /* execve() */
 #define EXEC_BINDCAP 0x00000301 /* bind capability */
+#define EXEC_SPAWN 0x00000302   /* posix_spawn() */
 
 /*
  * Exec message
@@ -54,6 +55,31 @@ struct exec_msg
     char buf[ARG_MAX];     /* string for arg/env */
 };
 
+/*
+ * Spawn message
+ *
+ * The exec server creates a child of the sender, sets up its file
+ * descriptors, loads the program and starts it in one request.
+ * Child descriptor i is a copy of parent descriptor fds[i], or is
+ * closed if fds[i] is -1.  Descriptors from nfds up are inherited
+ * unchanged.
+ */
+struct spawn_msg
+{
+    struct msg_header hdr; /* message header */
+    char path[PATH_MAX];   /* program path */
+    char cwd[PATH_MAX];    /* current directory */
+    int argc;              /* number of argment string */
+    int envc;              /* number of environment string */
+    size_t bufsz;          /* size of buffer */
+    char buf[ARG_MAX];     /* string for arg/env */
+    int flags;             /* POSIX_SPAWN_xxx */
+    pid_t pgroup;          /* process group for POSIX_SPAWN_SETPGROUP */
+    pid_t pid;             /* pid of child (returned) */
+    int nfds;              /* number of entries in fds[] */
+    int fds[OPEN_MAX];     /* parent fd for each child fd */
+};
+
 /*
  * Capability bind message
  */
@@ -64,6 +90,6 @@ struct bind_msg
 };
 
 /* Max size of exec message */
-#define MAX_EXECMSG sizeof(struct exec_msg)
+#define MAX_EXECMSG sizeof(struct spawn_msg)
 
 #endif /* !_IPC_EXEC_H */
@@ -84,6 +84,9 @@
 #define FS_POLL_REGISTER 0x00000227
 #define FS_POLL_DEREGISTER 0x00000228
 #define FS_POLL_QUERY 0x00000229
+#define FS_SPAWN 0x0000022A
+#define FS_SPLICE 0x0000022B
+#define FS_EVENT_CTL 0x0000022C
 
 /*
  * Mount message
@@ -177,6 +180,39 @@ struct fcntl_msg
     struct flock lock;     /* file lock data */
 };
 
+/*
+ * Spawn message (from exec server)
+ *
+ * Creates the file data of a spawned task.  Child descriptor i is a
+ * copy of parent descriptor fds[i], or is closed if fds[i] is -1.
+ * If parent is zero, the data of the child is released instead.
+ */
+struct fdmap_msg
+{
+    struct msg_header hdr; /* message header */
+    task_t parent;         /* parent task */
+    task_t child;          /* child task */
+    int nfds;              /* number of entries in fds[] */
+    int fds[OPEN_MAX];     /* parent fd for each child fd */
+};
+
+/*
+ * Splice message (from network server)
+ *
+ * Reads size bytes at offset from descriptor fd of the owner task
+ * into buf of the sender, for sendfile().  The file offset of the
+ * owner is not changed.
+ */
+struct splice_msg
+{
+    struct msg_header hdr; /* message header */
+    task_t owner;          /* task which owns fd */
+    int fd;                /* file descriptor */
+    off_t offset;          /* file offset */
+    char* buf;             /* i/o buffer */
+    size_t size;           /* read size */
+};
+
 /*
  * Poll entry
  */
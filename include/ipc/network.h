@@ -28,6 +28,7 @@
 #define _IPC_NETWORK_H_
 
 #include <sys/types.h>
+#include <stddef.h>
 #include <sys/socket.h>
 #include <sys/poll.h>
 #include <ipc/ipc.h>
@@ -57,6 +58,11 @@
 #define NET_POLL_REGISTER 0x60f
 #define NET_POLL_DEREGISTER 0x610
 #define NET_POLL_QUERY    0x611
+#define NET_SENDFILE    0x612
+#define NET_EVENT_CTL   0x613
+#define NET_DNSCONF     0x614
+#define NET_DNSSTAT     0x615
+#define NET_EXIT        0x616
 
 struct net_ifinfo {
     char name[16];
@@ -68,6 +74,14 @@ struct net_ifinfo {
     int      index;
 };
 
+/*
+ * Socket data up to NET_INLINE bytes is carried in data[].  Larger
+ * buffers are passed by reference in buf, and the server maps them
+ * with vm_map().  Only NET_MSG_HDRSIZE bytes plus the inline data in
+ * use need to be sent.
+ */
+#define NET_INLINE      256
+
 struct net_msg {
     struct msg_header hdr;
     int domain;
@@ -79,7 +93,34 @@ struct net_msg {
     size_t len;
     struct sockaddr addr;
     socklen_t addrlen;
-    char data[2048];
+    void *buf;                 /* user buffer, or NULL for data[] */
+    int fd;                    /* file for sendfile */
+    off_t offset;              /* file offset for sendfile */
+    char data[NET_INLINE];
+};
+
+#define NET_MSG_HDRSIZE offsetof(struct net_msg, data)
+
+/*
+ * Name resolution
+ *
+ * NET_RESOLVE takes a host name in data[], and returns len IPv4
+ * addresses (network byte order) in data[].  ENOENT means the name
+ * does not exist.  NET_DNSCONF sets the name server to addr, or back
+ * to the one from DHCP if the port is 0, and flushes the cache; the
+ * caller needs CAP_NETWORK.
+ * NET_DNSSTAT returns struct net_dnsstat in data[].
+ */
+#define NET_MAXADDRS    8
+
+struct net_dnsstat {
+    u_long hits;               /* answered from the cache */
+    u_long neghits;            /* negative answers from the cache */
+    u_long misses;             /* a query was sent */
+    u_long joined;             /* waited for a query in progress */
+    u_long retries;            /* queries sent again */
+    u_long timeouts;           /* no answer */
+    u_long entries;            /* names in the cache */
 };
 
 /*
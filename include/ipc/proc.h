@@ -49,5 +49,6 @@
 #define PS_SETINIT 0x0000010D
 #define PS_REGISTER 0x0000010E
 #define PS_TRACE 0x0000010F
+#define PS_SPAWN 0x00000110
 
 #endif /* !_IPC_PROC_H */
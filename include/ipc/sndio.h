@@ -27,6 +27,7 @@
 #define SNDIO_STOP        0x00000307
 #define SNDIO_QUEUE_BUF   0x00000308
 #define SNDIO_BUF_READY   0x00000309 /* Callback from server to client */
+#define SNDIO_GET_STATS   0x0000030a
 
 /*
  * Buffer states
@@ -79,6 +80,30 @@ struct sndio_queue_msg {
     int buf_id;     /* ID of the buffer to queue */
 };
 
+/*
+ * Mixer statistics
+ */
+#define SNDIO_HIST_SIZE 8
+
+struct sndio_stats {
+    u_int period;       /* mixing period (msec) */
+    u_int nblks;        /* blocks queued to the device */
+    u_int cycles;       /* mixing cycles run */
+    u_int late;         /* cycles that missed their deadline */
+    u_int underruns;    /* times the device ran out of data */
+    u_int mix_hist[SNDIO_HIST_SIZE]; /* mix time: 0, 1, 2-3, 4-7, ... msec */
+    u_int lat_avg;      /* average latency from queueing to output (msec) */
+    u_int lat_max;      /* maximum latency (msec) */
+};
+
+/*
+ * Statistics message
+ */
+struct sndio_stats_msg {
+    struct msg_header hdr;
+    struct sndio_stats stats;
+};
+
 /* Max size of sndio message */
 #define MAX_SNDIOMSG sizeof(struct sndio_params_msg)
 
@@ -101,6 +101,16 @@ struct audio_info {
     u_int   backlog;             /* Samples of output backlog to generate */
 };
 
+/*
+ * Playback statistics
+ */
+struct audio_stats {
+    u_int   blocks;         /* blocks played */
+    u_int   underruns;      /* times the hardware ran out of data */
+    u_int   queued;         /* blocks queued to the hardware */
+    u_int   blocksize;      /* current block size */
+};
+
 /*
  * IOCTLs for /dev/audio and /dev/sound
  */
@@ -108,6 +118,7 @@ struct audio_info {
 #define AUDIO_SETINFO   _IOWR('A', 2, struct audio_info)
 #define AUDIO_DRAIN     _IO('A', 3)
 #define AUDIO_FLUSH     _IO('A', 4)
+#define AUDIO_GETSTATS  _IOR('A', 5, struct audio_stats)
 
 /*
  * Playback/record modes
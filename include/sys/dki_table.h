@@ -77,8 +77,9 @@
     DO(36, dbgctl, DKI_INT_DBGCTL)                                                                                     \
     DO(37, uart_lock, hal_uart_lock)                                                                                   \
     DO(38, uart_unlock, hal_uart_unlock)                                                                               \
-    DO(39, ksem_post, ksem_post)
+    DO(39, ksem_post, ksem_post)                                                                                       \
+    DO(40, irq_setaffinity, irq_setaffinity)
 
-#define MAX_DKI 40
+#define MAX_DKI 41
 
 #endif /* !_SYS_DKI_TABLE_H */
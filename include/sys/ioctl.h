@@ -110,6 +110,14 @@ struct __timeval
     long tv_usec; /* and microseconds */
 };
 
+/*
+ * RAM disk I/O control code
+ *
+ * A RAM disk can be read at any length from any block, so a
+ * file system may read it directly instead of block by block.
+ */
+#define RDIOC_GET_SIZE _IOR('r', 0, size_t) /* get image size */
+
 __BEGIN_DECLS
 int ioctl(int, unsigned long, ...);
 __END_DECLS
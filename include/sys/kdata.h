@@ -0,0 +1,66 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _SYS_KDATA_H
+#define _SYS_KDATA_H
+
+#include <sys/types.h>
+#include <sys/param.h>
+
+/*
+ * Kernel data pages.
+ *
+ * On MMU systems the kernel maps two read-only pages at the top
+ * of every user address space. The first one is shared by all
+ * tasks and publishes the system time; the second one belongs to
+ * the task (or the tasks sharing its map) and holds the POSIX
+ * identity set by the process server.
+ *
+ * Readers sample the sequence counter, copy the fields, and retry
+ * if the counter was odd or has changed in the meantime.
+ */
+#define KDATA_BASE (USERLIMIT - 2 * PAGE_SIZE) /* struct kdata */
+#define KDATA_TASK (USERLIMIT - PAGE_SIZE)     /* struct kdata_task */
+
+struct kdata
+{
+    volatile u_int seq;    /* sequence counter, odd while updating */
+    int hz;                /* clock frequency */
+    int ncpus;             /* number of running CPUs */
+    volatile u_long ticks; /* ticks since boot */
+};
+
+struct kdata_task
+{
+    volatile u_int seq; /* sequence counter, odd while updating */
+    pid_t pid;          /* process id */
+    pid_t ppid;         /* parent process id */
+};
+
+#endif /* !_SYS_KDATA_H */
@@ -104,6 +104,7 @@ typedef struct mount* mount_t;
 #define MNT_LOCAL 0x00001000  /* filesystem is stored locally */
 #define MNT_QUOTA 0x00002000  /* quotas are enabled on filesystem */
 #define MNT_ROOTFS 0x00004000 /* identifies the root filesystem */
+#define MNT_NOCACHE 0x00008000 /* don't cache names in lookup */
 
 /*
  * Mask of flags that are visible to statfs()
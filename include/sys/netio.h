@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _SYS_NETIO_H_
+#define _SYS_NETIO_H_
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+
+/*
+ * Batched receive.
+ *
+ * NETIO_RXBATCH waits for at least one frame, then copies as many
+ * whole frames as fit into buf.  Each frame is stored as a struct
+ * net_frame followed by the frame data, and the next frame starts at
+ * the following 4-byte boundary.  On return, size holds the number
+ * of bytes used and nframes the number of frames.
+ */
+struct net_frame {
+    u_short nf_len;     /* frame length */
+    u_short nf_pad;
+};
+
+#define NET_FRAME_SIZE(len) \
+    ((sizeof(struct net_frame) + (size_t)(len) + 3) & ~(size_t)3)
+
+struct net_rxbatch {
+    char    *buf;       /* frame buffer */
+    size_t  size;       /* buffer size / bytes used */
+    int     nframes;    /* frames returned */
+};
+
+/*
+ * Receive statistics
+ */
+struct net_stats {
+    u_int   intrs;      /* receive interrupts */
+    u_int   polls;      /* poll passes that found frames */
+    u_int   frames;     /* frames received */
+    u_int   max_batch;  /* most frames found by one poll */
+    u_int   stalls;     /* polls stopped because the queue was full */
+    u_int   reads;      /* read requests */
+};
+
+/*
+ * IOCTLs for network devices
+ */
+#define NETIO_RXBATCH   _IOWR('N', 1, struct net_rxbatch)
+#define NETIO_GETSTATS  _IOR('N', 2, struct net_stats)
+
+#endif /* !_SYS_NETIO_H_ */
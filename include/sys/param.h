@@ -70,6 +70,7 @@
 #define MAXDEVNAME 12  /* max device name */
 #define MAXOBJNAME 16  /* max object name */
 #define MAXEVTNAME 12  /* max event name */
+#define MAXLOCKNAME 12 /* max lock name */
 
 #define HZ CONFIG_HZ   /* ticks per second */
 #define MAXIRQS 256    /* max number of irq line */
@@ -95,6 +96,7 @@
 #define PRI_EXEC 125 /* exec server */
 #define PRI_FS 126   /* file system server */
 #define PRI_POW 100  /* power server */
+#define PRI_SNDIO 90 /* sound server mixer */
 
 #ifndef NULL
 #if !defined(__cplusplus)
@@ -33,11 +33,19 @@
 
 #include <sys/types.h>
 
+/*
+ * Descriptors which are not handled by the fs server
+ */
+#define SOCKET_FDBASE 1024 /* sockets of the network server */
+#define EPOLL_FDBASE 4096  /* epoll instances */
+
 extern object_t __proc_obj;
 extern object_t __fs_obj;
 
 __BEGIN_DECLS
 int __posix_call(object_t, void*, size_t, int);
+int __sock_close(int);
+int __epoll_close(int);
 __END_DECLS
 
 #endif /* KERNEL */
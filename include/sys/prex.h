@@ -91,6 +91,7 @@ int task_resume(task_t task);
 int task_setname(task_t task, const char* name);
 int task_setcap(task_t task, cap_t cap);
 int task_chkcap(task_t task, cap_t cap);
+int task_setpid(task_t task, pid_t pid, pid_t ppid);
 
 int thread_create(task_t task, thread_t* tp);
 int thread_terminate(thread_t t);
@@ -104,6 +105,8 @@ int thread_getpri(thread_t t, int* pri);
 int thread_setpri(thread_t t, int pri);
 int thread_getpolicy(thread_t t, int* policy);
 int thread_setpolicy(thread_t t, int policy);
+int thread_setaffinity(thread_t t, u_int mask);
+int thread_getaffinity(thread_t t, u_int* mask);
 
 int vm_allocate(task_t task, void** addr, size_t size, int anywhere);
 int vm_free(task_t task, void* addr);
@@ -155,6 +158,8 @@ void sys_panic(const char* msg);
 int sys_info(int type, void* buf);
 int sys_time(u_long* ticks);
 int sys_debug(int cmd, void* data);
+int sys_trace(int cmd, void* data);
+int sys_prof(int cmd, void* data);
 
 #include <sys/backtrace.h>
 
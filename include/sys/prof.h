@@ -0,0 +1,71 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _SYS_PROF_H
+#define _SYS_PROF_H
+
+#include <sys/types.h>
+
+/*
+ * Profile sample count for a program counter of a thread
+ */
+struct prof_entry
+{
+    uint32_t pc;     /* interrupted program counter */
+    uint32_t thread; /* thread id */
+    uint32_t task;   /* task id */
+    uint32_t count;  /* number of samples */
+    uint32_t flags;  /* PROF_xxx */
+};
+
+#define PROF_USER 0x01    /* pc is in user mode */
+#define PROF_UNKNOWN 0x02 /* pc is not known */
+
+/*
+ * Commands for sys_prof()
+ */
+#define PROF_START 1 /* clear and start sampling every data ticks */
+#define PROF_STOP 2  /* stop sampling */
+#define PROF_READ 3  /* read entries of one CPU */
+
+/*
+ * Argument for PROF_READ
+ */
+struct prof_read
+{
+    int cpu;                    /* in: CPU number */
+    int index;                  /* in/out: table index to read from */
+    int count;                  /* in: buffer size, out: entries read */
+    struct prof_entry* entries; /* in: buffer */
+    u_int samples;              /* out: samples taken */
+    u_int dropped;              /* out: samples not recorded */
+    int period;                 /* out: ticks per sample */
+};
+
+#endif /* !_SYS_PROF_H */
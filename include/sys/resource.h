@@ -32,6 +32,8 @@
 #ifndef _SYS_RESOURCE_H_
 #define _SYS_RESOURCE_H_
 
+#include <sys/time.h>
+
 /*
  * Process priority specifications to get/setpriority.
  */
@@ -59,6 +61,33 @@
 
 #define RLIM_INFINITY (((u_long)1 << 31) - 1)
 
+/*
+ * Resource utilization information.
+ */
+#define RUSAGE_SELF 0
+#define RUSAGE_CHILDREN -1
+#define RUSAGE_THREAD 1 /* calling thread only */
+
+struct rusage
+{
+    struct timeval ru_utime; /* user time used */
+    struct timeval ru_stime; /* system time used */
+    long ru_maxrss;          /* max resident set size */
+    long ru_ixrss;           /* integral shared memory size */
+    long ru_idrss;           /* integral unshared data " */
+    long ru_isrss;           /* integral unshared stack " */
+    long ru_minflt;          /* page reclaims */
+    long ru_majflt;          /* page faults */
+    long ru_nswap;           /* swaps */
+    long ru_inblock;         /* block input operations */
+    long ru_oublock;         /* block output operations */
+    long ru_msgsnd;          /* messages sent */
+    long ru_msgrcv;          /* messages received */
+    long ru_nsignals;        /* signals received */
+    long ru_nvcsw;           /* voluntary context switches */
+    long ru_nivcsw;          /* involuntary " */
+};
+
 struct rlimit
 {
     rlim_t rlim_cur; /* current (soft) limit */
@@ -72,6 +101,7 @@ int getpriority(int, int);
 int setpriority(int, int, int);
 int getrlimit(int, struct rlimit*);
 int setrlimit(int, const struct rlimit*);
+int getrusage(int, struct rusage*);
 __END_DECLS
 
 #endif /* !_SYS_RESOURCE_H_ */
@@ -89,6 +89,11 @@ struct in_addr {
     in_addr_t s_addr;
 };
 
+#ifndef INADDR_ANY
+#define INADDR_ANY      ((in_addr_t)0x00000000)
+#define INADDR_LOOPBACK ((in_addr_t)0x7f000001)
+#endif
+
 struct sockaddr_in {
     u_char          sin_len;
     u_char          sin_family;
@@ -117,6 +122,7 @@ struct hostent {
 #define EAI_NONAME      3
 #define EAI_SERVICE     4
 #define EAI_FAIL        5
+#define EAI_AGAIN       6
 
 #define HOST_NOT_FOUND  1
 
@@ -258,10 +264,14 @@ ssize_t recv(int, void *, size_t, int);
 ssize_t recvfrom(int, void *, size_t, int, struct sockaddr *, socklen_t *);
 ssize_t send(int, const void *, size_t, int);
 ssize_t sendto(int, const void *, size_t, int, const struct sockaddr *, socklen_t);
+ssize_t sendfile(int, int, off_t *, size_t);
 int setsockopt(int, int, int, const void *, socklen_t);
 int shutdown(int, int);
 int socket(int, int, int);
 struct hostent *gethostbyname(const char *);
+int getaddrinfo(const char *, const char *, const struct addrinfo *, struct addrinfo **);
+void freeaddrinfo(struct addrinfo *);
+const char *gai_strerror(int);
 __END_DECLS
 
 #endif /* !_SYS_SOCKET_H_ */
@@ -95,7 +95,12 @@
     DO(sys_time, 1) \
     DO(sys_debug, 2) \
     DO(device_gather_read, 4) \
-    DO(device_scatter_write, 4)
+    DO(device_scatter_write, 4) \
+    DO(task_setpid, 3) \
+    DO(thread_setaffinity, 2) \
+    DO(thread_getaffinity, 2) \
+    DO(sys_trace, 2) \
+    DO(sys_prof, 2)
 
 /*
  * Define SYS_xxx constants.
@@ -162,7 +167,12 @@
 #define SYS_sys_debug 59
 #define SYS_device_gather_read 60
 #define SYS_device_scatter_write 61
+#define SYS_task_setpid 62
+#define SYS_thread_setaffinity 63
+#define SYS_thread_getaffinity 64
+#define SYS_sys_trace 65
+#define SYS_sys_prof 66
 
-#define MAX_SYSCALL 62
+#define MAX_SYSCALL 67
 
 #endif /* !_SYS_SYSCALL_H */
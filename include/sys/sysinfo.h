@@ -41,7 +41,7 @@
  * Please make sure MAXINFOSZ is still correct if you change
  * the information structure below.
  */
-#define MAXINFOSZ sizeof(struct kerninfo)
+#define MAXINFOSZ sizeof(struct irqinfo)
 
 /*
  * Data type for sys_info()
@@ -54,6 +54,10 @@
 #define INFO_VM 6
 #define INFO_DEVICE 7
 #define INFO_IRQ 8
+#define INFO_LOCK 9
+#define INFO_TIMERQ 10
+#define INFO_CPU 11
+#define INFO_USAGE 12
 
 /*
  * Kernel information
@@ -78,6 +82,28 @@ struct meminfo
     psize_t bootdisk; /* total size of boot disk */
 };
 
+/*
+ * CPU time
+ */
+struct cputime
+{
+    u_long sec;  /* seconds */
+    u_long usec; /* microseconds */
+};
+
+/*
+ * CPU usage of a thread or a task
+ */
+struct cpuusage
+{
+    struct cputime utime; /* time in user mode */
+    struct cputime stime; /* time in kernel mode */
+    struct cputime itime; /* time in interrupts taken while running */
+    struct cputime wtime; /* time waiting on a run queue */
+    u_long nvcsw;         /* voluntary context switches */
+    u_long nivcsw;        /* involuntary context switches */
+};
+
 /*
  * Thread information
  */
@@ -95,6 +121,7 @@ struct threadinfo
     int active;                 /* true if active thread */
     char taskname[MAXTASKNAME]; /* task name */
     char slpevt[MAXEVTNAME];    /* sleep event */
+    struct cpuusage usage;      /* CPU usage */
 };
 
 /*
@@ -111,6 +138,7 @@ struct taskinfo
     int nthreads;               /* number of threads */
     int active;                 /* true if active task */
     char taskname[MAXTASKNAME]; /* task name */
+    struct cpuusage usage;      /* CPU usage, including exited threads */
 };
 
 /*
@@ -118,12 +146,13 @@ struct taskinfo
  */
 struct vminfo
 {
-    u_long cookie; /* index cookie */
-    task_t task;   /* task id */
-    vaddr_t virt;  /* virtual address */
-    size_t size;   /* size */
-    int flags;     /* region flag */
-    paddr_t phys;  /* physical address */
+    u_long cookie;   /* index cookie */
+    task_t task;     /* task id */
+    vaddr_t virt;    /* virtual address */
+    size_t size;     /* size */
+    int flags;       /* region flag */
+    paddr_t phys;    /* physical address */
+    size_t resident; /* size backed by physical pages */
 };
 
 /* Flags for vm */
@@ -132,6 +161,7 @@ struct vminfo
 #define VF_EXEC 0x00000004
 #define VF_SHARED 0x00000008
 #define VF_MAPPED 0x00000010
+#define VF_LAZY 0x00000020
 #define VF_FREE 0x00000080
 
 /*
@@ -155,17 +185,85 @@ struct timerinfo
     u_long idleticks; /* total idle ticks */
 };
 
+/*
+ * Per-CPU timer queue information
+ */
+#define NTIMERLATE 4 /* lateness buckets: 0, 1, 2 and more ticks */
+
+struct timerqinfo
+{
+    int cookie;                /* index cookie */
+    int cpu;                   /* CPU number */
+    u_int active;              /* timers queued now */
+    u_long expired;            /* one-shot timers expired */
+    u_long periodic;           /* periodic timers expired */
+    u_long migrated;           /* timers moved in from other CPUs */
+    u_long late[NTIMERLATE];   /* expirations by lateness in ticks */
+};
+
 /*
  * IRQ information
  */
+#define IRQ_HISTSIZE 32 /* log2 buckets of cycles: bucket n is [2^n, 2^(n+1)) */
+
 struct irqinfo
 {
-    int cookie;      /* index cookie */
-    int vector;      /* vector number */
-    u_int count;     /* interrupt count */
-    int priority;    /* interrupt priority */
-    int istreq;      /* pending ist request */
-    thread_t thread; /* thread id of ist */
+    int cookie;              /* index cookie */
+    int vector;              /* vector number */
+    u_int count;             /* interrupt count */
+    int priority;            /* interrupt priority */
+    int istreq;              /* pending ist request */
+    thread_t thread;         /* thread id of ist */
+    int cpu;                 /* CPU the interrupt is routed to */
+    u_int istcount;          /* number of IST runs */
+    uint32_t cyclehz;        /* rate of the cycle counter */
+    uint32_t lat_max;        /* max ISR to IST latency in cycles */
+    uint32_t run_max;        /* max IST run time in cycles */
+    u_int lat[IRQ_HISTSIZE]; /* latency histogram */
+    u_int run[IRQ_HISTSIZE]; /* run time histogram */
+};
+
+/*
+ * Per-CPU scheduling statistics
+ */
+struct cpuinfo
+{
+    int cookie;           /* index cookie */
+    int cpu;              /* CPU number */
+    int online;           /* true if the CPU is running */
+    thread_t active;      /* running thread */
+    u_int nswitch;        /* number of thread switches */
+    u_int nmigrate;       /* threads pulled from another CPU */
+    u_int nirq;           /* interrupts handled */
+    u_int ticks;          /* clock ticks */
+    u_int idleticks;      /* clock ticks spent idle */
+    struct cputime itime; /* time in interrupt handlers */
+    u_int nacct;          /* CPU accounting updates */
+    struct cputime acct;  /* time spent in accounting updates */
+};
+
+/*
+ * CPU usage of the calling thread
+ */
+struct usageinfo
+{
+    struct cpuusage thread; /* calling thread */
+    struct cpuusage task;   /* its task, including exited threads */
+};
+
+/*
+ * Spinlock statistics
+ */
+struct lockinfo
+{
+    int cookie;             /* index cookie */
+    void* addr;             /* lock address */
+    char name[MAXLOCKNAME]; /* lock name */
+    u_long acquired;        /* number of acquisitions */
+    u_long contended;       /* acquisitions that had to wait */
+    u_long spins;           /* total wait loop iterations */
+    uint64_t holdcycles;    /* total hold time in CPU cycles */
+    u_long maxholdcycles;   /* longest hold time in CPU cycles */
 };
 
 #endif /* !_SYS_SYSINFO_H */
@@ -64,6 +64,14 @@ struct timespec
         (tv)->tv_usec = (ts)->ts_nsec / 1000;                                                                          \
     }
 
+/*
+ * Clocks for clock_gettime()
+ */
+#define CLOCK_REALTIME 0           /* time of day */
+#define CLOCK_MONOTONIC 1          /* time since boot */
+#define CLOCK_PROCESS_CPUTIME_ID 2 /* CPU time of the calling task */
+#define CLOCK_THREAD_CPUTIME_ID 3  /* CPU time of the calling thread */
+
 struct timezone
 {
     int tz_minuteswest; /* minutes west of Greenwich */
@@ -117,6 +125,8 @@ struct clockinfo
 
 __BEGIN_DECLS
 int gettimeofday(struct timeval*, struct timezone*);
+int clock_gettime(clockid_t, struct timespec*);
+int clock_getres(clockid_t, struct timespec*);
 #if 0
 int	adjtime(const struct timeval *, struct timeval *);
 int	getitimer(int, struct itimerval *);
@@ -0,0 +1,84 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _SYS_TRACE_H
+#define _SYS_TRACE_H
+
+#include <sys/types.h>
+
+/*
+ * Kernel trace events
+ */
+#define TR_SWTCH 0    /* context switch: next thread, previous state */
+#define TR_SYSENTER 1 /* system call entry: number, first argument */
+#define TR_SYSEXIT 2  /* system call exit: number, return value */
+#define TR_MSGSEND 3  /* msg_send: object, message code */
+#define TR_MSGRECV 4  /* msg_receive: object, sender thread */
+#define TR_MSGREPLY 5 /* msg_reply: object, sender thread */
+#define TR_IRQENTER 6 /* interrupt entry: vector, 0 */
+#define TR_IRQEXIT 7  /* interrupt exit: vector, ISR result */
+#define TR_PGFAULT 8  /* page fault: address, result */
+#define TR_TIMER 9    /* timer expiry: timer, ticks late */
+#define NTRACE 10
+
+#define TRACE_ALL ((1U << NTRACE) - 1)
+
+/*
+ * Trace record
+ */
+struct trace_event
+{
+    uint32_t time;   /* clock_cycles() */
+    uint32_t tick;   /* timer ticks */
+    uint32_t thread; /* current thread */
+    uint16_t type;   /* TR_xxx */
+    uint16_t cpu;    /* CPU number */
+    uint32_t arg[2]; /* event arguments */
+};
+
+/*
+ * Commands for sys_trace()
+ */
+#define TRACE_START 1 /* enable events in the mask */
+#define TRACE_STOP 2  /* disable all events */
+#define TRACE_READ 3  /* drain events of one CPU */
+
+/*
+ * Argument for TRACE_READ
+ */
+struct trace_read
+{
+    int cpu;                    /* in: CPU number */
+    int count;                  /* in: buffer size, out: events read */
+    struct trace_event* events; /* in: buffer */
+    u_int lost;                 /* out: events overwritten since last read */
+    uint32_t cyclehz;           /* out: rate of the time stamp */
+};
+
+#endif /* !_SYS_TRACE_H */
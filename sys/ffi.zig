@@ -42,6 +42,18 @@ pub const smp = struct {
     pub const activate = smp_activate;
     pub const get_cpu_control = c.hal_get_cpu_control;
     pub const processor_id = c.smp_processor_id;
+    pub const lockstat_register = c.lockstat_register;
+    pub const lockstat_info = c.lockstat_info;
+    pub const cpu_info = c.cpu_info;
+
+    pub extern var cpu_table: [1]c.struct_cpu_control;
+
+    pub inline fn curcpu() *c.struct_cpu_control {
+        if (comptime @hasDecl(c, "CONFIG_SMP")) {
+            return @ptrCast(c.hal_get_cpu_control());
+        }
+        return &cpu_table[0];
+    }
 };
 
 pub const thread = struct {
@@ -64,6 +76,8 @@ pub const thread = struct {
     pub const idle = c.thread_idle;
     pub const valid = c.thread_valid;
     pub const schedparam = c.thread_schedparam;
+    pub const setaffinity = c.thread_setaffinity;
+    pub const getaffinity = c.thread_getaffinity;
     pub const syscall_ret = c.syscall_ret;
 };
 
@@ -85,6 +99,9 @@ pub const sched = struct {
     pub fn wakeup(ev: *sync.Event) callconv(.c) void {
         c.sched_wakeup(@ptrCast(ev));
     }
+    pub fn wakeist(ev: *sync.Event) callconv(.c) void {
+        c.sched_wakeist(@ptrCast(ev));
+    }
     pub const unsleep = c.sched_unsleep;
     pub fn wakeone(ev: *sync.Event) callconv(.c) c.thread_t {
         return c.sched_wakeone(@ptrCast(ev));
@@ -111,6 +128,52 @@ pub const system = struct {
     pub const init = c.sys_init;
 };
 
+pub const trace = struct {
+    pub const sys = c.sys_trace;
+    pub const SWTCH = c.TR_SWTCH;
+    pub const SYSENTER = c.TR_SYSENTER;
+    pub const SYSEXIT = c.TR_SYSEXIT;
+    pub const MSGSEND = c.TR_MSGSEND;
+    pub const MSGRECV = c.TR_MSGRECV;
+    pub const MSGREPLY = c.TR_MSGREPLY;
+    pub const IRQENTER = c.TR_IRQENTER;
+    pub const IRQEXIT = c.TR_IRQEXIT;
+    pub const PGFAULT = c.TR_PGFAULT;
+    pub const TIMER = c.TR_TIMER;
+
+    // Same as the TRACE() macro: only a load and a branch while off.
+    pub inline fn event(tr_type: c_int, a0: u32, a1: u32) void {
+        if (c.trace_mask & (@as(c_uint, 1) << @intCast(tr_type)) != 0) {
+            c.trace_log(tr_type, a0, a1);
+        }
+    }
+};
+
+pub const prof = struct {
+    pub const sys = c.sys_prof;
+
+    // Same as the PROF_TICK() macro.
+    pub inline fn tick() void {
+        if (c.prof_period != 0) {
+            c.prof_tick();
+        }
+    }
+};
+
+pub const acct = struct {
+    pub const @"switch" = c.acct_switch;
+    pub const ready = c.acct_ready;
+    pub const tick = c.acct_tick;
+    pub const mode = c.acct_mode;
+    pub const irqenter = c.acct_irqenter;
+    pub const irqexit = c.acct_irqexit;
+    pub const exit = c.acct_exit;
+    pub const thread = c.acct_thread;
+    pub const task = c.acct_task;
+    pub const info = c.acct_info;
+    pub const cpu = c.acct_cpu;
+};
+
 pub const task = struct {
     pub const valid = c.task_valid;
     pub const access = c.task_access;
@@ -126,11 +189,13 @@ pub const task = struct {
     pub const setname = c.task_setname;
     pub const setcap = c.task_setcap;
     pub const chkcap = c.task_chkcap;
+    pub const setpid = c.task_setpid;
     pub const cleanup = c.task_cleanup;
 };
 
 pub const page = struct {
     pub const alloc = c.page_alloc;
+    pub const alloc_aligned = c.page_alloc_aligned;
     pub const free = c.page_free;
     pub const reserve = c.page_reserve;
     pub const init = c.page_init;
@@ -151,6 +216,7 @@ pub const vm = struct {
     pub const free = c.vm_free;
     pub const attribute = c.vm_attribute;
     pub const map = c.vm_map;
+    pub const kdata = c.vm_kdata;
 };
 
 pub const timer = struct {
@@ -159,6 +225,7 @@ pub const timer = struct {
     pub const init = c.timer_init;
     pub const cancel = c.timer_cancel;
     pub const info = c.timer_info;
+    pub const queue_info = c.timerq_info;
     pub const ticks = c.timer_ticks;
     pub const delay = c.timer_delay;
     pub const hztoms = c.hztoms;
@@ -173,6 +240,7 @@ pub const timer = struct {
 pub const irq = struct {
     pub const attach = c.irq_attach;
     pub const detach = c.irq_detach;
+    pub const setaffinity = c.irq_setaffinity;
     pub const init = c.irq_init;
     pub const info = c.irq_info;
     pub const handler = c.irq_handler;
@@ -289,6 +357,8 @@ pub const hal = struct {
 
     pub const clock_init = c.clock_init;
     pub const clock_ap_init = c.clock_ap_init;
+    pub const clock_cycles = c.clock_cycles;
+    pub const clock_cyclehz = c.clock_cyclehz;
 
     pub const diag_init = c.diag_init;
     pub const diag_puts = c.diag_puts;
@@ -298,6 +368,7 @@ pub const hal = struct {
     pub const interrupt_setup = c.interrupt_setup;
     pub const interrupt_mask = c.interrupt_mask;
     pub const interrupt_unmask = c.interrupt_unmask;
+    pub const interrupt_setaffinity = c.interrupt_setaffinity;
 
     pub const hal_cpu_id = c.hal_cpu_id;
     pub const hal_cpu_start = c.hal_cpu_start;
@@ -356,7 +427,11 @@ pub const hal = struct {
     pub const VmInfo = c.struct_vminfo;
     pub const DeviceInfo = c.struct_devinfo;
     pub const IrqInfo = c.struct_irqinfo;
+    pub const UsageInfo = c.struct_usageinfo;
+    pub const LockInfo = c.struct_lockinfo;
+    pub const CpuInfo = c.struct_cpuinfo;
     pub const TimerInfo = c.struct_timerinfo;
+    pub const TimerqInfo = c.struct_timerqinfo;
     pub const RiscvCpu = c.struct_riscv_cpu;
     pub const KernInfo = c.struct_kerninfo;
     pub const Object = c.struct_object;
@@ -397,6 +472,7 @@ pub const hal = struct {
     pub const MAXDEVNAME = c.MAXDEVNAME;
     pub const MAXEVTNAME = c.MAXEVTNAME;
     pub const MAXIRQS = c.MAXIRQS;
+    pub const IRQ_HISTSIZE = c.IRQ_HISTSIZE;
     pub const MAXMEM = c.MAXMEM;
     pub const MAXOBJECTS = c.MAXOBJECTS;
     pub const MAXOBJNAME = c.MAXOBJNAME;
@@ -422,11 +498,15 @@ pub const hal = struct {
     pub const INFO_DEVICE = c.INFO_DEVICE;
     pub const INFO_IRQ = c.INFO_IRQ;
     pub const INFO_KERNEL = c.INFO_KERNEL;
+    pub const INFO_LOCK = c.INFO_LOCK;
     pub const INFO_MEMORY = c.INFO_MEMORY;
     pub const INFO_TASK = c.INFO_TASK;
     pub const INFO_THREAD = c.INFO_THREAD;
     pub const INFO_TIMER = c.INFO_TIMER;
+    pub const INFO_TIMERQ = c.INFO_TIMERQ;
     pub const INFO_VM = c.INFO_VM;
+    pub const INFO_USAGE = c.INFO_USAGE;
+    pub const INFO_CPU = c.INFO_CPU;
     pub const MAXINFOSZ = c.MAXINFOSZ;
 
     // Constants from include/sys/ipl.h
@@ -436,6 +516,7 @@ pub const hal = struct {
     pub const INTSTKTOP = c.INTSTKTOP;
     pub const KERNOFFSET = c.KERNOFFSET;
     pub const PAGE_SIZE = c.PAGE_SIZE;
+    pub const SPAGE_SIZE = if (@hasDecl(c, "SPAGE_SIZE")) c.SPAGE_SIZE else 0;
     pub const USERLIMIT = c.USERLIMIT;
 
     // Constants from sys/include/deadlock.h
@@ -451,7 +532,7 @@ pub const hal = struct {
     pub const NEXC = c.NEXC;
 
     // Constants from sys/include/smp.h
-    pub const SPINLOCK_INITIALIZER = c.SPINLOCK_INITIALIZER;
+    pub const SPINLOCK_INITIALIZER = std.mem.zeroes(c.spinlock_t);
 
     // Spinlock with inline methods (moved from sys/kern/timer.zig)
     pub const Spinlock = extern struct {
@@ -566,6 +647,7 @@ pub const kern = struct {
     pub const Register = c.register_t;
     pub const QueueRef = c.queue_t;
     pub const Cap = c.cap_t;
+    pub const Pid = c.pid_t;
     pub const Uint = c.u_int;
     pub const Ulong = c.u_long;
     pub const Vaddr = c.vaddr_t;
@@ -592,15 +674,24 @@ pub const kern = struct {
         ist: ?*const fn (?*anyopaque) callconv(.c) void,
         data: ?*anyopaque,
         priority: c_int,
+        cpu: c_int,
         count: Uint,
         istreq: c_int,
         thread: ThreadRef,
         istevt: sync.Event,
+        stamped: c_int,
+        stamp: u32,
+        istcount: Uint,
+        lat_max: u32,
+        run_max: u32,
+        lat: [hal.IRQ_HISTSIZE]Uint,
+        run: [hal.IRQ_HISTSIZE]Uint,
     };
 
     pub const Timer = extern struct {
         link: hal.List,
         state: c_int,
+        cpu: c_int,
         expire: Ulong,
         interval: Ulong,
         func: ?*const fn (?*anyopaque) callconv(.c) void,
@@ -680,6 +771,7 @@ pub const kern = struct {
 pub const mem = struct {
     // Constants from sys/include/vm.h (VM segment flags)
     pub const SEG_FREE = c.SEG_FREE;
+    pub const SEG_LAZY = c.SEG_LAZY;
     pub const SEG_MAPPED = c.SEG_MAPPED;
     pub const SEG_READ = c.SEG_READ;
     pub const SEG_SHARED = c.SEG_SHARED;
@@ -701,8 +793,16 @@ pub const mem = struct {
         refcnt: c_int,
         pgd: kern.Pgd,
         total: usize,
+        kdata: kern.Paddr,
     };
 
+    // Kernel data pages from include/sys/kdata.h
+    pub const KData = c.struct_kdata;
+    pub const KDataTask = c.struct_kdata_task;
+    pub const KDATA_BASE = hal.USERLIMIT - 2 * hal.PAGE_SIZE;
+    pub const KDATA_TASK = hal.USERLIMIT - hal.PAGE_SIZE;
+    pub extern var kdata: [*c]c.struct_kdata;
+
     comptime {
         std.debug.assert(@sizeOf(Segment) == @sizeOf(c.struct_seg));
         std.debug.assert(@sizeOf(VmMap) == @sizeOf(c.struct_vm_map));
@@ -0,0 +1,64 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _ACCT_H
+#define _ACCT_H
+
+#include <types.h>
+#include <sys/cdefs.h>
+#include <sys/sysinfo.h>
+
+/*
+ * CPU accounting of a thread or a task, in clock cycles.
+ */
+struct cpuacct
+{
+    uint64_t utime; /* cycles in user mode */
+    uint64_t stime; /* cycles in kernel mode */
+    uint64_t itime; /* cycles in interrupts taken while running */
+    uint64_t wtime; /* cycles waiting on a run queue */
+    u_long nvcsw;   /* voluntary switches */
+    u_long nivcsw;  /* involuntary switches */
+};
+
+__BEGIN_DECLS
+void acct_switch(thread_t, thread_t);
+void acct_ready(thread_t);
+void acct_tick(void);
+int acct_mode(int);
+void acct_irqenter(uint32_t);
+void acct_irqexit(void);
+void acct_exit(thread_t);
+void acct_thread(thread_t, struct cpuusage*);
+void acct_task(task_t, struct cpuusage*);
+void acct_cpu(int, struct cpuinfo*);
+int acct_info(struct usageinfo*);
+__END_DECLS
+
+#endif /* !_ACCT_H */
@@ -41,7 +41,14 @@ struct cpu_control
     int spl_level;                /* current spl level */
     void* int_stack;              /* interrupt stack */
     int cpu_id;                   /* CPU identifier */
-    long padding[10];             /* Pad to 64 bytes (cache line) */
+    u_int bkl_ticket;             /* BKL ticket being waited on */
+    int bkl_wait;                 /* true if bkl_ticket is valid */
+    u_int nswitch;                /* number of thread switches */
+    u_int nmigrate;               /* threads pulled from another CPU */
+    u_int nirq;                   /* interrupts handled */
+    u_int ticks;                  /* clock ticks */
+    u_int idleticks;              /* clock ticks spent idle */
+    long padding[3];              /* Pad to 64 bytes (cache line) */
 } __attribute__((aligned(64)));
 
 #endif /* !_CPU_CONTROL_H */
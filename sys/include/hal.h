@@ -123,6 +123,7 @@ void interrupt_mask(int);
 void interrupt_unmask(int, int);
 void interrupt_setup(int, int);
 void interrupt_init(void);
+int interrupt_pc(vaddr_t*);
 
 void machine_startup(void);
 void machine_idle(void);
@@ -132,9 +133,12 @@ void machine_bootinfo(struct bootinfo**);
 
 void clock_init(void);
 void clock_ap_init(void);
+uint32_t clock_cycles(void);
+uint32_t clock_cyclehz(void);
 
 int hal_cpu_start(uint32_t, paddr_t);
 void hal_cpu_send_ipi(uint32_t, uint32_t);
+int interrupt_setaffinity(int, int);
 void interrupt_cpu_init(void);
 
 #ifdef DEBUG
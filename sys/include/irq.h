@@ -38,15 +38,23 @@
 
 struct irq
 {
-    int vector;          /* vector number */
-    int (*isr)(void*);   /* pointer to isr */
-    void (*ist)(void*);  /* pointer to ist */
-    void* data;          /* data to be passed for isr/ist */
-    int priority;        /* interrupt priority */
-    u_int count;         /* interrupt count */
-    int istreq;          /* number of ist request */
-    thread_t thread;     /* thread id of ist */
-    struct event istevt; /* event for ist */
+    int vector;              /* vector number */
+    int (*isr)(void*);       /* pointer to isr */
+    void (*ist)(void*);      /* pointer to ist */
+    void* data;              /* data to be passed for isr/ist */
+    int priority;            /* interrupt priority */
+    int cpu;                 /* CPU the interrupt is routed to */
+    u_int count;             /* interrupt count */
+    int istreq;              /* number of ist request */
+    thread_t thread;         /* thread id of ist */
+    struct event istevt;     /* event for ist */
+    int stamped;             /* stamp is valid */
+    uint32_t stamp;          /* cycle count at the first pending request */
+    u_int istcount;          /* number of ist runs */
+    uint32_t lat_max;        /* max isr to ist latency in cycles */
+    uint32_t run_max;        /* max ist run time in cycles */
+    u_int lat[IRQ_HISTSIZE]; /* latency histogram */
+    u_int run[IRQ_HISTSIZE]; /* run time histogram */
 };
 
 /*
@@ -67,6 +75,7 @@ struct irq
 __BEGIN_DECLS
 irq_t irq_attach(int, int, int, int (*)(void*), void (*)(void*), void*);
 void irq_detach(irq_t);
+int irq_setaffinity(irq_t, int);
 void irq_handler(int);
 int irq_info(struct irqinfo*);
 void irq_init(void);
@@ -36,6 +36,7 @@
 
 __BEGIN_DECLS
 paddr_t page_alloc(psize_t);
+paddr_t page_alloc_aligned(psize_t, psize_t);
 void page_free(paddr_t, psize_t);
 int page_reserve(paddr_t, psize_t);
 void page_info(struct meminfo*);
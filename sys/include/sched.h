@@ -47,6 +47,12 @@
  */
 #define QUANTUM (CONFIG_TIME_SLICE * HZ / 1000)
 
+/*
+ * Number of runnable threads checked for a cache-hot one
+ * when a CPU picks the next thread.
+ */
+#define AFFINITY_SCAN 4
+
 /*
  * DPC (Deferred Procedure Call) object
  */
@@ -67,6 +73,7 @@ struct dpc
 __BEGIN_DECLS
 int sched_tsleep(struct event*, u_long);
 void sched_wakeup(struct event*);
+void sched_wakeist(struct event*);
 thread_t sched_wakeone(struct event*);
 void sched_unsleep(thread_t, int);
 void sched_yield(void);
@@ -83,6 +90,7 @@ int sched_getpri(thread_t);
 void sched_setpri(thread_t, int, int);
 int sched_getpolicy(thread_t);
 int sched_setpolicy(thread_t, int);
+void sched_setaffinity(thread_t, u_int);
 void sched_dpc(struct dpc*, void (*)(void*), void*);
 void sched_init(void);
 __END_DECLS
@@ -36,49 +36,144 @@
 #include <hal.h>
 #include <deadlock.h>
 
-#ifdef CONFIG_KD
+#if defined(CONFIG_KD) || defined(CONFIG_LOCKSTAT)
 #include <timer.h>
 #endif
 
 /*
  * SAL Spinlock Interface.
- * Currently focused on TAS (Test-And-Set) implementation.
+ *
+ * Spinlocks are ticket locks. A CPU takes the next ticket with one
+ * atomic add and spins reading the owner field until its number comes
+ * up, so waiters get the lock in arrival order and only the release
+ * store bounces the cache line.
  */
 
 #ifdef CONFIG_SMP
 
-typedef volatile int spinlock_t;
-#define SPINLOCK_INITIALIZER 0
+#ifdef CONFIG_LOCKSTAT
+/*
+ * Per-lock statistics. All counters except the registration flag
+ * are updated by the lock holder only.
+ */
+struct lockstat
+{
+    const char* name; /* lock name, or NULL */
+    int registered;   /* true if listed for sys_info() */
+    u_long acquired;  /* number of acquisitions */
+    u_long contended; /* acquisitions that had to wait */
+    u_long spins;     /* total wait loop iterations */
+    uint64_t holdcycles;    /* total hold time in cycles */
+    uint32_t maxholdcycles; /* longest hold time in cycles */
+    uint32_t start;         /* clock_cycles() at the last acquisition */
+};
+#endif
+
+typedef struct spinlock
+{
+    volatile u_int next;  /* next ticket to hand out */
+    volatile u_int owner; /* ticket now being served */
+#ifdef CONFIG_LOCKSTAT
+    struct lockstat stat; /* statistics */
+#endif
+} spinlock_t;
+
+#define SPINLOCK_INITIALIZER {0, 0}
 
 #define smp_processor_id() (hal_get_cpu_control()->cpu_id)
+#define curcpu() hal_get_cpu_control()
 
 extern struct cpu_control cpu_table[];
+extern volatile u_int cpu_online; /* mask of running CPUs */
+
+#ifdef CONFIG_LOCKSTAT
+struct lockinfo;
+
+void lockstat_register(spinlock_t*, const char*);
+int lockstat_info(struct lockinfo*);
+void lockstat_dump(void);
+
+static inline void lockstat_acquire(spinlock_t* lock, u_long spins)
+{
+    if (!lock->stat.registered)
+        lockstat_register(lock, NULL);
+    lock->stat.acquired++;
+    if (spins > 0) {
+        lock->stat.contended++;
+        lock->stat.spins += spins;
+    }
+    lock->stat.start = clock_cycles();
+}
+
+static inline void lockstat_release(spinlock_t* lock)
+{
+    uint32_t held = clock_cycles() - lock->stat.start;
+
+    lock->stat.holdcycles += held;
+    if (held > lock->stat.maxholdcycles)
+        lock->stat.maxholdcycles = held;
+}
+#else
+#define lockstat_register(lock, name) ((void)0)
+#define lockstat_acquire(lock, spins) ((void)0)
+#define lockstat_release(lock) ((void)0)
+#endif /* CONFIG_LOCKSTAT */
 
 static inline void spinlock_init(spinlock_t* lock)
 {
-    *lock = 0;
+    lock->next = 0;
+    lock->owner = 0;
 }
 
-static inline void spinlock_lock(spinlock_t* lock)
+static inline u_int spinlock_ticket(spinlock_t* lock)
+{
+    return __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Wait until the ticket is served. Returns the number of
+ * wait loops.
+ */
+static inline u_long spinlock_wait(spinlock_t* lock, u_int ticket)
 {
+    u_long spins = 0;
 #ifdef CONFIG_KD
     uint32_t start = (uint32_t)timer_ticks();
     uint32_t iters = 0;
 #endif
-    while (__sync_lock_test_and_set(lock, 1)) {
+
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
 #ifdef CONFIG_KD
         deadlock_check_spin((void*)lock, start, &iters);
 #endif
-        while (*lock)
-            ; /* Spin */
+        spins++;
     }
+    return spins;
+}
+
+static inline void spinlock_lock(spinlock_t* lock)
+{
+    u_long spins;
+
+    spins = spinlock_wait(lock, spinlock_ticket(lock));
+    lockstat_acquire(lock, spins);
     deadlock_record_lock((void*)lock, LOCK_TYPE_SPIN);
 }
 
 static inline void spinlock_unlock(spinlock_t* lock)
 {
     deadlock_record_unlock((void*)lock);
-    __sync_lock_release(lock);
+    lockstat_release(lock);
+    __atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Release a lock that may be held in an unknown state,
+ * e.g. when printing from a panic path.
+ */
+static inline void spinlock_break(spinlock_t* lock)
+{
+    __atomic_store_n(&lock->owner, lock->next, __ATOMIC_RELEASE);
 }
 
 static inline void spinlock_lock_irq(spinlock_t* lock, int* s)
@@ -99,8 +194,14 @@ typedef int spinlock_t;
 #define SPINLOCK_INITIALIZER 0
 
 #define smp_processor_id() 0
+#define curcpu() (&cpu_table[0])
+#define cpu_online 1U
+
+extern struct cpu_control cpu_table[];
 
 #define spinlock_init(lock) (void)0
+#define spinlock_break(lock) (void)0
+#define lockstat_register(lock, name) ((void)0)
 #define spinlock_lock(lock) (void)0
 #define spinlock_unlock(lock) (void)0
 #define spinlock_lock_irq(lock, s) (*(s) = splhigh())
@@ -108,4 +209,8 @@ typedef int spinlock_t;
 
 #endif /* CONFIG_SMP */
 
+struct cpuinfo;
+
+int cpu_info(struct cpuinfo*);
+
 #endif /* !_SMP_H */
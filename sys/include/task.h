@@ -60,6 +60,7 @@ struct task
     int nthreads;           /* number of threads */
     int nobjects;           /* number of IPC objects */
     int nsyncs;             /* number of syncronizer objects */
+    struct cpuacct acct;    /* CPU usage of exited threads */
 #ifdef CONFIG_USR_BACKTRACE
     struct {
         uint32_t pc;   /* Return address */
@@ -100,6 +101,7 @@ int task_resume(task_t);
 int task_setname(task_t, const char*);
 int task_setcap(task_t, cap_t);
 int task_chkcap(task_t, cap_t);
+int task_setpid(task_t, pid_t, pid_t);
 int task_capable(cap_t);
 int task_valid(task_t);
 int task_access(task_t);
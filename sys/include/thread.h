@@ -38,6 +38,7 @@
 #include <event.h>
 #include <timer.h>
 #include <hal.h>
+#include <acct.h>
 
 /*
  * Description of a thread.
@@ -52,8 +53,15 @@ struct thread
     int policy;              /* scheduling policy */
     int priority;            /* current priority */
     int basepri;             /* statical base priority */
+    u_int affinity;          /* mask of CPUs allowed to run on */
+    int lastcpu;             /* CPU we ran on last, or -1 */
     int timeleft;            /* remaining ticks to run */
     u_int time;              /* total running time */
+    struct cpuacct acct;     /* CPU accounting */
+    int kmode;               /* true while in a system call */
+    int queued;              /* true if qstamp is valid */
+    uint32_t qstamp;         /* cycle counter when made runnable */
+    u_long qtick;            /* tick when made runnable */
     int resched;             /* true if rescheduling is needed */
     int locks;               /* schedule lock counter */
     int suscnt;              /* suspend count */
@@ -130,6 +138,8 @@ void thread_yield(void);
 int thread_suspend(thread_t);
 int thread_resume(thread_t);
 int thread_schedparam(thread_t, int, int*);
+int thread_setaffinity(thread_t, u_int);
+int thread_getaffinity(thread_t, u_int*);
 void thread_idle(void);
 int thread_info(struct threadinfo*);
 thread_t kthread_create(void (*)(void*), void*, int);
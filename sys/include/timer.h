@@ -43,6 +43,7 @@ struct timer
 {
     struct list link;    /* linkage on timer chain */
     int state;           /* timer state */
+    int cpu;             /* CPU whose queue holds the timer */
     u_long expire;       /* expiration time, in ticks */
     u_long interval;     /* time interval */
     void (*func)(void*); /* function to call */
@@ -82,6 +83,7 @@ void timer_clock(void);
 void timer_handler(void);
 u_long timer_ticks(void);
 void timer_info(struct timerinfo*);
+int timerq_info(struct timerqinfo*);
 void timer_init(void);
 __END_DECLS
 
@@ -34,6 +34,8 @@
 #include <sys/cdefs.h>
 #include <sys/sysinfo.h>
 #include <sys/bootinfo.h>
+#include <sys/kdata.h>
+#include <atomic.h>
 
 /*
  * One structure per allocated segment.
@@ -56,6 +58,7 @@ struct seg
 #define SEG_EXEC 0x00000004
 #define SEG_SHARED 0x00000008
 #define SEG_MAPPED 0x00000010
+#define SEG_LAZY 0x00000020
 #define SEG_FREE 0x00000080
 
 /* Attribute for vm_attribute() */
@@ -73,8 +76,26 @@ struct vm_map
     int refcnt;      /* reference count */
     pgd_t pgd;       /* page directory */
     size_t total;    /* total used size */
+    paddr_t kdata;   /* page for struct kdata_task */
 };
 
+/*
+ * Update a kernel data page. Readers in user mode retry while
+ * the sequence counter is odd or has changed.
+ */
+#define KDATA_BEGIN(kd)                                                                                                \
+    do {                                                                                                               \
+        (kd)->seq++;                                                                                                   \
+        memory_barrier();                                                                                              \
+    } while (0)
+#define KDATA_END(kd)                                                                                                  \
+    do {                                                                                                               \
+        memory_barrier();                                                                                              \
+        (kd)->seq++;                                                                                                   \
+    } while (0)
+
+extern struct kdata* kdata; /* shared kernel data page */
+
 __BEGIN_DECLS
 int vm_allocate(task_t, void**, size_t, int);
 int vm_free(task_t, void*);
@@ -87,6 +108,8 @@ void vm_terminate(vm_map_t);
 void vm_switch(vm_map_t);
 int vm_load(vm_map_t, struct module*, void**);
 paddr_t vm_translate(vaddr_t, size_t);
+int vm_fault(vaddr_t);
+int vm_kdata(vm_map_t);
 int vm_info(struct vminfo*);
 void vm_init(void);
 __END_DECLS
@@ -50,6 +50,9 @@
 #include <smp.h>
 #include <deadlock.h>
 #include <exception.h>
+#include <trace.h>
+#include <prof.h>
+#include <acct.h>
 #include <sys/dbgctl.h>
 #include <mmu.h>
 #include <machine/syspage.h>
@@ -63,6 +63,7 @@
 #include <task.h>
 #include <event.h>
 #include <ipc.h>
+#include <trace.h>
 
 /* forward declarations */
 static thread_t msg_dequeue(queue_t);
@@ -124,6 +125,7 @@ int msg_send(object_t obj, void* msg, size_t size)
      */
     hdr = (struct msg_header*)kmsg;
     hdr->task = curtask;
+    TRACE(TR_MSGSEND, obj, hdr->code);
 
     /*
      * If receiver already exists, wake it up.
@@ -271,6 +273,7 @@ int msg_receive(object_t obj, void* msg, size_t size)
      */
     curthread->sender = t;
     t->receiver = curthread;
+    TRACE(TR_MSGRECV, obj, t);
 
     sched_unlock();
     return error;
@@ -321,6 +324,7 @@ int msg_reply(object_t obj, void* msg, size_t size)
      */
     sched_unsleep(t, 0);
     t->receiver = NULL;
+    TRACE(TR_MSGREPLY, obj, t);
 
     /* Clear transmit state */
     curthread->sender = NULL;
@@ -81,6 +81,7 @@ pub fn send(obj: kern.ObjectRef, msg: ?*anyopaque, size: usize) callconv(.c) c_i
 
     const hdr: *hal.MsgHeader = @ptrCast(@alignCast(kmsg));
     hdr.task = kutil.get_curtask();
+    ffi.trace.event(ffi.trace.MSGSEND, @truncate(@intFromPtr(obj)), @bitCast(hdr.code));
 
     if (!lib.IntrusiveQueue(hal.Object, lib.Queue, "recvq").node(obj.?).isEmpty()) {
         const t = dequeue(lib.IntrusiveQueue(hal.Object, lib.Queue, "recvq").node(obj.?));
@@ -167,6 +168,7 @@ pub fn receive(obj: kern.ObjectRef, msg: ?*anyopaque, size: usize) callconv(.c)
 
     kutil.get_curthread().?.sender = t;
     t.?.receiver = kutil.get_curthread();
+    ffi.trace.event(ffi.trace.MSGRECV, @truncate(@intFromPtr(obj)), @truncate(@intFromPtr(t)));
 
     return err_code;
 }
@@ -198,6 +200,7 @@ pub fn reply(obj: kern.ObjectRef, msg: ?*anyopaque, size: usize) callconv(.c) c_
 
     sched.unsleep(t, 0);
     t.?.receiver = null;
+    ffi.trace.event(ffi.trace.MSGREPLY, @truncate(@intFromPtr(obj)), @truncate(@intFromPtr(t)));
 
     kutil.get_curthread().?.sender = null;
     kutil.get_curthread().?.recvobj = null;
@@ -0,0 +1,397 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * acct.c - CPU accounting
+ */
+
+/**
+ * The cycle counter of each CPU is read whenever the current thread
+ * changes its state: a thread switch, a system call entry or exit,
+ * a page fault and the exit of the outermost interrupt. The cycles
+ * since the previous read are billed to the current thread as user
+ * or kernel time, and the cycles spent in interrupt handlers are
+ * billed to it separately.
+ *
+ * The counter is 32 bits wide, so it must be read at least once
+ * before it wraps. This is done by the clock interrupt.
+ *
+ * The accounting code measures its own cost, which is reported
+ * per CPU.
+ */
+
+#include <kernel.h>
+#include <task.h>
+#include <thread.h>
+#include <timer.h>
+#include <sched.h>
+#include <hal.h>
+#include <smp.h>
+#include <acct.h>
+
+#ifdef CONFIG_SMP
+#define NACCTCPU CONFIG_SMP_NCPUS
+#else
+#define NACCTCPU 1
+#endif
+
+struct acctcpu
+{
+    uint32_t stamp;    /* cycle counter at the last update */
+    uint32_t irqstamp; /* cycle counter at the outermost interrupt */
+    int started;       /* true if stamp is valid */
+    int depth;         /* interrupt nesting level */
+    u_int count;       /* number of updates */
+    uint64_t itime;    /* cycles in interrupt handlers */
+    uint64_t cost;     /* cycles spent in updates */
+};
+
+static struct acctcpu acctcpu[NACCTCPU];
+
+/*
+ * Bill the cycles since the last update to the current thread.
+ * Called with interrupts disabled.
+ */
+static void acct_run(struct acctcpu* ac, uint32_t now)
+{
+    thread_t t = curthread;
+    uint32_t run;
+
+    if (ac->started) {
+        run = now - ac->stamp;
+        if (t->kmode || (t->task->flags & TF_SYSTEM))
+            t->acct.stime += run;
+        else
+            t->acct.utime += run;
+    }
+    ac->stamp = now;
+    ac->started = 1;
+}
+
+/*
+ * Count the cost of an update which started at the given cycle.
+ */
+static void acct_done(struct acctcpu* ac, uint32_t start)
+{
+
+    ac->count++;
+    ac->cost += clock_cycles() - start;
+}
+
+/*
+ * Bring the current thread up to date.
+ */
+static void acct_sync(void)
+{
+    struct acctcpu* ac;
+    uint32_t now;
+    int s;
+
+    s = splhigh();
+    ac = &acctcpu[smp_processor_id()];
+    if (ac->depth == 0) {
+        now = clock_cycles();
+        acct_run(ac, now);
+        acct_done(ac, now);
+    }
+    splx(s);
+}
+
+/*
+ * Return the cycles a thread has been waiting on a run queue.
+ *
+ * The tick count is used instead if the cycle counter may have
+ * wrapped, or if it is not in step with the counter of the CPU
+ * which queued the thread.
+ */
+static uint64_t acct_wait(thread_t t, uint32_t now)
+{
+    uint32_t per, ticks, cyc;
+
+    cyc = now - t->qstamp;
+    per = clock_cyclehz() / HZ;
+    if (per == 0)
+        return cyc;
+
+    ticks = (uint32_t)(timer_ticks() - t->qtick);
+    if ((ticks > 1 && cyc < (uint64_t)(ticks - 1) * per) || cyc > (uint64_t)(ticks + 1) * per)
+        return (uint64_t)ticks * per;
+    return cyc;
+}
+
+/*
+ * Account a thread switch from prev to next.
+ * Called from sched_swtch() with interrupts disabled.
+ */
+void acct_switch(thread_t prev, thread_t next)
+{
+    struct acctcpu* ac = &acctcpu[smp_processor_id()];
+    uint32_t now;
+
+    now = clock_cycles();
+    acct_run(ac, now);
+
+    if (prev->state == TS_RUN)
+        prev->acct.nivcsw++;
+    else
+        prev->acct.nvcsw++;
+
+    /*
+     * A thread which terminated itself is folded into its task
+     * only now, so that its last cycles are not lost.  The task
+     * is gone if the thread terminated its own task.
+     */
+    if (prev->state == TS_EXIT && task_valid(prev->task))
+        acct_exit(prev);
+
+    if (next->queued) {
+        next->acct.wtime += acct_wait(next, now);
+        next->queued = 0;
+    }
+    acct_done(ac, now);
+}
+
+/*
+ * Stamp a thread put on a run queue.
+ */
+void acct_ready(thread_t t)
+{
+
+    t->qstamp = clock_cycles();
+    t->qtick = timer_ticks();
+    t->queued = 1;
+}
+
+/*
+ * Called from sched_tick() once every tick.
+ *
+ * If the clock interrupt came through irq_handler(), the update
+ * is done at the interrupt exit. Otherwise do it here so that the
+ * cycle counter does not wrap between updates.
+ */
+void acct_tick(void)
+{
+    struct acctcpu* ac = &acctcpu[smp_processor_id()];
+    uint32_t now;
+
+    if (ac->depth > 0)
+        return;
+    now = clock_cycles();
+    acct_run(ac, now);
+    acct_done(ac, now);
+}
+
+/*
+ * Switch the current thread to kernel (1) or user (0) mode
+ * accounting. Returns the previous mode.
+ */
+int acct_mode(int kmode)
+{
+    struct acctcpu* ac;
+    thread_t t = curthread;
+    uint32_t now;
+    int old, s;
+
+    old = t->kmode;
+    if (old == kmode)
+        return old;
+
+    s = splhigh();
+    ac = &acctcpu[smp_processor_id()];
+    now = clock_cycles();
+    acct_run(ac, now);
+    t->kmode = kmode;
+    acct_done(ac, now);
+    splx(s);
+    return old;
+}
+
+/*
+ * Called from irq_handler() at the entry of each interrupt.
+ */
+void acct_irqenter(uint32_t entry)
+{
+    struct acctcpu* ac = &acctcpu[smp_processor_id()];
+
+    if (ac->depth++ == 0)
+        ac->irqstamp = entry;
+}
+
+/*
+ * Called from irq_handler() at the exit of each interrupt.
+ * The outermost interrupt bills the time up to its entry to the
+ * current thread, and its own time as interrupt time.
+ */
+void acct_irqexit(void)
+{
+    struct acctcpu* ac = &acctcpu[smp_processor_id()];
+    uint32_t now, irq;
+
+    if (--ac->depth > 0)
+        return;
+
+    now = clock_cycles();
+    if (!ac->started || (int32_t)(ac->irqstamp - ac->stamp) > 0)
+        acct_run(ac, ac->irqstamp);
+    irq = now - ac->stamp;
+    curthread->acct.itime += irq;
+    ac->itime += irq;
+    ac->stamp = now;
+    acct_done(ac, now);
+}
+
+/*
+ * Fold the usage of an exiting thread into its task.
+ * The current thread is folded by acct_switch() instead.
+ */
+void acct_exit(thread_t t)
+{
+    struct cpuacct* ta = &t->task->acct;
+
+    ta->utime += t->acct.utime;
+    ta->stime += t->acct.stime;
+    ta->itime += t->acct.itime;
+    ta->wtime += t->acct.wtime;
+    ta->nvcsw += t->acct.nvcsw;
+    ta->nivcsw += t->acct.nivcsw;
+}
+
+/*
+ * Convert cycles to seconds and microseconds.
+ * This is done by shift and subtract to avoid a 64-bit division.
+ */
+static void acct_cputime(uint64_t cyc, uint32_t hz, struct cputime* ct)
+{
+    u_long sec = 0, usec = 0;
+    int i;
+
+    if (hz != 0) {
+        if ((cyc >> 32) >= hz)
+            cyc = ((uint64_t)hz << 32) - 1;
+        for (i = 31; i >= 0; i--) {
+            if ((cyc >> i) >= hz) {
+                cyc -= (uint64_t)hz << i;
+                sec |= 1UL << i;
+            }
+        }
+        cyc *= 1000000;
+        for (i = 19; i >= 0; i--) {
+            if ((cyc >> i) >= hz) {
+                cyc -= (uint64_t)hz << i;
+                usec |= 1UL << i;
+            }
+        }
+    }
+    ct->sec = sec;
+    ct->usec = usec;
+}
+
+static void acct_usage(const struct cpuacct* a, struct cpuusage* u)
+{
+    uint32_t hz = clock_cyclehz();
+
+    acct_cputime(a->utime, hz, &u->utime);
+    acct_cputime(a->stime, hz, &u->stime);
+    acct_cputime(a->itime, hz, &u->itime);
+    acct_cputime(a->wtime, hz, &u->wtime);
+    u->nvcsw = a->nvcsw;
+    u->nivcsw = a->nivcsw;
+}
+
+/*
+ * Return the CPU usage of a thread.
+ * A thread running on another CPU is up to date as of the last
+ * interrupt on that CPU.
+ */
+void acct_thread(thread_t t, struct cpuusage* u)
+{
+
+    if (t == curthread)
+        acct_sync();
+    acct_usage(&t->acct, u);
+}
+
+/*
+ * Return the CPU usage of a task, including its exited threads.
+ * Called with scheduler locked.
+ */
+void acct_task(task_t task, struct cpuusage* u)
+{
+    struct cpuacct sum;
+    thread_t t;
+    list_t n;
+
+    if (task == curtask)
+        acct_sync();
+
+    sum = task->acct;
+    for (n = list_first(&task->threads); n != &task->threads; n = list_next(n)) {
+        t = list_entry(n, struct thread, task_link);
+        sum.utime += t->acct.utime;
+        sum.stime += t->acct.stime;
+        sum.itime += t->acct.itime;
+        sum.wtime += t->acct.wtime;
+        sum.nvcsw += t->acct.nvcsw;
+        sum.nivcsw += t->acct.nivcsw;
+    }
+    acct_usage(&sum, u);
+}
+
+/*
+ * Fill in the accounting statistics of a CPU.
+ */
+void acct_cpu(int cpu, struct cpuinfo* info)
+{
+    struct acctcpu* ac;
+    uint32_t hz = clock_cyclehz();
+
+    if (cpu < 0 || cpu >= NACCTCPU) {
+        memset(&info->itime, 0, sizeof(info->itime));
+        memset(&info->acct, 0, sizeof(info->acct));
+        info->nacct = 0;
+        return;
+    }
+    ac = &acctcpu[cpu];
+    acct_cputime(ac->itime, hz, &info->itime);
+    acct_cputime(ac->cost, hz, &info->acct);
+    info->nacct = ac->count;
+}
+
+/*
+ * Return the CPU usage of the calling thread and its task.
+ */
+int acct_info(struct usageinfo* info)
+{
+
+    sched_lock();
+    acct_thread(curthread, &info->thread);
+    acct_task(curtask, &info->task);
+    sched_unlock();
+    return 0;
+}
@@ -140,7 +140,7 @@ void deadlock_check_spin(void *lock, uint32_t start_tick, uint32_t *iters)
     (*iters)++;
 
     if (*iters > SPIN_TIMEOUT_ITER) {
-        log_lock = 0;
+        spinlock_break(&log_lock);
         printf("\n*** HARD STALL DETECTED: CPU %d spinning with blocked timer ***\n", 
                smp_processor_id());
         printf("Lock: %p, Iters: %u\n", lock, *iters);
@@ -164,7 +164,7 @@ void deadlock_check_loop(const char *func, uint32_t *iters)
 
     (*iters)++;
     if (*iters > SPIN_TIMEOUT_ITER) {
-        log_lock = 0;
+        spinlock_break(&log_lock);
         printf("\n*** STALL DETECTED: Infinite loop in %s ***\n", func);
         deadlock_dump();
         panic("Loop Stall");
@@ -236,7 +236,7 @@ void deadlock_proactive_check(void)
 
     if (now == last_check && now != 0) {
         if (++timer_stuck_cnt > 100) {
-            log_lock = 0;
+            spinlock_break(&log_lock);
             printf("\n*** HARD STALL DETECTED: System timer (lbolt) has stopped! ***\n");
             deadlock_dump();
             panic("Timer Stall");
@@ -251,7 +251,7 @@ void deadlock_proactive_check(void)
         if (wait_records[i].active) {
             if (wait_records[i].name != NULL && strncmp(wait_records[i].name, "mutex", 6) == 0) {
                 if (now - wait_records[i].start_tick > CONFIG_HZ) {
-                    log_lock = 0;
+                    spinlock_break(&log_lock);
                     printf("\n*** DEADLOCK DETECTED: Lost Wakeup / Resource Stall ***\n");
                     printf("Thread %p has been waiting on %s %p for %u ticks!\n", 
                            wait_records[i].thread, wait_records[i].name, 
@@ -286,6 +286,10 @@ void deadlock_dump(void)
         }
     }
 
+#ifdef CONFIG_LOCKSTAT
+    lockstat_dump();
+#endif
+
     printf("\nWait Status:\n");
     for (i = 0; i < MAX_WAITERS; i++) {
         if (wait_records[i].active) {
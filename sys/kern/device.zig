@@ -526,7 +526,7 @@ pub fn init() callconv(.c) void {
 // ---------------------------------------------------------------------------
 const dkifn_t = ?*const anyopaque;
 
-const dkient = [40]dkifn_t{
+const dkient = [41]dkifn_t{
     //  0: copyin
     @ptrCast(&hal.copyin),
     //  1: copyout
@@ -607,6 +607,8 @@ const dkient = [40]dkifn_t{
     @ptrCast(&ffi.raw.hal_uart_unlock),
     // 39: ksem_post
     @ptrCast(&sem.postKernel),
+    // 40: irq_setaffinity
+    @ptrCast(&irq.setaffinity),
 };
 
 // ---------------------------------------------------------------------------
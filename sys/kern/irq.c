@@ -65,6 +65,9 @@
 #include <thread.h>
 #include <irq.h>
 #include <hal.h>
+#include <smp.h>
+#include <trace.h>
+#include <acct.h>
 
 /* forward declarations */
 static void irq_thread(void*);
@@ -134,6 +137,48 @@ void irq_detach(irq_t irq)
     kmem_free(irq);
 }
 
+/*
+ * irq_setaffinity - route an interrupt to the specified CPU.
+ *
+ * The IST thread is bound to the same CPU, so the ISR and the
+ * IST share its cache.  Returns EINVAL if the CPU is not running
+ * or the interrupt controller can not route the interrupt.
+ */
+int irq_setaffinity(irq_t irq, int cpu)
+{
+    int error = 0;
+
+    ASSERT(irq != NULL);
+
+    if (cpu < 0 || cpu >= 32 || !(cpu_online & (1U << cpu)))
+        return EINVAL;
+
+    sched_lock();
+#ifdef CONFIG_SMP
+    if (interrupt_setaffinity(irq->vector, cpu) != 0)
+        error = EINVAL;
+#endif
+    if (error == 0) {
+        irq->cpu = cpu;
+        if (irq->thread != NULL)
+            sched_setaffinity(irq->thread, 1U << cpu);
+    }
+    sched_unlock();
+    return error;
+}
+
+/*
+ * Return the log2 histogram bucket for a cycle count.
+ */
+static int irq_bucket(uint32_t cycles)
+{
+    int n = 0;
+
+    while (cycles >>= 1)
+        n++;
+    return n;
+}
+
 /*
  * Interrupt service thread.
  * This is a common dispatcher to all interrupt threads.
@@ -143,6 +188,7 @@ static void irq_thread(void* arg)
     void (*fn)(void*);
     void* data;
     struct irq* irq;
+    uint32_t start, t;
 
     splhigh();
 
@@ -157,12 +203,31 @@ static void irq_thread(void* arg)
         irq->istreq--;
         ASSERT(irq->istreq >= 0);
 
+        /*
+         * Account the latency from the entry of the ISR
+         * which made the oldest pending request.
+         */
+        start = clock_cycles();
+        if (irq->stamped) {
+            t = start - irq->stamp;
+            irq->lat[irq_bucket(t)]++;
+            if (t > irq->lat_max)
+                irq->lat_max = t;
+            irq->stamped = 0;
+        }
+
         /*
          * Call IST
          */
         spl0();
         (*fn)(data);
         splhigh();
+
+        t = clock_cycles() - start;
+        irq->run[irq_bucket(t)]++;
+        if (t > irq->run_max)
+            irq->run_max = t;
+        irq->istcount++;
     }
     /* NOTREACHED */
 }
@@ -177,32 +242,43 @@ static void irq_thread(void* arg)
 void irq_handler(int vector)
 {
     struct irq* irq;
+    uint32_t entry;
     int rc;
 
+    entry = clock_cycles();
     irq = irq_table[vector];
     if (irq == NULL) {
         DPRINTF(("Random interrupt ignored\n"));
         return;
     }
     ASSERT(irq->isr != NULL);
+    acct_irqenter(entry);
 
     /* Profile */
     irq->count++;
+    curcpu()->nirq++;
 
     /*
      * Call ISR
      */
+    TRACE(TR_IRQENTER, vector, 0);
     rc = (*irq->isr)(irq->data);
+    TRACE(TR_IRQEXIT, vector, rc);
 
     if (rc == INT_CONTINUE) {
         /*
          * Kick IST
          */
         ASSERT(irq->ist != IST_NONE);
+        if (!irq->stamped) {
+            irq->stamp = entry;
+            irq->stamped = 1;
+        }
         irq->istreq++;
-        sched_wakeup(&irq->istevt);
+        sched_wakeist(&irq->istevt);
         ASSERT(irq->istreq != 0);
     }
+    acct_irqexit();
 }
 
 /*
@@ -230,6 +306,13 @@ int irq_info(struct irqinfo* info)
     info->priority = irq->priority;
     info->istreq = irq->istreq;
     info->thread = irq->thread;
+    info->cpu = irq->cpu;
+    info->istcount = irq->istcount;
+    info->cyclehz = clock_cyclehz();
+    info->lat_max = irq->lat_max;
+    info->run_max = irq->run_max;
+    memcpy(info->lat, irq->lat, sizeof(info->lat));
+    memcpy(info->run, irq->run, sizeof(info->run));
     info->cookie = vec + 1;
     return 0;
 }
@@ -35,6 +35,8 @@ const kmem = ffi.kmem;
 const thread = ffi.thread;
 const sync = ffi.sync;
 
+const NCPUS = if (@hasDecl(ffi.raw, "CONFIG_SMP_NCPUS")) ffi.raw.CONFIG_SMP_NCPUS else 1;
+
 var IST_NONE: ?*const fn (?*anyopaque) callconv(.c) void = undefined;
 
 var irq_table = std.mem.zeroes([hal.MAXIRQS]?*kern.IRQ);
@@ -43,6 +45,15 @@ inline fn ISTPRI(pri: c_int) c_int {
     return hal.PRI_IST + (hal.IPL_HIGH - pri);
 }
 
+fn irq_bucket(cycles: u32) usize {
+    var n: usize = 0;
+    var v = cycles >> 1;
+    while (v != 0) : (v >>= 1) {
+        n += 1;
+    }
+    return n;
+}
+
 fn irq_thread(arg: ?*anyopaque) callconv(.c) void {
     const irq: *kern.IRQ = @ptrCast(@alignCast(arg.?));
     const fn_ptr = irq.ist;
@@ -57,9 +68,26 @@ fn irq_thread(arg: ?*anyopaque) callconv(.c) void {
         irq.istreq -= 1;
         std.debug.assert(irq.istreq >= 0);
 
+        const start = hal.clock_cycles();
+        if (irq.stamped != 0) {
+            const lat = start -% irq.stamp;
+            irq.lat[irq_bucket(lat)] +%= 1;
+            if (lat > irq.lat_max) {
+                irq.lat_max = lat;
+            }
+            irq.stamped = 0;
+        }
+
         _ = hal.spl0();
         fn_ptr.?(data);
         _ = hal.splhigh();
+
+        const run = hal.clock_cycles() -% start;
+        irq.run[irq_bucket(run)] +%= 1;
+        if (run > irq.run_max) {
+            irq.run_max = run;
+        }
+        irq.istcount +%= 1;
     }
 }
 
@@ -105,22 +133,53 @@ pub fn detach(irq: ?*kern.IRQ) callconv(.c) void {
     kmem.free(irq);
 }
 
+pub fn setaffinity(irq: ?*kern.IRQ, cpu: c_int) callconv(.c) c_int {
+    std.debug.assert(irq != null);
+
+    if (cpu < 0 or cpu >= NCPUS) {
+        return kern.Errno.EINVAL;
+    }
+
+    sched.lock();
+    defer sched.unlock();
+
+    if (comptime @hasDecl(ffi.raw, "CONFIG_SMP")) {
+        if (hal.interrupt_setaffinity(irq.?.vector, cpu) != 0) {
+            return kern.Errno.EINVAL;
+        }
+    }
+    irq.?.cpu = cpu;
+    if (irq.?.thread != null) {
+        irq.?.thread.?.*.affinity = @as(c_uint, 1) << @intCast(cpu);
+    }
+    return 0;
+}
+
 pub fn handler(vector: c_int) callconv(.c) void {
+    const entry = hal.clock_cycles();
     const irq = irq_table[@intCast(vector)] orelse {
         return;
     };
     std.debug.assert(irq.isr != null);
+    ffi.acct.irqenter(entry);
 
     irq.count +%= 1;
 
+    ffi.trace.event(ffi.trace.IRQENTER, @bitCast(vector), 0);
     const rc = irq.isr.?(irq.data);
+    ffi.trace.event(ffi.trace.IRQEXIT, @bitCast(vector), @bitCast(rc));
 
     if (rc == hal.INT_CONTINUE) {
         std.debug.assert(irq.ist != IST_NONE);
+        if (irq.stamped == 0) {
+            irq.stamp = entry;
+            irq.stamped = 1;
+        }
         irq.istreq += 1;
-        sched.wakeup(&irq.istevt);
+        sched.wakeist(&irq.istevt);
         std.debug.assert(irq.istreq != 0);
     }
+    ffi.acct.irqexit();
 }
 
 pub fn info(irq_info_ptr: ?*hal.IrqInfo) callconv(.c) c_int {
@@ -142,6 +201,13 @@ pub fn info(irq_info_ptr: ?*hal.IrqInfo) callconv(.c) c_int {
     irq_info_ptr.?.priority = irq.priority;
     irq_info_ptr.?.istreq = irq.istreq;
     irq_info_ptr.?.thread = irq.thread;
+    irq_info_ptr.?.cpu = irq.cpu;
+    irq_info_ptr.?.istcount = irq.istcount;
+    irq_info_ptr.?.cyclehz = hal.clock_cyclehz();
+    irq_info_ptr.?.lat_max = irq.lat_max;
+    irq_info_ptr.?.run_max = irq.run_max;
+    irq_info_ptr.?.lat = irq.lat;
+    irq_info_ptr.?.run = irq.run;
     irq_info_ptr.?.cookie = vec + 1;
     return 0;
 }
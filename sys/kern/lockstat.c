@@ -0,0 +1,122 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * lockstat.c - spinlock statistics
+ */
+
+#include <kernel.h>
+#include <smp.h>
+#include <sys/sysinfo.h>
+
+#ifndef CONFIG_SMP
+#error "LOCKSTAT requires SMP_NCPUS"
+#endif
+
+#define NLOCKSTAT 32 /* max number of listed locks */
+
+static spinlock_t* lockstat_table[NLOCKSTAT];
+static int nlockstat;
+
+/*
+ * Add a lock to the statistics table.
+ *
+ * Locks are listed on their first acquisition. Call this
+ * explicitly to give a lock a name.
+ */
+void lockstat_register(spinlock_t* lock, const char* name)
+{
+    int i;
+
+    if (name != NULL)
+        lock->stat.name = name;
+    if (__sync_lock_test_and_set(&lock->stat.registered, 1))
+        return;
+    i = __sync_fetch_and_add(&nlockstat, 1);
+    if (i < NLOCKSTAT)
+        lockstat_table[i] = lock;
+}
+
+/*
+ * Return statistics of the next listed lock.
+ *
+ * The counters are read without the lock, so a snapshot
+ * may be slightly inconsistent.
+ */
+int lockstat_info(struct lockinfo* info)
+{
+    int i = info->cookie;
+    spinlock_t* lock;
+    struct lockstat* ls;
+
+    while (i < NLOCKSTAT && i < nlockstat) {
+        if ((lock = lockstat_table[i]) != NULL)
+            break;
+        i++;
+    }
+    if (i >= NLOCKSTAT || i >= nlockstat)
+        return ESRCH;
+
+    ls = &lock->stat;
+    info->addr = (void*)lock;
+    if (ls->name != NULL)
+        strlcpy(info->name, ls->name, MAXLOCKNAME);
+    else
+        info->name[0] = '\0';
+    info->acquired = ls->acquired;
+    info->contended = ls->contended;
+    info->spins = ls->spins;
+    info->holdcycles = ls->holdcycles;
+    info->maxholdcycles = ls->maxholdcycles;
+    info->cookie = i + 1;
+    return 0;
+}
+
+#ifdef DEBUG
+/*
+ * Dump statistics of all listed locks.
+ */
+void lockstat_dump(void)
+{
+    struct lockstat* ls;
+    int i;
+
+    printf("\nLock Statistics:\n");
+    printf("Lock     Name        Acquired Contended    Spins  MaxHoldCyc\n");
+    printf("-------- ----------- -------- --------- -------- -----------\n");
+    for (i = 0; i < NLOCKSTAT && i < nlockstat; i++) {
+        if (lockstat_table[i] == NULL)
+            continue;
+        ls = &lockstat_table[i]->stat;
+        printf("%08lx %-11s %8lu %9lu %8lu %11lu\n", (long)lockstat_table[i],
+               ls->name != NULL ? ls->name : "-", ls->acquired, ls->contended,
+               ls->spins, (u_long)ls->maxholdcycles);
+    }
+}
+#endif
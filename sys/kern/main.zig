@@ -151,6 +151,7 @@ comptime {
     // ---- irq ----
     @export(&irq.attach, .{ .name = "irq_attach", .linkage = .strong });
     @export(&irq.detach, .{ .name = "irq_detach", .linkage = .strong });
+    @export(&irq.setaffinity, .{ .name = "irq_setaffinity", .linkage = .strong });
     @export(&irq.handler, .{ .name = "irq_handler", .linkage = .strong });
     @export(&irq.info, .{ .name = "irq_info", .linkage = .strong });
     @export(&irq.init, .{ .name = "irq_init", .linkage = .strong });
@@ -163,6 +164,7 @@ comptime {
     @export(&sched.swtch, .{ .name = "sched_swtch", .linkage = .strong });
     @export(&sched.tsleep, .{ .name = "sched_tsleep", .linkage = .strong });
     @export(&sched.wakeup, .{ .name = "sched_wakeup", .linkage = .strong });
+    @export(&sched.wakeist, .{ .name = "sched_wakeist", .linkage = .strong });
     @export(&sched.wakeone, .{ .name = "sched_wakeone", .linkage = .strong });
     @export(&sched.unsleep, .{ .name = "sched_unsleep", .linkage = .strong });
     @export(&sched.yield, .{ .name = "sched_yield", .linkage = .strong });
@@ -184,6 +186,7 @@ comptime {
     // ---- smp (vars always needed for C-side refs; fns only when SMP) ----
     @export(&smp.cpu_table, .{ .name = "cpu_table", .linkage = .strong });
     @export(&smp.ap_boot_stacks, .{ .name = "ap_boot_stacks", .linkage = .strong });
+    @export(&smp.cpuInfo, .{ .name = "cpu_info", .linkage = .strong });
     if (@hasDecl(ffi.raw, "CONFIG_SMP")) {
         @export(&smp.initEarly, .{ .name = "smp_init_early", .linkage = .strong });
         @export(&smp.hal_set_cpu_control, .{ .name = "hal_set_cpu_control", .linkage = .strong });
@@ -219,6 +222,7 @@ comptime {
     @export(&task.setname, .{ .name = "task_setname", .linkage = .strong });
     @export(&task.setcap, .{ .name = "task_setcap", .linkage = .strong });
     @export(&task.chkcap, .{ .name = "task_chkcap", .linkage = .strong });
+    @export(&task.setpid, .{ .name = "task_setpid", .linkage = .strong });
     @export(&task.capable, .{ .name = "task_capable", .linkage = .strong });
     @export(&task.valid, .{ .name = "task_valid", .linkage = .strong });
     @export(&task.access, .{ .name = "task_access", .linkage = .strong });
@@ -243,6 +247,8 @@ comptime {
     @export(&thread.@"suspend", .{ .name = "thread_suspend", .linkage = .strong });
     @export(&thread.@"resume", .{ .name = "thread_resume", .linkage = .strong });
     @export(&thread.schedparam, .{ .name = "thread_schedparam", .linkage = .strong });
+    @export(&thread.setaffinity, .{ .name = "thread_setaffinity", .linkage = .strong });
+    @export(&thread.getaffinity, .{ .name = "thread_getaffinity", .linkage = .strong });
     @export(&thread.idle, .{ .name = "thread_idle", .linkage = .strong });
     @export(&thread.info, .{ .name = "thread_info", .linkage = .strong });
     @export(&thread.createKernel, .{ .name = "kthread_create", .linkage = .strong });
@@ -261,6 +267,7 @@ comptime {
     @export(&timer.handler, .{ .name = "timer_handler", .linkage = .strong });
     @export(&timer.ticks, .{ .name = "timer_ticks", .linkage = .strong });
     @export(&timer.info, .{ .name = "timer_info", .linkage = .strong });
+    @export(&timer.queueInfo, .{ .name = "timerq_info", .linkage = .strong });
     @export(&timer.init, .{ .name = "timer_init", .linkage = .strong });
     if (@hasDecl(ffi.raw, "CONFIG_SMP")) {
         @export(&timer.__broken_spinlock_lock, .{ .name = "__broken_spinlock_lock", .linkage = .strong });
@@ -319,6 +326,7 @@ comptime {
 
     // ---- page ----
     @export(&page.alloc, .{ .name = "page_alloc", .linkage = .strong });
+    @export(&page.alloc_aligned, .{ .name = "page_alloc_aligned", .linkage = .strong });
     @export(&page.free, .{ .name = "page_free", .linkage = .strong });
     @export(&page.reserve, .{ .name = "page_reserve", .linkage = .strong });
     @export(&page.info, .{ .name = "page_info", .linkage = .strong });
@@ -337,5 +345,10 @@ comptime {
     @export(&vm.load, .{ .name = "vm_load", .linkage = .strong });
     @export(&vm.translate, .{ .name = "vm_translate", .linkage = .strong });
     @export(&vm.info, .{ .name = "vm_info", .linkage = .strong });
+    if (@hasDecl(ffi.raw, "CONFIG_MMU")) {
+        @export(&vm.fault, .{ .name = "vm_fault", .linkage = .strong });
+        @export(&vm.kdataSetup, .{ .name = "vm_kdata", .linkage = .strong });
+        @export(&vm.kdata, .{ .name = "kdata", .linkage = .strong });
+    }
     @export(&vm.init, .{ .name = "vm_init", .linkage = .strong });
 }
@@ -0,0 +1,225 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * prof.c - statistical profiler
+ */
+
+/**
+ * The clock interrupt samples the interrupted program counter on
+ * each CPU, and counts it in a hash table keyed by the thread and
+ * the program counter. Each CPU has its own table which is only
+ * updated by its clock interrupt, so no lock is needed.
+ *
+ * A sample is dropped when its slot is not found within a few
+ * probes. The user tool reads the tables and resolves the program
+ * counters to function names.
+ */
+
+#include <kernel.h>
+#include <page.h>
+#include <sched.h>
+#include <task.h>
+#include <thread.h>
+#include <hal.h>
+#include <smp.h>
+#include <prof.h>
+
+#define PROF_NENTS 2048 /* entries per CPU, must be power of 2 */
+#define PROF_PROBE 16   /* max slots probed per sample */
+#define PROF_CHUNK 16   /* entries copied at once by a reader */
+
+#ifdef CONFIG_SMP
+#define NPROFBUF CONFIG_SMP_NCPUS
+#else
+#define NPROFBUF 1
+#endif
+
+struct profbuf
+{
+    struct prof_entry* table; /* hash table */
+    int ticks;                /* ticks since last sample */
+    u_int samples;            /* samples taken */
+    u_int dropped;            /* samples not recorded */
+};
+
+volatile int prof_period; /* ticks per sample, 0 if off */
+
+static struct profbuf profbuf[NPROFBUF];
+static int last_period; /* period of the last run */
+
+/*
+ * Count a sample for the current CPU.
+ * Called from timer_handler() with interrupts disabled.
+ */
+void prof_tick(void)
+{
+    struct profbuf* pb;
+    struct prof_entry* e;
+    vaddr_t pc = 0;
+    u_int h, i;
+    uint32_t flags;
+    int mode;
+
+    pb = &profbuf[smp_processor_id()];
+    if (pb->table == NULL || ++pb->ticks < prof_period)
+        return;
+    pb->ticks = 0;
+    pb->samples++;
+
+    mode = interrupt_pc(&pc);
+    if (mode < 0) {
+        pc = 0;
+        flags = PROF_UNKNOWN;
+    } else
+        flags = mode ? PROF_USER : 0;
+
+    h = ((uint32_t)pc >> 2) ^ ((uint32_t)curthread >> 4);
+    h ^= h >> 11;
+    for (i = 0; i < PROF_PROBE; i++) {
+        e = &pb->table[(h + i) & (PROF_NENTS - 1)];
+        if (e->count == 0) {
+            e->pc = (uint32_t)pc;
+            e->thread = (uint32_t)curthread;
+            e->task = (uint32_t)curthread->task;
+            e->flags = flags;
+            e->count = 1;
+            return;
+        }
+        if (e->pc == (uint32_t)pc && e->thread == (uint32_t)curthread) {
+            e->count++;
+            return;
+        }
+    }
+    pb->dropped++;
+}
+
+/*
+ * Allocate and clear the tables, and start sampling.
+ */
+static int prof_start(int period)
+{
+    struct profbuf* pb;
+    paddr_t pa;
+    int i;
+
+    if (period <= 0)
+        return EINVAL;
+
+    prof_period = 0;
+    for (i = 0; i < NPROFBUF; i++) {
+        pb = &profbuf[i];
+        if (pb->table == NULL) {
+            pa = page_alloc(PROF_NENTS * sizeof(struct prof_entry));
+            if (pa == 0)
+                return ENOMEM;
+            pb->table = ptokv(pa);
+        }
+        memset(pb->table, 0, PROF_NENTS * sizeof(struct prof_entry));
+        pb->ticks = 0;
+        pb->samples = 0;
+        pb->dropped = 0;
+    }
+    last_period = period;
+    prof_period = period;
+    return 0;
+}
+
+/*
+ * Copy the used entries of one CPU to the user buffer,
+ * starting from the table index in the request.
+ */
+static int prof_read(struct prof_read* pr)
+{
+    struct prof_entry chunk[PROF_CHUNK];
+    struct profbuf* pb;
+    int i, n, count = 0;
+
+    if (pr->cpu < 0 || pr->cpu >= NPROFBUF)
+        return ESRCH;
+
+    pb = &profbuf[pr->cpu];
+    i = pr->index;
+    if (pb->table == NULL || i < 0)
+        i = PROF_NENTS;
+
+    while (i < PROF_NENTS && count < pr->count) {
+        n = 0;
+        while (i < PROF_NENTS && n < PROF_CHUNK && count + n < pr->count) {
+            if (pb->table[i].count != 0)
+                chunk[n++] = pb->table[i];
+            i++;
+        }
+        if (n > 0 && copyout(chunk, &pr->entries[count], n * sizeof(struct prof_entry)))
+            return EFAULT;
+        count += n;
+    }
+    pr->index = i;
+    pr->count = count;
+    pr->samples = pb->samples;
+    pr->dropped = pb->dropped;
+    pr->period = last_period;
+    return 0;
+}
+
+/*
+ * Profiler control system call.
+ */
+int sys_prof(int cmd, void* data)
+{
+    struct prof_read pr;
+    int error = 0;
+
+    if (!task_capable(CAP_TASKCTRL))
+        return EPERM;
+
+    sched_lock();
+    switch (cmd) {
+    case PROF_START:
+        error = prof_start((int)data);
+        break;
+    case PROF_STOP:
+        prof_period = 0;
+        break;
+    case PROF_READ:
+        if (copyin(data, &pr, sizeof(pr))) {
+            error = EFAULT;
+            break;
+        }
+        error = prof_read(&pr);
+        if (error == 0 && copyout(&pr, data, sizeof(pr)))
+            error = EFAULT;
+        break;
+    default:
+        error = EINVAL;
+        break;
+    }
+    sched_unlock();
+    return error;
+}
@@ -92,6 +92,8 @@
 
 #include <smp.h>
 #include <deadlock.h>
+#include <trace.h>
+#include <acct.h>
 
 static struct queue runq[NPRI]; /* run queues */
 static struct queue wakeq;      /* queue for waking threads */
@@ -101,6 +103,55 @@ static int maxpri;              /* highest priority in runq */
 
 static spinlock_t kernel_lock = SPINLOCK_INITIALIZER;
 
+#ifdef CONFIG_SMP
+/*
+ * Acquire the Big Kernel Lock (BKL).
+ *
+ * The caller is at splhigh and *s holds the saved IPL. At the
+ * outermost level the IPL is dropped while waiting so that IPIs
+ * and device interrupts are still serviced. An interrupt handler
+ * that needs the BKL while this CPU is queued inherits the ticket
+ * instead of taking a second one behind it, which would never be
+ * served. The interrupted waiter then finds its ticket consumed
+ * and queues again.
+ */
+static void bkl_acquire(int* s)
+{
+    struct cpu_control* cpu;
+    u_long spins = 0;
+    u_int ticket;
+#if defined(DEBUG) && defined(CONFIG_KD)
+    uint32_t start = (uint32_t)timer_ticks();
+    uint32_t iters = 0;
+#endif
+
+    for (;;) {
+        cpu = hal_get_cpu_control();
+        if (!cpu->bkl_wait) {
+            cpu->bkl_ticket = spinlock_ticket(&kernel_lock);
+            cpu->bkl_wait = 1;
+        }
+        ticket = cpu->bkl_ticket;
+        if (__atomic_load_n(&kernel_lock.owner, __ATOMIC_ACQUIRE) == ticket) {
+            cpu->bkl_wait = 0;
+            break;
+        }
+#if defined(DEBUG) && defined(CONFIG_KD)
+        deadlock_check_spin((void*)&kernel_lock, start, &iters);
+#endif
+        spins++;
+        if (cpu->nest_count == 0) {
+            splx(*s); /* Drop IPL to allow IPIs */
+            while (kernel_lock.owner != ticket && cpu->bkl_wait)
+                memory_barrier();
+            *s = splhigh();
+        }
+    }
+    lockstat_acquire(&kernel_lock, spins);
+    deadlock_record_lock((void*)&kernel_lock, LOCK_TYPE_BKL);
+}
+#endif /* CONFIG_SMP */
+
 /*
  * Unlock the Big Kernel Lock (BKL).
  * This is called from the thread entry trampolines to release the
@@ -124,6 +175,32 @@ static int runq_getbest(void)
     return pri;
 }
 
+#ifdef CONFIG_SMP
+/*
+ * Ask the CPUs that may run the thread to reschedule.
+ */
+static void runq_kick(thread_t t)
+{
+    thread_t active;
+    u_int mask = 0;
+    int i, self;
+
+    self = smp_processor_id();
+    if (t->affinity & (1U << self))
+        curthread->resched = 1;
+
+    for (i = 0; i < CONFIG_SMP_NCPUS; i++) {
+        if (i == self || !(t->affinity & cpu_online & (1U << i)))
+            continue;
+        if ((active = cpu_table[i].active_thread) != NULL)
+            active->resched = 1;
+        mask |= 1U << i;
+    }
+    if (mask != 0)
+        hal_cpu_send_ipi(mask, 0);
+}
+#endif /* CONFIG_SMP */
+
 /*
  * Put a thread on the tail of the run queue.
  * The rescheduling flag is set if the priority is beter
@@ -131,23 +208,16 @@ static int runq_getbest(void)
  */
 static void runq_enqueue(thread_t t)
 {
-#ifdef CONFIG_SMP
-    int i;
-#endif
 
+    acct_ready(t);
     enqueue(&runq[t->priority], &t->sched_link);
     if (t->priority < maxpri) {
         maxpri = t->priority;
-        curthread->resched = 1;
 #ifdef CONFIG_SMP
-        /* Kick other CPUs to pick up the new thread */
-        for (i = 0; i < CONFIG_SMP_NCPUS; i++) {
-            if (i != smp_processor_id()) {
-                if (cpu_table[i].active_thread)
-                    cpu_table[i].active_thread->resched = 1;
-            }
-        }
-        hal_cpu_send_ipi(0, 0);
+        /* Kick the CPUs allowed to pick up the new thread */
+        runq_kick(t);
+#else
+        curthread->resched = 1;
 #endif
     }
 }
@@ -159,6 +229,7 @@ static void runq_enqueue(thread_t t)
 static void runq_insert(thread_t t)
 {
 
+    acct_ready(t);
     queue_insert(&runq[t->priority], &t->sched_link);
     if (t->priority < maxpri)
         maxpri = t->priority;
@@ -167,11 +238,23 @@ static void runq_insert(thread_t t)
 /*
  * Pick up and remove the highest-priority thread
  * from the run queue.
+ *
+ * On SMP, only threads whose affinity mask includes this CPU
+ * are taken. Within a priority level, a thread that ran here
+ * last is preferred since its cache is likely still warm.
+ * Only the first AFFINITY_SCAN candidates are looked at, so
+ * the queue stays close to FIFO order.
  */
 static thread_t runq_dequeue(void)
 {
     queue_t q;
     thread_t t;
+#ifdef CONFIG_SMP
+    thread_t best;
+    queue_t head;
+    u_int cpubit;
+    int self, pri, n;
+#endif
 
     if (maxpri >= PRI_IDLE) {
 #ifdef CONFIG_SMP
@@ -181,12 +264,43 @@ static thread_t runq_dequeue(void)
 #endif
     }
 
+#ifdef CONFIG_SMP
+    self = smp_processor_id();
+    cpubit = 1U << self;
+    for (pri = maxpri; pri < MINPRI; pri++) {
+        head = &runq[pri];
+        best = NULL;
+        n = 0;
+        for (q = queue_first(head); !queue_end(head, q); q = queue_next(q)) {
+            t = queue_entry(q, struct thread, sched_link);
+            if (!(t->affinity & cpubit))
+                continue;
+            if (t->lastcpu == self || t->lastcpu < 0) {
+                best = t;
+                break;
+            }
+            if (best == NULL)
+                best = t;
+            if (++n >= AFFINITY_SCAN)
+                break;
+        }
+        if (best != NULL) {
+            queue_remove(&best->sched_link);
+            if (queue_empty(&runq[maxpri]))
+                maxpri = runq_getbest();
+            return best;
+        }
+    }
+    /* Nothing may run here, leave the others for other CPUs */
+    return hal_get_cpu_control()->idle_thread;
+#else
     q = dequeue(&runq[maxpri]);
     t = queue_entry(q, struct thread, sched_link);
     if (queue_empty(&runq[maxpri]))
         maxpri = runq_getbest();
 
     return t;
+#endif
 }
 
 /*
@@ -243,6 +357,7 @@ static void sched_setrun(thread_t t)
  */
 void sched_swtch(void)
 {
+    struct cpu_control* cpu;
     thread_t prev, next;
 
     /*
@@ -254,6 +369,11 @@ void sched_swtch(void)
             runq_insert(prev); /* preemption */
         else
             runq_enqueue(prev);
+#ifdef CONFIG_SMP
+        /* The affinity was changed to exclude this CPU */
+        if (!(prev->affinity & (1U << smp_processor_id())))
+            runq_kick(prev);
+#endif
     }
     prev->resched = 0;
 
@@ -264,8 +384,16 @@ void sched_swtch(void)
     next = runq_dequeue();
     if (next == prev)
         return;
+    TRACE(TR_SWTCH, next, prev->state);
+    acct_switch(prev, next);
     curthread = next;
 
+    cpu = curcpu();
+    cpu->nswitch++;
+    if (next->lastcpu >= 0 && next->lastcpu != cpu->cpu_id)
+        cpu->nmigrate++;
+    next->lastcpu = cpu->cpu_id;
+
     /*
      * Switch to the new thread.
      * You are expected to understand this..
@@ -283,29 +411,8 @@ void sched_swtch(void)
 
 #ifdef CONFIG_SMP
     /* SMP: Re-acquire BKL after context switch. */
-    struct cpu_control* cpu = hal_get_cpu_control();
     int s = splhigh();
-#if defined(DEBUG) && defined(CONFIG_KD)
-    uint32_t sw_start = (uint32_t)timer_ticks();
-    uint32_t sw_iters = 0;
-#endif
-    while (__sync_lock_test_and_set(&kernel_lock, 1)) {
-#if defined(DEBUG) && defined(CONFIG_KD)
-        deadlock_check_spin((void*)&kernel_lock, sw_start, &sw_iters);
-#endif
-        if (cpu->nest_count == 0) {
-            splx(s); /* Drop IPL to allow IPIs */
-            while (kernel_lock) {
-                memory_barrier();
-            }
-            s = splhigh();
-        } else {
-            while (kernel_lock) {
-                memory_barrier();
-            }
-        }
-    }
-    deadlock_record_lock((void*)&kernel_lock, LOCK_TYPE_BKL);
+    bkl_acquire(&s);
     curthread->locks = locks;
     splx(s);
 #endif
@@ -387,6 +494,41 @@ void sched_wakeup(struct event* evt)
     sched_unlock();
 }
 
+/*
+ * sched_wakeist - wake up an interrupt service thread.
+ *
+ * This is called by irq_handler() with the scheduler locked
+ * by the HAL. If this is the outermost lock, the interrupted
+ * thread was not touching the run queue, so the IST is put
+ * there directly rather than waiting for wakeq_flush().
+ * Otherwise this is same as sched_wakeup().
+ */
+void sched_wakeist(struct event* evt)
+{
+    queue_t q;
+    thread_t t;
+    int s;
+
+    ASSERT(evt != NULL);
+
+    if (curthread->locks != 1) {
+        sched_wakeup(evt);
+        return;
+    }
+    s = splhigh();
+    while (!queue_empty(&evt->sleepq)) {
+        q = dequeue(&evt->sleepq);
+        t = queue_entry(q, struct thread, sched_link);
+        t->slpret = 0;
+        t->slpevt = NULL;
+        t->state &= ~TS_SLEEP;
+        timer_stop(&t->timeout);
+        if (t != curthread && t->state == TS_RUN)
+            runq_enqueue(t);
+    }
+    splx(s);
+}
+
 /*
  * sched_wakeone - wake up one thread sleeping on event.
  *
@@ -508,12 +650,18 @@ void sched_resume(thread_t t)
  */
 void sched_tick(void)
 {
+    struct cpu_control* cpu = curcpu();
+
+    cpu->ticks++;
+    if (curthread->priority == PRI_IDLE)
+        cpu->idleticks++;
 
     if (curthread->state != TS_EXIT) {
         /*
          * Bill time to current thread.
          */
         curthread->time++;
+        acct_tick();
 
         if (curthread->policy == SCHED_RR) {
             if (--curthread->timeleft <= 0) {
@@ -580,31 +728,11 @@ void sched_lock(void)
     int s = splhigh();
     if (curthread->locks == 0) {
 #ifdef CONFIG_SMP
-        struct cpu_control* cpu = hal_get_cpu_control();
-#if defined(DEBUG) && defined(CONFIG_KD)
-        uint32_t start = (uint32_t)timer_ticks();
-        uint32_t iters = 0;
-#endif
-        while (__sync_lock_test_and_set(&kernel_lock, 1)) {
-#if defined(DEBUG) && defined(CONFIG_KD)
-            deadlock_check_spin((void*)&kernel_lock, start, &iters);
-#endif
-            if (cpu->nest_count == 0) {
-                splx(s);
-                while (kernel_lock) {
-                    memory_barrier();
-                }
-                s = splhigh();
-            } else {
-                while (kernel_lock) {
-                    memory_barrier();
-                }
-            }
-        }
+        bkl_acquire(&s);
 #else
         spinlock_lock(&kernel_lock);
-#endif
         deadlock_record_lock((void*)&kernel_lock, LOCK_TYPE_BKL);
+#endif
     }
     curthread->locks++;
     splx(s);
@@ -645,11 +773,10 @@ void sched_unlock(void)
             wakeq_flush();
         }
         curthread->locks = 0;
-        deadlock_record_unlock((void*)&kernel_lock);
 #ifdef CONFIG_SMP
-        __sync_lock_release(&kernel_lock);
-#else
         spinlock_unlock(&kernel_lock);
+#else
+        deadlock_record_unlock((void*)&kernel_lock);
 #endif
     } else {
         curthread->locks--;
@@ -702,6 +829,44 @@ void sched_setpri(thread_t t, int basepri, int pri)
     }
 }
 
+/*
+ * Set the CPUs the thread may run on.
+ * Called with scheduler locked.
+ */
+void sched_setaffinity(thread_t t, u_int mask)
+{
+#ifdef CONFIG_SMP
+    int i;
+#endif
+
+    t->affinity = mask;
+#ifdef CONFIG_SMP
+    if (t->state != TS_RUN)
+        return;
+
+    if (t == curthread) {
+        if (!(mask & (1U << smp_processor_id())))
+            curthread->resched = 1;
+        return;
+    }
+    for (i = 0; i < CONFIG_SMP_NCPUS; i++) {
+        if (cpu_table[i].active_thread == t) {
+            /*
+             * Running on another CPU. Make it go through
+             * sched_swtch() there if it must move away.
+             */
+            if (!(mask & (1U << i))) {
+                t->resched = 1;
+                hal_cpu_send_ipi(1U << i, 0);
+            }
+            return;
+        }
+    }
+    /* On the run queue */
+    runq_kick(t);
+#endif
+}
+
 /*
  * Get the scheduling policy.
  */
@@ -812,6 +977,7 @@ void sched_init(void)
     queue_init(&wakeq);
     queue_init(&dpcq);
     event_init(&dpc_event, "dpc");
+    lockstat_register(&kernel_lock, "kernel");
     maxpri = PRI_IDLE;
     curthread->resched = 1;
 
@@ -38,7 +38,7 @@ const thread = ffi.thread;
 const timer = ffi.timer;
 const vm = ffi.vm;
 
-pub var kernel_lock: hal.Spinlock = .{ .value = 0 };
+pub var kernel_lock: hal.Spinlock = .{ .value = hal.SPINLOCK_INITIALIZER };
 var runq: [hal.NPRI]lib.Queue = undefined;
 var wakeq: lib.Queue = undefined;
 var dpcq: lib.Queue = undefined;
@@ -56,6 +56,7 @@ fn runq_getbest() c_int {
 }
 
 fn runq_enqueue(t: kern.ThreadRef) void {
+    ffi.acct.ready(t);
     runq[@intCast(t.*.priority)].enqueue(lib.IntrusiveQueue(kern.Thread, lib.Queue, "sched_link").node(t));
     if (t.*.priority < maxpri) {
         maxpri = t.*.priority;
@@ -66,15 +67,57 @@ fn runq_enqueue(t: kern.ThreadRef) void {
 }
 
 fn runq_insert(t: kern.ThreadRef) void {
+    ffi.acct.ready(t);
     runq[@intCast(t.*.priority)].insert(lib.IntrusiveQueue(kern.Thread, lib.Queue, "sched_link").node(t));
     if (t.*.priority < maxpri) {
         maxpri = t.*.priority;
     }
 }
 
+fn idle_thread() kern.ThreadRef {
+    if (comptime @hasDecl(ffi.raw, "CONFIG_SMP")) {
+        return smp.get_cpu_control().*.idle_thread;
+    }
+    return &thread.idle_thread;
+}
+
+// On SMP, only threads whose affinity mask includes this CPU are
+// taken. Within a priority level a thread that ran here last is
+// preferred, looking at no more than AFFINITY_SCAN candidates.
 fn runq_dequeue() kern.ThreadRef {
     if (maxpri >= hal.PRI_IDLE) {
-        return &thread.idle_thread;
+        return idle_thread();
+    }
+    if (comptime @hasDecl(ffi.raw, "CONFIG_SMP")) {
+        const self = smp.get_cpu_control().*.cpu_id;
+        const cpubit = @as(c_uint, 1) << @intCast(self);
+        var pri = maxpri;
+        while (pri < hal.MINPRI) : (pri += 1) {
+            const head: *lib.Queue = &runq[@intCast(pri)];
+            var best: kern.ThreadRef = null;
+            var n: c_int = 0;
+            var q = head.first();
+            while (q != head) : (q = q.nextNode()) {
+                const t = q.entry(kern.Thread, "sched_link");
+                if (t.*.affinity & cpubit == 0) continue;
+                if (t.*.lastcpu == self or t.*.lastcpu < 0) {
+                    best = t;
+                    break;
+                }
+                if (best == null) best = t;
+                n += 1;
+                if (n >= ffi.raw.AFFINITY_SCAN) break;
+            }
+            if (best) |t| {
+                lib.IntrusiveQueue(kern.Thread, lib.Queue, "sched_link").node(t).remove();
+                if (runq[@intCast(maxpri)].isEmpty()) {
+                    maxpri = runq_getbest();
+                }
+                return t;
+            }
+        }
+        // Nothing may run here, leave the others for other CPUs.
+        return idle_thread();
     }
     const q = runq[@intCast(maxpri)].dequeue().?;
     const t = q.entry(kern.Thread, "sched_link");
@@ -139,8 +182,17 @@ pub fn swtch() callconv(.c) void {
     if (next == prev) {
         return;
     }
+    ffi.trace.event(ffi.trace.SWTCH, @truncate(@intFromPtr(next)), @bitCast(prev.*.state));
+    ffi.acct.@"switch"(prev, next);
     set_curthread(next);
 
+    const cpu = smp.curcpu();
+    cpu.*.nswitch +%= 1;
+    if (next.*.lastcpu >= 0 and next.*.lastcpu != cpu.*.cpu_id) {
+        cpu.*.nmigrate +%= 1;
+    }
+    next.*.lastcpu = cpu.*.cpu_id;
+
     if (prev.*.task != next.*.task) {
         vm.switch_map(next.*.task.*.map);
     }
@@ -199,6 +251,27 @@ pub fn wakeup(evt: *hal.Event) callconv(.c) void {
     unlock();
 }
 
+pub fn wakeist(evt: *hal.Event) callconv(.c) void {
+    const e: *sync.Event = @ptrCast(evt);
+    if (curthread().*.locks != 1) {
+        wakeup(evt);
+        return;
+    }
+    const s = hal.splhigh();
+    while (!e.*.sleepq.isEmpty()) {
+        const q = e.*.sleepq.dequeue().?;
+        const t = q.entry(kern.Thread, "sched_link");
+        t.*.slpret = 0;
+        t.*.slpevt = null;
+        t.*.state &= ~@as(c_int, kern.TS_SLEEP);
+        timer.stop(&t.*.timeout);
+        if (t != curthread() and t.*.state == kern.TS_RUN) {
+            runq_enqueue(t);
+        }
+    }
+    hal.splx(s);
+}
+
 pub fn wakeone(evt: *hal.Event) callconv(.c) kern.ThreadRef {
     const e: *sync.Event = @ptrCast(evt);
     lock();
@@ -266,8 +339,15 @@ pub fn @"resume"(t: kern.ThreadRef) callconv(.c) void {
 }
 
 pub fn tick() callconv(.c) void {
+    const cpu = smp.curcpu();
+    cpu.*.ticks +%= 1;
+    if (curthread().*.priority == hal.PRI_IDLE) {
+        cpu.*.idleticks +%= 1;
+    }
+
     if (curthread().*.state != kern.TS_EXIT) {
         curthread().*.time += 1;
+        ffi.acct.tick();
         if (curthread().*.policy == kern.SCHED_RR) {
             curthread().*.timeleft -= 1;
             if (curthread().*.timeleft <= 0) {
@@ -430,6 +510,8 @@ pub fn init() callconv(.c) void {
         dpc_event.sleepq.init();
         dpc_event.name = "dpc";
     }
+    if (comptime @hasDecl(ffi.raw, "CONFIG_LOCKSTAT"))
+        smp.lockstat_register(&kernel_lock.value, "kernel");
     maxpri = hal.PRI_IDLE;
     curthread().*.resched = 1;
 
@@ -39,6 +39,8 @@
 #include <locore.h>
 #include <sched.h>
 #include <irq.h>
+#include <vm.h>
+#include <acct.h>
 
 extern void kernel_start(void);
 extern void ap_reset_entry(void);
@@ -60,6 +62,7 @@ struct cpu_control cpu_table[CONFIG_SMP_NCPUS] = {
     }
 };
 char ap_boot_stacks[CONFIG_SMP_NCPUS][KSTACKSZ] __attribute__((aligned(16)));
+volatile u_int cpu_online = 1;
 #else
 struct cpu_control cpu_table[1] = {
     {
@@ -77,6 +80,31 @@ struct cpu_control cpu_table[1] = {
 static volatile int ready_count = 0;
 static volatile int smp_active = 0;
 
+/*
+ * Return per-CPU scheduling statistics.
+ */
+int cpu_info(struct cpuinfo* info)
+{
+    struct cpu_control* cpu;
+    int i = info->cookie;
+
+    if (i < 0 || i >= (int)(sizeof(cpu_table) / sizeof(cpu_table[0])))
+        return ESRCH;
+
+    cpu = &cpu_table[i];
+    info->cpu = i;
+    info->online = (cpu_online & (1U << i)) ? 1 : 0;
+    info->active = cpu->active_thread;
+    info->nswitch = cpu->nswitch;
+    info->nmigrate = cpu->nmigrate;
+    info->nirq = cpu->nirq;
+    info->ticks = cpu->ticks;
+    info->idleticks = cpu->idleticks;
+    acct_cpu(i, info);
+    info->cookie = i + 1;
+    return 0;
+}
+
 /*
  * IPI handler for rescheduling.
  */
@@ -159,6 +187,11 @@ void smp_start_aps(void)
  */
 void smp_activate(void)
 {
+#ifdef CONFIG_MMU
+    KDATA_BEGIN(kdata);
+    kdata->ncpus = atomic_read(&ready_count);
+    KDATA_END(kdata);
+#endif
     memory_barrier();
     smp_active = 1;
     memory_barrier();
@@ -192,6 +225,7 @@ void smp_ap_boot(void)
      * Increment ready count to signal that this AP has finished
      * early architecture initialization.
      */
+    __atomic_fetch_or(&cpu_online, 1U << cpuid, __ATOMIC_RELEASE);
     atomic_inc(&ready_count);
 
     /*
@@ -49,6 +49,7 @@ pub var ap_boot_stacks: [NCPUS][hal.KSTACKSZ]u8 align(16) = std.mem.zeroes([NCPU
 
 var ready_count: c_int = 0;
 var smp_active: c_int = 0;
+var cpu_online: c_uint = 1;
 
 extern fn zig_memory_barrier() callconv(.c) void;
 
@@ -62,6 +63,26 @@ pub fn kvtop(va: anytype) kern.Paddr {
 }
 
 
+/// Return per-CPU scheduling statistics.
+pub fn cpuInfo(info: *hal.CpuInfo) callconv(.c) c_int {
+    const i = info.cookie;
+    if (i < 0 or i >= NCPUS) {
+        return kern.Errno.ESRCH;
+    }
+    const cpu = &cpu_table[@intCast(i)];
+    info.cpu = i;
+    info.online = if (@atomicLoad(c_uint, &cpu_online, .acquire) & (@as(c_uint, 1) << @intCast(i)) != 0) 1 else 0;
+    info.active = cpu.active_thread;
+    info.nswitch = cpu.nswitch;
+    info.nmigrate = cpu.nmigrate;
+    info.nirq = cpu.nirq;
+    info.ticks = cpu.ticks;
+    info.idleticks = cpu.idleticks;
+    ffi.acct.cpu(i, info);
+    info.cookie = i + 1;
+    return 0;
+}
+
 pub fn initEarly() callconv(.c) void {
     const cpu: *hal.CpuControl = &cpu_table[0];
 
@@ -126,6 +147,14 @@ pub fn startAps() callconv(.c) void {
 
 pub fn activate() callconv(.c) void {
     _ = lib.printf("[SMP] Activating secondary CPUs...\n");
+    if (comptime @hasDecl(ffi.raw, "CONFIG_MMU")) {
+        const kd: *volatile ffi.mem.KData = ffi.mem.kdata;
+        kd.seq +%= 1;
+        zig_memory_barrier();
+        kd.ncpus = @atomicLoad(c_int, &ready_count, .seq_cst);
+        zig_memory_barrier();
+        kd.seq +%= 1;
+    }
     zig_memory_barrier();
     @atomicStore(c_int, &smp_active, 1, .seq_cst);
     zig_memory_barrier();
@@ -143,6 +172,7 @@ pub fn apBoot() callconv(.c) void {
 
     hal.clock_ap_init();
 
+    _ = @atomicRmw(c_uint, &cpu_online, .Or, @as(c_uint, 1) << @intCast(cpuid), .release);
     _ = @atomicRmw(c_int, &ready_count, .Add, 1, .seq_cst);
 
     while (@atomicLoad(c_int, &smp_active, .seq_cst) == 0) {}
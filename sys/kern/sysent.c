@@ -42,6 +42,9 @@
 #include <device.h>
 #include <sync.h>
 #include <system.h>
+#include <trace.h>
+#include <prof.h>
+#include <acct.h>
 
 #include <sys/syscall.h>
 
@@ -95,12 +98,16 @@ register_t syscall_handler(struct cpu_regs* regs, register_t id)
 #ifdef DEBUG
     strace_entry(regs->r0, regs->r1, regs->r2, regs->r3, id);
 #endif
+    TRACE(TR_SYSENTER, id, regs->r0);
+    acct_mode(1);
 
     if (id < NSYSCALL) {
         callp = &sysent[id];
         retval = (*callp->sy_call)(regs->r0, regs->r1, regs->r2, regs->r3);
     }
 
+    acct_mode(0);
+    TRACE(TR_SYSEXIT, id, retval);
 #ifdef DEBUG
     strace_return(retval, id);
 #endif
@@ -115,12 +122,16 @@ register_t syscall_handler(register_t a1, register_t a2, register_t a3, register
 #ifdef DEBUG
     strace_entry(a1, a2, a3, a4, id);
 #endif
+    TRACE(TR_SYSENTER, id, a1);
+    acct_mode(1);
 
     if (id < NSYSCALL) {
         callp = &sysent[id];
         retval = (*callp->sy_call)(a1, a2, a3, a4);
     }
 
+    acct_mode(0);
+    TRACE(TR_SYSEXIT, id, retval);
 #ifdef DEBUG
     strace_return(retval, id);
 #endif
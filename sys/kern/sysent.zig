@@ -45,7 +45,7 @@ const thread = ffi.thread;
 const timer = ffi.timer;
 const vm = ffi.vm;
 const TF_TRACE: c_int = 0x00000002;
-const NSYSCALL: comptime_int = 62;
+const NSYSCALL: comptime_int = 67;
 
 const sysfn_t = *const fn (kern.Register, kern.Register, kern.Register, kern.Register) callconv(.c) kern.Register;
 
@@ -126,6 +126,11 @@ const sysent: [NSYSCALL]SysEnt = .{
     SysEnt.init("sys_debug", 2, system.debug),
     SysEnt.init("device_gather_read", 4, ffi.raw.device_gather_read),
     SysEnt.init("device_scatter_write", 4, ffi.raw.device_scatter_write),
+    SysEnt.init("task_setpid", 3, task.setpid),
+    SysEnt.init("thread_setaffinity", 2, thread.setaffinity),
+    SysEnt.init("thread_getaffinity", 2, thread.getaffinity),
+    SysEnt.init("sys_trace", 2, ffi.trace.sys),
+    SysEnt.init("sys_prof", 2, ffi.prof.sys),
 };
 
 pub fn syscall_handler_std(a1: kern.Register, a2: kern.Register, a3: kern.Register, a4: kern.Register, id: kern.Register) callconv(.c) kern.Register {
@@ -134,11 +139,15 @@ pub fn syscall_handler_std(a1: kern.Register, a2: kern.Register, a3: kern.Regist
     if (comptime builtin.mode == .Debug) {
         strace_entry(a1, a2, a3, a4, id);
     }
+    ffi.trace.event(ffi.trace.SYSENTER, @bitCast(id), @bitCast(a1));
+    _ = ffi.acct.mode(1);
 
     if (id < NSYSCALL) {
         retval = sysent[@intCast(id)].call(a1, a2, a3, a4);
     }
 
+    _ = ffi.acct.mode(0);
+    ffi.trace.event(ffi.trace.SYSEXIT, @bitCast(id), @bitCast(retval));
     if (comptime builtin.mode == .Debug) {
         strace_return(retval, id);
     }
@@ -161,11 +170,15 @@ pub fn syscall_handler_armv8m(regs: *hal.CpuRegs, id: kern.Register) callconv(.c
     if (comptime builtin.mode == .Debug) {
         strace_entry(r0, r1, r2, r3, id);
     }
+    ffi.trace.event(ffi.trace.SYSENTER, @bitCast(id), @bitCast(r0));
+    _ = ffi.acct.mode(1);
 
     if (id < NSYSCALL) {
         retval = sysent[@intCast(id)].call(r0, r1, r2, r3);
     }
 
+    _ = ffi.acct.mode(0);
+    ffi.trace.event(ffi.trace.SYSEXIT, @bitCast(id), @bitCast(retval));
     if (comptime builtin.mode == .Debug) {
         strace_return(retval, id);
     }
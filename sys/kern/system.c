@@ -42,6 +42,8 @@
 #include <system.h>
 #include <hal.h>
 #include <cpufunc.h>
+#include <smp.h>
+#include <acct.h>
 #include <sys/dbgctl.h>
 
 static char infobuf[MAXINFOSZ]; /* common information buffer */
@@ -82,6 +84,20 @@ int sysinfo(int type, void* buf)
     case INFO_IRQ:
         error = irq_info(buf);
         break;
+#ifdef CONFIG_LOCKSTAT
+    case INFO_LOCK:
+        error = lockstat_info(buf);
+        break;
+#endif
+    case INFO_TIMERQ:
+        error = timerq_info(buf);
+        break;
+    case INFO_CPU:
+        error = cpu_info(buf);
+        break;
+    case INFO_USAGE:
+        error = acct_info(buf);
+        break;
     default:
         error = EINVAL;
         break;
@@ -128,6 +144,20 @@ int sys_info(int type, void* buf)
     case INFO_IRQ:
         bufsz = sizeof(struct irqinfo);
         break;
+#ifdef CONFIG_LOCKSTAT
+    case INFO_LOCK:
+        bufsz = sizeof(struct lockinfo);
+        break;
+#endif
+    case INFO_TIMERQ:
+        bufsz = sizeof(struct timerqinfo);
+        break;
+    case INFO_CPU:
+        bufsz = sizeof(struct cpuinfo);
+        break;
+    case INFO_USAGE:
+        bufsz = sizeof(struct usageinfo);
+        break;
     default:
         sched_unlock();
         return EINVAL;
@@ -36,6 +36,7 @@ const kutil = ffi.kutil;
 const lib = ffi.lib;
 const page = ffi.page;
 const sched = ffi.sched;
+const smp = ffi.smp;
 const task = ffi.task;
 const thread = ffi.thread;
 const timer = ffi.timer;
@@ -87,6 +88,9 @@ pub fn sysinfo(sysinfo_type: c_int, buf: ?*anyopaque) callconv(.c) c_int {
         hal.INFO_TIMER => {
             timer.info(@ptrCast(@alignCast(buf)));
         },
+        hal.INFO_TIMERQ => {
+            error_val = timer.queue_info(@ptrCast(@alignCast(buf)));
+        },
         hal.INFO_THREAD => {
             error_val = thread.info(@ptrCast(@alignCast(buf)));
         },
@@ -102,6 +106,19 @@ pub fn sysinfo(sysinfo_type: c_int, buf: ?*anyopaque) callconv(.c) c_int {
         hal.INFO_IRQ => {
             error_val = irq.info(@ptrCast(@alignCast(buf)));
         },
+        hal.INFO_USAGE => {
+            error_val = ffi.acct.info(@ptrCast(@alignCast(buf)));
+        },
+        hal.INFO_CPU => {
+            error_val = smp.cpu_info(@ptrCast(@alignCast(buf)));
+        },
+        hal.INFO_LOCK => {
+            if (comptime @hasDecl(ffi.raw, "CONFIG_LOCKSTAT")) {
+                error_val = smp.lockstat_info(@ptrCast(@alignCast(buf)));
+            } else {
+                error_val = kern.Errno.EINVAL;
+            }
+        },
         else => {
             error_val = kern.Errno.EINVAL;
         },
@@ -131,6 +148,9 @@ pub fn sysInfo(sysinfo_type: c_int, buf: ?*anyopaque) callconv(.c) c_int {
         hal.INFO_TIMER => {
             bufsz = @sizeOf(hal.TimerInfo);
         },
+        hal.INFO_TIMERQ => {
+            bufsz = @sizeOf(hal.TimerqInfo);
+        },
         hal.INFO_THREAD => {
             bufsz = @sizeOf(hal.ThreadInfo);
         },
@@ -146,6 +166,17 @@ pub fn sysInfo(sysinfo_type: c_int, buf: ?*anyopaque) callconv(.c) c_int {
         hal.INFO_IRQ => {
             bufsz = @sizeOf(hal.IrqInfo);
         },
+        hal.INFO_USAGE => {
+            bufsz = @sizeOf(hal.UsageInfo);
+        },
+        hal.INFO_CPU => {
+            bufsz = @sizeOf(hal.CpuInfo);
+        },
+        hal.INFO_LOCK => {
+            if (comptime !@hasDecl(ffi.raw, "CONFIG_LOCKSTAT"))
+                return kern.Errno.EINVAL;
+            bufsz = @sizeOf(hal.LockInfo);
+        },
         else => {
             return kern.Errno.EINVAL;
         },
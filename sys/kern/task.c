@@ -41,6 +41,7 @@
 #include <exception.h>
 #include <task.h>
 #include <hal.h>
+#include <acct.h>
 #include <sys/bootinfo.h>
 
 struct task kernel_task;      /* kernel task */
@@ -112,6 +113,12 @@ int task_create(task_t parent, int vm_option, task_t* childp)
     switch (vm_option) {
     case VM_NEW:
         map = vm_create();
+#ifdef CONFIG_MMU
+        if (map != NULL && vm_kdata(map)) {
+            vm_terminate(map);
+            map = NULL;
+        }
+#endif
         break;
     case VM_SHARE:
         vm_reference(parent->map);
@@ -351,6 +358,41 @@ int task_setcap(task_t task, cap_t cap)
     return 0;
 }
 
+/*
+ * Publish the POSIX process id of the specified task.
+ *
+ * The process server calls this whenever it assigns or
+ * changes the identity of a process, so that getpid() and
+ * getppid() can be answered from the task data page without
+ * sending a message.
+ */
+int task_setpid(task_t task, pid_t pid, pid_t ppid)
+{
+#ifdef CONFIG_MMU
+    struct kdata_task* kt;
+#endif
+
+    if (!task_capable(CAP_PROTSERV))
+        return EPERM;
+
+    sched_lock();
+    if (!task_valid(task)) {
+        sched_unlock();
+        return ESRCH;
+    }
+#ifdef CONFIG_MMU
+    if (task->map->kdata != 0) {
+        kt = ptokv(task->map->kdata);
+        KDATA_BEGIN(kt);
+        kt->pid = pid;
+        kt->ppid = ppid;
+        KDATA_END(kt);
+    }
+#endif
+    sched_unlock();
+    return 0;
+}
+
 /*
  * task_chkcap - system call to check task capability.
  */
@@ -445,6 +487,7 @@ int task_info(struct taskinfo* info)
             info->nthreads = task->nthreads;
             info->active = (task == curtask) ? 1 : 0;
             strlcpy(info->taskname, task->name, MAXTASKNAME);
+            acct_task(task, &info->usage);
             sched_unlock();
             return 0;
         }
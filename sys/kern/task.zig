@@ -155,6 +155,12 @@ pub fn create(parent: kern.TaskRef, vm_option: c_int, childp: ?*kern.TaskRef) ca
     switch (vm_option) {
         kern.VM_NEW => {
             map = vm.create();
+            if (comptime @hasDecl(ffi.raw, "CONFIG_MMU")) {
+                if (map != null and vm.kdata(map) != 0) {
+                    vm.terminate(map);
+                    map = null;
+                }
+            }
         },
         kern.VM_SHARE => {
             _ = vm.reference(parent.?.*.map);
@@ -328,6 +334,29 @@ pub fn setcap(task: kern.TaskRef, cap: kern.Cap) callconv(.c) c_int {
     return 0;
 }
 
+pub fn setpid(task: kern.TaskRef, pid: kern.Pid, ppid: kern.Pid) callconv(.c) c_int {
+    if (capable(kern.CAP_PROTSERV) == 0) return kern.Errno.EPERM;
+
+    sched.lock();
+    defer sched.unlock();
+    if (valid(task) == 0) {
+        return kern.Errno.ESRCH;
+    }
+    if (comptime @hasDecl(ffi.raw, "CONFIG_MMU")) {
+        const map = task.?.*.map.?;
+        if (map.*.kdata != 0) {
+            const kt: *volatile ffi.mem.KDataTask = @ptrCast(@alignCast(kutil.ptokv(map.*.kdata).?));
+            kt.seq +%= 1;
+            hal.zig_memory_barrier();
+            kt.pid = pid;
+            kt.ppid = ppid;
+            hal.zig_memory_barrier();
+            kt.seq +%= 1;
+        }
+    }
+    return 0;
+}
+
 pub fn chkcap(task: kern.TaskRef, cap: kern.Cap) callconv(.c) c_int {
     var err: c_int = 0;
 
@@ -364,6 +393,7 @@ pub fn info(task_info_ptr: ?*hal.TaskInfo) callconv(.c) c_int {
             task_info_ptr.?.*.nthreads = task.*.nthreads;
             task_info_ptr.?.*.active = if (task == kutil.cur_task()) @as(c_int, 1) else @as(c_int, 0);
             _ = lib.strlcpy(@ptrCast(&task_info_ptr.?.*.taskname), @ptrCast(&task.*.name), hal.MAXTASKNAME);
+            ffi.acct.task(task, &task_info_ptr.?.*.usage);
             return 0;
         }
         i += 1;
@@ -39,6 +39,8 @@
 #include <sched.h>
 #include <sync.h>
 #include <hal.h>
+#include <smp.h>
+#include <acct.h>
 
 /* forward declarations */
 static thread_t thread_allocate(task_t);
@@ -118,6 +120,8 @@ int thread_create(task_t task, thread_t* tp)
 #endif
     context_set(&t->ctx, CTX_KENTRY, (register_t)&syscall_ret);
     sched_start(t, curthread->basepri, SCHED_RR);
+    if ((curtask->flags & TF_SYSTEM) == 0)
+        t->affinity = curthread->affinity;
     t->suscnt = task->suscnt + 1;
 
     /*
@@ -401,6 +405,59 @@ int thread_schedparam(thread_t t, int op, int* param)
     return error;
 }
 
+/*
+ * thread_setaffinity - set the CPUs a thread may run on.
+ *
+ * CPUs that are not running are dropped from the mask, and
+ * EINVAL is returned if none is left.  The permission rules
+ * are the same as for thread_schedparam().
+ */
+int thread_setaffinity(thread_t t, u_int mask)
+{
+
+    sched_lock();
+    if (!thread_valid(t)) {
+        sched_unlock();
+        return ESRCH;
+    }
+    if (t->task->flags & TF_SYSTEM) {
+        sched_unlock();
+        return EINVAL;
+    }
+    if (!(t->task == curtask || t->task->parent == curtask) && !task_capable(CAP_NICE)) {
+        sched_unlock();
+        return EPERM;
+    }
+    mask &= cpu_online;
+    if (mask == 0) {
+        sched_unlock();
+        return EINVAL;
+    }
+    sched_setaffinity(t, mask);
+    sched_unlock();
+    return 0;
+}
+
+/*
+ * thread_getaffinity - get the CPUs a thread may run on.
+ */
+int thread_getaffinity(thread_t t, u_int* mask)
+{
+    u_int m;
+
+    sched_lock();
+    if (!thread_valid(t)) {
+        sched_unlock();
+        return ESRCH;
+    }
+    m = t->affinity & cpu_online;
+    sched_unlock();
+
+    if (copyout(&m, mask, sizeof(m)))
+        return EFAULT;
+    return 0;
+}
+
 /*
  * Idle thread.
  *
@@ -435,6 +492,8 @@ static thread_t thread_allocate(task_t task)
 
     t->kstack = stack;
     t->task = task;
+    t->affinity = ~0U;
+    t->lastcpu = -1;
     list_init(&t->mutexes);
     list_insert(&thread_list, &t->link);
     list_insert(&task->threads, &t->task_link);
@@ -454,6 +513,8 @@ static thread_t thread_allocate(task_t task)
 static void thread_deallocate(thread_t t)
 {
 
+    if (t != curthread)
+        acct_exit(t);
     list_remove(&t->task_link);
     list_remove(&t->link);
     t->excbits = 0;
@@ -511,6 +572,7 @@ int thread_info(struct threadinfo* info)
             info->active = (t == curthread) ? 1 : 0;
             strlcpy(info->taskname, t->task->name, MAXTASKNAME);
             strlcpy(info->slpevt, t->slpevt ? t->slpevt->name : "-", MAXEVTNAME);
+            acct_thread(t, &info->usage);
             sched_unlock();
             return 0;
         }
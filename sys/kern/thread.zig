@@ -43,6 +43,9 @@ pub var idle_thread: kern.Thread = std.mem.zeroes(kern.Thread);
 var zombie: kern.ThreadRef = null;
 var thread_list: hal.List = undefined;
 
+const NCPUS = if (@hasDecl(ffi.raw, "CONFIG_SMP_NCPUS")) ffi.raw.CONFIG_SMP_NCPUS else 1;
+const ALLCPUS: c_uint = if (NCPUS >= 32) ~@as(c_uint, 0) else (@as(c_uint, 1) << NCPUS) - 1;
+
 pub var curthread: kern.ThreadRef = &idle_thread;
 pub var irq_nesting: c_int = 0;
 pub var curspl: c_int = 15;
@@ -81,6 +84,8 @@ fn allocate(tsk: kern.TaskRef) kern.ThreadRef {
     _ = lib.memset(t, 0, @sizeOf(kern.Thread));
     t.*.kstack = stack;
     t.*.task = tsk;
+    t.*.affinity = ~@as(c_uint, 0);
+    t.*.lastcpu = -1;
     list_init(&t.*.mutexes);
     list_insert(&thread_list, &t.*.link);
     list_insert(&tsk.*.threads, &t.*.task_link);
@@ -90,6 +95,8 @@ fn allocate(tsk: kern.TaskRef) kern.ThreadRef {
 }
 
 fn deallocate(t: kern.ThreadRef) void {
+    // The current thread is folded into its task at its final switch.
+    if (t != kutil.get_curthread()) ffi.acct.exit(t);
     list_remove(&t.*.task_link);
     list_remove(&t.*.link);
     t.*.excbits = 0;
@@ -345,6 +352,51 @@ pub fn schedparam(t: kern.ThreadRef, op: c_int, param: ?*c_int) callconv(.c) c_i
     return err;
 }
 
+// Set the CPUs the thread may run on. The scheduler only hands a
+// thread to a CPU in its mask.
+pub fn setaffinity(t: kern.ThreadRef, mask: c_uint) callconv(.c) c_int {
+    sched.lock();
+    defer sched.unlock();
+
+    if (valid(t) == 0) {
+        return kern.Errno.ESRCH;
+    }
+    if (t.*.task.*.flags & kern.TF_SYSTEM != 0) {
+        return kern.Errno.EINVAL;
+    }
+    if (!(t.*.task == kutil.get_curtask() or t.*.task.*.parent == kutil.get_curtask()) and task.capable(kern.CAP_NICE) == 0) {
+        return kern.Errno.EPERM;
+    }
+    if (mask & ALLCPUS == 0) {
+        return kern.Errno.EINVAL;
+    }
+    t.*.affinity = mask & ALLCPUS;
+    if (comptime @hasDecl(ffi.raw, "CONFIG_SMP")) {
+        // Move away from this CPU at the next reschedule.
+        if (t == kutil.get_curthread() and t.*.affinity & (@as(c_uint, 1) << @intCast(ffi.smp.curcpu().cpu_id)) == 0) {
+            t.*.resched = 1;
+        }
+    }
+    return 0;
+}
+
+pub fn getaffinity(t: kern.ThreadRef, mask: ?*c_uint) callconv(.c) c_int {
+    var m: c_uint = undefined;
+
+    {
+        sched.lock();
+        defer sched.unlock();
+        if (valid(t) == 0) {
+            return kern.Errno.ESRCH;
+        }
+        m = t.*.affinity & ALLCPUS;
+    }
+    if (hal.copyout(&m, mask, @sizeOf(c_uint)) != 0) {
+        return kern.Errno.EFAULT;
+    }
+    return 0;
+}
+
 pub fn idle() callconv(.c) void {
     while (true) {
         hal.machine_idle();
@@ -374,6 +426,7 @@ pub fn info(tinfo: ?*hal.ThreadInfo) callconv(.c) c_int {
             tinfo.?.active = if (t == @as(?*kern.Thread, @ptrCast(kutil.get_curthread().?))) 1 else 0;
             _ = lib.strlcpy(@ptrCast(&tinfo.?.taskname), @ptrCast(&t.task.*.name), hal.MAXTASKNAME);
             _ = lib.strlcpy(@ptrCast(&tinfo.?.slpevt), if (t.slpevt) |evt| @as([*c]const u8, @ptrCast(evt.*.name)) else @as([*c]const u8, "-"), hal.MAXEVTNAME);
+            ffi.acct.thread(t, &tinfo.?.usage);
             return 0;
         }
         i += 1;
@@ -42,15 +42,47 @@
 #include <sys/signal.h>
 #include <smp.h>
 #include <deadlock.h>
+#include <vm.h>
+#include <trace.h>
+#include <prof.h>
+
+/*
+ * Per-CPU timer queue.
+ *
+ * A timer is queued on the CPU that armed it, and only the clock
+ * tick of that CPU checks it for expiration.  Expired one-shot
+ * timers are called out by the timer thread bound to the same CPU.
+ * A periodic timer is moved to the CPU of its thread when the
+ * thread waits for the next period on another CPU.
+ *
+ * The queue lock protects the lists and the state and cpu fields of
+ * the timers on them.  Arming the same timer from two CPUs at once
+ * is not allowed; the callers are serialized by the BKL.
+ */
+struct timerq
+{
+    spinlock_t lock;         /* lock for this queue */
+    struct list timer_list;  /* list of active timers */
+    struct list expire_list; /* list of expired timers */
+    struct event event;      /* event to wakeup the timer thread */
+    u_int active;            /* number of timers on both lists */
+    u_long expired;          /* one-shot timers expired */
+    u_long periodic;         /* periodic timers expired */
+    u_long migrated;         /* timers moved in from other CPUs */
+    u_long late[NTIMERLATE]; /* expirations by lateness */
+} __attribute__((aligned(64)));
+
+#ifdef CONFIG_SMP
+#define NTIMERQ CONFIG_SMP_NCPUS
+#else
+#define NTIMERQ 1
+#endif
 
 static volatile u_long lbolt;      /* ticks elapsed since bootup */
 static volatile u_long idle_ticks; /* total ticks for idle */
-static spinlock_t timer_lock = SPINLOCK_INITIALIZER;
 
-static struct event timer_event; /* event to wakeup a timer thread */
-static struct event delay_event; /* event for the thread delay */
-static struct list timer_list;   /* list of active timers */
-static struct list expire_list;  /* list of expired timers */
+static struct event delay_event;      /* event for the thread delay */
+static struct timerq timerq[NTIMERQ]; /* timer queue for each CPU */
 
 /*
  * Get remaining ticks to the expiration time.
@@ -65,30 +97,79 @@ static u_long time_remain(u_long expire)
 }
 
 /*
- * Activate a timer.
+ * Lock the queue that holds an active timer.
+ * Returns NULL with no lock held if the timer is not active.
  */
-static void timer_add(struct timer* tmr, u_long ticks)
+static struct timerq* timer_lockq(struct timer* tmr)
 {
-    list_t head, n;
-    struct timer* t;
+    struct timerq* tq;
+    int cpu;
 
-    if (ticks == 0)
-        ticks++;
+    for (;;) {
+        cpu = tmr->cpu;
+        if (tmr->state != TM_ACTIVE || cpu < 0 || cpu >= NTIMERQ)
+            return NULL;
+        tq = &timerq[cpu];
+        spinlock_lock(&tq->lock);
+        if (tmr->state == TM_ACTIVE && tmr->cpu == cpu)
+            return tq;
+        spinlock_unlock(&tq->lock);
+    }
+}
 
-    tmr->expire = lbolt + ticks;
-    tmr->state = TM_ACTIVE;
+/*
+ * Insert a timer into a queue.
+ * The queue must be locked.
+ */
+static void timerq_insert(struct timerq* tq, struct timer* tmr)
+{
+    list_t head, n;
+    struct timer* t;
 
     /*
      * Insert a timer element into the timer list which
      * is sorted by expiration time.
      */
-    head = &timer_list;
+    head = &tq->timer_list;
     for (n = list_first(head); n != head; n = list_next(n)) {
         t = list_entry(n, struct timer, link);
         if (time_before(tmr->expire, t->expire))
             break;
     }
     list_insert(list_prev(n), &tmr->link);
+    tmr->state = TM_ACTIVE;
+    tmr->cpu = (int)(tq - timerq);
+    tq->active++;
+}
+
+/*
+ * Remove a timer from its queue.
+ * The queue must be locked.
+ */
+static void timerq_remove(struct timerq* tq, struct timer* tmr)
+{
+
+    list_remove(&tmr->link);
+    tmr->state = TM_STOP;
+    tq->active--;
+}
+
+/*
+ * Activate a timer on the queue of the current CPU.
+ * The timer must not be active.
+ */
+static void timer_add(struct timer* tmr, u_long ticks)
+{
+    struct timerq* tq;
+
+    if (ticks == 0)
+        ticks++;
+
+    tq = &timerq[smp_processor_id()];
+    spinlock_lock(&tq->lock);
+    tmr->expire = lbolt + ticks;
+    timerq_insert(tq, tmr);
+    spinlock_unlock(&tq->lock);
 }
 
 /*
@@ -96,16 +177,17 @@ static void timer_add(struct timer* tmr, u_long ticks)
  */
 void timer_stop(struct timer* tmr)
 {
+    struct timerq* tq;
     int s;
 
     ASSERT(tmr != NULL);
 
-    spinlock_lock_irq(&timer_lock, &s);
-    if (tmr->state == TM_ACTIVE) {
-        list_remove(&tmr->link);
-        tmr->state = TM_STOP;
+    s = splhigh();
+    if ((tq = timer_lockq(tmr)) != NULL) {
+        timerq_remove(tq, tmr);
+        spinlock_unlock(&tq->lock);
     }
-    spinlock_unlock_irq(&timer_lock, s);
+    splx(s);
 }
 
 /*
@@ -117,22 +199,23 @@ void timer_stop(struct timer* tmr)
  */
 void timer_callout(struct timer* tmr, u_long msec, void (*fn)(void*), void* arg)
 {
+    struct timerq* tq;
     int s;
 
     ASSERT(tmr != NULL);
     ASSERT(fn != NULL);
 
-    spinlock_lock_irq(&timer_lock, &s);
-
-    if (tmr->state == TM_ACTIVE)
-        list_remove(&tmr->link);
+    s = splhigh();
+    if ((tq = timer_lockq(tmr)) != NULL) {
+        timerq_remove(tq, tmr);
+        spinlock_unlock(&tq->lock);
+    }
 
     tmr->func = fn;
     tmr->arg = arg;
     tmr->interval = 0;
     timer_add(tmr, mstohz(msec));
-
-    spinlock_unlock_irq(&timer_lock, s);
+    splx(s);
 }
 
 /*
@@ -198,20 +281,23 @@ static void alarm_expire(void* arg)
  */
 int timer_alarm(u_long msec, u_long* remain)
 {
+    struct timerq* tq;
     struct timer* tmr;
     u_long left = 0;
     int s;
 
-    spinlock_lock_irq(&timer_lock, &s);
     tmr = &curtask->alarm;
 
     /*
      * If the timer is active, save the remaining time
      * before we update the timer setting.
      */
-    if (tmr->state == TM_ACTIVE)
+    s = splhigh();
+    if ((tq = timer_lockq(tmr)) != NULL) {
         left = hztoms(time_remain(tmr->expire));
-    spinlock_unlock_irq(&timer_lock, s);
+        spinlock_unlock(&tq->lock);
+    }
+    splx(s);
 
     if (msec == 0)
         timer_stop(tmr);
@@ -266,7 +352,7 @@ int timer_periodic(thread_t t, u_long start, u_long period)
              * This is to save the data area in the thread
              * structure.
              */
-            if ((tmr = kmem_alloc(sizeof(tmr))) == NULL) {
+            if ((tmr = kmem_alloc(sizeof(*tmr))) == NULL) {
                 sched_unlock();
                 return ENOMEM;
             }
@@ -277,17 +363,46 @@ int timer_periodic(thread_t t, u_long start, u_long period)
         /*
          * Program an interval timer.
          */
-        spinlock_lock_irq(&timer_lock, &s);
+        s = splhigh();
+        timer_stop(tmr);
         tmr->interval = mstohz(period);
         if (tmr->interval == 0)
             tmr->interval = 1;
         timer_add(tmr, mstohz(start));
-        spinlock_unlock_irq(&timer_lock, s);
+        splx(s);
     }
     sched_unlock();
     return 0;
 }
 
+/*
+ * Move an active timer to the queue of the current CPU.
+ * The expiration time is kept.
+ */
+static void timer_migrate(struct timer* tmr)
+{
+#ifdef CONFIG_SMP
+    struct timerq *tq, *newq;
+    int s;
+
+    newq = &timerq[smp_processor_id()];
+    if (tmr->cpu == (int)(newq - timerq))
+        return;
+
+    s = splhigh();
+    if ((tq = timer_lockq(tmr)) != NULL) {
+        timerq_remove(tq, tmr);
+        spinlock_unlock(&tq->lock);
+
+        spinlock_lock(&newq->lock);
+        timerq_insert(newq, tmr);
+        newq->migrated++;
+        spinlock_unlock(&newq->lock);
+    }
+    splx(s);
+#endif
+}
+
 /*
  * timer_waitperiod - wait next period of the periodic timer.
  *
@@ -305,6 +420,8 @@ int timer_waitperiod(void)
     if (tmr == NULL || tmr->state != TM_ACTIVE)
         return EINVAL;
 
+    timer_migrate(tmr);
+
     if (time_before(lbolt, tmr->expire)) {
         /*
          * Sleep until timer_handler() routine wakes us up.
@@ -332,36 +449,32 @@ void timer_cancel(thread_t t)
 /*
  * Timer thread.
  *
- * Handle all expired timers. Each callout routine is
+ * Each CPU has its own timer thread, which handles the expired
+ * timers of the queue of that CPU. Each callout routine is
  * called with scheduler locked and interrupts enabled.
  */
-static void timer_thread(void* dummy)
+static void timer_thread(void* arg)
 {
+    struct timerq* tq = arg;
     struct timer* tmr;
 
     splhigh();
 
     for (;;) {
-        /*
-         * Wait until next timer expiration.
-         */
-        sched_sleep(&timer_event);
-
 #if defined(DEBUG) && defined(CONFIG_KD)
         uint32_t iters_expire = 0;
 #endif
-        spinlock_lock(&timer_lock);
-        while (!list_empty(&expire_list)) {
+        spinlock_lock(&tq->lock);
+        while (!list_empty(&tq->expire_list)) {
 #if defined(DEBUG) && defined(CONFIG_KD)
             deadlock_check_loop("timer_thread (expire_list)", &iters_expire);
 #endif
             /*
              * callout
              */
-            tmr = timer_next(&expire_list);
-            list_remove(&tmr->link);
-            tmr->state = TM_STOP;
-            spinlock_unlock(&timer_lock);
+            tmr = timer_next(&tq->expire_list);
+            timerq_remove(tq, tmr);
+            spinlock_unlock(&tq->lock);
             sched_lock();
             spl0();
             (*tmr->func)(tmr->arg);
@@ -372,25 +485,86 @@ static void timer_thread(void* dummy)
              */
             sched_unlock();
             splhigh();
-            spinlock_lock(&timer_lock);
+            spinlock_lock(&tq->lock);
         }
-        spinlock_unlock(&timer_lock);
+        spinlock_unlock(&tq->lock);
+
+        /*
+         * Wait until next timer expiration. The local clock
+         * tick can not come in before we sleep, since the
+         * interrupts are disabled.
+         */
+        sched_sleep(&tq->event);
     }
     /* NOTREACHED */
 }
 
+/*
+ * Check the timer queue of the current CPU for expired timers.
+ * Returns true if a one-shot timer has expired.
+ */
+static int timerq_expire(struct timerq* tq)
+{
+    struct timer* tmr;
+    u_long late;
+    int expired = 0;
+
+    spinlock_lock(&tq->lock);
+#if defined(DEBUG) && defined(CONFIG_KD)
+    uint32_t iters_timer = 0;
+#endif
+    while (!list_empty(&tq->timer_list)) {
+#if defined(DEBUG) && defined(CONFIG_KD)
+        deadlock_check_loop("timer_handler (timer_list)", &iters_timer);
+#endif
+        /*
+         * Check timer expiration.
+         */
+        tmr = timer_next(&tq->timer_list);
+        if (time_before(lbolt, tmr->expire))
+            break;
+
+        late = lbolt - tmr->expire;
+        tq->late[late < NTIMERLATE - 1 ? late : NTIMERLATE - 1]++;
+        TRACE(TR_TIMER, tmr, late);
+
+        list_remove(&tmr->link);
+        if (tmr->interval != 0) {
+            /*
+             * Periodic timer - reprogram timer again.
+             */
+            tmr->expire += tmr->interval;
+            if (time_before(tmr->expire, lbolt + 1))
+                tmr->expire = lbolt + 1;
+            tq->active--;
+            timerq_insert(tq, tmr);
+            tq->periodic++;
+            spinlock_unlock(&tq->lock);
+            sched_wakeup(&tmr->event);
+            spinlock_lock(&tq->lock);
+        } else {
+            /*
+             * One-shot timer
+             */
+            list_insert(&tq->expire_list, &tmr->link);
+            tq->expired++;
+            expired = 1;
+        }
+    }
+    spinlock_unlock(&tq->lock);
+    return expired;
+}
+
 /*
  * Handle clock interrupts.
  *
  * timer_handler() is called directly from the real time clock
- * interrupt.  All interrupts are still disabled at the entry
- * of this routine.
+ * interrupt on every CPU.  All interrupts are still disabled at
+ * the entry of this routine.
  */
 void timer_handler(void)
 {
-    struct timer* tmr;
-    u_long ticks;
-    int wakeup = 0;
+    struct timerq* tq;
 
     if (smp_processor_id() == 0) {
         /*
@@ -400,48 +574,23 @@ void timer_handler(void)
         lbolt++;
         if (curthread->priority == PRI_IDLE)
             idle_ticks++;
-
-        spinlock_lock(&timer_lock);
-#if defined(DEBUG) && defined(CONFIG_KD)
-        uint32_t iters_timer = 0;
+#ifdef CONFIG_MMU
+        KDATA_BEGIN(kdata);
+        kdata->ticks = lbolt;
+        KDATA_END(kdata);
 #endif
-        while (!list_empty(&timer_list)) {
-#if defined(DEBUG) && defined(CONFIG_KD)
-            deadlock_check_loop("timer_handler (timer_list)", &iters_timer);
-#endif
-            /*
-             * Check timer expiration.
-             */
-            tmr = timer_next(&timer_list);
-            if (time_before(lbolt, tmr->expire))
-                break;
-
-            list_remove(&tmr->link);
-            if (tmr->interval != 0) {
-                /*
-                 * Periodic timer - reprogram timer again.
-                 */
-                ticks = time_remain(tmr->expire + tmr->interval);
-                timer_add(tmr, ticks);
-                spinlock_unlock(&timer_lock);
-                sched_wakeup(&tmr->event);
-                spinlock_lock(&timer_lock);
-            } else {
-                /*
-                 * One-shot timer
-                 */
-                list_insert(&expire_list, &tmr->link);
-                wakeup = 1;
-            }
-        }
-        spinlock_unlock(&timer_lock);
-        if (wakeup)
-            sched_wakeup(&timer_event);
+    }
 
+    tq = &timerq[smp_processor_id()];
+    if (timerq_expire(tq))
+        sched_wakeup(&tq->event);
+
+    if (smp_processor_id() == 0) {
         deadlock_heartbeat();
         deadlock_proactive_check();
     }
 
+    PROF_TICK();
     sched_tick();
 }
 
@@ -465,17 +614,47 @@ void timer_info(struct timerinfo* info)
     info->idleticks = idle_ticks;
 }
 
+/*
+ * Return the statistics of a per-CPU timer queue.
+ */
+int timerq_info(struct timerqinfo* info)
+{
+    struct timerq* tq;
+    int i;
+
+    if (info->cookie < 0 || info->cookie >= NTIMERQ)
+        return ESRCH;
+
+    tq = &timerq[info->cookie];
+    info->cpu = info->cookie;
+    info->active = tq->active;
+    info->expired = tq->expired;
+    info->periodic = tq->periodic;
+    info->migrated = tq->migrated;
+    for (i = 0; i < NTIMERLATE; i++)
+        info->late[i] = tq->late[i];
+    info->cookie++;
+    return 0;
+}
+
 /*
  * Initialize the timer facility, called at system startup time.
  */
 void timer_init(void)
 {
+    thread_t t;
+    int i;
 
-    event_init(&timer_event, "timer");
     event_init(&delay_event, "delay");
-    list_init(&timer_list);
-    list_init(&expire_list);
-
-    if (kthread_create(&timer_thread, NULL, PRI_TIMER) == NULL)
-        panic("timer_init");
+    for (i = 0; i < NTIMERQ; i++) {
+        spinlock_init(&timerq[i].lock);
+        list_init(&timerq[i].timer_list);
+        list_init(&timerq[i].expire_list);
+        event_init(&timerq[i].event, "timer");
+        lockstat_register(&timerq[i].lock, "timer");
+
+        if ((t = kthread_create(&timer_thread, &timerq[i], PRI_TIMER)) == NULL)
+            panic("timer_init");
+        sched_setaffinity(t, 1U << i);
+    }
 }
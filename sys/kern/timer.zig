@@ -45,17 +45,41 @@ const TM_ACTIVE: c_int = 0x54616321; // 'Tac!'
 const TM_STOP: c_int = 0x54737421; // 'Tst!'
 const SIGALRM: c_int = 14;
 
+// ---------------------------------------------------------------------------
+// Per-CPU timer queue
+//
+// A timer is queued on the CPU that armed it, and only the clock tick of
+// that CPU checks it for expiration. Expired one-shot timers are called
+// out by the timer thread bound to the same CPU. A periodic timer is moved
+// to the CPU of its thread when the thread waits for the next period on
+// another CPU.
+//
+// The queue lock protects the lists and the state and cpu fields of the
+// timers on them.
+// ---------------------------------------------------------------------------
+const NTIMERQ = if (@hasDecl(ffi.raw, "CONFIG_SMP")) ffi.raw.CONFIG_SMP_NCPUS else 1;
+const NTIMERLATE = ffi.raw.NTIMERLATE;
+
+const TimerQ = struct {
+    lock: hal.Spinlock align(64), // lock for this queue
+    timer_list: hal.List, // list of active timers
+    expire_list: hal.List, // list of expired timers
+    event: hal.Event, // event to wakeup the timer thread
+    active: c_uint, // number of timers on both lists
+    expired: c_ulong, // one-shot timers expired
+    periodic: c_ulong, // periodic timers expired
+    migrated: c_ulong, // timers moved in from other CPUs
+    late: [NTIMERLATE]c_ulong, // expirations by lateness
+};
+
 // ---------------------------------------------------------------------------
 // Local global variables
 // ---------------------------------------------------------------------------
 var lbolt: c_ulong = 0;
 var idle_ticks: c_ulong = 0;
-var timer_lock: hal.Spinlock = .{ .value = hal.SPINLOCK_INITIALIZER };
 
-var timer_event: hal.Event = std.mem.zeroes(hal.Event);
 var delay_event: hal.Event = std.mem.zeroes(hal.Event);
-var timer_list: hal.List = std.mem.zeroes(hal.List);
-var expire_list: hal.List = std.mem.zeroes(hal.List);
+var timerq: [NTIMERQ]TimerQ = undefined;
 
 // ---------------------------------------------------------------------------
 // Inline helper functions for lists and events
@@ -97,6 +121,10 @@ inline fn timerNext(head: *hal.List) *hal.Timer {
     return lib.IntrusiveList(hal.Timer, hal.List, "link").parent(n);
 }
 
+inline fn localq() *TimerQ {
+    return &timerq[@intCast(smp.processor_id())];
+}
+
 // ---------------------------------------------------------------------------
 // Static (internal) helpers
 // ---------------------------------------------------------------------------
@@ -108,21 +136,116 @@ fn time_remain(expire: c_ulong) c_ulong {
     return 0;
 }
 
+// Lock the queue that holds an active timer. Returns null with no lock
+// held if the timer is not active.
+fn timerLockq(tmr: *hal.Timer) ?*TimerQ {
+    while (true) {
+        const cpu = @atomicLoad(c_int, &tmr.cpu, .monotonic);
+        if (@atomicLoad(c_int, &tmr.state, .monotonic) != TM_ACTIVE or cpu < 0 or cpu >= NTIMERQ)
+            return null;
+        const tq = &timerq[@intCast(cpu)];
+        tq.lock.lock();
+        if (tmr.state == TM_ACTIVE and tmr.cpu == cpu)
+            return tq;
+        tq.lock.unlock();
+    }
+}
+
+// Insert a timer into a queue, sorted by expiration time. The queue must
+// be locked.
+fn timerqInsert(tq: *TimerQ, tmr: *hal.Timer) void {
+    const head = &tq.timer_list;
+    var n: *hal.List = @ptrCast(head.next.?);
+    while (n != head) : (n = @ptrCast(n.next.?)) {
+        const t = lib.IntrusiveList(hal.Timer, hal.List, "link").parent(n);
+        if (time_before(tmr.expire, t.expire))
+            break;
+    }
+    list_insert(@ptrCast(n.prev.?), &tmr.link);
+    tmr.state = TM_ACTIVE;
+    tmr.cpu = @intCast((@intFromPtr(tq) - @intFromPtr(&timerq[0])) / @sizeOf(TimerQ));
+    tq.active += 1;
+}
+
+// Remove a timer from its queue. The queue must be locked.
+fn timerqRemove(tq: *TimerQ, tmr: *hal.Timer) void {
+    list_remove(&tmr.link);
+    tmr.state = TM_STOP;
+    tq.active -= 1;
+}
+
+// Activate a timer on the queue of the current CPU. The timer must not
+// be active.
 fn timerAdd(tmr: *hal.Timer, tck: c_ulong) void {
     var ticks_val = tck;
     if (ticks_val == 0) ticks_val = 1;
 
+    const tq = localq();
+    tq.lock.lock();
     tmr.expire = lbolt +% ticks_val;
-    tmr.state = TM_ACTIVE;
+    timerqInsert(tq, tmr);
+    tq.lock.unlock();
+}
 
-    const head = &timer_list;
-    var n: *hal.List = head;
-    while (n.next != head) : (n = @ptrCast(n.next.?)) {
-        const t = timerNext(n);
-        if (time_before(tmr.expire, t.expire))
+// Move an active timer to the queue of the current CPU. The expiration
+// time is kept.
+fn timerMigrate(tmr: *hal.Timer) void {
+    if (comptime @hasDecl(ffi.raw, "CONFIG_SMP")) {
+        const newq = localq();
+        if (tmr.cpu == smp.processor_id())
+            return;
+
+        const s = hal.splhigh();
+        if (timerLockq(tmr)) |tq| {
+            timerqRemove(tq, tmr);
+            tq.lock.unlock();
+
+            newq.lock.lock();
+            timerqInsert(newq, tmr);
+            newq.migrated +%= 1;
+            newq.lock.unlock();
+        }
+        _ = hal.splx(s);
+    }
+}
+
+// Check the timer queue of the current CPU for expired timers. Returns
+// true if a one-shot timer has expired.
+fn timerqExpire(tq: *TimerQ) bool {
+    var expired = false;
+
+    tq.lock.lock();
+    while (!list_empty(&tq.timer_list)) {
+        const tmr = timerNext(&tq.timer_list);
+        if (time_before(lbolt, tmr.expire))
             break;
+
+        const late = lbolt -% tmr.expire;
+        const slot: usize = @intCast(@min(late, NTIMERLATE - 1));
+        tq.late[slot] +%= 1;
+        ffi.trace.event(ffi.trace.TIMER, @truncate(@intFromPtr(tmr)), @truncate(late));
+
+        list_remove(&tmr.link);
+        if (tmr.interval != 0) {
+            // Periodic timer - reprogram timer again.
+            tmr.expire +%= tmr.interval;
+            if (time_before(tmr.expire, lbolt +% 1))
+                tmr.expire = lbolt +% 1;
+            tq.active -= 1;
+            timerqInsert(tq, tmr);
+            tq.periodic +%= 1;
+            tq.lock.unlock();
+            sched.wakeup(@ptrCast(&tmr.event));
+            tq.lock.lock();
+        } else {
+            // One-shot timer
+            list_insert(&tq.expire_list, &tmr.link);
+            tq.expired +%= 1;
+            expired = true;
+        }
     }
-    list_insert(@ptrCast(n.prev.?), &tmr.link);
+    tq.lock.unlock();
+    return expired;
 }
 
 fn alarm_expire(arg: ?*anyopaque) callconv(.c) void {
@@ -131,22 +254,19 @@ fn alarm_expire(arg: ?*anyopaque) callconv(.c) void {
 }
 
 // ---------------------------------------------------------------------------
-// Timer thread – handles expired timers
+// Timer thread – handles expired timers of one CPU
 // ---------------------------------------------------------------------------
 
-fn timerThread(dummy: ?*anyopaque) callconv(.c) void {
-    _ = dummy;
+fn timerThread(arg: ?*anyopaque) callconv(.c) void {
+    const tq: *TimerQ = @ptrCast(@alignCast(arg));
     _ = hal.splhigh();
 
     while (true) {
-        _ = sched.sleep(&timer_event);
-
-        timer_lock.lock();
-        while (!list_empty(&expire_list)) {
-            const tmr = timerNext(&expire_list);
-            list_remove(&tmr.link);
-            tmr.state = TM_STOP;
-            timer_lock.unlock();
+        tq.lock.lock();
+        while (!list_empty(&tq.expire_list)) {
+            const tmr = timerNext(&tq.expire_list);
+            timerqRemove(tq, tmr);
+            tq.lock.unlock();
             {
                 sched.lock();
                 defer sched.unlock();
@@ -155,9 +275,13 @@ fn timerThread(dummy: ?*anyopaque) callconv(.c) void {
                 func(tmr.arg);
                 _ = hal.splhigh();
             }
-            timer_lock.lock();
+            tq.lock.lock();
         }
-        timer_lock.unlock();
+        tq.lock.unlock();
+
+        // Wait until next timer expiration. The local clock tick can
+        // not come in before we sleep, since the interrupts are disabled.
+        _ = sched.sleep(&tq.event);
     }
 }
 
@@ -167,14 +291,12 @@ fn timerThread(dummy: ?*anyopaque) callconv(.c) void {
 
 /// stop – stop an active timer.
 pub fn stop(tmr: ?*hal.Timer) callconv(.c) void {
-    var s: c_int = undefined;
-
-    timer_lock.lock_irq(&s);
-    if (tmr.?.state == TM_ACTIVE) {
-        list_remove(&tmr.?.link);
-        tmr.?.state = TM_STOP;
+    const s = hal.splhigh();
+    if (timerLockq(tmr.?)) |tq| {
+        timerqRemove(tq, tmr.?);
+        tq.lock.unlock();
     }
-    timer_lock.unlock_irq(s);
+    _ = hal.splx(s);
 }
 
 /// callout – schedule a callout function after a specified delay.
@@ -184,19 +306,17 @@ pub fn callout(
     fn_ptr: ?*const fn (?*anyopaque) callconv(.c) void,
     arg: ?*anyopaque,
 ) callconv(.c) void {
-    var s: c_int = undefined;
-
-    timer_lock.lock_irq(&s);
-
-    if (tmr.?.state == TM_ACTIVE)
-        list_remove(&tmr.?.link);
+    const s = hal.splhigh();
+    if (timerLockq(tmr.?)) |tq| {
+        timerqRemove(tq, tmr.?);
+        tq.lock.unlock();
+    }
 
     tmr.?.func = fn_ptr;
     tmr.?.arg = arg;
     tmr.?.interval = 0;
     timerAdd(tmr.?, timer.mstohz(msec));
-
-    timer_lock.unlock_irq(s);
+    _ = hal.splx(s);
 }
 
 /// delay – delay thread execution for the specified time.
@@ -227,24 +347,23 @@ pub fn sleep(msec: c_ulong, remain: ?*c_ulong) callconv(.c) c_int {
 
 /// alarm – alarm system call.
 pub fn alarm(msec: c_ulong, remain: ?*c_ulong) callconv(.c) c_int {
-    var s: c_int = undefined;
     var left: c_ulong = 0;
 
-    timer_lock.lock_irq(&s);
     const cur_thread: ?*kern.Thread = kutil.get_curthread();
     const cur_task: ?*kern.Task = cur_thread.?.task;
     const tmr: *hal.Timer = @ptrCast(@alignCast(&cur_task.?.alarm));
 
-    if (tmr.state == TM_ACTIVE)
+    const s = hal.splhigh();
+    if (timerLockq(tmr)) |tq| {
         left = timer.hztoms(time_remain(tmr.expire));
-    timer_lock.unlock_irq(s);
+        tq.lock.unlock();
+    }
+    _ = hal.splx(s);
 
     if (msec == 0) {
         stop(tmr);
     } else {
-        const cur_thread2: ?*kern.Thread = kutil.get_curthread();
-        const cur_task2 = cur_thread2.?.task;
-        callout(tmr, msec, &alarm_expire, cur_task2);
+        callout(tmr, msec, &alarm_expire, cur_task);
     }
 
     if (remain != null) {
@@ -256,8 +375,6 @@ pub fn alarm(msec: c_ulong, remain: ?*c_ulong) callconv(.c) c_int {
 
 /// periodic – set periodic timer for the specified thread.
 pub fn periodic(t: kern.ThreadRef, start: c_ulong, period: c_ulong) callconv(.c) c_int {
-    var s: c_int = undefined;
-
     if (start != 0 and period == 0)
         return kern.Errno.EINVAL;
 
@@ -286,12 +403,13 @@ pub fn periodic(t: kern.ThreadRef, start: c_ulong, period: c_ulong) callconv(.c)
             event_init(&tmr.?.event, "periodic");
             thread_ptr.?.periodic = tmr;
         }
-        timer_lock.lock_irq(&s);
+        const s = hal.splhigh();
+        stop(tmr);
         tmr.?.interval = timer.mstohz(period);
         if (tmr.?.interval == 0)
             tmr.?.interval = 1;
         timerAdd(tmr.?, timer.mstohz(start));
-        timer_lock.unlock_irq(s);
+        _ = hal.splx(s);
     }
     return 0;
 }
@@ -303,6 +421,8 @@ pub fn waitperiod() callconv(.c) c_int {
     if (tmr == null or tmr.?.state != TM_ACTIVE)
         return kern.Errno.EINVAL;
 
+    timerMigrate(tmr.?);
+
     if (time_before(lbolt, tmr.?.expire)) {
         const rc = sched.sleep(&tmr.?.event);
         if (rc != kern.SLP_SUCCESS)
@@ -324,44 +444,35 @@ pub fn cancel(t_ref: kern.ThreadRef) callconv(.c) void {
     }
 }
 
-/// handler – handle clock interrupts.
+/// handler – handle clock interrupts on every CPU.
 pub fn handler() callconv(.c) void {
-    var wakeup: c_int = 0;
-
     if (smp.processor_id() == 0) {
         lbolt +%= 1;
         const cur_thread: ?*kern.Thread = kutil.get_curthread();
         if (cur_thread.?.priority == hal.PRI_IDLE)
             idle_ticks +%= 1;
-
-        timer_lock.lock();
-        while (!list_empty(&timer_list)) {
-            const tmr = timerNext(&timer_list);
-            if (time_before(lbolt, tmr.expire))
-                break;
-
-            list_remove(&tmr.link);
-            if (tmr.interval != 0) {
-                const ticks_val = time_remain(tmr.expire +% tmr.interval);
-                timerAdd(tmr, ticks_val);
-                timer_lock.unlock();
-                sched.wakeup(@ptrCast(&tmr.event));
-                timer_lock.lock();
-            } else {
-                list_insert(&expire_list, &tmr.link);
-                wakeup = 1;
-            }
+        if (comptime @hasDecl(ffi.raw, "CONFIG_MMU")) {
+            const kd: *volatile ffi.mem.KData = ffi.mem.kdata;
+            kd.seq +%= 1;
+            hal.zig_memory_barrier();
+            kd.ticks = lbolt;
+            hal.zig_memory_barrier();
+            kd.seq +%= 1;
         }
-        timer_lock.unlock();
-        if (wakeup != 0)
-            sched.wakeup(@ptrCast(&timer_event));
+    }
 
+    const tq = localq();
+    if (timerqExpire(tq))
+        sched.wakeup(@ptrCast(&tq.event));
+
+    if (smp.processor_id() == 0) {
         if (@hasDecl(ffi.raw, "DEBUG") and @hasDecl(ffi.raw, "CONFIG_KD")) {
             deadlock.heartbeat();
             deadlock.proactive_check();
         }
     }
 
+    ffi.prof.tick();
     sched.tick();
 }
 
@@ -379,30 +490,74 @@ pub fn info(timer_info_ptr: ?*hal.TimerInfo) callconv(.c) void {
     }
 }
 
+/// queueInfo – return the statistics of a per-CPU timer queue.
+pub fn queueInfo(inf: *hal.TimerqInfo) callconv(.c) c_int {
+    if (inf.cookie < 0 or inf.cookie >= NTIMERQ)
+        return kern.Errno.ESRCH;
+
+    const tq = &timerq[@intCast(inf.cookie)];
+    inf.cpu = inf.cookie;
+    inf.active = tq.active;
+    inf.expired = tq.expired;
+    inf.periodic = tq.periodic;
+    inf.migrated = tq.migrated;
+    for (0..NTIMERLATE) |i| inf.late[i] = tq.late[i];
+    inf.cookie += 1;
+    return 0;
+}
+
 /// init – initialize the timer facility.
 pub fn init() callconv(.c) void {
-    event_init(&timer_event, "timer");
     event_init(&delay_event, "delay");
-    list_init(&timer_list);
-    list_init(&expire_list);
-
-    if (thread.kcreate(&timerThread, null, hal.PRI_TIMER) == null)
-        lib.panic("init");
+    for (&timerq, 0..) |*tq, i| {
+        tq.* = std.mem.zeroes(TimerQ);
+        tq.lock = .{ .value = hal.SPINLOCK_INITIALIZER };
+        list_init(&tq.timer_list);
+        list_init(&tq.expire_list);
+        event_init(&tq.event, "timer");
+        if (comptime @hasDecl(ffi.raw, "CONFIG_LOCKSTAT"))
+            smp.lockstat_register(&tq.lock.value, "timer");
+
+        const t = thread.kcreate(&timerThread, tq, hal.PRI_TIMER);
+        if (t == null)
+            lib.panic("init");
+        t.?.*.affinity = @as(c_uint, 1) << @intCast(i);
+    }
 }
 
 // ---------------------------------------------------------------------------
 // Comptime exports – public API functions with strong C linkage
 // ---------------------------------------------------------------------------
 pub fn __broken_spinlock_lock(lock: ?*volatile ffi.raw.spinlock_t) callconv(.c) void {
-    if (comptime !@hasDecl(ffi.raw, "CONFIG_SMP")) return;
-    const l: *volatile i32 = @ptrCast(@alignCast(lock.?));
-    while (@atomicRmw(i32, l, .Xchg, 1, .seq_cst) != 0) {
-        while (l.* != 0) {}
+    if (comptime @hasDecl(ffi.raw, "CONFIG_SMP")) {
+        const l = lock.?;
+        const ticket = @atomicRmw(c_uint, &l.next, .Add, 1, .monotonic);
+        var spins: c_ulong = 0;
+        while (@atomicLoad(c_uint, &l.owner, .acquire) != ticket) {
+            spins += 1;
+        }
+        if (comptime @hasDecl(ffi.raw, "CONFIG_LOCKSTAT")) {
+            if (l.stat.registered == 0)
+                smp.lockstat_register(@volatileCast(l), null);
+            l.stat.acquired +%= 1;
+            if (spins > 0) {
+                l.stat.contended +%= 1;
+                l.stat.spins +%= spins;
+            }
+            l.stat.start = hal.clock_cycles();
+        }
     }
 }
 
 pub fn __broken_spinlock_unlock(lock: ?*volatile ffi.raw.spinlock_t) callconv(.c) void {
-    if (comptime !@hasDecl(ffi.raw, "CONFIG_SMP")) return;
-    const l: *volatile i32 = @ptrCast(@alignCast(lock.?));
-    @atomicStore(i32, l, 0, .seq_cst);
+    if (comptime @hasDecl(ffi.raw, "CONFIG_SMP")) {
+        const l = lock.?;
+        if (comptime @hasDecl(ffi.raw, "CONFIG_LOCKSTAT")) {
+            const held = hal.clock_cycles() -% l.stat.start;
+            l.stat.holdcycles +%= held;
+            if (held > l.stat.maxholdcycles)
+                l.stat.maxholdcycles = held;
+        }
+        @atomicStore(c_uint, &l.owner, l.owner +% 1, .release);
+    }
 }
@@ -0,0 +1,219 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * trace.c - kernel event tracing
+ */
+
+/**
+ * Each CPU has its own ring of binary trace records. The ring is
+ * written only by its CPU with interrupts disabled, so no lock is
+ * taken on the fast path. When a ring is full, the oldest records
+ * are overwritten and counted as lost by the next reader.
+ *
+ * A reader copies a few records to a bounce buffer, and checks
+ * the write count again to drop any record which was overwritten
+ * while it was being copied.
+ *
+ * The rings are allocated when tracing is first started, so the
+ * cost is one load and a branch per trace point while it is off.
+ */
+
+#include <kernel.h>
+#include <page.h>
+#include <sched.h>
+#include <task.h>
+#include <hal.h>
+#include <timer.h>
+#include <smp.h>
+#include <trace.h>
+
+#define TRACE_NEVENTS 1024 /* records per CPU, must be power of 2 */
+#define TRACE_CHUNK 16     /* records copied at once by a reader */
+
+#ifdef CONFIG_SMP
+#define NTRACEBUF CONFIG_SMP_NCPUS
+#else
+#define NTRACEBUF 1
+#endif
+
+struct tracebuf
+{
+    struct trace_event* ring; /* ring buffer */
+    volatile u_int head;      /* records written */
+    u_int tail;               /* records read */
+};
+
+volatile u_int trace_mask; /* enabled events */
+
+static struct tracebuf tracebuf[NTRACEBUF];
+
+/*
+ * Append an event to the ring of the current CPU.
+ */
+void trace_log(int type, uint32_t a0, uint32_t a1)
+{
+    struct tracebuf* tb;
+    struct trace_event* e;
+    int s, cpu;
+
+    s = splhigh();
+    cpu = smp_processor_id();
+    tb = &tracebuf[cpu];
+    if (tb->ring != NULL) {
+        e = &tb->ring[tb->head & (TRACE_NEVENTS - 1)];
+        e->time = clock_cycles();
+        e->tick = (uint32_t)timer_ticks();
+        e->thread = (uint32_t)curthread;
+        e->type = (uint16_t)type;
+        e->cpu = (uint16_t)cpu;
+        e->arg[0] = a0;
+        e->arg[1] = a1;
+        __atomic_store_n(&tb->head, tb->head + 1, __ATOMIC_RELEASE);
+    }
+    splx(s);
+}
+
+/*
+ * Allocate the rings and enable the events in the mask.
+ * Records left from the previous run are discarded.
+ */
+static int trace_start(u_int mask)
+{
+    struct tracebuf* tb;
+    paddr_t pa;
+    int i;
+
+    trace_mask = 0;
+    for (i = 0; i < NTRACEBUF; i++) {
+        tb = &tracebuf[i];
+        if (tb->ring == NULL) {
+            pa = page_alloc(TRACE_NEVENTS * sizeof(struct trace_event));
+            if (pa == 0)
+                return ENOMEM;
+            tb->ring = ptokv(pa);
+        }
+        tb->tail = tb->head;
+    }
+    trace_mask = mask & TRACE_ALL;
+    return 0;
+}
+
+/*
+ * Copy the pending records of one CPU to the user buffer.
+ */
+static int trace_read(struct trace_read* tr)
+{
+    struct trace_event chunk[TRACE_CHUNK];
+    struct tracebuf* tb;
+    u_int head, tail, lost = 0;
+    int i, n, skip, count = 0;
+
+    if (tr->cpu < 0 || tr->cpu >= NTRACEBUF)
+        return ESRCH;
+
+    tb = &tracebuf[tr->cpu];
+    if (tb->ring == NULL)
+        goto out;
+
+    tail = tb->tail;
+    while (count < tr->count) {
+        head = __atomic_load_n(&tb->head, __ATOMIC_ACQUIRE);
+        if (head - tail >= TRACE_NEVENTS) {
+            lost += head - tail - (TRACE_NEVENTS - 1);
+            tail = head - (TRACE_NEVENTS - 1);
+        }
+        n = (int)MIN(head - tail, TRACE_CHUNK);
+        n = MIN(n, tr->count - count);
+        if (n == 0)
+            break;
+        for (i = 0; i < n; i++)
+            chunk[i] = tb->ring[(tail + i) & (TRACE_NEVENTS - 1)];
+
+        /*
+         * Drop the records overwritten during the copy.  The slot
+         * at head may be half written, so it counts as lost too.
+         */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&tb->head, __ATOMIC_ACQUIRE);
+        skip = 0;
+        if (head - tail >= TRACE_NEVENTS) {
+            skip = (int)MIN(head - tail - (TRACE_NEVENTS - 1), (u_int)n);
+            lost += skip;
+        }
+        if (n > skip && copyout(&chunk[skip], &tr->events[count], (n - skip) * sizeof(struct trace_event))) {
+            tb->tail = tail;
+            return EFAULT;
+        }
+        count += n - skip;
+        tail += n;
+    }
+    tb->tail = tail;
+out:
+    tr->count = count;
+    tr->lost = lost;
+    tr->cyclehz = clock_cyclehz();
+    return 0;
+}
+
+/*
+ * Trace control system call.
+ */
+int sys_trace(int cmd, void* data)
+{
+    struct trace_read tr;
+    int error = 0;
+
+    if (!task_capable(CAP_TASKCTRL))
+        return EPERM;
+
+    sched_lock();
+    switch (cmd) {
+    case TRACE_START:
+        error = trace_start((u_int)data);
+        break;
+    case TRACE_STOP:
+        trace_mask = 0;
+        break;
+    case TRACE_READ:
+        if (copyin(data, &tr, sizeof(tr))) {
+            error = EFAULT;
+            break;
+        }
+        error = trace_read(&tr);
+        if (error == 0 && copyout(&tr, data, sizeof(tr)))
+            error = EFAULT;
+        break;
+    default:
+        error = EINVAL;
+        break;
+    }
+    sched_unlock();
+    return error;
+}
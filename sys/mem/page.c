@@ -118,6 +118,45 @@ paddr_t page_alloc(psize_t psize)
     return kvtop(blk);
 }
 
+/*
+ * page_alloc_aligned - allocate continuous pages whose physical
+ * address is aligned to the specified boundary.
+ *
+ * This is used to back large mappings with superpages. The
+ * alignment must be a power of two.
+ */
+paddr_t page_alloc_aligned(psize_t psize, psize_t align)
+{
+    struct page* blk;
+    paddr_t start, pa;
+    vsize_t size;
+
+    ASSERT(psize != 0);
+
+    if (align <= PAGE_SIZE)
+        return page_alloc(psize);
+
+    sched_lock();
+
+    /*
+     * Find the free block that has an aligned area of
+     * enough size, and carve the area out of it.
+     */
+    size = round_page(psize);
+    for (blk = page_head.next; blk != &page_head; blk = blk->next) {
+        start = kvtop(blk);
+        pa = (start + align - 1) & ~(align - 1);
+        if (pa + size <= start + blk->size) {
+            page_reserve(pa, size);
+            sched_unlock();
+            return pa;
+        }
+    }
+    sched_unlock();
+    DPRINTF(("page_alloc_aligned: out of memory\n"));
+    return 0;
+}
+
 static int page_is_ram(paddr_t pa)
 {
     struct bootinfo *bi;
@@ -122,6 +122,30 @@ pub fn alloc(psize: kern.Psize) callconv(.c) kern.Paddr {
     return ret_val;
 }
 
+pub fn alloc_aligned(psize: kern.Psize, alignment: kern.Psize) callconv(.c) kern.Paddr {
+    if (alignment <= hal.PAGE_SIZE) return alloc(psize);
+
+    sched.lock();
+    defer sched.unlock();
+
+    const size: kern.Paddr = @intCast(kutil.round_page(@as(usize, @intCast(psize))));
+    const mask: kern.Paddr = @intCast(alignment - 1);
+    var blk: ?*Page = page_head.next;
+
+    while (blk != &page_head and blk != null) {
+        const block = blk.?;
+        const start = kutil.kvtop(block);
+        const pa = (start + mask) & ~mask;
+        if (pa + size <= start + @as(kern.Paddr, @intCast(block.*.size))) {
+            _ = reserve(pa, @intCast(size));
+            dprintf("page_alloc_aligned: returning 0x%x\n", .{pa});
+            return pa;
+        }
+        blk = block.*.next;
+    }
+    return 0;
+}
+
 pub fn free(paddr: kern.Paddr, psize: kern.Psize) callconv(.c) void {
     sched.lock();
     defer sched.unlock();
@@ -42,6 +42,13 @@
  * it is guaranteed that the allocated memory is always continuing
  * and existing. Thereby, a kernel and drivers can be constructed
  * very simply.
+ *
+ * The only exception is a lazy segment. When the kernel chooses
+ * the address of the allocation, the segment is reserved without
+ * physical pages, and vm_fault() backs each page with zero-filled
+ * memory on first touch. When a kernel or a driver asks the
+ * physical address of an area in a lazy segment, only that area is
+ * moved to continuing pages, and the segment stays lazy.
  */
 
 #include <kernel.h>
@@ -52,6 +59,8 @@
 #include <sched.h>
 #include <hal.h>
 #include <vm.h>
+#include <trace.h>
+#include <acct.h>
 
 /* forward declarations */
 static void seg_init(struct seg*);
@@ -59,15 +68,26 @@ static struct seg* seg_create(struct seg*, vaddr_t, size_t);
 static void seg_delete(struct seg*, struct seg*);
 static struct seg* seg_lookup(struct seg*, vaddr_t, size_t);
 static struct seg* seg_alloc(struct seg*, size_t);
+static struct seg* seg_alloc_aligned(struct seg*, size_t, size_t);
+static paddr_t seg_page_alloc(vaddr_t, size_t);
 static void seg_free(struct seg*, struct seg*);
 static struct seg* seg_reserve(struct seg*, vaddr_t, size_t);
+static int seg_commit(vm_map_t, struct seg*, vaddr_t, size_t);
+static void seg_release(vm_map_t, struct seg*);
+static int seg_copy(vm_map_t, vm_map_t, struct seg*);
+static size_t seg_resident(vm_map_t, struct seg*);
+static int kdata_map(vm_map_t, vaddr_t, paddr_t);
+static int kdata_dup(vm_map_t, vm_map_t);
 static int do_allocate(vm_map_t, void**, size_t, int);
 static int do_free(vm_map_t, void*);
 static int do_attribute(vm_map_t, void*, int);
 static int do_map(vm_map_t, void*, size_t, void**);
 static vm_map_t do_dup(vm_map_t);
+static int do_fault(vaddr_t);
 
 static struct vm_map kernel_map; /* vm mapping for kernel */
+static paddr_t kdata_phys;       /* shared kernel data page */
+struct kdata* kdata;             /* kernel address of kdata_phys */
 
 /**
  * vm_allocate - allocate zero-filled memory for specified address
@@ -79,6 +99,9 @@ static struct vm_map kernel_map; /* vm mapping for kernel */
  * The allocated area has writable, user-access attribute by
  * default.  The "addr" and "size" argument will be adjusted
  * to page boundary.
+ *
+ * An area placed "anywhere" is not backed until it is touched,
+ * unless it is large enough to be mapped with superpages.
  */
 int vm_allocate(task_t task, void** addr, size_t size, int anywhere)
 {
@@ -118,6 +141,7 @@ static int do_allocate(vm_map_t map, void** addr, size_t size, int anywhere)
     struct seg* seg;
     vaddr_t start, end;
     paddr_t pa;
+    int lazy;
 
     if (size == 0)
         return EINVAL;
@@ -127,10 +151,20 @@ static int do_allocate(vm_map_t map, void** addr, size_t size, int anywhere)
     /*
      * Allocate segment
      */
+    lazy = 0;
     if (anywhere) {
         size = round_page(size);
-        if ((seg = seg_alloc(&map->head, size)) == NULL)
-            return ENOMEM;
+        seg = NULL;
+#ifdef SPAGE_SIZE
+        /* Place large area on superpage boundary */
+        if (size >= SPAGE_SIZE)
+            seg = seg_alloc_aligned(&map->head, size, SPAGE_SIZE);
+#endif
+        if (seg == NULL) {
+            if ((seg = seg_alloc(&map->head, size)) == NULL)
+                return ENOMEM;
+            lazy = 1;
+        }
     } else {
         start = trunc_page((vaddr_t)*addr);
         end = round_page(start + size);
@@ -141,10 +175,20 @@ static int do_allocate(vm_map_t map, void** addr, size_t size, int anywhere)
     }
     seg->flags = SEG_READ | SEG_WRITE;
 
+    /*
+     * Defer the page allocation to vm_fault().
+     */
+    if (lazy) {
+        seg->flags |= SEG_LAZY;
+        *addr = (void*)seg->addr;
+        map->total += size;
+        return 0;
+    }
+
     /*
      * Allocate physical pages, and map them into virtual address
      */
-    if ((pa = page_alloc(size)) == 0)
+    if ((pa = seg_page_alloc(seg->addr, size)) == 0)
         goto err1;
 
     if (mmu_map(map->pgd, pa, seg->addr, size, PG_WRITE))
@@ -213,16 +257,20 @@ static int do_free(vm_map_t map, void* addr)
     if (seg == NULL || seg->addr != va || (seg->flags & SEG_FREE))
         return EINVAL;
 
-    /*
-     * Unmap pages of the segment.
-     */
-    mmu_map(map->pgd, seg->phys, seg->addr, seg->size, PG_UNMAP);
+    if (seg->flags & SEG_LAZY) {
+        seg_release(map, seg);
+    } else {
+        /*
+         * Unmap pages of the segment.
+         */
+        mmu_map(map->pgd, seg->phys, seg->addr, seg->size, PG_UNMAP);
 
-    /*
-     * Relinquish use of the page if it is not shared and mapped.
-     */
-    if (!(seg->flags & SEG_SHARED) && !(seg->flags & SEG_MAPPED))
-        page_free(seg->phys, seg->size);
+        /*
+         * Relinquish use of the page if it is not shared and mapped.
+         */
+        if (!(seg->flags & SEG_SHARED) && !(seg->flags & SEG_MAPPED))
+            page_free(seg->phys, seg->size);
+    }
 
     map->total -= seg->size;
     seg_free(&map->head, seg);
@@ -271,7 +319,7 @@ static int do_attribute(vm_map_t map, void* addr, int attr)
     struct seg* seg;
     int new_flags, map_type;
     paddr_t old_pa, new_pa;
-    vaddr_t va;
+    vaddr_t va, pg;
 
     va = trunc_page((vaddr_t)addr);
 
@@ -312,7 +360,7 @@ static int do_attribute(vm_map_t map, void* addr, int attr)
         old_pa = seg->phys;
 
         /* Allocate new physical page. */
-        if ((new_pa = page_alloc(seg->size)) == 0)
+        if ((new_pa = seg_page_alloc(seg->addr, seg->size)) == 0)
             return ENOMEM;
 
         /* Copy source page */
@@ -331,6 +379,15 @@ static int do_attribute(vm_map_t map, void* addr, int attr)
         if (seg->sh_prev == seg->sh_next)
             seg->sh_prev->flags &= ~SEG_SHARED;
         seg->sh_next = seg->sh_prev = seg;
+    } else if (seg->flags & SEG_LAZY) {
+        /* Remap resident pages. The others are mapped on fault. */
+        for (pg = seg->addr; pg < seg->addr + seg->size; pg += PAGE_SIZE) {
+            if ((old_pa = mmu_extract(map->pgd, pg, PAGE_SIZE)) == 0)
+                continue;
+            if (mmu_map(map->pgd, old_pa, pg, PAGE_SIZE, map_type))
+                return ENOMEM;
+        }
+        new_flags |= SEG_LAZY;
     } else {
         if (mmu_map(map->pgd, seg->phys, seg->addr, seg->size, map_type))
             return ENOMEM;
@@ -405,6 +462,16 @@ static int do_map(vm_map_t map, void* addr, size_t size, void** alloc)
         return EINVAL; /* not allocated */
     tgt = seg;
 
+    /*
+     * The pages must be continuing to be shared.
+     */
+    if (tgt->flags & SEG_LAZY) {
+        if (seg_commit(map, tgt, start, size))
+            return ENOMEM;
+        pa = mmu_extract(map->pgd, start, size);
+    } else
+        pa = tgt->phys + (paddr_t)(start - tgt->addr);
+
     /*
      * Find the free segment in current task
      */
@@ -421,13 +488,12 @@ static int do_map(vm_map_t map, void* addr, size_t size, void** alloc)
     else
         map_type = PG_READ;
 
-    pa = tgt->phys + (paddr_t)(start - tgt->addr);
     if (mmu_map(curmap->pgd, pa, cur->addr, size, map_type)) {
         seg_free(&curmap->head, seg);
         return ENOMEM;
     }
 
-    cur->flags = tgt->flags | SEG_MAPPED;
+    cur->flags = (tgt->flags & ~SEG_LAZY) | SEG_MAPPED;
     cur->phys = pa;
 
     tmp = (void*)(cur->addr + offset);
@@ -453,6 +519,7 @@ vm_map_t vm_create(void)
 
     map->refcnt = 1;
     map->total = 0;
+    map->kdata = 0;
 
     /* Allocate new page directory */
     if ((map->pgd = mmu_newmap()) == NO_PGD) {
@@ -477,7 +544,9 @@ void vm_terminate(vm_map_t map)
     sched_lock();
     seg = &map->head;
     do {
-        if (seg->flags != SEG_FREE) {
+        if (seg->flags & SEG_LAZY) {
+            seg_release(map, seg);
+        } else if (seg->flags != SEG_FREE) {
             /* Unmap segment */
             mmu_map(map->pgd, seg->phys, seg->addr, seg->size, PG_UNMAP);
 
@@ -491,6 +560,9 @@ void vm_terminate(vm_map_t map)
         seg_delete(&map->head, tmp);
     } while (seg != &map->head);
 
+    if (map->kdata != 0)
+        page_free(map->kdata, PAGE_SIZE);
+
     if (map == curtask->map) {
         /*
          * Switch to the kernel page directory before
@@ -576,13 +648,20 @@ static vm_map_t do_dup(vm_map_t org_map)
              */
         } else {
             /* Check if the segment can be shared */
-            if (!(src->flags & SEG_WRITE) && !(src->flags & SEG_MAPPED)) {
+            if (!(src->flags & SEG_WRITE) && !(src->flags & SEG_MAPPED) && !(src->flags & SEG_LAZY)) {
                 dest->flags |= SEG_SHARED;
             }
 
+            if (dest->flags & SEG_LAZY) {
+                /* Copy resident pages only */
+                if (seg_copy(org_map, new_map, src))
+                    return NULL;
+                src = src->next;
+                continue;
+            }
             if (!(dest->flags & SEG_SHARED)) {
                 /* Allocate new physical page. */
-                dest->phys = page_alloc(src->size);
+                dest->phys = seg_page_alloc(src->addr, src->size);
                 if (dest->phys == 0)
                     return NULL;
 
@@ -617,6 +696,9 @@ static vm_map_t do_dup(vm_map_t org_map)
         dest = dest->next;
         src = src->next;
     } while (src != &org_map->head);
+
+    if (org_map->kdata != 0 && kdata_dup(org_map, new_map))
+        return NULL;
     return new_map;
 }
 
@@ -705,11 +787,93 @@ int vm_load(vm_map_t map, struct module* mod, void** stack)
 /*
  * Translate virtual address of current task to physical address.
  * Returns physical address on success, or NULL if no mapped memory.
+ *
+ * The area in a lazy segment is backed by continuing pages first,
+ * since the caller will access it through the physical address.
  */
 paddr_t vm_translate(vaddr_t addr, size_t size)
 {
+    vm_map_t map;
+    struct seg* seg;
+    paddr_t pa;
+
+    sched_lock();
+    map = curtask->map;
+    seg = seg_lookup(&map->head, addr, size);
+    if (seg != NULL && (seg->flags & SEG_LAZY) && seg_commit(map, seg, addr, size)) {
+        sched_unlock();
+        return 0;
+    }
+    pa = mmu_extract(map->pgd, addr, size);
+    sched_unlock();
+    return pa;
+}
+
+/*
+ * Handle a page fault of current task.
+ *
+ * This is called by the trap handler when the page at the
+ * specified address is not present. If the address is in a lazy
+ * segment, a zero-filled page is allocated and mapped there.
+ * Returns 0 if the faulting access can be retried, or errno if
+ * it must be handled as an exception.
+ */
+int vm_fault(vaddr_t addr)
+{
+    int error, mode;
+
+    mode = acct_mode(1);
+    error = do_fault(addr);
+    acct_mode(mode);
+    TRACE(TR_PGFAULT, addr, error);
+    return error;
+}
+
+static int do_fault(vaddr_t addr)
+{
+    vm_map_t map;
+    struct seg* seg;
+    vaddr_t va;
+    paddr_t pa;
 
-    return mmu_extract(curtask->map->pgd, addr, size);
+    if (!user_area(addr))
+        return EFAULT;
+
+    va = trunc_page(addr);
+
+    sched_lock();
+    map = curtask->map;
+    seg = seg_lookup(&map->head, va, PAGE_SIZE);
+    if (seg == NULL || (seg->flags & SEG_FREE)) {
+        sched_unlock();
+        return EFAULT;
+    }
+    if (mmu_extract(map->pgd, va, PAGE_SIZE) != 0) {
+        /*
+         * Another thread has already filled or moved this
+         * page while we were waiting for the lock. The trap
+         * handler checks that the access is allowed before
+         * it retries.
+         */
+        sched_unlock();
+        return 0;
+    }
+    if (!(seg->flags & SEG_LAZY)) {
+        sched_unlock();
+        return EFAULT;
+    }
+    if ((pa = page_alloc(PAGE_SIZE)) == 0) {
+        sched_unlock();
+        return ENOMEM;
+    }
+    memset(ptokv(pa), 0, PAGE_SIZE);
+    if (mmu_map(map->pgd, pa, va, PAGE_SIZE, (seg->flags & SEG_WRITE) ? PG_WRITE : PG_READ)) {
+        page_free(pa, PAGE_SIZE);
+        sched_unlock();
+        return ENOMEM;
+    }
+    sched_unlock();
+    return 0;
 }
 
 int vm_info(struct vminfo* info)
@@ -735,6 +899,7 @@ int vm_info(struct vminfo* info)
             info->size = seg->size;
             info->flags = seg->flags;
             info->phys = seg->phys;
+            info->resident = seg_resident(map, seg);
             sched_unlock();
             return 0;
         }
@@ -758,6 +923,82 @@ void vm_init(void)
 
     seg_init(&kernel_map.head);
     kernel_task.map = &kernel_map;
+
+    /*
+     * Setup the shared kernel data page.
+     */
+    if ((kdata_phys = page_alloc(PAGE_SIZE)) == 0)
+        panic("vm_init");
+    kdata = ptokv(kdata_phys);
+    memset(kdata, 0, PAGE_SIZE);
+    kdata->hz = CONFIG_HZ;
+    kdata->ncpus = 1;
+}
+
+/*
+ * Map the kernel data pages at the top of the user space.
+ * The shared page is mapped as is, and a new page is
+ * allocated to hold the identity of the task.
+ *
+ * Must be called with scheduler locked.
+ */
+int vm_kdata(vm_map_t map)
+{
+    paddr_t pa;
+
+    if ((pa = page_alloc(PAGE_SIZE)) == 0)
+        return ENOMEM;
+    memset(ptokv(pa), 0, PAGE_SIZE);
+
+    if (kdata_map(map, KDATA_BASE, kdata_phys) || kdata_map(map, KDATA_TASK, pa)) {
+        page_free(pa, PAGE_SIZE);
+        return ENOMEM;
+    }
+    map->kdata = pa;
+    return 0;
+}
+
+/*
+ * Map one kernel data page read-only. The segment is
+ * marked as mapped so that the page is never freed or
+ * made writable through it.
+ */
+static int kdata_map(vm_map_t map, vaddr_t va, paddr_t pa)
+{
+    struct seg* seg;
+
+    if ((seg = seg_reserve(&map->head, va, PAGE_SIZE)) == NULL)
+        return ENOMEM;
+    if (mmu_map(map->pgd, pa, va, PAGE_SIZE, PG_READ)) {
+        seg_free(&map->head, seg);
+        return ENOMEM;
+    }
+    seg->flags = SEG_READ | SEG_MAPPED;
+    seg->phys = pa;
+    map->total += PAGE_SIZE;
+    return 0;
+}
+
+/*
+ * Give a duplicated map its own copy of the task data page.
+ */
+static int kdata_dup(vm_map_t org_map, vm_map_t new_map)
+{
+    struct seg* seg;
+    paddr_t pa;
+
+    if ((pa = page_alloc(PAGE_SIZE)) == 0)
+        return ENOMEM;
+    memcpy(ptokv(pa), ptokv(org_map->kdata), PAGE_SIZE);
+    new_map->kdata = pa;
+
+    seg = seg_lookup(&new_map->head, KDATA_TASK, PAGE_SIZE);
+    if (seg != NULL && seg->phys == org_map->kdata && (seg->flags & SEG_MAPPED)) {
+        seg->phys = pa;
+        if (mmu_map(new_map->pgd, pa, KDATA_TASK, PAGE_SIZE, PG_READ))
+            return ENOMEM;
+    }
+    return 0;
 }
 
 /*
@@ -860,6 +1101,45 @@ static struct seg* seg_alloc(struct seg* head, size_t size)
     return NULL;
 }
 
+/*
+ * Allocate free segment for specified size at an address
+ * aligned to the specified boundary.
+ */
+static struct seg* seg_alloc_aligned(struct seg* head, size_t size, size_t align)
+{
+    struct seg* seg;
+    vaddr_t addr;
+
+    seg = head;
+    do {
+        if (seg->flags & SEG_FREE) {
+            addr = (seg->addr + align - 1) & ~(align - 1);
+            if (addr >= seg->addr && addr - seg->addr + size <= seg->size)
+                return seg_reserve(head, addr, size);
+        }
+        seg = seg->next;
+    } while (seg != head);
+    return NULL;
+}
+
+/*
+ * Allocate physical pages for the segment at the specified
+ * address. A large segment gets pages aligned like its address,
+ * so that the MMU can map it with superpages.
+ */
+static paddr_t seg_page_alloc(vaddr_t addr, size_t size)
+{
+#ifdef SPAGE_SIZE
+    paddr_t pa;
+
+    if (size >= SPAGE_SIZE && (addr & SPAGE_MASK) == 0) {
+        if ((pa = page_alloc_aligned(size, SPAGE_SIZE)) != 0)
+            return pa;
+    }
+#endif
+    return page_alloc(size);
+}
+
 /*
  * Delete specified free segment.
  */
@@ -946,3 +1226,124 @@ static struct seg* seg_reserve(struct seg* head, vaddr_t addr, size_t size)
     seg->flags = 0;
     return seg;
 }
+
+/*
+ * Back the specified area of the lazy segment by continuing pages.
+ * The resident pages are copied and the others are zero-filled.
+ * Each resident page is unmapped before it is copied, so a thread
+ * of the task running on another CPU faults and waits for us
+ * instead of writing to the old page. The rest of the segment is
+ * left as it is, and the segment stays lazy.
+ */
+static int seg_commit(vm_map_t map, struct seg* seg, vaddr_t addr, size_t size)
+{
+    paddr_t pa, old_pa;
+    vaddr_t start, end, va;
+    size_t off;
+    int map_type;
+
+    start = trunc_page(addr);
+    end = round_page(addr + size);
+    if (start < seg->addr)
+        start = seg->addr;
+    if (end > seg->addr + seg->size)
+        end = seg->addr + seg->size;
+    size = (size_t)(end - start);
+
+    /* Nothing to do if the area is already continuing. */
+    if ((pa = mmu_extract(map->pgd, start, PAGE_SIZE)) != 0) {
+        for (off = PAGE_SIZE; off < size; off += PAGE_SIZE) {
+            if (mmu_extract(map->pgd, start + off, PAGE_SIZE) != pa + off)
+                break;
+        }
+        if (off >= size)
+            return 0;
+    }
+
+    if ((pa = page_alloc(size)) == 0)
+        return ENOMEM;
+
+    map_type = (seg->flags & SEG_WRITE) ? PG_WRITE : PG_READ;
+    for (off = 0; off < size; off += PAGE_SIZE) {
+        va = start + off;
+        old_pa = mmu_extract(map->pgd, va, PAGE_SIZE);
+        if (old_pa == 0) {
+            memset(ptokv(pa + off), 0, PAGE_SIZE);
+            if (mmu_map(map->pgd, pa + off, va, PAGE_SIZE, map_type)) {
+                /* Keep the pages done so far, and drop the rest. */
+                page_free(pa + off, size - off);
+                return ENOMEM;
+            }
+            continue;
+        }
+        if (mmu_map(map->pgd, 0, va, PAGE_SIZE, PG_UNMAP))
+            panic("seg_commit");
+        memcpy(ptokv(pa + off), ptokv(old_pa), PAGE_SIZE);
+
+        /* Replace the page before it is released. */
+        if (mmu_map(map->pgd, pa + off, va, PAGE_SIZE, map_type))
+            panic("seg_commit");
+        page_free(old_pa, PAGE_SIZE);
+    }
+    return 0;
+}
+
+/*
+ * Release the resident pages of the lazy segment.
+ */
+static void seg_release(vm_map_t map, struct seg* seg)
+{
+    paddr_t pa;
+    vaddr_t va;
+
+    for (va = seg->addr; va < seg->addr + seg->size; va += PAGE_SIZE) {
+        if ((pa = mmu_extract(map->pgd, va, PAGE_SIZE)) != 0)
+            page_free(pa, PAGE_SIZE);
+    }
+    mmu_map(map->pgd, 0, seg->addr, seg->size, PG_UNMAP);
+}
+
+/*
+ * Copy the resident pages of the lazy segment to the new map.
+ */
+static int seg_copy(vm_map_t org_map, vm_map_t new_map, struct seg* seg)
+{
+    paddr_t src, dest;
+    vaddr_t va;
+    int map_type;
+
+    map_type = (seg->flags & SEG_WRITE) ? PG_WRITE : PG_READ;
+    for (va = seg->addr; va < seg->addr + seg->size; va += PAGE_SIZE) {
+        if ((src = mmu_extract(org_map->pgd, va, PAGE_SIZE)) == 0)
+            continue;
+        if ((dest = page_alloc(PAGE_SIZE)) == 0)
+            return ENOMEM;
+        memcpy(ptokv(dest), ptokv(src), PAGE_SIZE);
+        if (mmu_map(new_map->pgd, dest, va, PAGE_SIZE, map_type)) {
+            page_free(dest, PAGE_SIZE);
+            return ENOMEM;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Return the size of the segment backed by physical pages.
+ */
+static size_t seg_resident(vm_map_t map, struct seg* seg)
+{
+    vaddr_t va;
+    size_t size;
+
+    if (seg->flags & SEG_FREE)
+        return 0;
+    if (!(seg->flags & SEG_LAZY))
+        return seg->size;
+
+    size = 0;
+    for (va = seg->addr; va < seg->addr + seg->size; va += PAGE_SIZE) {
+        if (mmu_extract(map->pgd, va, PAGE_SIZE) != 0)
+            size += PAGE_SIZE;
+    }
+    return size;
+}
@@ -71,6 +71,8 @@ const task = ffi.task;
 // ---------------------------------------------------------------------------
 
 var kernel_map: mem.VmMap = undefined;
+var kdata_phys: kern.Paddr = 0;
+pub var kdata: ?*mem.KData = null;
 
 // ---------------------------------------------------------------------------
 // Segment list helpers (operate on circular doubly-linked list)
@@ -147,6 +149,33 @@ fn seg_alloc(head: *mem.Segment, size: usize) ?*mem.Segment {
     return null;
 }
 
+fn seg_alloc_aligned(head: *mem.Segment, size: usize, alignment: usize) ?*mem.Segment {
+    var seg = head;
+    while (true) {
+        if (seg.flags & mem.SEG_FREE != 0) {
+            const addr = (seg.addr + alignment - 1) & ~(alignment - 1);
+            if (addr >= seg.addr and addr - seg.addr + size <= seg.size) {
+                return seg_reserve(head, addr, size);
+            }
+        }
+        seg = seg.next;
+        if (seg == head) break;
+    }
+    return null;
+}
+
+// Large segments get pages aligned like their address, so that the
+// MMU can map them with superpages.
+fn seg_page_alloc(addr: kern.Vaddr, size: usize) kern.Paddr {
+    if (hal.SPAGE_SIZE != 0) {
+        if (size >= hal.SPAGE_SIZE and addr & (hal.SPAGE_SIZE - 1) == 0) {
+            const pa = page.alloc_aligned(@intCast(size), hal.SPAGE_SIZE);
+            if (pa != 0) return pa;
+        }
+    }
+    return page.alloc(@intCast(size));
+}
+
 fn seg_free(head: *mem.Segment, seg: *mem.Segment) void {
     std.debug.assert(seg.flags != mem.SEG_FREE);
 
@@ -202,12 +231,108 @@ fn seg_reserve(head: *mem.Segment, addr: kern.Vaddr, size: usize) ?*mem.Segment
     return seg;
 }
 
+// Back the given area of a lazy segment by contiguous pages. Resident
+// pages are copied and the others are zero-filled. Each resident page is
+// unmapped before it is copied, so a thread of the task on another CPU
+// faults and waits for us instead of writing to the old page. The rest
+// of the segment is left alone, and the segment stays lazy.
+fn seg_commit(vm_map: *mem.VmMap, seg: *mem.Segment, addr: kern.Vaddr, len: usize) c_int {
+    var start: kern.Vaddr = @intCast(kutil.trunc_page(addr));
+    var end: kern.Vaddr = @intCast(kutil.round_page(addr + len));
+    if (start < seg.addr) start = seg.addr;
+    if (end > seg.addr + seg.size) end = seg.addr + seg.size;
+    const size: usize = end - start;
+
+    // Nothing to do if the area is already contiguous.
+    const first = hal.mmu_extract(vm_map.pgd, start, hal.PAGE_SIZE);
+    if (first != 0) {
+        var off: usize = hal.PAGE_SIZE;
+        while (off < size) : (off += hal.PAGE_SIZE) {
+            if (hal.mmu_extract(vm_map.pgd, start + off, hal.PAGE_SIZE) != first + off) break;
+        }
+        if (off >= size) return 0;
+    }
+
+    const pa = page.alloc(@intCast(size));
+    if (pa == 0) return kern.Errno.ENOMEM;
+
+    const map_type: c_int = if (seg.flags & mem.SEG_WRITE != 0) hal.PG_WRITE else hal.PG_READ;
+    var off: usize = 0;
+    while (off < size) : (off += hal.PAGE_SIZE) {
+        const va = start + off;
+        const dst: [*]u8 = @ptrCast(kutil.ptokv(pa + off).?);
+        const old_pa = hal.mmu_extract(vm_map.pgd, va, hal.PAGE_SIZE);
+        if (old_pa == 0) {
+            @memset(dst[0..hal.PAGE_SIZE], 0);
+            if (hal.mmu_map(vm_map.pgd, pa + off, va, hal.PAGE_SIZE, map_type) != 0) {
+                // Keep the pages done so far, and drop the rest.
+                page.free(pa + off, @intCast(size - off));
+                return kern.Errno.ENOMEM;
+            }
+            continue;
+        }
+        if (hal.mmu_map(vm_map.pgd, 0, va, hal.PAGE_SIZE, hal.PG_UNMAP) != 0) {
+            @panic("seg_commit");
+        }
+        @memcpy(dst[0..hal.PAGE_SIZE], @as([*]const u8, @ptrCast(kutil.ptokv(old_pa).?))[0..hal.PAGE_SIZE]);
+
+        // Replace the page before it is released.
+        if (hal.mmu_map(vm_map.pgd, pa + off, va, hal.PAGE_SIZE, map_type) != 0) {
+            @panic("seg_commit");
+        }
+        page.free(old_pa, hal.PAGE_SIZE);
+    }
+    return 0;
+}
+
+// Release the resident pages of a lazy segment.
+fn seg_release(vm_map: *mem.VmMap, seg: *mem.Segment) void {
+    var va = seg.addr;
+    while (va < seg.addr + seg.size) : (va += hal.PAGE_SIZE) {
+        const pa = hal.mmu_extract(vm_map.pgd, va, hal.PAGE_SIZE);
+        if (pa != 0) page.free(pa, hal.PAGE_SIZE);
+    }
+    _ = hal.mmu_map(vm_map.pgd, 0, seg.addr, seg.size, hal.PG_UNMAP);
+}
+
+// Copy the resident pages of a lazy segment to the new map.
+fn seg_copy(org_map: *mem.VmMap, new_map: *mem.VmMap, seg: *mem.Segment) c_int {
+    const map_type: c_int = if (seg.flags & mem.SEG_WRITE != 0) hal.PG_WRITE else hal.PG_READ;
+    var va = seg.addr;
+    while (va < seg.addr + seg.size) : (va += hal.PAGE_SIZE) {
+        const src = hal.mmu_extract(org_map.pgd, va, hal.PAGE_SIZE);
+        if (src == 0) continue;
+        const dest = page.alloc(hal.PAGE_SIZE);
+        if (dest == 0) return kern.Errno.ENOMEM;
+        @memcpy(@as([*]u8, @ptrCast(kutil.ptokv(dest).?))[0..hal.PAGE_SIZE], @as([*]const u8, @ptrCast(kutil.ptokv(src).?))[0..hal.PAGE_SIZE]);
+        if (hal.mmu_map(new_map.pgd, dest, va, hal.PAGE_SIZE, map_type) != 0) {
+            page.free(dest, hal.PAGE_SIZE);
+            return kern.Errno.ENOMEM;
+        }
+    }
+    return 0;
+}
+
+// Return the size of the segment backed by physical pages.
+fn seg_resident(vm_map: *mem.VmMap, seg: *mem.Segment) usize {
+    if (seg.flags & mem.SEG_FREE != 0) return 0;
+    if (seg.flags & mem.SEG_LAZY == 0) return seg.size;
+
+    var size: usize = 0;
+    var va = seg.addr;
+    while (va < seg.addr + seg.size) : (va += hal.PAGE_SIZE) {
+        if (hal.mmu_extract(vm_map.pgd, va, hal.PAGE_SIZE) != 0) size += hal.PAGE_SIZE;
+    }
+    return size;
+}
+
 // ---------------------------------------------------------------------------
 // Internal do_* helpers
 // ---------------------------------------------------------------------------
 
 fn do_allocate(vm_map: *mem.VmMap, addr: *?*anyopaque, size: usize, anywhere: c_int) c_int {
     var seg: ?*mem.Segment = null;
+    var lazy = false;
     const vaddr_val = @intFromPtr(addr.*);
 
     if (size == 0) return kern.Errno.EINVAL;
@@ -215,7 +340,13 @@ fn do_allocate(vm_map: *mem.VmMap, addr: *?*anyopaque, size: usize, anywhere: c_
 
     if (anywhere != 0) {
         const alloc_size = kutil.round_page(size);
-        seg = seg_alloc(&vm_map.head, alloc_size) orelse return kern.Errno.ENOMEM;
+        if (hal.SPAGE_SIZE != 0 and alloc_size >= hal.SPAGE_SIZE) {
+            seg = seg_alloc_aligned(&vm_map.head, alloc_size, hal.SPAGE_SIZE);
+        }
+        if (seg == null) {
+            seg = seg_alloc(&vm_map.head, alloc_size) orelse return kern.Errno.ENOMEM;
+            lazy = true;
+        }
     } else {
         const start = kutil.trunc_page(vaddr_val);
         const end = kutil.round_page(start + size);
@@ -225,7 +356,16 @@ fn do_allocate(vm_map: *mem.VmMap, addr: *?*anyopaque, size: usize, anywhere: c_
 
     seg.?.flags = mem.SEG_READ | mem.SEG_WRITE;
 
-    const pa = page.alloc(@intCast(seg.?.size));
+    // An area placed anywhere is backed on first touch by fault(),
+    // unless it is large enough to be mapped with superpages.
+    if (lazy) {
+        seg.?.flags |= mem.SEG_LAZY;
+        addr.* = @ptrFromInt(seg.?.addr);
+        vm_map.total += seg.?.size;
+        return 0;
+    }
+
+    const pa = seg_page_alloc(seg.?.addr, seg.?.size);
     if (pa == 0) {
         seg_free(&vm_map.head, seg.?);
         return kern.Errno.ENOMEM;
@@ -252,10 +392,14 @@ fn do_free(vm_map: *mem.VmMap, addr: ?*anyopaque) c_int {
         return kern.Errno.EINVAL;
     }
 
-    _ = hal.mmu_map(vm_map.pgd, seg.phys, seg.addr, seg.size, hal.PG_UNMAP);
+    if (seg.flags & mem.SEG_LAZY != 0) {
+        seg_release(vm_map, seg);
+    } else {
+        _ = hal.mmu_map(vm_map.pgd, seg.phys, seg.addr, seg.size, hal.PG_UNMAP);
 
-    if (seg.flags & mem.SEG_SHARED == 0 and seg.flags & mem.SEG_MAPPED == 0) {
-        page.free(seg.phys, @intCast(seg.size));
+        if (seg.flags & mem.SEG_SHARED == 0 and seg.flags & mem.SEG_MAPPED == 0) {
+            page.free(seg.phys, @intCast(seg.size));
+        }
     }
 
     vm_map.total -= seg.size;
@@ -286,7 +430,7 @@ fn do_attribute(vm_map: *mem.VmMap, addr: ?*anyopaque, attr: c_int) c_int {
 
     if (seg.flags & mem.SEG_SHARED != 0) {
         const old_pa = seg.phys;
-        const new_pa = page.alloc(@intCast(seg.size));
+        const new_pa = seg_page_alloc(seg.addr, seg.size);
         if (new_pa == 0) return kern.Errno.ENOMEM;
 
         @memcpy(@as([*]u8, @ptrCast(kutil.ptokv(new_pa).?))[0..seg.size], @as([*]const u8, @ptrCast(kutil.ptokv(old_pa).?))[0..seg.size]);
@@ -304,6 +448,15 @@ fn do_attribute(vm_map: *mem.VmMap, addr: ?*anyopaque, attr: c_int) c_int {
         }
         seg.sh_next = seg;
         seg.sh_prev = seg;
+    } else if (seg.flags & mem.SEG_LAZY != 0) {
+        // Remap resident pages. The others are mapped on fault.
+        var pg = seg.addr;
+        while (pg < seg.addr + seg.size) : (pg += hal.PAGE_SIZE) {
+            const pa = hal.mmu_extract(vm_map.pgd, pg, hal.PAGE_SIZE);
+            if (pa == 0) continue;
+            if (hal.mmu_map(vm_map.pgd, pa, pg, hal.PAGE_SIZE, map_type) != 0) return kern.Errno.ENOMEM;
+        }
+        new_flags |= mem.SEG_LAZY;
     } else {
         if (hal.mmu_map(vm_map.pgd, seg.phys, seg.addr, seg.size, map_type) != 0) return kern.Errno.ENOMEM;
     }
@@ -331,17 +484,23 @@ fn do_map(target_map: *mem.VmMap, addr: ?*anyopaque, size: usize, alloc: *?*anyo
     const tgt = seg_lookup(&target_map.head, @intCast(start), total) orelse return kern.Errno.EINVAL;
     if (tgt.flags & mem.SEG_FREE != 0) return kern.Errno.EINVAL;
 
+    // The pages must be contiguous to be shared.
+    var pa = tgt.phys + (start - tgt.addr);
+    if (tgt.flags & mem.SEG_LAZY != 0) {
+        if (seg_commit(target_map, tgt, @intCast(start), total) != 0) return kern.Errno.ENOMEM;
+        pa = hal.mmu_extract(target_map.pgd, @intCast(start), total);
+    }
+
     const cur_seg = seg_alloc(&curmap.head, total) orelse return kern.Errno.ENOMEM;
 
     const map_type: c_int = if (tgt.flags & mem.SEG_WRITE != 0) hal.PG_WRITE else hal.PG_READ;
 
-    const pa = tgt.phys + (start - tgt.addr);
     if (hal.mmu_map(curmap.pgd, pa, cur_seg.addr, total, map_type) != 0) {
         seg_free(&curmap.head, cur_seg);
         return kern.Errno.ENOMEM;
     }
 
-    cur_seg.flags = tgt.flags | mem.SEG_MAPPED;
+    cur_seg.flags = (tgt.flags & ~mem.SEG_LAZY) | mem.SEG_MAPPED;
     cur_seg.phys = pa;
 
     const result: ?*anyopaque = @ptrFromInt(cur_seg.addr + offset);
@@ -383,12 +542,20 @@ fn do_dup(org_map: *mem.VmMap) ?*mem.VmMap {
         if (src.flags == mem.SEG_FREE) {
             // Skip free segment
         } else {
-            if (src.flags & mem.SEG_WRITE == 0 and src.flags & mem.SEG_MAPPED == 0) {
+            if (src.flags & mem.SEG_WRITE == 0 and src.flags & mem.SEG_MAPPED == 0 and src.flags & mem.SEG_LAZY == 0) {
                 dest.flags |= mem.SEG_SHARED;
             }
 
+            if (dest.flags & mem.SEG_LAZY != 0) {
+                // Copy resident pages only
+                if (seg_copy(org_map, new_map_ptr, src) != 0) return null;
+                src = src.next;
+                if (src == &org_map.head) break;
+                continue;
+            }
+
             if (dest.flags & mem.SEG_SHARED == 0) {
-                dest.phys = page.alloc(@intCast(src.size));
+                dest.phys = seg_page_alloc(src.addr, src.size);
                 if (dest.phys == 0) return null;
 
                 @memcpy(@as([*]u8, @ptrCast(kutil.ptokv(dest.phys).?))[0..src.size], @as([*]const u8, @ptrCast(kutil.ptokv(src.phys).?))[0..src.size]);
@@ -417,6 +584,7 @@ fn do_dup(org_map: *mem.VmMap) ?*mem.VmMap {
         if (src == &org_map.head) break;
     }
 
+    if (org_map.kdata != 0 and kdata_dup(org_map, new_map_ptr) != 0) return null;
     return new_map_ptr;
 }
 
@@ -430,6 +598,7 @@ fn vm_create_internal() ?*mem.VmMap {
 
     vm_map.refcnt = 1;
     vm_map.total = 0;
+    vm_map.kdata = 0;
 
     vm_map.pgd = hal.mmu_newmap();
     if (vm_map.pgd == hal.NO_PGD) {
@@ -520,7 +689,9 @@ pub fn terminate(vm_map: kern.VmMapRef) callconv(.c) void {
 
     var seg: *mem.Segment = &map_opt.?.head;
     while (true) {
-        if (seg.flags != mem.SEG_FREE) {
+        if (seg.flags & mem.SEG_LAZY != 0) {
+            seg_release(map_opt.?, seg);
+        } else if (seg.flags != mem.SEG_FREE) {
             _ = hal.mmu_map(map_opt.?.pgd, seg.phys, seg.addr, seg.size, hal.PG_UNMAP);
 
             if (seg.flags & mem.SEG_SHARED == 0 and seg.flags & mem.SEG_MAPPED == 0) {
@@ -533,6 +704,10 @@ pub fn terminate(vm_map: kern.VmMapRef) callconv(.c) void {
         if (seg == &map_opt.?.head) break;
     }
 
+    if (map_opt.?.kdata != 0) {
+        page.free(map_opt.?.kdata, hal.PAGE_SIZE);
+    }
+
     if (map_opt == @as(?*mem.VmMap, @ptrCast(@alignCast(kutil.cur_task().map)))) {
         hal.mmu_switch(kernel_map.pgd);
     }
@@ -592,10 +767,64 @@ pub fn load(vm_map: kern.VmMapRef, mod: *hal.Module, stack: *?*anyopaque) callco
     return 0;
 }
 
+// The area in a lazy segment is backed by contiguous pages first, since
+// the caller will access it through the physical address.
 pub fn translate(addr: kern.Vaddr, size: usize) callconv(.c) kern.Paddr {
     const map_ptr = kutil.cur_task().map;
     if (map_ptr == null) return 0;
-    return hal.mmu_extract(map_ptr.*.pgd, addr, size);
+    const vm_map: *mem.VmMap = @ptrCast(@alignCast(map_ptr));
+
+    sched.lock();
+    defer sched.unlock();
+
+    if (seg_lookup(&vm_map.head, addr, size)) |seg| {
+        if (seg.flags & mem.SEG_LAZY != 0 and seg_commit(vm_map, seg, addr, size) != 0) return 0;
+    }
+    return hal.mmu_extract(vm_map.pgd, addr, size);
+}
+
+// Handle a page fault of the current task at a non-present page. A page
+// in a lazy segment is backed by a zero-filled page. Returns 0 if the
+// faulting access can be retried, or errno if it must be handled as an
+// exception.
+pub fn fault(addr: kern.Vaddr) callconv(.c) c_int {
+    const mode = ffi.acct.mode(1);
+    const rc = doFault(addr);
+    _ = ffi.acct.mode(mode);
+    ffi.trace.event(ffi.trace.PGFAULT, @truncate(addr), @bitCast(rc));
+    return rc;
+}
+
+fn doFault(addr: kern.Vaddr) c_int {
+    if (!kutil.user_area(addr)) return kern.Errno.EFAULT;
+
+    const va: kern.Vaddr = @intCast(kutil.trunc_page(addr));
+
+    sched.lock();
+    defer sched.unlock();
+
+    const map_ptr = kutil.cur_task().map;
+    if (map_ptr == null) return kern.Errno.EFAULT;
+    const vm_map: *mem.VmMap = @ptrCast(@alignCast(map_ptr));
+    const seg = seg_lookup(&vm_map.head, va, hal.PAGE_SIZE) orelse return kern.Errno.EFAULT;
+    if (seg.flags & mem.SEG_FREE != 0) return kern.Errno.EFAULT;
+
+    // Another thread may have filled or moved this page while we were
+    // waiting for the lock. The trap handler checks that the access is
+    // allowed before it retries.
+    if (hal.mmu_extract(vm_map.pgd, va, hal.PAGE_SIZE) != 0) return 0;
+    if (seg.flags & mem.SEG_LAZY == 0) return kern.Errno.EFAULT;
+
+    const pa = page.alloc(hal.PAGE_SIZE);
+    if (pa == 0) return kern.Errno.ENOMEM;
+    @memset(@as([*]u8, @ptrCast(kutil.ptokv(pa).?))[0..hal.PAGE_SIZE], 0);
+
+    const map_type: c_int = if (seg.flags & mem.SEG_WRITE != 0) hal.PG_WRITE else hal.PG_READ;
+    if (hal.mmu_map(vm_map.pgd, pa, va, hal.PAGE_SIZE, map_type) != 0) {
+        page.free(pa, hal.PAGE_SIZE);
+        return kern.Errno.ENOMEM;
+    }
+    return 0;
 }
 
 pub fn info(vminfo: *hal.VmInfo) callconv(.c) c_int {
@@ -618,6 +847,7 @@ pub fn info(vminfo: *hal.VmInfo) callconv(.c) c_int {
             vminfo.size = seg.size;
             vminfo.flags = seg.flags;
             vminfo.phys = seg.phys;
+            vminfo.resident = seg_resident(vm_map, seg);
             return 0;
         }
         i += 1;
@@ -637,4 +867,61 @@ pub fn init() callconv(.c) void {
 
     seg_init(&kernel_map.head);
     kern.kernel_task.map = @ptrCast(&kernel_map);
+
+    // Setup the shared kernel data page.
+    kdata_phys = page.alloc(hal.PAGE_SIZE);
+    if (kdata_phys == 0) {
+        while (true) {}
+    }
+    kdata = @ptrCast(@alignCast(kutil.ptokv(kdata_phys).?));
+    @memset(@as([*]u8, @ptrCast(kdata.?))[0..hal.PAGE_SIZE], 0);
+    kdata.?.hz = ffi.raw.CONFIG_HZ;
+    kdata.?.ncpus = 1;
+}
+
+/// Map the kernel data pages at the top of the user space.
+/// The shared page is mapped as is, and a new page holds the
+/// identity of the task. Must be called with scheduler locked.
+pub fn kdataSetup(vm_map: kern.VmMapRef) callconv(.c) c_int {
+    const map_ptr: *mem.VmMap = @ptrCast(@alignCast(vm_map.?));
+
+    const pa = page.alloc(hal.PAGE_SIZE);
+    if (pa == 0) return kern.Errno.ENOMEM;
+    @memset(@as([*]u8, @ptrCast(kutil.ptokv(pa).?))[0..hal.PAGE_SIZE], 0);
+
+    if (kdata_map(map_ptr, mem.KDATA_BASE, kdata_phys) != 0 or kdata_map(map_ptr, mem.KDATA_TASK, pa) != 0) {
+        page.free(pa, hal.PAGE_SIZE);
+        return kern.Errno.ENOMEM;
+    }
+    map_ptr.kdata = pa;
+    return 0;
+}
+
+/// Map one kernel data page read-only.
+fn kdata_map(vm_map: *mem.VmMap, va: kern.Vaddr, pa: kern.Paddr) c_int {
+    const seg = seg_reserve(&vm_map.head, va, hal.PAGE_SIZE) orelse return kern.Errno.ENOMEM;
+    if (hal.mmu_map(vm_map.pgd, pa, va, hal.PAGE_SIZE, hal.PG_READ) != 0) {
+        seg_free(&vm_map.head, seg);
+        return kern.Errno.ENOMEM;
+    }
+    seg.flags = mem.SEG_READ | mem.SEG_MAPPED;
+    seg.phys = pa;
+    vm_map.total += hal.PAGE_SIZE;
+    return 0;
+}
+
+/// Give a duplicated map its own copy of the task data page.
+fn kdata_dup(org_map: *mem.VmMap, new_map: *mem.VmMap) c_int {
+    const pa = page.alloc(hal.PAGE_SIZE);
+    if (pa == 0) return kern.Errno.ENOMEM;
+    @memcpy(@as([*]u8, @ptrCast(kutil.ptokv(pa).?))[0..hal.PAGE_SIZE], @as([*]const u8, @ptrCast(kutil.ptokv(org_map.kdata).?))[0..hal.PAGE_SIZE]);
+    new_map.kdata = pa;
+
+    if (seg_lookup(&new_map.head, mem.KDATA_TASK, hal.PAGE_SIZE)) |seg| {
+        if (seg.phys == org_map.kdata and seg.flags & mem.SEG_MAPPED != 0) {
+            seg.phys = pa;
+            if (hal.mmu_map(new_map.pgd, pa, mem.KDATA_TASK, hal.PAGE_SIZE, hal.PG_READ) != 0) return kern.Errno.ENOMEM;
+        }
+    }
+    return 0;
 }
@@ -70,6 +70,22 @@ typedef struct
     int is_initialized;
 } pthread_condattr_t;
 
+/*
+ * CPU set for pthread_setaffinity_np()
+ */
+#define CPU_SETSIZE 32
+
+typedef struct
+{
+    u_int __bits;
+} cpu_set_t;
+
+#define CPU_ZERO(set) ((set)->__bits = 0)
+#define CPU_SET(cpu, set) ((void)((cpu) < CPU_SETSIZE && ((set)->__bits |= 1U << (cpu))))
+#define CPU_CLR(cpu, set) ((void)((cpu) < CPU_SETSIZE && ((set)->__bits &= ~(1U << (cpu)))))
+#define CPU_ISSET(cpu, set) ((cpu) < CPU_SETSIZE && ((set)->__bits & (1U << (cpu))) != 0)
+#define CPU_COUNT(set) __builtin_popcount((set)->__bits)
+
 /*
  * POSIX thread constants
  */
@@ -94,6 +110,8 @@ int pthread_detach(pthread_t thread);
 pthread_t pthread_self(void);
 void pthread_exit(void* retval);
 int pthread_yield(void);
+int pthread_setaffinity_np(pthread_t thread, size_t size, const cpu_set_t* set);
+int pthread_getaffinity_np(pthread_t thread, size_t size, cpu_set_t* set);
 
 /*
  * Mutex
@@ -66,6 +66,20 @@ typedef struct
 extern int __mb_cur_max;
 #define MB_CUR_MAX __mb_cur_max
 
+/*
+ * Statistics of malloc()
+ */
+struct mallstat
+{
+    size_t ms_heap;           /* bytes mapped for small objects */
+    size_t ms_small;          /* bytes of small objects allocated */
+    size_t ms_cached;         /* bytes of small objects in thread caches */
+    size_t ms_large;          /* bytes mapped for large objects */
+    unsigned long ms_nmalloc; /* number of malloc() */
+    unsigned long ms_nfree;   /* number of free() */
+    unsigned long ms_nhit;    /* malloc() served by thread caches */
+};
+
 #include <sys/cdefs.h>
 
 __BEGIN_DECLS
@@ -146,6 +160,7 @@ void unsetenv(const char*);
 
 void* malloc_r(size_t);
 void free_r(void*);
+int mallstat(struct mallstat*);
 
 const char* getprogname(void);
 
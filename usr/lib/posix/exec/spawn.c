@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/prex.h>
+#include <ipc/exec.h>
+#include <ipc/ipc.h>
+
+#include <unistd.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <paths.h>
+#include <spawn.h>
+
+/*
+ * posix_spawn() is served by the exec server in one request.  The
+ * file actions are resolved here into a map from child descriptor
+ * to parent descriptor, and the server builds the child's file
+ * table from that map.  The parent is never duplicated, so no
+ * copy-on-write faults or address space teardown are involved.
+ */
+
+/*
+ * Set once the exec server has answered EXEC_SPAWN with ENOSYS.
+ */
+static int spawn_nosys;
+
+#define SPAWN_OPEN 1
+#define SPAWN_CLOSE 2
+#define SPAWN_DUP2 3
+
+struct __spawn_action
+{
+    int type;            /* SPAWN_xxx */
+    int fd;              /* target descriptor */
+    int srcfd;           /* source descriptor for dup2 */
+    int oflag;           /* flags for open */
+    mode_t mode;         /* mode for open */
+    char path[PATH_MAX]; /* path for open */
+};
+
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t* fa)
+{
+
+    fa->__count = 0;
+    fa->__size = 0;
+    fa->__actions = NULL;
+    return 0;
+}
+
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t* fa)
+{
+
+    free(fa->__actions);
+    fa->__actions = NULL;
+    fa->__count = 0;
+    fa->__size = 0;
+    return 0;
+}
+
+static struct __spawn_action* spawn_addaction(posix_spawn_file_actions_t* fa, int type, int fd)
+{
+    struct __spawn_action* act;
+    int size;
+
+    if (fd < 0 || fd >= OPEN_MAX)
+        return NULL;
+
+    if (fa->__count >= fa->__size) {
+        size = fa->__size ? fa->__size * 2 : 4;
+        act = realloc(fa->__actions, size * sizeof(struct __spawn_action));
+        if (act == NULL)
+            return NULL;
+        fa->__actions = act;
+        fa->__size = size;
+    }
+    act = &fa->__actions[fa->__count++];
+    memset(act, 0, sizeof(*act));
+    act->type = type;
+    act->fd = fd;
+    return act;
+}
+
+int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t* fa, int fd, const char* path, int oflag,
+                                     mode_t mode)
+{
+    struct __spawn_action* act;
+
+    if (strlen(path) >= PATH_MAX)
+        return ENAMETOOLONG;
+    if ((act = spawn_addaction(fa, SPAWN_OPEN, fd)) == NULL)
+        return (fd < 0 || fd >= OPEN_MAX) ? EBADF : ENOMEM;
+    strlcpy(act->path, path, PATH_MAX);
+    act->oflag = oflag;
+    act->mode = mode;
+    return 0;
+}
+
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t* fa, int fd)
+{
+
+    if (spawn_addaction(fa, SPAWN_CLOSE, fd) == NULL)
+        return (fd < 0 || fd >= OPEN_MAX) ? EBADF : ENOMEM;
+    return 0;
+}
+
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t* fa, int fd, int newfd)
+{
+    struct __spawn_action* act;
+
+    if (fd < 0 || fd >= OPEN_MAX)
+        return EBADF;
+    if ((act = spawn_addaction(fa, SPAWN_DUP2, newfd)) == NULL)
+        return (newfd < 0 || newfd >= OPEN_MAX) ? EBADF : ENOMEM;
+    act->srcfd = fd;
+    return 0;
+}
+
+int posix_spawnattr_init(posix_spawnattr_t* attr)
+{
+
+    memset(attr, 0, sizeof(*attr));
+    return 0;
+}
+
+int posix_spawnattr_destroy(posix_spawnattr_t* attr)
+{
+
+    return 0;
+}
+
+int posix_spawnattr_getflags(const posix_spawnattr_t* attr, short* flags)
+{
+
+    *flags = attr->__flags;
+    return 0;
+}
+
+int posix_spawnattr_setflags(posix_spawnattr_t* attr, short flags)
+{
+
+    if (flags & ~(POSIX_SPAWN_RESETIDS | POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK))
+        return EINVAL;
+    attr->__flags = flags;
+    return 0;
+}
+
+int posix_spawnattr_getpgroup(const posix_spawnattr_t* attr, pid_t* pgroup)
+{
+
+    *pgroup = attr->__pgroup;
+    return 0;
+}
+
+int posix_spawnattr_setpgroup(posix_spawnattr_t* attr, pid_t pgroup)
+{
+
+    if (pgroup < 0)
+        return EINVAL;
+    attr->__pgroup = pgroup;
+    return 0;
+}
+
+int posix_spawnattr_getsigdefault(const posix_spawnattr_t* attr, sigset_t* set)
+{
+
+    *set = attr->__sigdefault;
+    return 0;
+}
+
+int posix_spawnattr_setsigdefault(posix_spawnattr_t* attr, const sigset_t* set)
+{
+
+    attr->__sigdefault = *set;
+    return 0;
+}
+
+int posix_spawnattr_getsigmask(const posix_spawnattr_t* attr, sigset_t* set)
+{
+
+    *set = attr->__sigmask;
+    return 0;
+}
+
+int posix_spawnattr_setsigmask(posix_spawnattr_t* attr, const sigset_t* set)
+{
+
+    attr->__sigmask = *set;
+    return 0;
+}
+
+/*
+ * Parent descriptor that backs child descriptor fd.
+ */
+static int spawn_fdget(struct spawn_msg* msg, int fd)
+{
+
+    return (fd < msg->nfds) ? msg->fds[fd] : fd;
+}
+
+static void spawn_fdset(struct spawn_msg* msg, int fd, int pfd)
+{
+
+    while (msg->nfds <= fd) {
+        msg->fds[msg->nfds] = msg->nfds;
+        msg->nfds++;
+    }
+    msg->fds[fd] = pfd;
+}
+
+/*
+ * Resolve the file actions into msg->fds[].
+ * Files opened for the child are opened in the parent and are
+ * recorded in tmpfd[] to be closed after the request.
+ */
+static int spawn_fdmap(struct spawn_msg* msg, const posix_spawn_file_actions_t* fa, int* tmpfd, int* ntmp)
+{
+    struct __spawn_action* act;
+    int i, pfd;
+
+    msg->nfds = 0;
+    *ntmp = 0;
+    if (fa == NULL)
+        return 0;
+
+    for (i = 0; i < fa->__count; i++) {
+        act = &fa->__actions[i];
+        switch (act->type) {
+        case SPAWN_OPEN:
+            if ((pfd = open(act->path, act->oflag, act->mode)) < 0)
+                return errno;
+            tmpfd[(*ntmp)++] = pfd;
+            /* The parent slot used for the temp is not the child's */
+            spawn_fdset(msg, pfd, -1);
+            spawn_fdset(msg, act->fd, pfd);
+            break;
+        case SPAWN_CLOSE:
+            spawn_fdset(msg, act->fd, -1);
+            break;
+        case SPAWN_DUP2:
+            if ((pfd = spawn_fdget(msg, act->srcfd)) < 0)
+                return EBADF;
+            spawn_fdset(msg, act->fd, pfd);
+            break;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Rearrange the descriptors of a forked child by msg->fds[].
+ * The sources are first moved above the map, so that no target
+ * overwrites a source that is still needed.
+ */
+static int spawn_fdapply(struct spawn_msg* msg)
+{
+    int tmp[OPEN_MAX];
+    int i, pfd;
+
+    for (i = 0; i < msg->nfds; i++) {
+        tmp[i] = -1;
+        pfd = msg->fds[i];
+        if (pfd != -1 && pfd != i && (tmp[i] = fcntl(pfd, F_DUPFD, msg->nfds)) == -1)
+            return -1;
+    }
+    for (i = 0; i < msg->nfds; i++) {
+        if (tmp[i] != -1) {
+            if (dup2(tmp[i], i) == -1)
+                return -1;
+            close(tmp[i]);
+        } else if (msg->fds[i] == -1)
+            close(i);
+    }
+    return 0;
+}
+
+/*
+ * Spawn with vfork() and execve().
+ * This is used if the exec server does not support EXEC_SPAWN.
+ * The files of the child were already opened by spawn_fdmap(),
+ * and the program was checked by the caller.  The child can not
+ * report an error after vfork(), so it exits with status 127.
+ */
+static int spawn_fork(pid_t* pid, const char* path, struct spawn_msg* msg, const posix_spawnattr_t* attr,
+                      char* const argv[], char* const envp[])
+{
+    pid_t p;
+
+    if ((p = vfork()) == -1)
+        return errno;
+    if (p == 0) {
+        if (attr && (attr->__flags & POSIX_SPAWN_SETPGROUP)) {
+            if (setpgid(0, attr->__pgroup) == -1)
+                _exit(127);
+        }
+        if (spawn_fdapply(msg) == -1)
+            _exit(127);
+        execve(path, (argv && argv[0]) ? &argv[1] : argv, envp);
+        _exit(127);
+    }
+    if (pid != NULL)
+        *pid = p;
+    return 0;
+}
+
+/*
+ * Note:
+ *
+ * A new program always starts with the default signal actions and
+ * an empty signal mask, the same as after execve().  So
+ * POSIX_SPAWN_SETSIGDEF needs no work, and POSIX_SPAWN_SETSIGMASK is
+ * only accepted with an empty mask.  POSIX_SPAWN_RESETIDS has no
+ * effect because there are no separate effective ids.
+ */
+int posix_spawn(pid_t* pid, const char* path, const posix_spawn_file_actions_t* fa, const posix_spawnattr_t* attr,
+                char* const argv[], char* const envp[])
+{
+    struct spawn_msg msg;
+    object_t execobj;
+    int tmpfd[OPEN_MAX];
+    int error, i, argc, envc, ntmp;
+    size_t bufsz;
+    char *dest, *src;
+
+    if ((error = object_lookup("!exec", &execobj)) != 0)
+        return ENOSYS;
+
+    if (path == NULL)
+        return EFAULT;
+    if (strlen(path) >= PATH_MAX)
+        return ENAMETOOLONG;
+    if (attr && (attr->__flags & POSIX_SPAWN_SETSIGMASK) && attr->__sigmask != 0)
+        return EINVAL;
+
+    /*
+     * The exec server supplies the program path as argv[0],
+     * so only the arguments after argv[0] are sent.
+     */
+    bufsz = 0;
+    argc = 0;
+    if (argv && argv[0]) {
+        while (argv[argc + 1]) {
+            bufsz += (strlen(argv[argc + 1]) + 1);
+            argc++;
+        }
+    }
+    envc = 0;
+    if (envp) {
+        while (envp[envc]) {
+            bufsz += (strlen(envp[envc]) + 1);
+            envc++;
+        }
+    }
+    if (bufsz >= ARG_MAX)
+        return E2BIG;
+
+    dest = msg.buf;
+    for (i = 0; i < argc; i++) {
+        src = argv[i + 1];
+        while ((*dest++ = *src++) != 0)
+            ;
+    }
+    for (i = 0; i < envc; i++) {
+        src = envp[i];
+        while ((*dest++ = *src++) != 0)
+            ;
+    }
+
+    error = spawn_fdmap(&msg, fa, tmpfd, &ntmp);
+    if (error == 0 && !spawn_nosys) {
+        /* Request to exec server */
+        msg.hdr.code = EXEC_SPAWN;
+        msg.argc = argc;
+        msg.envc = envc;
+        msg.bufsz = bufsz;
+        msg.flags = attr ? attr->__flags : 0;
+        msg.pgroup = attr ? attr->__pgroup : 0;
+        msg.pid = 0;
+        getcwd(msg.cwd, PATH_MAX);
+        strlcpy(msg.path, path, PATH_MAX);
+        do {
+            error = msg_send(execobj, &msg, sizeof(msg));
+        } while (error == EINTR);
+
+        if (error)
+            error = EIO;
+        else
+            error = msg.hdr.status;
+        /*
+         * An exec server without EXEC_SPAWN may answer the request
+         * with success and no child. Treat it as unsupported.
+         */
+        if (error == 0 && msg.pid <= 0)
+            error = ENOSYS;
+        if (error == 0 && pid != NULL)
+            *pid = msg.pid;
+        if (error == ENOSYS) {
+            /* Fall back to vfork(), and do not ask again */
+            spawn_nosys = 1;
+            error = 0;
+        }
+    }
+    if (error == 0 && spawn_nosys) {
+        /*
+         * The child of vfork() can not report an error, so check
+         * the program here as the exec server would.
+         */
+        if (access(path, X_OK) == -1)
+            error = errno;
+        else
+            error = spawn_fork(pid, path, &msg, attr, argv, envp);
+    }
+
+    for (i = 0; i < ntmp; i++)
+        close(tmpfd[i]);
+    return error;
+}
+
+/*
+ * posix_spawnp() - posix_spawn() with a search of $PATH.
+ */
+int posix_spawnp(pid_t* pid, const char* name, const posix_spawn_file_actions_t* fa,
+                 const posix_spawnattr_t* attr, char* const argv[], char* const envp[])
+{
+    char buf[PATH_MAX];
+    const char *path, *p;
+    size_t lp, ln;
+    int error, eacces = 0;
+
+    /* "" is not a valid filename; check this before traversing PATH. */
+    if (name[0] == '\0')
+        return ENOENT;
+    /* If it's an absolute or relative path name, it's easy. */
+    if (strchr(name, '/'))
+        return posix_spawn(pid, name, fa, attr, argv, envp);
+
+    /* Get the path we're searching. */
+    if (!(path = getenv("PATH")))
+        path = _PATH_DEFPATH;
+
+    ln = strlen(name);
+    do {
+        /* Find the end of this path element. */
+        for (p = path; *path != 0 && *path != ':'; path++)
+            continue;
+        /* Empty elements mean the current directory. */
+        if (p == path) {
+            p = ".";
+            lp = 1;
+        } else
+            lp = path - p;
+
+        if (lp + ln + 2 > sizeof(buf))
+            continue;
+        memcpy(buf, p, lp);
+        buf[lp] = '/';
+        memcpy(buf + lp + 1, name, ln);
+        buf[lp + ln + 1] = '\0';
+
+        /*
+         * Skip missing programs before posix_spawn() opens the
+         * files of the child, which may be O_CREAT or O_EXCL.
+         */
+        if (access(buf, X_OK) == -1)
+            error = errno;
+        else
+            error = posix_spawn(pid, buf, fa, attr, argv, envp);
+        switch (error) {
+        case EACCES:
+            eacces = 1;
+            break;
+        case ENOTDIR:
+        case ENOENT:
+            break;
+        default:
+            return error;
+        }
+    } while (*path++ == ':'); /* Otherwise, *path was NUL */
+    return eacces ? EACCES : ENOENT;
+}
@@ -36,6 +36,11 @@ int close(int fd)
 {
     struct msg m;
 
+    if (fd >= EPOLL_FDBASE)
+        return __epoll_close(fd);
+    if (fd >= SOCKET_FDBASE)
+        return __sock_close(fd);
+
     m.hdr.code = FS_CLOSE;
     m.data[0] = fd;
     return __posix_call(__fs_obj, &m, sizeof(m), 1);
@@ -0,0 +1,483 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * epoll - I/O event notification
+ *
+ * An epoll instance keeps a persistent listener in the server of
+ * each registered descriptor.  The servers queue events to rings in
+ * a shared area and post one semaphore, so epoll_wait() costs one
+ * blocking call no matter how many descriptors are registered.
+ *
+ * Level triggered descriptors are queried again after they have been
+ * reported, and devices which can not post events are queried on
+ * every wait.  Only those descriptors are sent to the servers.
+ */
+
+#include <sys/prex.h>
+#include <sys/posix.h>
+#include <sys/epoll.h>
+#include <ipc/fs.h>
+#include <ipc/network.h>
+#include <ipc/event.h>
+#include <ipc/ipc.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define EPOLL_MAX 8  /* instances per task */
+#define QUERY_MAX 32 /* descriptors per query message */
+
+struct epitem {
+    int fd;            /* descriptor, -1 if free */
+    u_int events;      /* events of interest */
+    epoll_data_t data; /* user data */
+    u_int pending;     /* events not reported yet */
+    u_char et;         /* edge triggered */
+    u_char polled;     /* server can not post events */
+    u_char recheck;    /* query on next wait */
+    u_char queued;     /* on the ready list */
+};
+
+struct epoll {
+    sem_t sem;             /* posted by the servers */
+    struct event_shm *shm; /* shared event rings */
+    int nitems;            /* slots in use, high water */
+    int nready;            /* entries in ready[] */
+    struct epitem items[EPOLL_MAXFDS];
+    int ready[EPOLL_MAXFDS];
+};
+
+extern object_t __fs_obj;
+static object_t net_obj = 0;
+static struct epoll *epolls[EPOLL_MAX];
+
+static int get_net_obj(void) {
+    if (net_obj == 0) {
+        if (object_lookup(OBJNAME_NETWORK, &net_obj) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static struct epoll *epoll_lookup(int epfd)
+{
+    int i = epfd - EPOLL_FDBASE;
+
+    if (i < 0 || i >= EPOLL_MAX || epolls[i] == NULL)
+        return NULL;
+    return epolls[i];
+}
+
+static void ready_insert(struct epoll *ep, int slot)
+{
+    struct epitem *it = &ep->items[slot];
+
+    if (!it->queued) {
+        it->queued = 1;
+        ep->ready[ep->nready++] = slot;
+    }
+}
+
+int epoll_create(int size)
+{
+    struct epoll *ep;
+    void *addr;
+    int i;
+
+    for (i = 0; i < EPOLL_MAX; i++) {
+        if (epolls[i] == NULL)
+            break;
+    }
+    if (i == EPOLL_MAX) {
+        errno = EMFILE;
+        return -1;
+    }
+    if ((ep = malloc(sizeof(*ep))) == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(ep, 0, sizeof(*ep));
+    if (vm_allocate(task_self(), &addr, sizeof(struct event_shm), 1) != 0) {
+        free(ep);
+        errno = ENOMEM;
+        return -1;
+    }
+    ep->shm = addr;
+    memset(ep->shm, 0, sizeof(struct event_shm));
+    if (sem_init(&ep->sem, 0) != 0) {
+        vm_free(task_self(), addr);
+        free(ep);
+        return -1;
+    }
+    epolls[i] = ep;
+    return EPOLL_FDBASE + i;
+}
+
+/*
+ * Send an event control message to the server of fd.
+ */
+static int epoll_send(struct epoll *ep, int op, int fd, int slot, u_int events,
+                      int *polled)
+{
+    struct event_msg m;
+    object_t obj;
+
+    if (fd >= SOCKET_FDBASE) {
+        if (get_net_obj() != 0)
+            return EBADF;
+        obj = net_obj;
+        m.hdr.code = NET_EVENT_CTL;
+    } else {
+        obj = __fs_obj;
+        m.hdr.code = FS_EVENT_CTL;
+    }
+    m.op = op;
+    m.fd = fd;
+    m.slot = slot;
+    m.events = events;
+    m.sem = ep->sem;
+    m.shm = ep->shm;
+    m.polled = 0;
+    if (msg_send(obj, &m, sizeof(m)) != 0)
+        return EIO;
+    if (polled != NULL)
+        *polled = m.polled;
+    return m.hdr.status;
+}
+
+static int epoll_add(struct epoll *ep, int slot, int fd, struct epoll_event *ev)
+{
+    struct epitem *it = &ep->items[slot];
+    u_int events;
+    int error, polled;
+
+    events = (ev->events & ~EPOLLET) | POLLERR | POLLHUP;
+    error = epoll_send(ep, EVENT_ADD, fd, slot, events, &polled);
+    if (error)
+        return error;
+    it->fd = fd;
+    it->events = events;
+    it->data = ev->data;
+    it->pending = 0;
+    it->et = (ev->events & EPOLLET) ? 1 : 0;
+    it->polled = (u_char)polled;
+    it->recheck = (u_char)polled;
+    return 0;
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *ev)
+{
+    struct epoll *ep;
+    struct epitem *it;
+    int slot, error;
+
+    if ((ep = epoll_lookup(epfd)) == NULL || fd < 0 || fd >= EPOLL_FDBASE) {
+        errno = EBADF;
+        return -1;
+    }
+    if (op != EPOLL_CTL_DEL && ev == NULL) {
+        errno = EFAULT;
+        return -1;
+    }
+    for (slot = 0; slot < ep->nitems; slot++) {
+        if (ep->items[slot].fd == fd)
+            break;
+    }
+
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        if (slot < ep->nitems) {
+            error = EEXIST;
+            break;
+        }
+        /*
+         * Prefer a fresh slot, so that stale events of a
+         * removed descriptor are not seen by a new one.
+         */
+        if (ep->nitems < EPOLL_MAXFDS) {
+            ep->items[slot].queued = 0;
+            ep->nitems++;
+        } else {
+            for (slot = 0; slot < ep->nitems; slot++) {
+                if (ep->items[slot].fd == -1)
+                    break;
+            }
+            if (slot == ep->nitems) {
+                error = ENOSPC;
+                break;
+            }
+        }
+        if ((error = epoll_add(ep, slot, fd, ev)) != 0) {
+            ep->items[slot].fd = -1;
+            if (slot == ep->nitems - 1 && !ep->items[slot].queued)
+                ep->nitems--;
+        }
+        break;
+    case EPOLL_CTL_DEL:
+    case EPOLL_CTL_MOD:
+        if (slot == ep->nitems) {
+            error = ENOENT;
+            break;
+        }
+        it = &ep->items[slot];
+        error = epoll_send(ep, EVENT_DEL, fd, slot, 0, NULL);
+        it->fd = -1;
+        it->pending = 0;
+        it->recheck = 0;
+        if (op == EPOLL_CTL_MOD && error == 0)
+            error = epoll_add(ep, slot, fd, ev);
+        break;
+    default:
+        error = EINVAL;
+        break;
+    }
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Move events from the rings to the ready list.
+ */
+static void epoll_collect(struct epoll *ep)
+{
+    struct event_ring *r;
+    struct event_entry *e;
+    struct epitem *it;
+    u_int head, tail;
+    int src, slot, overflow = 0;
+
+    for (src = 0; src < EVRING_NSRC; src++) {
+        r = &ep->shm->ring[src];
+        if (r->overflow) {
+            r->overflow = 0;
+            overflow = 1;
+        }
+        head = r->head;
+        __sync_synchronize();
+        for (tail = r->tail; tail != head; tail++) {
+            e = &r->ent[tail & (EVRING_SIZE - 1)];
+            slot = e->slot;
+            if (slot < 0 || slot >= ep->nitems)
+                continue;
+            it = &ep->items[slot];
+            if (it->fd == -1)
+                continue;
+            it->pending |= e->events;
+            ready_insert(ep, slot);
+        }
+        __sync_synchronize();
+        r->tail = tail;
+    }
+
+    /* Events were lost.  Check all descriptors. */
+    if (overflow) {
+        for (slot = 0; slot < ep->nitems; slot++) {
+            if (ep->items[slot].fd != -1)
+                ep->items[slot].recheck = 1;
+        }
+    }
+}
+
+static void query_result(struct epoll *ep, int slot, u_int revents)
+{
+    struct epitem *it = &ep->items[slot];
+
+    if (!it->polled)
+        it->recheck = 0;
+    revents &= it->events;
+    if (revents) {
+        it->pending |= revents;
+        ready_insert(ep, slot);
+    }
+}
+
+static void fs_query(struct epoll *ep, int *slots, int n)
+{
+    struct fs_poll_msg m;
+    int i;
+
+    m.hdr.code = FS_POLL_QUERY;
+    m.nfds = n;
+    for (i = 0; i < n; i++) {
+        m.fds[i].fd = ep->items[slots[i]].fd;
+        m.fds[i].events = (short)ep->items[slots[i]].events;
+        m.fds[i].revents = 0;
+    }
+    if (msg_send(__fs_obj, &m, sizeof(m)) != 0 || m.hdr.status != 0)
+        return;
+    for (i = 0; i < n; i++)
+        query_result(ep, slots[i], (u_short)m.fds[i].revents);
+}
+
+static void net_query(struct epoll *ep, int *slots, int n)
+{
+    struct net_poll_msg m;
+    int i;
+
+    if (get_net_obj() != 0)
+        return;
+    m.hdr.code = NET_POLL_QUERY;
+    m.nfds = n;
+    for (i = 0; i < n; i++) {
+        m.fds[i].fd = ep->items[slots[i]].fd;
+        m.fds[i].events = (short)ep->items[slots[i]].events;
+        m.fds[i].revents = 0;
+    }
+    if (msg_send(net_obj, &m, sizeof(m)) != 0 || m.hdr.status != 0)
+        return;
+    for (i = 0; i < n; i++)
+        query_result(ep, slots[i], (u_short)m.fds[i].revents);
+}
+
+/*
+ * Query the descriptors marked for recheck.
+ */
+static void epoll_recheck(struct epoll *ep)
+{
+    int fs_slots[QUERY_MAX], net_slots[QUERY_MAX];
+    int slot, nfs = 0, nnet = 0;
+    struct epitem *it;
+
+    for (slot = 0; slot < ep->nitems; slot++) {
+        it = &ep->items[slot];
+        if (it->fd == -1 || !it->recheck)
+            continue;
+        if (it->fd >= SOCKET_FDBASE) {
+            net_slots[nnet++] = slot;
+            if (nnet == QUERY_MAX) {
+                net_query(ep, net_slots, nnet);
+                nnet = 0;
+            }
+        } else {
+            fs_slots[nfs++] = slot;
+            if (nfs == QUERY_MAX) {
+                fs_query(ep, fs_slots, nfs);
+                nfs = 0;
+            }
+        }
+    }
+    if (nfs > 0)
+        fs_query(ep, fs_slots, nfs);
+    if (nnet > 0)
+        net_query(ep, net_slots, nnet);
+}
+
+/*
+ * Report events from the ready list.  Entries which do not fit in
+ * the caller's array stay on the list for the next call.
+ */
+static int epoll_deliver(struct epoll *ep, struct epoll_event *events, int maxevents)
+{
+    struct epitem *it;
+    u_int ev;
+    int i, j = 0, n = 0, slot;
+
+    for (i = 0; i < ep->nready; i++) {
+        slot = ep->ready[i];
+        it = &ep->items[slot];
+        ev = (it->fd == -1) ? 0 : (it->pending & it->events);
+        if (ev && n == maxevents) {
+            ep->ready[j++] = slot;
+            continue;
+        }
+        it->queued = 0;
+        it->pending = 0;
+        if (ev == 0)
+            continue;
+        events[n].events = ev;
+        events[n].data = it->data;
+        n++;
+        if (!it->et)
+            it->recheck = 1;
+    }
+    ep->nready = j;
+    return n;
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    struct epoll *ep;
+    int n, error;
+
+    if ((ep = epoll_lookup(epfd)) == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+    if (events == NULL || maxevents <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (;;) {
+        epoll_collect(ep);
+        epoll_recheck(ep);
+        n = epoll_deliver(ep, events, maxevents);
+        if (n > 0 || timeout == 0)
+            return n;
+
+        error = sem_wait(&ep->sem, (timeout < 0) ? 0 : (u_long)timeout);
+        if (error == ETIMEDOUT)
+            return 0;
+        if (error) {
+            errno = error;
+            return -1;
+        }
+    }
+}
+
+int __epoll_close(int epfd)
+{
+    struct fs_poll_msg fm;
+    struct net_poll_msg nm;
+    struct epoll *ep;
+
+    if ((ep = epoll_lookup(epfd)) == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+
+    /* Remove all listeners of this instance */
+    fm.hdr.code = FS_POLL_DEREGISTER;
+    fm.sem_id = ep->sem;
+    msg_send(__fs_obj, &fm, sizeof(fm));
+    if (net_obj != 0) {
+        nm.hdr.code = NET_POLL_DEREGISTER;
+        nm.sem_id = ep->sem;
+        msg_send(net_obj, &nm, sizeof(nm));
+    }
+
+    vm_free(task_self(), ep->shm);
+    sem_destroy(&ep->sem);
+    epolls[epfd - EPOLL_FDBASE] = NULL;
+    free(ep);
+    return 0;
+}
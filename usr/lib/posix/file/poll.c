@@ -29,6 +29,7 @@
 
 #include <sys/prex.h>
 #include <sys/poll.h>
+#include <sys/posix.h>
 #include <ipc/fs.h>
 #include <ipc/network.h>
 #include <ipc/ipc.h>
@@ -68,7 +69,7 @@ int poll(struct pollfd* fds, nfds_t nfds, int timeout)
     /* Categorize FDs into FS and Network */
     for (i = 0; i < (int)nfds; i++) {
         fds[i].revents = 0;
-        if (fds[i].fd >= 1024) { /* Sockets are usually high in Prex+ */
+        if (fds[i].fd >= SOCKET_FDBASE) {
             nm.fds[net_nfds].fd = fds[i].fd;
             nm.fds[net_nfds].events = fds[i].events;
             net_nfds++;
@@ -117,7 +118,7 @@ retry:
         nm.nfds = net_nfds;
         if (msg_send(net_obj, &nm, sizeof(nm)) == 0 && nm.hdr.status == 0) {
             for (i = 0; i < (int)nfds; i++) {
-                if (fds[i].fd >= 1024) {
+                if (fds[i].fd >= SOCKET_FDBASE) {
                     for (int j = 0; j < net_nfds; j++) {
                         if (nm.fds[j].fd == fds[i].fd) {
                             fds[i].revents = nm.fds[j].revents;
@@ -25,9 +25,12 @@
  */
 
 #include <sys/prex.h>
+#include <sys/posix.h>
 #include <sys/socket.h>
+#include <sys/endian.h>
 #include <ipc/network.h>
 #include <ipc/ipc.h>
+#include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
@@ -35,10 +38,24 @@
 
 static object_t net_obj = 0;
 
+extern void (*__sock_exit)(void);
+
+/*
+ * Tell the network server to drop the poll listeners and the
+ * event areas of this task.  Called from _exit().
+ */
+static void sock_exit(void) {
+    struct net_msg m;
+
+    m.hdr.code = NET_EXIT;
+    msg_send(net_obj, &m, NET_MSG_HDRSIZE);
+}
+
 static int get_net_obj(void) {
     if (net_obj == 0) {
         if (object_lookup(OBJNAME_NETWORK, &net_obj) != 0)
             return -1;
+        __sock_exit = sock_exit;
     }
     return 0;
 }
@@ -52,7 +69,7 @@ int socket(int domain, int type, int protocol) {
     m.type = type;
     m.protocol = protocol;
 
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE) != 0) return -1;
     if (m.hdr.status != 0) {
         errno = m.hdr.status;
         return -1;
@@ -66,41 +83,167 @@ static int is_ip_address(const char *s) {
     return 1;
 }
 
-struct hostent *gethostbyname(const char *name) {
-    static struct hostent he;
-    static struct in_addr addr;
-    static char *addr_list[2];
+/*
+ * Resolve a host name to at most NET_MAXADDRS IPv4 addresses.
+ * Returns 0 or an errno value.
+ */
+static int resolve(const char *name, uint32_t *addr, int *naddr) {
     struct net_msg m;
+    size_t len;
 
     if (is_ip_address(name)) {
         int a, b, c, d;
         sscanf(name, "%d.%d.%d.%d", &a, &b, &c, &d);
-        addr.s_addr = (uint32_t)((a & 0xff) | ((b & 0xff) << 8) | ((c & 0xff) << 16) | ((d & 0xff) << 24));
-    } else {
-        if (get_net_obj() != 0) return NULL;
+        addr[0] = (uint32_t)((a & 0xff) | ((b & 0xff) << 8) | ((c & 0xff) << 16) | ((d & 0xff) << 24));
+        *naddr = 1;
+        return 0;
+    }
+    if (get_net_obj() != 0) return ENETDOWN;
+
+    len = strlen(name);
+    if (len >= NET_INLINE) return ENAMETOOLONG;
+    m.hdr.code = NET_RESOLVE;
+    memcpy(m.data, name, len + 1);
+
+    /* The reply carries the addresses in data[], so size the message for them too. */
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE + MAX(len + 1, NET_MAXADDRS * sizeof(uint32_t))) != 0) return EIO;
+    if (m.hdr.status != 0) return m.hdr.status;
+    *naddr = (m.len > NET_MAXADDRS) ? NET_MAXADDRS : (int)m.len;
+    memcpy(addr, m.data, sizeof(uint32_t) * (size_t)*naddr);
+    return 0;
+}
 
-        m.hdr.code = NET_RESOLVE;
-        strncpy(m.data, name, 255);
-        m.data[255] = '\0';
+struct hostent *gethostbyname(const char *name) {
+    static struct hostent he;
+    static uint32_t addr[NET_MAXADDRS];
+    static char *addr_list[NET_MAXADDRS + 1];
+    int i, n, error;
 
-        if (msg_send(net_obj, &m, sizeof(m)) != 0) return NULL;
-        if (m.hdr.status != 0) {
-            errno = m.hdr.status;
-            return NULL;
-        }
-        memcpy(&addr.s_addr, m.data, 4);
+    if ((error = resolve(name, addr, &n)) != 0) {
+        errno = error;
+        return NULL;
     }
+    for (i = 0; i < n; i++)
+        addr_list[i] = (char *)&addr[i];
+    addr_list[n] = NULL;
 
     he.h_name = (char *)name;
     he.h_addrtype = AF_INET;
     he.h_length = 4;
-    addr_list[0] = (char *)&addr;
-    addr_list[1] = NULL;
     he.h_addr_list = addr_list;
 
     return &he;
 }
 
+/*
+ * getaddrinfo() for IPv4.  The service must be a port number.
+ * Each result is a single allocation with its address and name.
+ */
+int getaddrinfo(const char *node, const char *service,
+                const struct addrinfo *hints, struct addrinfo **res) {
+    uint32_t addr[NET_MAXADDRS];
+    struct addrinfo *ai, *head = NULL, **tail = &head;
+    struct sockaddr_in *sin;
+    int i, n, flags = 0, socktype = 0, protocol = 0;
+    size_t namelen = 0;
+    long port = 0;
+    char *end;
+
+    if (hints != NULL) {
+        if (hints->ai_family != AF_UNSPEC && hints->ai_family != AF_INET)
+            return EAI_FAMILY;
+        flags = hints->ai_flags;
+        socktype = hints->ai_socktype;
+        protocol = hints->ai_protocol;
+    }
+    if (node == NULL && service == NULL)
+        return EAI_NONAME;
+    if (service != NULL) {
+        port = strtol(service, &end, 10);
+        if (*service == '\0' || *end != '\0' || port < 0 || port > 65535)
+            return EAI_SERVICE;
+    }
+
+    if (node == NULL) {
+        addr[0] = htonl((flags & AI_PASSIVE) ? INADDR_ANY : INADDR_LOOPBACK);
+        n = 1;
+    } else if ((flags & AI_NUMERICHOST) && !is_ip_address(node)) {
+        return EAI_NONAME;
+    } else {
+        switch (resolve(node, addr, &n)) {
+        case 0:
+            break;
+        case ENOENT:
+        case ENAMETOOLONG:
+        case EINVAL:
+            return EAI_NONAME;
+        case ETIMEDOUT:
+        case EAGAIN:
+            return EAI_AGAIN;
+        default:
+            return EAI_FAIL;
+        }
+        if ((flags & AI_CANONNAME))
+            namelen = strlen(node) + 1;
+    }
+
+    for (i = 0; i < n; i++) {
+        ai = malloc(sizeof(*ai) + sizeof(*sin) + (i == 0 ? namelen : 0));
+        if (ai == NULL) {
+            freeaddrinfo(head);
+            return EAI_MEMORY;
+        }
+        memset(ai, 0, sizeof(*ai) + sizeof(*sin));
+        sin = (struct sockaddr_in *)(ai + 1);
+        sin->sin_len = sizeof(*sin);
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons((uint16_t)port);
+        sin->sin_addr.s_addr = addr[i];
+        ai->ai_family = AF_INET;
+        ai->ai_socktype = socktype;
+        ai->ai_protocol = protocol;
+        ai->ai_addrlen = sizeof(*sin);
+        ai->ai_addr = (struct sockaddr *)sin;
+        if (i == 0 && namelen > 0) {
+            ai->ai_canonname = (char *)(sin + 1);
+            memcpy(ai->ai_canonname, node, namelen);
+        }
+        *tail = ai;
+        tail = &ai->ai_next;
+    }
+    *res = head;
+    return 0;
+}
+
+void freeaddrinfo(struct addrinfo *ai) {
+    struct addrinfo *next;
+
+    for (; ai != NULL; ai = next) {
+        next = ai->ai_next;
+        free(ai);
+    }
+}
+
+const char *gai_strerror(int error) {
+    switch (error) {
+    case 0:
+        return "Success";
+    case EAI_FAMILY:
+        return "Address family not supported";
+    case EAI_MEMORY:
+        return "Memory allocation failure";
+    case EAI_NONAME:
+        return "Name does not resolve";
+    case EAI_SERVICE:
+        return "Service not supported";
+    case EAI_AGAIN:
+        return "Temporary failure in name resolution";
+    case EAI_FAIL:
+        return "Non-recoverable failure in name resolution";
+    }
+    return "Unknown error";
+}
+
 int bind(int s, const struct sockaddr *name, socklen_t namelen) {
     struct net_msg m;
     if (get_net_obj() != 0) return -1;
@@ -110,7 +253,7 @@ int bind(int s, const struct sockaddr *name, socklen_t namelen) {
     memcpy(&m.addr, name, namelen);
     m.addrlen = namelen;
 
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE) != 0) return -1;
     if (m.hdr.status != 0) {
         errno = m.hdr.status;
         return -1;
@@ -127,7 +270,7 @@ int connect(int s, const struct sockaddr *name, socklen_t namelen) {
     memcpy(&m.addr, name, namelen);
     m.addrlen = namelen;
 
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE) != 0) return -1;
     if (m.hdr.status != 0) {
         errno = m.hdr.status;
         return -1;
@@ -135,6 +278,34 @@ int connect(int s, const struct sockaddr *name, socklen_t namelen) {
     return 0;
 }
 
+/*
+ * Transfer socket data.  Small data is copied in the message, and
+ * larger buffers are passed by reference for the server to map, so
+ * a single request can move any amount of data.
+ */
+static ssize_t sock_xfer(struct net_msg *m, void *buf, size_t len, int out) {
+    size_t size = NET_MSG_HDRSIZE;
+
+    m->len = len;
+    if (len <= NET_INLINE) {
+        m->buf = NULL;
+        if (out)
+            memcpy(m->data, buf, len);
+        size += len;
+    } else {
+        m->buf = buf;
+    }
+
+    if (msg_send(net_obj, m, size) != 0) return -1;
+    if (m->hdr.status != 0) {
+        errno = m->hdr.status;
+        return -1;
+    }
+    if (!out && m->buf == NULL)
+        memcpy(buf, m->data, m->len);
+    return (ssize_t)m->len;
+}
+
 ssize_t send(int s, const void *msg, size_t len, int flags) {
     struct net_msg m;
     if (get_net_obj() != 0) return -1;
@@ -142,15 +313,7 @@ ssize_t send(int s, const void *msg, size_t len, int flags) {
     m.hdr.code = NET_SEND;
     m.socket = s;
     m.flags = flags;
-    m.len = (len > 2048) ? 2048 : len;
-    memcpy(m.data, msg, m.len);
-
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
-    if (m.hdr.status != 0) {
-        errno = m.hdr.status;
-        return -1;
-    }
-    return (ssize_t)m.len;
+    return sock_xfer(&m, (void *)msg, len, 1);
 }
 
 ssize_t recv(int s, void *buf, size_t len, int flags) {
@@ -160,15 +323,7 @@ ssize_t recv(int s, void *buf, size_t len, int flags) {
     m.hdr.code = NET_RECV;
     m.socket = s;
     m.flags = flags;
-    m.len = (len > 2048) ? 2048 : len;
-
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
-    if (m.hdr.status != 0) {
-        errno = m.hdr.status;
-        return -1;
-    }
-    memcpy(buf, m.data, m.len);
-    return (ssize_t)m.len;
+    return sock_xfer(&m, buf, len, 0);
 }
 
 ssize_t sendto(int s, const void *msg, size_t len, int flags, const struct sockaddr *to, socklen_t tolen) {
@@ -178,40 +333,124 @@ ssize_t sendto(int s, const void *msg, size_t len, int flags, const struct socka
     m.hdr.code = NET_SENDTO;
     m.socket = s;
     m.flags = flags;
-    m.len = (len > 2048) ? 2048 : len;
-    memcpy(m.data, msg, m.len);
     memcpy(&m.addr, to, tolen);
     m.addrlen = tolen;
+    return sock_xfer(&m, (void *)msg, len, 1);
+}
 
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
+ssize_t recvfrom(int s, void *buf, size_t len, int flags, struct sockaddr *from, socklen_t *fromlen) {
+    struct net_msg m;
+    ssize_t n;
+    if (get_net_obj() != 0) return -1;
+
+    m.hdr.code = NET_RECVFROM;
+    m.socket = s;
+    m.flags = flags;
+    m.addrlen = sizeof(m.addr);
+
+    if ((n = sock_xfer(&m, buf, len, 0)) < 0) return -1;
+    if (from && fromlen) {
+        memcpy(from, &m.addr, MIN(*fromlen, m.addrlen));
+        *fromlen = m.addrlen;
+    }
+    return n;
+}
+
+/*
+ * Copy a file to a socket through this task.  This is used when the
+ * file system server can not splice the file to the network server.
+ * Every read and send maps the buffer into a server, so the chunks
+ * are made large to keep the number of requests down.
+ */
+#define SENDFILE_BUFSZ 65536
+
+static ssize_t sendfile_copy(int s, int fd, off_t off, size_t count) {
+    char *buf;
+    size_t total = 0, bufsz;
+    ssize_t n, sent, ret;
+
+    if (lseek(fd, off, SEEK_SET) < 0) return -1;
+    if (count == 0) return 0;
+    bufsz = MIN(SENDFILE_BUFSZ, count);
+    if ((buf = malloc(bufsz)) == NULL) return -1;
+    ret = 0;
+    while (total < count) {
+        if ((n = read(fd, buf, MIN(bufsz, count - total))) <= 0) {
+            if (n < 0 && total == 0) ret = -1;
+            break;
+        }
+        if ((sent = send(s, buf, (size_t)n, 0)) < 0) {
+            if (total == 0) ret = -1;
+            break;
+        }
+        total += (size_t)sent;
+        if (sent < n) break;
+    }
+    free(buf);
+    return (ret < 0) ? -1 : (ssize_t)total;
+}
+
+/*
+ * Send a file to a socket.  The network server gets the data from
+ * the file system server, so it is not copied to this task.
+ */
+ssize_t sendfile(int s, int fd, off_t *offset, size_t count) {
+    struct net_msg m;
+    off_t off, cur;
+    ssize_t n;
+    if (get_net_obj() != 0) return -1;
+
+    if (offset == NULL) {
+        if ((off = lseek(fd, 0, SEEK_CUR)) < 0) return -1;
+    } else {
+        off = *offset;
+    }
+
+    m.hdr.code = NET_SENDFILE;
+    m.socket = s;
+    m.flags = 0;
+    m.fd = fd;
+    m.offset = off;
+    m.len = count;
+
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE) != 0) return -1;
+    if (m.hdr.status == EINVAL || m.hdr.status == ENOSYS) {
+        /* No splice in the fs server.  Copy the data here. */
+        if ((cur = lseek(fd, 0, SEEK_CUR)) < 0) return -1;
+        n = sendfile_copy(s, fd, off, count);
+        if (offset == NULL) {
+            lseek(fd, (n > 0) ? off + (off_t)n : cur, SEEK_SET);
+        } else {
+            lseek(fd, cur, SEEK_SET);
+            if (n > 0) *offset = off + (off_t)n;
+        }
+        return n;
+    }
     if (m.hdr.status != 0) {
         errno = m.hdr.status;
         return -1;
     }
+    off += (off_t)m.len;
+    if (offset == NULL)
+        lseek(fd, off, SEEK_SET);
+    else
+        *offset = off;
     return (ssize_t)m.len;
 }
 
-ssize_t recvfrom(int s, void *buf, size_t len, int flags, struct sockaddr *from, socklen_t *fromlen) {
+int __sock_close(int s) {
     struct net_msg m;
     if (get_net_obj() != 0) return -1;
 
-    m.hdr.code = NET_RECVFROM;
+    m.hdr.code = NET_CLOSE;
     m.socket = s;
-    m.flags = flags;
-    m.len = (len > 2048) ? 2048 : len;
-    if (fromlen) m.addrlen = *fromlen;
 
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE) != 0) return -1;
     if (m.hdr.status != 0) {
         errno = m.hdr.status;
         return -1;
     }
-    memcpy(buf, m.data, m.len);
-    if (from && fromlen) {
-        memcpy(from, &m.addr, m.addrlen);
-        *fromlen = m.addrlen;
-    }
-    return (ssize_t)m.len;
+    return 0;
 }
 
 int shutdown(int s, int how) {
@@ -222,7 +461,7 @@ int shutdown(int s, int how) {
     m.socket = s;
     m.flags = how;
 
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE) != 0) return -1;
     if (m.hdr.status != 0) {
         errno = m.hdr.status;
         return -1;
@@ -238,10 +477,30 @@ int listen(int s, int backlog) {
     m.socket = s;
     m.backlog = backlog;
 
-    if (msg_send(net_obj, &m, sizeof(m)) != 0) return -1;
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE) != 0) return -1;
     if (m.hdr.status != 0) {
         errno = m.hdr.status;
         return -1;
     }
     return 0;
 }
+
+int accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
+    struct net_msg m;
+    if (get_net_obj() != 0) return -1;
+
+    m.hdr.code = NET_ACCEPT;
+    m.socket = s;
+    m.addrlen = sizeof(m.addr);
+
+    if (msg_send(net_obj, &m, NET_MSG_HDRSIZE) != 0) return -1;
+    if (m.hdr.status != 0) {
+        errno = m.hdr.status;
+        return -1;
+    }
+    if (addr && addrlen) {
+        memcpy(addr, &m.addr, MIN(*addrlen, m.addrlen));
+        *addrlen = m.addrlen;
+    }
+    return m.socket;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * getrusage - get resource usage
+ *
+ * Only the CPU times and the context switch counts are kept by
+ * the kernel. Resource usage of child processes is not tracked.
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/resource.h>
+#include <string.h>
+#include <errno.h>
+
+static void cputime_to_timeval(const struct cputime* ct, struct timeval* tv)
+{
+
+    tv->tv_sec = (long)ct->sec;
+    tv->tv_usec = (long)ct->usec;
+}
+
+int getrusage(int who, struct rusage* rusage)
+{
+    struct usageinfo info;
+    struct cpuusage* u;
+    int error;
+
+    memset(rusage, 0, sizeof(*rusage));
+    switch (who) {
+    case RUSAGE_SELF:
+    case RUSAGE_THREAD:
+        if ((error = sys_info(INFO_USAGE, &info)) != 0) {
+            errno = error;
+            return -1;
+        }
+        u = (who == RUSAGE_THREAD) ? &info.thread : &info.task;
+        cputime_to_timeval(&u->utime, &rusage->ru_utime);
+        cputime_to_timeval(&u->stime, &rusage->ru_stime);
+        rusage->ru_nvcsw = (long)u->nvcsw;
+        rusage->ru_nivcsw = (long)u->nivcsw;
+        return 0;
+    case RUSAGE_CHILDREN:
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
@@ -39,6 +39,12 @@ extern void __file_exit(void);
 extern void __process_exit(int, int);
 #endif
 
+/*
+ * Set by the socket library once the network server is used.
+ * It is a hook so that programs without sockets do not link them.
+ */
+void (*__sock_exit)(void);
+
 void _exit(int status)
 {
 #ifndef _STANDALONE
@@ -46,6 +52,8 @@ void _exit(int status)
 
     __exception_exit(&signo);
     __file_exit();
+    if (__sock_exit)
+        __sock_exit();
     __process_exit(status, signo);
 #endif
 
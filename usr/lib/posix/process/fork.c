@@ -40,6 +40,7 @@
 #include <unistd.h>
 
 static void __child_entry(void);
+extern void __malloc_fork_child(void);
 
 static jmp_buf __fork_env;
 
@@ -133,6 +134,7 @@ static pid_t fork(void)
         error = mutex_init(&__sig_lock);
 #endif
         __sig_pending = 0;
+        __malloc_fork_child();
         return 0;
     }
     return pid;
@@ -28,6 +28,7 @@
  */
 
 #include <sys/prex.h>
+#include <sys/kdata.h>
 #include <sys/posix.h>
 #include <ipc/ipc.h>
 #include <ipc/proc.h>
@@ -39,6 +40,25 @@
 pid_t getpid(void)
 {
     struct msg m;
+#ifdef CONFIG_MMU
+    const volatile struct kdata_task* kt = (const volatile struct kdata_task*)KDATA_TASK;
+    u_int seq;
+    pid_t pid;
+
+    /*
+     * Read the id published by the process server. The
+     * sequence counter stays zero until it has been set. The
+     * fences keep the id read between the two counter reads.
+     */
+    do {
+        seq = kt->seq;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        pid = kt->pid;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != kt->seq);
+    if (seq != 0)
+        return pid;
+#endif
 
     m.hdr.code = PS_GETPID;
     __posix_call(__proc_obj, &m, sizeof(m), 1);
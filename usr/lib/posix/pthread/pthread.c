@@ -34,6 +34,8 @@
 #include <errno.h>
 #include <string.h>
 
+extern void __malloc_thread_exit(void);
+
 /*
  * Internal thread control block
  */
@@ -220,6 +222,9 @@ void pthread_exit(void* retval)
     self->retval = retval;
     self->terminated = 1;
 
+    /* Return the objects cached for this thread. */
+    __malloc_thread_exit();
+
     if (self->detached) {
         /* Remove from active list and prepend to reap list */
         struct __pthread *p, *prev;
@@ -297,6 +302,20 @@ int pthread_yield(void)
     return 0;
 }
 
+int pthread_setaffinity_np(pthread_t thread, size_t size, const cpu_set_t* set)
+{
+    if (thread == NULL || set == NULL || size < sizeof(cpu_set_t))
+        return EINVAL;
+    return thread_setaffinity(thread->kthread, set->__bits);
+}
+
+int pthread_getaffinity_np(pthread_t thread, size_t size, cpu_set_t* set)
+{
+    if (thread == NULL || set == NULL || size < sizeof(cpu_set_t))
+        return EINVAL;
+    return thread_getaffinity(thread->kthread, &set->__bits);
+}
+
 /*
  * Mutex implementation
  */
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * clock_gettime - get the time of a clock
+ *
+ * The CPU time clocks are read from the cycle-based accounting
+ * of the kernel, and have a resolution of a microsecond.
+ */
+
+#include <sys/prex.h>
+#include <sys/param.h>
+#include <sys/sysinfo.h>
+#include <sys/time.h>
+#include <errno.h>
+
+static void cputime_to_timespec(const struct cputime* u, const struct cputime* s, struct timespec* tp)
+{
+    u_long sec, usec;
+
+    sec = u->sec + s->sec;
+    usec = u->usec + s->usec;
+    if (usec >= 1000000) {
+        sec++;
+        usec -= 1000000;
+    }
+    tp->ts_sec = (time_t)sec;
+    tp->ts_nsec = (long)usec * 1000;
+}
+
+int clock_gettime(clockid_t clock_id, struct timespec* tp)
+{
+    struct usageinfo info;
+    struct timeval tv;
+    u_long ticks;
+    int error;
+
+    switch (clock_id) {
+    case CLOCK_REALTIME:
+        if (gettimeofday(&tv, NULL) < 0)
+            return -1;
+        TIMEVAL_TO_TIMESPEC(&tv, tp);
+        return 0;
+    case CLOCK_MONOTONIC:
+        sys_time(&ticks);
+        tp->ts_sec = (time_t)(ticks / HZ);
+        tp->ts_nsec = (long)(ticks % HZ) * (1000000000 / HZ);
+        return 0;
+    case CLOCK_PROCESS_CPUTIME_ID:
+    case CLOCK_THREAD_CPUTIME_ID:
+        if ((error = sys_info(INFO_USAGE, &info)) != 0) {
+            errno = error;
+            return -1;
+        }
+        if (clock_id == CLOCK_THREAD_CPUTIME_ID)
+            cputime_to_timespec(&info.thread.utime, &info.thread.stime, tp);
+        else
+            cputime_to_timespec(&info.task.utime, &info.task.stime, tp);
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+int clock_getres(clockid_t clock_id, struct timespec* res)
+{
+
+    switch (clock_id) {
+    case CLOCK_REALTIME:
+    case CLOCK_MONOTONIC:
+        res->ts_sec = 0;
+        res->ts_nsec = 1000000000 / HZ;
+        return 0;
+    case CLOCK_PROCESS_CPUTIME_ID:
+    case CLOCK_THREAD_CPUTIME_ID:
+        res->ts_sec = 0;
+        res->ts_nsec = 1000;
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
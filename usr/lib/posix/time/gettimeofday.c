@@ -28,25 +28,85 @@
  */
 
 #include <sys/prex.h>
+#include <sys/kdata.h>
 #include <sys/time.h>
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <errno.h>
 
-int gettimeofday(struct timeval* tv, struct timezone* tz)
+static int rtc_gettime(struct timeval* tv)
 {
     int fd, error;
 
-    if ((fd = open("/dev/rtc", 0)) < 0) {
-        errno = EPERM;
-        return -1;
-    }
+    if ((fd = open("/dev/rtc", 0)) < 0)
+        return EPERM;
     error = ioctl(fd, RTCIOC_GET_TIME, tv);
     close(fd);
-    if (error) {
+    return error;
+}
+
+#ifdef CONFIG_MMU
+/*
+ * The RTC driver derives the time from the boot time and the
+ * tick count, and the time can not be set. So the RTC is read
+ * only once, and later calls add the ticks elapsed since then
+ * from the kernel data page.
+ */
+static struct timeval base_tv; /* time read from RTC */
+static u_long base_ticks;      /* ticks at base_tv */
+static volatile int base_valid;
+
+static u_long kdata_ticks(int* hz)
+{
+    const volatile struct kdata* kd = (const volatile struct kdata*)KDATA_BASE;
+    u_int seq;
+    u_long ticks;
+
+    do {
+        seq = kd->seq;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        ticks = kd->ticks;
+        *hz = kd->hz;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != kd->seq);
+    return ticks;
+}
+
+int gettimeofday(struct timeval* tv, struct timezone* tz)
+{
+    u_long ticks, delta;
+    int hz, error;
+
+    ticks = kdata_ticks(&hz);
+    if (!base_valid) {
+        if ((error = rtc_gettime(&base_tv)) != 0) {
+            errno = error;
+            return -1;
+        }
+        base_ticks = ticks;
+        base_valid = 1;
+        *tv = base_tv;
+        return 0;
+    }
+    delta = ticks - base_ticks;
+    tv->tv_sec = base_tv.tv_sec + (long)(delta / hz);
+    tv->tv_usec = base_tv.tv_usec + (long)((delta % hz) * 1000000 / hz);
+    if (tv->tv_usec >= 1000000) {
+        tv->tv_sec++;
+        tv->tv_usec -= 1000000;
+    }
+    return 0;
+}
+#else
+int gettimeofday(struct timeval* tv, struct timezone* tz)
+{
+    int error;
+
+    if ((error = rtc_gettime(tv)) != 0) {
         errno = error;
         return -1;
     }
     return 0;
 }
+#endif
@@ -36,141 +36,589 @@
 #include <stdlib.h>
 #include "malloc.h"
 
+/*
+ * Size-class allocator with thread caches.
+ *
+ * A small object is taken from the cache of the calling thread
+ * without any lock. When the cache bin is empty, a batch of
+ * objects is moved from the arena of the thread. Each arena has
+ * its own lock, and threads are spread over the arenas.
+ *
+ * A large object is mapped by vm_allocate() directly, and it is
+ * returned to the kernel on free(). The chunk is also returned
+ * when all pages in it become free.
+ *
+ * The cache is released by pthread_exit(). A thread which exits
+ * by thread_terminate() keeps its cache until another thread
+ * hashed to the same slot finds the owner gone.
+ */
+
+#define THREAD_HASH(t) (((u_long)(t) >> 3) ^ ((u_long)(t) >> 9))
+
+static const u_short class_size[NR_CLASSES] = {
+    16,  32,  48,  64,  80,  96,  112, 128, 160, 192,  240,
+    288, 336, 400, 448, 496, 576, 672, 800, 1008, 1344, 2032,
+};
+
+/* Size class for each 16 bytes */
+static u_char size_class[SMALL_MAX / ALIGN_SIZE + 1];
+
+static struct arena arenas[NR_ARENAS] = {
+    [0 ... NR_ARENAS - 1] = { .lock = MUTEX_INITIALIZER },
+};
+static struct tcache tcaches[NR_TCACHES];
 #ifdef _REENTRANT
-static mutex_t malloc_lock = MUTEX_INITIALIZER;
+static mutex_t cache_lock = MUTEX_INITIALIZER;
 #endif
+static int malloc_initialized;
 
-static struct header* more_core(size_t size);
+static int tcache_reclaim(struct tcache*);
 
-static struct header free_list;  /* start of free list */
-static struct header* scan_head; /* start point to scan */
+static void malloc_init(void)
+{
+    int i, cls;
+
+    cls = 0;
+    for (i = 0; i <= SMALL_MAX / ALIGN_SIZE; i++) {
+        if (i * ALIGN_SIZE > class_size[cls])
+            cls++;
+        size_class[i] = (u_char)cls;
+    }
+    malloc_initialized = 1;
+}
 
 /*
- * Simple memory allocator from K&R
+ * Get the run including the object.
  */
-void* malloc(size_t size)
+static struct run* obj_run(void* p)
 {
-    struct header *p, *prev;
+    char* page;
 
-    if (size == 0) /* sanity check */
-        return NULL;
-    size = ROUNDUP(size + sizeof(struct header));
-
-    MALLOC_LOCK();
-
-    if (scan_head == NULL) {
-        /* Initialize */
-        free_list.next = &free_list;
-        free_list.size = 0;
-        free_list.vm_size = 0;
-        scan_head = &free_list;
-    }
-    prev = scan_head;
-    for (p = prev->next;; prev = p, p = p->next) {
-        if (p->size >= size) {   /* big enough */
-            if (p->size == size) /* exactly */
-                prev->next = p->next;
-            else { /* allocate tail end */
-                p->size -= size;
-                p = (struct header*)((char*)p + p->size);
-                p->size = size;
-                p->vm_size = 0;
-            }
-#ifdef DEBUG_MALLOC
-            p->magic = MALLOC_MAGIC;
-#endif
-            scan_head = prev;
+    page = (char*)((u_long)p & ~PAGE_MASK);
+    if (*(u_int*)page == CHUNK_MAGIC)
+        return (struct run*)(page + CHUNK_HDR);
+    return (struct run*)page;
+}
+
+/*
+ * Get a free page from the arena.
+ */
+static char* page_get(struct arena* a, struct chunk** chunkp)
+{
+    struct chunk* c;
+    struct run* r;
+    char* page;
+
+    if ((c = a->chunks) == NULL) {
+        if (vm_allocate(task_self(), (void**)&c, CHUNK_SIZE, 1))
+            return NULL;
+        c->magic = CHUNK_MAGIC;
+        c->arena = a;
+        c->nused = 0;
+        c->nfresh = CHUNK_SIZE / PAGE_SIZE;
+        c->pages = NULL;
+        c->prev = NULL;
+        c->next = NULL;
+        a->chunks = c;
+        a->heap += CHUNK_SIZE;
+    }
+    if ((r = c->pages) != NULL) {
+        c->pages = r->next;
+        page = (char*)((u_long)r & ~PAGE_MASK);
+    } else {
+        /* Never used pages are left untouched until now. */
+        page = (char*)c + (CHUNK_SIZE / PAGE_SIZE - c->nfresh) * PAGE_SIZE;
+        c->nfresh--;
+    }
+    c->nused++;
+
+    /* Remove the full chunk from the list. */
+    if (c->pages == NULL && c->nfresh == 0) {
+        a->chunks = c->next;
+        if (c->next != NULL)
+            c->next->prev = NULL;
+    }
+    *chunkp = c;
+    return page;
+}
+
+/*
+ * Return the page of the empty run to its chunk.
+ */
+static void page_put(struct arena* a, struct run* r)
+{
+    struct chunk* c = r->chunk;
+
+    /* The full chunk has a free page again. */
+    if (c->pages == NULL && c->nfresh == 0) {
+        c->prev = NULL;
+        c->next = a->chunks;
+        if (a->chunks != NULL)
+            a->chunks->prev = c;
+        a->chunks = c;
+    }
+    r->magic = 0;
+    r->next = c->pages;
+    c->pages = r;
+
+    /*
+     * Return the empty chunk to the kernel, unless it is the
+     * last one of the arena.
+     */
+    if (--c->nused == 0 && (c->prev != NULL || c->next != NULL)) {
+        if (c->prev != NULL)
+            c->prev->next = c->next;
+        else
+            a->chunks = c->next;
+        if (c->next != NULL)
+            c->next->prev = c->prev;
+        c->magic = 0;
+        vm_free(task_self(), c);
+        a->heap -= CHUNK_SIZE;
+    }
+}
+
+/*
+ * Allocate a small object from the arena.
+ * The arena must be locked.
+ */
+static void* arena_alloc(struct arena* a, int cls)
+{
+    struct chunk* c;
+    struct run* r;
+    struct obj* p;
+    char* page;
+
+    if ((r = a->partial[cls]) == NULL) {
+        /* Create new run */
+        if ((page = page_get(a, &c)) == NULL)
+            return NULL;
+        r = obj_run(page);
+        r->magic = RUN_MAGIC;
+        r->cls = (u_short)cls;
+        r->chunk = c;
+        r->free = NULL;
+        r->bump = (char*)r + RUN_HDR;
+        r->nobj = (u_short)((page + PAGE_SIZE - r->bump) / class_size[cls]);
+        r->nfree = r->nobj;
+        r->prev = NULL;
+        r->next = NULL;
+        a->partial[cls] = r;
+    }
+    if ((p = r->free) != NULL) {
+        r->free = p->next;
+    } else {
+        p = (struct obj*)r->bump;
+        r->bump += class_size[cls];
+    }
+
+    /* Remove the full run from the list. */
+    if (--r->nfree == 0) {
+        a->partial[cls] = r->next;
+        if (r->next != NULL)
+            r->next->prev = NULL;
+    }
+    a->small += class_size[cls];
+    return p;
+}
+
+/*
+ * Free a small object to the arena.
+ * The arena must be locked.
+ */
+static void arena_free(struct arena* a, struct run* r, struct obj* p)
+{
+    int cls = r->cls;
+
+    p->next = r->free;
+    r->free = p;
+    a->small -= class_size[cls];
+
+    /* The full run has a free object again. */
+    if (r->nfree++ == 0) {
+        r->prev = NULL;
+        r->next = a->partial[cls];
+        if (r->next != NULL)
+            r->next->prev = r;
+        a->partial[cls] = r;
+    }
+
+    /*
+     * Release the empty run, unless it is the last one of
+     * the size class.
+     */
+    if (r->nfree == r->nobj && (r->prev != NULL || r->next != NULL)) {
+        if (r->prev != NULL)
+            r->prev->next = r->next;
+        else
+            a->partial[cls] = r->next;
+        if (r->next != NULL)
+            r->next->prev = r->prev;
+        page_put(a, r);
+    }
+}
+
+/*
+ * Get the cache of the thread.
+ * Returns NULL if no cache is available for it.
+ */
+static struct tcache* tcache_get(thread_t self)
+{
+    struct tcache* tc;
+    int i;
+
+    i = (int)(THREAD_HASH(self) % NR_TCACHES);
+    tc = &tcaches[i];
+    if (tc->owner == self)
+        return tc;
+    if (tc->owner != 0) {
+        if (++tc->nmiss % TCACHE_PROBE != 0 || !tcache_reclaim(tc))
+            return NULL;
+    }
+
+    MALLOC_LOCK(&cache_lock);
+    if (tc->owner == 0) {
+        tc->owner = self;
+        tc->arena = &arenas[i % NR_ARENAS];
+    }
+    MALLOC_UNLOCK(&cache_lock);
+    return (tc->owner == self) ? tc : NULL;
+}
+
+/*
+ * Max number of objects in one cache bin.
+ */
+static int tcache_limit(int cls)
+{
+
+    if (class_size[cls] >= TCACHE_BYTES)
+        return 1;
+    return TCACHE_BYTES / class_size[cls];
+}
+
+/*
+ * Move a batch of objects from the arena to the cache bin,
+ * and return one of them.
+ */
+static void* tcache_fill(struct tcache* tc, int cls)
+{
+    struct arena* a = tc->arena;
+    struct obj *p, *q;
+    int n;
+
+    MALLOC_LOCK(&a->lock);
+    p = arena_alloc(a, cls);
+    for (n = tcache_limit(cls) / 2; p != NULL && n > 0; n--) {
+        if ((q = arena_alloc(a, cls)) == NULL)
             break;
-        }
-        if (p == scan_head) {
-            if ((p = more_core(size)) == NULL)
-                break;
-        }
+        q->next = tc->bin[cls];
+        tc->bin[cls] = q;
+        tc->count[cls]++;
     }
-    MALLOC_UNLOCK();
+    MALLOC_UNLOCK(&a->lock);
+    return p;
+}
 
-    if (p == NULL) {
-#ifdef DEBUG_MALLOC
-        sys_panic("malloc: out of memory");
-#endif
-        return NULL;
+/*
+ * Return the cached objects to their arenas until the bin
+ * has "keep" objects.
+ */
+static void tcache_flush(struct tcache* tc, int cls, int keep)
+{
+    struct arena *a, *locked;
+    struct obj* p;
+    struct run* r;
+
+    locked = NULL;
+    while (tc->count[cls] > keep) {
+        p = tc->bin[cls];
+        tc->bin[cls] = p->next;
+        tc->count[cls]--;
+
+        r = obj_run(p);
+        a = r->chunk->arena;
+        if (a != locked) {
+            if (locked != NULL)
+                MALLOC_UNLOCK(&locked->lock);
+            MALLOC_LOCK(&a->lock);
+            locked = a;
+        }
+        arena_free(a, r, p);
     }
-    return (void*)(p + 1);
+    if (locked != NULL)
+        MALLOC_UNLOCK(&locked->lock);
 }
 
 /*
- * Create new block and insert it to the free list.
+ * Return all objects and counts of the cache to the arenas.
+ * The cache must not be in use by its owner.
  */
-static struct header* more_core(size_t size)
+static void tcache_release(struct tcache* tc)
+{
+    struct arena* a;
+    int cls;
+
+    for (cls = 0; cls < NR_CLASSES; cls++)
+        tcache_flush(tc, cls, 0);
+
+    a = tc->arena;
+    MALLOC_LOCK(&a->lock);
+    a->nmalloc += tc->nmalloc;
+    a->nfree += tc->nfree;
+    a->nhit += tc->nhit;
+    MALLOC_UNLOCK(&a->lock);
+    tc->nmalloc = tc->nfree = tc->nhit = 0;
+}
+
+/*
+ * Release the cache of an owner which has exited without
+ * returning it. Returns true if the cache is free now.
+ */
+static int tcache_reclaim(struct tcache* tc)
+{
+    thread_t owner;
+    int pri;
+
+    if ((owner = tc->owner) == 0)
+        return 1;
+    if (thread_getpri(owner, &pri) != ESRCH)
+        return 0;
+
+    MALLOC_LOCK(&cache_lock);
+    if (tc->owner == owner) {
+        tcache_release(tc);
+        tc->owner = 0;
+    }
+    MALLOC_UNLOCK(&cache_lock);
+    return 1;
+}
+
+static void* large_alloc(size_t size)
 {
-    struct header *p, *prev;
+    struct large* l;
+    struct arena* a;
 
-    size = round_page(size);
-    if (vm_allocate(task_self(), (void*)&p, size, 1))
+    if (size > (size_t)-1 - LARGE_HDR - PAGE_MASK)
         return NULL;
-    p->size = size;
-    p->vm_size = size;
+    size = round_page(size + LARGE_HDR);
+    if (vm_allocate(task_self(), (void**)&l, size, 1))
+        return NULL;
+    l->magic = LARGE_MAGIC;
+    l->size = size;
 
-    /* Insert to free list */
-    for (prev = scan_head; !(p > prev && p < prev->next); prev = prev->next) {
-        if (prev >= prev->next && (p > prev || p < prev->next))
-            break;
+    a = &arenas[THREAD_HASH(thread_self()) % NR_ARENAS];
+    MALLOC_LOCK(&a->lock);
+    a->large += size;
+    a->nmalloc++;
+    MALLOC_UNLOCK(&a->lock);
+    return (char*)l + LARGE_HDR;
+}
+
+static void large_free(struct large* l)
+{
+    struct arena* a;
+    size_t size = l->size;
+
+    l->magic = 0;
+    vm_free(task_self(), l);
+
+    a = &arenas[THREAD_HASH(thread_self()) % NR_ARENAS];
+    MALLOC_LOCK(&a->lock);
+    a->large -= size;
+    a->nfree++;
+    MALLOC_UNLOCK(&a->lock);
+}
+
+void* malloc(size_t size)
+{
+    struct tcache* tc;
+    struct arena* a;
+    struct obj* p;
+    thread_t self;
+    int cls;
+
+    if (size == 0) /* sanity check */
+        return NULL;
+    if (!malloc_initialized)
+        malloc_init();
+
+    if (size > SMALL_MAX) {
+        p = large_alloc(size);
+    } else {
+        cls = size_class[(size + ALIGN_MASK) / ALIGN_SIZE];
+        self = thread_self();
+        if ((tc = tcache_get(self)) != NULL) {
+            tc->nmalloc++;
+            if ((p = tc->bin[cls]) != NULL) {
+                tc->bin[cls] = p->next;
+                tc->count[cls]--;
+                tc->nhit++;
+                return p;
+            }
+            p = tcache_fill(tc, cls);
+        } else {
+            a = &arenas[THREAD_HASH(self) % NR_ARENAS];
+            MALLOC_LOCK(&a->lock);
+            a->nmalloc++;
+            p = arena_alloc(a, cls);
+            MALLOC_UNLOCK(&a->lock);
+        }
     }
-    p->next = prev->next;
-    prev->next = p;
-    scan_head = prev;
-    return prev;
+#ifdef DEBUG_MALLOC
+    if (p == NULL)
+        sys_panic("malloc: out of memory");
+#endif
+    return p;
 }
 
 void free(void* addr)
 {
-    struct header *p, *prev;
+    struct tcache* tc;
+    struct large* l;
+    struct arena* a;
+    struct obj* p;
+    struct run* r;
+    int cls;
 
     if (addr == NULL)
         return;
 
-    MALLOC_LOCK();
-    p = (struct header*)addr - 1;
+    l = (struct large*)((u_long)addr & ~PAGE_MASK);
+    if (l->magic == LARGE_MAGIC && (char*)addr == (char*)l + LARGE_HDR) {
+        large_free(l);
+        return;
+    }
+    r = obj_run(addr);
+    if (r->magic != RUN_MAGIC) {
 #ifdef DEBUG_MALLOC
-    if (p->magic != MALLOC_MAGIC)
         sys_panic("free: invalid pointer");
-    p->magic = 0;
 #endif
-    for (prev = scan_head; !(p > prev && p < prev->next); prev = prev->next) {
-        if (prev >= prev->next && (p > prev || p < prev->next))
-            break;
+        return;
     }
-    if ((prev->next->vm_size == 0) && /* join to upper block */
-        ((char*)p + p->size == (char*)prev->next)) {
-        p->size += prev->next->size;
-        p->next = prev->next->next;
-    } else {
-        p->next = prev->next;
+    p = addr;
+    cls = r->cls;
+    if ((tc = tcache_get(thread_self())) != NULL) {
+        p->next = tc->bin[cls];
+        tc->bin[cls] = p;
+        tc->nfree++;
+        if (++tc->count[cls] > tcache_limit(cls))
+            tcache_flush(tc, cls, tcache_limit(cls) / 2);
+        return;
     }
-    if ((p->vm_size == 0) && /* join to lower block */
-        ((char*)prev + prev->size == (char*)p)) {
-        prev->size += p->size;
-        prev->next = p->next;
-    } else {
-        prev->next = p;
+    a = r->chunk->arena;
+    MALLOC_LOCK(&a->lock);
+    a->nfree++;
+    arena_free(a, r, p);
+    MALLOC_UNLOCK(&a->lock);
+}
+
+/*
+ * Return the usable size of the allocated object.
+ */
+size_t __malloc_usable(void* addr)
+{
+    struct large* l;
+    struct run* r;
+
+    l = (struct large*)((u_long)addr & ~PAGE_MASK);
+    if (l->magic == LARGE_MAGIC && (char*)addr == (char*)l + LARGE_HDR)
+        return l->size - LARGE_HDR;
+    r = obj_run(addr);
+    if (r->magic != RUN_MAGIC)
+        return 0;
+    return class_size[r->cls];
+}
+
+/*
+ * Release the cache of the current thread.
+ * This is called when the thread exits.
+ */
+void __malloc_thread_exit(void)
+{
+    struct tcache* tc;
+    thread_t self = thread_self();
+    int i;
+
+    i = (int)(THREAD_HASH(self) % NR_TCACHES);
+    tc = &tcaches[i];
+    if (tc->owner != self)
+        return;
+    tcache_release(tc);
+
+    MALLOC_LOCK(&cache_lock);
+    tc->owner = 0;
+    MALLOC_UNLOCK(&cache_lock);
+}
+
+/*
+ * Reset the allocator in the child of fork().
+ * Only the calling thread is copied to the child, so the locks
+ * held by other threads are recreated, and every cache, which
+ * now belongs to a thread of the parent, is returned.
+ */
+void __malloc_fork_child(void)
+{
+    struct tcache* tc;
+    int i;
+
+#ifdef _REENTRANT
+    for (i = 0; i < NR_ARENAS; i++)
+        mutex_init(&arenas[i].lock);
+    mutex_init(&cache_lock);
+#endif
+    for (i = 0; i < NR_TCACHES; i++) {
+        tc = &tcaches[i];
+        if (tc->owner != 0) {
+            tcache_release(tc);
+            tc->owner = 0;
+        }
+        tc->nmiss = 0;
+    }
+}
+
+/*
+ * Get the statistics of the allocator.
+ * The counts of the thread caches are not locked.
+ */
+int mallstat(struct mallstat* ms)
+{
+    struct arena* a;
+    struct tcache* tc;
+    int i, cls;
+
+    memset(ms, 0, sizeof(*ms));
+    for (i = 0; i < NR_ARENAS; i++) {
+        a = &arenas[i];
+        MALLOC_LOCK(&a->lock);
+        ms->ms_heap += a->heap;
+        ms->ms_small += a->small;
+        ms->ms_large += a->large;
+        ms->ms_nmalloc += a->nmalloc;
+        ms->ms_nfree += a->nfree;
+        ms->ms_nhit += a->nhit;
+        MALLOC_UNLOCK(&a->lock);
     }
-    /* Deallocate pool */
-    if (p->size == p->vm_size) {
-        prev->next = p->next;
-        vm_free(task_self(), p);
+    for (i = 0; i < NR_TCACHES; i++) {
+        tc = &tcaches[i];
+        if (tc->owner == 0)
+            continue;
+        for (cls = 0; cls < NR_CLASSES; cls++)
+            ms->ms_cached += (size_t)tc->count[cls] * class_size[cls];
+        ms->ms_nmalloc += tc->nmalloc;
+        ms->ms_nfree += tc->nfree;
+        ms->ms_nhit += tc->nhit;
     }
-    scan_head = prev;
-    MALLOC_UNLOCK();
+    return 0;
 }
 
 #ifdef DEBUG_MALLOC
 void mstat(void)
 {
-    struct header* p;
+    struct mallstat ms;
 
+    mallstat(&ms);
     printf("mstat: task=%x\n", task_self());
-    for (p = free_list.next; p != &free_list; p = p->next) {
-        printf("mstat: addr=%x size=%d next=%x\n", p, p->size, p->next);
-    }
+    printf("mstat: heap=%d small=%d cached=%d large=%d\n", ms.ms_heap, ms.ms_small, ms.ms_cached, ms.ms_large);
+    printf("mstat: malloc=%d free=%d hit=%d\n", ms.ms_nmalloc, ms.ms_nfree, ms.ms_nhit);
 }
 #endif
@@ -32,16 +32,14 @@
 
 /* #define DEBUG_MALLOC	1 */
 
-#define MALLOC_MAGIC (int)0xBAADF00D /* "bad food" from LocalAlloc :) */
-
 #ifdef _REENTRANT
-#define MALLOC_LOCK() mutex_lock(&malloc_lock);
-#define MALLOC_UNLOCK() mutex_unlock(&malloc_lock);
+#define MALLOC_LOCK(lock) mutex_lock(lock)
+#define MALLOC_UNLOCK(lock) mutex_unlock(lock)
 #else
-#define MALLOC_LOCK()                                                                                                  \
+#define MALLOC_LOCK(lock)                                                                                              \
     do {                                                                                                               \
     } while (0)
-#define MALLOC_UNLOCK()                                                                                                \
+#define MALLOC_UNLOCK(lock)                                                                                            \
     do {                                                                                                               \
     } while (0)
 #endif
@@ -50,12 +48,102 @@
 #define ALIGN_MASK (ALIGN_SIZE - 1)
 #define ROUNDUP(size) (((u_long)(size) + ALIGN_MASK) & ~ALIGN_MASK)
 
-struct header
+/*
+ * Small objects are carved from one page runs of the same size
+ * class. The runs are taken from chunks mapped by vm_allocate().
+ * Large objects are mapped directly.
+ */
+#define NR_CLASSES 22          /* number of size classes */
+#define SMALL_MAX 2032         /* largest small object */
+#define CHUNK_SIZE (64 * 1024) /* size of chunk */
+#define NR_ARENAS 4            /* number of arenas */
+#define NR_TCACHES 8           /* number of thread caches */
+#define TCACHE_BYTES 2048      /* bytes kept in one cache bin */
+#define TCACHE_PROBE 64        /* misses before the owner is checked */
+
+#define CHUNK_MAGIC 0x43686e6b /* "Chnk" */
+#define RUN_MAGIC 0x52756e21   /* "Run!" */
+#define LARGE_MAGIC 0x4c617267 /* "Larg" */
+
+struct obj
 {
-    struct header* next;
-    size_t size;
-    size_t vm_size;
-#ifdef DEBUG_MALLOC
-    int magic;
-#endif
+    struct obj* next; /* next free object */
 };
+
+/*
+ * Run - one page of small objects
+ */
+struct run
+{
+    u_int magic;         /* RUN_MAGIC */
+    u_short cls;         /* size class */
+    u_short nobj;        /* number of objects */
+    u_short nfree;       /* number of free objects */
+    struct chunk* chunk; /* chunk including this run */
+    struct obj* free;    /* free objects */
+    char* bump;          /* first object never used */
+    struct run* next;    /* link for partial runs */
+    struct run* prev;
+};
+
+/*
+ * Chunk - pages for runs
+ */
+struct chunk
+{
+    u_int magic;         /* CHUNK_MAGIC */
+    struct arena* arena; /* owner arena */
+    struct chunk* next;  /* link for chunks having free page */
+    struct chunk* prev;
+    int nused;           /* pages in use */
+    int nfresh;          /* pages never used */
+    struct run* pages;   /* free pages */
+};
+
+/*
+ * Header of large object
+ */
+struct large
+{
+    u_int magic; /* LARGE_MAGIC */
+    size_t size; /* mapped size */
+};
+
+#define RUN_HDR ROUNDUP(sizeof(struct run))
+#define CHUNK_HDR ROUNDUP(sizeof(struct chunk))
+#define LARGE_HDR ROUNDUP(sizeof(struct large))
+
+/*
+ * Arena - runs and chunks sharing one lock
+ */
+struct arena
+{
+    mutex_t lock;
+    struct run* partial[NR_CLASSES]; /* runs having free object */
+    struct chunk* chunks;            /* chunks having free page */
+    size_t heap;                     /* bytes mapped for chunks */
+    size_t small;                    /* bytes of small objects given */
+    size_t large;                    /* bytes mapped for large objects */
+    u_long nmalloc;
+    u_long nfree;
+    u_long nhit; /* allocations from thread cache */
+};
+
+/*
+ * Thread cache - small objects owned by one thread
+ */
+struct tcache
+{
+    thread_t owner;              /* owner thread */
+    struct arena* arena;         /* arena to refill */
+    struct obj* bin[NR_CLASSES]; /* cached objects */
+    u_short count[NR_CLASSES];   /* number of cached objects */
+    u_long nmalloc;
+    u_long nfree;
+    u_long nhit;   /* allocations from cache */
+    u_short nmiss; /* lookups by other threads */
+};
+
+size_t __malloc_usable(void*);
+void __malloc_thread_exit(void);
+void __malloc_fork_child(void);
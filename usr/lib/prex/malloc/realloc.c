@@ -33,18 +33,21 @@
 
 void* realloc(void* addr, size_t size)
 {
-    struct header *p, *old;
     size_t old_size;
+    void* p;
 
     if (addr == NULL)
         return malloc(size);
 
-    old = (struct header*)addr - 1;
+    old_size = __malloc_usable(addr);
 #ifdef DEBUG_MALLOC
-    if (old->magic != MALLOC_MAGIC)
-        sys_panic("free: invalid pointer");
+    if (old_size == 0)
+        sys_panic("realloc: invalid pointer");
 #endif
-    old_size = old->size - sizeof(struct header);
+    /* Keep the object if it still fits well. */
+    if (size != 0 && size <= old_size && size > old_size / 2)
+        return addr;
+
     if ((p = malloc(size)) == NULL)
         return NULL;
     if (old_size <= size)
@@ -96,5 +96,10 @@
 #define SYS_sys_debug 59
 #define SYS_device_gather_read 60
 #define SYS_device_scatter_write 61
+#define SYS_task_setpid 62
+#define SYS_thread_setaffinity 63
+#define SYS_thread_getaffinity 64
+#define SYS_sys_trace 65
+#define SYS_sys_prof 66
 
 #endif /* _SYSCALL_H */
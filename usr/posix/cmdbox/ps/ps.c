@@ -42,6 +42,7 @@ x *
 
 #define PSFX 0x01
 #define PSFL 0x02
+#define PSFT 0x04
 
 struct procinfo
 {
@@ -76,16 +77,62 @@ static int pstat(task_t task, struct procinfo* pi)
     return 0;
 }
 
+/*
+ * Print a CPU time in seconds with the given number of decimals.
+ */
+static void prtime(u_long sec, u_long usec, int width, int prec)
+{
+
+    if (prec == 2)
+        printf(" %*lu.%02lu", width - 3, sec, usec / 10000);
+    else
+        printf(" %*lu.%03lu", width - 4, sec, usec / 1000);
+}
+
+/*
+ * Print user + system time.
+ */
+static void prcpu(const struct cpuusage* u)
+{
+    u_long sec, usec;
+
+    sec = u->utime.sec + u->stime.sec;
+    usec = u->utime.usec + u->stime.usec;
+    if (usec >= 1000000) {
+        sec++;
+        usec -= 1000000;
+    }
+    prtime(sec, usec, 8, 2);
+}
+
+/*
+ * Get the CPU usage of a task, including its exited threads.
+ */
+static int taskusage(task_t task, struct cpuusage* u)
+{
+    static struct taskinfo ki;
+
+    ki.cookie = 0;
+    while (sys_info(INFO_TASK, &ki) == 0) {
+        if (ki.id == task) {
+            *u = ki.usage;
+            return 0;
+        }
+    }
+    return -1;
+}
+
 int main(int argc, char* argv[])
 {
     static const char stat[][2] = {"R", "Z", "S"};
     static const char pol[][5] = {"FIFO", "RR  "};
     static struct threadinfo ti;
     static struct procinfo pi;
+    static struct cpuusage usage;
     int ch, rc, ps_flag = 0;
-    pid_t last_pid = -2;
+    task_t last_task = TASK_NULL;
 
-    while ((ch = getopt(argc, argv, "lx")) != -1)
+    while ((ch = getopt(argc, argv, "ltx")) != -1)
         switch (ch) {
         case 'x':
             ps_flag |= PSFX;
@@ -93,10 +140,13 @@ int main(int argc, char* argv[])
         case 'l':
             ps_flag |= PSFL;
             break;
+        case 't':
+            ps_flag |= PSFT;
+            break;
 
         case '?':
         default:
-            fprintf(stderr, "usage: ps [-lx]\n");
+            fprintf(stderr, "usage: ps [-ltx]\n");
             exit(1);
         }
     argc -= optind;
@@ -105,7 +155,9 @@ int main(int argc, char* argv[])
     if (object_lookup("!proc", &procobj))
         exit(1);
 
-    if (ps_flag & PSFL)
+    if (ps_flag & PSFT)
+        printf("  PID      USER       SYS      INTR      WAIT   VCSW  IVCSW CMD\n");
+    else if (ps_flag & PSFL)
         printf("  PID  PPID PRI STAT POL      TIME WCHAN       CMD\n");
     else
         printf("  PID     TIME CMD\n");
@@ -124,25 +176,39 @@ int main(int argc, char* argv[])
             if (pstat(ti.task, &pi) && !(ps_flag & PSFX))
                 continue;
 
-            if (ps_flag & PSFL) {
+            if (ps_flag & PSFT) {
+                if (pi.pid == -1)
+                    printf("    -"); /* kernel */
+                else
+                    printf("%5d", pi.pid);
+
+                prtime(ti.usage.utime.sec, ti.usage.utime.usec, 9, 3);
+                prtime(ti.usage.stime.sec, ti.usage.stime.usec, 9, 3);
+                prtime(ti.usage.itime.sec, ti.usage.itime.usec, 9, 3);
+                prtime(ti.usage.wtime.sec, ti.usage.wtime.usec, 9, 3);
+                printf(" %6lu %6lu %-11s\n", ti.usage.nvcsw, ti.usage.nivcsw, ti.taskname);
+            } else if (ps_flag & PSFL) {
                 if (pi.pid == -1)
                     printf("    -     -"); /* kernel */
                 else
                     printf("%5d %5d", pi.pid, pi.ppid);
 
-                printf(" %3d %s    %s %8d "
-                       "%-11s %-11s\n",
-                       ti.priority, stat[pi.stat - 1], pol[ti.policy], ti.time, ti.slpevt, ti.taskname);
+                printf(" %3d %s    %s", ti.priority, stat[pi.stat - 1], pol[ti.policy]);
+                prcpu(&ti.usage);
+                printf(" %-11s %-11s\n", ti.slpevt, ti.taskname);
             } else {
-                if (!(ps_flag & PSFX) && (pi.pid == last_pid))
+                if (ti.task == last_task)
                     continue;
                 if (pi.pid == -1)
                     printf("    -"); /* kernel */
                 else
                     printf("%5d", pi.pid);
 
-                printf(" %8d %-11s\n", ti.time, ti.taskname);
-                last_pid = pi.pid;
+                if (taskusage(ti.task, &usage))
+                    usage = ti.usage;
+                prcpu(&usage);
+                printf(" %-11s\n", ti.taskname);
+                last_task = ti.task;
             }
         }
     } while (rc == 0);
@@ -44,6 +44,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <setjmp.h>
+#include <spawn.h>
 #include <libgen.h> /* for basename() */
 
 #include "sh.h"
@@ -54,6 +55,7 @@
 #define CMD_BACKGND 2
 #define CMD_BUILTIN 4
 
+extern char** environ;
 extern const struct cmdentry shell_cmds[];
 #ifdef CMDBOX
 extern const struct cmdentry builtin_cmds[];
@@ -107,15 +109,72 @@ static void showprompt(void)
     write(1, prompt, strlen(prompt));
 }
 
+/*
+ * Start an external command.
+ * The child is created by the exec server, so the shell is not
+ * duplicated for each command.  Returns the pid, or -1 on error.
+ */
+static int spawncmd(char* argv[], int* redir, int flags)
+{
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    pid_t pid = -1;
+    int i, error;
+
+    posix_spawn_file_actions_init(&fa);
+    for (i = 0; i < 2; i++) {
+        if (redir[i] != -1) {
+            posix_spawn_file_actions_adddup2(&fa, redir[i], i);
+            posix_spawn_file_actions_addclose(&fa, redir[i]);
+        }
+    }
+    if ((flags & CMD_BACKGND) && redir[0] == -1)
+        posix_spawn_file_actions_addopen(&fa, 0, "/dev/null", O_RDWR, 0);
+
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    error = posix_spawn(&pid, argv[0], &fa, &attr, argv, environ);
+    /* Try $PATH */
+    if (error == ENOENT)
+        error = posix_spawnp(&pid, argv[0], &fa, &attr, argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&fa);
+
+    if (error) {
+        if (error == ENOENT || error == ENOTDIR)
+            fprintf(stderr, "%s: command not found\n", argv[0]);
+        else if (error == EACCES)
+            fprintf(stderr, "Permission denied\n");
+        else
+            fprintf(stderr, "%s: %s\n", argv[0], strerror(error));
+        return -1;
+    }
+    tcsetpgrp(2, pid);
+    return pid;
+}
+
 static void execute(int argc, char* argv[], int* redir, int flags, cmdfn_t cmdfn)
 {
     int pid, i;
     int status;
-    static char** arg;
     char* file;
     char spid[20];
 
-    arg = argc > 1 ? &argv[1] : NULL;
+    if (cmdfn == NULL) {
+        pid = spawncmd(argv, redir, flags);
+        if (pid == -1) {
+            for (i = 0; i < 2; i++)
+                if (redir[i] != -1)
+                    close(redir[i]);
+            retval = 1;
+            return;
+        }
+        goto parent;
+    }
+
     file = argv[0];
     pid = vfork();
     if (pid == -1) {
@@ -150,25 +209,13 @@ static void execute(int argc, char* argv[], int* redir, int flags, cmdfn_t cmdfn
             }
         }
         errno = 0;
-        if (cmdfn) {
-            task_setname(task_self(), basename(file));
-            if (cmdfn(argc, argv) != 0)
-                fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
-        } else {
-            execv(file, arg);
-            /* Try $PATH */
-            if (errno == ENOENT)
-                execvp(file, arg);
-            if (errno == ENOENT || errno == ENOTDIR)
-                error("%s: command not found", argv[0]);
-            else if (errno == EACCES)
-                error("Permission denied");
-            else
-                error("%s: %s", argv[0], strerror(errno));
-        }
+        task_setname(task_self(), basename(file));
+        if (cmdfn(argc, argv) != 0)
+            fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
         exit(1);
         /* NOTREACHED */
     }
+parent:
     /* Parent */
     for (i = 0; i < 2; i++) {
         if (redir[i] != -1)
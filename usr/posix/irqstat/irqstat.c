@@ -0,0 +1,112 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * irqstat.c - display interrupt latency statistics.
+ *
+ * For each IRQ with an interrupt service thread, this shows the
+ * latency from the ISR entry to the IST start and the IST run
+ * time.  With -h, the log2 histograms are shown as well.
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Convert cycles to microseconds without 64-bit division.
+ */
+static u_long cyc2us(uint32_t cyc, uint32_t hz)
+{
+
+    if (hz == 0)
+        return 0;
+    if (hz >= 1000000)
+        return cyc / (hz / 1000000);
+    return cyc * (1000000 / hz);
+}
+
+static void print_hist(const char* name, const u_int* hist, uint32_t hz)
+{
+    int i;
+
+    printf("  %s:\n", name);
+    for (i = 0; i < IRQ_HISTSIZE; i++) {
+        if (hist[i] == 0)
+            continue;
+        printf("    < %8luus %10u\n", cyc2us(i == 31 ? 0xffffffff : 2U << i, hz), hist[i]);
+    }
+}
+
+static void usage(void)
+{
+
+    fputs("usage: irqstat [-h] [irq]\n", stderr);
+    exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+    struct irqinfo info;
+    int ch, hflag = 0, vec = -1;
+
+    while ((ch = getopt(argc, argv, "h")) != -1) {
+        switch (ch) {
+        case 'h':
+            hflag = 1;
+            break;
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc > 1)
+        usage();
+    if (argc == 1)
+        vec = atoi(argv[0]);
+
+    printf("IRQ CPU PRI      COUNT    ISTRUNS  LATMAX(us)  RUNMAX(us)\n");
+    info.cookie = 0;
+    while (sys_info(INFO_IRQ, &info) == 0) {
+        if (vec >= 0 && info.vector != vec)
+            continue;
+        printf("%3d %3d %3d %10u %10u %11lu %11lu\n", info.vector, info.cpu, info.priority, info.count,
+            info.istcount, cyc2us(info.lat_max, info.cyclehz), cyc2us(info.run_max, info.cyclehz));
+        if (hflag && info.istcount > 0) {
+            print_hist("latency", info.lat, info.cyclehz);
+            print_hist("run time", info.run, info.cyclehz);
+        }
+    }
+    return 0;
+}
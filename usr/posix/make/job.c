@@ -112,6 +112,11 @@ static char sccsid[] = "@(#)job.c	8.3 (Berkeley) 4/28/95";
 #include "dir.h"
 #include "job.h"
 #include "pathnames.h"
+#ifdef USE_SPAWN
+#include <spawn.h>
+
+extern char **environ;
+#endif
 
 extern int  errno;
 
@@ -995,6 +1000,55 @@ JobLocalInput(stream, job)
  *
  *-----------------------------------------------------------------------
  */
+#ifdef USE_SPAWN
+/*-
+ *-----------------------------------------------------------------------
+ * JobSpawn --
+ *	Start the shell for a job with a single spawn request. The
+ *	child's input and output are arranged with file actions instead
+ *	of in a vforked child.
+ *
+ * Results:
+ *	The process ID of the shell.
+ *
+ * Side Effects:
+ *	The command file is rewound.
+ *
+ *-----------------------------------------------------------------------
+ */
+static int
+JobSpawn(job, argv)
+    Job	    	  *job; 	/* Job to execute */
+    char    	  **argv;
+{
+    posix_spawn_file_actions_t fa;
+    int	    	  pid;
+    int	    	  error;
+
+    /*
+     * The child shares the offset of the command file with us, so
+     * rewind it here rather than in the child.
+     */
+    lseek(fileno(job->cmdFILE), 0, L_SET);
+
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, fileno(job->cmdFILE), 0);
+    if (usePipes) {
+	posix_spawn_file_actions_adddup2(&fa, job->outPipe, 1);
+    } else {
+	posix_spawn_file_actions_adddup2(&fa, job->outFd, 1);
+    }
+    posix_spawn_file_actions_adddup2(&fa, 1, 2);
+
+    error = posix_spawn(&pid, shellPath, &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    if (error) {
+	Punt("Cannot spawn %s: %s", shellPath, strerror(error));
+    }
+    return (pid);
+}
+#endif /* USE_SPAWN */
+
 static void
 JobExec(job, argv)
     Job	    	  *job; 	/* Job to execute */
@@ -1033,6 +1087,10 @@ JobExec(job, argv)
     }
 #endif /* RMT_NO_EXEC */
 
+#ifdef USE_SPAWN
+    cpid = JobSpawn(job, argv);
+    {
+#else
     if ((cpid =  vfork()) == -1) {
 	Punt ("Cannot fork");
     } else if (cpid == 0) {
@@ -1084,6 +1142,7 @@ JobExec(job, argv)
 		 sizeof ("Could not execute shell"));
 	_exit (1);
     } else {
+#endif /* USE_SPAWN */
 	job->pid = cpid;
 
 	if (usePipes && (job->flags & JOB_FIRST) ) {
@@ -25,6 +25,7 @@
  */
 
 #include <sys/prex.h>
+#include <sys/sysinfo.h>
 #include <sys/socket.h>
 #include <sys/endian.h>
 #include <stdio.h>
@@ -33,6 +34,67 @@
 #include <unistd.h>
 #include <errno.h>
 
+#define LISTEN_BUFSZ (64 * 1024)
+
+/*
+ * Accept one connection and copy the data to stdout.
+ * The receive buffer is large, so each recv() is a single request
+ * to the network server however much data is queued.
+ */
+static int nc_listen(uint16_t port) {
+    struct sockaddr_in local;
+    struct timerinfo info;
+    u_long start, end, msec;
+    size_t total = 0;
+    char *buf;
+    int s, c, n;
+
+    if ((buf = malloc(LISTEN_BUFSZ)) == NULL) {
+        printf("nc: out of memory\n");
+        return 1;
+    }
+    s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) {
+        perror("nc: socket");
+        return 1;
+    }
+
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+
+    if (bind(s, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        perror("nc: bind");
+        return 1;
+    }
+    if (listen(s, 1) < 0) {
+        perror("nc: listen");
+        return 1;
+    }
+    if ((c = accept(s, NULL, NULL)) < 0) {
+        perror("nc: accept");
+        return 1;
+    }
+
+    sys_time(&start);
+    while ((n = recv(c, buf, LISTEN_BUFSZ, 0)) > 0) {
+        if (write(1, buf, n) != n) break;
+        total += (size_t)n;
+    }
+    sys_time(&end);
+    if (n < 0) perror("nc: recv");
+
+    sys_info(INFO_TIMER, &info);
+    msec = (end - start) * 1000 / (u_long)info.hz;
+    if (msec == 0) msec = 1;
+    fprintf(stderr, "nc: %lu bytes in %lu msec (%lu KB/sec)\n",
+            (u_long)total, msec, (u_long)(total / msec * 1000 / 1024));
+
+    free(buf);
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     int s;
     struct sockaddr_in remote;
@@ -44,8 +106,11 @@ int main(int argc, char *argv[]) {
 
     if (argc < 3) {
         printf("usage: nc <hostname> <port>\n");
+        printf("       nc -l <port>\n");
         return 1;
     }
+    if (!strcmp(argv[1], "-l"))
+        return nc_listen((uint16_t)atoi(argv[2]));
 
     he = gethostbyname(argv[1]);
     if (he == NULL) {
@@ -0,0 +1,453 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * prof.c - statistical profiler.
+ *
+ * Required capabilities:
+ *      CAP_TASKCTRL
+ *
+ * The kernel counts the program counters sampled by the clock
+ * interrupt. This reads the counts, and resolves them to function
+ * names with the symbol tables of unstripped ELF files. Kernel
+ * addresses are looked up in the files given by -k, and user
+ * addresses in the file given by -s whose name matches the task.
+ */
+
+#include <sys/prex.h>
+#include <sys/param.h>
+#include <sys/sysinfo.h>
+#include <sys/prof.h>
+#include <sys/elf.h>
+
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NREAD 128  /* entries read at once */
+#define NTOP 20    /* default lines of report */
+
+/*
+ * Symbol table of an ELF file
+ */
+struct sym
+{
+    uint32_t addr;
+    uint32_t size;
+    const char* name;
+};
+
+struct symfile
+{
+    struct symfile* next;
+    char name[MAXTASKNAME]; /* task name, or empty for kernel */
+    struct sym* syms;       /* sorted by address */
+    int nsyms;
+    char* strtab;
+};
+
+/*
+ * Report line
+ */
+struct row
+{
+    uint32_t owner;   /* task or thread id */
+    uint32_t task;    /* task id */
+    const char* func; /* function name, NULL if not resolved */
+    uint32_t pc;      /* program counter if not resolved */
+    uint32_t flags;   /* PROF_xxx */
+    u_int count;
+};
+
+/*
+ * Task name
+ */
+struct taskname
+{
+    uint32_t id;
+    char name[MAXTASKNAME];
+};
+
+static struct symfile* symfiles;
+static struct taskname* tasks;
+static int ntasks;
+
+static struct prof_entry* entries;
+static int nentries;
+static u_int samples, dropped;
+static int period;
+
+static void usage(void)
+{
+
+    fputs("usage: prof start [-p ticks]\n"
+          "       prof stop\n"
+          "       prof report [-t] [-n count] [-k file] [-s file]\n",
+        stderr);
+    exit(1);
+}
+
+static int sym_cmp(const void* a, const void* b)
+{
+    const struct sym* sa = a;
+    const struct sym* sb = b;
+
+    if (sa->addr != sb->addr)
+        return sa->addr < sb->addr ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Read the function symbols of an ELF file.
+ */
+static int load_symbols(const char* path, int kernel)
+{
+    Elf32_Ehdr eh;
+    Elf32_Shdr* sh = NULL;
+    Elf32_Shdr *symsh, *strsh;
+    Elf32_Sym* st = NULL;
+    struct symfile* sf = NULL;
+    const char* base;
+    char* p;
+    FILE* fp;
+    int i, n, type;
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return -1;
+    if (fread(&eh, sizeof(eh), 1, fp) != 1 || memcmp(eh.e_ident, ELFMAG, SELFMAG) != 0 ||
+        eh.e_shentsize != sizeof(Elf32_Shdr))
+        goto err;
+    if ((sh = malloc(eh.e_shnum * sizeof(Elf32_Shdr))) == NULL)
+        goto err;
+    if (fseek(fp, (long)eh.e_shoff, SEEK_SET) != 0 || fread(sh, sizeof(Elf32_Shdr), eh.e_shnum, fp) != eh.e_shnum)
+        goto err;
+
+    symsh = NULL;
+    for (i = 0; i < eh.e_shnum; i++) {
+        if (sh[i].sh_type == SHT_SYMTAB && sh[i].sh_link < eh.e_shnum) {
+            symsh = &sh[i];
+            break;
+        }
+    }
+    if (symsh == NULL) {
+        fprintf(stderr, "prof: %s: no symbol table\n", path);
+        goto err;
+    }
+    strsh = &sh[symsh->sh_link];
+
+    if ((sf = calloc(1, sizeof(*sf))) == NULL)
+        goto err;
+    n = (int)(symsh->sh_size / sizeof(Elf32_Sym));
+    st = malloc(symsh->sh_size);
+    sf->syms = malloc(n * sizeof(struct sym));
+    sf->strtab = malloc(strsh->sh_size);
+    if (st == NULL || sf->syms == NULL || sf->strtab == NULL)
+        goto err;
+    if (fseek(fp, (long)symsh->sh_offset, SEEK_SET) != 0 || fread(st, symsh->sh_size, 1, fp) != 1)
+        goto err;
+    if (fseek(fp, (long)strsh->sh_offset, SEEK_SET) != 0 || fread(sf->strtab, strsh->sh_size, 1, fp) != 1)
+        goto err;
+
+    for (i = 0; i < n; i++) {
+        type = ELF32_ST_TYPE(st[i].st_info);
+        if (type != STT_FUNC && type != STT_NOTYPE)
+            continue;
+        if (st[i].st_shndx == SHN_UNDEF || st[i].st_value == 0 || st[i].st_name >= strsh->sh_size)
+            continue;
+        /* Skip local labels and mapping symbols */
+        p = sf->strtab + st[i].st_name;
+        if (*p == '\0' || *p == '$' || *p == '.')
+            continue;
+        sf->syms[sf->nsyms].addr = st[i].st_value & ~1U; /* Clear Thumb bit */
+        sf->syms[sf->nsyms].size = st[i].st_size;
+        sf->syms[sf->nsyms].name = p;
+        sf->nsyms++;
+    }
+    qsort(sf->syms, sf->nsyms, sizeof(struct sym), sym_cmp);
+
+    if (!kernel) {
+        /* Task name is the file name without the directory and suffix */
+        base = strrchr(path, '/');
+        base = base ? base + 1 : path;
+        strlcpy(sf->name, base, sizeof(sf->name));
+        if ((p = strchr(sf->name, '.')) != NULL)
+            *p = '\0';
+    }
+    sf->next = symfiles;
+    symfiles = sf;
+    free(st);
+    free(sh);
+    fclose(fp);
+    return 0;
+err:
+    if (sf != NULL) {
+        free(sf->syms);
+        free(sf->strtab);
+        free(sf);
+    }
+    free(st);
+    free(sh);
+    fclose(fp);
+    return -1;
+}
+
+/*
+ * Find the function containing pc in a symbol file.
+ */
+static const char* sym_lookup(const struct symfile* sf, uint32_t pc)
+{
+    const struct sym* s;
+    int lo = 0, hi = sf->nsyms - 1, mid;
+
+    s = NULL;
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (sf->syms[mid].addr <= pc) {
+            s = &sf->syms[mid];
+            lo = mid + 1;
+        } else
+            hi = mid - 1;
+    }
+    if (s == NULL || (s->size != 0 && pc >= s->addr + s->size))
+        return NULL;
+    return s->name;
+}
+
+static const char* task_name(uint32_t id)
+{
+    int i;
+
+    for (i = 0; i < ntasks; i++) {
+        if (tasks[i].id == id)
+            return tasks[i].name;
+    }
+    return NULL;
+}
+
+/*
+ * Resolve a program counter to a function name.
+ */
+static const char* resolve(const struct prof_entry* e)
+{
+    const struct symfile* sf;
+    const char* name;
+    const char* tname = NULL;
+
+    if (e->flags & PROF_UNKNOWN)
+        return "(unknown)";
+    if (e->flags & PROF_USER) {
+        if ((tname = task_name(e->task)) == NULL)
+            return NULL;
+    }
+    for (sf = symfiles; sf != NULL; sf = sf->next) {
+        if (tname == NULL ? sf->name[0] != '\0' : strcmp(sf->name, tname) != 0)
+            continue;
+        if ((name = sym_lookup(sf, e->pc)) != NULL)
+            return name;
+    }
+    return NULL;
+}
+
+/*
+ * Get the names of the running tasks.
+ */
+static void read_tasks(void)
+{
+    struct taskinfo ti;
+
+    ti.cookie = 0;
+    while (sys_info(INFO_TASK, &ti) == 0) {
+        tasks = realloc(tasks, (ntasks + 1) * sizeof(struct taskname));
+        if (tasks == NULL) {
+            perror("prof");
+            exit(1);
+        }
+        tasks[ntasks].id = (uint32_t)ti.id;
+        strlcpy(tasks[ntasks].name, ti.taskname, MAXTASKNAME);
+        ntasks++;
+    }
+}
+
+/*
+ * Read the entries of all CPUs.
+ */
+static int read_entries(void)
+{
+    struct prof_read pr;
+    int cpu, error;
+
+    for (cpu = 0;; cpu++) {
+        pr.index = 0;
+        do {
+            entries = realloc(entries, (nentries + NREAD) * sizeof(struct prof_entry));
+            if (entries == NULL)
+                return ENOMEM;
+            pr.cpu = cpu;
+            pr.count = NREAD;
+            pr.entries = &entries[nentries];
+            if ((error = sys_prof(PROF_READ, &pr)) != 0)
+                return error == ESRCH ? 0 : error;
+            nentries += pr.count;
+        } while (pr.count == NREAD);
+        samples += pr.samples;
+        dropped += pr.dropped;
+        period = pr.period;
+    }
+}
+
+static int row_key_cmp(const void* a, const void* b)
+{
+    const struct row* ra = a;
+    const struct row* rb = b;
+
+    if (ra->owner != rb->owner)
+        return ra->owner < rb->owner ? -1 : 1;
+    if (ra->func != rb->func) {
+        if (ra->func == NULL || rb->func == NULL)
+            return ra->func == NULL ? 1 : -1;
+        return strcmp(ra->func, rb->func);
+    }
+    if (ra->func == NULL && ra->pc != rb->pc)
+        return ra->pc < rb->pc ? -1 : 1;
+    return 0;
+}
+
+static int row_count_cmp(const void* a, const void* b)
+{
+    const struct row* ra = a;
+    const struct row* rb = b;
+
+    if (ra->count != rb->count)
+        return ra->count > rb->count ? -1 : 1;
+    return 0;
+}
+
+static void report(int tflag, int ntop)
+{
+    struct row* rows;
+    const char* name;
+    char owner[32], func[16];
+    int i, n;
+
+    if ((rows = malloc((nentries + 1) * sizeof(struct row))) == NULL) {
+        perror("prof");
+        exit(1);
+    }
+    for (i = 0; i < nentries; i++) {
+        rows[i].owner = tflag ? entries[i].thread : entries[i].task;
+        rows[i].task = entries[i].task;
+        rows[i].func = resolve(&entries[i]);
+        rows[i].pc = entries[i].pc;
+        rows[i].flags = entries[i].flags;
+        rows[i].count = entries[i].count;
+    }
+
+    /* Merge the entries for the same function */
+    qsort(rows, nentries, sizeof(struct row), row_key_cmp);
+    n = 0;
+    for (i = 0; i < nentries; i++) {
+        if (n > 0 && row_key_cmp(&rows[n - 1], &rows[i]) == 0)
+            rows[n - 1].count += rows[i].count;
+        else
+            rows[n++] = rows[i];
+    }
+    qsort(rows, n, sizeof(struct row), row_count_cmp);
+
+    printf("%u samples, %u dropped, every %d ticks (%d Hz)\n", samples, dropped, period,
+        period ? HZ / period : 0);
+    printf("     %%  SAMPLES %-20s FUNCTION\n", tflag ? "TASK:THREAD" : "TASK");
+    for (i = 0; i < n && i < ntop; i++) {
+        if ((name = task_name(rows[i].task)) == NULL)
+            name = "?";
+        if (tflag)
+            snprintf(owner, sizeof(owner), "%s:%08lx", name, (u_long)rows[i].owner);
+        else
+            strlcpy(owner, name, sizeof(owner));
+        if (rows[i].func == NULL)
+            snprintf(func, sizeof(func), "0x%08lx", (u_long)rows[i].pc);
+        printf("%3u.%01u %8u %-20s %s %s\n", samples ? rows[i].count * 100 / samples : 0,
+            samples ? rows[i].count * 1000 / samples % 10 : 0, rows[i].count, owner,
+            (rows[i].flags & PROF_USER) ? "[u]" : "[k]", rows[i].func ? rows[i].func : func);
+    }
+    free(rows);
+}
+
+int main(int argc, char* argv[])
+{
+    int ch, ticks = 1, tflag = 0, ntop = NTOP, error = 0;
+
+    if (argc < 2)
+        usage();
+
+    if (!strcmp(argv[1], "start")) {
+        while ((ch = getopt(argc - 1, argv + 1, "p:")) != -1) {
+            switch (ch) {
+            case 'p':
+                ticks = atoi(optarg);
+                break;
+            default:
+                usage();
+            }
+        }
+        error = sys_prof(PROF_START, (void*)ticks);
+    } else if (!strcmp(argv[1], "stop")) {
+        error = sys_prof(PROF_STOP, NULL);
+    } else if (!strcmp(argv[1], "report")) {
+        while ((ch = getopt(argc - 1, argv + 1, "tn:k:s:")) != -1) {
+            switch (ch) {
+            case 't':
+                tflag = 1;
+                break;
+            case 'n':
+                ntop = atoi(optarg);
+                break;
+            case 'k':
+            case 's':
+                if (load_symbols(optarg, ch == 'k') != 0)
+                    fprintf(stderr, "prof: cannot read symbols from %s\n", optarg);
+                break;
+            default:
+                usage();
+            }
+        }
+        read_tasks();
+        if ((error = read_entries()) == 0)
+            report(tflag, ntop);
+    } else
+        usage();
+
+    if (error) {
+        errno = error;
+        perror("prof");
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * trace.c - kernel event trace utility.
+ *
+ * Required capabilities:
+ *      CAP_TASKCTRL
+ */
+
+#include <sys/prex.h>
+#include <sys/param.h>
+#include <sys/syscall.h>
+#include <sys/trace.h>
+
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NREAD 128 /* events read at once */
+
+static const char* evname[NTRACE] = {
+    "swtch", "sysenter", "sysexit", "msgsend", "msgrecv", "msgreply", "irqenter", "irqexit", "pgfault", "timer",
+};
+
+#define _SYSNAME(name, narg) #name,
+static const char* sysname[] = {FOR_EACH_SYSCALL(_SYSNAME)};
+#undef _SYSNAME
+
+#define NSYSNAME (sizeof(sysname) / sizeof(sysname[0]))
+
+/*
+ * Event groups for "trace start".
+ */
+static const struct
+{
+    const char* name;
+    u_int mask;
+} groups[] = {
+    {"swtch", 1U << TR_SWTCH},
+    {"sys", (1U << TR_SYSENTER) | (1U << TR_SYSEXIT)},
+    {"msg", (1U << TR_MSGSEND) | (1U << TR_MSGRECV) | (1U << TR_MSGREPLY)},
+    {"irq", (1U << TR_IRQENTER) | (1U << TR_IRQEXIT)},
+    {"pgfault", 1U << TR_PGFAULT},
+    {"timer", 1U << TR_TIMER},
+    {"all", TRACE_ALL},
+    {NULL, 0},
+};
+
+/*
+ * Time stamp converter for one CPU.
+ *
+ * The 32-bit cycle count wraps in a few seconds on fast CPUs,
+ * so the tick count is used to catch long gaps.
+ */
+struct clock
+{
+    int valid;
+    uint32_t time; /* last cycle count */
+    uint32_t tick; /* last tick count */
+    long us;       /* microseconds since the first tick of the trace */
+    uint32_t rem;  /* cycles not yet counted in us */
+};
+
+static uint32_t cyclehz;
+static uint32_t tick0; /* first tick seen */
+static int tickset;
+static int jflag;
+static int nevents;
+
+static void usage(void)
+{
+
+    fputs("usage: trace start [swtch|sys|msg|irq|pgfault|timer|all ...]\n"
+          "       trace stop\n"
+          "       trace dump [-j]\n",
+          stderr);
+    exit(1);
+}
+
+/*
+ * Convert cycles less than a second to microseconds
+ * without 64-bit division.
+ */
+static long cyc2us(uint32_t cyc)
+{
+
+    if (cyclehz >= 1000000)
+        return (long)(cyc / (cyclehz / 1000000));
+    return (long)(cyc * (1000000 / cyclehz));
+}
+
+/*
+ * Return microseconds since the first tick of the trace.
+ * Events on other CPUs may be slightly negative.
+ */
+static long event_time(struct clock* c, const struct trace_event* e)
+{
+    uint32_t dt, cyc;
+
+    if (cyclehz < HZ)
+        return 0;
+    if (!c->valid) {
+        c->us = (long)(int32_t)(e->tick - tick0) * (1000000 / HZ);
+        c->rem = 0;
+        c->valid = 1;
+    } else {
+        dt = e->tick - c->tick;
+        if (dt >= 0x80000000U / (cyclehz / HZ)) {
+            /* The cycle counter may have wrapped */
+            c->us += (long)dt * (1000000 / HZ);
+        } else {
+            cyc = e->time - c->time;
+            c->us += (long)(cyc / cyclehz) * 1000000;
+            c->rem += cyc % cyclehz;
+            if (c->rem >= cyclehz) {
+                c->rem -= cyclehz;
+                c->us += 1000000;
+            }
+        }
+    }
+    c->time = e->time;
+    c->tick = e->tick;
+    return c->us + cyc2us(c->rem);
+}
+
+static void print_text(const struct trace_event* e, long us)
+{
+
+    printf("%3d %8ld.%03ld %08lx %-9s ", e->cpu, us / 1000, labs(us % 1000), (u_long)e->thread, evname[e->type]);
+    switch (e->type) {
+    case TR_SYSENTER:
+    case TR_SYSEXIT:
+        printf("%s %lx\n", e->arg[0] < NSYSNAME ? sysname[e->arg[0]] : "?", (u_long)e->arg[1]);
+        break;
+    case TR_IRQENTER:
+    case TR_IRQEXIT:
+        printf("%lu %lu\n", (u_long)e->arg[0], (u_long)e->arg[1]);
+        break;
+    default:
+        printf("%08lx %lx\n", (u_long)e->arg[0], (u_long)e->arg[1]);
+        break;
+    }
+}
+
+/*
+ * Chrome trace JSON.
+ *
+ * Process 0 has a lane per CPU showing the running thread and the
+ * interrupts. Process 1 has a lane per thread for the system calls.
+ * Other events are instant events on the thread lane.
+ */
+static void print_json(const struct trace_event* e, long us, uint32_t* running)
+{
+    const char* sep = nevents++ ? ",\n" : "";
+
+    switch (e->type) {
+    case TR_SWTCH:
+        if (running[0] != 0)
+            printf("%s{\"name\":\"%08lx\",\"ph\":\"E\",\"ts\":%ld,\"pid\":0,\"tid\":%d}", sep, (u_long)running[0],
+                us, e->cpu);
+        printf("%s{\"name\":\"%08lx\",\"ph\":\"B\",\"ts\":%ld,\"pid\":0,\"tid\":%d}", running[0] ? ",\n" : sep,
+            (u_long)e->arg[0], us, e->cpu);
+        running[0] = e->arg[0];
+        break;
+    case TR_IRQENTER:
+    case TR_IRQEXIT:
+        printf("%s{\"name\":\"irq %lu\",\"ph\":\"%s\",\"ts\":%ld,\"pid\":0,\"tid\":%d}", sep, (u_long)e->arg[0],
+            e->type == TR_IRQENTER ? "B" : "E", us, e->cpu);
+        break;
+    case TR_SYSENTER:
+    case TR_SYSEXIT:
+        printf("%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%ld,\"pid\":1,\"tid\":%lu,\"args\":{\"arg\":\"%lx\"}}", sep,
+            e->arg[0] < NSYSNAME ? sysname[e->arg[0]] : "?", e->type == TR_SYSENTER ? "B" : "E", us,
+            (u_long)e->thread, (u_long)e->arg[1]);
+        break;
+    default:
+        printf("%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%ld,\"pid\":1,\"tid\":%lu,"
+               "\"args\":{\"arg0\":\"%lx\",\"arg1\":\"%lx\"}}",
+            sep, evname[e->type], us, (u_long)e->thread, (u_long)e->arg[0], (u_long)e->arg[1]);
+        break;
+    }
+}
+
+/*
+ * Drain the buffers of all CPUs.
+ */
+static void trace_dump(void)
+{
+    struct trace_event* buf;
+    struct trace_read tr;
+    struct clock c;
+    uint32_t running;
+    u_long lost = 0;
+    long us;
+    int cpu, i;
+
+    if ((buf = malloc(NREAD * sizeof(*buf))) == NULL) {
+        perror("trace");
+        exit(1);
+    }
+    if (jflag)
+        printf("{\"traceEvents\":[\n");
+    else
+        printf("CPU     TIME(ms) THREAD   EVENT     ARGS\n");
+
+    for (cpu = 0;; cpu++) {
+        memset(&c, 0, sizeof(c));
+        running = 0;
+        for (;;) {
+            tr.cpu = cpu;
+            tr.count = NREAD;
+            tr.events = buf;
+            if ((errno = sys_trace(TRACE_READ, &tr)) != 0)
+                break;
+            lost += tr.lost;
+            cyclehz = tr.cyclehz;
+            if (tr.count == 0)
+                break;
+            if (!tickset) {
+                /* CPUs are aligned by their tick counts */
+                tick0 = buf[0].tick;
+                tickset = 1;
+            }
+            for (i = 0; i < tr.count; i++) {
+                if (buf[i].type >= NTRACE)
+                    continue;
+                us = event_time(&c, &buf[i]);
+                if (jflag)
+                    print_json(&buf[i], us, &running);
+                else
+                    print_text(&buf[i], us);
+            }
+        }
+        if (errno == ESRCH)
+            break;
+        if (errno != 0) {
+            perror("trace");
+            exit(1);
+        }
+    }
+    if (jflag)
+        printf("\n]}\n");
+    if (lost != 0)
+        fprintf(stderr, "trace: %lu events lost\n", lost);
+    free(buf);
+}
+
+int main(int argc, char* argv[])
+{
+    u_int mask = 0;
+    int i, ch, error = 0;
+
+    if (argc < 2)
+        usage();
+
+    if (!strcmp(argv[1], "start")) {
+        for (i = 2; i < argc; i++) {
+            for (ch = 0; groups[ch].name != NULL; ch++) {
+                if (!strcmp(argv[i], groups[ch].name))
+                    break;
+            }
+            if (groups[ch].name == NULL)
+                usage();
+            mask |= groups[ch].mask;
+        }
+        error = sys_trace(TRACE_START, (void*)(mask ? mask : TRACE_ALL));
+    } else if (!strcmp(argv[1], "stop")) {
+        error = sys_trace(TRACE_STOP, NULL);
+    } else if (!strcmp(argv[1], "dump")) {
+        while ((ch = getopt(argc - 1, argv + 1, "j")) != -1) {
+            switch (ch) {
+            case 'j':
+                jflag = 1;
+                break;
+            default:
+                usage();
+            }
+        }
+        trace_dump();
+    } else
+        usage();
+
+    if (error) {
+        errno = error;
+        perror("trace");
+        exit(1);
+    }
+    return 0;
+}
@@ -45,12 +45,15 @@
 #include <string.h>
 #include <unistd.h>
 #include <paths.h>
+#include <spawn.h>
 #include <stdarg.h>
 
 #ifndef _PATH_ECHO
 #define _PATH_ECHO "/bin/echo"
 #endif
 
+extern char **environ;
+
 static int tflag, rval;
 
 static void fatal(const char *fmt, ...)
@@ -66,10 +69,9 @@ static void fatal(const char *fmt, ...)
 
 static void run(char **argv)
 {
-	int noinvoke;
 	char **p;
 	pid_t pid;
-	int status;
+	int status, error;
 
 	if (tflag) {
 		(void)fprintf(stderr, "%s", *argv);
@@ -78,22 +80,15 @@ static void run(char **argv)
 		(void)fprintf(stderr, "\n");
 		(void)fflush(stderr);
 	}
-	noinvoke = 0;
-	switch(pid = vfork()) {
-	case -1:
-		fatal("vfork: %s", strerror(errno));
-	case 0:
-		execvp(argv[0], argv);
+	error = posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ);
+	if (error) {
 		(void)fprintf(stderr,
-		    "xargs: %s: %s\n", argv[0], strerror(errno));
-		noinvoke = 1;
-		_exit(1);
+		    "xargs: %s: %s\n", argv[0], strerror(error));
+		exit(127);
 	}
 	pid = waitpid(pid, &status, 0);
 	if (pid == -1)
 		fatal("waitpid: %s", strerror(errno));
-	if (noinvoke)
-		exit(127);
 	if (WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) == 255))
 		exit(1);
 	if (WIFEXITED(status) && WEXITSTATUS(status))
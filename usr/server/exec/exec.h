@@ -106,6 +106,7 @@ __BEGIN_DECLS
 void bind_cap(char*, task_t);
 int exec_bindcap(struct bind_msg*);
 int exec_execve(struct exec_msg*);
+int exec_spawn(struct spawn_msg*);
 __END_DECLS
 
 #endif /* !_EXEC_H */
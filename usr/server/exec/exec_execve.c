@@ -48,6 +48,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <libgen.h> /* for basename() */
+#include <spawn.h>
 
 #include "exec.h"
 
@@ -58,7 +59,7 @@
 #endif
 
 /* forward declarations */
-static int build_args(task_t, void*, char*, struct exec_msg*, char*, char*, void**);
+static int build_args(task_t, void*, char*, int, int, char*, size_t, char*, char*, void**);
 static int conv_path(char*, char*, char*);
 static void notify_server(task_t, task_t, void*);
 static int read_header(char*);
@@ -69,29 +70,27 @@ static int read_header(char*);
 static char hdrbuf[HEADER_SIZE];
 
 /*
- * Execute program
+ * Descriptor map sent to the file system server
  */
-int exec_execve(struct exec_msg* msg)
+static struct fdmap_msg fdmap;
+
+/*
+ * Find the loader for a program.
+ * @cwd:  current directory of the client
+ * @name: program path given by the client
+ * @path: full path to be returned
+ */
+static int probe_file(char* cwd, char* name, char* path, struct exec* exec, struct exec_loader** pldr)
 {
     struct exec_loader* ldr = NULL;
-    int error, i;
-    task_t old_task, new_task;
-    thread_t t;
-    void *stack, *sp;
-    char path[PATH_MAX];
-    struct exec exec;
-    int rc;
-
-    DPRINTF(("exec_execve: path=%s task=%x\n", msg->path, msg->hdr.task));
-
-    old_task = msg->hdr.task;
+    int error, i, rc;
 
     /*
      * Make it full path.
      */
-    if ((error = conv_path(msg->cwd, msg->path, path)) != 0) {
+    if ((error = conv_path(cwd, name, path)) != 0) {
         DPRINTF(("exec: invalid path\n"));
-        goto err1;
+        return error;
     }
 
     /*
@@ -99,22 +98,21 @@ int exec_execve(struct exec_msg* msg)
      */
     if (access(path, X_OK) == -1) {
         DPRINTF(("exec: no exec access\n"));
-        error = errno;
-        goto err1;
+        return errno;
     }
 
-    exec.path = path;
-    exec.header = hdrbuf;
-    exec.xarg1 = NULL;
-    exec.xarg2 = NULL;
+    exec->path = path;
+    exec->header = hdrbuf;
+    exec->xarg1 = NULL;
+    exec->xarg2 = NULL;
 
 again:
     /*
      * Read file header
      */
-    DPRINTF(("exec: read header for %s\n", exec.path));
-    if ((error = read_header(exec.path)) != 0)
-        goto err1;
+    DPRINTF(("exec: read header for %s\n", exec->path));
+    if ((error = read_header(exec->path)) != 0)
+        return error;
 
     /*
      * Find file loader
@@ -122,14 +120,13 @@ again:
     rc = PROBE_ERROR;
     for (i = 0; i < nloader; i++) {
         ldr = &loader_table[i];
-        if ((rc = ldr->el_probe(&exec)) != PROBE_ERROR) {
+        if ((rc = ldr->el_probe(exec)) != PROBE_ERROR) {
             break;
         }
     }
     if (rc == PROBE_ERROR) {
         DPRINTF(("exec: unsupported file format\n"));
-        error = ENOEXEC;
-        goto err1;
+        return ENOEXEC;
     }
 
     /*
@@ -143,61 +140,107 @@ again:
     /*
      * Check file permission.
      */
-    if (access(exec.path, X_OK) == -1) {
+    if (access(exec->path, X_OK) == -1) {
         DPRINTF(("exec: no exec access\n"));
-        error = errno;
-        goto err1;
+        return errno;
     }
+    *pldr = ldr;
+    return 0;
+}
 
-    /*
-     * Suspend old task
-     */
-    if ((error = task_suspend(old_task)) != 0)
-        goto err1;
-
-    /*
-     * Create new task
-     */
-    if ((error = task_create(old_task, VM_NEW, &new_task)) != 0) {
-        DPRINTF(("exec: failed to crete task\n"));
-        goto err1;
-    }
+/*
+ * Load a program into a new task, and create its first thread.
+ * The thread is left suspended.
+ */
+static int load_image(task_t task, struct exec* exec, struct exec_loader* ldr, int argc, int envc, char* buf,
+                      size_t bufsz, thread_t* pt, void** pstack)
+{
+    thread_t t;
+    void *stack, *sp;
+    int error;
 
-    if (*exec.path != '\0')
-        task_setname(new_task, basename(exec.path));
+    if (*exec->path != '\0')
+        task_setname(task, basename(exec->path));
 
     /*
      * Bind capabilities.
      */
-    bind_cap(exec.path, new_task);
+    bind_cap(exec->path, task);
 
-    if ((error = thread_create(new_task, &t)) != 0)
-        goto err3;
+    if ((error = thread_create(task, &t)) != 0)
+        return error;
 
     /*
      * Allocate stack and build arguments on it.
      */
-    error = vm_allocate(new_task, &stack, DFLSTKSZ, 1);
+    error = vm_allocate(task, &stack, DFLSTKSZ, 1);
     if (error) {
         DPRINTF(("exec: failed to allocate stack\n"));
-        goto err4;
+        goto err1;
     }
-    if ((error = build_args(new_task, stack, exec.path, msg, exec.xarg1, exec.xarg2, &sp)) != 0)
-        goto err5;
+    if ((error = build_args(task, stack, exec->path, argc, envc, buf, bufsz, exec->xarg1, exec->xarg2, &sp)) != 0)
+        goto err2;
 
     /*
      * Load file image.
      */
     DPRINTF(("exec: load file image\n"));
-    exec.task = new_task;
-    if ((error = ldr->el_load(&exec)) != 0)
-        goto err5;
+    exec->task = task;
+    if ((error = ldr->el_load(exec)) != 0)
+        goto err2;
 #if defined(__arm__)
-    if ((error = thread_setup(t, (void (*)(void))exec.entry, sp, (void*)exec.gp)) != 0)
+    if ((error = thread_setup(t, (void (*)(void))exec->entry, sp, (void*)exec->gp)) != 0)
 #else
-    if ((error = thread_load(t, (void (*)(void))exec.entry, sp)) != 0)
+    if ((error = thread_load(t, (void (*)(void))exec->entry, sp)) != 0)
 #endif
-        goto err5;
+        goto err2;
+
+    *pt = t;
+    *pstack = stack;
+    return 0;
+err2:
+    vm_free(task, stack);
+err1:
+    thread_terminate(t);
+    return error;
+}
+
+/*
+ * Execute program
+ */
+int exec_execve(struct exec_msg* msg)
+{
+    struct exec_loader* ldr;
+    int error;
+    task_t old_task, new_task;
+    thread_t t;
+    void* stack;
+    char path[PATH_MAX];
+    struct exec exec;
+
+    DPRINTF(("exec_execve: path=%s task=%x\n", msg->path, msg->hdr.task));
+
+    old_task = msg->hdr.task;
+
+    if ((error = probe_file(msg->cwd, msg->path, path, &exec, &ldr)) != 0)
+        goto err1;
+
+    /*
+     * Suspend old task
+     */
+    if ((error = task_suspend(old_task)) != 0)
+        goto err1;
+
+    /*
+     * Create new task
+     */
+    if ((error = task_create(old_task, VM_NEW, &new_task)) != 0) {
+        DPRINTF(("exec: failed to crete task\n"));
+        goto err1;
+    }
+
+    if ((error = load_image(new_task, &exec, ldr, msg->argc, msg->envc, msg->buf, msg->bufsz, &t, &stack)) != 0)
+        goto err2;
 
     /*
      * Notify to servers.
@@ -217,17 +260,105 @@ again:
 
     DPRINTF(("exec done\n"));
     return 0;
-err5:
-    vm_free(new_task, stack);
-err4:
-    thread_terminate(t);
-err3:
+err2:
     task_terminate(new_task);
 err1:
     DPRINTF(("exec failed error=%d\n", error));
     return error;
 }
 
+/*
+ * Spawn program
+ *
+ * Unlike fork() and exec(), the caller is not copied and keeps
+ * running.  The child is created empty, and the proc and fs servers
+ * are told about it once.
+ */
+int exec_spawn(struct spawn_msg* msg)
+{
+    struct exec_loader* ldr;
+    struct fdmap_msg* fm;
+    struct msg m;
+    object_t fsobj, procobj;
+    task_t parent, child;
+    thread_t t;
+    void* stack;
+    char path[PATH_MAX];
+    struct exec exec;
+    int error, i;
+
+    DPRINTF(("exec_spawn: path=%s task=%x\n", msg->path, msg->hdr.task));
+
+    parent = msg->hdr.task;
+
+    if (msg->nfds < 0 || msg->nfds > OPEN_MAX)
+        return EINVAL;
+    if (object_lookup("!fs", &fsobj) != 0 || object_lookup("!proc", &procobj) != 0)
+        return ENOSYS;
+
+    if ((error = probe_file(msg->cwd, msg->path, path, &exec, &ldr)) != 0)
+        goto err1;
+
+    if ((error = task_create(parent, VM_NEW, &child)) != 0) {
+        DPRINTF(("exec: failed to crete task\n"));
+        goto err1;
+    }
+    if ((error = load_image(child, &exec, ldr, msg->argc, msg->envc, msg->buf, msg->bufsz, &t, &stack)) != 0)
+        goto err2;
+
+    /*
+     * Set up the files of the child.
+     */
+    fm = &fdmap;
+    fm->hdr.code = FS_SPAWN;
+    fm->parent = parent;
+    fm->child = child;
+    fm->nfds = msg->nfds;
+    for (i = 0; i < msg->nfds; i++)
+        fm->fds[i] = msg->fds[i];
+    do {
+        error = msg_send(fsobj, fm, sizeof(*fm));
+    } while (error == EINTR);
+    if (error == 0)
+        error = fm->hdr.status;
+    if (error)
+        goto err2;
+
+    /*
+     * Create the process.
+     */
+    do {
+        m.hdr.code = PS_SPAWN;
+        m.data[0] = (int)parent;
+        m.data[1] = (int)child;
+        m.data[2] = (int)stack;
+        m.data[3] = (msg->flags & POSIX_SPAWN_SETPGROUP) ? (int)msg->pgroup : -1;
+        error = msg_send(procobj, &m, sizeof(m));
+    } while (error == EINTR);
+    if (error == 0)
+        error = m.hdr.status;
+    if (error)
+        goto err3;
+    msg->pid = (pid_t)m.data[0];
+
+    thread_setpri(t, PRI_DEFAULT);
+    thread_resume(t);
+
+    DPRINTF(("spawn done pid=%d\n", msg->pid));
+    return 0;
+err3:
+    /* Release the files of the child */
+    fm->hdr.code = FS_SPAWN;
+    fm->parent = 0;
+    fm->child = child;
+    msg_send(fsobj, fm, sizeof(*fm));
+err2:
+    task_terminate(child);
+err1:
+    DPRINTF(("spawn failed error=%d\n", error));
+    return error;
+}
+
 /*
  * Convert to full path from the cwd of task and path.
  * @cwd:  current working directory
@@ -303,18 +434,15 @@ static int conv_path(char* cwd, char* path, char* full)
  *
  * NOTE: This may depend on processor architecture.
  */
-static int build_args(task_t task, void* stack, char* path, struct exec_msg* msg, char* xarg1, char* xarg2,
-                      void** new_sp)
+static int build_args(task_t task, void* stack, char* path, int argc, int envc, char* buf, size_t bufsz, char* xarg1,
+                      char* xarg2, void** new_sp)
 {
-    int argc, envc;
     char* file;
     char **argv, **envp;
     int i, error;
     u_long arg_top, mapped, sp;
     int len;
 
-    argc = msg->argc;
-    envc = msg->envc;
     DPRINTF(("exec: argc=%d envc=%d\n", argc, envc));
     DPRINTF(("exec: xarg1=%s xarg2=%s\n", xarg1, xarg2));
 
@@ -339,9 +467,9 @@ static int build_args(task_t task, void* stack, char* path, struct exec_msg* msg
     file = (char*)sp;
 
     /* arg/env */
-    sp -= msg->bufsz;
+    sp -= bufsz;
     sp = SP_ALIGN(sp);
-    memcpy((char*)sp, (char*)&msg->buf, msg->bufsz);
+    memcpy((char*)sp, buf, bufsz);
     arg_top = sp;
 
     /*
@@ -92,7 +92,10 @@ fn buildArgs(
     task: ffi.task.prex.task_t,
     stack: ?*anyopaque,
     path: [*c]const u8,
-    msg: *ffi.ExecMsg,
+    argc: c_int,
+    envc: c_int,
+    buf: [*c]u8,
+    bufsz: usize,
     xarg1: ?[*c]const u8,
     xarg2: ?[*c]const u8,
     new_sp: *?*anyopaque,
@@ -103,7 +106,10 @@ fn buildArgs(
         task,
         stack,
         @constCast(path),
-        msg,
+        argc,
+        envc,
+        buf,
+        bufsz,
         xa1,
         xa2,
         new_sp,
@@ -138,24 +144,18 @@ fn notifyServer(org_task: ffi.task.prex.task_t, new_task: ffi.task.prex.task_t,
     }
 }
 
-fn doExecve(msg: *ffi.ExecMsg) !void {
-    const old_task: ffi.task.prex.task_t = msg.hdr.task;
-    var new_task: ffi.task.prex.task_t = undefined;
-    var t: ffi.task.prex.thread_t = undefined;
-    var stack: ?*anyopaque = undefined;
-    var sp: ?*anyopaque = undefined;
-    var path: [MAX_PATH]u8 = undefined;
-    var exec: ffi.Exec = undefined;
-
+/// Find the loader for a program. `path` receives the full path and
+/// must outlive `exec`.
+fn probeFile(cwd: [*c]const u8, name: [*c]u8, path: [*c]u8, exec: *ffi.Exec) !*const ffi.ExecLoader {
     // Make it full path
-    try convPath(@ptrCast(&msg.cwd), @ptrCast(&msg.path), @ptrCast(&path));
+    try convPath(cwd, name, path);
 
     // Check permission
-    if (ffi.prog.unistd.access(@ptrCast(&path), ffi.prog.unistd.X_OK) == -1) {
+    if (ffi.prog.unistd.access(path, ffi.prog.unistd.X_OK) == -1) {
         return ffi.fromCError(ffi.prog.errno.errno);
     }
 
-    exec.init(@ptrCast(&path), null);
+    exec.init(path, null);
 
     // Read file header and find the matching loader (follows #! interpreters)
     const ldr = try exec.findLoader();
@@ -164,13 +164,23 @@ fn doExecve(msg: *ffi.ExecMsg) !void {
     if (ffi.prog.unistd.access(exec.path, ffi.prog.unistd.X_OK) == -1) {
         return ffi.fromCError(ffi.prog.errno.errno);
     }
+    return ldr;
+}
 
-    // Suspend old task
-    try checkErrno(ffi.task.prex.task_suspend(old_task));
-
-    // Create new task
-    try checkErrno(ffi.task.prex.task_create(old_task, ffi.task.prex.VM_NEW, &new_task));
-    errdefer _ = ffi.task.prex.task_terminate(new_task);
+/// Load a program into a new task, and create its first thread.
+/// The thread is left suspended.
+fn loadImage(
+    new_task: ffi.task.prex.task_t,
+    exec: *ffi.Exec,
+    ldr: *const ffi.ExecLoader,
+    argc: c_int,
+    envc: c_int,
+    buf: [*c]u8,
+    bufsz: usize,
+    stack: *?*anyopaque,
+) !ffi.task.prex.thread_t {
+    var t: ffi.task.prex.thread_t = undefined;
+    var sp: ?*anyopaque = undefined;
 
     if (exec.path[0] != 0) {
         _ = ffi.task.prex.task_setname(new_task, ffi.libgen.basename(exec.path));
@@ -183,10 +193,10 @@ fn doExecve(msg: *ffi.ExecMsg) !void {
     errdefer _ = ffi.task.prex.thread_terminate(t);
 
     // Allocate stack and build arguments on it
-    try checkErrno(ffi.task.prex.vm_allocate(new_task, &stack, ffi.task.prex.DFLSTKSZ, 1));
-    errdefer _ = ffi.task.prex.vm_free(new_task, stack);
+    try checkErrno(ffi.task.prex.vm_allocate(new_task, stack, ffi.task.prex.DFLSTKSZ, 1));
+    errdefer _ = ffi.task.prex.vm_free(new_task, stack.*);
 
-    try checkErrno(buildArgs(new_task, stack, exec.path, msg, exec.xarg1, exec.xarg2, &sp));
+    try checkErrno(buildArgs(new_task, stack.*, exec.path, argc, envc, buf, bufsz, exec.xarg1, exec.xarg2, &sp));
 
     // Load file image
     exec.task = new_task;
@@ -197,6 +207,26 @@ fn doExecve(msg: *ffi.ExecMsg) !void {
     } else {
         try checkErrno(ffi.task.prex.thread_load(t, @ptrFromInt(@as(usize, exec.entry)), sp));
     }
+    return t;
+}
+
+fn doExecve(msg: *ffi.ExecMsg) !void {
+    const old_task: ffi.task.prex.task_t = msg.hdr.task;
+    var new_task: ffi.task.prex.task_t = undefined;
+    var stack: ?*anyopaque = undefined;
+    var path: [MAX_PATH]u8 = undefined;
+    var exec: ffi.Exec = undefined;
+
+    const ldr = try probeFile(@ptrCast(&msg.cwd), @ptrCast(&msg.path), @ptrCast(&path), &exec);
+
+    // Suspend old task
+    try checkErrno(ffi.task.prex.task_suspend(old_task));
+
+    // Create new task
+    try checkErrno(ffi.task.prex.task_create(old_task, ffi.task.prex.VM_NEW, &new_task));
+    errdefer _ = ffi.task.prex.task_terminate(new_task);
+
+    const t = try loadImage(new_task, &exec, ldr, msg.argc, msg.envc, @ptrCast(&msg.buf), msg.bufsz, &stack);
 
     // Notify to servers
     notifyServer(old_task, new_task, stack);
@@ -209,6 +239,75 @@ fn doExecve(msg: *ffi.ExecMsg) !void {
     _ = ffi.task.prex.thread_resume(t);
 }
 
+/// Spawn program. Unlike fork() and exec(), the caller is not copied
+/// and keeps running. The child is created empty, and the proc and fs
+/// servers are told about it once.
+fn doSpawn(msg: *ffi.SpawnMsg) !void {
+    const parent: ffi.task.prex.task_t = msg.hdr.task;
+    var child: ffi.task.prex.task_t = undefined;
+    var stack: ?*anyopaque = undefined;
+    var path: [MAX_PATH]u8 = undefined;
+    var exec: ffi.Exec = undefined;
+    var fsobj: ffi.task.prex.object_t = undefined;
+    var procobj: ffi.task.prex.object_t = undefined;
+    var m: ffi.Msg = undefined;
+
+    if (msg.nfds < 0 or msg.nfds > ffi.task.prex.OPEN_MAX) return error.InvalidArgument;
+    if (ffi.task.prex.object_lookup(ffi.global.get_fs_obj_name(), &fsobj) != 0) return error.NotSupported;
+    if (ffi.task.prex.object_lookup(ffi.global.get_proc_obj_name(), &procobj) != 0) return error.NotSupported;
+
+    const ldr = try probeFile(@ptrCast(&msg.cwd), @ptrCast(&msg.path), @ptrCast(&path), &exec);
+
+    try checkErrno(ffi.task.prex.task_create(parent, ffi.task.prex.VM_NEW, &child));
+    errdefer _ = ffi.task.prex.task_terminate(child);
+
+    const t = try loadImage(child, &exec, ldr, msg.argc, msg.envc, @ptrCast(&msg.buf), msg.bufsz, &stack);
+
+    // Set up the files of the child
+    const fm = ffi.global.fdmap_get();
+    fm.hdr.code = ffi.prog.ipc.fs.FS_SPAWN;
+    fm.parent = parent;
+    fm.child = child;
+    fm.nfds = msg.nfds;
+    const nfds: usize = @intCast(msg.nfds);
+    @memcpy(fm.fds[0..nfds], msg.fds[0..nfds]);
+    var err: c_int = undefined;
+    while (true) {
+        err = ffi.task.prex.msg_send(fsobj, @ptrCast(fm), @sizeOf(ffi.FdmapMsg));
+        if (err != ffi.prog.errno.EINTR) break;
+    }
+    if (err == 0) err = fm.hdr.status;
+    try checkErrno(err);
+    errdefer {
+        // Release the files of the child
+        fm.hdr.code = ffi.prog.ipc.fs.FS_SPAWN;
+        fm.parent = 0;
+        fm.child = child;
+        _ = ffi.task.prex.msg_send(fsobj, @ptrCast(fm), @sizeOf(ffi.FdmapMsg));
+    }
+
+    // Create the process
+    while (true) {
+        m.hdr.code = ffi.prog.ipc.proc.PS_SPAWN;
+        m.data[0] = @bitCast(@as(u32, @truncate(parent)));
+        m.data[1] = @bitCast(@as(u32, @truncate(child)));
+        m.data[2] = @bitCast(@as(u32, @truncate(@intFromPtr(stack))));
+        m.data[3] = if ((msg.flags & ffi.POSIX_SPAWN_SETPGROUP) != 0) msg.pgroup else -1;
+        err = ffi.task.prex.msg_send(procobj, @ptrCast(&m), @sizeOf(ffi.Msg));
+        if (err != ffi.prog.errno.EINTR) break;
+    }
+    if (err == 0) err = m.hdr.status;
+    try checkErrno(err);
+    msg.pid = m.data[0];
+
+    _ = ffi.task.prex.thread_setpri(t, ffi.task.prex.PRI_DEFAULT);
+    _ = ffi.task.prex.thread_resume(t);
+}
+
 pub export fn exec_execve(msg: *ffi.ExecMsg) callconv(.c) c_int {
     return ffi.catchToCError(doExecve(msg));
 }
+
+pub export fn exec_spawn(msg: *ffi.SpawnMsg) callconv(.c) c_int {
+    return ffi.catchToCError(doSpawn(msg));
+}
@@ -10,6 +10,7 @@ const c = @cImport({
     @cInclude("usr/server/exec/exec.h");
     @cInclude("sys/elf.h");
     @cInclude("libgen.h");
+    @cInclude("spawn.h");
 });
 
 /// Compile-time configuration flags derived from conf/config.h.
@@ -86,6 +87,8 @@ pub const elf = struct {
 };
 
 pub const ExecMsg = c.struct_exec_msg;
+pub const SpawnMsg = c.struct_spawn_msg;
+pub const FdmapMsg = prog.ipc.fs.struct_fdmap_msg;
 pub const BindMsg = c.struct_bind_msg;
 pub const CapMap = c.struct_cap_map;
 pub const Msg = c.struct_msg;
@@ -99,6 +102,9 @@ pub const ExecLoader = extern struct {
     el_load: ?*const fn (*Exec) callconv(.c) c_int,
 };
 
+/// posix_spawn() attribute flag honoured by the exec server (from spawn.h)
+pub const POSIX_SPAWN_SETPGROUP = c.POSIX_SPAWN_SETPGROUP;
+
 /// Probe result constants (from exec.h)
 pub const PROBE_ERROR = c.PROBE_ERROR;
 pub const PROBE_MATCH = c.PROBE_MATCH;
@@ -237,6 +243,10 @@ pub fn toCError(err: anyerror) c_int {
         error.PermissionDenied => prog.errno.EACCES,
         error.NameTooLong => prog.errno.ENAMETOOLONG,
         error.IOError => prog.errno.EIO,
+        error.BadFileDescriptor => prog.errno.EBADF,
+        error.ResourceLimit => prog.errno.EAGAIN,
+        error.OperationNotPermitted => prog.errno.EPERM,
+        error.NotSupported => prog.errno.ENOSYS,
         else => prog.errno.EIO,
     };
 }
@@ -245,8 +255,8 @@ pub fn catchToCError(result: anytype) c_int {
     return if (result) |_| 0 else |err| toCError(err);
 }
 
-/// Reverse of toCError(): map a POSIX errno produced by a loader back to a
-/// Zig error at the Exec.load() boundary.
+/// Reverse of toCError(): map a POSIX errno produced by a loader or another
+/// server back to a Zig error.
 pub fn fromCError(val: c_int) anyerror {
     return switch (val) {
         prog.errno.ENOMEM => error.OutOfMemory,
@@ -254,6 +264,10 @@ pub fn fromCError(val: c_int) anyerror {
         prog.errno.ENOEXEC => error.InvalidExecutable,
         prog.errno.ENOENT => error.NotFound,
         prog.errno.EACCES => error.PermissionDenied,
+        prog.errno.ENAMETOOLONG => error.NameTooLong,
+        prog.errno.EBADF => error.BadFileDescriptor,
+        prog.errno.EAGAIN => error.ResourceLimit,
+        prog.errno.EPERM => error.OperationNotPermitted,
         else => error.IOError,
     };
 }
@@ -302,11 +316,15 @@ pub const global = struct {
 
     pub extern fn setup_exec_exception() void;
     pub extern fn dispatch_msg(c_int, *Msg) c_int;
+    pub extern fn fdmap_get() *FdmapMsg;
     pub extern fn build_args(
         task: task.prex.task_t,
         stack: ?*anyopaque,
         path: [*c]u8,
-        msg: *ExecMsg,
+        argc: c_int,
+        envc: c_int,
+        buf: [*c]u8,
+        bufsz: usize,
         xarg1: [*c]u8,
         xarg2: [*c]u8,
         new_sp: *?*anyopaque,
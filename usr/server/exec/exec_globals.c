@@ -45,6 +45,7 @@
 
 /* External handler declarations (exported from Zig) */
 extern int exec_execve(struct exec_msg*);
+extern int exec_spawn(struct spawn_msg*);
 extern int exec_bindcap(struct bind_msg*);
 extern int exec_boot(struct msg*);
 extern int exec_shutdown(struct msg*);
@@ -69,6 +70,9 @@ Elf32_Addr text_runtime;
 Elf32_Addr data_runtime;
 Elf32_Sym* current_symtab;
 
+/* Descriptor map sent to the file system server (exec_execve.zig) */
+static struct fdmap_msg fdmap;
+
 /* Script interpreter buffers (exec_script.c) */
 static char interp[PATH_MAX];
 static char intarg[LINE_MAX];
@@ -127,6 +131,8 @@ void set_sram_got_base(Elf32_Addr val) { sram_got_base = val; }
 
 void set_current_symtab(Elf32_Sym* symtab) { current_symtab = symtab; }
 
+struct fdmap_msg* fdmap_get(void) { return &fdmap; }
+
 char* get_script_interp(void) { return interp; }
 
 char* get_script_intarg(void) { return intarg; }
@@ -190,22 +196,18 @@ extern int exec_execve(struct exec_msg*);
 #define SP_ALIGN(p) ((unsigned)(p) & ~_ALIGNBYTES)
 #endif
 
-int build_args(task_t task, void* stack, char* path, struct exec_msg* msg,
-               char* xarg1, char* xarg2, void** new_sp);
+int build_args(task_t task, void* stack, char* path, int argc, int envc, char* buf,
+               size_t bufsz, char* xarg1, char* xarg2, void** new_sp);
 
-int build_args(task_t task, void* stack, char* path, struct exec_msg* msg,
-               char* xarg1, char* xarg2, void** new_sp)
+int build_args(task_t task, void* stack, char* path, int argc, int envc, char* buf,
+               size_t bufsz, char* xarg1, char* xarg2, void** new_sp)
 {
-    int argc, envc;
     char* file;
     char **argv, **envp;
     int i, error;
     u_long arg_top, mapped, sp;
     int len;
 
-    argc = msg->argc;
-    envc = msg->envc;
-
     error = vm_map(task, stack, DFLSTKSZ, (void*)&mapped);
     if (error)
         return ENOMEM;
@@ -219,9 +221,9 @@ int build_args(task_t task, void* stack, char* path, struct exec_msg* msg,
     strlcpy((char*)sp, path, PATH_MAX);
     file = (char*)sp;
 
-    sp -= msg->bufsz;
+    sp -= bufsz;
     sp = SP_ALIGN(sp);
-    memcpy((char*)sp, (char*)&msg->buf, msg->bufsz);
+    memcpy((char*)sp, buf, bufsz);
     arg_top = sp;
 
     if (xarg2 != NULL) {
@@ -291,6 +293,8 @@ int dispatch_msg(int code, struct msg* msg)
         return exec_execve((struct exec_msg*)msg);
     else if (code == EXEC_BINDCAP)
         return exec_bindcap((struct bind_msg*)msg);
+    else if (code == EXEC_SPAWN)
+        return exec_spawn((struct spawn_msg*)msg);
     else if (code == STD_BOOT)
         return exec_boot(msg);
     else if (code == STD_SHUTDOWN)
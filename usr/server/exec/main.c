@@ -71,8 +71,9 @@ struct msg_map
     }
 
 static const struct msg_map execmsg_map[] = {
-    MSGMAP(EXEC_EXECVE, exec_execve),    MSGMAP(EXEC_BINDCAP, exec_bindcap), MSGMAP(STD_BOOT, exec_boot),
-    MSGMAP(STD_SHUTDOWN, exec_shutdown), MSGMAP(STD_DEBUG, exec_debug),      MSGMAP(0, exec_null),
+    MSGMAP(EXEC_EXECVE, exec_execve),  MSGMAP(EXEC_SPAWN, exec_spawn),       MSGMAP(EXEC_BINDCAP, exec_bindcap),
+    MSGMAP(STD_BOOT, exec_boot),       MSGMAP(STD_SHUTDOWN, exec_shutdown), MSGMAP(STD_DEBUG, exec_debug),
+    MSGMAP(0, exec_null),
 };
 
 static void register_process(void)
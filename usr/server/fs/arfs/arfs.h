@@ -68,4 +68,34 @@
     } while (0)
 #endif
 
+#define ARFS_NAMELEN 16 /* max length of archive member name */
+#define ARFS_NHASH 32   /* size of name hash table (power of 2) */
+
+/*
+ * Index entry for one archive member.
+ */
+struct arfs_entry
+{
+    char ae_name[ARFS_NAMELEN + 1]; /* file name */
+    int ae_next;                    /* next entry in hash chain, or -1 */
+    off_t ae_off;                   /* offset of data in image */
+    size_t ae_size;                 /* file size */
+};
+
+/*
+ * Per-mount data. The index is built once at mount time and
+ * never changes afterwards, so it is read without locking.
+ */
+struct arfs_mount
+{
+    int am_direct;                 /* device can be read at any length */
+    int am_nentries;               /* number of entries */
+    int am_hash[ARFS_NHASH];       /* first entry of each hash chain */
+    struct arfs_entry* am_entries; /* entries in archive order */
+};
+
+__BEGIN_DECLS
+int arfs_hash(const char*);
+__END_DECLS
+
 #endif /* !_ARFS_H */
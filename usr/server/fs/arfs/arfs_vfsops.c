@@ -35,6 +35,7 @@
 #include <sys/mount.h>
 #include <sys/param.h>
 #include <sys/buf.h>
+#include <sys/ioctl.h>
 
 #include <stdlib.h>
 #include <string.h>
@@ -64,12 +65,118 @@ const struct vfsops arfs_vfsops = {
     &arfs_vnops,  /* vnops */
 };
 
+/*
+ * Hash a file name. Only the first ARFS_NAMELEN characters
+ * are significant, as in the archive header.
+ */
+int arfs_hash(const char* name)
+{
+    u_int h = 0;
+    int i;
+
+    for (i = 0; i < ARFS_NAMELEN && name[i] != '\0'; i++)
+        h = h * 31 + (u_char)name[i];
+    return (int)(h & (ARFS_NHASH - 1));
+}
+
+/*
+ * Read the archive header at the specified offset.
+ */
+static int arfs_readhdr(mount_t mp, off_t off, struct ar_hdr* hdr)
+{
+    struct buf* bp;
+    size_t len, n;
+    char* p;
+    int error;
+
+    p = (char*)hdr;
+    len = sizeof(struct ar_hdr);
+    while (len > 0) {
+        if ((error = bread(mp->m_dev, (int)(off / BSIZE), &bp)) != 0)
+            return error;
+        n = BSIZE - (size_t)(off % BSIZE);
+        if (n > len)
+            n = len;
+        memcpy(p, bp->b_data + off % BSIZE, n);
+        brelse(bp);
+        p += n;
+        off += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*
+ * Build the name index of the archive. The archive is walked
+ * header by header until a read fails, the header is invalid,
+ * or the end of the image is reached.
+ */
+static int arfs_index(mount_t mp, struct arfs_mount* am, size_t imgsize)
+{
+    struct arfs_entry *ae, *tmp;
+    struct ar_hdr hdr;
+    off_t off;
+    size_t size;
+    int i, nalloc, h;
+    char* p;
+
+    for (i = 0; i < ARFS_NHASH; i++)
+        am->am_hash[i] = -1;
+
+    nalloc = 0;
+    off = SARMAG;
+    for (;;) {
+        if (imgsize != 0 && off + sizeof(struct ar_hdr) > imgsize)
+            break;
+        if (arfs_readhdr(mp, off, &hdr) != 0)
+            break;
+        if (strncmp(hdr.ar_fmag, ARFMAG, sizeof(ARFMAG) - 1))
+            break;
+        size = (size_t)atol((char*)&hdr.ar_size);
+        if (size == 0)
+            break;
+
+        if (am->am_nentries == nalloc) {
+            nalloc = nalloc ? nalloc * 2 : 32;
+            tmp = malloc(nalloc * sizeof(struct arfs_entry));
+            if (tmp == NULL)
+                return ENOMEM;
+            if (am->am_entries != NULL) {
+                memcpy(tmp, am->am_entries, am->am_nentries * sizeof(struct arfs_entry));
+                free(am->am_entries);
+            }
+            am->am_entries = tmp;
+        }
+        ae = &am->am_entries[am->am_nentries];
+
+        /* Convert archive name */
+        memcpy(ae->ae_name, hdr.ar_name, ARFS_NAMELEN);
+        ae->ae_name[ARFS_NAMELEN] = '\0';
+        if ((p = memchr(ae->ae_name, '/', ARFS_NAMELEN)) != NULL)
+            *p = '\0';
+        ae->ae_off = off + sizeof(struct ar_hdr);
+        ae->ae_size = size;
+
+        h = arfs_hash(ae->ae_name);
+        ae->ae_next = am->am_hash[h];
+        am->am_hash[h] = am->am_nentries;
+        am->am_nentries++;
+
+        /* Proceed to next archive header */
+        off += (sizeof(struct ar_hdr) + size);
+        off += (off % 2); /* Pad to even boundary */
+    }
+    DPRINTF(("arfs_index: %d files\n", am->am_nentries));
+    return 0;
+}
+
 /*
  * Mount a file system.
  */
 static int arfs_mount(mount_t mp, char* dev, int flags, void* data)
 {
-    size_t size;
+    struct arfs_mount* am;
+    size_t size, imgsize;
     char* buf;
     int error = 0;
 
@@ -96,7 +203,29 @@ static int arfs_mount(mount_t mp, char* dev, int flags, void* data)
     }
     DPRINTF(("arfs_mount: archive image valid\n"));
 
+    if ((am = malloc(sizeof(struct arfs_mount))) == NULL) {
+        error = ENOMEM;
+        goto out;
+    }
+    memset(am, 0, sizeof(struct arfs_mount));
+
+    /*
+     * A RAM disk (or a flash image mapped in the same way) is
+     * read directly into the caller's buffer, bypassing the
+     * buffer cache.
+     */
+    imgsize = 0;
+    if (device_ioctl((device_t)mp->m_dev, RDIOC_GET_SIZE, &imgsize) == 0)
+        am->am_direct = 1;
+
+    if ((error = arfs_index(mp, am, imgsize)) != 0) {
+        free(am->am_entries);
+        free(am);
+        goto out;
+    }
+
     /* Ok, we find the archive */
+    mp->m_data = am;
     mp->m_flags |= MNT_RDONLY;
 out:
     free(buf);
@@ -105,5 +234,12 @@ out:
 
 static int arfs_unmount(mount_t mp)
 {
+    struct arfs_mount* am = mp->m_data;
+
+    if (am != NULL) {
+        free(am->am_entries);
+        free(am);
+        mp->m_data = NULL;
+    }
     return 0;
 }
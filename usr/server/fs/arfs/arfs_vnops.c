@@ -39,6 +39,13 @@
  * The file system is typically used for the boot time file system,
  * and it's mounted to the ram disk device mapped to the pre-loaded
  * archive file image. All files are placed in one single directory.
+ *
+ * The archive headers are scanned once at mount time to build an
+ * in-memory index of file names, offsets and sizes. The index is
+ * not modified after mount, so lookup and readdir run without any
+ * lock. When the device is a RAM disk, file data is copied straight
+ * from the image into the caller's buffer, bypassing the buffer
+ * cache except for a partial first block.
  */
 
 #include <sys/prex.h>
@@ -81,12 +88,6 @@ static int arfs_lookup(vnode_t, char*, vnode_t);
 #define arfs_inactive ((vnop_inactive_t)vop_nullop)
 #define arfs_truncate ((vnop_truncate_t)vop_nullop)
 
-static char iobuf[BSIZE * 2];
-
-#if CONFIG_FS_THREADS > 1
-static mutex_t arfs_lock = MUTEX_INITIALIZER;
-#endif
-
 /*
  * vnode operations
  */
@@ -112,116 +113,43 @@ const struct vnops arfs_vnops = {
     vop_poll_default, /* poll */
 };
 
-/*
- * Read blocks.
- * iobuf is filled by read data.
- */
-static int arfs_readblk(mount_t mp, int blkno)
-{
-    struct buf* bp;
-    int error;
-
-    /*
-     * Read two blocks for archive header
-     */
-    if ((error = bread(mp->m_dev, blkno, &bp)) != 0) {
-        DPRINTF(("arfs_readblk: bread %d failed\n", blkno));
-        return error;
-    }
-    memcpy(iobuf, bp->b_data, BSIZE);
-    brelse(bp);
-
-    if ((error = bread(mp->m_dev, blkno + 1, &bp)) != 0) {
-        DPRINTF(("arfs_readblk: bread %d failed\n", blkno + 1));
-        return error;
-    }
-    memcpy(iobuf + BSIZE, bp->b_data, BSIZE);
-    brelse(bp);
-
-    return 0;
-}
-
 /*
  * Lookup vnode for the specified file/directory.
  * The vnode is filled properly.
  */
 static int arfs_lookup(vnode_t dvp, char* name, vnode_t vp)
 {
-    struct ar_hdr* hdr;
-    int blkno, error;
-    off_t off;
-    size_t size;
-    mount_t mp;
-    char* p;
+    struct arfs_mount* am;
+    struct arfs_entry* ae;
+    int i;
 
     DPRINTF(("arfs_lookup: name=%s\n", name));
     if (*name == '\0')
         return ENOENT;
 
-    DPRINTF(("arfs_lookup: looking for %s on dev %x\n", name, (int)vp->v_mount->m_dev));
-
-    mutex_lock(&arfs_lock);
-
-    error = ENOENT;
-    mp = vp->v_mount;
-    blkno = 0;
-    off = SARMAG; /* offset in archive image */
-    for (;;) {
-        /* Read two blocks for archive header */
-        if (arfs_readblk(mp, blkno) != 0) {
-            DPRINTF(("arfs_lookup: readblk failed blkno=%d\n", blkno));
-            goto out;
-        }
-
-        /* Check file header */
-        hdr = (struct ar_hdr*)(iobuf + (off % BSIZE));
-        if (strncmp(hdr->ar_fmag, ARFMAG, sizeof(ARFMAG) - 1)) {
-            DPRINTF(("arfs_lookup: header magic mismatch at off=%d! found '%.2s'\n", (int)off, hdr->ar_fmag));
-            goto out;
-        }
-
-        /* Get file size */
-        size = (size_t)atol((char*)&hdr->ar_size);
-
-        if (size == 0) {
-            DPRINTF(("arfs_lookup: zero size file header at off=%d\n", (int)off));
-            goto out;
-        }
-
-        /* Convert archive name */
-        char tmp_name[17];
-        memcpy(tmp_name, hdr->ar_name, 16);
-        tmp_name[16] = '\0';
-        if ((p = memchr(tmp_name, '/', 16)) != NULL)
-            *p = '\0';
-
-        if (strncmp(name, tmp_name, 16) == 0) {
-            DPRINTF(("arfs_lookup: match found for %s at off=%d\n", name, (int)off));
+    am = vp->v_mount->m_data;
+    for (i = am->am_hash[arfs_hash(name)]; i != -1; i = ae->ae_next) {
+        ae = &am->am_entries[i];
+        if (strncmp(name, ae->ae_name, ARFS_NAMELEN) == 0)
             break;
-        }
-
-        /* Proceed to next archive header */
-        off += (sizeof(struct ar_hdr) + size);
-        off += (off % 2); /* Pad to even boundary */
-
-        blkno = (int)(off / BSIZE);
+    }
+    if (i == -1) {
+        DPRINTF(("arfs_lookup: %s not found\n", name));
+        return ENOENT;
     }
     vp->v_type = VREG;
 
     /* No write access */
     vp->v_mode = (mode_t)(S_IRUSR | S_IXUSR);
-    vp->v_size = size;
-    vp->v_blkno = blkno;
-    vp->v_data = (void*)(off + sizeof(struct ar_hdr));
-    error = 0;
-out:
-    mutex_unlock(&arfs_lock);
-    DPRINTF(("arfs_lookup: error=%d\n\n", error));
-    return error;
+    vp->v_size = ae->ae_size;
+    vp->v_blkno = (int)(ae->ae_off / BSIZE);
+    vp->v_data = (void*)ae->ae_off;
+    return 0;
 }
 
 static int arfs_read(vnode_t vp, file_t fp, void* buf, size_t size, size_t* result)
 {
+    struct arfs_mount* am;
     off_t off, file_pos, buf_pos;
     int blkno, error;
     size_t nr_read, nr_copy;
@@ -229,17 +157,16 @@ static int arfs_read(vnode_t vp, file_t fp, void* buf, size_t size, size_t* resu
     struct buf* bp;
 
     DPRINTF(("arfs_read: start size=%d\n", size));
-    mutex_lock(&arfs_lock);
 
     *result = 0;
     mp = vp->v_mount;
+    am = mp->m_data;
 
     /* Check if current file position is already end of file. */
     file_pos = fp->f_offset;
-    if (file_pos >= (off_t)vp->v_size) {
-        error = 0;
-        goto out;
-    }
+    if (file_pos >= (off_t)vp->v_size)
+        return 0;
+
     /* Get the actual read size. */
     if (vp->v_size - file_pos < size)
         size = vp->v_size - file_pos;
@@ -247,39 +174,40 @@ static int arfs_read(vnode_t vp, file_t fp, void* buf, size_t size, size_t* resu
     /* Read and copy data */
     off = (off_t)vp->v_data;
     nr_read = 0;
-    for (;;) {
+    while (size > 0) {
         DPRINTF(("arfs_read: file_pos=%d buf=%x size=%d\n", file_pos, buf, size));
 
         blkno = (off + file_pos) / BSIZE;
         buf_pos = (off + file_pos) % BSIZE;
-        if ((error = bread(mp->m_dev, blkno, &bp)) != 0)
-            goto out;
-        nr_copy = BSIZE;
-        if (buf_pos > 0)
-            nr_copy -= buf_pos;
-        if (buf_pos + size < BSIZE)
+        if (am->am_direct && buf_pos == 0) {
+            /*
+             * Read the rest straight from the image.
+             */
             nr_copy = size;
-        ASSERT(nr_copy > 0);
-        memcpy(buf, bp->b_data + buf_pos, nr_copy);
-        brelse(bp);
+            if ((error = device_read((device_t)mp->m_dev, buf, &nr_copy, blkno)) != 0)
+                return error;
+            if (nr_copy == 0)
+                break;
+        } else {
+            if ((error = bread(mp->m_dev, blkno, &bp)) != 0)
+                return error;
+            nr_copy = BSIZE - buf_pos;
+            if (nr_copy > size)
+                nr_copy = size;
+            memcpy(buf, bp->b_data + buf_pos, nr_copy);
+            brelse(bp);
+        }
 
         file_pos += nr_copy;
         DPRINTF(("arfs_read: file_pos=%d nr_copy=%d\n", file_pos, nr_copy));
 
         nr_read += nr_copy;
         size -= nr_copy;
-        if (size <= 0)
-            break;
         buf = (void*)((u_long)buf + nr_copy);
-        buf_pos = 0;
     }
     fp->f_offset = file_pos;
     *result = nr_read;
-    error = 0;
-out:
-    mutex_unlock(&arfs_lock);
-    DPRINTF(("arfs_read: error=%d\n\n", error));
-    return error;
+    return 0;
 }
 
 /*
@@ -296,58 +224,23 @@ static int arfs_seek(vnode_t vp, file_t fp, off_t oldoff, off_t newoff)
 
 static int arfs_readdir(vnode_t vp, file_t fp, struct dirent* dir)
 {
-    struct ar_hdr* hdr;
-    int blkno, i, error;
-    off_t off;
-    size_t size;
-    mount_t mp;
-    char* p;
+    struct arfs_mount* am;
+    struct arfs_entry* ae;
 
     DPRINTF(("arfs_readdir: start\n"));
-    mutex_lock(&arfs_lock);
-
-    i = 0;
-    mp = vp->v_mount;
-    blkno = 0;
-    off = SARMAG; /* offset in archive image */
-    for (;;) {
-        /* Read two blocks for archive header */
-        if ((error = arfs_readblk(mp, blkno)) != 0)
-            goto out;
-
-        hdr = (struct ar_hdr*)(iobuf + (off % BSIZE));
-
-        /* Get file size */
-        size = (size_t)atol((char*)&hdr->ar_size);
-        if (size == 0) {
-            error = ENOENT;
-            goto out;
-        }
-        if (i == fp->f_offset)
-            break;
-
-        /* Proceed to next archive header */
-        off += (sizeof(struct ar_hdr) + size);
-        off += (off % 2); /* Pad to even boundary */
-
-        blkno = off / BSIZE;
-        i++;
-    }
 
-    /* Convert archive name */
-    if ((p = memchr(&hdr->ar_name, '/', 16)) != NULL)
-        *p = '\0';
+    am = vp->v_mount->m_data;
+    if (fp->f_offset >= am->am_nentries)
+        return ENOENT;
+    ae = &am->am_entries[fp->f_offset];
 
-    strlcpy((char*)&dir->d_name, (char*)&hdr->ar_name, sizeof(dir->d_name));
+    strlcpy((char*)&dir->d_name, ae->ae_name, sizeof(dir->d_name));
     dir->d_namlen = (uint16_t)strlen(dir->d_name);
     dir->d_fileno = (uint32_t)fp->f_offset;
     dir->d_type = DT_REG;
 
     fp->f_offset++;
-    error = 0;
-out:
-    mutex_unlock(&arfs_lock);
-    return error;
+    return 0;
 }
 
 int arfs_init(void)
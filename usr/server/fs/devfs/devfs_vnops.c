@@ -51,7 +51,7 @@
 
 #include "devfs.h"
 
-#define devfs_mount ((vfsop_mount_t)vfs_nullop)
+static int devfs_mount(mount_t, char*, int, void*);
 #define devfs_unmount ((vfsop_umount_t)vfs_nullop)
 #define devfs_sync ((vfsop_sync_t)vfs_nullop)
 #define devfs_vget ((vfsop_vget_t)vfs_nullop)
@@ -76,6 +76,17 @@ static int devfs_lookup(vnode_t, char*, vnode_t);
 #define devfs_inactive ((vnop_inactive_t)vop_nullop)
 #define devfs_truncate ((vnop_truncate_t)vop_nullop)
 
+/*
+ * Device names are not created through the VFS, so they must
+ * not be kept in the name cache.
+ */
+static int devfs_mount(mount_t mp, char* dev, int flags, void* data)
+{
+
+    mp->m_flags |= MNT_NOCACHE;
+    return 0;
+}
+
 static int devfs_poll(vnode_t vp, file_t fp, int events)
 {
     device_t dev = (device_t)vp->v_data;
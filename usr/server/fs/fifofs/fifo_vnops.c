@@ -67,7 +67,7 @@ struct fifo_node
     char* fn_buf;    /* pointer to buffer */
 };
 
-#define fifo_mount ((vfsop_mount_t)vfs_nullop)
+static int fifo_mount(mount_t, char*, int, void*);
 #define fifo_unmount ((vfsop_umount_t)vfs_nullop)
 #define fifo_sync ((vfsop_sync_t)vfs_nullop)
 #define fifo_vget ((vfsop_vget_t)vfs_nullop)
@@ -142,6 +142,17 @@ struct vfsops fifofs_vfsops = {
     &fifofs_vnops, /* vnops */
 };
 
+/*
+ * Pipes are removed on the last close, without the VFS, so their
+ * names must not be kept in the name cache.
+ */
+static int fifo_mount(mount_t mp, char* dev, int flags, void* data)
+{
+
+    mp->m_flags |= MNT_NOCACHE;
+    return 0;
+}
+
 static int fifo_open(vnode_t vp, int flags)
 {
     struct fifo_node* np = vp->v_data;
@@ -198,13 +209,17 @@ static int fifo_close(vnode_t vp, file_t fp)
 
     if (fp->f_flags & FREAD) {
         np->fn_readers--;
-        if (np->fn_readers == 0)
+        if (np->fn_readers == 0) {
             wakeup_writer(vp);
+            vnode_poll_signal(vp, POLLOUT | POLLERR);
+        }
     }
     if (fp->f_flags & FWRITE) {
         np->fn_writers--;
-        if (np->fn_writers == 0)
+        if (np->fn_writers == 0) {
             wakeup_reader(vp);
+            vnode_poll_signal(vp, POLLIN | POLLHUP);
+        }
     }
     if (vp->v_refcnt > 1)
         return 0;
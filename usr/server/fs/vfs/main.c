@@ -79,11 +79,20 @@ struct msg_map
 {
     int code;
     int (*func)(struct task*, struct msg*);
+    int flags;
 };
 
 #define MSGMAP(code, fn)                                                                                               \
     {                                                                                                                  \
-        code, (int (*)(struct task*, struct msg*))fn                                                                   \
+        code, (int (*)(struct task*, struct msg*))fn, 0                                                                \
+    }
+
+/* The handler unlocks or frees the task by itself. */
+#define MF_UNLOCK 0x01
+
+#define MSGMAP_UNLOCK(code, fn)                                                                                        \
+    {                                                                                                                  \
+        code, (int (*)(struct task*, struct msg*))fn, MF_UNLOCK                                                        \
     }
 
 /* object for file service */
@@ -152,7 +161,7 @@ static int fs_open(struct task* t, struct open_msg* msg)
     if ((error = sys_open(path, msg->flags, msg->mode, &fp)) != 0)
         return error;
 
-    t->t_ofile[fd] = fp;
+    task_setfp(t, fd, fp);
     t->t_nopens++;
     msg->fd = fd;
     return 0;
@@ -164,17 +173,13 @@ static int fs_close(struct task* t, struct msg* msg)
     int fd, error;
 
     fd = msg->data[0];
-    if (fd >= OPEN_MAX)
-        return EBADF;
-
-    fp = t->t_ofile[fd];
-    if (fp == NULL)
+    if ((fp = task_getfp(t, fd)) == NULL)
         return EBADF;
 
     if ((error = sys_close(fp)) != 0)
         return error;
 
-    t->t_ofile[fd] = NULL;
+    task_delfd(t, fd);
     t->t_nopens--;
     return 0;
 }
@@ -213,16 +218,29 @@ static int fs_read(struct task* t, struct io_msg* msg)
     size_t size, bytes;
     int error;
 
-    if ((fp = task_getfp(t, msg->fd)) == NULL)
+    if ((fp = task_getfp(t, msg->fd)) == NULL) {
+        task_unlock(t);
         return EBADF;
+    }
+
+    /*
+     * Hold the file and unlock the task.  Other requests from
+     * the task can run while the data is transferred, and the
+     * vnode lock serializes access to the file.
+     */
+    file_hold(fp);
+    task_unlock(t);
+
     size = msg->size;
     if ((error = vm_map(msg->hdr.task, msg->buf, size, &buf)) != 0) {
+        sys_close(fp);
         return error;
     }
 
     error = sys_read(fp, buf, size, &bytes);
     msg->size = bytes;
     vm_free(task_self(), buf);
+    sys_close(fp);
     return error;
 }
 
@@ -233,16 +251,29 @@ static int fs_write(struct task* t, struct io_msg* msg)
     size_t size, bytes;
     int error;
 
-    if ((fp = task_getfp(t, msg->fd)) == NULL)
+    if ((fp = task_getfp(t, msg->fd)) == NULL) {
+        task_unlock(t);
         return EBADF;
+    }
+
+    /*
+     * Hold the file and unlock the task.  Other requests from
+     * the task can run while the data is transferred, and the
+     * vnode lock serializes access to the file.
+     */
+    file_hold(fp);
+    task_unlock(t);
+
     size = msg->size;
     if ((error = vm_map(msg->hdr.task, msg->buf, size, &buf)) != 0) {
+        sys_close(fp);
         return error;
     }
 
     error = sys_write(fp, buf, size, &bytes);
     msg->size = bytes;
     vm_free(task_self(), buf);
+    sys_close(fp);
     return error;
 }
 
@@ -296,7 +327,7 @@ static int fs_opendir(struct task* t, struct open_msg* msg)
 
     if ((error = sys_opendir(path, &fp)) != 0)
         return error;
-    t->t_ofile[fd] = fp;
+    task_setfp(t, fd, fp);
     msg->fd = fd;
     return 0;
 }
@@ -307,15 +338,12 @@ static int fs_closedir(struct task* t, struct msg* msg)
     int fd, error;
 
     fd = msg->data[0];
-    if (fd >= OPEN_MAX)
-        return EBADF;
-    fp = t->t_ofile[fd];
-    if (fp == NULL)
+    if ((fp = task_getfp(t, fd)) == NULL)
         return EBADF;
 
     if ((error = sys_closedir(fp)) != 0)
         return error;
-    t->t_ofile[fd] = NULL;
+    task_delfd(t, fd);
     return 0;
 }
 
@@ -493,11 +521,10 @@ static int fs_dup(struct task* t, struct msg* msg)
     if ((new_fd = task_newfd(t)) == -1)
         return EMFILE;
 
-    t->t_ofile[new_fd] = fp;
+    task_setfp(t, new_fd, fp);
 
     /* Increment file reference */
-    vref(fp->f_vnode);
-    fp->f_count++;
+    file_hold(fp);
 
     msg->data[0] = new_fd;
     return 0;
@@ -513,21 +540,21 @@ static int fs_dup2(struct task* t, struct msg* msg)
 
     old_fd = msg->data[0];
     new_fd = msg->data[1];
-    if (old_fd >= OPEN_MAX || new_fd >= OPEN_MAX)
+    if (new_fd < 0 || new_fd >= OPEN_MAX)
         return EBADF;
-    fp = t->t_ofile[old_fd];
-    if (fp == NULL)
+    if ((fp = task_getfp(t, old_fd)) == NULL)
         return EBADF;
-    org = t->t_ofile[new_fd];
+    if (task_growfd(t, new_fd) != 0)
+        return EMFILE;
+    org = task_getfp(t, new_fd);
     if (org != NULL) {
         /* Close previous file if it's opened. */
         sys_close(org);
     }
-    t->t_ofile[new_fd] = fp;
+    task_setfp(t, new_fd, fp);
 
     /* Increment file reference */
-    vref(fp->f_vnode);
-    fp->f_count++;
+    file_hold(fp);
 
     msg->data[0] = new_fd;
     return 0;
@@ -547,16 +574,19 @@ static int fs_fcntl(struct task* t, struct fcntl_msg* msg)
     arg = msg->arg;
     switch (msg->cmd) {
     case F_DUPFD:
-        if (arg >= OPEN_MAX)
+        if (arg < 0 || arg >= OPEN_MAX)
             return EINVAL;
-        /* Find smallest empty slot as new fd. */
-        if ((new_fd = task_newfd(t)) == -1)
+        /* Find smallest empty slot from arg as new fd. */
+        for (new_fd = arg; new_fd < t->t_nofile; new_fd++) {
+            if (t->t_ofile[new_fd] == NULL)
+                break;
+        }
+        if (task_growfd(t, new_fd) != 0)
             return EMFILE;
-        t->t_ofile[new_fd] = fp;
+        task_setfp(t, new_fd, fp);
 
         /* Increment file reference */
-        vref(fp->f_vnode);
-        fp->f_count++;
+        file_hold(fp);
         msg->arg = new_fd;
         break;
     case F_GETFD:
@@ -618,25 +648,26 @@ static int fs_fork(struct task* t, struct msg* msg)
     /*
      * Copy task related data
      */
+    if ((error = task_growfd(newtask, t->t_nofile - 1)) != 0) {
+        mutex_lock(&newtask->t_lock);
+        task_free(newtask);
+        return error;
+    }
     newtask->t_cwdfp = t->t_cwdfp;
     strlcpy(newtask->t_cwd, t->t_cwd, sizeof(newtask->t_cwd));
-    for (i = 0; i < OPEN_MAX; i++) {
+    for (i = 0; i < t->t_nofile; i++) {
         fp = t->t_ofile[i];
         newtask->t_ofile[i] = fp;
         /*
          * Increment file reference if it's
          * already opened.
          */
-        if (fp != NULL) {
-            vref(fp->f_vnode);
-            fp->f_count++;
-        }
+        if (fp != NULL)
+            file_hold(fp);
     }
-    if (newtask->t_cwdfp)
-        newtask->t_cwdfp->f_count++;
     /* Increment cwd's reference count */
     if (newtask->t_cwdfp)
-        vref(newtask->t_cwdfp->f_vnode);
+        file_hold(newtask->t_cwdfp);
 
     DPRINTF(VFSDB_CORE, ("fs_fork-complete\n"));
     return 0;
@@ -664,12 +695,12 @@ static int fs_exec(struct task* t, struct msg* msg)
     task_setid(target, new_id);
 
     /* Close all directory descriptor */
-    for (fd = 0; fd < OPEN_MAX; fd++) {
+    for (fd = 0; fd < target->t_nofile; fd++) {
         fp = target->t_ofile[fd];
         if (fp) {
             if (fp->f_vnode->v_type == VDIR) {
                 sys_close(fp);
-                target->t_ofile[fd] = NULL;
+                task_delfd(target, fd);
             }
 
             /* XXX: need to check close-on-exec flag */
@@ -689,10 +720,13 @@ static int fs_exit(struct task* t, struct msg* msg)
 
     DPRINTF(VFSDB_CORE, ("fs_exit\n"));
 
+    /* Drop poll listeners and event areas of the task */
+    sys_poll_exit(t->t_taskid);
+
     /*
      * Close all files opened by task.
      */
-    for (fd = 0; fd < OPEN_MAX; fd++) {
+    for (fd = 0; fd < t->t_nofile; fd++) {
         fp = t->t_ofile[fd];
         if (fp != NULL)
             sys_close(fp);
@@ -703,6 +737,109 @@ static int fs_exit(struct task* t, struct msg* msg)
     return 0;
 }
 
+/*
+ * fs_spawn() is called by the exec server for posix_spawn().
+ * The child gets the cwd and the files of the parent as with
+ * fork(), rearranged by the descriptor map.  Directory streams
+ * are not inherited.
+ */
+static int fs_spawn(struct task* t, struct fdmap_msg* msg)
+{
+    struct task *parent, *newtask;
+    file_t fp;
+    int error = 0, i, fd, nfds, n;
+
+    DPRINTF(VFSDB_CORE, ("fs_spawn\n"));
+
+    if (task_chkcap(msg->hdr.task, CAP_PROTSERV) != 0)
+        return EPERM;
+
+    if (msg->parent == 0) {
+        /* Back out of a failed spawn */
+        if (!(newtask = task_lookup(msg->child)))
+            return EINVAL;
+        return fs_exit(newtask, (struct msg*)msg);
+    }
+
+    nfds = msg->nfds;
+    if (nfds < 0 || nfds > OPEN_MAX)
+        return EINVAL;
+    if (!(parent = task_lookup(msg->parent)))
+        return EINVAL;
+
+    for (i = 0; i < nfds; i++) {
+        fd = msg->fds[i];
+        if (fd != -1 && task_getfp(parent, fd) == NULL) {
+            error = EBADF;
+            goto out;
+        }
+    }
+    if ((error = task_alloc(msg->child, &newtask)) != 0)
+        goto out;
+
+    n = (nfds > parent->t_nofile) ? nfds : parent->t_nofile;
+    if ((error = task_growfd(newtask, n - 1)) != 0) {
+        mutex_lock(&newtask->t_lock);
+        task_free(newtask);
+        goto out;
+    }
+    newtask->t_cwdfp = parent->t_cwdfp;
+    strlcpy(newtask->t_cwd, parent->t_cwd, sizeof(newtask->t_cwd));
+    if (newtask->t_cwdfp)
+        file_hold(newtask->t_cwdfp);
+
+    for (i = 0; i < n; i++) {
+        fd = (i < nfds) ? msg->fds[i] : i;
+        if (fd == -1 || (fp = task_getfp(parent, fd)) == NULL)
+            continue;
+        if (fp->f_vnode->v_type == VDIR)
+            continue;
+        newtask->t_ofile[i] = fp;
+        file_hold(fp);
+    }
+out:
+    task_unlock(parent);
+    return error;
+}
+
+/*
+ * fs_splice() is called by the network server for sendfile().
+ * It reads a file of the owner task straight into the buffer of
+ * the server, so the data never passes through the owner.  The
+ * server need not be registered.
+ */
+static int fs_splice(struct task* t, struct splice_msg* msg)
+{
+    struct task* owner;
+    file_t fp;
+    void* buf;
+    size_t bytes;
+    int error;
+
+    if (task_chkcap(msg->hdr.task, CAP_PROTSERV) != 0)
+        return EPERM;
+    if (msg->size == 0)
+        return 0;
+    if (!(owner = task_lookup(msg->owner)))
+        return EINVAL;
+    if ((fp = task_getfp(owner, msg->fd)) == NULL) {
+        task_unlock(owner);
+        return EBADF;
+    }
+    file_hold(fp);
+    task_unlock(owner);
+
+    if ((error = vm_map(msg->hdr.task, msg->buf, msg->size, &buf)) != 0) {
+        sys_close(fp);
+        return error;
+    }
+    error = sys_pread(fp, buf, msg->size, msg->offset, &bytes);
+    msg->size = bytes;
+    vm_free(task_self(), buf);
+    sys_close(fp);
+    return error;
+}
+
 /*
  * fs_register() is called by boot tasks.
  * This can be called even when no fs is mounted.
@@ -729,10 +866,10 @@ static int fs_pipe(struct task* t, struct msg* msg)
 
     if ((rfd = task_newfd(t)) == -1)
         return EMFILE;
-    t->t_ofile[rfd] = (file_t)1; /* temp */
+    task_setfp(t, rfd, (file_t)1); /* temp */
 
     if ((wfd = task_newfd(t)) == -1) {
-        t->t_ofile[rfd] = NULL;
+        task_setfp(t, rfd, NULL);
         return EMFILE;
     }
     sprintf(path, "/mnt/fifo/pipe-%x-%d", (u_int)t->t_taskid, rfd);
@@ -745,15 +882,14 @@ static int fs_pipe(struct task* t, struct msg* msg)
     if ((error = sys_open(path, O_WRONLY | O_NONBLOCK, 0, &wfp)) != 0) {
         goto out;
     }
-    t->t_ofile[rfd] = rfp;
-    t->t_ofile[wfd] = wfp;
+    task_setfp(t, rfd, rfp);
+    task_setfp(t, wfd, wfp);
     t->t_nopens += 2;
     msg->data[0] = rfd;
     msg->data[1] = wfd;
     return 0;
 out:
-    t->t_ofile[rfd] = NULL;
-    t->t_ofile[wfd] = NULL;
+    task_setfp(t, rfd, NULL);
     return error;
 #else
     return ENOSYS;
@@ -808,6 +944,11 @@ static int fs_poll_deregister(struct task* t, struct fs_poll_msg* msg)
     return sys_poll_deregister(t, msg->sem_id);
 }
 
+static int fs_event_ctl(struct task* t, struct event_msg* msg)
+{
+    return sys_event_ctl(t, msg);
+}
+
 static int fs_poll_query(struct task* t, struct fs_poll_msg* msg)
 {
     int ready;
@@ -896,6 +1037,7 @@ static void vfs_init(void)
     task_init();
     bio_init();
     vnode_init();
+    ncache_init();
 
     /*
      * Initialize each file system.
@@ -952,8 +1094,8 @@ static const struct msg_map fsmsg_map[] = {
     MSGMAP(FS_CLOSE, fs_close),
     MSGMAP(FS_MKNOD, fs_mknod),
     MSGMAP(FS_LSEEK, fs_lseek),
-    MSGMAP(FS_READ, fs_read),
-    MSGMAP(FS_WRITE, fs_write),
+    MSGMAP_UNLOCK(FS_READ, fs_read),
+    MSGMAP_UNLOCK(FS_WRITE, fs_write),
     MSGMAP(FS_IOCTL, fs_ioctl),
     MSGMAP(FS_FSYNC, fs_fsync),
     MSGMAP(FS_FSTAT, fs_fstat),
@@ -977,7 +1119,7 @@ static const struct msg_map fsmsg_map[] = {
     MSGMAP(FS_ACCESS, fs_access),
     MSGMAP(FS_FORK, fs_fork),
     MSGMAP(FS_EXEC, fs_exec),
-    MSGMAP(FS_EXIT, fs_exit),
+    MSGMAP_UNLOCK(FS_EXIT, fs_exit),
     MSGMAP(FS_REGISTER, fs_register),
     MSGMAP(FS_PIPE, fs_pipe),
     MSGMAP(FS_ISATTY, fs_isatty),
@@ -987,6 +1129,9 @@ static const struct msg_map fsmsg_map[] = {
     MSGMAP(FS_POLL_REGISTER, fs_poll_register),
     MSGMAP(FS_POLL_DEREGISTER, fs_poll_deregister),
     MSGMAP(FS_POLL_QUERY, fs_poll_query),
+    MSGMAP(FS_EVENT_CTL, fs_event_ctl),
+    MSGMAP(FS_SPAWN, fs_spawn),
+    MSGMAP(FS_SPLICE, fs_splice),
     MSGMAP(STD_BOOT, fs_boot),
     MSGMAP(STD_SHUTDOWN, fs_shutdown),
 #ifdef DEBUG_VFS
@@ -1033,6 +1178,10 @@ static void fs_thread(void)
                     error = fs_register(NULL, msg);
                     break;
                 }
+                if (map->code == FS_SPLICE) {
+                    error = fs_splice(NULL, (struct splice_msg*)msg);
+                    break;
+                }
 
                 /* Lookup and lock task */
                 t = task_lookup(msg->hdr.task);
@@ -1041,7 +1190,7 @@ static void fs_thread(void)
 
                 /* Dispatch request */
                 error = (*map->func)(t, msg);
-                if (map->code != FS_EXIT)
+                if (!(map->flags & MF_UNLOCK))
                     task_unlock(t);
                 break;
             }
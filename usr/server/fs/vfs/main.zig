@@ -113,12 +113,11 @@ pub export fn fs_telldir(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c)
 pub export fn fs_close(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_int {
     const task_ptr = t orelse return prog.errno.EINVAL;
     const fd = msg[0].data[0];
-    if (fd >= c.OPEN_MAX) return prog.errno.EBADF;
-    const fp = task_ptr.t_ofile[@intCast(fd)];
+    const fp = c.task_getfp(task_ptr, fd);
     if (fp == null) return prog.errno.EBADF;
     const error_code = c.sys_close(fp);
     if (error_code != 0) return error_code;
-    task_ptr.t_ofile[@intCast(fd)] = null;
+    c.task_delfd(task_ptr, fd);
     task_ptr.t_nopens -= 1;
     return 0;
 }
@@ -210,12 +209,11 @@ pub export fn fs_fstat(t: ?*c.struct_task, msg: [*c]c.struct_stat_msg) callconv(
 pub export fn fs_closedir(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_int {
     const task_ptr = t orelse return prog.errno.EINVAL;
     const fd = msg[0].data[0];
-    if (fd >= c.OPEN_MAX) return prog.errno.EBADF;
-    const fp = task_ptr.t_ofile[@intCast(fd)];
+    const fp = c.task_getfp(task_ptr, fd);
     if (fp == null) return prog.errno.EBADF;
     const error_code = c.sys_closedir(fp);
     if (error_code != 0) return error_code;
-    task_ptr.t_ofile[@intCast(fd)] = null;
+    c.task_delfd(task_ptr, fd);
     return 0;
 }
 
@@ -232,7 +230,7 @@ pub export fn fs_opendir(t: ?*c.struct_task, msg: [*c]c.struct_open_msg) callcon
     const open_err = c.sys_opendir(&path, &fp);
     if (open_err != 0) return open_err;
 
-    task_ptr.t_ofile[@intCast(fd)] = fp;
+    c.task_setfp(task_ptr, fd, fp);
     msg[0].fd = fd;
     return 0;
 }
@@ -257,7 +255,7 @@ pub export fn fs_open(t: ?*c.struct_task, msg: [*c]c.struct_open_msg) callconv(.
     const open_err = c.sys_open(&path, msg[0].flags, msg[0].mode, &fp);
     if (open_err != 0) return open_err;
 
-    task_ptr.t_ofile[@intCast(fd)] = fp;
+    c.task_setfp(task_ptr, fd, fp);
     task_ptr.t_nopens += 1;
     msg[0].fd = fd;
     return 0;
@@ -270,7 +268,18 @@ pub export fn fs_open(t: ?*c.struct_task, msg: [*c]c.struct_open_msg) callconv(.
 pub export fn fs_read(t: ?*c.struct_task, msg: [*c]c.struct_io_msg) callconv(.c) c_int {
     const task_ptr = t orelse return prog.errno.EINVAL;
     const fp_raw = c.task_getfp(task_ptr, msg[0].fd);
-    if (fp_raw == null) return prog.errno.EBADF;
+    if (fp_raw == null) {
+        c.task_unlock(task_ptr);
+        return prog.errno.EBADF;
+    }
+
+    // Hold the file and unlock the task. Other requests from the task
+    // can run while the data is transferred, and the vnode lock
+    // serializes access to the file.
+    c.file_hold(fp_raw);
+    c.task_unlock(task_ptr);
+    defer _ = c.sys_close(fp_raw);
+
     var buf: ?*anyopaque = null;
     const map_err = c.vm_map(msg[0].hdr.task, msg[0].buf, msg[0].size, &buf);
     if (map_err != 0) return map_err;
@@ -285,7 +294,18 @@ pub export fn fs_read(t: ?*c.struct_task, msg: [*c]c.struct_io_msg) callconv(.c)
 pub export fn fs_write(t: ?*c.struct_task, msg: [*c]c.struct_io_msg) callconv(.c) c_int {
     const task_ptr = t orelse return prog.errno.EINVAL;
     const fp_raw = c.task_getfp(task_ptr, msg[0].fd);
-    if (fp_raw == null) return prog.errno.EBADF;
+    if (fp_raw == null) {
+        c.task_unlock(task_ptr);
+        return prog.errno.EBADF;
+    }
+
+    // Hold the file and unlock the task. Other requests from the task
+    // can run while the data is transferred, and the vnode lock
+    // serializes access to the file.
+    c.file_hold(fp_raw);
+    c.task_unlock(task_ptr);
+    defer _ = c.sys_close(fp_raw);
+
     var buf: ?*anyopaque = null;
     const map_err = c.vm_map(msg[0].hdr.task, msg[0].buf, msg[0].size, &buf);
     if (map_err != 0) return map_err;
@@ -353,14 +373,12 @@ pub export fn fs_dup(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_i
     const old_fd = msg[0].data[0];
     const fp_raw = c.task_getfp(task_ptr, old_fd);
     if (fp_raw == null) return prog.errno.EBADF;
-    const fp: *c.struct_file = @ptrCast(fp_raw);
 
     const new_fd = c.task_newfd(task_ptr);
     if (new_fd == -1) return prog.errno.EMFILE;
 
-    task_ptr.t_ofile[@intCast(new_fd)] = fp_raw;
-    c.vref(fp.f_vnode);
-    fp.f_count += 1;
+    c.task_setfp(task_ptr, new_fd, fp_raw);
+    c.file_hold(fp_raw);
     msg[0].data[0] = new_fd;
     return 0;
 }
@@ -369,18 +387,18 @@ pub export fn fs_dup2(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_
     const task_ptr = t orelse return prog.errno.EINVAL;
     const old_fd = msg[0].data[0];
     const new_fd = msg[0].data[1];
-    if (old_fd >= c.OPEN_MAX or new_fd >= c.OPEN_MAX) return prog.errno.EBADF;
-    const fp_raw = task_ptr.t_ofile[@intCast(old_fd)];
+    if (new_fd < 0 or new_fd >= c.OPEN_MAX) return prog.errno.EBADF;
+    const fp_raw = c.task_getfp(task_ptr, old_fd);
     if (fp_raw == null) return prog.errno.EBADF;
-    const fp: *c.struct_file = @ptrCast(fp_raw);
 
     // Close previous occupant of new_fd slot, if any.
-    if (task_ptr.t_ofile[@intCast(new_fd)]) |org| {
+    if (c.task_getfp(task_ptr, new_fd)) |org| {
         _ = c.sys_close(org);
+    } else if (c.task_growfd(task_ptr, new_fd) != 0) {
+        return prog.errno.EMFILE;
     }
-    task_ptr.t_ofile[@intCast(new_fd)] = fp_raw;
-    c.vref(fp.f_vnode);
-    fp.f_count += 1;
+    c.task_setfp(task_ptr, new_fd, fp_raw);
+    c.file_hold(fp_raw);
     msg[0].data[0] = new_fd;
     return 0;
 }
@@ -394,12 +412,15 @@ pub export fn fs_fcntl(t: ?*c.struct_task, msg: [*c]c.struct_fcntl_msg) callconv
     const arg = msg[0].arg;
     switch (msg[0].cmd) {
         F_DUPFD => {
-            if (arg >= c.OPEN_MAX) return prog.errno.EINVAL;
-            const new_fd = c.task_newfd(task_ptr);
-            if (new_fd == -1) return prog.errno.EMFILE;
-            task_ptr.t_ofile[@intCast(new_fd)] = fp_raw;
-            c.vref(fp.f_vnode);
-            fp.f_count += 1;
+            if (arg < 0 or arg >= c.OPEN_MAX) return prog.errno.EINVAL;
+            // Find smallest empty slot from arg as new fd.
+            var new_fd: c_int = arg;
+            while (new_fd < task_ptr.t_nofile) : (new_fd += 1) {
+                if (task_ptr.t_ofile[@intCast(new_fd)] == null) break;
+            }
+            if (c.task_growfd(task_ptr, new_fd) != 0) return prog.errno.EMFILE;
+            c.task_setfp(task_ptr, new_fd, fp_raw);
+            c.file_hold(fp_raw);
             msg[0].arg = new_fd;
         },
         F_GETFD => {
@@ -435,9 +456,11 @@ pub export fn fs_pipe(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_
     // then bind the resulting file pointers to the slots.
     const rfd = c.task_newfd(task_ptr);
     if (rfd == -1) return prog.errno.EMFILE;
+    // rfd is the lowest free slot; skip it for the next allocation.
+    task_ptr.t_freefd = rfd + 1;
     const wfd = c.task_newfd(task_ptr);
     if (wfd == -1) {
-        task_ptr.t_ofile[@intCast(rfd)] = null;
+        c.task_delfd(task_ptr, rfd);
         return prog.errno.EMFILE;
     }
 
@@ -446,16 +469,14 @@ pub export fn fs_pipe(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_
 
     var err = c.sys_mknod(&path, S_IFIFO);
     if (err != 0) {
-        task_ptr.t_ofile[@intCast(rfd)] = null;
-        task_ptr.t_ofile[@intCast(wfd)] = null;
+        c.task_delfd(task_ptr, rfd);
         return err;
     }
 
     var rfp: c.file_t = null;
     err = c.sys_open(&path, O_RDONLY | O_NONBLOCK, 0, &rfp);
     if (err != 0) {
-        task_ptr.t_ofile[@intCast(rfd)] = null;
-        task_ptr.t_ofile[@intCast(wfd)] = null;
+        c.task_delfd(task_ptr, rfd);
         return err;
     }
 
@@ -463,13 +484,12 @@ pub export fn fs_pipe(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_
     err = c.sys_open(&path, O_WRONLY | O_NONBLOCK, 0, &wfp);
     if (err != 0) {
         _ = c.sys_close(rfp);
-        task_ptr.t_ofile[@intCast(rfd)] = null;
-        task_ptr.t_ofile[@intCast(wfd)] = null;
+        c.task_delfd(task_ptr, rfd);
         return err;
     }
 
-    task_ptr.t_ofile[@intCast(rfd)] = rfp;
-    task_ptr.t_ofile[@intCast(wfd)] = wfp;
+    c.task_setfp(task_ptr, rfd, rfp);
+    c.task_setfp(task_ptr, wfd, wfp);
     task_ptr.t_nopens += 2;
     msg[0].data[0] = rfd;
     msg[0].data[1] = wfd;
@@ -496,13 +516,13 @@ pub export fn fs_exec(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_
     c.task_setid(target_ptr, new_id);
 
     var fd: c_int = 0;
-    while (fd < c.OPEN_MAX) : (fd += 1) {
+    while (fd < target_ptr[0].t_nofile) : (fd += 1) {
         const fp_raw = target_ptr[0].t_ofile[@intCast(fd)];
         if (fp_raw) |raw| {
             const fp: *c.struct_file = @ptrCast(raw);
             if (fp.f_vnode.?.*.v_type == c.VDIR) {
                 _ = c.sys_close(fp_raw);
-                target_ptr[0].t_ofile[@intCast(fd)] = null;
+                c.task_delfd(target_ptr, fd);
             }
         }
     }
@@ -517,32 +537,34 @@ pub export fn fs_fork(t: ?*c.struct_task, msg: [*c]c.struct_msg) callconv(.c) c_
     const err = c.task_alloc(child_taskid, &newtask);
     if (err != 0) return err;
     const new_ptr = newtask.?;
+    const grow_err = c.task_growfd(new_ptr, task_ptr.t_nofile - 1);
+    if (grow_err != 0) {
+        _ = c.mutex_lock(&new_ptr.t_lock);
+        c.task_free(new_ptr);
+        return grow_err;
+    }
 
     new_ptr.t_cwdfp = task_ptr.t_cwdfp;
     _ = ffi.prog.string.strlcpy(@ptrCast(&new_ptr.t_cwd), @ptrCast(&task_ptr.t_cwd), @sizeOf(@TypeOf(new_ptr.t_cwd)));
 
     var i: c_int = 0;
-    while (i < c.OPEN_MAX) : (i += 1) {
+    while (i < task_ptr.t_nofile) : (i += 1) {
         const fp_raw = task_ptr.t_ofile[@intCast(i)];
         new_ptr.t_ofile[@intCast(i)] = fp_raw;
-        if (fp_raw) |raw| {
-            const fp: *c.struct_file = @ptrCast(raw);
-            c.vref(fp.f_vnode);
-            fp.f_count += 1;
-        }
-    }
-    if (new_ptr.t_cwdfp) |cwdfp| {
-        const cwd_file: *c.struct_file = @ptrCast(cwdfp);
-        cwd_file.f_count += 1;
-        c.vref(cwd_file.f_vnode);
+        if (fp_raw != null) c.file_hold(fp_raw);
     }
+    if (new_ptr.t_cwdfp != null) c.file_hold(new_ptr.t_cwdfp);
     return 0;
 }
 
 pub export fn fs_exit(t: ?*c.struct_task, _: [*c]c.struct_msg) callconv(.c) c_int {
     const task_ptr = t orelse return prog.errno.EINVAL;
+
+    // Drop poll listeners and event areas of the task
+    c.sys_poll_exit(task_ptr.t_taskid);
+
     var fd: c_int = 0;
-    while (fd < c.OPEN_MAX) : (fd += 1) {
+    while (fd < task_ptr.t_nofile) : (fd += 1) {
         const fp_raw = task_ptr.t_ofile[@intCast(fd)];
         if (fp_raw != null) {
             _ = c.sys_close(fp_raw);
@@ -555,6 +577,87 @@ pub export fn fs_exit(t: ?*c.struct_task, _: [*c]c.struct_msg) callconv(.c) c_in
     return 0;
 }
 
+/// Called by the exec server for posix_spawn(). The child gets the cwd
+/// and the files of the parent as with fork(), rearranged by the
+/// descriptor map. Directory streams are not inherited.
+pub export fn fs_spawn(_: ?*c.struct_task, msg: [*c]c.struct_fdmap_msg) callconv(.c) c_int {
+    if (c.task_chkcap(msg[0].hdr.task, c.CAP_PROTSERV) != 0) return prog.errno.EPERM;
+
+    if (msg[0].parent == 0) {
+        // Back out of a failed spawn
+        const child = c.task_lookup(msg[0].child) orelse return prog.errno.EINVAL;
+        return fs_exit(child, null);
+    }
+
+    const nfds = msg[0].nfds;
+    if (nfds < 0 or nfds > c.OPEN_MAX) return prog.errno.EINVAL;
+    const parent = c.task_lookup(msg[0].parent) orelse return prog.errno.EINVAL;
+    defer c.task_unlock(parent);
+
+    var i: c_int = 0;
+    while (i < nfds) : (i += 1) {
+        const fd = msg[0].fds[@intCast(i)];
+        if (fd != -1 and c.task_getfp(parent, fd) == null) return prog.errno.EBADF;
+    }
+
+    var newtask: ?*c.struct_task = null;
+    const err = c.task_alloc(msg[0].child, &newtask);
+    if (err != 0) return err;
+    const new_ptr = newtask.?;
+
+    const n = @max(nfds, parent.*.t_nofile);
+    const grow_err = c.task_growfd(new_ptr, n - 1);
+    if (grow_err != 0) {
+        _ = c.mutex_lock(&new_ptr.t_lock);
+        c.task_free(new_ptr);
+        return grow_err;
+    }
+
+    new_ptr.t_cwdfp = parent.*.t_cwdfp;
+    _ = ffi.prog.string.strlcpy(@ptrCast(&new_ptr.t_cwd), @ptrCast(&parent.*.t_cwd), @sizeOf(@TypeOf(new_ptr.t_cwd)));
+    if (new_ptr.t_cwdfp != null) c.file_hold(new_ptr.t_cwdfp);
+
+    i = 0;
+    while (i < n) : (i += 1) {
+        const fd = if (i < nfds) msg[0].fds[@intCast(i)] else i;
+        if (fd == -1) continue;
+        const fp_raw = c.task_getfp(parent, fd) orelse continue;
+        const fp: *c.struct_file = @ptrCast(fp_raw);
+        if (fp.f_vnode.?.*.v_type == c.VDIR) continue;
+        new_ptr.t_ofile[@intCast(i)] = fp_raw;
+        c.file_hold(fp_raw);
+    }
+    return 0;
+}
+
+/// Called by the network server for sendfile(). Reads a file of the
+/// owner task straight into the buffer of the server, so the data never
+/// passes through the owner. The server need not be registered.
+pub export fn fs_splice(_: ?*c.struct_task, msg: [*c]c.struct_splice_msg) callconv(.c) c_int {
+    if (c.task_chkcap(msg[0].hdr.task, c.CAP_PROTSERV) != 0) return prog.errno.EPERM;
+    if (msg[0].size == 0) return 0;
+
+    const owner = c.task_lookup(msg[0].owner) orelse return prog.errno.EINVAL;
+    const fp_raw = c.task_getfp(owner, msg[0].fd);
+    if (fp_raw == null) {
+        c.task_unlock(owner);
+        return prog.errno.EBADF;
+    }
+    c.file_hold(fp_raw);
+    c.task_unlock(owner);
+    defer _ = c.sys_close(fp_raw);
+
+    var buf: ?*anyopaque = null;
+    const map_err = c.vm_map(msg[0].hdr.task, msg[0].buf, msg[0].size, &buf);
+    if (map_err != 0) return map_err;
+
+    var bytes: usize = 0;
+    const read_err = c.sys_pread(fp_raw, buf, msg[0].size, msg[0].offset, &bytes);
+    msg[0].size = bytes;
+    _ = c.vm_free(c.task_self(), buf);
+    return read_err;
+}
+
 // ---------------------------------------------------------------------------
 // Step 2.9: poll handlers (select/poll multiplexing)
 // ---------------------------------------------------------------------------
@@ -567,6 +670,10 @@ pub export fn fs_poll_deregister(t: ?*c.struct_task, msg: [*c]c.struct_fs_poll_m
     return c.sys_poll_deregister(t, msg[0].sem_id);
 }
 
+pub export fn fs_event_ctl(t: ?*c.struct_task, msg: [*c]c.struct_event_msg) callconv(.c) c_int {
+    return c.sys_event_ctl(t, msg);
+}
+
 pub export fn fs_poll_query(t: ?*c.struct_task, msg: [*c]c.struct_fs_poll_msg) callconv(.c) c_int {
     const ready = c.sys_poll_query(t, msg[0].nfds, &msg[0].fds);
     if (ready < 0) return -ready;
@@ -643,6 +750,7 @@ export fn vfs_init() void {
     c.task_init();
     c.bio_init();
     c.vnode_init();
+    c.ncache_init();
 
     var entry: [*c]const c.struct_vfssw = get_vfssw();
     while (entry[0].vs_name != null) {
@@ -37,6 +37,7 @@
 #include <sys/mount.h>
 #include <sys/dirent.h>
 #include <ipc/fs.h>
+#include <ipc/event.h>
 
 #include <assert.h>
 
@@ -47,6 +48,8 @@
  */
 #define FSMAXNAMES 16 /* max length of 'file system' name */
 
+#define NCACHE_MISS (-1) /* ncache_lookup(): path is not cached */
+
 #ifdef DEBUG_VFS
 extern int vfs_debug;
 
@@ -97,11 +100,25 @@ struct task
     task_t t_taskid;        /* task id */
     char t_cwd[PATH_MAX];   /* current working directory */
     file_t t_cwdfp;         /* directory for cwd */
-    file_t t_ofile[NOFILE]; /* pointers to file structures of open files */
+    file_t* t_ofile;        /* pointers to file structures of open files */
+    int t_nofile;           /* number of slots in t_ofile */
+    int t_freefd;           /* no free slot below this fd */
     int t_nopens;           /* number of opening files */
     mutex_t t_lock;         /* lock for this task */
 };
 
+/*
+ * Event area of an epoll instance mapped from a client
+ */
+struct event_map
+{
+    struct list link;      /* Link in the map list */
+    task_t task;           /* Client task */
+    void* uaddr;           /* Address in the client */
+    struct event_shm* shm; /* Mapped address */
+    int refcnt;            /* Number of listeners */
+};
+
 /*
  * poll listener
  */
@@ -112,6 +129,9 @@ struct poll_listener
     vnode_t vp;       /* Target vnode */
     sem_t sem;        /* Client notification semaphore */
     short events;     /* Events of interest (POLLIN, POLLOUT) */
+    struct event_map* emap; /* Event area, or NULL for poll() */
+    int slot;         /* Slot in the event area */
+    task_t task;      /* Client task */
 };
 
 extern const struct vfssw vfssw[];
@@ -119,7 +139,9 @@ extern const struct vfssw vfssw[];
 __BEGIN_DECLS
 int sys_open(char* path, int flags, mode_t mode, file_t* pfp);
 int sys_close(file_t fp);
+void file_hold(file_t fp);
 int sys_read(file_t fp, void* buf, size_t size, size_t* result);
+int sys_pread(file_t fp, void* buf, size_t size, off_t offset, size_t* result);
 int sys_write(file_t fp, void* buf, size_t size, size_t* result);
 int sys_lseek(file_t fp, off_t off, int type, off_t* cur_off);
 int sys_ioctl(file_t fp, u_long request, void* buf);
@@ -138,6 +160,8 @@ int sys_fchdir(file_t fp, char* path);
 int sys_poll_register(struct task* t, sem_t sem, int nfds, struct poll_entry* fds);
 int sys_poll_deregister(struct task* t, sem_t sem);
 int sys_poll_query(struct task* t, int nfds, struct poll_entry* fds);
+int sys_event_ctl(struct task* t, struct event_msg* msg);
+void sys_poll_exit(task_t task);
 
 int sys_mkdir(char* path, mode_t mode);
 int sys_rmdir(char* path);
@@ -161,6 +185,7 @@ void task_unlock(struct task* t);
 file_t task_getfp(struct task* t, int fd);
 void task_setfp(struct task* t, int fd, file_t fp);
 int task_newfd(struct task* t);
+int task_growfd(struct task* t, int fd);
 void task_delfd(struct task* t, int fd);
 
 int task_conv(struct task* t, char* path, int mode, char* full);
@@ -172,11 +197,18 @@ int sec_vnode_permission(char* path);
 int namei(char* path, vnode_t* vpp);
 int lookup(char* path, vnode_t* vpp, char** name);
 void vnode_init(void);
+
+int ncache_lookup(mount_t mp, char* path, vnode_t* vpp);
+void ncache_enter(mount_t mp, char* path, vnode_t vp);
+void ncache_purge(char* path);
+void ncache_purge_mount(mount_t mp);
+void ncache_init(void);
 void bio_init(void);
 
 void vnode_poll_register(vnode_t vp, struct poll_listener* pl);
 void vnode_poll_deregister(vnode_t vp, struct poll_listener* pl);
 void vnode_poll_signal(vnode_t vp, short events);
+void vnode_poll_post(struct poll_listener* pl, short events);
 
 int vfs_findroot(char* path, mount_t* mp, char** root);
 void vfs_busy(mount_t mp);
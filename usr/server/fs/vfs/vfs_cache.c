@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * vfs_cache.c - name lookup cache.
+ *
+ * A vnode is named by its mount point and its path in the file
+ * system, so the cache is keyed the same way.  A positive entry
+ * holds a reference on its vnode.  The vnode stays in the vnode
+ * table and namei() finds it without calling the file system.  A
+ * negative entry records a path which does not exist.
+ *
+ * Entries are recycled in LRU order.  Any operation which creates,
+ * removes or renames a name must call ncache_purge() for it.  A
+ * file system whose names can change by themselves sets MNT_NOCACHE
+ * at mount time.
+ */
+
+#include <sys/prex.h>
+#include <sys/list.h>
+#include <sys/vnode.h>
+#include <sys/mount.h>
+
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+
+#include "vfs.h"
+
+#define NCACHE_SIZE 128    /* number of cache entries */
+#define NCACHE_BUCKETS 32  /* size of hash table */
+#define NCACHE_PATHLEN 64  /* longest path to cache */
+
+struct ncache
+{
+    struct list nc_link;         /* hash link */
+    struct list nc_lru;          /* LRU link */
+    mount_t nc_mount;            /* mount point */
+    vnode_t nc_vp;               /* vnode, or NULL for negative entry */
+    char nc_path[NCACHE_PATHLEN]; /* path in the file system */
+};
+
+static struct ncache ncache_pool[NCACHE_SIZE];
+static struct list ncache_table[NCACHE_BUCKETS];
+static struct list ncache_lru; /* head is the most recently used */
+
+#if CONFIG_FS_THREADS > 1
+static mutex_t ncache_lock = MUTEX_INITIALIZER;
+#define NCACHE_LOCK() mutex_lock(&ncache_lock)
+#define NCACHE_UNLOCK() mutex_unlock(&ncache_lock)
+#else
+#define NCACHE_LOCK()
+#define NCACHE_UNLOCK()
+#endif
+
+static u_int ncache_hash(mount_t mp, char* path)
+{
+    u_int val = 0;
+
+    while (*path)
+        val = ((val << 5) + val) + *path++;
+    return (val ^ (u_int)mp) & (NCACHE_BUCKETS - 1);
+}
+
+static struct ncache* ncache_find(mount_t mp, char* path)
+{
+    list_t head, n;
+    struct ncache* nc;
+
+    head = &ncache_table[ncache_hash(mp, path)];
+    for (n = list_first(head); n != head; n = list_next(n)) {
+        nc = list_entry(n, struct ncache, nc_link);
+        if (nc->nc_mount == mp && !strcmp(nc->nc_path, path))
+            return nc;
+    }
+    return NULL;
+}
+
+/*
+ * Unlink an entry and move it to the LRU tail for reuse.
+ * Returns the vnode to be released by the caller.
+ */
+static vnode_t ncache_remove(struct ncache* nc)
+{
+    vnode_t vp;
+
+    vp = nc->nc_vp;
+    list_remove(&nc->nc_link);
+    list_init(&nc->nc_link);
+    list_remove(&nc->nc_lru);
+    list_insert(list_last(&ncache_lru), &nc->nc_lru);
+    nc->nc_mount = NULL;
+    nc->nc_vp = NULL;
+    return vp;
+}
+
+/*
+ * Look up a path in the cache.
+ * Returns 0 with a locked vnode, ENOENT for a negative entry, or
+ * NCACHE_MISS if the path is not cached.
+ */
+int ncache_lookup(mount_t mp, char* path, vnode_t* vpp)
+{
+    struct ncache* nc;
+    vnode_t vp;
+
+    if (mp->m_flags & MNT_NOCACHE)
+        return NCACHE_MISS;
+
+    NCACHE_LOCK();
+    if ((nc = ncache_find(mp, path)) == NULL) {
+        NCACHE_UNLOCK();
+        return NCACHE_MISS;
+    }
+    list_remove(&nc->nc_lru);
+    list_insert(&ncache_lru, &nc->nc_lru);
+    if ((vp = nc->nc_vp) == NULL) {
+        NCACHE_UNLOCK();
+        return ENOENT;
+    }
+    vref(vp);
+    NCACHE_UNLOCK();
+
+    vn_lock(vp);
+    *vpp = vp;
+    return 0;
+}
+
+/*
+ * Add a path to the cache.
+ * @vp: vnode of the path, or NULL if the path does not exist.
+ */
+void ncache_enter(mount_t mp, char* path, vnode_t vp)
+{
+    struct ncache* nc;
+    vnode_t old = NULL;
+
+    if ((mp->m_flags & MNT_NOCACHE) || strlen(path) >= NCACHE_PATHLEN)
+        return;
+    if (vp)
+        vref(vp);
+
+    NCACHE_LOCK();
+    if ((nc = ncache_find(mp, path)) != NULL) {
+        old = nc->nc_vp;
+        nc->nc_vp = vp;
+    } else {
+        /* Recycle the least recently used entry */
+        nc = list_entry(list_last(&ncache_lru), struct ncache, nc_lru);
+        old = ncache_remove(nc);
+        nc->nc_mount = mp;
+        nc->nc_vp = vp;
+        strlcpy(nc->nc_path, path, sizeof(nc->nc_path));
+        list_insert(&ncache_table[ncache_hash(mp, path)], &nc->nc_link);
+    }
+    list_remove(&nc->nc_lru);
+    list_insert(&ncache_lru, &nc->nc_lru);
+    NCACHE_UNLOCK();
+
+    if (old)
+        vrele(old);
+}
+
+/*
+ * Drop the entries of a mount point whose path is @path or is
+ * below @path.  A NULL path drops all entries of the mount.
+ */
+static void ncache_flush(mount_t mp, char* path)
+{
+    struct ncache* nc;
+    vnode_t vps[NCACHE_SIZE];
+    size_t len = 0;
+    int i, n = 0;
+
+    if (path) {
+        len = strlen(path);
+        if (len == 1)
+            len = 0; /* root directory */
+    }
+
+    NCACHE_LOCK();
+    for (i = 0; i < NCACHE_SIZE; i++) {
+        nc = &ncache_pool[i];
+        if (nc->nc_mount != mp)
+            continue;
+        if (len > 0 && (strncmp(nc->nc_path, path, len) ||
+                        (nc->nc_path[len] != '\0' && nc->nc_path[len] != '/')))
+            continue;
+        if ((vps[n] = ncache_remove(nc)) != NULL)
+            n++;
+    }
+    NCACHE_UNLOCK();
+
+    /* Release the vnodes without the cache lock */
+    for (i = 0; i < n; i++)
+        vrele(vps[i]);
+}
+
+/*
+ * Invalidate a full path name and all names below it.
+ */
+void ncache_purge(char* path)
+{
+    char node[PATH_MAX];
+    mount_t mp;
+    char* p;
+
+    if (vfs_findroot(path, &mp, &p))
+        return;
+    strlcpy(node, "/", sizeof(node));
+    strlcat(node, p, sizeof(node));
+    ncache_flush(mp, node);
+}
+
+/*
+ * Invalidate all names in a mount point.
+ */
+void ncache_purge_mount(mount_t mp)
+{
+
+    ncache_flush(mp, NULL);
+}
+
+void ncache_init(void)
+{
+    int i;
+
+    for (i = 0; i < NCACHE_BUCKETS; i++)
+        list_init(&ncache_table[i]);
+    list_init(&ncache_lru);
+    for (i = 0; i < NCACHE_SIZE; i++) {
+        list_init(&ncache_pool[i].nc_link);
+        list_insert(&ncache_lru, &ncache_pool[i].nc_lru);
+    }
+}
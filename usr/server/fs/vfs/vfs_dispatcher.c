@@ -67,6 +67,9 @@ extern int fs_exit(struct task*, struct msg*);
 extern int fs_poll_register(struct task*, struct fs_poll_msg*);
 extern int fs_poll_deregister(struct task*, struct fs_poll_msg*);
 extern int fs_poll_query(struct task*, struct fs_poll_msg*);
+extern int fs_event_ctl(struct task*, struct event_msg*);
+extern int fs_spawn(struct task*, struct fdmap_msg*);
+extern int fs_splice(struct task*, struct splice_msg*);
 extern int fs_ftruncate(struct task*, struct msg*);
 extern int fs_mount(struct task*, struct mount_msg*);
 extern int fs_umount(struct task*, struct path_msg*);
@@ -80,11 +83,20 @@ struct msg_map
 {
     int code;
     int (*func)(struct task*, struct msg*);
+    int flags;
 };
 
 #define MSGMAP(code, fn)                                                                                               \
     {                                                                                                                  \
-        code, (int (*)(struct task*, struct msg*))fn                                                                   \
+        code, (int (*)(struct task*, struct msg*))fn, 0                                                                \
+    }
+
+/* The handler unlocks or frees the task by itself. */
+#define MF_UNLOCK 0x01
+
+#define MSGMAP_UNLOCK(code, fn)                                                                                        \
+    {                                                                                                                  \
+        code, (int (*)(struct task*, struct msg*))fn, MF_UNLOCK                                                        \
     }
 
 /* object for file service - stored in vfs_globals.c, accessed via get_fsobj() */
@@ -101,8 +113,8 @@ static const struct msg_map fsmsg_map[] = {
     MSGMAP(FS_CLOSE, fs_close),
     MSGMAP(FS_MKNOD, fs_mknod),
     MSGMAP(FS_LSEEK, fs_lseek),
-    MSGMAP(FS_READ, fs_read),
-    MSGMAP(FS_WRITE, fs_write),
+    MSGMAP_UNLOCK(FS_READ, fs_read),
+    MSGMAP_UNLOCK(FS_WRITE, fs_write),
     MSGMAP(FS_IOCTL, fs_ioctl),
     MSGMAP(FS_FSYNC, fs_fsync),
     MSGMAP(FS_FSTAT, fs_fstat),
@@ -126,7 +138,7 @@ static const struct msg_map fsmsg_map[] = {
     MSGMAP(FS_ACCESS, fs_access),
     MSGMAP(FS_FORK, fs_fork),
     MSGMAP(FS_EXEC, fs_exec),
-    MSGMAP(FS_EXIT, fs_exit),
+    MSGMAP_UNLOCK(FS_EXIT, fs_exit),
     MSGMAP(FS_REGISTER, fs_register),
     MSGMAP(FS_PIPE, fs_pipe),
     MSGMAP(FS_ISATTY, fs_isatty),
@@ -136,6 +148,9 @@ static const struct msg_map fsmsg_map[] = {
     MSGMAP(FS_POLL_REGISTER, fs_poll_register),
     MSGMAP(FS_POLL_DEREGISTER, fs_poll_deregister),
     MSGMAP(FS_POLL_QUERY, fs_poll_query),
+    MSGMAP(FS_EVENT_CTL, fs_event_ctl),
+    MSGMAP(FS_SPAWN, fs_spawn),
+    MSGMAP(FS_SPLICE, fs_splice),
     MSGMAP(STD_BOOT, fs_boot),
     MSGMAP(STD_SHUTDOWN, fs_shutdown),
 #ifdef DEBUG_VFS
@@ -184,6 +199,10 @@ void fs_thread(void)
                     error = fs_register(NULL, msg);
                     break;
                 }
+                if (map->code == FS_SPLICE) {
+                    error = fs_splice(NULL, (struct splice_msg*)msg);
+                    break;
+                }
 
                 /* Lookup and lock task */
                 t = task_lookup(msg->hdr.task);
@@ -192,7 +211,7 @@ void fs_thread(void)
 
                 /* Dispatch request */
                 error = (*map->func)(t, msg);
-                if (map->code != FS_EXIT)
+                if (!(map->flags & MF_UNLOCK))
                     task_unlock(t);
                 break;
             }
@@ -34,6 +34,31 @@ mutex_t* get_task_lock(void)
     return &task_lock;
 }
 
+static struct task* volatile task_cache[64];
+static struct list task_freelist = LIST_INIT(task_freelist);
+
+struct task* volatile* get_task_cache(void)
+{
+    return task_cache;
+}
+
+struct list* get_task_freelist(void)
+{
+    return &task_freelist;
+}
+
+/* File reference count lock */
+#if CONFIG_FS_THREADS > 1
+static mutex_t file_lock = MUTEX_INITIALIZER;
+#else
+static mutex_t file_lock = 0x4d496e69;
+#endif
+
+mutex_t* get_file_lock(void)
+{
+    return &file_lock;
+}
+
 /* Poll multiplexing globals */
 static struct list poll_list;
 
@@ -42,6 +67,14 @@ struct list* get_poll_list(void)
     return &poll_list;
 }
 
+/* Event areas mapped from epoll clients */
+static struct list event_maps = LIST_INIT(event_maps);
+
+struct list* get_event_maps(void)
+{
+    return &event_maps;
+}
+
 /* Buffer cache globals */
 #include <sys/param.h>
 #include <sys/buf.h>
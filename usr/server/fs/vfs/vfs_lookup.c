@@ -66,6 +66,12 @@ int namei(char* path, vnode_t* vpp)
         return ENOTDIR;
     strlcpy(node, "/", sizeof(node));
     strlcat(node, p, sizeof(node));
+    if ((error = ncache_lookup(mp, node, &vp)) != NCACHE_MISS) {
+        /* Found in the name cache. */
+        if (error == 0)
+            *vpp = vp;
+        return error;
+    }
     vp = vn_lookup(mp, node);
     if (vp) {
         /* vnode is already active. */
@@ -102,7 +108,13 @@ int namei(char* path, vnode_t* vpp)
          */
         strlcat(node, "/", sizeof(node));
         strlcat(node, name, sizeof(node));
-        vp = vn_lookup(mp, node);
+        error = ncache_lookup(mp, node, &vp);
+        if (error == ENOENT) {
+            vput(dvp);
+            return error;
+        }
+        if (error == NCACHE_MISS)
+            vp = vn_lookup(mp, node);
         if (vp == NULL) {
             vp = vget(mp, node);
             if (vp == NULL) {
@@ -111,12 +123,17 @@ int namei(char* path, vnode_t* vpp)
             }
             /* Find a vnode in this directory. */
             error = VOP_LOOKUP(dvp, name, vp);
-            if (error || (*p == '/' && vp->v_type != VDIR)) {
-                /* Not found */
-                vput(vp);
-                vput(dvp);
-                return error;
-            }
+            if (error == ENOENT)
+                ncache_enter(mp, node, NULL);
+            else if (error == 0)
+                ncache_enter(mp, node, vp);
+        } else
+            error = 0;
+        if (error || (*p == '/' && vp->v_type != VDIR)) {
+            /* Not found */
+            vput(vp);
+            vput(dvp);
+            return error ? error : ENOTDIR;
         }
         vput(dvp);
         dvp = vp;
@@ -8,6 +8,8 @@ extern fn vn_lock(vp: c.vnode_t) callconv(.c) void;
 extern fn vget(mp: c.mount_t, path: [*c]const u8) callconv(.c) c.vnode_t;
 extern fn vput(vp: c.vnode_t) callconv(.c) void;
 extern fn sec_vnode_permission(path: [*c]const u8) callconv(.c) c_int;
+extern fn ncache_lookup(mp: c.mount_t, path: [*c]u8, vpp: [*c]c.vnode_t) callconv(.c) c_int;
+extern fn ncache_enter(mp: c.mount_t, path: [*c]u8, vp: c.vnode_t) callconv(.c) void;
 
 extern fn strlcpy(dst: [*c]u8, src: [*c]const u8, size: usize) callconv(.c) usize;
 extern fn strlcat(dst: [*c]u8, src: [*c]const u8, size: usize) callconv(.c) usize;
@@ -38,7 +40,15 @@ pub export fn namei(path: [*c]u8, vpp: [*c]c.vnode_t) callconv(.c) c_int {
     _ = strlcpy(&node, "/", node.len);
     _ = strlcat(&node, p, node.len);
 
-    var vp = vn_lookup(mp, &node);
+    var vp: c.vnode_t = null;
+    const cached = ncache_lookup(mp, &node, &vp);
+    if (cached != c.NCACHE_MISS) {
+        // Found in the name cache.
+        if (cached == 0) vpp.* = vp;
+        return cached;
+    }
+
+    vp = vn_lookup(mp, &node);
     if (vp != null) {
         vpp.* = vp;
         return 0;
@@ -70,7 +80,12 @@ pub export fn namei(path: [*c]u8, vpp: [*c]c.vnode_t) callconv(.c) c_int {
         _ = strlcat(&node, "/", node.len);
         _ = strlcat(&node, &name, node.len);
 
-        vp = vn_lookup(mp, &node);
+        var err = ncache_lookup(mp, &node, &vp);
+        if (err == ffi.prog.errno.ENOENT) {
+            vput(dvp);
+            return err;
+        }
+        if (err == c.NCACHE_MISS) vp = vn_lookup(mp, &node);
         if (vp == null) {
             vp = vget(mp, &node);
             if (vp == null) {
@@ -78,13 +93,20 @@ pub export fn namei(path: [*c]u8, vpp: [*c]c.vnode_t) callconv(.c) c_int {
                 return ffi.prog.errno.ENOMEM;
             }
 
-            const err = VOP_LOOKUP(dvp, &name, vp);
-            const vp_node: *c.struct_vnode = @ptrCast(vp.?);
-            if (err != 0 or (p[0] == '/' and vp_node.v_type != c.VDIR)) {
-                vput(vp);
-                vput(dvp);
-                return err;
+            err = VOP_LOOKUP(dvp, &name, vp);
+            if (err == ffi.prog.errno.ENOENT) {
+                ncache_enter(mp, &node, null);
+            } else if (err == 0) {
+                ncache_enter(mp, &node, vp);
             }
+        } else {
+            err = 0;
+        }
+        const vp_node: *c.struct_vnode = @ptrCast(vp.?);
+        if (err != 0 or (p[0] == '/' and vp_node.v_type != c.VDIR)) {
+            vput(vp);
+            vput(dvp);
+            return if (err != 0) err else ffi.prog.errno.ENOTDIR;
         }
         vput(dvp);
         const vp_val = vp.?;
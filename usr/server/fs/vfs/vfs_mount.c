@@ -241,6 +241,9 @@ int sys_umount(char* path)
         error = EINVAL;
         goto out;
     }
+    /* Release the vnodes held by the name cache */
+    ncache_purge_mount(mp);
+
     if ((error = VFS_UNMOUNT(mp)) != 0)
         goto out;
     list_remove(&mp->m_link);
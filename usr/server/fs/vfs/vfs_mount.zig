@@ -10,6 +10,7 @@ extern fn vget(mp: c.mount_t, path: [*c]const u8) callconv(.c) c.vnode_t;
 extern fn vput(vp: c.vnode_t) callconv(.c) void;
 extern fn vn_unlock(vp: c.vnode_t) callconv(.c) void;
 extern fn vrele(vp: c.vnode_t) callconv(.c) void;
+extern fn ncache_purge_mount(mp: c.mount_t) callconv(.c) void;
 extern fn vflush(mp: c.mount_t) callconv(.c) void;
 extern fn binval(dev: c.dev_t) callconv(.c) void;
 extern fn bio_sync() callconv(.c) void;
@@ -213,6 +214,9 @@ pub export fn sys_umount(path: [*c]u8) callconv(.c) c_int {
         return ffi.prog.errno.EINVAL;
     }
 
+    // Release the vnodes held by the name cache.
+    ncache_purge_mount(mount_entry);
+
     const err = VFS_UNMOUNT(mount_entry);
     if (err != 0) {
         mountUnlock();
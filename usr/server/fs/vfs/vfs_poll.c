@@ -52,6 +52,76 @@
  */
 static struct list poll_list = LIST_INIT(poll_list);
 
+/*
+ * List of event areas mapped from epoll clients.
+ */
+static struct list event_maps = LIST_INIT(event_maps);
+
+#if CONFIG_FS_THREADS > 1
+static mutex_t poll_lock = MUTEX_INITIALIZER;
+#define POLL_LOCK() mutex_lock(&poll_lock)
+#define POLL_UNLOCK() mutex_unlock(&poll_lock)
+#else
+#define POLL_LOCK()
+#define POLL_UNLOCK()
+#endif
+
+/*
+ * Get the event area of a client, mapping it on first use.
+ * Called with the poll lock held.
+ */
+static struct event_map* event_map_get(task_t task, void* uaddr)
+{
+    struct event_map* em;
+    list_t n;
+    void* kaddr;
+
+    for (n = list_first(&event_maps); n != &event_maps; n = list_next(n)) {
+        em = list_entry(n, struct event_map, link);
+        if (em->task == task && em->uaddr == uaddr) {
+            em->refcnt++;
+            return em;
+        }
+    }
+    if (!(em = malloc(sizeof(struct event_map))))
+        return NULL;
+    if (vm_map(task, uaddr, sizeof(struct event_shm), &kaddr) != 0) {
+        free(em);
+        return NULL;
+    }
+    em->task = task;
+    em->uaddr = uaddr;
+    em->shm = kaddr;
+    em->refcnt = 1;
+    list_insert(&event_maps, &em->link);
+    return em;
+}
+
+static void event_map_put(struct event_map* em)
+{
+
+    if (--em->refcnt > 0)
+        return;
+    list_remove(&em->link);
+    vm_free(task_self(), em->shm);
+    free(em);
+}
+
+/*
+ * Remove a listener.  Called with the poll lock held.
+ */
+static void poll_remove(struct poll_listener* pl)
+{
+
+    vnode_poll_deregister(pl->vp, pl);
+    list_remove(&pl->g_link);
+    if (pl->emap != NULL) {
+        event_map_put(pl->emap);
+        vrele(pl->vp);
+    }
+    free(pl);
+}
+
 int sys_poll_register(struct task* t, sem_t sem, int nfds, struct poll_entry* fds)
 {
     struct poll_listener* pl;
@@ -70,6 +140,9 @@ int sys_poll_register(struct task* t, sem_t sem, int nfds, struct poll_entry* fd
         pl->sem = sem;
         pl->events = fds[i].events;
         pl->vp = fp->f_vnode;
+        pl->emap = NULL;
+        pl->slot = 0;
+        pl->task = t->t_taskid;
         list_init(&pl->link);
         list_init(&pl->g_link);
 
@@ -77,7 +150,9 @@ int sys_poll_register(struct task* t, sem_t sem, int nfds, struct poll_entry* fd
         vnode_poll_register(vp, pl);
         
         /* Add to global poll list for cleanup */
+        POLL_LOCK();
         list_insert(&poll_list, &pl->g_link);
+        POLL_UNLOCK();
     }
     return 0;
 }
@@ -87,15 +162,95 @@ int sys_poll_deregister(struct task* t, sem_t sem)
     list_t n, next;
     struct poll_listener* pl;
 
+    POLL_LOCK();
     for (n = list_first(&poll_list); n != &poll_list; n = next) {
         next = list_next(n);
         pl = list_entry(n, struct poll_listener, g_link);
-        if (pl->sem == sem) {
-            vnode_poll_deregister(pl->vp, pl);
-            list_remove(&pl->g_link);
-            free(pl);
+        if (pl->sem == sem)
+            poll_remove(pl);
+    }
+    POLL_UNLOCK();
+    return 0;
+}
+
+/*
+ * Remove all listeners of a terminating task.  This also unmaps its
+ * event areas, which must not be written once the task is gone.
+ */
+void sys_poll_exit(task_t task)
+{
+    list_t n, next;
+    struct poll_listener* pl;
+
+    POLL_LOCK();
+    for (n = list_first(&poll_list); n != &poll_list; n = next) {
+        next = list_next(n);
+        pl = list_entry(n, struct poll_listener, g_link);
+        if (pl->task == task)
+            poll_remove(pl);
+    }
+    POLL_UNLOCK();
+}
+
+/*
+ * Add or remove a persistent listener for epoll.
+ *
+ * Events are queued to the fs ring of the client's event area.
+ * Device vnodes only post the semaphore from the driver, so the
+ * client is told to poll them instead.
+ */
+int sys_event_ctl(struct task* t, struct event_msg* msg)
+{
+    struct poll_listener* pl;
+    file_t fp;
+    vnode_t vp;
+    list_t n, next;
+    short revents;
+
+    if (msg->op == EVENT_DEL) {
+        POLL_LOCK();
+        for (n = list_first(&poll_list); n != &poll_list; n = next) {
+            next = list_next(n);
+            pl = list_entry(n, struct poll_listener, g_link);
+            if (pl->sem == msg->sem && pl->emap != NULL && pl->slot == msg->slot)
+                poll_remove(pl);
         }
+        POLL_UNLOCK();
+        return 0;
+    }
+    if (msg->op != EVENT_ADD)
+        return EINVAL;
+
+    if ((fp = task_getfp(t, msg->fd)) == NULL)
+        return EBADF;
+    vp = fp->f_vnode;
+    if (!(pl = malloc(sizeof(struct poll_listener))))
+        return ENOMEM;
+
+    POLL_LOCK();
+    if ((pl->emap = event_map_get(t->t_taskid, msg->shm)) == NULL) {
+        POLL_UNLOCK();
+        free(pl);
+        return EFAULT;
     }
+    pl->sem = msg->sem;
+    pl->events = (short)msg->events;
+    pl->vp = vp;
+    pl->slot = msg->slot;
+    pl->task = t->t_taskid;
+    list_init(&pl->link);
+    list_init(&pl->g_link);
+    vref(vp);
+    vnode_poll_register(vp, pl);
+    list_insert(&poll_list, &pl->g_link);
+
+    /* Report the current state */
+    revents = VOP_POLL(vp, fp, pl->events);
+    if (revents)
+        vnode_poll_post(pl, revents);
+    POLL_UNLOCK();
+
+    msg->polled = (vp->v_type == VCHR || vp->v_type == VBLK);
     return 0;
 }
 
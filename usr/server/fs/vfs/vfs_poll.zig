@@ -2,6 +2,65 @@ const ffi = @import("fs_ffi.zig");
 const c = ffi.raw;
 
 extern fn get_poll_list() callconv(.c) *c.struct_list;
+extern fn get_event_maps() callconv(.c) *c.struct_list;
+extern fn vref(vp: c.vnode_t) callconv(.c) void;
+extern fn vrele(vp: c.vnode_t) callconv(.c) void;
+
+fn pollList() *ffi.List {
+    const list_head: *ffi.List = @ptrCast(get_poll_list());
+    if (list_head.next == null) {
+        list_head.init();
+    }
+    return list_head;
+}
+
+// Get the event area of a client, mapping it on first use.
+fn eventMapGet(task: c.task_t, uaddr: ?*anyopaque) ?*c.struct_event_map {
+    const head: *ffi.List = @ptrCast(get_event_maps());
+    var n = head.next;
+    while (n != head) {
+        const em = n.?.entry(c.struct_event_map, "link");
+        if (em.task == task and em.uaddr == uaddr) {
+            em.refcnt += 1;
+            return em;
+        }
+        n = n.?.next;
+    }
+
+    const p = ffi.prog.stdlib.malloc(@sizeOf(c.struct_event_map)) orelse return null;
+    const em: *c.struct_event_map = @ptrCast(@alignCast(p));
+    var kaddr: ?*anyopaque = null;
+    if (c.vm_map(task, uaddr, @sizeOf(c.struct_event_shm), &kaddr) != 0) {
+        ffi.prog.stdlib.free(p);
+        return null;
+    }
+    em.task = task;
+    em.uaddr = uaddr;
+    em.shm = @ptrCast(@alignCast(kaddr));
+    em.refcnt = 1;
+    head.insert(@ptrCast(&em.link));
+    return em;
+}
+
+fn eventMapPut(em: *c.struct_event_map) void {
+    em.refcnt -= 1;
+    if (em.refcnt > 0) return;
+    const link: *ffi.List = @ptrCast(&em.link);
+    link.remove();
+    _ = c.vm_free(c.task_self(), em.shm);
+    ffi.prog.stdlib.free(em);
+}
+
+fn pollRemove(pl: *c.struct_poll_listener) void {
+    c.vnode_poll_deregister(pl.vp, pl);
+    const g_link: *ffi.List = @ptrCast(&pl.g_link);
+    g_link.remove();
+    if (pl.emap != null) {
+        eventMapPut(pl.emap);
+        vrele(pl.vp);
+    }
+    ffi.prog.stdlib.free(pl);
+}
 
 pub export fn sys_poll_register(
     t: ?*c.struct_task,
@@ -9,11 +68,7 @@ pub export fn sys_poll_register(
     nfds: c_int,
     fds: [*c]c.struct_poll_entry,
 ) callconv(.c) c_int {
-    const list_head: *ffi.List = @ptrCast(get_poll_list());
-    const raw_poll_list = get_poll_list();
-    if (raw_poll_list.next == null) {
-        list_head.init();
-    }
+    const list_head = pollList();
 
     var i: c_int = 0;
     while (i < nfds) : (i += 1) {
@@ -27,6 +82,9 @@ pub export fn sys_poll_register(
         listener.sem = sem;
         listener.events = fds[@intCast(i)].events;
         listener.vp = fp.f_vnode;
+        listener.emap = null;
+        listener.slot = 0;
+        listener.task = t.?.t_taskid;
 
         // Initialize list links
         const link: *ffi.List = @ptrCast(&listener.link);
@@ -48,27 +106,90 @@ pub export fn sys_poll_deregister(
     sem: ffi.task.prex.sem_t,
 ) callconv(.c) c_int {
     _ = t;
-    const list_head: *ffi.List = @ptrCast(get_poll_list());
-    const raw_poll_list = get_poll_list();
-    if (raw_poll_list.next == null) {
-        list_head.init();
-    }
+    const list_head = pollList();
 
     var n = list_head.next;
     while (n != list_head) {
         const next_node = n.?.next;
         const pl = n.?.entry(c.struct_poll_listener, "g_link");
         if (pl.sem == sem) {
-            c.vnode_poll_deregister(pl.vp, pl);
-            const g_link: *ffi.List = @ptrCast(&pl.g_link);
-            g_link.remove();
-            ffi.prog.stdlib.free(pl);
+            pollRemove(pl);
         }
         n = next_node;
     }
     return 0;
 }
 
+// Remove all listeners of a terminating task. This also unmaps its
+// event areas, which must not be written once the task is gone.
+pub export fn sys_poll_exit(task: c.task_t) callconv(.c) void {
+    const list_head = pollList();
+
+    var n = list_head.next;
+    while (n != list_head) {
+        const next_node = n.?.next;
+        const pl = n.?.entry(c.struct_poll_listener, "g_link");
+        if (pl.task == task) {
+            pollRemove(pl);
+        }
+        n = next_node;
+    }
+}
+
+// Add or remove a persistent listener for epoll. Device vnodes only
+// post the semaphore from the driver, so the client polls them.
+pub export fn sys_event_ctl(t: ?*c.struct_task, msg: *c.struct_event_msg) callconv(.c) c_int {
+    const list_head = pollList();
+
+    if (msg.op == c.EVENT_DEL) {
+        var n = list_head.next;
+        while (n != list_head) {
+            const next_node = n.?.next;
+            const pl = n.?.entry(c.struct_poll_listener, "g_link");
+            if (pl.sem == msg.sem and pl.emap != null and pl.slot == msg.slot) {
+                pollRemove(pl);
+            }
+            n = next_node;
+        }
+        return 0;
+    }
+    if (msg.op != c.EVENT_ADD) return ffi.prog.errno.EINVAL;
+
+    const fp_raw = c.task_getfp(t, msg.fd);
+    if (fp_raw == null) return ffi.prog.errno.EBADF;
+    const fp: *c.struct_file = @ptrCast(fp_raw);
+    const vp = fp.f_vnode;
+
+    const p = ffi.prog.stdlib.malloc(@sizeOf(c.struct_poll_listener)) orelse return ffi.prog.errno.ENOMEM;
+    const pl: *c.struct_poll_listener = @ptrCast(@alignCast(p));
+    pl.emap = eventMapGet(t.?.t_taskid, msg.shm) orelse {
+        ffi.prog.stdlib.free(p);
+        return ffi.prog.errno.EFAULT;
+    };
+    pl.sem = msg.sem;
+    pl.events = @truncate(@as(c_int, @bitCast(msg.events)));
+    pl.vp = vp;
+    pl.slot = msg.slot;
+    pl.task = t.?.t_taskid;
+    const link: *ffi.List = @ptrCast(&pl.link);
+    const g_link: *ffi.List = @ptrCast(&pl.g_link);
+    link.init();
+    g_link.init();
+    vref(vp);
+    c.vnode_poll_register(vp, pl);
+    list_head.insert(g_link);
+
+    // Report the current state
+    const revents = ffi.VOP_POLL(vp, fp, pl.events);
+    if (revents != 0) {
+        c.vnode_poll_post(pl, @truncate(revents));
+    }
+
+    const v: *c.struct_vnode = @ptrCast(vp.?);
+    msg.polled = if (v.v_type == c.VCHR or v.v_type == c.VBLK) 1 else 0;
+    return 0;
+}
+
 pub export fn sys_poll_query(
     t: ?*c.struct_task,
     nfds: c_int,
@@ -51,6 +51,32 @@
 
 #include "vfs.h"
 
+/*
+ * Lock for the reference count of files.  A file can be shared
+ * by several tasks, so the task lock does not protect it.
+ */
+#if CONFIG_FS_THREADS > 1
+static mutex_t file_lock = MUTEX_INITIALIZER;
+#define FILE_LOCK() mutex_lock(&file_lock)
+#define FILE_UNLOCK() mutex_unlock(&file_lock)
+#else
+#define FILE_LOCK()
+#define FILE_UNLOCK()
+#endif
+
+/*
+ * Add a reference to an open file.
+ * The reference is dropped by sys_close().
+ */
+void file_hold(file_t fp)
+{
+
+    vref(fp->f_vnode);
+    FILE_LOCK();
+    fp->f_count++;
+    FILE_UNLOCK();
+}
+
 int sys_open(char* path, int flags, mode_t mode, file_t* pfp)
 {
     vnode_t vp, dvp;
@@ -76,6 +102,7 @@ int sys_open(char* path, int flags, mode_t mode, file_t* pfp)
             mode &= ~S_IFMT;
             mode |= S_IFREG;
             error = VOP_CREATE(dvp, filename, mode);
+            ncache_purge(path);
             vput(dvp);
             if (error)
                 return error;
@@ -145,15 +172,17 @@ int sys_open(char* path, int flags, mode_t mode, file_t* pfp)
 int sys_close(file_t fp)
 {
     vnode_t vp;
-    int error;
+    int error, count;
 
     DPRINTF(VFSDB_SYSCALL, ("sys_close: fp=%x count=%d\n", (u_int)fp, fp->f_count));
 
+    vp = fp->f_vnode;
+    FILE_LOCK();
     if (fp->f_count <= 0)
         sys_panic("sys_close");
-
-    vp = fp->f_vnode;
-    if (--fp->f_count > 0) {
+    count = --fp->f_count;
+    FILE_UNLOCK();
+    if (count > 0) {
         vrele(vp);
         return 0;
     }
@@ -187,6 +216,37 @@ int sys_read(file_t fp, void* buf, size_t size, size_t* count)
     return error;
 }
 
+/*
+ * Read at the given offset without moving the file offset.
+ * The file system reads from a private copy of the file, so the
+ * shared offset is never changed.
+ */
+int sys_pread(file_t fp, void* buf, size_t size, off_t offset, size_t* count)
+{
+    struct file f;
+    vnode_t vp;
+    int error;
+
+    if ((fp->f_flags & FREAD) == 0)
+        return EBADF;
+    vp = fp->f_vnode;
+    if (vp->v_type != VREG)
+        return EINVAL;
+    if (offset < 0)
+        return EINVAL;
+    *count = 0;
+    vn_lock(vp);
+    if (size == 0 || offset >= (off_t)vp->v_size) {
+        vn_unlock(vp);
+        return 0;
+    }
+    f = *fp;
+    f.f_offset = offset;
+    error = VOP_READ(vp, &f, buf, size, count);
+    vn_unlock(vp);
+    return error;
+}
+
 int sys_write(file_t fp, void* buf, size_t size, size_t* count)
 {
     vnode_t vp;
@@ -461,6 +521,7 @@ int sys_mkdir(char* path, mode_t mode)
     mode |= S_IFDIR;
 
     error = VOP_MKDIR(dvp, name, mode);
+    ncache_purge(path);
 out:
     vput(dvp);
     return error;
@@ -478,6 +539,7 @@ int sys_rmdir(char* path)
         return error;
     if ((error = namei(path, &vp)) != 0)
         return error;
+    ncache_purge(path);
     if ((error = vn_access(vp, VWRITE)) != 0)
         goto out;
     if (vp->v_type != VDIR) {
@@ -534,6 +596,7 @@ int sys_mknod(char* path, mode_t mode)
         error = VOP_MKDIR(dvp, name, mode);
     else
         error = VOP_CREATE(dvp, name, mode);
+    ncache_purge(path);
 out:
     vput(dvp);
     return error;
@@ -542,7 +605,7 @@ out:
 int sys_rename(char* src, char* dest)
 {
     vnode_t vp1, vp2 = 0, dvp1, dvp2;
-    char *sname, *dname;
+    char *sname, *dname, *target = dest;
     int error;
     size_t len;
     char root[] = "/";
@@ -551,6 +614,7 @@ int sys_rename(char* src, char* dest)
 
     if ((error = namei(src, &vp1)) != 0)
         return error;
+    ncache_purge(src);
     if ((error = vn_access(vp1, VWRITE)) != 0)
         goto err1;
 
@@ -571,6 +635,7 @@ int sys_rename(char* src, char* dest)
     }
     /* Check type of source & target */
     error = namei(dest, &vp2);
+    ncache_purge(dest);
     if (error == 0) {
         /* target exists */
         if (vp1->v_type == VDIR && vp2->v_type != VDIR) {
@@ -614,6 +679,10 @@ int sys_rename(char* src, char* dest)
         goto err4;
     }
     error = VOP_RENAME(dvp1, vp1, sname, dvp2, vp2, dname);
+
+    /* Drop the names which were looked up in the meantime */
+    dname[-1] = '/';
+    ncache_purge(target);
 err4:
     vput(dvp2);
 err3:
@@ -636,6 +705,7 @@ int sys_unlink(char* path)
 
     if ((error = namei(path, &vp)) != 0)
         return error;
+    ncache_purge(path);
     if ((error = vn_access(vp, VWRITE)) != 0)
         goto out;
     if (vp->v_type == VDIR) {
@@ -7,9 +7,11 @@ extern fn vn_access(vp: c.vnode_t, flags: c_int) callconv(.c) c_int;
 extern fn vn_lock(vp: c.vnode_t) callconv(.c) void;
 extern fn vn_unlock(vp: c.vnode_t) callconv(.c) void;
 extern fn vput(vp: c.vnode_t) callconv(.c) void;
+extern fn vref(vp: c.vnode_t) callconv(.c) void;
 extern fn vrele(vp: c.vnode_t) callconv(.c) void;
 extern fn vgone(vp: c.vnode_t) callconv(.c) void;
 extern fn vcount(vp: c.vnode_t) callconv(.c) c_int;
+extern fn ncache_purge(path: [*c]u8) callconv(.c) void;
 extern fn vn_stat(vp: c.vnode_t, st: [*c]c.struct_stat) callconv(.c) c_int;
 
 extern fn strcmp(s1: [*c]const u8, s2: [*c]const u8) callconv(.c) c_int;
@@ -255,6 +257,7 @@ pub export fn sys_open(path: [*c]u8, flags: c_int, mode: c.mode_t, pfp: [*c]c.fi
             var m = mode;
             m = (m & ~@as(c.mode_t, c.S_IFMT)) | @as(c.mode_t, c.S_IFREG);
             err = VOP_CREATE(dvp, filename, m);
+            ncache_purge(path);
             vput(dvp);
             if (err != 0) return err;
             err = namei(path, &vp);
@@ -322,16 +325,46 @@ pub export fn sys_open(path: [*c]u8, flags: c_int, mode: c.mode_t, pfp: [*c]c.fi
     return 0;
 }
 
+// Lock for the reference count of files. A file can be shared by
+// several tasks, so the task lock does not protect it.
+extern fn get_file_lock() callconv(.c) *c.mutex_t;
+
+const has_threads = @hasDecl(c, "CONFIG_FS_THREADS") and c.CONFIG_FS_THREADS > 1;
+
+fn lockFile() void {
+    if (has_threads) {
+        _ = c.mutex_lock(get_file_lock());
+    }
+}
+
+fn unlockFile() void {
+    if (has_threads) {
+        _ = c.mutex_unlock(get_file_lock());
+    }
+}
+
+/// Add a reference to an open file. The reference is dropped by sys_close().
+pub export fn file_hold(fp: c.file_t) callconv(.c) void {
+    const fp_ptr: *c.struct_file = @ptrCast(fp);
+    vref(fp_ptr.f_vnode);
+    lockFile();
+    fp_ptr.f_count += 1;
+    unlockFile();
+}
+
 pub export fn sys_close(fp: c.file_t) callconv(.c) c_int {
     const fp_ptr: *c.struct_file = @ptrCast(fp);
+    const vp = fp_ptr.f_vnode;
 
+    lockFile();
     if (fp_ptr.f_count <= 0) {
+        unlockFile();
         return ffi.prog.errno.EINVAL;
     }
-
-    const vp = fp_ptr.f_vnode;
     fp_ptr.f_count -= 1;
-    if (fp_ptr.f_count > 0) {
+    const count = fp_ptr.f_count;
+    unlockFile();
+    if (count > 0) {
         vrele(vp);
         return 0;
     }
@@ -363,6 +396,30 @@ pub export fn sys_read(fp: c.file_t, buf: ?*anyopaque, size: usize, count: [*c]u
     return err;
 }
 
+/// Read a regular file at the given offset. The file offset is not changed.
+pub export fn sys_pread(fp: c.file_t, buf: ?*anyopaque, size: usize, offset: c.off_t, count: [*c]usize) callconv(.c) c_int {
+    const fp_ptr: *c.struct_file = @ptrCast(fp);
+
+    if ((fp_ptr.f_flags & c.FREAD) == 0) {
+        return ffi.prog.errno.EBADF;
+    }
+    const vp = fp_ptr.f_vnode;
+    const vp_ptr: *c.struct_vnode = @ptrCast(vp);
+    if (vp_ptr.v_type != c.VREG) return ffi.prog.errno.EINVAL;
+    if (offset < 0) return ffi.prog.errno.EINVAL;
+    count.* = 0;
+    vn_lock(vp);
+    if (size == 0 or @as(usize, @intCast(offset)) >= vp_ptr.v_size) {
+        vn_unlock(vp);
+        return 0;
+    }
+    var f: c.struct_file = fp_ptr.*;
+    f.f_offset = offset;
+    const err = VOP_READ(vp, &f, buf, size, count);
+    vn_unlock(vp);
+    return err;
+}
+
 pub export fn sys_write(fp: c.file_t, buf: ?*anyopaque, size: usize, count: [*c]usize) callconv(.c) c_int {
     const fp_ptr: *c.struct_file = @ptrCast(fp);
 
@@ -577,6 +634,7 @@ pub export fn sys_mkdir(path: [*c]u8, mode: c.mode_t) callconv(.c) c_int {
     m = (m & ~@as(c.mode_t, c.S_IFMT)) | @as(c.mode_t, c.S_IFDIR);
 
     err = VOP_MKDIR(dvp, name, m);
+    ncache_purge(path);
     vput(dvp);
     return err;
 }
@@ -591,6 +649,7 @@ pub export fn sys_rmdir(path: [*c]u8) callconv(.c) c_int {
 
     err = namei(path, &vp);
     if (err != 0) return err;
+    ncache_purge(path);
 
     err = vn_access(vp, c.VWRITE);
     if (err != 0) {
@@ -648,6 +707,7 @@ pub export fn sys_mknod(path: [*c]u8, mode: c.mode_t) callconv(.c) c_int {
     } else {
         err = VOP_CREATE(dvp, name, mode);
     }
+    ncache_purge(path);
     vput(dvp);
     return err;
 }
@@ -663,6 +723,7 @@ pub export fn sys_rename(src: [*c]u8, dest: [*c]u8) callconv(.c) c_int {
 
     var err = namei(src, &vp1);
     if (err != 0) return err;
+    ncache_purge(src);
 
     err = vn_access(vp1, c.VWRITE);
     if (err != 0) {
@@ -687,6 +748,7 @@ pub export fn sys_rename(src: [*c]u8, dest: [*c]u8) callconv(.c) c_int {
     }
 
     err = namei(dest_var, &vp2);
+    ncache_purge(dest_var);
     if (err == 0) {
         if (vp1.?.v_type == c.VDIR and vp2.?.v_type != c.VDIR) {
             err = ffi.prog.errno.ENOTDIR;
@@ -750,6 +812,10 @@ pub export fn sys_rename(src: [*c]u8, dest: [*c]u8) callconv(.c) c_int {
         return err;
     }
     err = VOP_RENAME(dvp1, vp1, sname, dvp2, vp2, dname);
+
+    // Drop the names which were looked up in the meantime.
+    (dname - 1)[0] = '/';
+    ncache_purge(dest);
     vput(dvp2);
     vput(dvp1);
     if (vp2 != null) vput(vp2);
@@ -764,6 +830,7 @@ pub export fn sys_unlink(path: [*c]u8) callconv(.c) c_int {
 
     var err = namei(path, &vp);
     if (err != 0) return err;
+    ncache_purge(path);
 
     err = vn_access(vp, c.VWRITE);
     if (err != 0) {
@@ -42,14 +42,32 @@
 #include "vfs.h"
 
 #define TASK_MAXBUCKETS 32 /* number of task hash buckets */
+#define TASK_CACHESIZE 64  /* number of task cache entries */
+#if OPEN_MAX > 16
+#define TASK_NOFILE 16 /* initial size of fd table */
+#else
+#define TASK_NOFILE OPEN_MAX
+#endif
 
 #define TASKHASH(x) (int)((x) & (TASK_MAXBUCKETS - 1))
+#define TASKCACHE(x) (int)(((x) ^ ((x) >> 6)) & (TASK_CACHESIZE - 1))
 
 /*
  * Hash table for task.
  */
 static struct list task_table[TASK_MAXBUCKETS];
 
+/*
+ * Cache of recently used tasks.
+ *
+ * The cache is read without the global lock.  A task structure is
+ * never returned to malloc: a freed task goes to task_freelist and
+ * keeps its mutex, so a stale cache entry always points to a valid
+ * structure.  The task id is checked again after the task is locked.
+ */
+static struct task* volatile task_cache[TASK_CACHESIZE];
+static struct list task_freelist;
+
 /*
  * Global lock for task access.
  */
@@ -74,14 +92,30 @@ struct task* task_lookup(task_t task)
     if (task == TASK_NULL)
         return NULL;
 
+    /* Fast path: look in the cache without the global lock. */
+    t = task_cache[TASKCACHE(task)];
+    if (t != NULL && t->t_taskid == task) {
+        mutex_lock(&t->t_lock);
+        if (t->t_taskid == task)
+            return t;
+        /* The task was freed or reused while we waited. */
+        mutex_unlock(&t->t_lock);
+    }
+
+ again:
     TASK_LOCK();
     head = &task_table[TASKHASH(task)];
     for (n = list_first(head); n != head; n = list_next(n)) {
         t = list_entry(n, struct task, t_link);
         ASSERT(t->t_taskid);
         if (t->t_taskid == task) {
+            task_cache[TASKCACHE(task)] = t;
             TASK_UNLOCK();
             mutex_lock(&t->t_lock);
+            if (t->t_taskid != task) {
+                mutex_unlock(&t->t_lock);
+                goto again;
+            }
             return t;
         }
     }
@@ -97,19 +131,38 @@ struct task* task_lookup(task_t task)
 int task_alloc(task_t task, struct task** pt)
 {
     struct task* t;
+    file_t* ofile;
 
     /* Check if specified task already exists. */
-    if (task_lookup(task) != NULL)
+    if ((t = task_lookup(task)) != NULL) {
+        task_unlock(t);
         return EINVAL;
+    }
 
-    if (!(t = malloc(sizeof(struct task))))
+    if (!(ofile = malloc(sizeof(file_t) * TASK_NOFILE)))
         return ENOMEM;
-    memset(t, 0, sizeof(struct task));
-    t->t_taskid = task;
-    strlcpy(t->t_cwd, "/", sizeof(t->t_cwd));
-    mutex_init(&t->t_lock);
+    memset(ofile, 0, sizeof(file_t) * TASK_NOFILE);
 
     TASK_LOCK();
+    if (!list_empty(&task_freelist)) {
+        /* Reuse a task structure.  The mutex is still valid. */
+        t = list_entry(list_first(&task_freelist), struct task, t_link);
+        list_remove(&t->t_link);
+    } else {
+        if (!(t = malloc(sizeof(struct task)))) {
+            TASK_UNLOCK();
+            free(ofile);
+            return ENOMEM;
+        }
+        mutex_init(&t->t_lock);
+    }
+    t->t_cwdfp = NULL;
+    t->t_ofile = ofile;
+    t->t_nofile = TASK_NOFILE;
+    t->t_freefd = 0;
+    t->t_nopens = 0;
+    strlcpy(t->t_cwd, "/", sizeof(t->t_cwd));
+    t->t_taskid = task;
     list_insert(&task_table[TASKHASH(task)], &t->t_link);
     TASK_UNLOCK();
     *pt = t;
@@ -118,26 +171,39 @@ int task_alloc(task_t task, struct task** pt)
 
 /*
  * Free task and related resource.
+ * The task must be locked.
  */
 void task_free(struct task* t)
 {
+    int i;
 
     TASK_LOCK();
     list_remove(&t->t_link);
+    i = TASKCACHE(t->t_taskid);
+    if (task_cache[i] == t)
+        task_cache[i] = NULL;
+    t->t_taskid = TASK_NULL;
+    free(t->t_ofile);
+    t->t_ofile = NULL;
+    t->t_nofile = 0;
     mutex_unlock(&t->t_lock);
-    mutex_destroy(&t->t_lock);
-    free(t);
+    list_insert(&task_freelist, &t->t_link);
     TASK_UNLOCK();
 }
 
 /*
  * Set task id of the specified task.
+ * The task must be locked.
  */
 void task_setid(struct task* t, task_t task)
 {
+    int i;
 
     TASK_LOCK();
     list_remove(&t->t_link);
+    i = TASKCACHE(t->t_taskid);
+    if (task_cache[i] == t)
+        task_cache[i] = NULL;
     t->t_taskid = task;
     list_insert(&task_table[TASKHASH(task)], &t->t_link);
     TASK_UNLOCK();
@@ -159,7 +225,7 @@ void task_unlock(struct task* t)
 file_t task_getfp(struct task* t, int fd)
 {
 
-    if (fd < 0 || fd >= OPEN_MAX)
+    if (fd < 0 || fd >= t->t_nofile)
         return NULL;
 
     return t->t_ofile[fd];
@@ -167,11 +233,42 @@ file_t task_getfp(struct task* t, int fd)
 
 /*
  * Set file pointer for task/fd pair.
+ * The fd table must be large enough for fd.
  */
 void task_setfp(struct task* t, int fd, file_t fp)
 {
 
     t->t_ofile[fd] = fp;
+    if (fp == NULL && fd < t->t_freefd)
+        t->t_freefd = fd;
+}
+
+/*
+ * Grow the fd table of the task to hold the specified fd.
+ * The table is doubled in size up to OPEN_MAX entries.
+ */
+int task_growfd(struct task* t, int fd)
+{
+    file_t* ofile;
+    int size;
+
+    if (fd < t->t_nofile)
+        return 0;
+    if (fd < 0 || fd >= OPEN_MAX)
+        return EMFILE;
+
+    size = t->t_nofile;
+    while (size <= fd)
+        size *= 2;
+    if (size > OPEN_MAX)
+        size = OPEN_MAX;
+
+    if (!(ofile = realloc(t->t_ofile, sizeof(file_t) * size)))
+        return ENOMEM;
+    memset(&ofile[t->t_nofile], 0, sizeof(file_t) * (size - t->t_nofile));
+    t->t_ofile = ofile;
+    t->t_nofile = size;
+    return 0;
 }
 
 /*
@@ -185,13 +282,14 @@ int task_newfd(struct task* t)
     /*
      * Find the smallest empty slot in the fd array.
      */
-    for (fd = 0; fd < OPEN_MAX; fd++) {
+    for (fd = t->t_freefd; fd < t->t_nofile; fd++) {
         if (t->t_ofile[fd] == NULL)
             break;
     }
-    if (fd == OPEN_MAX)
+    if (fd == t->t_nofile && task_growfd(t, fd) != 0)
         return -1; /* slot full */
 
+    t->t_freefd = fd;
     return fd;
 }
 
@@ -202,6 +300,8 @@ void task_delfd(struct task* t, int fd)
 {
 
     t->t_ofile[fd] = NULL;
+    if (fd < t->t_freefd)
+        t->t_freefd = fd;
 }
 
 /*
@@ -297,4 +397,5 @@ void task_init(void)
 
     for (i = 0; i < TASK_MAXBUCKETS; i++)
         list_init(&task_table[i]);
+    list_init(&task_freelist);
 }
@@ -3,15 +3,33 @@ const c = ffi.raw;
 const std = @import("std");
 
 const TASK_MAXBUCKETS = 32;
+const TASK_CACHESIZE = 64;
+
+// Initial number of slots in the fd table. The table is doubled on
+// demand up to OPEN_MAX slots.
+const TASK_NOFILE = 16;
 
 fn TASKHASH(x: c.task_t) usize {
     return @intCast(x & (TASK_MAXBUCKETS - 1));
 }
 
+fn TASKCACHE(x: c.task_t) usize {
+    return @intCast((x ^ (x >> 6)) & (TASK_CACHESIZE - 1));
+}
+
 // FFI getters for global tables/locks to avoid NOMMU XIP relocation mismatch
 extern fn get_task_table() callconv(.c) [*]c.struct_list;
 extern fn get_task_lock() callconv(.c) *c.mutex_t;
 
+// Cache of recently used tasks.
+//
+// The cache is read without the global lock. A task structure is never
+// returned to malloc: a freed task goes to the free list and keeps its
+// mutex, so a stale cache entry always points to a valid structure. The
+// task id is checked again after the task is locked.
+extern fn get_task_cache() callconv(.c) [*]volatile ?*c.struct_task;
+extern fn get_task_freelist() callconv(.c) *c.struct_list;
+
 const has_threads = @hasDecl(c, "CONFIG_FS_THREADS") and c.CONFIG_FS_THREADS > 1;
 
 fn lockTaskTable() void {
@@ -28,49 +46,86 @@ fn unlockTaskTable() void {
 
 extern fn sec_file_permission(task: c.task_t, path: [*c]const u8, acc: c_int) callconv(.c) c_int;
 
+/// Convert task ID to a task structure.
+/// Returns locked task. Caller must unlock it after using it.
 pub export fn task_lookup(task: c.task_t) callconv(.c) ?*c.struct_task {
     if (task == 0) return null;
 
-    lockTaskTable();
-    const task_table = get_task_table();
-    const bucket = TASKHASH(task);
-    const list_head: *ffi.List = @ptrCast(&task_table[bucket]);
-    var n = list_head.next;
-    while (n != list_head) {
-        const next_node = n.?.next;
-        const t = n.?.entry(c.struct_task, "t_link");
+    // Fast path: look in the cache without the global lock.
+    const cache = get_task_cache();
+    if (cache[TASKCACHE(task)]) |t| {
         if (t.t_taskid == task) {
-            unlockTaskTable();
             _ = c.mutex_lock(&t.t_lock);
-            return t;
+            if (t.t_taskid == task) return t;
+            // The task was freed or reused while we waited.
+            _ = c.mutex_unlock(&t.t_lock);
         }
-        n = next_node;
     }
-    unlockTaskTable();
-    return null;
+
+    while (true) {
+        lockTaskTable();
+        const task_table = get_task_table();
+        const list_head: *ffi.List = @ptrCast(&task_table[TASKHASH(task)]);
+        var n = list_head.next;
+        const found: ?*c.struct_task = while (n != list_head) : (n = n.?.next) {
+            const t = n.?.entry(c.struct_task, "t_link");
+            if (t.t_taskid == task) break t;
+        } else null;
+
+        const t = found orelse {
+            unlockTaskTable();
+            return null;
+        };
+        cache[TASKCACHE(task)] = t;
+        unlockTaskTable();
+        _ = c.mutex_lock(&t.t_lock);
+        if (t.t_taskid == task) return t;
+        _ = c.mutex_unlock(&t.t_lock);
+    }
 }
 
 pub export fn task_alloc(task: c.task_t, pt: [*c]?*c.struct_task) callconv(.c) c_int {
-    if (task_lookup(task) != null) return ffi.prog.errno.EINVAL;
-
-    const mem = ffi.prog.stdlib.malloc(@sizeOf(c.struct_task)) orelse return ffi.prog.errno.ENOMEM;
-    const t: *c.struct_task = @ptrCast(@alignCast(mem));
-    @memset(@as([*]u8, @ptrCast(t))[0..@sizeOf(c.struct_task)], 0);
+    if (task_lookup(task)) |existing| {
+        _ = c.mutex_unlock(&existing.t_lock);
+        return ffi.prog.errno.EINVAL;
+    }
 
-    t.t_taskid = task;
-    _ = ffi.prog.string.strlcpy(@ptrCast(&t.t_cwd), "/", @sizeOf(@TypeOf(t.t_cwd)));
+    const ofile_mem = ffi.prog.stdlib.malloc(@sizeOf(c.file_t) * TASK_NOFILE) orelse return ffi.prog.errno.ENOMEM;
+    const ofile: [*c]c.file_t = @ptrCast(@alignCast(ofile_mem));
+    @memset(ofile[0..TASK_NOFILE], null);
 
-    if (has_threads) {
-        _ = c.mutex_init(&t.t_lock);
+    lockTaskTable();
+    const freelist: *ffi.List = @ptrCast(get_task_freelist());
+    var t: *c.struct_task = undefined;
+    if (!freelist.empty()) {
+        // Reuse a task structure. The mutex is still valid.
+        const link = freelist.first().?;
+        link.remove();
+        t = link.entry(c.struct_task, "t_link");
+    } else {
+        const mem = ffi.prog.stdlib.malloc(@sizeOf(c.struct_task)) orelse {
+            unlockTaskTable();
+            ffi.prog.stdlib.free(ofile_mem);
+            return ffi.prog.errno.ENOMEM;
+        };
+        t = @ptrCast(@alignCast(mem));
+        @memset(@as([*]u8, @ptrCast(t))[0..@sizeOf(c.struct_task)], 0);
+        if (has_threads) {
+            _ = c.mutex_init(&t.t_lock);
+        }
     }
 
-    const link: *ffi.List = @ptrCast(&t.t_link);
-    link.init();
+    t.t_cwdfp = null;
+    t.t_ofile = ofile;
+    t.t_nofile = TASK_NOFILE;
+    t.t_freefd = 0;
+    t.t_nopens = 0;
+    _ = ffi.prog.string.strlcpy(@ptrCast(&t.t_cwd), "/", @sizeOf(@TypeOf(t.t_cwd)));
+    t.t_taskid = task;
 
-    lockTaskTable();
+    const link: *ffi.List = @ptrCast(&t.t_link);
     const task_table = get_task_table();
-    const bucket = TASKHASH(task);
-    const list_head: *ffi.List = @ptrCast(&task_table[bucket]);
+    const list_head: *ffi.List = @ptrCast(&task_table[TASKHASH(task)]);
     list_head.insert(link);
     unlockTaskTable();
 
@@ -78,29 +133,38 @@ pub export fn task_alloc(task: c.task_t, pt: [*c]?*c.struct_task) callconv(.c) c
     return 0;
 }
 
+/// Free task and related resource. The task must be locked.
 pub export fn task_free(t: ?*c.struct_task) callconv(.c) void {
     if (t) |task_ptr| {
         lockTaskTable();
         const link: *ffi.List = @ptrCast(&task_ptr.t_link);
         link.remove();
+        const cache = get_task_cache();
+        const i = TASKCACHE(task_ptr.t_taskid);
+        if (cache[i] == task_ptr) cache[i] = null;
+        task_ptr.t_taskid = 0;
+        ffi.prog.stdlib.free(@ptrCast(task_ptr.t_ofile));
+        task_ptr.t_ofile = null;
+        task_ptr.t_nofile = 0;
         _ = c.mutex_unlock(&task_ptr.t_lock);
-        if (has_threads) {
-            _ = c.mutex_destroy(&task_ptr.t_lock);
-        }
-        ffi.prog.stdlib.free(task_ptr);
+        const freelist: *ffi.List = @ptrCast(get_task_freelist());
+        freelist.insert(link);
         unlockTaskTable();
     }
 }
 
+/// Set task id of the specified task. The task must be locked.
 pub export fn task_setid(t: ?*c.struct_task, task: c.task_t) callconv(.c) void {
     if (t) |task_ptr| {
         lockTaskTable();
         const link: *ffi.List = @ptrCast(&task_ptr.t_link);
         link.remove();
+        const cache = get_task_cache();
+        const i = TASKCACHE(task_ptr.t_taskid);
+        if (cache[i] == task_ptr) cache[i] = null;
         task_ptr.t_taskid = task;
         const task_table = get_task_table();
-        const bucket = TASKHASH(task);
-        const list_head: *ffi.List = @ptrCast(&task_table[bucket]);
+        const list_head: *ffi.List = @ptrCast(&task_table[TASKHASH(task)]);
         list_head.insert(link);
         unlockTaskTable();
     }
@@ -114,34 +178,60 @@ pub export fn task_unlock(t: ?*c.struct_task) callconv(.c) void {
 
 pub export fn task_getfp(t: ?*c.struct_task, fd: c_int) callconv(.c) c.file_t {
     if (t) |task_ptr| {
-        if (fd < 0 or fd >= c.OPEN_MAX) return null;
+        if (fd < 0 or fd >= task_ptr.t_nofile) return null;
         return task_ptr.t_ofile[@intCast(fd)];
     }
     return null;
 }
 
+// The fd table must be large enough for fd; see task_growfd().
 pub export fn task_setfp(t: ?*c.struct_task, fd: c_int, fp: c.file_t) callconv(.c) void {
     if (t) |task_ptr| {
-        if (fd >= 0 and fd < c.OPEN_MAX) {
+        if (fd >= 0 and fd < task_ptr.t_nofile) {
             task_ptr.t_ofile[@intCast(fd)] = fp;
+            if (fp == null and fd < task_ptr.t_freefd) task_ptr.t_freefd = fd;
         }
     }
 }
 
+// Grow the fd table of the task to hold the specified fd. The table is
+// doubled in size up to OPEN_MAX entries.
+pub export fn task_growfd(t: ?*c.struct_task, fd: c_int) callconv(.c) c_int {
+    const task_ptr = t orelse return ffi.prog.errno.EINVAL;
+    if (fd < task_ptr.t_nofile) return 0;
+    if (fd < 0 or fd >= c.OPEN_MAX) return ffi.prog.errno.EMFILE;
+
+    var size: c_int = task_ptr.t_nofile;
+    while (size <= fd) size *= 2;
+    if (size > c.OPEN_MAX) size = c.OPEN_MAX;
+
+    const mem = ffi.prog.stdlib.realloc(@ptrCast(task_ptr.t_ofile), @sizeOf(c.file_t) * @as(usize, @intCast(size))) orelse
+        return ffi.prog.errno.ENOMEM;
+    const ofile: [*c]c.file_t = @ptrCast(@alignCast(mem));
+    @memset(ofile[@intCast(task_ptr.t_nofile)..@intCast(size)], null);
+    task_ptr.t_ofile = ofile;
+    task_ptr.t_nofile = size;
+    return 0;
+}
+
+// Get the lowest free fd of the task, growing the table when it is
+// full. Returns -1 if there is no empty slot.
 pub export fn task_newfd(t: ?*c.struct_task) callconv(.c) c_int {
-    if (t) |task_ptr| {
-        var fd: c_int = 0;
-        while (fd < c.OPEN_MAX) : (fd += 1) {
-            if (task_ptr.t_ofile[@intCast(fd)] == null) return fd;
-        }
+    const task_ptr = t orelse return -1;
+    var fd: c_int = task_ptr.t_freefd;
+    while (fd < task_ptr.t_nofile) : (fd += 1) {
+        if (task_ptr.t_ofile[@intCast(fd)] == null) break;
     }
-    return -1;
+    if (fd == task_ptr.t_nofile and task_growfd(task_ptr, fd) != 0) return -1;
+    task_ptr.t_freefd = fd;
+    return fd;
 }
 
 pub export fn task_delfd(t: ?*c.struct_task, fd: c_int) callconv(.c) void {
     if (t) |task_ptr| {
-        if (fd >= 0 and fd < c.OPEN_MAX) {
+        if (fd >= 0 and fd < task_ptr.t_nofile) {
             task_ptr.t_ofile[@intCast(fd)] = null;
+            if (fd < task_ptr.t_freefd) task_ptr.t_freefd = fd;
         }
     }
 }
@@ -345,6 +345,18 @@ void vnode_poll_deregister(vnode_t vp, struct poll_listener* pl)
     }
 }
 
+/*
+ * Notify a poll listener.  The vnode lock keeps the fs server the
+ * single writer of the event ring.
+ */
+static void poll_notify(struct poll_listener* pl, short events)
+{
+
+    if (pl->emap != NULL)
+        event_post(&pl->emap->shm->ring[EVRING_FS], pl->slot, (u_int)events);
+    sem_post(&pl->sem);
+}
+
 /*
  * Signal all poll listeners for a specific event.
  */
@@ -359,12 +371,23 @@ void vnode_poll_signal(vnode_t vp, short events)
     for (n = list_first(&vp->v_poll_list); n != &vp->v_poll_list; n = list_next(n)) {
         pl = list_entry(n, struct poll_listener, link);
         if (pl->events & events) {
-            sem_post(&pl->sem);
+            poll_notify(pl, pl->events & events);
         }
     }
     VNODE_UNLOCK();
 }
 
+/*
+ * Post events to one listener.
+ */
+void vnode_poll_post(struct poll_listener* pl, short events)
+{
+
+    VNODE_LOCK();
+    poll_notify(pl, events);
+    VNODE_UNLOCK();
+}
+
 /*
  * Remove all vnode in the vnode table for unmount.
  */
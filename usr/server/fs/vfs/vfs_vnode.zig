@@ -243,6 +243,27 @@ pub export fn vnode_poll_deregister(vp: c.vnode_t, pl: *c.struct_poll_listener)
     }
 }
 
+// Queue an event to the fs ring of an epoll client. The vnode lock
+// makes this the single writer of the ring.
+fn eventPost(r: *c.struct_event_ring, slot: c_int, events: c_uint) void {
+    const head = @atomicLoad(c_uint, &r.head, .monotonic);
+    if (head -% @atomicLoad(c_uint, &r.tail, .acquire) >= c.EVRING_SIZE) {
+        @atomicStore(c_int, &r.overflow, 1, .release);
+        return;
+    }
+    r.ent[head & (c.EVRING_SIZE - 1)].slot = slot;
+    r.ent[head & (c.EVRING_SIZE - 1)].events = events;
+    @atomicStore(c_uint, &r.head, head +% 1, .release);
+}
+
+fn pollNotify(pl: *c.struct_poll_listener, events: c_short) void {
+    if (pl.emap != null) {
+        const em: *c.struct_event_map = pl.emap;
+        eventPost(&em.shm.*.ring[c.EVRING_FS], pl.slot, @as(u16, @bitCast(events)));
+    }
+    _ = c.sem_post(&pl.sem);
+}
+
 pub export fn vnode_poll_signal(vp: c.vnode_t, events: c_short) callconv(.c) void {
     const v: *c.struct_vnode = @ptrCast(vp.?);
     const poll_list: *ffi.List = @ptrCast(&v.v_poll_list);
@@ -251,14 +272,21 @@ pub export fn vnode_poll_signal(vp: c.vnode_t, events: c_short) callconv(.c) voi
     var n = poll_list.first();
     while (n != poll_list) {
         const pl: *c.struct_poll_listener = n.?.entry(c.struct_poll_listener, "link");
-        if (@as(c_short, @intCast(pl.events & @as(c_int, @intCast(events)))) != 0) {
-            _ = c.sem_post(&pl.sem);
+        const ev: c_short = pl.events & events;
+        if (ev != 0) {
+            pollNotify(pl, ev);
         }
         n = n.?.next;
     }
     vnodeUnlock();
 }
 
+pub export fn vnode_poll_post(pl: *c.struct_poll_listener, events: c_short) callconv(.c) void {
+    vnodeLock();
+    pollNotify(pl, events);
+    vnodeUnlock();
+}
+
 pub export fn vflush(mp: c.mount_t) callconv(.c) void {
     _ = mp;
     const table = get_vnode_table();
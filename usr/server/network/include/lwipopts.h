@@ -45,8 +45,9 @@
 #define LWIP_DHCP_AUTOIP_COOP_TRIES 3
 #define LWIP_SO_RCVTIMEO 1
 
+/* Socket descriptors start at SOCKET_FDBASE in <sys/posix.h> */
 #ifndef LWIP_SOCKET_OFFSET
-#define LWIP_SOCKET_OFFSET 0
+#define LWIP_SOCKET_OFFSET 1024
 #endif
 
 #ifdef FD_SETSIZE
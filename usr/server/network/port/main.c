@@ -40,56 +40,245 @@
 #include <sys/list.h>
 #include <ipc/ipc.h>
 #include <ipc/network.h>
+#include <ipc/exec.h>
+#include <ipc/fs.h>
+#include <ipc/event.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "resolv.h"
+
 extern err_t prex_netif_init(struct netif *netif);
 
+/*
+ * Number of threads serving requests.  A blocking send, recv or
+ * accept occupies a thread, so more than one is needed for a peer
+ * on the loopback interface to make progress.
+ */
+#define NET_THREADS 4
+
+/*
+ * A name lookup also occupies a thread while it waits for the name
+ * server, so the pool grows up to NET_MAXTHREADS to keep a thread
+ * free for other requests.
+ */
+#define NET_MAXTHREADS 8
+
+/* Size of the file buffer of each thread for sendfile */
+#define SENDFILE_BUFSZ (64 * 1024)
+
 static struct netif prex_netif;
 static object_t net_obj;
+static object_t fs_obj;
+static int net_nthreads = NET_THREADS;
+static int net_resolving;  /* threads in a name lookup */
+
+/*
+ * Event area of an epoll instance mapped from a client
+ */
+struct net_event_map {
+    struct list link;
+    task_t task;
+    void *uaddr;
+    struct event_shm *shm;
+    int refcnt;
+};
+static struct list event_maps = LIST_INIT(event_maps);
 
 struct net_poll_listener {
     struct list link;
     sem_t sem;
     int fd;
     short events;
+    struct net_event_map *emap;   /* event area, or NULL for poll() */
+    int slot;                     /* slot in the event area */
+    task_t task;                  /* client task */
 };
-static struct list poll_listeners = LIST_INIT(poll_listeners);
+
+/*
+ * Poll listeners of each socket.  They are only touched with the
+ * lwIP core lock held, so the callback below is the single writer
+ * of the event rings.
+ */
+static struct list poll_listeners[MEMP_NUM_NETCONN];
+
+#define SOCK_INDEX(s) ((s) - LWIP_SOCKET_OFFSET)
+#define SOCK_VALID(s) ((s) >= LWIP_SOCKET_OFFSET && (s) < LWIP_SOCKET_OFFSET + MEMP_NUM_NETCONN)
 
 static netconn_callback original_callbacks[MEMP_NUM_NETCONN];
 
+static short sock_revents(struct lwip_sock *sock) {
+    short revents = 0;
+
+    if (sock->rcvevent > 0)
+        revents |= POLLIN;
+    if (sock->sendevent != 0)
+        revents |= POLLOUT;
+    if (sock->errevent != 0)
+        revents |= POLLERR;
+    return revents;
+}
+
+static void poll_notify(struct net_poll_listener *pl, short events) {
+    if (pl->emap != NULL)
+        event_post(&pl->emap->shm->ring[EVRING_NET], pl->slot, (u_int)events);
+    sem_post(&pl->sem);
+}
+
 static void my_netconn_callback(struct netconn *conn, enum netconn_evt evt, u16_t len) {
     int s = conn->callback_arg.socket;
-    if (s >= LWIP_SOCKET_OFFSET && s < LWIP_SOCKET_OFFSET + MEMP_NUM_NETCONN) {
-        netconn_callback orig = original_callbacks[s - LWIP_SOCKET_OFFSET];
-        if (orig) {
-            orig(conn, evt, len);
-        }
+    if (!SOCK_VALID(s))
+        return;
+
+    netconn_callback orig = original_callbacks[SOCK_INDEX(s)];
+    if (orig) {
+        orig(conn, evt, len);
     }
 
     struct lwip_sock *sock = lwip_socket_dbg_get_socket(s);
     if (sock) {
-        int has_recvevent = sock->rcvevent > 0;
-        int has_sendevent = sock->sendevent != 0;
-        int has_errevent = sock->errevent != 0;
-
+        short revents = sock_revents(sock);
+        list_t head = &poll_listeners[SOCK_INDEX(s)];
         list_t n;
         struct net_poll_listener *pl;
-        for (n = list_first(&poll_listeners); n != &poll_listeners; n = list_next(n)) {
+        for (n = list_first(head); n != head; n = list_next(n)) {
             pl = list_entry(n, struct net_poll_listener, link);
-            if (pl->fd == s) {
-                int signal = 0;
-                if (has_recvevent && (pl->events & POLLIN)) signal = 1;
-                if (has_sendevent && (pl->events & POLLOUT)) signal = 1;
-                if (has_errevent && (pl->events & POLLERR)) signal = 1;
-                if (signal) {
-                    sem_post(&pl->sem);
-                }
-            }
+            if (revents & pl->events)
+                poll_notify(pl, revents & pl->events);
+        }
+    }
+}
+
+/*
+ * Get the event area of a client, mapping it on first use.
+ * Called with the core lock held.
+ */
+static struct net_event_map *event_map_get(task_t task, void *uaddr) {
+    struct net_event_map *em;
+    list_t n;
+    void *kaddr;
+
+    for (n = list_first(&event_maps); n != &event_maps; n = list_next(n)) {
+        em = list_entry(n, struct net_event_map, link);
+        if (em->task == task && em->uaddr == uaddr) {
+            em->refcnt++;
+            return em;
+        }
+    }
+    if ((em = malloc(sizeof(*em))) == NULL)
+        return NULL;
+    if (vm_map(task, uaddr, sizeof(struct event_shm), &kaddr) != 0) {
+        free(em);
+        return NULL;
+    }
+    em->task = task;
+    em->uaddr = uaddr;
+    em->shm = kaddr;
+    em->refcnt = 1;
+    list_insert(&event_maps, &em->link);
+    return em;
+}
+
+static void poll_remove(struct net_poll_listener *pl) {
+    struct net_event_map *em = pl->emap;
+
+    list_remove(&pl->link);
+    if (em != NULL && --em->refcnt == 0) {
+        list_remove(&em->link);
+        vm_free(task_self(), em->shm);
+        free(em);
+    }
+    free(pl);
+}
+
+/*
+ * Remove all listeners of a semaphore, or one slot of it.
+ */
+static void poll_deregister(sem_t sem, int slot) {
+    list_t head, n, next;
+    struct net_poll_listener *pl;
+
+    LOCK_TCPIP_CORE();
+    for (int i = 0; i < MEMP_NUM_NETCONN; i++) {
+        head = &poll_listeners[i];
+        for (n = list_first(head); n != head; n = next) {
+            next = list_next(n);
+            pl = list_entry(n, struct net_poll_listener, link);
+            if (pl->sem == sem && (slot < 0 || (pl->emap != NULL && pl->slot == slot)))
+                poll_remove(pl);
+        }
+    }
+    UNLOCK_TCPIP_CORE();
+}
+
+/*
+ * Remove all listeners of a terminating client.  This also unmaps
+ * its event areas, which must not be written once the task is gone.
+ */
+static void net_exit(task_t task) {
+    list_t head, n, next;
+    struct net_poll_listener *pl;
+
+    LOCK_TCPIP_CORE();
+    for (int i = 0; i < MEMP_NUM_NETCONN; i++) {
+        head = &poll_listeners[i];
+        for (n = list_first(head); n != head; n = next) {
+            next = list_next(n);
+            pl = list_entry(n, struct net_poll_listener, link);
+            if (pl->task == task)
+                poll_remove(pl);
         }
     }
+    UNLOCK_TCPIP_CORE();
+}
+
+/*
+ * Add or remove a persistent listener for epoll.
+ */
+static int net_event_ctl(struct event_msg *em) {
+    struct net_poll_listener *pl;
+    struct lwip_sock *sock;
+    short revents;
+
+    if (em->op == EVENT_DEL) {
+        poll_deregister(em->sem, em->slot);
+        return 0;
+    }
+    if (em->op != EVENT_ADD)
+        return EINVAL;
+    if (!SOCK_VALID(em->fd))
+        return EBADF;
+    if ((pl = malloc(sizeof(*pl))) == NULL)
+        return ENOMEM;
+
+    LOCK_TCPIP_CORE();
+    if ((sock = lwip_socket_dbg_get_socket(em->fd)) == NULL) {
+        UNLOCK_TCPIP_CORE();
+        free(pl);
+        return EBADF;
+    }
+    if ((pl->emap = event_map_get(em->hdr.task, em->shm)) == NULL) {
+        UNLOCK_TCPIP_CORE();
+        free(pl);
+        return EFAULT;
+    }
+    pl->sem = em->sem;
+    pl->fd = em->fd;
+    pl->events = (short)em->events;
+    pl->slot = em->slot;
+    pl->task = em->hdr.task;
+    list_insert(&poll_listeners[SOCK_INDEX(em->fd)], &pl->link);
+
+    /* Report the current state */
+    revents = sock_revents(sock) & pl->events;
+    if (revents)
+        poll_notify(pl, revents);
+    UNLOCK_TCPIP_CORE();
+
+    em->polled = 0;
+    return 0;
 }
 
 static void tcpip_init_done(void *arg) {
@@ -125,38 +314,142 @@ static void ip_monitor(void *arg) {
     }
 }
 
-int main(int argc, char **argv) {
-    sys_sem_t init_sem;
-    struct net_msg m;
+/*
+ * Get the data buffer of a socket request.  Small data is carried in
+ * the message, and larger user buffers are mapped from the client.
+ */
+static int net_getbuf(struct net_msg *m, void **buf) {
+    if (m->buf == NULL) {
+        if (m->len > NET_INLINE)
+            return EINVAL;
+        *buf = m->data;
+        return 0;
+    }
+    return vm_map(m->hdr.task, m->buf, m->len, buf);
+}
 
-    //sys_log("Network server starting...\n");
+static void net_putbuf(struct net_msg *m, void *buf) {
+    if (m->buf != NULL)
+        vm_free(task_self(), buf);
+}
 
-    if (object_create(OBJNAME_NETWORK, &net_obj) != 0) {
-        fprintf(stderr, "network: failed to create object\n");
-        return 1;
+/*
+ * Hook the netconn callback of a new socket to wake up pollers.
+ */
+static void net_hook(int s) {
+    struct lwip_sock *sock;
+
+    if (!SOCK_VALID(s))
+        return;
+    LOCK_TCPIP_CORE();
+    sock = lwip_socket_dbg_get_socket(s);
+    if (sock && sock->conn) {
+        original_callbacks[SOCK_INDEX(s)] = sock->conn->callback;
+        sock->conn->callback = my_netconn_callback;
     }
+    UNLOCK_TCPIP_CORE();
+}
 
-    // Intercept socket callbacks dynamically inside NET_SOCKET
+/*
+ * Send a file of the client to a socket.  The fs server reads the
+ * file into the buffer of this thread, and lwIP takes the data from
+ * there.  The client does not see the data at all.
+ */
+static int net_sendfile(struct net_msg *m, char *buf) {
+    struct splice_msg sm;
+    size_t left, total = 0;
+    ssize_t n;
+    int error = 0;
 
-    if (sys_sem_new(&init_sem, 0) != ERR_OK) return 1;
-    tcpip_init(tcpip_init_done, &init_sem);
-    sys_arch_sem_wait(&init_sem, 0);
-    sys_sem_free(&init_sem);
+    if (buf == NULL)
+        return ENOMEM;
+    if (fs_obj == 0 && object_lookup("!fs", &fs_obj) != 0)
+        return ENOSYS;
 
-    if (netif_add(&prex_netif, NULL, NULL, NULL, NULL, prex_netif_init, tcpip_input) == NULL) {
-        //sys_log("network: failed to add netif\n");
-        return 1;
+    for (left = m->len; left > 0; left -= (size_t)n) {
+        sm.hdr.code = FS_SPLICE;
+        sm.owner = m->hdr.task;
+        sm.fd = m->fd;
+        sm.offset = m->offset + (off_t)total;
+        sm.buf = buf;
+        sm.size = (left < SENDFILE_BUFSZ) ? left : SENDFILE_BUFSZ;
+        if (msg_send(fs_obj, &sm, sizeof(sm)) != 0) {
+            error = EIO;
+            break;
+        }
+        if ((error = sm.hdr.status) != 0 || sm.size == 0)
+            break;
+        if ((n = lwip_send(m->socket, buf, sm.size, m->flags)) < 0) {
+            error = errno;
+            break;
+        }
+        total += (size_t)n;
+        if ((size_t)n < sm.size)
+            break;
     }
-    netif_set_default(&prex_netif);
+    m->len = total;
+    return (total > 0) ? 0 : error;
+}
 
-    netif_set_up(&prex_netif);
+static void net_thread(void *arg);
 
-    //sys_log("network: starting DHCP...\n");
-    dhcp_start(&prex_netif);
+static int net_resolve(struct net_msg *m) {
+    uint32_t addr[NET_MAXADDRS];
+    char host[NET_INLINE];
+    int error, n = 0, grow = 0;
 
-    //sys_log("Network server initialized\n");
+    m->data[NET_INLINE - 1] = '\0';
+    strlcpy(host, m->data, sizeof(host));
 
-    sys_thread_new("ip_monitor", ip_monitor, NULL, 4096, 0);
+    LOCK_TCPIP_CORE();
+    if (++net_resolving >= net_nthreads - 1 && net_nthreads < NET_MAXTHREADS) {
+        net_nthreads++;
+        grow = 1;
+    }
+    UNLOCK_TCPIP_CORE();
+    if (grow)
+        sys_thread_new("net_thread", net_thread, NULL, DEFAULT_THREAD_STACKSIZE, 0);
+
+    error = res_lookup(host, addr, &n);
+
+    LOCK_TCPIP_CORE();
+    net_resolving--;
+    UNLOCK_TCPIP_CORE();
+
+    if (error == 0) {
+        memcpy(m->data, addr, sizeof(uint32_t) * (size_t)n);
+        m->len = (size_t)n;
+    }
+    return error;
+}
+
+/*
+ * Request the capabilities to map client buffers.
+ */
+static void bind_cap(void) {
+    struct bind_msg bm;
+    object_t execobj;
+    int i;
+
+    for (i = 0; i < 100; i++) {
+        if (object_lookup("!exec", &execobj) == 0) {
+            bm.hdr.code = EXEC_BINDCAP;
+            strlcpy(bm.path, "/boot/network", sizeof(bm.path));
+            msg_send(execobj, &bm, sizeof(bm));
+            return;
+        }
+        timer_sleep(10, 0);
+    }
+    fprintf(stderr, "network: exec server not found\n");
+}
+
+static void net_thread(void *arg) {
+    struct net_msg m;
+    void *buf, *fbuf;
+    ssize_t n;
+
+    if (vm_allocate(task_self(), &fbuf, SENDFILE_BUFSZ, 1) != 0)
+        fbuf = NULL;
 
     for (;;) {
         if (msg_receive(net_obj, &m, sizeof(m)) != 0)
@@ -166,13 +459,8 @@ int main(int argc, char **argv) {
         case NET_SOCKET:
             m.socket = lwip_socket(m.domain, m.type, m.protocol);
             m.hdr.status = (m.socket < 0) ? errno : 0;
-            if (m.socket >= 0) {
-                struct lwip_sock *sock = lwip_socket_dbg_get_socket(m.socket);
-                if (sock && sock->conn) {
-                    original_callbacks[m.socket - LWIP_SOCKET_OFFSET] = sock->conn->callback;
-                    sock->conn->callback = my_netconn_callback;
-                }
-            }
+            if (m.socket >= 0)
+                net_hook(m.socket);
             break;
         case NET_BIND:
             m.hdr.status = lwip_bind(m.socket, &m.addr, m.addrlen);
@@ -182,29 +470,51 @@ int main(int argc, char **argv) {
             m.hdr.status = lwip_connect(m.socket, &m.addr, m.addrlen);
             if (m.hdr.status < 0) m.hdr.status = errno;
             break;
-        case NET_SEND:
-            m.len = lwip_send(m.socket, m.data, m.len, m.flags);
-            m.hdr.status = (m.len < 0) ? errno : 0;
+        case NET_LISTEN:
+            m.hdr.status = lwip_listen(m.socket, m.backlog);
+            if (m.hdr.status < 0) m.hdr.status = errno;
             break;
-        case NET_RECV:
-            m.len = lwip_recv(m.socket, m.data, m.len, m.flags);
-            m.hdr.status = (m.len < 0) ? errno : 0;
+        case NET_ACCEPT:
+            if (m.addrlen > sizeof(m.addr)) m.addrlen = sizeof(m.addr);
+            m.socket = lwip_accept(m.socket, &m.addr, &m.addrlen);
+            m.hdr.status = (m.socket < 0) ? errno : 0;
+            if (m.socket >= 0)
+                net_hook(m.socket);
             break;
+        case NET_SEND:
+        case NET_RECV:
         case NET_SENDTO:
-            m.len = lwip_sendto(m.socket, m.data, m.len, m.flags, &m.addr, m.addrlen);
-            m.hdr.status = (m.len < 0) ? errno : 0;
-            break;
         case NET_RECVFROM:
-            m.len = lwip_recvfrom(m.socket, m.data, m.len, m.flags, &m.addr, &m.addrlen);
-            m.hdr.status = (m.len < 0) ? errno : 0;
+            if (m.addrlen > sizeof(m.addr)) m.addrlen = sizeof(m.addr);
+            if ((m.hdr.status = net_getbuf(&m, &buf)) != 0)
+                break;
+            if (m.hdr.code == NET_SEND)
+                n = lwip_send(m.socket, buf, m.len, m.flags);
+            else if (m.hdr.code == NET_RECV)
+                n = lwip_recv(m.socket, buf, m.len, m.flags);
+            else if (m.hdr.code == NET_SENDTO)
+                n = lwip_sendto(m.socket, buf, m.len, m.flags, &m.addr, m.addrlen);
+            else
+                n = lwip_recvfrom(m.socket, buf, m.len, m.flags, &m.addr, &m.addrlen);
+            m.hdr.status = (n < 0) ? errno : 0;
+            m.len = (n < 0) ? 0 : (size_t)n;
+            net_putbuf(&m, buf);
+            break;
+        case NET_SENDFILE:
+            m.hdr.status = net_sendfile(&m, fbuf);
             break;
         case NET_SHUTDOWN:
             m.hdr.status = lwip_shutdown(m.socket, m.flags);
             if (m.hdr.status < 0) m.hdr.status = errno;
             break;
         case NET_CLOSE:
-            if (m.socket >= LWIP_SOCKET_OFFSET && m.socket < LWIP_SOCKET_OFFSET + MEMP_NUM_NETCONN) {
-                original_callbacks[m.socket - LWIP_SOCKET_OFFSET] = NULL;
+            if (SOCK_VALID(m.socket)) {
+                list_t head = &poll_listeners[SOCK_INDEX(m.socket)];
+                LOCK_TCPIP_CORE();
+                original_callbacks[SOCK_INDEX(m.socket)] = NULL;
+                while (!list_empty(head))
+                    poll_remove(list_entry(list_first(head), struct net_poll_listener, link));
+                UNLOCK_TCPIP_CORE();
             }
             m.hdr.status = lwip_close(m.socket);
             if (m.hdr.status < 0) m.hdr.status = errno;
@@ -256,51 +566,56 @@ int main(int argc, char **argv) {
             }
             break;
         case NET_RESOLVE:
-            {
-                char hostname[256];
-                strncpy(hostname, m.data, 255);
-                hostname[255] = '\0';
-                
-                struct hostent *he = lwip_gethostbyname(hostname);
-                if (he && he->h_addr_list[0]) {
-                    uint32_t *ip_out = (uint32_t *)m.data;
-                    memcpy(ip_out, he->h_addr_list[0], 4);
-                    m.hdr.status = 0;
-                } else {
-                    m.hdr.status = EHOSTUNREACH;
-                }
+            m.hdr.status = net_resolve(&m);
+            break;
+        case NET_DNSCONF:
+            if (task_chkcap(m.hdr.task, CAP_NETWORK) != 0) {
+                m.hdr.status = EPERM;
+                break;
             }
+            res_config((struct sockaddr_in *)&m.addr);
+            m.hdr.status = 0;
+            break;
+        case NET_DNSSTAT:
+            res_getstat((struct net_dnsstat *)m.data);
+            m.hdr.status = 0;
             break;
         case NET_POLL_REGISTER:
             {
                 struct net_poll_msg *pm = (struct net_poll_msg *)&m;
+                LOCK_TCPIP_CORE();
                 for (int i = 0; i < pm->nfds; i++) {
+                    if (!SOCK_VALID(pm->fds[i].fd))
+                        continue;
                     struct net_poll_listener *pl = malloc(sizeof(*pl));
                     if (pl) {
                         pl->sem = pm->sem_id;
                         pl->fd = pm->fds[i].fd;
                         pl->events = pm->fds[i].events;
-                        list_insert(&poll_listeners, &pl->link);
+                        pl->emap = NULL;
+                        pl->slot = 0;
+                        pl->task = pm->hdr.task;
+                        list_insert(&poll_listeners[SOCK_INDEX(pl->fd)], &pl->link);
                     }
                 }
+                UNLOCK_TCPIP_CORE();
                 pm->hdr.status = 0;
             }
             break;
         case NET_POLL_DEREGISTER:
             {
                 struct net_poll_msg *pm = (struct net_poll_msg *)&m;
-                list_t n, next;
-                for (n = list_first(&poll_listeners); n != &poll_listeners; n = next) {
-                    next = list_next(n);
-                    struct net_poll_listener *pl = list_entry(n, struct net_poll_listener, link);
-                    if (pl->sem == pm->sem_id) {
-                        list_remove(&pl->link);
-                        free(pl);
-                    }
-                }
+                poll_deregister(pm->sem_id, -1);
                 pm->hdr.status = 0;
             }
             break;
+        case NET_EVENT_CTL:
+            m.hdr.status = net_event_ctl((struct event_msg *)&m);
+            break;
+        case NET_EXIT:
+            net_exit(m.hdr.task);
+            m.hdr.status = 0;
+            break;
         case NET_POLL_QUERY:
             {
                 struct net_poll_msg *pm = (struct net_poll_msg *)&m;
@@ -332,6 +647,50 @@ int main(int argc, char **argv) {
 
         msg_reply(net_obj, &m, sizeof(m));
     }
+}
+
+int main(int argc, char **argv) {
+    sys_sem_t init_sem;
+
+    //sys_log("Network server starting...\n");
+
+    for (int i = 0; i < MEMP_NUM_NETCONN; i++)
+        list_init(&poll_listeners[i]);
+
+    if (object_create(OBJNAME_NETWORK, &net_obj) != 0) {
+        fprintf(stderr, "network: failed to create object\n");
+        return 1;
+    }
+
+    // Intercept socket callbacks dynamically inside NET_SOCKET
+
+    if (sys_sem_new(&init_sem, 0) != ERR_OK) return 1;
+    tcpip_init(tcpip_init_done, &init_sem);
+    sys_arch_sem_wait(&init_sem, 0);
+    sys_sem_free(&init_sem);
+
+    if (netif_add(&prex_netif, NULL, NULL, NULL, NULL, prex_netif_init, tcpip_input) == NULL) {
+        //sys_log("network: failed to add netif\n");
+        return 1;
+    }
+    netif_set_default(&prex_netif);
+
+    netif_set_up(&prex_netif);
+
+    //sys_log("network: starting DHCP...\n");
+    dhcp_start(&prex_netif);
+
+    //sys_log("Network server initialized\n");
+
+    sys_thread_new("ip_monitor", ip_monitor, NULL, 4096, 0);
+
+    res_init();
+
+    bind_cap();
+
+    for (int i = 1; i < NET_THREADS; i++)
+        sys_thread_new("net_thread", net_thread, NULL, DEFAULT_THREAD_STACKSIZE, 0);
+    net_thread(NULL);
 
     return 0;
 }
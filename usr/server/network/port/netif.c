@@ -36,12 +36,16 @@
 #include "netif/etharp.h"
 
 #include <sys/prex.h>
+#include <sys/netio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #define IFNAME0 'e'
 #define IFNAME1 't'
 
+#define RX_BATCH_SIZE (16 * 1024)
+
 struct prex_netif {
     device_t dev;
 };
@@ -59,26 +63,50 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p) {
     return ERR_OK;
 }
 
+static void input_frame(struct netif *netif, const void *data, size_t len) {
+    struct pbuf *p;
+
+    p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+    if (p) {
+        pbuf_take(p, data, len);
+        if (netif->input(p, netif) != ERR_OK) {
+            pbuf_free(p);
+        }
+    }
+}
+
 static void input_thread(void *arg) {
     struct netif *netif = arg;
     struct prex_netif *px = netif->state;
-    size_t len;
-    struct pbuf *p;
-    char *rx_buf = malloc(2048);
+    struct net_rxbatch rb;
+    struct net_frame *nf;
+    size_t len, off;
+    int i, error;
+    char *rx_buf = malloc(RX_BATCH_SIZE);
 
     if (!rx_buf) return;
 
     for (;;) {
-        len = 2048;
-        if (device_read(px->dev, rx_buf, &len, 0) == 0 && len > 0) {
-            p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
-            if (p) {
-                pbuf_take(p, rx_buf, len);
-                if (netif->input(p, netif) != ERR_OK) {
-                    pbuf_free(p);
-                }
+        /* Take all pending frames with one request */
+        rb.buf = rx_buf;
+        rb.size = RX_BATCH_SIZE;
+        error = device_ioctl(px->dev, NETIO_RXBATCH, &rb);
+        if (error == 0) {
+            off = 0;
+            for (i = 0; i < rb.nframes; i++) {
+                nf = (struct net_frame *)(rx_buf + off);
+                input_frame(netif, nf + 1, nf->nf_len);
+                off += NET_FRAME_SIZE(nf->nf_len);
             }
+            continue;
         }
+        if (error == EINTR)
+            continue;
+
+        /* Driver without batched receive: one frame per read */
+        len = RX_BATCH_SIZE;
+        if (device_read(px->dev, rx_buf, &len, 0) == 0 && len > 0)
+            input_frame(netif, rx_buf, len);
     }
 }
 
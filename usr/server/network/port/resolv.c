@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * resolv.c - DNS stub resolver with a cache.
+ *
+ * Queries are sent with the raw UDP API of lwIP, and answers are
+ * handled by the receive callback in the tcpip thread, so resolution
+ * never holds a request thread on the network.  A request thread only
+ * sleeps until its name is resolved, and concurrent lookups of one
+ * name share a single query.
+ *
+ * Answers are cached for their TTL, and names which do not exist for
+ * the SOA minimum TTL (RFC 2308).  Failures are not cached.  All state
+ * is protected by the lwIP core lock.
+ */
+
+#include "lwipopts.h"
+#include "lwip/udp.h"
+#include "lwip/dns.h"
+#include "lwip/pbuf.h"
+#include "lwip/timeouts.h"
+#include "lwip/tcpip.h"
+#include "lwip/sys.h"
+
+#include <sys/prex.h>
+#include <sys/list.h>
+#include <errno.h>
+#include <string.h>
+
+#include "resolv.h"
+
+#define RES_CACHE       64      /* cached names */
+#define RES_TIMEOUT     2000    /* msec per try */
+#define RES_TRIES       3       /* tries per query */
+#define RES_NEGTTL      60      /* sec, negative answer without SOA */
+#define RES_MAXTTL      3600    /* sec */
+#define RES_PKTSIZE     512     /* max UDP message */
+#define RES_HOSTSIZE    256     /* max host name */
+
+/* Entry state */
+#define RES_FREE        0
+#define RES_PENDING     1       /* query in progress */
+#define RES_FOUND       2       /* addresses */
+#define RES_NOTFOUND    3       /* name or address does not exist */
+
+#define DNS_PORT        53
+#define DNS_TYPE_A      1
+#define DNS_TYPE_SOA    6
+#define DNS_CLASS_IN    1
+#define DNS_RCODE_NXDOMAIN 3
+
+struct res_waiter {
+    struct list link;
+    sys_sem_t sem;
+    int error;
+    int naddr;
+    uint32_t addr[NET_MAXADDRS];
+};
+
+struct res_entry {
+    int state;
+    char name[RES_HOSTSIZE];
+    u32_t expire;               /* sys_now() when stale */
+    u32_t used;                 /* last use, for replacement */
+    u16_t id;                   /* query id while pending */
+    int tries;
+    int naddr;
+    uint32_t addr[NET_MAXADDRS];
+    struct list waiters;        /* threads waiting for the answer */
+};
+
+static struct res_entry res_cache[RES_CACHE];
+static struct udp_pcb *res_pcb;
+static ip_addr_t res_server;    /* configured name server */
+static u16_t res_port;          /* 0 for the server from DHCP */
+static u16_t res_id;
+static struct net_dnsstat res_stat;
+
+static void res_timeout(void *);
+
+static int expired(struct res_entry *e, u32_t now)
+{
+    return (s32_t)(now - e->expire) >= 0;
+}
+
+static struct res_entry *res_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < RES_CACHE; i++) {
+        if (res_cache[i].state != RES_FREE &&
+            strcasecmp(res_cache[i].name, name) == 0)
+            return &res_cache[i];
+    }
+    return NULL;
+}
+
+/*
+ * Get a free entry, or replace the least recently used one.
+ */
+static struct res_entry *res_alloc(void)
+{
+    struct res_entry *e, *victim = NULL;
+    u32_t now = sys_now();
+    int i;
+
+    for (i = 0; i < RES_CACHE; i++) {
+        e = &res_cache[i];
+        if (e->state == RES_FREE)
+            return e;
+        if (e->state == RES_PENDING)
+            continue;
+        if (expired(e, now))
+            return e;
+        if (victim == NULL || (s32_t)(e->used - victim->used) < 0)
+            victim = e;
+    }
+    return victim;
+}
+
+/*
+ * Encode a host name as DNS labels.
+ */
+static int res_encode(const char *name, u8_t *buf)
+{
+    const char *p;
+    int len = 0, n;
+
+    while (*name != '\0') {
+        for (p = name; *p != '\0' && *p != '.'; p++)
+            ;
+        n = (int)(p - name);
+        if (n == 0 || n > 63 || len + n + 2 > RES_HOSTSIZE)
+            return -1;
+        buf[len++] = (u8_t)n;
+        memcpy(&buf[len], name, (size_t)n);
+        len += n;
+        name = (*p == '.') ? p + 1 : p;
+    }
+    buf[len++] = 0;
+    return len;
+}
+
+static int res_send(struct res_entry *e)
+{
+    u8_t pkt[RES_PKTSIZE];
+    const ip_addr_t *server;
+    struct pbuf *p;
+    u16_t port;
+    int len, n;
+
+    if (res_pcb == NULL)
+        return ENETDOWN;
+    if (res_port != 0) {
+        server = &res_server;
+        port = res_port;
+    } else {
+        server = dns_getserver(0);
+        port = DNS_PORT;
+        if (server == NULL || ip_addr_isany(server))
+            return EHOSTUNREACH;
+    }
+
+    memset(pkt, 0, 12);
+    pkt[0] = (u8_t)(e->id >> 8);
+    pkt[1] = (u8_t)e->id;
+    pkt[2] = 0x01;              /* recursion desired */
+    pkt[5] = 1;                 /* one question */
+    if ((n = res_encode(e->name, &pkt[12])) < 0)
+        return EINVAL;
+    len = 12 + n;
+    pkt[len++] = 0;
+    pkt[len++] = DNS_TYPE_A;
+    pkt[len++] = 0;
+    pkt[len++] = DNS_CLASS_IN;
+
+    if ((p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)len, PBUF_RAM)) == NULL)
+        return ENOMEM;
+    memcpy(p->payload, pkt, (size_t)len);
+    udp_sendto(res_pcb, p, server, port);
+    pbuf_free(p);
+    sys_timeout(RES_TIMEOUT, res_timeout, e);
+    return 0;
+}
+
+/*
+ * Finish a query and wake up the waiters.
+ */
+static void res_done(struct res_entry *e, int error, u32_t ttl)
+{
+    struct res_waiter *w;
+    u32_t now = sys_now();
+
+    sys_untimeout(res_timeout, e);
+
+    if (ttl > RES_MAXTTL)
+        ttl = RES_MAXTTL;
+    e->used = now;
+    e->expire = now + ttl * 1000;
+    if (error == 0)
+        e->state = RES_FOUND;
+    else if (error == ENOENT)
+        e->state = RES_NOTFOUND;
+    else
+        e->state = RES_FREE;
+
+    while (!list_empty(&e->waiters)) {
+        w = list_entry(list_first(&e->waiters), struct res_waiter, link);
+        list_remove(&w->link);
+        w->error = error;
+        w->naddr = (error == 0) ? e->naddr : 0;
+        memcpy(w->addr, e->addr, sizeof(w->addr));
+        sys_sem_signal(&w->sem);
+    }
+}
+
+static void res_timeout(void *arg)
+{
+    struct res_entry *e = arg;
+
+    if (e->state != RES_PENDING)
+        return;
+    if (++e->tries < RES_TRIES) {
+        res_stat.retries++;
+        if (res_send(e) == 0)
+            return;
+    }
+    res_stat.timeouts++;
+    res_done(e, ETIMEDOUT, 0);
+}
+
+/*
+ * Skip a name in a message.  Returns the offset after it, or -1.
+ */
+static int res_skipname(const u8_t *pkt, int len, int off)
+{
+    int n;
+
+    while (off < len) {
+        n = pkt[off];
+        if (n == 0)
+            return off + 1;
+        if ((n & 0xc0) == 0xc0)
+            return (off + 2 <= len) ? off + 2 : -1;
+        if (n & 0xc0)
+            return -1;
+        off += n + 1;
+    }
+    return -1;
+}
+
+static u32_t get32(const u8_t *p)
+{
+    return ((u32_t)p[0] << 24) | ((u32_t)p[1] << 16) | ((u32_t)p[2] << 8) | p[3];
+}
+
+/*
+ * Parse an answer for entry e.
+ */
+static void res_answer(struct res_entry *e, const u8_t *pkt, int len)
+{
+    int off, i, qd, an, ns, type, class, rdlen, rcode, n;
+    u32_t ttl, minttl = RES_MAXTTL, negttl = RES_NEGTTL;
+    u8_t q[RES_HOSTSIZE + 2];
+
+    rcode = pkt[3] & 0x0f;
+    qd = (pkt[4] << 8) | pkt[5];
+    an = (pkt[6] << 8) | pkt[7];
+    ns = (pkt[8] << 8) | pkt[9];
+
+    /* The question must be ours */
+    if (qd != 1 || (n = res_encode(e->name, q)) < 0 || 12 + n + 4 > len)
+        return;
+    for (i = 0; i < n; i++) {
+        if (q[i] != pkt[12 + i] && (q[i] | 0x20) != (pkt[12 + i] | 0x20))
+            return;
+    }
+    off = 12 + n + 4;
+
+    if (rcode != 0 && rcode != DNS_RCODE_NXDOMAIN) {
+        res_done(e, EIO, 0);
+        return;
+    }
+
+    e->naddr = 0;
+    for (i = 0; i < an + ns; i++) {
+        if ((off = res_skipname(pkt, len, off)) < 0 || off + 10 > len)
+            break;
+        type = (pkt[off] << 8) | pkt[off + 1];
+        class = (pkt[off + 2] << 8) | pkt[off + 3];
+        ttl = get32(&pkt[off + 4]);
+        rdlen = (pkt[off + 8] << 8) | pkt[off + 9];
+        off += 10;
+        if (off + rdlen > len)
+            break;
+        if (class == DNS_CLASS_IN) {
+            if (i < an && type == DNS_TYPE_A && rdlen == 4 && rcode == 0) {
+                if (e->naddr < NET_MAXADDRS)
+                    memcpy(&e->addr[e->naddr++], &pkt[off], 4);
+                if (ttl < minttl)
+                    minttl = ttl;
+            } else if (i >= an && type == DNS_TYPE_SOA && rdlen >= 20) {
+                /* Negative TTL is min(SOA TTL, SOA minimum) */
+                negttl = get32(&pkt[off + rdlen - 4]);
+                if (ttl < negttl)
+                    negttl = ttl;
+            }
+        }
+        off += rdlen;
+    }
+
+    if (e->naddr > 0)
+        res_done(e, 0, minttl);
+    else
+        res_done(e, ENOENT, negttl);
+}
+
+static void res_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                     const ip_addr_t *addr, u16_t port)
+{
+    u8_t pkt[RES_PKTSIZE];
+    struct res_entry *e;
+    int i, len;
+    u16_t id;
+
+    len = (int)pbuf_copy_partial(p, pkt, sizeof(pkt), 0);
+    pbuf_free(p);
+
+    /* Must be a response from the server we asked */
+    if (len < 12 || !(pkt[2] & 0x80))
+        return;
+    if (res_port != 0) {
+        if (port != res_port ||
+            ip4_addr_get_u32(ip_2_ip4(addr)) != ip4_addr_get_u32(ip_2_ip4(&res_server)))
+            return;
+    } else if (port != DNS_PORT)
+        return;
+
+    id = (u16_t)((pkt[0] << 8) | pkt[1]);
+    for (i = 0; i < RES_CACHE; i++) {
+        e = &res_cache[i];
+        if (e->state == RES_PENDING && e->id == id) {
+            res_answer(e, pkt, len);
+            return;
+        }
+    }
+}
+
+/*
+ * Look up the IPv4 addresses of a host.
+ * Called by request threads without the core lock.
+ */
+int res_lookup(const char *name, uint32_t *addr, int *naddr)
+{
+    struct res_entry *e;
+    struct res_waiter w;
+    char host[RES_HOSTSIZE];
+    size_t len;
+    u32_t now;
+    int error;
+
+    len = strlcpy(host, name, sizeof(host));
+    if (len >= sizeof(host))
+        return EINVAL;
+    if (len > 1 && host[len - 1] == '.')
+        host[len - 1] = '\0';
+
+    LOCK_TCPIP_CORE();
+    now = sys_now();
+    e = res_find(host);
+    if (e != NULL && e->state != RES_PENDING && !expired(e, now)) {
+        e->used = now;
+        if (e->state == RES_FOUND) {
+            res_stat.hits++;
+            *naddr = e->naddr;
+            memcpy(addr, e->addr, sizeof(uint32_t) * (size_t)e->naddr);
+            error = 0;
+        } else {
+            res_stat.neghits++;
+            error = ENOENT;
+        }
+        UNLOCK_TCPIP_CORE();
+        return error;
+    }
+
+    if (e != NULL && e->state == RES_PENDING)
+        res_stat.joined++;
+    else {
+        if (e == NULL && (e = res_alloc()) == NULL) {
+            UNLOCK_TCPIP_CORE();
+            return EAGAIN;
+        }
+        strlcpy(e->name, host, sizeof(e->name));
+        e->state = RES_PENDING;
+        e->id = (u16_t)(++res_id ^ now);
+        e->tries = 0;
+        e->naddr = 0;
+        list_init(&e->waiters);
+        res_stat.misses++;
+        if ((error = res_send(e)) != 0) {
+            e->state = RES_FREE;
+            UNLOCK_TCPIP_CORE();
+            return error;
+        }
+    }
+    if (sys_sem_new(&w.sem, 0) != ERR_OK) {
+        UNLOCK_TCPIP_CORE();
+        return ENOMEM;
+    }
+    list_insert(&e->waiters, &w.link);
+    UNLOCK_TCPIP_CORE();
+
+    sys_arch_sem_wait(&w.sem, 0);
+    sys_sem_free(&w.sem);
+    if (w.error == 0) {
+        *naddr = w.naddr;
+        memcpy(addr, w.addr, sizeof(uint32_t) * (size_t)w.naddr);
+    }
+    return w.error;
+}
+
+/*
+ * Set the name server and flush the cache.
+ */
+void res_config(const struct sockaddr_in *sin)
+{
+    int i;
+
+    LOCK_TCPIP_CORE();
+    ip_addr_set_ip4_u32(&res_server, sin->sin_addr.s_addr);
+    res_port = lwip_ntohs(sin->sin_port);
+    for (i = 0; i < RES_CACHE; i++) {
+        if (res_cache[i].state != RES_PENDING)
+            res_cache[i].state = RES_FREE;
+    }
+    memset(&res_stat, 0, sizeof(res_stat));
+    UNLOCK_TCPIP_CORE();
+}
+
+void res_getstat(struct net_dnsstat *st)
+{
+    u32_t now;
+    int i;
+
+    LOCK_TCPIP_CORE();
+    *st = res_stat;
+    st->entries = 0;
+    now = sys_now();
+    for (i = 0; i < RES_CACHE; i++) {
+        if ((res_cache[i].state == RES_FOUND || res_cache[i].state == RES_NOTFOUND) &&
+            !expired(&res_cache[i], now))
+            st->entries++;
+    }
+    UNLOCK_TCPIP_CORE();
+}
+
+void res_init(void)
+{
+
+    LOCK_TCPIP_CORE();
+    res_id = (u16_t)sys_now();
+    if ((res_pcb = udp_new()) != NULL) {
+        udp_bind(res_pcb, IP_ADDR_ANY, 0);
+        udp_recv(res_pcb, res_recv, NULL);
+    }
+    UNLOCK_TCPIP_CORE();
+}
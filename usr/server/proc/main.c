@@ -75,6 +75,7 @@ static int proc_stop(struct msg*);
 static int proc_waitpid(struct msg*);
 static int proc_kill(struct msg*);
 static int proc_exec(struct msg*);
+static int proc_spawn(struct msg*);
 static int proc_pstat(struct msg*);
 static int proc_register(struct msg*);
 static int proc_setinit(struct msg*);
@@ -98,7 +99,8 @@ static const struct msg_map procmsg_map[] = {
     {PS_GETSID, proc_getsid}, {PS_SETSID, proc_setsid},      {PS_FORK, proc_fork},       {PS_EXIT, proc_exit},
     {PS_STOP, proc_stop},     {PS_WAITPID, proc_waitpid},    {PS_KILL, proc_kill},       {PS_EXEC, proc_exec},
     {PS_PSTAT, proc_pstat},   {PS_REGISTER, proc_register},  {PS_SETINIT, proc_setinit}, {PS_TRACE, proc_trace},
-    {STD_BOOT, proc_boot},    {STD_SHUTDOWN, proc_shutdown}, {STD_DEBUG, proc_debug},    {0, proc_noop},
+    {PS_SPAWN, proc_spawn},   {STD_BOOT, proc_boot},         {STD_SHUTDOWN, proc_shutdown}, {STD_DEBUG, proc_debug},
+    {0, proc_noop},
 };
 
 static struct proc proc0;       /* process data of this server (pid=0) */
@@ -269,6 +271,7 @@ static int proc_exec(struct msg* msg)
     p_add(p);
     p->p_invfork = 0;
     p->p_stackbase = (void*)msg->data[2];
+    task_setpid(newtask, p->p_pid, p->p_parent ? p->p_parent->p_pid : 0);
 
     if (p->p_flag & P_TRACED) {
         DPRINTF(("proc: traced!\n"));
@@ -282,6 +285,46 @@ static int proc_exec(struct msg* msg)
     return 0;
 }
 
+/*
+ * spawn() - Create the process of a task spawned by the exec
+ * server on behalf of its parent.
+ * If data[3] is not negative, the child joins that process group.
+ */
+static int proc_spawn(struct msg* msg)
+{
+    task_t parent, child;
+    struct proc* p;
+    pid_t pid;
+    int error;
+
+    /* Check client's capability. */
+    if (task_chkcap(msg->hdr.task, CAP_PROTSERV) != 0)
+        return EPERM;
+
+    parent = (task_t)msg->data[0];
+    child = (task_t)msg->data[1];
+    DPRINTF(("proc: spawn parent=%x child=%x\n", parent, child));
+
+    if ((curproc = task_to_proc(parent)) == NULL)
+        return EINVAL;
+
+    if ((error = sys_fork(child, 0, &pid)) != 0)
+        return error;
+
+    p = task_to_proc(child);
+    p->p_stackbase = (void*)msg->data[2];
+
+    /* Move to the requested process group */
+    if (msg->data[3] >= 0 && (error = sys_setpgid(pid, (pid_t)msg->data[3])) != 0) {
+        p_remove(p);
+        cleanup(p);
+        return error;
+    }
+
+    msg->data[0] = (int)pid;
+    return 0;
+}
+
 /*
  * Get process status.
  */
@@ -473,6 +516,7 @@ static void proc0_init(void)
     list_init(&p->p_children);
     p_add(p);
     list_insert(&pg->pg_members, &p->p_pgrp_link);
+    task_setpid(p->p_task, 0, 0);
 }
 
 /*
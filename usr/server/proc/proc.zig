@@ -103,6 +103,7 @@ fn proc_exec(msg: *ffi.Msg) callconv(.c) c_int {
     hash.p_add(p);
     p.p_invfork = 0;
     p.p_stackbase = @as(?*anyopaque, @ptrFromInt(@as(usize, @bitCast(msg.data[2]))));
+    _ = task.prex.task_setpid(newtask, p.p_pid, if (p.p_parent != null) p.p_parent.*.p_pid else 0);
 
     const parent = p.p_parent;
     if (parent != null and parent.*.p_vforked != 0) {
@@ -111,6 +112,35 @@ fn proc_exec(msg: *ffi.Msg) callconv(.c) c_int {
     return 0;
 }
 
+/// Create the process of a task spawned by the exec server on behalf
+/// of its parent. If data[3] is not negative, the child joins that
+/// process group.
+fn proc_spawn(msg: *ffi.Msg) callconv(.c) c_int {
+    if (task.prex.task_chkcap(msg.hdr.task, ffi.raw.CAP_PROTSERV) != 0) {
+        return prog.errno.EPERM;
+    }
+
+    const parent = @as(task.prex.task_t, @bitCast(msg.data[0]));
+    const child = @as(task.prex.task_t, @bitCast(msg.data[1]));
+    ffi.global.set_curproc(hash.task_to_proc(parent) orelse return prog.errno.EINVAL);
+
+    const child_pid = fork.sys_fork(child, 0) catch |err| return ffi.toCError(err);
+    const p = hash.task_to_proc(child).?;
+    p.p_stackbase = @as(?*anyopaque, @ptrFromInt(@as(usize, @bitCast(msg.data[2]))));
+
+    // Move to the requested process group
+    if (msg.data[3] >= 0) {
+        pid.sys_setpgid(child_pid, @as(task.prex.pid_t, @bitCast(msg.data[3]))) catch |err| {
+            hash.p_remove(p);
+            fork.cleanup(p);
+            return ffi.toCError(err);
+        };
+    }
+
+    msg.data[0] = @intCast(child_pid);
+    return 0;
+}
+
 fn proc_pstat(msg: *ffi.Msg) callconv(.c) c_int {
     const t = @as(task.prex.task_t, @bitCast(msg.data[0]));
     const p = hash.task_to_proc(t) orelse return prog.errno.EINVAL;
@@ -229,6 +259,7 @@ fn proc0_init() void {
     hash.p_add(p);
     const pgrp_link: *ffi.List = @ptrCast(&p.p_pgrp_link);
     pg_members.insert(pgrp_link);
+    _ = task.prex.task_setpid(p.p_task, 0, 0);
 }
 
 pub fn main(argc: c_int, argv: [*c][*c]u8) callconv(.c) c_int {
@@ -281,6 +312,7 @@ comptime {
     @export(&proc_waitpid, .{ .name = "proc_waitpid", .linkage = .strong });
     @export(&proc_kill, .{ .name = "proc_kill", .linkage = .strong });
     @export(&proc_exec, .{ .name = "proc_exec", .linkage = .strong });
+    @export(&proc_spawn, .{ .name = "proc_spawn", .linkage = .strong });
     @export(&proc_pstat, .{ .name = "proc_pstat", .linkage = .strong });
     @export(&proc_register, .{ .name = "proc_register", .linkage = .strong });
     @export(&proc_setinit, .{ .name = "proc_setinit", .linkage = .strong });
@@ -77,6 +77,7 @@ int sys_exit(int exitcode)
         child->p_parent = &initproc;
         list_remove(&child->p_sibling);
         list_insert(&initproc.p_children, &child->p_sibling);
+        task_setpid(child->p_task, child->p_pid, 1);
     }
 
     /*
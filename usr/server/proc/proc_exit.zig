@@ -25,6 +25,7 @@ pub fn sys_exit(exitcode: c_int) !void {
         const init_children: *ffi.List = @ptrCast(&init.p_children);
         child_sibling.remove();
         init_children.insert(child_sibling);
+        _ = task.prex.task_setpid(child.p_task, child.p_pid, 1);
     }
 
     const parent = cur.p_parent;
@@ -110,6 +110,7 @@ int newproc(struct proc* p, pid_t pid, task_t task)
     list_insert(&pg->pg_members, &p->p_pgrp_link);
     list_insert(&allproc, &p->p_link);
 
+    task_setpid(task, pid, curproc->p_pid);
     return 0;
 }
 
@@ -46,6 +46,8 @@ pub fn newproc(p: *ffi.Proc, pid_in: task.prex.pid_t, t: task.prex.task_t) !void
     const allproc: *ffi.List = @ptrCast(ffi.global.get_allproc());
     const p_link: *ffi.List = @ptrCast(&p.p_link);
     allproc.insert(p_link);
+
+    _ = task.prex.task_setpid(t, pid, ffi.global.get_curproc().p_pid);
 }
 
 pub fn sys_fork(child: task.prex.task_t, vfork: c_int) !task.prex.pid_t {
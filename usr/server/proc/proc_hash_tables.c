@@ -13,6 +13,7 @@ extern int proc_stop(struct msg *);
 extern int proc_waitpid(struct msg *);
 extern int proc_kill(struct msg *);
 extern int proc_exec(struct msg *);
+extern int proc_spawn(struct msg *);
 extern int proc_pstat(struct msg *);
 extern int proc_register(struct msg *);
 extern int proc_setinit(struct msg *);
@@ -139,6 +140,8 @@ dispatch_msg(int code, struct msg *msg)
 		return proc_kill(msg);
 	else if (code == PS_EXEC)
 		return proc_exec(msg);
+	else if (code == PS_SPAWN)
+		return proc_spawn(msg);
 	else if (code == PS_PSTAT)
 		return proc_pstat(msg);
 	else if (code == PS_REGISTER)
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * This is an original implementation inspired by the OpenBSD sndio project.
+ *
+ * Mixing and format conversion for the Prex+ sndio server
+ */
+
+/*
+ * The mixing kernel is a saturating 16-bit add.  It is selected at
+ * compile time:
+ *
+ *  - SSE2   : paddsw on 8 samples
+ *  - NEON   : vqadd.s16 on 8 samples
+ *  - SIMD32 : ARMv6 qadd16 on 2 samples
+ *  - SWAR   : 2 samples in a 32-bit word, portable C
+ *
+ * Format and sample rate conversion is done per block.  Samples are
+ * decoded into a scratch buffer, and resampled by linear interpolation.
+ */
+
+#include <sys/types.h>
+#include <sys/audioio.h>
+#include <string.h>
+
+#include "mix.h"
+
+#if defined(__SSE2__)
+typedef short v8hi __attribute__((vector_size(16)));
+#elif defined(__ARM_NEON)
+typedef short v8hi __attribute__((vector_size(16)));
+#endif
+
+/*
+ * Add two pairs of signed 16-bit samples with saturation.
+ */
+static inline uint32_t swar_addsat(uint32_t a, uint32_t b)
+{
+    uint32_t s, ov, mask, sat;
+
+    /* Lane-wise add without carry between lanes */
+    s = ((a & 0x7fff7fff) + (b & 0x7fff7fff)) ^ ((a ^ b) & 0x80008000);
+
+    /* Overflow if both operands have the same sign and the sum does not */
+    ov = ~(a ^ b) & (a ^ s) & 0x80008000;
+    mask = (ov >> 15) * 0xffff;
+
+    /* 0x7fff for positive overflow, 0x8000 for negative overflow */
+    sat = 0x7fff7fff + ((a >> 15) & 0x00010001);
+    return (s & ~mask) | (sat & mask);
+}
+
+/*
+ * dst[i] = saturate(dst[i] + src[i])
+ */
+void mix_add(int16_t* dst, const int16_t* src, int n)
+{
+    uint32_t a, b;
+    int32_t v;
+
+#if defined(__SSE2__)
+    v8hi va, vb;
+
+    for (; n >= 8; n -= 8, dst += 8, src += 8) {
+        memcpy(&va, dst, sizeof(va));
+        memcpy(&vb, src, sizeof(vb));
+        va = __builtin_ia32_paddsw128(va, vb);
+        memcpy(dst, &va, sizeof(va));
+    }
+#elif defined(__ARM_NEON)
+    v8hi va, vb;
+
+    for (; n >= 8; n -= 8, dst += 8, src += 8) {
+        memcpy(&va, dst, sizeof(va));
+        memcpy(&vb, src, sizeof(vb));
+        __asm__("vqadd.s16 %q0, %q1, %q2" : "=w"(va) : "w"(va), "w"(vb));
+        memcpy(dst, &va, sizeof(va));
+    }
+#endif
+    for (; n >= 2; n -= 2, dst += 2, src += 2) {
+        memcpy(&a, dst, sizeof(a));
+        memcpy(&b, src, sizeof(b));
+#if defined(__ARM_FEATURE_SIMD32)
+        __asm__("qadd16 %0, %1, %2" : "=r"(a) : "r"(a), "r"(b));
+#else
+        a = swar_addsat(a, b);
+#endif
+        memcpy(dst, &a, sizeof(a));
+    }
+    if (n > 0) {
+        v = (int32_t)*dst + (int32_t)*src;
+        if (v > 32767)
+            v = 32767;
+        if (v < -32768)
+            v = -32768;
+        *dst = (int16_t)v;
+    }
+}
+
+/*
+ * Scale samples by vol/MIX_UNITY.
+ * vol must not be larger than MIX_UNITY, so this never clips.
+ */
+void mix_scale(int16_t* buf, int n, int vol)
+{
+
+    while (n-- > 0) {
+        *buf = (int16_t)(((int32_t)*buf * vol) >> 8);
+        buf++;
+    }
+}
+
+/*
+ * Name of the mixing kernel in use.
+ */
+const char* mix_impl(void)
+{
+
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON)
+    return "neon";
+#elif defined(__ARM_FEATURE_SIMD32)
+    return "simd32";
+#else
+    return "swar";
+#endif
+}
+
+/*
+ * Convert a sample rate to Hz.
+ * Accepts both AUDIO_SAMP_RATE_xxx and a plain value in Hz.
+ */
+u_int conv_rate(u_int rate)
+{
+    static const u_int rates[] = { 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000, 96000 };
+    u_int i;
+
+    if (rate >= 1000)
+        return rate;
+    for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        if (rate & (1U << i))
+            return rates[i];
+    }
+    return 0;
+}
+
+/*
+ * Compute rate/orate in 16.16 fixed point without 64-bit division.
+ */
+static u_int conv_step(u_int rate, u_int orate)
+{
+    u_int q, r, frac = 0;
+    int i;
+
+    q = rate / orate;
+    r = rate % orate;
+    for (i = 0; i < 16; i++) {
+        r <<= 1;
+        frac <<= 1;
+        if (r >= orate) {
+            r -= orate;
+            frac |= 1;
+        }
+    }
+    return (q << 16) | frac;
+}
+
+/*
+ * Set up a converter.
+ * Returns 0 if the client format is the native mixer format at the
+ * same rate, 1 if conversion is needed, or -1 if it is unsupported.
+ */
+int conv_setup(struct conv* c, const struct audio_prinfo* pi, u_int orate, int ochan)
+{
+    u_int rate;
+    int bps;
+
+    switch (pi->encoding) {
+    case AUDIO_ENCODING_ULAW:
+    case AUDIO_ENCODING_ALAW:
+    case AUDIO_ENCODING_PCM_S8:
+    case AUDIO_ENCODING_PCM_U8:
+        bps = 1;
+        break;
+    case AUDIO_ENCODING_PCM_S16_LE:
+    case AUDIO_ENCODING_PCM_S16_BE:
+    case AUDIO_ENCODING_PCM_U16_LE:
+    case AUDIO_ENCODING_PCM_U16_BE:
+        bps = 2;
+        break;
+    default:
+        return -1;
+    }
+    rate = conv_rate(pi->sample_rate);
+    if (rate == 0 || orate == 0 || pi->channels < 1 || pi->channels > 2)
+        return -1;
+
+    memset(c, 0, sizeof(*c));
+    c->encoding = pi->encoding;
+    c->ichan = (int)pi->channels;
+    c->ochan = ochan;
+    c->bpf = bps * c->ichan;
+    c->step = conv_step(rate, orate);
+
+#if BYTE_ORDER == LITTLE_ENDIAN
+    if (c->encoding == AUDIO_ENCODING_PCM_S16_LE && c->ichan == ochan && c->step == 0x10000)
+        return 0;
+#else
+    if (c->encoding == AUDIO_ENCODING_PCM_S16_BE && c->ichan == ochan && c->step == 0x10000)
+        return 0;
+#endif
+    return 1;
+}
+
+static int16_t ulaw_decode(uint8_t u)
+{
+    int t;
+
+    u = ~u;
+    t = ((u & 0x0f) << 3) + 0x84;
+    t <<= (u & 0x70) >> 4;
+    return (int16_t)((u & 0x80) ? (0x84 - t) : (t - 0x84));
+}
+
+static int16_t alaw_decode(uint8_t a)
+{
+    int t, seg;
+
+    a ^= 0x55;
+    t = (a & 0x0f) << 4;
+    seg = (a & 0x70) >> 4;
+    if (seg == 0)
+        t += 8;
+    else {
+        t += 0x108;
+        if (seg > 1)
+            t <<= seg - 1;
+    }
+    return (int16_t)((a & 0x80) ? t : -t);
+}
+
+/*
+ * Decode n client frames into mixer samples.
+ * dst must have room for n * 2 samples.
+ */
+static void conv_decode(const struct conv* c, int16_t* dst, const uint8_t* src, int n)
+{
+    int i, cnt = n * c->ichan;
+
+    switch (c->encoding) {
+    case AUDIO_ENCODING_ULAW:
+        for (i = 0; i < cnt; i++)
+            dst[i] = ulaw_decode(src[i]);
+        break;
+    case AUDIO_ENCODING_ALAW:
+        for (i = 0; i < cnt; i++)
+            dst[i] = alaw_decode(src[i]);
+        break;
+    case AUDIO_ENCODING_PCM_S8:
+        for (i = 0; i < cnt; i++)
+            dst[i] = (int16_t)((int8_t)src[i] * 256);
+        break;
+    case AUDIO_ENCODING_PCM_U8:
+        for (i = 0; i < cnt; i++)
+            dst[i] = (int16_t)(((int)src[i] - 128) * 256);
+        break;
+    case AUDIO_ENCODING_PCM_S16_LE:
+        for (i = 0; i < cnt; i++, src += 2)
+            dst[i] = (int16_t)(src[0] | (src[1] << 8));
+        break;
+    case AUDIO_ENCODING_PCM_S16_BE:
+        for (i = 0; i < cnt; i++, src += 2)
+            dst[i] = (int16_t)((src[0] << 8) | src[1]);
+        break;
+    case AUDIO_ENCODING_PCM_U16_LE:
+        for (i = 0; i < cnt; i++, src += 2)
+            dst[i] = (int16_t)((src[0] | (src[1] << 8)) ^ 0x8000);
+        break;
+    case AUDIO_ENCODING_PCM_U16_BE:
+        for (i = 0; i < cnt; i++, src += 2)
+            dst[i] = (int16_t)(((src[0] << 8) | src[1]) ^ 0x8000);
+        break;
+    }
+
+    /* Channel mapping */
+    if (c->ichan == 1 && c->ochan == 2) {
+        for (i = n - 1; i >= 0; i--) {
+            dst[i * 2] = dst[i];
+            dst[i * 2 + 1] = dst[i];
+        }
+    } else if (c->ichan == 2 && c->ochan == 1) {
+        for (i = 0; i < n; i++)
+            dst[i] = (int16_t)(((int32_t)dst[i * 2] + dst[i * 2 + 1]) / 2);
+    }
+}
+
+/*
+ * Convert up to nin client frames into at most nout mixer frames.
+ * Returns the number of mixer frames produced and stores the number
+ * of client frames consumed in *used.
+ */
+int conv_run(struct conv* c, int16_t* out, int nout, const uint8_t* in, int nin, int* used)
+{
+    int16_t dec[CONV_FRAMES * 2];
+    const int16_t *a, *b;
+    int n, i, k, ch, f, oc = c->ochan;
+    int produced = 0, consumed = 0;
+
+    while (produced < nout && consumed < nin) {
+        n = nin - consumed;
+        if (n > CONV_FRAMES)
+            n = CONV_FRAMES;
+
+        if (c->step == 0x10000) {
+            /* Same rate: format and channel conversion only */
+            if (n > nout - produced)
+                n = nout - produced;
+            conv_decode(c, dec, in + consumed * c->bpf, n);
+            memcpy(&out[produced * oc], dec, (size_t)(n * oc) * sizeof(int16_t));
+            produced += n;
+            consumed += n;
+            continue;
+        }
+
+        conv_decode(c, dec, in + consumed * c->bpf, n);
+        i = (int)(c->pos >> 16);
+        while (produced < nout && i < n) {
+            /* Interpolate between frame i-1 and frame i */
+            f = (int)((c->pos & 0xffff) >> 1);
+            a = (i == 0) ? c->last : &dec[(i - 1) * oc];
+            b = &dec[i * oc];
+            for (ch = 0; ch < oc; ch++)
+                out[produced * oc + ch] = (int16_t)(a[ch] + (((b[ch] - a[ch]) * f) >> 15));
+            produced++;
+            c->pos += c->step;
+            i = (int)(c->pos >> 16);
+        }
+
+        /* Drop the client frames we have moved past */
+        k = (i < n) ? i : n;
+        if (k > 0) {
+            for (ch = 0; ch < oc; ch++)
+                c->last[ch] = dec[(k - 1) * oc + ch];
+            c->pos -= (u_int)k << 16;
+            consumed += k;
+        }
+        if (k < n)
+            break;
+    }
+    *used = consumed;
+    return produced;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * This is an original implementation inspired by the OpenBSD sndio project.
+ *
+ * Mixing and format conversion for the Prex+ sndio server
+ */
+
+#ifndef _SNDIO_MIX_H
+#define _SNDIO_MIX_H
+
+#include <sys/types.h>
+#include <sys/audioio.h>
+
+#define MIX_UNITY 256    /* volume for 0 dB */
+#define CONV_FRAMES 256  /* frames decoded per conversion step */
+
+/*
+ * Converter from a client format to the native mixer format,
+ * which is signed 16-bit host endian with 1 or 2 channels.
+ */
+struct conv
+{
+    u_int encoding;  /* client encoding */
+    int ichan;       /* client channels */
+    int ochan;       /* mixer channels */
+    int bpf;         /* bytes per client frame */
+    u_int step;      /* client frames per mixer frame (16.16) */
+    u_int pos;       /* position from last[] (16.16) */
+    int16_t last[2]; /* previous client frame */
+};
+
+__BEGIN_DECLS
+void mix_add(int16_t*, const int16_t*, int);
+void mix_scale(int16_t*, int, int);
+const char* mix_impl(void);
+u_int conv_rate(u_int);
+int conv_setup(struct conv*, const struct audio_prinfo*, u_int, int);
+int conv_run(struct conv*, int16_t*, int, const uint8_t*, int, int*);
+__END_DECLS
+
+#endif /* !_SNDIO_MIX_H */
@@ -16,9 +16,17 @@
 #include <string.h>
 #include <errno.h>
 
+#include "mix.h"
+
 #define MAX_CLIENTS 8
-#define MAX_BUFFERS_PER_CLIENT 4
+#define MAX_BUFFERS_PER_CLIENT 4 /* must be a power of 2 */
 #define MIX_BUFFER_SIZE 16384
+#define RING_MASK (MAX_BUFFERS_PER_CLIENT - 1)
+#define SNDIO_NBLKS 3 /* blocks queued to the device */
+
+#ifndef CONFIG_SNDIO_PERIOD
+#define CONFIG_SNDIO_PERIOD 10 /* mixing period in msec */
+#endif
 
 #ifdef DEBUG_SNDIOD
 #define DPRINTF(a) dprintf a
@@ -34,17 +42,47 @@ struct client {
     struct audio_info info;
     struct sndio_buf_info bufs[MAX_BUFFERS_PER_CLIENT];
     int num_bufs;
-    int next_buf;
     void *shm_base;
+    struct conv conv;       /* client format to mixer format */
+    int native;             /* no conversion needed */
+    int vol;                /* volume (MIX_UNITY = 0dB) */
+    int cur_buf;            /* buffer being mixed, or -1 */
+    size_t cur_off;         /* byte offset in cur_buf */
+    u_int done_mask;        /* buffers to release after playback */
+    /*
+     * Queued buffers.  This is a single producer (control thread),
+     * single consumer (mixing thread) ring, so queueing a buffer
+     * does not need client_mutex.
+     */
+    int ring[MAX_BUFFERS_PER_CLIENT];
+    u_long qtime[MAX_BUFFERS_PER_CLIENT]; /* tick when queued */
+    volatile u_int ring_head;
+    volatile u_int ring_tail;
 };
 
 static struct client clients[MAX_CLIENTS];
 static mutex_t client_mutex = MUTEX_INITIALIZER;
-static cond_t mix_cond = COND_INITIALIZER;
+static sem_t mix_sem; /* posted when there is work for the mixer */
 static object_t sndio_obj;
 static device_t sound_dev;
 
 static int16_t mix_buffer[MIX_BUFFER_SIZE / 2];
+static int16_t conv_buffer[MIX_BUFFER_SIZE / 2];
+static u_int mix_rate = 44100; /* device sample rate in Hz */
+static int mix_channels = 2;   /* device channels */
+static int mix_frames;         /* frames per mixing period */
+static u_long period_ms = CONFIG_SNDIO_PERIOD;
+static u_long hz = 1000;       /* ticks per second */
+
+/*
+ * Statistics.  Protected by client_mutex.
+ */
+static struct sndio_stats stats;
+static u_int dev_queued;       /* blocks queued to the device */
+static u_long lat_sum;
+static u_int lat_cnt;
+
+#define TICK2MS(t) ((u_long)(t) * 1000 / hz)
 
 /*
  * Wait until specified server starts.
@@ -75,92 +113,275 @@ static void wait_server(const char* name, object_t* pobj)
 }
 
 /*
- * Mixing thread: Sums client buffers and writes to hardware
+ * Set the format of a client.
  */
-static void mixing_thread(void)
+static void client_setfmt(struct client *cl, struct audio_info *info)
 {
-    size_t size;
-    int i, b, s, error;
-    int16_t *src;
-    int active_play;
+    struct audio_prinfo pi;
+    int rc;
+
+    cl->info = *info;
+    pi = info->play;
+    rc = conv_setup(&cl->conv, &pi, mix_rate, mix_channels);
+    if (rc < 0) {
+        /* Unknown format: play it as the device format */
+        DPRINTF(("sndiod: unsupported format, enc=%d\n", pi.encoding));
+        pi.encoding = AUDIO_ENCODING_PCM_S16_LE;
+        pi.sample_rate = mix_rate;
+        pi.channels = (u_int)mix_channels;
+        rc = conv_setup(&cl->conv, &pi, mix_rate, mix_channels);
+    }
+    cl->vol = MIX_UNITY;
+    if (info->play.gain < 255)
+        cl->vol = (int)info->play.gain;
+    cl->native = (rc == 0 && cl->vol == MIX_UNITY);
+}
 
-    DPRINTF(("sndiod: Mixing thread started\n"));
+/*
+ * Mix one client into mix_buffer.
+ * Returns true if any data of the client was mixed.
+ */
+static int mix_client(struct client *cl, u_long now)
+{
+    struct sndio_buf_info *bp;
+    u_long lat;
+    int16_t *dst = mix_buffer;
+    const uint8_t *src;
+    int left = mix_frames;
+    int n, nin, used, mixed = 0;
+
+    while (left > 0) {
+        if (cl->cur_buf < 0) {
+            if (cl->ring_head == cl->ring_tail)
+                break;
+            __sync_synchronize();
+            cl->cur_buf = cl->ring[cl->ring_head & RING_MASK];
+            cl->ring_head++;
+            cl->cur_off = 0;
+            cl->bufs[cl->cur_buf].state = SNDIO_BUF_BUSY_STATE;
+
+            /*
+             * Latency of the buffer: time it waited in the ring,
+             * plus the blocks ahead of it in the device.
+             */
+            lat = TICK2MS(now - cl->qtime[cl->cur_buf]) + dev_queued * period_ms;
+            lat_sum += lat;
+            lat_cnt++;
+            if (lat > stats.lat_max)
+                stats.lat_max = (u_int)lat;
+        }
+        bp = &cl->bufs[cl->cur_buf];
+        src = (const uint8_t *)bp->addr + cl->cur_off;
+        nin = (int)((bp->size - cl->cur_off) / (size_t)cl->conv.bpf);
+
+        if (cl->native) {
+            /* Mix straight from the shared buffer */
+            n = (nin < left) ? nin : left;
+            mix_add(dst, (const int16_t *)src, n * mix_channels);
+            used = n;
+        } else {
+            n = conv_run(&cl->conv, conv_buffer, left, src, nin, &used);
+            if (cl->vol != MIX_UNITY)
+                mix_scale(conv_buffer, n * mix_channels, cl->vol);
+            mix_add(dst, conv_buffer, n * mix_channels);
+        }
+        dst += n * mix_channels;
+        left -= n;
+        cl->cur_off += (size_t)used * (size_t)cl->conv.bpf;
+        if (n > 0 || used > 0)
+            mixed = 1;
+
+        if (used >= nin) {
+            /* Whole buffer consumed */
+            cl->done_mask |= 1U << cl->cur_buf;
+            cl->cur_buf = -1;
+        } else if (n == 0 && used == 0)
+            break;
+    }
+    return mixed;
+}
 
-    while (1) {
-        mutex_lock(&client_mutex);
-        
-        /* Clear mix buffer */
-        memset(mix_buffer, 0, sizeof(mix_buffer));
-        active_play = 0;
-
-        /* Mix active clients */
-        for (i = 0; i < MAX_CLIENTS; i++) {
-            if (!clients[i].active || !clients[i].playing)
-                continue;
-
-            for (int count = 0; count < clients[i].num_bufs; count++) {
-                b = (clients[i].next_buf + count) % clients[i].num_bufs;
-                if (clients[i].bufs[b].state == SNDIO_BUF_QUEUED_STATE) {
-                    clients[i].bufs[b].state = SNDIO_BUF_BUSY_STATE;
-                    clients[i].next_buf = (b + 1) % clients[i].num_bufs;
-                    src = (int16_t *)clients[i].bufs[b].addr;
-                    
-                    /* Simple linear mixing (addition) */
-                    for (s = 0; s < (MIX_BUFFER_SIZE / 2); s++) {
-                        int32_t mixed = (int32_t)mix_buffer[s] + (int32_t)src[s];
-                        /* Clipping */
-                        if (mixed > 32767) mixed = 32767;
-                        if (mixed < -32768) mixed = -32768;
-                        mix_buffer[s] = (int16_t)mixed;
-                    }
-                    active_play = 1;
-                    break; 
+/*
+ * Mix all playing clients into mix_buffer.
+ * Returns true if any client had data.
+ */
+static int mix_all(void)
+{
+    struct audio_stats ast;
+    u_long now;
+    int i, active_play = 0;
+
+    if (device_ioctl(sound_dev, AUDIO_GETSTATS, &ast) == 0)
+        dev_queued = ast.queued;
+    sys_time(&now);
+
+    mutex_lock(&client_mutex);
+    memset(mix_buffer, 0, (size_t)(mix_frames * mix_channels) * sizeof(int16_t));
+    for (i = 0; i < MAX_CLIENTS; i++) {
+        if (!clients[i].active || !clients[i].playing)
+            continue;
+        if (mix_client(&clients[i], now))
+            active_play = 1;
+    }
+    mutex_unlock(&client_mutex);
+    return active_play;
+}
+
+/*
+ * Release the buffers consumed by the mixer back to the clients.
+ */
+static void release_bufs(void)
+{
+    int i, b;
+
+    mutex_lock(&client_mutex);
+    for (i = 0; i < MAX_CLIENTS; i++) {
+        if (!clients[i].active)
+            continue;
+
+        for (b = 0; b < clients[i].num_bufs; b++) {
+            if (clients[i].done_mask & (1U << b)) {
+                clients[i].done_mask &= ~(1U << b);
+                clients[i].bufs[b].state = SNDIO_BUF_READY_STATE;
+
+                /* Notify client that buffer is ready */
+                if (clients[i].cb_obj != 0) {
+                    struct msg notification;
+                    object_t cb_obj = clients[i].cb_obj;
+                    notification.hdr.code = SNDIO_BUF_READY;
+                    notification.data[0] = clients[i].bufs[b].id;
+
+                    /*
+                     * CRITICAL: Unlock mutex before msg_send to avoid deadlock
+                     * with client blocked on msg_send to us.
+                     */
+                    mutex_unlock(&client_mutex);
+                    msg_send(cb_obj, &notification, sizeof(notification));
+                    mutex_lock(&client_mutex);
                 }
             }
         }
+    }
+    mutex_unlock(&client_mutex);
+}
 
-        if (!active_play) {
-            /* If nothing to play, wait for a client to queue a buffer */
-            cond_wait(&mix_cond, &client_mutex);
-            mutex_unlock(&client_mutex);
+/*
+ * Account one mixing cycle which took "ticks" from wakeup to the
+ * end of mixing.  The device write is not counted, since it blocks
+ * while the device queue is full.
+ */
+static void account_cycle(u_long ticks, int late)
+{
+    u_long ms = TICK2MS(ticks);
+    int slot = 0;
+
+    while (ms > 0 && slot < SNDIO_HIST_SIZE - 1) {
+        ms >>= 1;
+        slot++;
+    }
+    mutex_lock(&client_mutex);
+    stats.cycles++;
+    stats.mix_hist[slot]++;
+    if (late)
+        stats.late++;
+    mutex_unlock(&client_mutex);
+}
+
+/*
+ * Mixing thread: Sums client buffers and writes to hardware
+ *
+ * While a stream is playing, the thread is woken by a periodic timer
+ * once per period and writes one block to the device.  The device
+ * keeps up to SNDIO_NBLKS blocks queued, so the hardware does not
+ * run dry as long as each cycle finishes within its period.
+ */
+static void mixing_thread(void)
+{
+    size_t size, bytes;
+    u_long start, end, due, period_ticks;
+    int late;
+
+    DPRINTF(("sndiod: Mixing thread started\n"));
+
+    bytes = (size_t)(mix_frames * mix_channels) * sizeof(int16_t);
+    period_ticks = period_ms * hz / 1000;
+    if (period_ticks == 0)
+        period_ticks = 1;
+
+    while (1) {
+        /*
+         * Idle: wait for a client to queue a buffer.  Drain the
+         * extra posts so that we sleep again once all queued
+         * buffers are played.
+         */
+        sem_wait(&mix_sem, 0);
+        while (sem_trywait(&mix_sem) == 0)
+            ;
+        sys_time(&start);
+        if (!mix_all())
             continue;
+
+        /* Pre-roll one block of silence to absorb wakeup jitter */
+        memset(conv_buffer, 0, bytes);
+        size = bytes;
+        device_write(sound_dev, conv_buffer, &size, 0);
+
+        timer_periodic(thread_self(), period_ms, period_ms);
+        due = start;
+        late = 0;
+
+        /* Playing: one block per period */
+        for (;;) {
+            sys_time(&end);
+            account_cycle(end - start, late);
+            size = bytes;
+            device_write(sound_dev, mix_buffer, &size, 0);
+            release_bufs();
+
+            timer_waitperiod();
+
+            /* Woken a whole period after the deadline? */
+            sys_time(&start);
+            due += period_ticks;
+            late = ((long)(start - due) >= (long)period_ticks);
+            if (late)
+                due = start;
+            if (!mix_all())
+                break;
         }
-        mutex_unlock(&client_mutex);
 
-        /* Write to hardware (blocks if driver is working) */
-        size = MIX_BUFFER_SIZE;
-        error = device_write(sound_dev, mix_buffer, &size, 0);
+        /* End of stream: let the device play out and stop the timer */
+        timer_periodic(thread_self(), 0, 0);
+        device_ioctl(sound_dev, AUDIO_DRAIN, NULL);
+    }
+}
 
-        /* Post-playback: Release buffers back to clients */
-        mutex_lock(&client_mutex);
-        for (i = 0; i < MAX_CLIENTS; i++) {
-            if (!clients[i].active)
-                continue;
+/*
+ * Queue a buffer without taking client_mutex.
+ * Only the control thread changes the client table, so it can be
+ * searched here safely.
+ */
+static void queue_buf(task_t client_task, struct sndio_queue_msg *m)
+{
+    struct client *cl;
+    int i, id = m->buf_id;
 
-            for (b = 0; b < clients[i].num_bufs; b++) {
-                if (clients[i].bufs[b].state == SNDIO_BUF_BUSY_STATE) {
-                    clients[i].bufs[b].state = SNDIO_BUF_READY_STATE;
-                    
-                    /* Notify client that buffer is ready */
-                    if (clients[i].cb_obj != 0) {
-                        struct msg notification;
-                        object_t cb_obj = clients[i].cb_obj;
-                        notification.hdr.code = SNDIO_BUF_READY;
-                        notification.data[0] = clients[i].bufs[b].id;
-                        
-                        /* 
-                         * CRITICAL: Unlock mutex before msg_send to avoid deadlock
-                         * with client blocked on msg_send to us.
-                         */
-                        mutex_unlock(&client_mutex);
-                        msg_send(cb_obj, &notification, sizeof(notification));
-                        mutex_lock(&client_mutex);
-                    }
-                }
-            }
+    for (i = 0; i < MAX_CLIENTS; i++) {
+        cl = &clients[i];
+        if (!cl->active || cl->task != client_task)
+            continue;
+        if (id >= 0 && id < cl->num_bufs && cl->ring_tail - cl->ring_head < MAX_BUFFERS_PER_CLIENT) {
+            cl->bufs[id].state = SNDIO_BUF_QUEUED_STATE;
+            cl->ring[cl->ring_tail & RING_MASK] = id;
+            sys_time(&cl->qtime[id]);
+            __sync_synchronize();
+            cl->ring_tail++;
+            DPRINTF(("sndiod: Queued buffer %d for client %x\n", id, (int)client_task));
+            sem_post(&mix_sem);
         }
-        mutex_unlock(&client_mutex);
+        break;
     }
+    m->hdr.status = 0;
 }
 
 /*
@@ -182,6 +403,12 @@ static void control_thread(void)
             continue;
 
         client_task = hdr->task;
+        if (hdr->code == SNDIO_QUEUE_BUF) {
+            /* Hot path: hand the buffer over to the mixer */
+            queue_buf(client_task, (struct sndio_queue_msg *)msg_buf);
+            msg_reply(sndio_obj, msg_buf, MAX_SNDIOMSG);
+            continue;
+        }
         mutex_lock(&client_mutex);
 
         switch (hdr->code) {
@@ -195,12 +422,23 @@ static void control_thread(void)
                 }
             }
             if (found != -1) {
+                struct audio_info info;
+
                 clients[found].active = 1;
                 clients[found].task = client_task;
                 clients[found].playing = 0;
                 clients[found].num_bufs = 0;
-                clients[found].next_buf = 0;
                 clients[found].shm_base = NULL;
+                clients[found].cur_buf = -1;
+                clients[found].done_mask = 0;
+                clients[found].ring_head = clients[found].ring_tail = 0;
+
+                /* Default to the device format */
+                AUDIO_INITINFO(&info);
+                info.play.sample_rate = mix_rate;
+                info.play.channels = (u_int)mix_channels;
+                info.play.encoding = AUDIO_ENCODING_PCM_S16_LE;
+                client_setfmt(&clients[found], &info);
                 
                 /* Look up client callback object */
                 sprintf(cb_name, "scb_%x", (int)client_task);
@@ -234,7 +472,7 @@ static void control_thread(void)
             struct sndio_params_msg *m = (struct sndio_params_msg *)msg_buf;
             for (i = 0; i < MAX_CLIENTS; i++) {
                 if (clients[i].active && clients[i].task == client_task) {
-                    clients[i].info = m->info;
+                    client_setfmt(&clients[i], &m->info);
                     break;
                 }
             }
@@ -261,7 +499,9 @@ static void control_thread(void)
                             clients[i].bufs[b].state = SNDIO_BUF_READY_STATE;
                         }
                         clients[i].num_bufs = count;
-                        clients[i].next_buf = 0;
+                        clients[i].cur_buf = -1;
+                        clients[i].done_mask = 0;
+                        clients[i].ring_head = clients[i].ring_tail = 0;
                         m->count = count;
                     } else {
                         DPRINTF(("sndiod: vm_map failed with error %d\n", err));
@@ -279,7 +519,7 @@ static void control_thread(void)
                 if (clients[i].active && clients[i].task == client_task) {
                     clients[i].playing = 1;
                     DPRINTF(("sndiod: Starting playback for client %x\n", (int)client_task));
-                    cond_signal(&mix_cond);
+                    sem_post(&mix_sem);
                     break;
                 }
             }
@@ -297,19 +537,16 @@ static void control_thread(void)
             hdr->status = 0;
             break;
 
-        case SNDIO_QUEUE_BUF: {
-            struct sndio_queue_msg *m = (struct sndio_queue_msg *)msg_buf;
-            for (i = 0; i < MAX_CLIENTS; i++) {
-                if (clients[i].active && clients[i].task == client_task) {
-                    int id = m->buf_id;
-                    if (id >= 0 && id < clients[i].num_bufs) {
-                        clients[i].bufs[id].state = SNDIO_BUF_QUEUED_STATE;
-                        DPRINTF(("sndiod: Queued buffer %d for client %x\n", id, (int)client_task));
-                        cond_signal(&mix_cond);
-                    }
-                    break;
-                }
-            }
+        case SNDIO_GET_STATS: {
+            struct sndio_stats_msg *m = (struct sndio_stats_msg *)msg_buf;
+            struct audio_stats ast;
+
+            stats.period = (u_int)period_ms;
+            stats.nblks = SNDIO_NBLKS;
+            if (device_ioctl(sound_dev, AUDIO_GETSTATS, &ast) == 0)
+                stats.underruns = ast.underruns;
+            stats.lat_avg = lat_cnt ? (u_int)(lat_sum / lat_cnt) : 0;
+            m->stats = stats;
             hdr->status = 0;
             break;
         }
@@ -332,6 +569,8 @@ int main(int argc, char *argv[])
     int error;
     object_t execobj;
     struct bind_msg bm;
+    struct audio_info dev_info;
+    struct timerinfo ti;
 
     DPRINTF(("sndiod: Starting...\n"));
 
@@ -350,6 +589,29 @@ int main(int argc, char *argv[])
         sys_panic("sndiod: Error opening /dev/audio");
     }
 
+    /* Mix in the format of the device */
+    if (device_ioctl(sound_dev, AUDIO_GETINFO, &dev_info) == 0) {
+        if (conv_rate(dev_info.play.sample_rate) != 0)
+            mix_rate = conv_rate(dev_info.play.sample_rate);
+        if (dev_info.play.channels == 1)
+            mix_channels = 1;
+    }
+
+    /* Mix one period at a time, and queue SNDIO_NBLKS periods */
+    if (sys_info(INFO_TIMER, &ti) == 0 && ti.hz > 0)
+        hz = (u_long)ti.hz;
+    if (period_ms < 1)
+        period_ms = 1;
+    mix_frames = (int)(mix_rate * period_ms / 1000);
+    if (mix_frames > MIX_BUFFER_SIZE / (2 * mix_channels))
+        mix_frames = MIX_BUFFER_SIZE / (2 * mix_channels);
+    AUDIO_INITINFO(&dev_info);
+    dev_info.blocksize = (u_int)(mix_frames * mix_channels) * sizeof(int16_t);
+    dev_info.hiwat = SNDIO_NBLKS;
+    if (device_ioctl(sound_dev, AUDIO_SETINFO, &dev_info) != 0)
+        DPRINTF(("sndiod: cannot set block size\n"));
+    sem_init(&mix_sem, 0);
+
     /* Create sndio object */
     error = object_create("!sndio", &sndio_obj);
     if (error) {
@@ -360,7 +622,8 @@ int main(int argc, char *argv[])
     error = thread_create(task_self(), &t);
     if (error) return 1;
     thread_load(t, mixing_thread, mix_stack + 8192);
-    thread_setpri(t, 100); /* Standard priority */
+    thread_setpolicy(t, SCHED_FIFO);
+    thread_setpri(t, PRI_SNDIO);
     thread_resume(t);
 
     /* Run control thread in main */
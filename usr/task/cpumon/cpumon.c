@@ -28,20 +28,79 @@
  */
 
 /*
- * cpumon.c - CPU voltage monitoring program
+ * cpumon.c - CPU voltage and load monitoring program
  */
 
 #include <sys/prex.h>
+#include <sys/param.h>
 #include <sys/ioctl.h>
+#include <sys/sysinfo.h>
 #include <stdio.h>
 
+/*
+ * CPU statistics summed over all CPUs.
+ * Times are in microseconds, and may wrap.
+ */
+struct cpustat
+{
+    u_long ticks;     /* clock ticks */
+    u_long idleticks; /* clock ticks spent idle */
+    u_long itime;     /* time in interrupt handlers */
+    u_long acct;      /* time spent in CPU accounting */
+    u_long nacct;     /* CPU accounting updates */
+};
+
 static struct cpufreqinfo cf_info;
+static struct cpuinfo cpu_info;
+
+static void cpu_stat(struct cpustat* st)
+{
+
+    st->ticks = st->idleticks = st->itime = st->acct = st->nacct = 0;
+    cpu_info.cookie = 0;
+    while (sys_info(INFO_CPU, &cpu_info) == 0) {
+        if (!cpu_info.online)
+            continue;
+        st->ticks += cpu_info.ticks;
+        st->idleticks += cpu_info.idleticks;
+        st->itime += cpu_info.itime.sec * 1000000 + cpu_info.itime.usec;
+        st->acct += cpu_info.acct.sec * 1000000 + cpu_info.acct.usec;
+        st->nacct += cpu_info.nacct;
+    }
+}
+
+/*
+ * Display the load, the interrupt time and the cost of the CPU
+ * accounting since the last call, in percent of the CPU time.
+ */
+static void show_load(struct cpustat* last)
+{
+    struct cpustat st;
+    u_long ticks, unit, load, intr, acct;
+
+    cpu_stat(&st);
+    ticks = st.ticks - last->ticks;
+    unit = ticks * (1000000 / HZ) / 10000; /* microseconds per 0.01% */
+    if (unit == 0)
+        return;
+
+    load = 100 - (st.idleticks - last->idleticks) * 100 / ticks;
+    intr = (st.itime - last->itime) / unit;
+    acct = (st.acct - last->acct) / unit;
+
+    printf("\33[s"); /* save cursor */
+    printf("\n\n\nLoad:  %3lu%%  Intr: %lu.%02lu%%  Acct: %lu.%02lu%% (%lu/s)  ", load, intr / 100, intr % 100,
+           acct / 100, acct % 100, (st.nacct - last->nacct) * HZ / ticks);
+    printf("\33[u"); /* restore cursor */
+    *last = st;
+}
 
 int main(int argc, char* argv[])
 {
     device_t dev;
+    struct cpustat last;
     int last_mhz = 0;
-    int i, j;
+    int i, j, n = 0;
     static char bar[21];
 
     /* Boost current prioriy */
@@ -62,11 +121,21 @@ int main(int argc, char* argv[])
      * Setup periodic timer for 10msec period
      */
     timer_periodic(thread_self(), 100, 10);
+    cpu_stat(&last);
     for (;;) {
         /*
          * Wait next period
          */
         timer_waitperiod();
+
+        /*
+         * Display load once a second
+         */
+        if (++n >= 100) {
+            show_load(&last);
+            n = 0;
+        }
+
         device_ioctl(dev, CFIOC_GET_INFO, &cf_info);
         if (cf_info.freq != last_mhz) {
             printf("\33[s"); /* save cursor */
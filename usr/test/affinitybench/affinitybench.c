@@ -0,0 +1,258 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * affinitybench.c - CPU affinity benchmark.
+ *
+ * Runs an IPC ping-pong between two tasks and a read loop
+ * through the file system server, first with every thread free
+ * to run anywhere, and then with the threads pinned to one CPU
+ * or to two different CPUs. The per-CPU switch and migration
+ * counters are printed at the end.
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <ipc/ipc.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NR_ROUNDS 20000
+#define NR_READS 5000
+#define MAXFSTHREADS 16
+#define ALLCPUS (~0U)
+
+struct ping_msg {
+    struct msg_header hdr;
+    int seq;
+};
+
+static char stack[1024];
+static thread_t fs_threads[MAXFSTHREADS];
+static int nr_fs_threads;
+
+/*
+ * Echo server running in the child task.
+ */
+static void server_thread(void)
+{
+    struct ping_msg m;
+    object_t obj;
+
+    if (object_create("affinitybench", &obj) != 0)
+        panic("affinitybench: object_create failed");
+
+    for (;;) {
+        if (msg_receive(obj, &m, sizeof(m)) != 0)
+            continue;
+        m.seq++;
+        msg_reply(obj, &m, sizeof(m));
+    }
+}
+
+static int count_cpus(void)
+{
+    struct cpuinfo info;
+    int n = 0;
+
+    info.cookie = 0;
+    while (sys_info(INFO_CPU, &info) == 0) {
+        if (info.online)
+            n++;
+    }
+    return n;
+}
+
+static void print_cpus(void)
+{
+    struct cpuinfo info;
+
+    printf("CPU   Switches Migrations     IRQs  Ticks   Idle\n");
+    info.cookie = 0;
+    while (sys_info(INFO_CPU, &info) == 0) {
+        if (!info.online)
+            continue;
+        printf("%3d %10u %10u %8u %6u %6u\n", info.cpu, info.nswitch, info.nmigrate, info.nirq, info.ticks,
+            info.idleticks);
+    }
+}
+
+/*
+ * Collect the threads of the file system server.
+ */
+static void find_fs_threads(void)
+{
+    struct threadinfo info;
+
+    info.cookie = 0;
+    while (sys_info(INFO_THREAD, &info) == 0) {
+        if (strcmp(info.taskname, "fs") == 0 && nr_fs_threads < MAXFSTHREADS)
+            fs_threads[nr_fs_threads++] = info.id;
+    }
+}
+
+static int pin_fs(u_int mask)
+{
+    int i, error;
+
+    for (i = 0; i < nr_fs_threads; i++) {
+        if ((error = thread_setaffinity(fs_threads[i], mask)) != 0)
+            return error;
+    }
+    return 0;
+}
+
+static void check_api(void)
+{
+    u_int mask;
+
+    if (thread_getaffinity(thread_self(), &mask) != 0 || mask == 0)
+        panic("thread_getaffinity failed");
+    printf("initial affinity: 0x%x\n", mask);
+
+    if (thread_setaffinity(thread_self(), 0) != EINVAL)
+        panic("empty mask accepted");
+    if (thread_setaffinity(thread_self(), 1) != 0)
+        panic("thread_setaffinity failed");
+    if (thread_getaffinity(thread_self(), &mask) != 0 || mask != 1)
+        panic("affinity not updated");
+    thread_setaffinity(thread_self(), ALLCPUS);
+}
+
+static void ping(object_t obj, const char* label)
+{
+    struct ping_msg m;
+    u_long start, end;
+    int i;
+
+    m.seq = 0;
+    sys_time(&start);
+    for (i = 0; i < NR_ROUNDS; i++) {
+        if (msg_send(obj, &m, sizeof(m)) != 0)
+            break;
+    }
+    sys_time(&end);
+
+    if (m.seq != i)
+        printf("sequence mismatch: %d/%d\n", m.seq, i);
+    printf("  ipc %-10s %6d round trips in %5lu ticks\n", label, i, end - start);
+}
+
+static void readloop(const char* label)
+{
+    char buf[512];
+    u_long start, end;
+    int fd, i;
+
+    if ((fd = open("/dev/zero", O_RDONLY)) < 0) {
+        printf("  vfs %-10s can not open /dev/zero\n", label);
+        return;
+    }
+    sys_time(&start);
+    for (i = 0; i < NR_READS; i++) {
+        if (read(fd, buf, sizeof(buf)) != sizeof(buf))
+            break;
+    }
+    sys_time(&end);
+    close(fd);
+    printf("  vfs %-10s %6d reads in %5lu ticks\n", label, i, end - start);
+}
+
+int main(int argc, char* argv[])
+{
+    task_t task;
+    thread_t t;
+    object_t obj;
+    int ncpus, other, error;
+
+    printf("CPU affinity benchmark\n");
+
+    check_api();
+    ncpus = count_cpus();
+    other = (ncpus > 1) ? 1 : 0;
+    printf("%d CPU(s) online\n", ncpus);
+
+    /*
+     * Start the echo server in another task.
+     */
+#ifdef CONFIG_MMU
+    error = task_create(task_self(), VM_COPY, &task);
+#else
+    error = task_create(task_self(), VM_SHARE, &task);
+#endif
+    if (error) {
+        printf("task_create failed. error=%d\n", error);
+        exit(1);
+    }
+    if (thread_create(task, &t) != 0 || thread_load(t, server_thread, stack + 1024) != 0 || thread_resume(t) != 0) {
+        printf("failed to start server thread\n");
+        task_terminate(task);
+        exit(1);
+    }
+    while (object_lookup("affinitybench", &obj) != 0)
+        timer_sleep(10, 0);
+
+    ping(obj, "unpinned");
+    thread_setaffinity(thread_self(), 1U);
+    thread_setaffinity(t, 1U);
+    ping(obj, "same cpu");
+    if (ncpus > 1) {
+        thread_setaffinity(t, 1U << other);
+        ping(obj, "split");
+    }
+    thread_setaffinity(t, ALLCPUS);
+    thread_setaffinity(thread_self(), ALLCPUS);
+    task_terminate(task);
+
+    /*
+     * Pinning threads of another task needs CAP_NICE.
+     */
+    find_fs_threads();
+    readloop("unpinned");
+    if (nr_fs_threads == 0 || pin_fs(1U) != 0) {
+        printf("  can not pin the fs server\n");
+    } else {
+        thread_setaffinity(thread_self(), 1U);
+        readloop("same cpu");
+        if (ncpus > 1) {
+            pin_fs(1U << other);
+            readloop("split");
+        }
+        pin_fs(ALLCPUS);
+        thread_setaffinity(thread_self(), ALLCPUS);
+    }
+
+    print_cpus();
+    return 0;
+}
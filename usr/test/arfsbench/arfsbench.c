@@ -0,0 +1,140 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * arfsbench.c - boot file system benchmark.
+ *
+ * Finds the last file in the /boot archive, which is the worst
+ * case for a linear header scan, and times open() and read() of
+ * it. If a program is given, it also times vfork() and exec() of
+ * that program with the remaining arguments.
+ *
+ * Usage: arfsbench [program [args...]]
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/wait.h>
+
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_LOOPS 200
+#define IOBUFSZ 4096
+
+static char path[PATH_MAX];
+static char iobuf[IOBUFSZ];
+static int hz;
+
+static void report(const char* name, u_long start, u_long end)
+{
+    u_long usec;
+
+    usec = (end - start) * (1000000 / hz) / NR_LOOPS;
+    printf("%-8s %8lu usec\n", name, usec);
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo info;
+    struct dirent* d;
+    u_long start, end;
+    DIR* dir;
+    pid_t pid;
+    int fd, i, sts;
+    size_t total;
+    ssize_t n;
+
+    sys_info(INFO_TIMER, &info);
+    hz = info.hz;
+
+    if ((dir = opendir("/boot")) == NULL) {
+        printf("can not open /boot\n");
+        exit(1);
+    }
+    path[0] = '\0';
+    while ((d = readdir(dir)) != NULL) {
+        if (d->d_name[0] != '\0') {
+            strlcpy(path, "/boot/", sizeof(path));
+            strlcat(path, d->d_name, sizeof(path));
+        }
+    }
+    closedir(dir);
+    if (path[0] == '\0') {
+        printf("no file in /boot\n");
+        exit(1);
+    }
+    printf("target: %s\n", path);
+
+    sys_time(&start);
+    for (i = 0; i < NR_LOOPS; i++) {
+        if ((fd = open(path, O_RDONLY)) < 0) {
+            printf("open failed\n");
+            exit(1);
+        }
+        close(fd);
+    }
+    sys_time(&end);
+    report("open", start, end);
+
+    total = 0;
+    sys_time(&start);
+    for (i = 0; i < NR_LOOPS; i++) {
+        if ((fd = open(path, O_RDONLY)) < 0)
+            exit(1);
+        while ((n = read(fd, iobuf, IOBUFSZ)) > 0)
+            total += (size_t)n;
+        close(fd);
+    }
+    sys_time(&end);
+    report("read", start, end);
+    printf("size     %8u bytes\n", (u_int)(total / NR_LOOPS));
+
+    if (argc > 1) {
+        sys_time(&start);
+        for (i = 0; i < NR_LOOPS; i++) {
+            pid = vfork();
+            if (pid == 0) {
+                execv(argv[1], &argv[1]);
+                _exit(1);
+            }
+            if (pid < 0 || waitpid(pid, &sts, 0) != pid) {
+                printf("exec failed\n");
+                exit(1);
+            }
+        }
+        sys_time(&end);
+        report("exec", start, end);
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026, Champ Yen (champ.yen@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * cputime.c - CPU accounting test.
+ *
+ * Burns CPU in user mode, makes system calls and sleeps, and
+ * checks that the user and system times, the switch counts and
+ * clock_gettime(CLOCK_THREAD_CPUTIME_ID) follow. The cost of the
+ * accounting itself is printed at the end.
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_CALLS 20000
+#define BURN_MSEC 200
+#define SLEEP_MSEC 100
+
+static int hz;
+
+/* Return a timespec in microseconds. */
+static u_long ts_usec(const struct timespec* ts)
+{
+
+    return (u_long)ts->ts_sec * 1000000 + (u_long)ts->ts_nsec / 1000;
+}
+
+/* Return a timeval in microseconds. */
+static u_long tv_usec(const struct timeval* tv)
+{
+
+    return (u_long)tv->tv_sec * 1000000 + (u_long)tv->tv_usec;
+}
+
+static u_long thread_cputime(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        printf("clock_gettime failed\n");
+        exit(1);
+    }
+    return ts_usec(&ts);
+}
+
+static void self_usage(struct rusage* ru)
+{
+
+    if (getrusage(RUSAGE_THREAD, ru) != 0) {
+        printf("getrusage failed\n");
+        exit(1);
+    }
+}
+
+/*
+ * Spin in user mode for the given time.
+ */
+static void burn(int msec)
+{
+    volatile u_long n = 0;
+    u_long start, now;
+
+    sys_time(&start);
+    do {
+        for (n = 0; n < 10000; n++)
+            ;
+        sys_time(&now);
+    } while ((now - start) * 1000 / hz < (u_long)msec);
+}
+
+static void print_overhead(void)
+{
+    struct cpuinfo info;
+    u_long us, ns;
+
+    printf("CPU    Updates      Cost   ns/update  Interrupts\n");
+    info.cookie = 0;
+    while (sys_info(INFO_CPU, &info) == 0) {
+        if (!info.online || info.nacct == 0)
+            continue;
+        us = info.acct.sec * 1000000 + info.acct.usec;
+        ns = (us / info.nacct) * 1000 + (us % info.nacct) * 1000 / info.nacct;
+        printf("%3d %10u %3lu.%06lu %11lu %4lu.%06lu\n", info.cpu, info.nacct, info.acct.sec, info.acct.usec, ns,
+               info.itime.sec, info.itime.usec);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo tinfo;
+    struct timespec res;
+    struct rusage r0, r1;
+    u_long t0, t1, start, end;
+    int i;
+
+    printf("CPU accounting test\n");
+
+    sys_info(INFO_TIMER, &tinfo);
+    hz = tinfo.hz;
+
+    clock_getres(CLOCK_THREAD_CPUTIME_ID, &res);
+    printf("thread clock resolution: %ld ns\n", res.ts_nsec);
+
+    /* User time */
+    self_usage(&r0);
+    t0 = thread_cputime();
+    burn(BURN_MSEC);
+    t1 = thread_cputime();
+    self_usage(&r1);
+    printf("burn %d ms: cpu %lu us, user %lu us, sys %lu us\n", BURN_MSEC, t1 - t0,
+           tv_usec(&r1.ru_utime) - tv_usec(&r0.ru_utime), tv_usec(&r1.ru_stime) - tv_usec(&r0.ru_stime));
+    if (t1 <= t0 || tv_usec(&r1.ru_utime) <= tv_usec(&r0.ru_utime)) {
+        printf("user time did not advance\n");
+        exit(1);
+    }
+
+    /* The thread clock must not go backwards */
+    t0 = thread_cputime();
+    for (i = 0; i < NR_CALLS; i++) {
+        t1 = thread_cputime();
+        if (t1 < t0) {
+            printf("thread clock went backwards\n");
+            exit(1);
+        }
+        t0 = t1;
+    }
+
+    /* System time */
+    self_usage(&r0);
+    sys_time(&start);
+    for (i = 0; i < NR_CALLS; i++)
+        thread_yield();
+    sys_time(&end);
+    self_usage(&r1);
+    printf("%d yields in %lu ticks: sys %lu us, nivcsw %ld\n", NR_CALLS, end - start,
+           tv_usec(&r1.ru_stime) - tv_usec(&r0.ru_stime), r1.ru_nivcsw - r0.ru_nivcsw);
+    if (tv_usec(&r1.ru_stime) <= tv_usec(&r0.ru_stime)) {
+        printf("system time did not advance\n");
+        exit(1);
+    }
+
+    /* Sleeping is a voluntary switch and does not use CPU time */
+    self_usage(&r0);
+    t0 = thread_cputime();
+    timer_sleep(SLEEP_MSEC, 0);
+    t1 = thread_cputime();
+    self_usage(&r1);
+    printf("sleep %d ms: cpu %lu us, nvcsw %ld\n", SLEEP_MSEC, t1 - t0, r1.ru_nvcsw - r0.ru_nvcsw);
+    if (r1.ru_nvcsw <= r0.ru_nvcsw) {
+        printf("voluntary switch not counted\n");
+        exit(1);
+    }
+    if (t1 - t0 >= SLEEP_MSEC * 1000 / 2) {
+        printf("sleep was billed as CPU time\n");
+        exit(1);
+    }
+
+    /* Task usage includes this thread */
+    getrusage(RUSAGE_SELF, &r0);
+    self_usage(&r1);
+    if (tv_usec(&r0.ru_utime) < tv_usec(&r1.ru_utime)) {
+        printf("task time is less than thread time\n");
+        exit(1);
+    }
+
+    print_overhead();
+    printf("test completed\n");
+    return 0;
+}
@@ -0,0 +1,264 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * dnscache.c - DNS cache test with a stub name server on loopback.
+ *
+ * A thread answers queries on 127.0.0.1:5353: "multi.test" has three
+ * A records, and every other name is NXDOMAIN.  Both answers have a
+ * TTL of two seconds.  The network server is pointed at the stub,
+ * and the test checks that repeated lookups are answered from the
+ * cache, that a name is queried again after its TTL, and reports
+ * the lookup times and the counters of the cache.
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/socket.h>
+#include <sys/endian.h>
+#include <ipc/network.h>
+
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PORT 5353
+#define TTL 2
+#define NLOOKUP 1000
+
+static object_t net_obj;
+static volatile int queries;
+
+static void put16(u_char* p, int v)
+{
+    p[0] = (u_char)(v >> 8);
+    p[1] = (u_char)v;
+}
+
+static void put32(u_char* p, u_long v)
+{
+    put16(p, (int)(v >> 16));
+    put16(p + 2, (int)v);
+}
+
+/*
+ * Turn a query into its answer.  Returns the length.
+ */
+static int stub_answer(u_char* pkt, int len)
+{
+    char name[256];
+    int off = 12, n, i, k = 0;
+
+    while (off < len && (n = pkt[off]) != 0) {
+        if (k + n + 1 >= (int)sizeof(name) || off + n + 1 > len)
+            return 0;
+        if (k > 0)
+            name[k++] = '.';
+        memcpy(&name[k], &pkt[off + 1], (size_t)n);
+        k += n;
+        off += n + 1;
+    }
+    name[k] = '\0';
+    off += 5; /* end of name, type and class */
+    if (off > len)
+        return 0;
+
+    put16(&pkt[6], 0);
+    put16(&pkt[8], 0);
+    put16(&pkt[10], 0);
+    if (strcmp(name, "multi.test") == 0) {
+        put16(&pkt[2], 0x8180);
+        put16(&pkt[6], 3);
+        for (i = 1; i <= 3; i++) {
+            put16(&pkt[off], 0xc00c); /* name of the question */
+            put16(&pkt[off + 2], 1);  /* A */
+            put16(&pkt[off + 4], 1);  /* IN */
+            put32(&pkt[off + 6], TTL);
+            put16(&pkt[off + 10], 4);
+            pkt[off + 12] = 10;
+            pkt[off + 13] = 0;
+            pkt[off + 14] = 0;
+            pkt[off + 15] = (u_char)i;
+            off += 16;
+        }
+    } else {
+        put16(&pkt[2], 0x8183);
+        put16(&pkt[8], 1);
+        put16(&pkt[off], 0xc00c);
+        put16(&pkt[off + 2], 6);      /* SOA */
+        put16(&pkt[off + 4], 1);
+        put32(&pkt[off + 6], 3600);
+        put16(&pkt[off + 10], 22);
+        memset(&pkt[off + 12], 0, 22); /* root names, zero counters */
+        put32(&pkt[off + 30], TTL);   /* minimum */
+        off += 34;
+    }
+    return off;
+}
+
+static void* stub_server(void* arg)
+{
+    struct sockaddr_in from;
+    socklen_t fromlen;
+    u_char pkt[512];
+    ssize_t n;
+    int s = *(int*)arg;
+    int len;
+
+    for (;;) {
+        fromlen = sizeof(from);
+        n = recvfrom(s, pkt, sizeof(pkt) - 64, 0, (struct sockaddr*)&from, &fromlen);
+        if (n < 12)
+            continue;
+        queries++;
+        if ((len = stub_answer(pkt, (int)n)) > 0)
+            sendto(s, pkt, (size_t)len, 0, (struct sockaddr*)&from, fromlen);
+    }
+    return NULL;
+}
+
+static void set_server(uint32_t addr, int port)
+{
+    struct net_msg m;
+    struct sockaddr_in* sin = (struct sockaddr_in*)&m.addr;
+
+    memset(&m, 0, sizeof(m));
+    m.hdr.code = NET_DNSCONF;
+    sin->sin_family = AF_INET;
+    sin->sin_addr.s_addr = addr;
+    sin->sin_port = htons(port);
+    msg_send(net_obj, &m, NET_MSG_HDRSIZE);
+}
+
+static void check(int cond, const char* what)
+{
+
+    if (!cond) {
+        printf("dnscache: FAILED: %s\n", what);
+        set_server(0, 0);
+        exit(1);
+    }
+}
+
+static u_long lookup_usec(const char* name, int count, int expect)
+{
+    struct addrinfo hints, *res, *ai;
+    u_long start, end, hz;
+    struct timerinfo info;
+    u_long a, seen;
+    int i, n, error;
+
+    sys_info(INFO_TIMER, &info);
+    hz = (u_long)info.hz;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+
+    sys_time(&start);
+    for (i = 0; i < count; i++) {
+        error = getaddrinfo(name, "80", &hints, &res);
+        if (expect == 0) {
+            check(error == EAI_NONAME, "negative answer");
+            continue;
+        }
+        check(error == 0, gai_strerror(error));
+        seen = 0;
+        for (n = 0, ai = res; ai != NULL; ai = ai->ai_next) {
+            a = ntohl(((struct sockaddr_in*)ai->ai_addr)->sin_addr.s_addr);
+            check((a & ~0xffUL) == 0x0a000000 && (a & 0xff) >= 1 && (a & 0xff) <= 3 &&
+                      !(seen & (1UL << (a & 0xff))),
+                  "address");
+            seen |= 1UL << (a & 0xff);
+            n++;
+        }
+        check(n == expect, "number of addresses");
+        freeaddrinfo(res);
+    }
+    sys_time(&end);
+    return (end - start) * 1000000 / hz / (u_long)count;
+}
+
+int main(int argc, char* argv[])
+{
+    struct sockaddr_in addr;
+    struct net_dnsstat* st;
+    struct net_msg m;
+    pthread_t th;
+    u_long usec, total;
+    int s, q;
+
+    if (object_lookup(OBJNAME_NETWORK, &net_obj) != 0) {
+        printf("dnscache: network server not found\n");
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(PORT);
+    if ((s = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+        bind(s, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        return 1;
+    }
+    pthread_create(&th, NULL, stub_server, &s);
+    set_server(htonl(INADDR_LOOPBACK), PORT);
+
+    usec = lookup_usec("multi.test", 1, 3);
+    check(queries == 1, "first lookup sends one query");
+    printf("miss:     %8lu usec\n", usec);
+
+    usec = lookup_usec("multi.test", NLOOKUP, 3);
+    check(queries == 1, "cached lookups send no query");
+    printf("hit:      %8lu usec\n", usec);
+
+    lookup_usec("nx.test", 1, 0);
+    q = queries;
+    usec = lookup_usec("nx.test", NLOOKUP, 0);
+    check(queries == q, "negative answer is cached");
+    printf("negative: %8lu usec\n", usec);
+
+    timer_sleep((TTL + 1) * 1000, NULL);
+    q = queries;
+    lookup_usec("multi.test", 1, 3);
+    check(queries == q + 1, "expired name is queried again");
+
+    memset(&m, 0, sizeof(m));
+    m.hdr.code = NET_DNSSTAT;
+    msg_send(net_obj, &m, NET_MSG_HDRSIZE + sizeof(struct net_dnsstat));
+    st = (struct net_dnsstat*)m.data;
+    total = st->hits + st->neghits + st->misses + st->joined;
+    printf("hits %lu, negative hits %lu, misses %lu, joined %lu, timeouts %lu, hit rate %lu%%\n",
+           st->hits, st->neghits, st->misses, st->joined, st->timeouts,
+           total ? (st->hits + st->neghits) * 100 / total : 0);
+
+    set_server(0, 0);
+    printf("dnscache: OK\n");
+    return 0;
+}
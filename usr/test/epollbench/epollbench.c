@@ -0,0 +1,210 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * epollbench.c - epoll wakeup cost with many idle descriptors.
+ *
+ * Ten active descriptors, five pipes and five loopback UDP sockets,
+ * are watched together with a number of idle UDP sockets.  A sender
+ * thread writes one byte to every active descriptor per round, and
+ * the main thread waits with epoll_wait() until all ten have been
+ * read.  The round rate is reported with no idle descriptors and
+ * with the requested number of idle descriptors; it should not
+ * depend on the number of idle ones.
+ *
+ * Usage: epollbench [idle] [rounds]
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/socket.h>
+#include <sys/endian.h>
+#include <sys/epoll.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PORT 5100
+#define NPIPE 5
+#define NUDP 5
+#define NACTIVE (NPIPE + NUDP)
+#define DEF_IDLE 1000
+#define DEF_ROUNDS 2000
+
+static int pipes[NPIPE][2];
+static int usock[NUDP];
+static struct sockaddr_in uaddr[NUDP];
+static int ssock;
+static int rounds;
+static sem_t go;
+
+static void* sender(void* arg)
+{
+    char c = 'x';
+    int r, i;
+
+    for (r = 0; r < rounds; r++) {
+        sem_wait(&go, 0);
+        for (i = 0; i < NPIPE; i++)
+            write(pipes[i][1], &c, 1);
+        for (i = 0; i < NUDP; i++)
+            sendto(ssock, &c, 1, 0, (struct sockaddr*)&uaddr[i], sizeof(uaddr[i]));
+    }
+    return NULL;
+}
+
+static u_long run(int* idle, int nidle, u_long hz)
+{
+    struct epoll_event ev, events[NACTIVE];
+    pthread_t th;
+    u_long start, end, msec;
+    char c;
+    int ep, i, k, n, r, done;
+
+    if ((ep = epoll_create(NACTIVE + nidle)) < 0) {
+        perror("epoll_create");
+        exit(1);
+    }
+    ev.events = EPOLLIN;
+    for (i = 0; i < nidle; i++) {
+        ev.data.u32 = (uint32_t)(NACTIVE + i);
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, idle[i], &ev) < 0) {
+            perror("epoll_ctl");
+            exit(1);
+        }
+    }
+    for (i = 0; i < NPIPE; i++) {
+        ev.data.u32 = (uint32_t)i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, pipes[i][0], &ev);
+    }
+    for (i = 0; i < NUDP; i++) {
+        ev.data.u32 = (uint32_t)(NPIPE + i);
+        epoll_ctl(ep, EPOLL_CTL_ADD, usock[i], &ev);
+    }
+
+    if (pthread_create(&th, NULL, sender, NULL) != 0) {
+        printf("pthread_create failed\n");
+        exit(1);
+    }
+    sys_time(&start);
+    for (r = 0; r < rounds; r++) {
+        sem_post(&go);
+        for (done = 0; done < NACTIVE;) {
+            if ((n = epoll_wait(ep, events, NACTIVE, 1000)) <= 0) {
+                printf("epoll_wait timed out in round %d\n", r);
+                exit(1);
+            }
+            for (i = 0; i < n; i++) {
+                k = (int)events[i].data.u32;
+                if (k < NPIPE)
+                    read(pipes[k][0], &c, 1);
+                else if (k < NACTIVE)
+                    recv(usock[k - NPIPE], &c, 1, 0);
+                else
+                    continue;
+                done++;
+            }
+        }
+    }
+    sys_time(&end);
+    pthread_join(th, NULL);
+    close(ep);
+
+    msec = (end - start) * 1000 / hz;
+    return (msec == 0) ? 1 : msec;
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo info;
+    u_long msec;
+    int* idle;
+    int i, nidle;
+
+    nidle = DEF_IDLE;
+    rounds = DEF_ROUNDS;
+    if (argc > 1)
+        nidle = atoi(argv[1]);
+    if (argc > 2)
+        rounds = atoi(argv[2]);
+    if (nidle < 0 || nidle > EPOLL_MAXFDS - NACTIVE)
+        nidle = EPOLL_MAXFDS - NACTIVE;
+    if (rounds <= 0)
+        rounds = 1;
+
+    sys_info(INFO_TIMER, &info);
+    sem_init(&go, 0);
+
+    for (i = 0; i < NPIPE; i++) {
+        if (pipe(pipes[i]) < 0) {
+            perror("pipe");
+            exit(1);
+        }
+    }
+    for (i = 0; i < NUDP; i++) {
+        memset(&uaddr[i], 0, sizeof(uaddr[i]));
+        uaddr[i].sin_family = AF_INET;
+        uaddr[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        uaddr[i].sin_port = htons(PORT + i);
+        if ((usock[i] = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+            bind(usock[i], (struct sockaddr*)&uaddr[i], sizeof(uaddr[i])) < 0) {
+            perror("bind");
+            exit(1);
+        }
+    }
+    if ((ssock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        perror("socket");
+        exit(1);
+    }
+    if ((idle = malloc(sizeof(int) * (size_t)(nidle + 1))) == NULL) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < nidle; i++) {
+        if ((idle[i] = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+            perror("socket");
+            exit(1);
+        }
+    }
+
+    printf("epollbench: %d active descriptors, %d rounds\n", NACTIVE, rounds);
+    printf("%10s %10s %10s\n", "idle", "msec", "rounds/sec");
+
+    msec = run(idle, 0, (u_long)info.hz);
+    printf("%10d %10lu %10lu\n", 0, msec, (u_long)rounds * 1000 / msec);
+    msec = run(idle, nidle, (u_long)info.hz);
+    printf("%10d %10lu %10lu\n", nidle, msec, (u_long)rounds * 1000 / msec);
+
+    for (i = 0; i < nidle; i++)
+        close(idle[i]);
+    return 0;
+}
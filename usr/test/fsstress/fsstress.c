@@ -0,0 +1,204 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * fsstress.c - file system server scaling test.
+ *
+ * Checks that a task can open more descriptors than the initial
+ * size of its file table, then runs 1, 2, 4 and 8 client processes
+ * which read their own file in parallel and reports the aggregate
+ * read rate for each.
+ *
+ * The number of server threads is fixed when the server is built
+ * (options FS_THREADS), so it can not be varied from here.  With N
+ * server threads the rate scales up to N clients and stays flat
+ * beyond; rebuild with FS_THREADS=1, 2, 4 and 8 to compare the
+ * thread counts themselves.
+ *
+ * Clients are started by running this program again with "-c id".
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/wait.h>
+
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAXCLIENTS 8
+#define NR_READS 2000
+#define IOBUFSZ 512
+#define NR_FDS 40
+
+static char iobuf[IOBUFSZ];
+static char* prog;
+
+static void filename(char* buf, size_t len, int id)
+{
+
+    snprintf(buf, len, "/tmp/fsstress.%d", id);
+}
+
+static int check_fds(void)
+{
+    int fds[NR_FDS];
+    int i, n, fd, error = 0;
+
+    if ((fds[0] = open("/dev/null", O_RDONLY)) < 0) {
+        printf("open failed\n");
+        return -1;
+    }
+    for (n = 1; n < NR_FDS; n++) {
+        if ((fds[n] = dup(fds[0])) < 0)
+            break;
+    }
+    printf("dup: %d descriptors\n", n);
+    if (n < NR_FDS && n < OPEN_MAX - 3)
+        error = -1;
+
+    /* Close one in the middle, and the next dup must reuse it */
+    close(fds[n / 2]);
+    if ((fd = dup(fds[0])) != fds[n / 2]) {
+        printf("dup did not reuse fd %d\n", fds[n / 2]);
+        error = -1;
+    }
+    fds[n / 2] = fd;
+
+    if (dup2(fds[0], OPEN_MAX - 1) != OPEN_MAX - 1) {
+        printf("dup2 to fd %d failed\n", OPEN_MAX - 1);
+        error = -1;
+    } else
+        close(OPEN_MAX - 1);
+
+    for (i = 0; i < n; i++)
+        close(fds[i]);
+    return error;
+}
+
+static int client(int id)
+{
+    char path[32];
+    int fd, i;
+
+    filename(path, sizeof(path), id);
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return 1;
+    for (i = 0; i < NR_READS; i++) {
+        lseek(fd, 0, SEEK_SET);
+        if (read(fd, iobuf, IOBUFSZ) != IOBUFSZ)
+            return 1;
+    }
+    close(fd);
+    return 0;
+}
+
+static int run(int nclients, int hz)
+{
+    pid_t pid[MAXCLIENTS];
+    u_long start, end, msec;
+    char id[12];
+    int i, sts, error = 0;
+
+    sys_time(&start);
+    for (i = 0; i < nclients; i++) {
+        snprintf(id, sizeof(id), "%d", i);
+        if ((pid[i] = vfork()) == 0) {
+            execl(prog, prog, "-c", id, NULL);
+            _exit(1);
+        }
+        if (pid[i] < 0) {
+            printf("fork failed\n");
+            return -1;
+        }
+    }
+    for (i = 0; i < nclients; i++) {
+        if (waitpid(pid[i], &sts, 0) != pid[i] || WEXITSTATUS(sts) != 0)
+            error = -1;
+    }
+    sys_time(&end);
+
+    msec = (end - start) * 1000 / hz;
+    if (msec == 0)
+        msec = 1;
+    printf("%d clients: %6lu msec, %8lu reads/sec\n", nclients, msec,
+           (u_long)nclients * NR_READS * 1000 / msec);
+    return error;
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo info;
+    char path[32];
+    int fd, i, n, error = 0;
+
+    if (argc == 3 && !strcmp(argv[1], "-c"))
+        return client(atoi(argv[2]));
+
+    prog = argv[0];
+    sys_info(INFO_TIMER, &info);
+
+    printf("fsstress: file system server scaling test\n");
+#ifdef CONFIG_FS_THREADS
+    printf("server threads: %d\n", CONFIG_FS_THREADS);
+#else
+    printf("server threads: 1\n");
+#endif
+
+    if (check_fds() != 0)
+        error = -1;
+
+    memset(iobuf, 0x5a, sizeof(iobuf));
+    for (i = 0; i < MAXCLIENTS; i++) {
+        filename(path, sizeof(path), i);
+        if ((fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644)) < 0) {
+            printf("can not create %s\n", path);
+            exit(1);
+        }
+        write(fd, iobuf, IOBUFSZ);
+        close(fd);
+    }
+
+    for (n = 1; n <= MAXCLIENTS; n *= 2) {
+        if (run(n, info.hz) != 0) {
+            printf("client failed\n");
+            error = -1;
+        }
+    }
+
+    for (i = 0; i < MAXCLIENTS; i++) {
+        filename(path, sizeof(path), i);
+        unlink(path);
+    }
+    printf(error ? "test failed\n" : "test succeeded\n");
+    return error ? 1 : 0;
+}
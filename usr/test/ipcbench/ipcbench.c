@@ -0,0 +1,130 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * ipcbench.c - IPC ping-pong benchmark between two tasks.
+ *
+ * Every round trip switches the address space twice, so the
+ * result mostly reflects the cost of a task switch and of the
+ * TLB refill after it.
+ */
+
+#include <sys/prex.h>
+#include <ipc/ipc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_ROUNDS 20000
+
+struct ping_msg {
+    struct msg_header hdr;
+    int seq;
+};
+
+static char stack[1024];
+
+/*
+ * Echo server running in the child task.
+ */
+static void server_thread(void)
+{
+    struct ping_msg m;
+    object_t obj;
+
+    if (object_create("ipcbench", &obj) != 0)
+        panic("ipcbench: object_create failed");
+
+    for (;;) {
+        if (msg_receive(obj, &m, sizeof(m)) != 0)
+            continue;
+        m.seq++;
+        msg_reply(obj, &m, sizeof(m));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    struct ping_msg m;
+    task_t task;
+    thread_t t;
+    object_t obj;
+    u_long start, end;
+    int i, error;
+
+    printf("IPC ping-pong benchmark\n");
+
+    /*
+     * Start the echo server in another task.
+     */
+#ifdef CONFIG_MMU
+    error = task_create(task_self(), VM_COPY, &task);
+#else
+    error = task_create(task_self(), VM_SHARE, &task);
+#endif
+    if (error) {
+        printf("task_create failed. error=%d\n", error);
+        exit(1);
+    }
+    if (thread_create(task, &t) != 0 ||
+        thread_load(t, server_thread, stack + 1024) != 0 ||
+        thread_resume(t) != 0) {
+        printf("failed to start server thread\n");
+        task_terminate(task);
+        exit(1);
+    }
+
+    /*
+     * Wait for the server object.
+     */
+    while (object_lookup("ipcbench", &obj) != 0)
+        timer_sleep(10, 0);
+
+    m.seq = 0;
+    sys_time(&start);
+    for (i = 0; i < NR_ROUNDS; i++) {
+        error = msg_send(obj, &m, sizeof(m));
+        if (error) {
+            printf("msg_send failed. error=%d\n", error);
+            break;
+        }
+    }
+    sys_time(&end);
+
+    if (m.seq != i)
+        printf("sequence mismatch: %d/%d\n", m.seq, i);
+
+    printf("%d round trips in %lu ticks", i, end - start);
+    if (end != start)
+        printf(" (%lu per tick)", (u_long)i / (end - start));
+    printf("\n");
+
+    task_terminate(task);
+    return 0;
+}
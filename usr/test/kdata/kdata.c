@@ -0,0 +1,152 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * kdata.c - kernel data page test.
+ *
+ * Checks that getpid() and getppid() read from the task data
+ * page agree with the process server in the parent and in a
+ * forked child, and compares the cost of getpid() and
+ * gettimeofday() with the message based path.
+ */
+
+#include <sys/prex.h>
+#include <sys/posix.h>
+#include <sys/sysinfo.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <ipc/proc.h>
+#include <ipc/ipc.h>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_CALLS 100000
+
+static int hz;
+
+static pid_t ipc_getpid(void)
+{
+    struct msg m;
+
+    m.hdr.code = PS_GETPID;
+    __posix_call(__proc_obj, &m, sizeof(m), 1);
+    return m.data[0];
+}
+
+static pid_t ipc_getppid(void)
+{
+    struct msg m;
+
+    m.hdr.code = PS_GETPPID;
+    __posix_call(__proc_obj, &m, sizeof(m), 1);
+    return m.data[0];
+}
+
+static int check_ids(const char* who)
+{
+    pid_t pid, ppid;
+
+    pid = ipc_getpid();
+    ppid = ipc_getppid();
+    printf("%s: pid=%d/%d ppid=%d/%d\n", who, getpid(), pid, getppid(), ppid);
+    if (getpid() != pid || getppid() != ppid) {
+        printf("%s: mismatch!\n", who);
+        return -1;
+    }
+    return 0;
+}
+
+static void report(const char* name, u_long start, u_long end)
+{
+    u_long msec;
+
+    msec = (end - start) * 1000 / hz;
+    if (msec == 0)
+        msec = 1;
+    printf("%-16s %8lu calls/sec\n", name, (u_long)NR_CALLS * 1000 / msec);
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo info;
+    struct timeval tv, prev;
+    u_long start, end;
+    pid_t pid;
+    int i, sts;
+
+    printf("kernel data page test\n");
+
+    sys_info(INFO_TIMER, &info);
+    hz = info.hz;
+
+    if (check_ids("parent"))
+        exit(1);
+
+    pid = vfork();
+    if (pid == 0)
+        exit(check_ids("child") ? 1 : 0);
+    if (pid < 0 || waitpid(pid, &sts, 0) != pid || sts != 0) {
+        printf("fork test failed\n");
+        exit(1);
+    }
+
+    /* time must not go backwards */
+    gettimeofday(&prev, NULL);
+    for (i = 0; i < NR_CALLS; i++) {
+        gettimeofday(&tv, NULL);
+        if (tv.tv_sec < prev.tv_sec || (tv.tv_sec == prev.tv_sec && tv.tv_usec < prev.tv_usec)) {
+            printf("time went backwards\n");
+            exit(1);
+        }
+        prev = tv;
+    }
+
+    sys_time(&start);
+    for (i = 0; i < NR_CALLS; i++)
+        ipc_getpid();
+    sys_time(&end);
+    report("getpid (ipc)", start, end);
+
+    sys_time(&start);
+    for (i = 0; i < NR_CALLS; i++)
+        getpid();
+    sys_time(&end);
+    report("getpid", start, end);
+
+    sys_time(&start);
+    for (i = 0; i < NR_CALLS; i++)
+        gettimeofday(&tv, NULL);
+    sys_time(&end);
+    report("gettimeofday", start, end);
+
+    printf("test completed\n");
+    return 0;
+}
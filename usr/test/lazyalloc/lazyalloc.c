@@ -0,0 +1,103 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * lazyalloc.c - demand paging test.
+ *
+ * Memory from vm_allocate() is backed on first touch. Check the
+ * resident size of the area while it is touched page by page.
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFSZ (512 * 1024)
+#define PGSZ 4096
+
+static size_t resident(void* addr)
+{
+    struct vminfo vi;
+
+    vi.cookie = 0;
+    vi.task = task_self();
+    while (sys_info(INFO_VM, &vi) == 0) {
+        if (vi.virt == (vaddr_t)addr)
+            return vi.resident;
+        vi.task = task_self();
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    char* buf;
+    u_long start, end;
+    size_t off;
+    int error;
+
+    printf("Demand paging test\n");
+
+    buf = NULL;
+    sys_time(&start);
+    if (vm_allocate(task_self(), (void**)&buf, BUFSZ, 1)) {
+        printf("vm_allocate failed\n");
+        exit(1);
+    }
+    sys_time(&end);
+    printf("allocated %d KB in %lu ticks, resident %d KB\n", BUFSZ / 1024, end - start, resident(buf) / 1024);
+
+    /*
+     * Touch every other page. Each of them must be zero-filled.
+     */
+    error = 0;
+    for (off = 0; off < BUFSZ; off += PGSZ * 2) {
+        if (buf[off] != 0 || buf[off + PGSZ - 1] != 0)
+            error = 1;
+        buf[off] = 1;
+    }
+    printf("half touched, resident %d KB\n", resident(buf) / 1024);
+
+    sys_time(&start);
+    memset(buf, 0, BUFSZ);
+    sys_time(&end);
+    printf("fully touched in %lu ticks, resident %d KB\n", end - start, resident(buf) / 1024);
+
+    vm_free(task_self(), buf);
+
+    if (error) {
+        printf("Test failed: page is not zero-filled\n");
+        exit(1);
+    }
+    printf("Test succeeded\n");
+    return 0;
+}
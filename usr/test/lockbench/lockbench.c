@@ -0,0 +1,125 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * lockbench.c - kernel lock contention benchmark.
+ *
+ * Several threads issue system calls that take the big kernel
+ * lock as fast as they can. With fair spinlocks each thread
+ * should complete about the same number of calls. Run it on a
+ * multi-core configuration built with the LOCKSTAT option to see
+ * the per-lock counters as well.
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_THREADS 4
+#define STACK_SIZE 1024
+#define RUN_MSEC 2000
+
+static char stack[NR_THREADS][STACK_SIZE];
+static volatile u_long count[NR_THREADS];
+static volatile int stop;
+static volatile int nr_done;
+static mutex_t done_lock = MUTEX_INITIALIZER;
+static int nr_running;
+
+static void worker(void)
+{
+    struct timerinfo info;
+    int id;
+
+    mutex_lock(&done_lock);
+    id = nr_running++;
+    mutex_unlock(&done_lock);
+
+    while (!stop) {
+        sys_info(INFO_TIMER, &info);
+        count[id]++;
+    }
+
+    mutex_lock(&done_lock);
+    nr_done++;
+    mutex_unlock(&done_lock);
+    thread_terminate(thread_self());
+}
+
+static void print_locks(void)
+{
+    struct lockinfo info;
+
+    info.cookie = 0;
+    if (sys_info(INFO_LOCK, &info) != 0) {
+        printf("lock statistics are not available\n");
+        return;
+    }
+    printf("Lock     Name        Acquired Contended    Spins  MaxHoldCyc\n");
+    do {
+        printf("%08lx %-11s %8lu %9lu %8lu %11lu\n", (u_long)info.addr, info.name[0] ? info.name : "-",
+            info.acquired, info.contended, info.spins, info.maxholdcycles);
+    } while (sys_info(INFO_LOCK, &info) == 0);
+}
+
+int main(int argc, char* argv[])
+{
+    thread_t t;
+    u_long total, min, max;
+    int i;
+
+    printf("Lock contention benchmark\n");
+
+    for (i = 0; i < NR_THREADS; i++) {
+        if (thread_create(task_self(), &t) != 0 || thread_load(t, worker, stack[i] + STACK_SIZE) != 0 ||
+            thread_resume(t) != 0)
+            panic("can not start thread");
+    }
+    timer_sleep(RUN_MSEC, 0);
+    stop = 1;
+    while (nr_done < NR_THREADS)
+        timer_sleep(10, 0);
+
+    total = 0;
+    min = max = count[0];
+    for (i = 0; i < NR_THREADS; i++) {
+        printf("thread %d: %lu calls\n", i, count[i]);
+        total += count[i];
+        if (count[i] < min)
+            min = count[i];
+        if (count[i] > max)
+            max = count[i];
+    }
+    printf("total: %lu calls in %d msec, min/max=%lu/%lu\n", total, RUN_MSEC, min, max);
+
+    print_locks();
+    return 0;
+}
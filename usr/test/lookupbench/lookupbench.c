@@ -0,0 +1,166 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * lookupbench.c - path name lookup benchmark.
+ *
+ * Checks that creating, renaming and removing a file is seen by
+ * the next lookup, then times stat() of an existing file, of a
+ * missing file, and a shell style PATH search for a few commands.
+ * If a program is given, it also times vfork() and exec() of that
+ * program with the remaining arguments, e.g. "lookupbench
+ * /usr/bin/make -v".
+ *
+ * Usage: lookupbench [program [args...]]
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_LOOPS 1000
+
+static const char* search_path[] = { "/usr/local/bin", "/usr/bin", "/bin", "/boot", NULL };
+static const char* commands[] = { "sh", "make", "cc", "ls", NULL };
+
+static int hz;
+
+static void report(const char* name, u_long start, u_long end, int count)
+{
+    u_long usec;
+
+    usec = (end - start) * (1000000 / hz) / count;
+    printf("%-8s %8lu usec\n", name, usec);
+}
+
+static int check(const char* msg, int ok)
+{
+
+    printf("%s: %s\n", msg, ok ? "ok" : "NG");
+    return ok ? 0 : -1;
+}
+
+static int check_invalidate(void)
+{
+    struct stat st;
+    int fd, error = 0;
+
+    unlink("/tmp/lookup.a");
+    unlink("/tmp/lookup.b");
+
+    error |= check("missing file", stat("/tmp/lookup.a", &st) != 0);
+    if ((fd = open("/tmp/lookup.a", O_CREAT | O_WRONLY, 0644)) < 0)
+        return check("create", 0);
+    close(fd);
+    error |= check("create", stat("/tmp/lookup.a", &st) == 0);
+
+    error |= check("missing target", stat("/tmp/lookup.b", &st) != 0);
+    rename("/tmp/lookup.a", "/tmp/lookup.b");
+    error |= check("rename source", stat("/tmp/lookup.a", &st) != 0);
+    error |= check("rename target", stat("/tmp/lookup.b", &st) == 0);
+
+    unlink("/tmp/lookup.b");
+    error |= check("unlink", stat("/tmp/lookup.b", &st) != 0);
+
+    error |= check("missing directory", stat("/tmp/lookup.d/x", &st) != 0);
+    mkdir("/tmp/lookup.d", 0755);
+    if ((fd = open("/tmp/lookup.d/x", O_CREAT | O_WRONLY, 0644)) >= 0)
+        close(fd);
+    error |= check("mkdir", stat("/tmp/lookup.d/x", &st) == 0);
+    unlink("/tmp/lookup.d/x");
+    rmdir("/tmp/lookup.d");
+    error |= check("rmdir", stat("/tmp/lookup.d", &st) != 0);
+    return error;
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo info;
+    struct stat st;
+    char path[PATH_MAX];
+    u_long start, end;
+    pid_t pid;
+    int i, j, k, sts, error;
+
+    sys_info(INFO_TIMER, &info);
+    hz = info.hz;
+
+    error = check_invalidate();
+
+    sys_time(&start);
+    for (i = 0; i < NR_LOOPS; i++)
+        stat("/boot", &st);
+    sys_time(&end);
+    report("hit", start, end, NR_LOOPS);
+
+    sys_time(&start);
+    for (i = 0; i < NR_LOOPS; i++)
+        stat("/boot/lookupbench.none", &st);
+    sys_time(&end);
+    report("miss", start, end, NR_LOOPS);
+
+    sys_time(&start);
+    for (i = 0; i < NR_LOOPS / 10; i++) {
+        for (j = 0; commands[j] != NULL; j++) {
+            for (k = 0; search_path[k] != NULL; k++) {
+                snprintf(path, sizeof(path), "%s/%s", search_path[k], commands[j]);
+                if (stat(path, &st) == 0)
+                    break;
+            }
+        }
+    }
+    sys_time(&end);
+    report("PATH", start, end, NR_LOOPS / 10);
+
+    if (argc > 1) {
+        sys_time(&start);
+        for (i = 0; i < NR_LOOPS / 10; i++) {
+            pid = vfork();
+            if (pid == 0) {
+                execv(argv[1], &argv[1]);
+                _exit(1);
+            }
+            if (pid < 0 || waitpid(pid, &sts, 0) != pid) {
+                printf("exec failed\n");
+                exit(1);
+            }
+        }
+        sys_time(&end);
+        report("exec", start, end, NR_LOOPS / 10);
+    }
+    printf(error ? "test failed\n" : "test succeeded\n");
+    return error ? 1 : 0;
+}
@@ -29,13 +29,29 @@
 
 /*
  * malloc.c - malloc test program.
+ *
+ * test_4 is a multi-threaded throughput benchmark and test_5 reports
+ * fragmentation of the heap after a random allocation pattern. The
+ * workers of test_4 exit by pthread_exit(), which returns their
+ * caches to the arenas.
  */
 
+#include <sys/prex.h>
+
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 
 #define NR_ALLOCS 30
 
+#define NR_THREADS 4
+#define NR_SLOTS 256
+#define NR_OPS 20000
+
+static void* slot[NR_THREADS][NR_SLOTS];
+static volatile int nr_errors;
+
 static void* ptr[NR_ALLOCS];
 
 static char* alloc(int buflen)
@@ -137,12 +153,135 @@ static void test_3(void)
     printf("test_3 - done!?\n");
 }
 
+/*
+ * Pick a size: mostly small objects, sometimes a large one.
+ */
+static size_t pick_size(u_long* seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    if (((*seed >> 8) & 0x3f) == 0)
+        return 4096 + ((*seed >> 16) & 0x7fff);
+    return 1 + ((*seed >> 16) & 0x1ff);
+}
+
+static void* worker(void* arg)
+{
+    void** p;
+    u_long seed;
+    size_t size;
+    int i, j, id;
+
+    id = (int)(long)arg;
+    p = slot[id];
+    seed = (u_long)id + 1;
+    for (i = 0; i < NR_OPS; i++) {
+        j = (int)((seed >> 4) % NR_SLOTS);
+        if (p[j] != NULL) {
+            if (*(u_char*)p[j] != (u_char)j)
+                nr_errors++;
+            free(p[j]);
+        }
+        size = pick_size(&seed);
+        if ((p[j] = malloc(size)) == NULL) {
+            nr_errors++;
+            continue;
+        }
+        memset(p[j], j, size);
+    }
+    for (j = 0; j < NR_SLOTS; j++) {
+        free(p[j]);
+        p[j] = NULL;
+    }
+    pthread_exit(NULL);
+    /* NOTREACHED */
+    return NULL;
+}
+
+static void print_stat(void)
+{
+    struct mallstat ms;
+    size_t live;
+
+    mallstat(&ms);
+    live = ms.ms_small - ms.ms_cached;
+    printf("heap=%u live=%u cached=%u large=%u\n", (u_int)ms.ms_heap, (u_int)live, (u_int)ms.ms_cached,
+        (u_int)ms.ms_large);
+    printf("malloc=%lu free=%lu cache hit=%lu\n", ms.ms_nmalloc, ms.ms_nfree, ms.ms_nhit);
+    if (ms.ms_heap != 0)
+        printf("fragmentation=%d%%\n", (int)(100 - live * 100 / ms.ms_heap));
+}
+
+static void test_4(void)
+{
+    pthread_t th[NR_THREADS];
+    u_long start, end;
+    int i, nthreads;
+
+    printf("test_4 - start\n");
+
+    for (nthreads = 1; nthreads <= NR_THREADS; nthreads *= 2) {
+        nr_errors = 0;
+        sys_time(&start);
+        for (i = 0; i < nthreads; i++) {
+            if (pthread_create(&th[i], NULL, worker, (void*)(long)i) != 0)
+                panic("can not start thread");
+        }
+        for (i = 0; i < nthreads; i++)
+            pthread_join(th[i], NULL);
+        sys_time(&end);
+        printf("%d threads: %d ops in %lu ticks, errors=%d\n", nthreads, nthreads * NR_OPS, end - start,
+            nr_errors);
+    }
+    print_stat();
+
+    printf("test_4 - done\n");
+}
+
+static void test_5(void)
+{
+    u_long seed;
+    int i, j;
+
+    printf("test_5 - start\n");
+
+    /*
+     * Fill the slots, then free every other one so that the
+     * survivors pin partially used pages.
+     */
+    seed = 1;
+    for (j = 0; j < NR_SLOTS; j++)
+        slot[0][j] = malloc(pick_size(&seed) & 0x1ff);
+    for (j = 0; j < NR_SLOTS; j += 2) {
+        free(slot[0][j]);
+        slot[0][j] = NULL;
+    }
+    print_stat();
+
+    for (i = 0; i < NR_OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        j = (int)((seed >> 4) % NR_SLOTS);
+        free(slot[0][j]);
+        slot[0][j] = malloc(pick_size(&seed));
+    }
+    print_stat();
+
+    for (j = 0; j < NR_SLOTS; j++) {
+        free(slot[0][j]);
+        slot[0][j] = NULL;
+    }
+    print_stat();
+
+    printf("test_5 - done\n");
+}
+
 int main(int argc, char* argv[])
 {
     printf("Malloc test program.\n");
 
     test_1();
     test_2();
+    test_4();
+    test_5();
     test_3();
 
     return 0;
@@ -0,0 +1,182 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * mixbench.c - sndiod mixing benchmark.
+ *
+ * Mixes N synthetic streams with the sndiod mixing kernels and
+ * reports the CPU time spent per second of mixed audio.  The
+ * first pass uses streams in the mixer format, which are added
+ * straight from the client buffer.  The second pass uses streams
+ * that need format, channel and sample rate conversion and have
+ * the volume lowered.
+ *
+ * Usage: mixbench [streams [seconds]]
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/audioio.h>
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mix.h"
+
+#define OUT_RATE 44100
+#define OUT_CHAN 2
+#define MIX_FRAMES 4096
+#define SRC_SIZE 16384
+#define MAX_STREAMS 16
+
+struct stream
+{
+    struct conv conv;
+    int native;
+    int vol;
+    int off;
+};
+
+static const struct fmt
+{
+    u_int encoding;
+    u_int rate;
+    u_int channels;
+} fmts[] = {
+    { AUDIO_ENCODING_PCM_U8, 22050, 1 },
+    { AUDIO_ENCODING_PCM_S16_BE, 48000, 2 },
+    { AUDIO_ENCODING_ULAW, 8000, 1 },
+    { AUDIO_ENCODING_PCM_S16_LE, 32000, 2 },
+};
+
+static struct stream streams[MAX_STREAMS];
+static int16_t mix_buf[MIX_FRAMES * OUT_CHAN];
+static int16_t conv_buf[MIX_FRAMES * OUT_CHAN];
+static uint8_t src_buf[SRC_SIZE];
+static int hz;
+
+/*
+ * Mix one period of a stream.  The source buffer is played in a loop.
+ */
+static void mix_stream(struct stream* st)
+{
+    int16_t* dst = mix_buf;
+    int left = MIX_FRAMES;
+    int n, nin, used;
+
+    while (left > 0) {
+        nin = (SRC_SIZE - st->off) / st->conv.bpf;
+        if (st->native) {
+            n = (nin < left) ? nin : left;
+            mix_add(dst, (const int16_t*)&src_buf[st->off], n * OUT_CHAN);
+            used = n;
+        } else {
+            n = conv_run(&st->conv, conv_buf, left, &src_buf[st->off], nin, &used);
+            if (st->vol != MIX_UNITY)
+                mix_scale(conv_buf, n * OUT_CHAN, st->vol);
+            mix_add(dst, conv_buf, n * OUT_CHAN);
+        }
+        dst += n * OUT_CHAN;
+        left -= n;
+        st->off += used * st->conv.bpf;
+        if (used >= nin)
+            st->off = 0;
+    }
+}
+
+/*
+ * Returns msec of CPU time per second of audio.
+ */
+static u_long run(int nstreams, int seconds, int convert)
+{
+    struct audio_prinfo pi;
+    u_long start, end;
+    int i, p, periods;
+
+    for (i = 0; i < nstreams; i++) {
+        memset(&pi, 0, sizeof(pi));
+        if (convert) {
+            pi.encoding = fmts[i % 4].encoding;
+            pi.sample_rate = fmts[i % 4].rate;
+            pi.channels = fmts[i % 4].channels;
+        } else {
+            pi.encoding = AUDIO_ENCODING_PCM_S16_LE;
+            pi.sample_rate = OUT_RATE;
+            pi.channels = OUT_CHAN;
+        }
+        streams[i].vol = convert ? MIX_UNITY / 2 : MIX_UNITY;
+        streams[i].native = (conv_setup(&streams[i].conv, &pi, OUT_RATE, OUT_CHAN) == 0 &&
+                             streams[i].vol == MIX_UNITY);
+        streams[i].off = 0;
+    }
+
+    periods = seconds * OUT_RATE / MIX_FRAMES;
+    sys_time(&start);
+    for (p = 0; p < periods; p++) {
+        memset(mix_buf, 0, sizeof(mix_buf));
+        for (i = 0; i < nstreams; i++)
+            mix_stream(&streams[i]);
+    }
+    sys_time(&end);
+
+    /* Scale to the audio time actually mixed */
+    return (end - start) * 1000 / hz * OUT_RATE / ((u_long)periods * MIX_FRAMES);
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo info;
+    u_long msec;
+    int nstreams = 4, seconds = 30;
+    int i;
+
+    sys_info(INFO_TIMER, &info);
+    hz = info.hz;
+
+    if (argc > 1)
+        nstreams = atoi(argv[1]);
+    if (argc > 2)
+        seconds = atoi(argv[2]);
+    if (nstreams < 1 || nstreams > MAX_STREAMS || seconds < 1) {
+        printf("usage: mixbench [streams(1-%d) [seconds]]\n", MAX_STREAMS);
+        exit(1);
+    }
+
+    /* Loud triangle wave, so that saturation happens */
+    for (i = 0; i < SRC_SIZE; i++)
+        src_buf[i] = (uint8_t)((i & 0x100) ? ~i : i);
+
+    printf("kernel: %s, %d streams, %d sec at %d Hz\n", mix_impl(), nstreams, seconds, OUT_RATE);
+    msec = run(nstreams, seconds, 0);
+    printf("native  %4lu msec per sec of audio (%lu%% CPU)\n", msec, msec / 10);
+    msec = run(nstreams, seconds, 1);
+    printf("convert %4lu msec per sec of audio (%lu%% CPU)\n", msec, msec / 10);
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * netbench.c - network receive benchmark.
+ *
+ * Samples the receive statistics of eth0 and the CPU usage over
+ * a period, while traffic is sent to the guest from the host, for
+ * example with a UDP flood through a forwarded port of user-mode
+ * networking.  Reports frames/sec, interrupts/sec, frames per poll
+ * and the CPU load.
+ *
+ * Usage: netbench [seconds]
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/netio.h>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEF_SECS 10
+
+int main(int argc, char* argv[])
+{
+    struct net_stats s0, s1;
+    struct timerinfo t0, t1;
+    device_t dev;
+    u_long ticks, idle, msec;
+    u_int frames, intrs, polls, reads;
+    int secs;
+
+    secs = DEF_SECS;
+    if (argc > 1)
+        secs = atoi(argv[1]);
+    if (secs <= 0)
+        secs = 1;
+
+    if (device_open("eth0", 0, &dev) != 0) {
+        fprintf(stderr, "netbench: cannot open eth0\n");
+        exit(1);
+    }
+    if (device_ioctl(dev, NETIO_GETSTATS, &s0) != 0) {
+        fprintf(stderr, "netbench: no statistics\n");
+        exit(1);
+    }
+    sys_info(INFO_TIMER, &t0);
+
+    printf("netbench: sampling for %d seconds\n", secs);
+    sleep((u_int)secs);
+
+    device_ioctl(dev, NETIO_GETSTATS, &s1);
+    sys_info(INFO_TIMER, &t1);
+    device_close(dev);
+
+    ticks = t1.cputicks - t0.cputicks;
+    idle = t1.idleticks - t0.idleticks;
+    msec = ticks * 1000 / (u_long)t1.hz;
+    if (msec == 0)
+        msec = 1;
+    frames = s1.frames - s0.frames;
+    intrs = s1.intrs - s0.intrs;
+    polls = s1.polls - s0.polls;
+    reads = s1.reads - s0.reads;
+
+    printf("frames:      %8u (%lu/sec)\n", frames, (u_long)frames * 1000 / msec);
+    printf("interrupts:  %8u (%lu/sec)\n", intrs, (u_long)intrs * 1000 / msec);
+    printf("reads:       %8u (%lu/sec)\n", reads, (u_long)reads * 1000 / msec);
+    printf("frames/poll: %8u.%02u (max %u)\n", polls ? frames / polls : 0,
+           polls ? (frames % polls) * 100 / polls : 0, s1.max_batch);
+    printf("frames/read: %8u\n", reads ? frames / reads : 0);
+    printf("stalls:      %8u\n", s1.stalls - s0.stalls);
+    printf("cpu load:    %8lu%%\n", ticks ? (ticks - idle) * 100 / ticks : 0);
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * sendfilebench.c - static file serving benchmark.
+ *
+ * Serves a file over a loopback TCP connection in the manner of an
+ * HTTP server, once with a read()/send() loop and once with
+ * sendfile(), and reports the throughput of each.  A client thread
+ * in the same task sends the request and drains the response.
+ *
+ * Usage: sendfilebench [megabytes]
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/socket.h>
+#include <sys/endian.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PORT 5002
+#define DEF_MBYTES 16
+#define IOBUFSZ (64 * 1024)
+#define FILENAME "/tmp/sendfilebench.dat"
+
+static struct sockaddr_in addr;
+static char iobuf[IOBUFSZ];
+static char rbuf[IOBUFSZ];
+static size_t received;
+
+/*
+ * Client: send a request and read the response until EOF.
+ */
+static void* client(void* arg)
+{
+    static const char req[] = "GET /sendfilebench.dat HTTP/1.0\r\n\r\n";
+    ssize_t n;
+    int s;
+
+    received = 0;
+    if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+        connect(s, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        return NULL;
+    }
+    send(s, req, sizeof(req) - 1, 0);
+    while ((n = recv(s, rbuf, IOBUFSZ, 0)) > 0)
+        received += (size_t)n;
+    return NULL;
+}
+
+/*
+ * Server: accept one request and send the file back.
+ */
+static int serve(int lsock, size_t size, int use_sendfile)
+{
+    char hdr[128];
+    size_t left;
+    ssize_t n;
+    off_t off;
+    int s, fd, len;
+
+    if ((s = accept(lsock, NULL, NULL)) < 0) {
+        perror("accept");
+        return -1;
+    }
+    if (recv(s, hdr, sizeof(hdr), 0) <= 0)
+        return -1;
+    if ((fd = open(FILENAME, O_RDONLY)) < 0)
+        return -1;
+
+    len = snprintf(hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\nContent-Length: %u\r\n\r\n", (u_int)size);
+    send(s, hdr, (size_t)len, 0);
+
+    if (use_sendfile) {
+        off = 0;
+        for (left = size; left > 0; left -= (size_t)n) {
+            if ((n = sendfile(s, fd, &off, left)) <= 0)
+                break;
+        }
+    } else {
+        for (left = size; left > 0; left -= (size_t)n) {
+            if ((n = read(fd, iobuf, IOBUFSZ)) <= 0)
+                break;
+            if (send(s, iobuf, (size_t)n, 0) != n)
+                break;
+        }
+    }
+    close(fd);
+    shutdown(s, SHUT_WR);
+    return (left == 0) ? 0 : -1;
+}
+
+int main(int argc, char* argv[])
+{
+    static const char* names[] = { "read/send", "sendfile" };
+    struct timerinfo info;
+    pthread_t th;
+    u_long start, end, msec;
+    size_t size, done;
+    int i, fd, lsock, mbytes;
+
+    mbytes = DEF_MBYTES;
+    if (argc > 1)
+        mbytes = atoi(argv[1]);
+    if (mbytes <= 0)
+        mbytes = 1;
+    size = (size_t)mbytes * 1024 * 1024;
+
+    sys_info(INFO_TIMER, &info);
+
+    /* Create the file to serve */
+    if ((fd = open(FILENAME, O_CREAT | O_TRUNC | O_WRONLY, 0644)) < 0) {
+        printf("can not create %s\n", FILENAME);
+        exit(1);
+    }
+    memset(iobuf, 0x5a, IOBUFSZ);
+    for (done = 0; done < size; done += IOBUFSZ) {
+        if (write(fd, iobuf, IOBUFSZ) != IOBUFSZ) {
+            printf("write failed\n");
+            exit(1);
+        }
+    }
+    close(fd);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(PORT);
+
+    if ((lsock = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+        bind(lsock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(lsock, 1) < 0) {
+        perror("listen");
+        exit(1);
+    }
+
+    printf("sendfilebench: %d MB file over loopback TCP\n", mbytes);
+    printf("%-10s %10s %10s\n", "method", "msec", "KB/sec");
+
+    for (i = 0; i < 2; i++) {
+        if (pthread_create(&th, NULL, client, NULL) != 0) {
+            printf("pthread_create failed\n");
+            exit(1);
+        }
+        sys_time(&start);
+        if (serve(lsock, size, i) != 0) {
+            printf("%s failed\n", names[i]);
+            exit(1);
+        }
+        pthread_join(th, NULL);
+        sys_time(&end);
+
+        if (received < size) {
+            printf("received %u of %u bytes\n", (u_int)received, (u_int)size);
+            exit(1);
+        }
+        msec = (end - start) * 1000 / (u_long)info.hz;
+        if (msec == 0)
+            msec = 1;
+        printf("%-10s %10lu %10lu\n", names[i], msec, (u_long)(size / msec * 1000 / 1024));
+    }
+    unlink(FILENAME);
+    return 0;
+}
@@ -21,7 +21,7 @@
 
 #define SAMPLE_RATE 44100
 #define CHANNELS 2
-#define BUFFER_SIZE 16384 /* Must match server MIX_BUFFER_SIZE for now */
+#define BUFFER_SIZE 16384
 
 #ifdef DEBUG_SNDIO_TEST
 #define DPRINTF(a) printf a
@@ -121,6 +121,7 @@ int main(int argc, char *argv[])
     /* Initial queueing */
     fill_buffer(buf0, BUFFER_SIZE, &phase);
     struct sndio_queue_msg q_msg;
+    struct sndio_stats_msg stats_msg;
     q_msg.hdr.code = SNDIO_QUEUE_BUF;
     q_msg.buf_id = 0;
     msg_send(sndio_obj, &q_msg, sizeof(q_msg));
@@ -160,6 +161,22 @@ int main(int argc, char *argv[])
     msg.hdr.code = SNDIO_STOP;
     msg_send(sndio_obj, &msg, sizeof(msg));
 
+    /* Show mixer statistics */
+    stats_msg.hdr.code = SNDIO_GET_STATS;
+    if (msg_send(sndio_obj, &stats_msg, sizeof(stats_msg)) == 0 &&
+        stats_msg.hdr.status == 0) {
+        struct sndio_stats *st = &stats_msg.stats;
+        int i;
+
+        printf("sndio_test: period %u ms, %u blocks, %u cycles, %u late, %u underruns\n",
+               st->period, st->nblks, st->cycles, st->late, st->underruns);
+        printf("sndio_test: latency avg %u ms, max %u ms\n", st->lat_avg, st->lat_max);
+        printf("sndio_test: mix time histogram:");
+        for (i = 0; i < SNDIO_HIST_SIZE; i++)
+            printf(" %u", st->mix_hist[i]);
+        printf("\n");
+    }
+
     /* Close */
     msg.hdr.code = SNDIO_CLOSE;
     msg_send(sndio_obj, &msg, sizeof(msg));
@@ -0,0 +1,155 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * sockbench.c - loopback TCP throughput benchmark.
+ *
+ * Sends 100 MB over a loopback TCP connection for several send()
+ * sizes, and reports the throughput.  A receiver thread in the same
+ * task accepts the connection and drains it with large recv() calls.
+ *
+ * Usage: sockbench [megabytes]
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/socket.h>
+#include <sys/endian.h>
+
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PORT 5001
+#define DEF_MBYTES 100
+#define RECV_BUFSZ (256 * 1024)
+
+static const size_t sizes[] = { 2048, 16 * 1024, 64 * 1024, 1024 * 1024 };
+
+static int lsock;
+static char* rbuf;
+static size_t received;
+
+static void* receiver(void* arg)
+{
+    ssize_t n;
+    int s;
+
+    received = 0;
+    if ((s = accept(lsock, NULL, NULL)) < 0) {
+        perror("accept");
+        return NULL;
+    }
+    while ((n = recv(s, rbuf, RECV_BUFSZ, 0)) > 0)
+        received += (size_t)n;
+    if (n < 0)
+        perror("recv");
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    struct sockaddr_in addr;
+    struct timerinfo info;
+    pthread_t th;
+    u_long start, end, msec;
+    size_t total, left, chunk;
+    ssize_t n;
+    char* sbuf;
+    u_int i;
+    int s, mbytes;
+
+    mbytes = DEF_MBYTES;
+    if (argc > 1)
+        mbytes = atoi(argv[1]);
+    if (mbytes <= 0)
+        mbytes = 1;
+    total = (size_t)mbytes * 1024 * 1024;
+
+    sys_info(INFO_TIMER, &info);
+
+    sbuf = malloc(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+    rbuf = malloc(RECV_BUFSZ);
+    if (sbuf == NULL || rbuf == NULL) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    memset(sbuf, 0x5a, sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(PORT);
+
+    if ((lsock = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+        bind(lsock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(lsock, 1) < 0) {
+        perror("listen");
+        exit(1);
+    }
+
+    printf("sockbench: %d MB over loopback TCP\n", mbytes);
+    printf("%10s %10s %10s\n", "send size", "msec", "KB/sec");
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (pthread_create(&th, NULL, receiver, NULL) != 0) {
+            printf("pthread_create failed\n");
+            exit(1);
+        }
+        if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+            connect(s, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            perror("connect");
+            exit(1);
+        }
+
+        sys_time(&start);
+        for (left = total; left > 0; left -= (size_t)n) {
+            chunk = (left < sizes[i]) ? left : sizes[i];
+            if ((n = send(s, sbuf, chunk, 0)) <= 0) {
+                perror("send");
+                exit(1);
+            }
+        }
+        shutdown(s, SHUT_WR);
+        pthread_join(th, NULL);
+        sys_time(&end);
+
+        if (received != total) {
+            printf("received %u of %u bytes\n", (u_int)received, (u_int)total);
+            exit(1);
+        }
+        msec = (end - start) * 1000 / (u_long)info.hz;
+        if (msec == 0)
+            msec = 1;
+        printf("%10u %10lu %10lu\n", (u_int)sizes[i], msec,
+               (u_long)(total / msec * 1000 / 1024));
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * spawnbench.c - posix_spawn() test.
+ *
+ * Checks that file actions and the process group attribute are
+ * applied to a spawned child, and compares the latency of
+ * posix_spawn() with vfork() and execv().
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+#include <sys/wait.h>
+
+#include <unistd.h>
+#include <spawn.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#define NR_SPAWN 100
+
+extern char** environ;
+
+static int hz;
+
+static void report(const char* name, u_long start, u_long end)
+{
+    u_long usec;
+
+    usec = (end - start) * (1000000 / hz) / NR_SPAWN;
+    printf("%-16s %8lu usec/spawn\n", name, usec);
+}
+
+static int check_actions(char* prog)
+{
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    char* args[] = {prog, "-p", NULL};
+    char buf[16];
+    pid_t pid;
+    int pfd[2], sts, error, n;
+
+    if (pipe(pfd) == -1) {
+        printf("pipe failed\n");
+        return -1;
+    }
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, pfd[1], 1);
+    posix_spawn_file_actions_addclose(&fa, pfd[0]);
+    posix_spawn_file_actions_addclose(&fa, pfd[1]);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    error = posix_spawn(&pid, prog, &fa, &attr, args, environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&fa);
+    close(pfd[1]);
+    if (error) {
+        printf("posix_spawn: %s\n", strerror(error));
+        close(pfd[0]);
+        return -1;
+    }
+    n = read(pfd[0], buf, sizeof(buf) - 1);
+    close(pfd[0]);
+    if (waitpid(pid, &sts, 0) != pid || sts != 0) {
+        printf("child failed\n");
+        return -1;
+    }
+    buf[n > 0 ? n : 0] = '\0';
+    printf("child: %s\n", buf);
+    return strcmp(buf, "ok") ? -1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo info;
+    char* args[] = {argv[0], "-c", NULL};
+    u_long start, end;
+    pid_t pid;
+    int i, sts, error;
+
+    if (argc > 1 && !strcmp(argv[1], "-c"))
+        exit(0);
+    if (argc > 1 && !strcmp(argv[1], "-p")) {
+        /* Report if we lead our own process group */
+        if (getpgrp() == getpid())
+            write(1, "ok", 2);
+        else
+            write(1, "bad", 3);
+        exit(0);
+    }
+
+    printf("posix_spawn test\n");
+
+    sys_info(INFO_TIMER, &info);
+    hz = info.hz;
+
+    if (check_actions(argv[0]))
+        exit(1);
+
+    error = posix_spawn(&pid, "/boot/nonexistent", NULL, NULL, args, environ);
+    if (error != ENOENT) {
+        printf("spawn of missing file returned %d\n", error);
+        exit(1);
+    }
+
+    sys_time(&start);
+    for (i = 0; i < NR_SPAWN; i++) {
+        pid = vfork();
+        if (pid == 0) {
+            execv(argv[0], &args[1]);
+            _exit(1);
+        }
+        if (pid < 0 || waitpid(pid, &sts, 0) != pid || sts != 0) {
+            printf("vfork/execv failed\n");
+            exit(1);
+        }
+    }
+    sys_time(&end);
+    report("vfork+execv", start, end);
+
+    sys_time(&start);
+    for (i = 0; i < NR_SPAWN; i++) {
+        error = posix_spawn(&pid, argv[0], NULL, NULL, args, environ);
+        if (error || waitpid(pid, &sts, 0) != pid || sts != 0) {
+            printf("posix_spawn failed\n");
+            exit(1);
+        }
+    }
+    sys_time(&end);
+    report("posix_spawn", start, end);
+
+    printf("test completed\n");
+    return 0;
+}
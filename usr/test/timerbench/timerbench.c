@@ -0,0 +1,134 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * timerbench.c - periodic timer benchmark.
+ *
+ * Many real-time threads wait on periodic timers at the same time.
+ * Each thread records how late it wakes up, in ticks, against its
+ * ideal schedule.  The per-CPU timer queue statistics show how the
+ * expirations are spread over the CPUs and how late the clock tick
+ * of each CPU found them.
+ */
+
+#include <sys/prex.h>
+#include <sys/param.h>
+#include <sys/sysinfo.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_THREADS 16
+#define STACK_SIZE 1024
+#define PERIOD_MSEC 10
+#define NR_PERIODS 200
+
+static char stack[NR_THREADS][STACK_SIZE];
+static u_long late[NR_THREADS][NTIMERLATE];
+static volatile int nr_done;
+static mutex_t done_lock = MUTEX_INITIALIZER;
+static int nr_running;
+static int period;
+
+static void worker(void)
+{
+    u_long base, now, expect;
+    long d;
+    int id, i;
+
+    mutex_lock(&done_lock);
+    id = nr_running++;
+    mutex_unlock(&done_lock);
+
+    if (timer_periodic(thread_self(), PERIOD_MSEC, PERIOD_MSEC) != 0)
+        panic("timer_periodic failed");
+
+    timer_waitperiod();
+    sys_time(&base);
+    for (i = 1; i <= NR_PERIODS; i++) {
+        timer_waitperiod();
+        sys_time(&now);
+        expect = base + (u_long)(i * period);
+        d = (long)(now - expect);
+        if (d < 0)
+            d = 0;
+        late[id][d < NTIMERLATE - 1 ? d : NTIMERLATE - 1]++;
+    }
+    timer_periodic(thread_self(), 0, 0);
+
+    mutex_lock(&done_lock);
+    nr_done++;
+    mutex_unlock(&done_lock);
+    thread_terminate(thread_self());
+}
+
+static void print_timerq(void)
+{
+    struct timerqinfo info;
+
+    info.cookie = 0;
+    if (sys_info(INFO_TIMERQ, &info) != 0) {
+        printf("timer queue statistics are not available\n");
+        return;
+    }
+    printf("CPU Active  Oneshot Periodic Migrated   late:0      1      2     3+\n");
+    do {
+        printf("%3d %6u %8lu %8lu %8lu %8lu %6lu %6lu %6lu\n", info.cpu, info.active, info.expired,
+            info.periodic, info.migrated, info.late[0], info.late[1], info.late[2], info.late[3]);
+    } while (sys_info(INFO_TIMERQ, &info) == 0);
+}
+
+int main(int argc, char* argv[])
+{
+    struct timerinfo tinfo;
+    thread_t t;
+    int i;
+
+    printf("Periodic timer benchmark\n");
+
+    sys_info(INFO_TIMER, &tinfo);
+    period = PERIOD_MSEC * tinfo.hz / 1000;
+    if (period == 0)
+        period = 1;
+
+    for (i = 0; i < NR_THREADS; i++) {
+        if (thread_create(task_self(), &t) != 0 || thread_load(t, worker, stack[i] + STACK_SIZE) != 0 ||
+            thread_setpri(t, PRI_REALTIME) != 0 || thread_resume(t) != 0)
+            panic("can not start thread");
+    }
+    while (nr_done < NR_THREADS)
+        timer_sleep(100, 0);
+
+    printf("thread   late:0      1      2     3+ (ticks)\n");
+    for (i = 0; i < NR_THREADS; i++)
+        printf("%6d %8lu %6lu %6lu %6lu\n", i, late[i][0], late[i][1], late[i][2], late[i][3]);
+
+    print_timerq();
+    return 0;
+}
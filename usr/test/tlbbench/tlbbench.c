@@ -0,0 +1,91 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * tlbbench.c - TLB-miss-sensitive memory benchmark.
+ *
+ * Large buffers from vm_allocate() are mapped with superpages when
+ * the MMU supports them. Compare the results with a kernel that
+ * maps them with base pages.
+ */
+
+#include <sys/prex.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFSZ (4 * 1024 * 1024)
+#define NR_COPY 16
+#define NR_ACCESS (1024 * 1024)
+
+int main(int argc, char* argv[])
+{
+    char *src, *dst;
+    u_long start, end, seed;
+    u_int sum;
+    int i;
+
+    printf("TLB benchmark\n");
+
+    src = NULL;
+    dst = NULL;
+    if (vm_allocate(task_self(), (void**)&src, BUFSZ, 1) ||
+        vm_allocate(task_self(), (void**)&dst, BUFSZ, 1)) {
+        printf("vm_allocate failed\n");
+        exit(1);
+    }
+    printf("buffers at %p and %p\n", src, dst);
+
+    /*
+     * Large sequential copy
+     */
+    sys_time(&start);
+    for (i = 0; i < NR_COPY; i++)
+        memcpy(dst, src, BUFSZ);
+    sys_time(&end);
+    printf("memcpy: %d x %d KB in %lu ticks\n", NR_COPY, BUFSZ / 1024, end - start);
+
+    /*
+     * Random access, one word per page on average
+     */
+    seed = 1;
+    sum = 0;
+    sys_time(&start);
+    for (i = 0; i < NR_ACCESS; i++) {
+        seed = seed * 1103515245 + 12345;
+        sum += (u_int)src[(seed >> 4) % BUFSZ]++;
+    }
+    sys_time(&end);
+    printf("random: %d accesses in %lu ticks (sum=%u)\n", NR_ACCESS, end - start, sum);
+
+    vm_free(task_self(), src);
+    vm_free(task_self(), dst);
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*-
+ * Copyright (c) 2026, Champ Yen <champ.yen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the author nor the names of any co-contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * ttybench.c - console output benchmark.
+ *
+ * Writes a block of text to the console with write(2) in
+ * chunks of various sizes and reports the throughput in
+ * bytes/sec.  Raw mode is also measured so the cost of output
+ * processing can be seen.
+ *
+ * Usage: ttybench [total-bytes]
+ */
+
+#include <sys/prex.h>
+#include <sys/sysinfo.h>
+
+#include <termios.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEF_TOTAL 16384
+#define LINE_LEN 64
+
+static char buf[1024];
+static int hz;
+
+static u_long run(size_t total, size_t chunk)
+{
+    u_long start, end, msec;
+    size_t done, n;
+
+    sys_time(&start);
+    for (done = 0; done < total; done += n) {
+        n = total - done;
+        if (n > chunk)
+            n = chunk;
+        if (write(STDOUT_FILENO, buf, n) != (ssize_t)n) {
+            fprintf(stderr, "write failed\n");
+            exit(1);
+        }
+    }
+    /* Wait for the output queue to drain */
+    tcdrain(STDOUT_FILENO);
+    sys_time(&end);
+
+    msec = (end - start) * 1000 / hz;
+    if (msec == 0)
+        msec = 1;
+    return (u_long)total * 1000 / msec;
+}
+
+int main(int argc, char* argv[])
+{
+    static const size_t chunks[] = { 1, 16, 128, 1024 };
+    struct timerinfo info;
+    struct termios t, raw;
+    u_long rate[4], rawrate;
+    size_t total;
+    int i;
+
+    sys_info(INFO_TIMER, &info);
+    hz = info.hz;
+
+    total = DEF_TOTAL;
+    if (argc > 1)
+        total = (size_t)atoi(argv[1]);
+
+    /* Printable lines with a newline at the end */
+    for (i = 0; i < (int)sizeof(buf); i++)
+        buf[i] = (char)('!' + i % 64);
+    for (i = LINE_LEN - 1; i < (int)sizeof(buf); i += LINE_LEN)
+        buf[i] = '\n';
+
+    for (i = 0; i < 4; i++)
+        rate[i] = run(total, chunks[i]);
+
+    rawrate = 0;
+    if (tcgetattr(STDOUT_FILENO, &t) == 0) {
+        raw = t;
+        raw.c_lflag &= ~ICANON;
+        tcsetattr(STDOUT_FILENO, TCSADRAIN, &raw);
+        rawrate = run(total, sizeof(buf));
+        tcsetattr(STDOUT_FILENO, TCSADRAIN, &t);
+    }
+
+    printf("\n");
+    for (i = 0; i < 4; i++)
+        printf("write %4u bytes: %8lu bytes/sec\n", (u_int)chunks[i], rate[i]);
+    printf("raw   %4u bytes: %8lu bytes/sec\n", (u_int)sizeof(buf), rawrate);
+    return 0;
+}